@@ -25,12 +25,28 @@
 #include "../common/logging/common.h"
 #include "../common/notifications.h"
 #include "../common/process.h"
+#include "../common/startup-trace.h"
 
 namespace fs = ghc::filesystem;
 
 void* find_plugin_library(const std::string& name) {
+    // All loads use `RTLD_NODELETE` so the plugin library stays resident when
+    // a chainloader copy gets `dlclose()`'d again, like during a plugin scan.
+    // Subsequent loads then reuse the already relocated library through the
+    // `RTLD_NOLOAD` check below instead of repeating the search. This matters
+    // because every plugin gets its own copy of the chainloader library, so
+    // these copies cannot simply share their state through a global.
+    constexpr int dlopen_flags = RTLD_LAZY | RTLD_LOCAL | RTLD_NODELETE;
+
     // Just using a goto for this would probably be cleaner, but yeah...
     const auto impl = [&name]() -> void* {
+        // If another chainloader in this process has already loaded the
+        // library, then the dynamic linker can resolve it by its soname
+        // without touching the file system
+        if (void* handle = dlopen(name.c_str(), dlopen_flags | RTLD_NOLOAD)) {
+            return handle;
+        }
+
         // If `name` exists right next to the Wine plugin host binary, then
         // we'll try loading that. Otherwise we'll fall back to regular
         // `dlopen()` for distro packaged versions of yabridge
@@ -39,7 +55,7 @@ void* find_plugin_library(const std::string& name) {
                 search_in_path(search_path, yabridge_host_name)) {
             const fs::path candidate = yabridge_host_path->parent_path() / name;
             if (fs::exists(candidate)) {
-                return dlopen(candidate.c_str(), RTLD_LAZY | RTLD_LOCAL);
+                return dlopen(candidate.c_str(), dlopen_flags);
             }
         }
 
@@ -48,11 +64,11 @@ void* find_plugin_library(const std::string& name) {
             const fs::path candidate =
                 yabridge_host_32_path->parent_path() / name;
             if (fs::exists(candidate)) {
-                return dlopen(candidate.c_str(), RTLD_LAZY | RTLD_LOCAL);
+                return dlopen(candidate.c_str(), dlopen_flags);
             }
         }
 
-        if (void* handle = dlopen(name.c_str(), RTLD_LAZY | RTLD_LOCAL)) {
+        if (void* handle = dlopen(name.c_str(), dlopen_flags)) {
             return handle;
         }
 
@@ -69,8 +85,7 @@ void* find_plugin_library(const std::string& name) {
                  "/usr/local/lib64",
              }) {
             const fs::path candidate = fs::path(lib_dir) / name;
-            if (void* handle =
-                    dlopen(candidate.c_str(), RTLD_LAZY | RTLD_LOCAL)) {
+            if (void* handle = dlopen(candidate.c_str(), dlopen_flags)) {
                 return handle;
             }
         }
@@ -78,7 +93,9 @@ void* find_plugin_library(const std::string& name) {
         return nullptr;
     };
 
+    startup_trace_event("chainloader-dlopen-begin");
     void* handle = impl();
+    startup_trace_event("chainloader-dlopen-end");
     if (!handle) {
         const fs::path this_plugin_path = get_this_file_location();
 
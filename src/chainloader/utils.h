@@ -22,9 +22,13 @@
  * Finds the matching `libyabridge-*.so` for this chainloader. Returns the
  * handle if it is found. Otherwise, we'll log an error and show a desktop
  * notification, and this function returns a null pointer. The pointer may be
- * `dlclose()`'d when it's no longer needed. This search works in the following
- * order:
+ * `dlclose()`'d when it's no longer needed. The library is loaded with
+ * `RTLD_NODELETE` so it stays resident in the process after that, and other
+ * chainloader copies in the same process reuse the already loaded library
+ * directly instead of repeating the file system search. This search works in
+ * the following order:
  *
+ * - If the library is already loaded in this process, reuse it.
  * - First we'll try to locate `yabridge-host.exe` using the same method used by
  *   the yabridge plugin bridges themselves. We'll search in `$PATH`, followed
  *   by `${XDG_DATA_HOME:-$HOME/.local/share}/yabridge`. If that file exists and
@@ -0,0 +1,202 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Copy kernels for moving audio between host buffers and the shared memory
+ * objects. The per-block gather/scatter copies are the largest fixed CPU cost
+ * in the bridging process after the plugin's own DSP, so these deserve a bit
+ * more attention than a plain loop:
+ *
+ * - Same-precision copies go through `memcpy()`, which every libc already
+ *   vectorizes as well as it's going to get.
+ * - Mixed 32-bit/64-bit copies (CLAP allows ports to do either precision, and
+ *   the shared memory layout always reserves 64-bit sized slots for those)
+ *   use explicit AVX/SSE2 conversion kernels on x86, selected once at runtime
+ *   based on what the CPU supports. On other architectures the plain loop is
+ *   simple enough that the compiler's auto-vectorizer (e.g. to NEON) takes
+ *   care of it.
+ */
+namespace audio_copy {
+
+namespace detail {
+
+inline void convert_f32_to_f64_scalar(const float* src,
+                                      size_t n,
+                                      double* dst) noexcept {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = static_cast<double>(src[i]);
+    }
+}
+
+inline void convert_f64_to_f32_scalar(const double* src,
+                                      size_t n,
+                                      float* dst) noexcept {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx"))) inline void
+convert_f32_to_f64_avx(const float* src, size_t n, double* dst) noexcept {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm_loadu_ps(src + i)));
+    }
+    for (; i < n; i++) {
+        dst[i] = static_cast<double>(src[i]);
+    }
+}
+
+__attribute__((target("avx"))) inline void
+convert_f64_to_f32_avx(const double* src, size_t n, float* dst) noexcept {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+    }
+    for (; i < n; i++) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+__attribute__((target("sse2"))) inline void
+convert_f32_to_f64_sse2(const float* src, size_t n, double* dst) noexcept {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i,
+                      _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(
+                          reinterpret_cast<const __m128i*>(src + i)))));
+    }
+    for (; i < n; i++) {
+        dst[i] = static_cast<double>(src[i]);
+    }
+}
+
+__attribute__((target("sse2"))) inline void
+convert_f64_to_f32_sse2(const double* src, size_t n, float* dst) noexcept {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(dst + i),
+            _mm_castps_si128(_mm_cvtpd_ps(_mm_loadu_pd(src + i))));
+    }
+    for (; i < n; i++) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+inline auto resolve_f32_to_f64() noexcept {
+    if (__builtin_cpu_supports("avx")) {
+        return &convert_f32_to_f64_avx;
+    } else if (__builtin_cpu_supports("sse2")) {
+        return &convert_f32_to_f64_sse2;
+    } else {
+        return &convert_f32_to_f64_scalar;
+    }
+}
+
+inline auto resolve_f64_to_f32() noexcept {
+    if (__builtin_cpu_supports("avx")) {
+        return &convert_f64_to_f32_avx;
+    } else if (__builtin_cpu_supports("sse2")) {
+        return &convert_f64_to_f32_sse2;
+    } else {
+        return &convert_f64_to_f32_scalar;
+    }
+}
+
+// These get resolved exactly once, the first time a translation unit
+// including this header gets initialized
+inline const auto convert_f32_to_f64 = resolve_f32_to_f64();
+inline const auto convert_f64_to_f32 = resolve_f64_to_f32();
+#else
+inline constexpr auto convert_f32_to_f64 = &convert_f32_to_f64_scalar;
+inline constexpr auto convert_f64_to_f32 = &convert_f64_to_f32_scalar;
+#endif
+
+}  // namespace detail
+
+/**
+ * Copy `n` audio samples from `src` to `dst`, converting between single and
+ * double precision floating point values when the two types differ. The
+ * argument order matches `std::copy_n()`.
+ */
+template <typename From, typename To>
+inline void convert_copy_n(const From* src, size_t n, To* dst) noexcept {
+    static_assert(std::is_floating_point_v<From> &&
+                  std::is_floating_point_v<To>);
+
+    if constexpr (std::is_same_v<From, To>) {
+        std::memcpy(dst, src, n * sizeof(From));
+    } else if constexpr (std::is_same_v<From, float>) {
+        detail::convert_f32_to_f64(src, n, dst);
+    } else {
+        detail::convert_f64_to_f32(src, n, dst);
+    }
+}
+
+/**
+ * Check whether all `n` samples in `buffer` are digital silence. Both positive
+ * and negative floating point zero count as silence. This is used to skip the
+ * input gather copies for silent channels, since in a large session most
+ * instances receive silence most of the time.
+ *
+ * The inner loop accumulates the absolute values over a fixed size chunk
+ * instead of branching on every sample. That keeps it auto-vectorizable while
+ * still bailing out after a single chunk for buffers that obviously aren't
+ * silent, so the scan costs next to nothing in the non-silent case.
+ */
+template <typename T>
+inline bool is_silent(const T* buffer, size_t n) noexcept {
+    static_assert(std::is_floating_point_v<T>);
+
+    constexpr size_t chunk_size = 64;
+    size_t i = 0;
+    for (; i + chunk_size <= n; i += chunk_size) {
+        // The absolute values so samples can't cancel each other out. A
+        // nonzero sum may round to infinity but it can never round back to
+        // zero.
+        T accumulated = static_cast<T>(0.0);
+        for (size_t j = 0; j < chunk_size; j++) {
+            accumulated += std::fabs(buffer[i + j]);
+        }
+
+        if (accumulated != static_cast<T>(0.0)) {
+            return false;
+        }
+    }
+
+    for (; i < n; i++) {
+        if (buffer[i] != static_cast<T>(0.0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace audio_copy
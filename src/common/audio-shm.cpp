@@ -16,12 +16,95 @@
 
 #include "audio-shm.h"
 
+#include <chrono>
+#include <climits>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <ghc/filesystem.hpp>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "logging/common.h"
+#include "process.h"
+
+namespace fs = ghc::filesystem;
 
 using namespace std::literals::string_literals;
 
+/**
+ * A small wrapper around the futex syscall, since glibc doesn't provide one.
+ * The timeout is relative and may be a null pointer to block indefinitely.
+ */
+static long futex(std::atomic<uint32_t>& word,
+                  int futex_op,
+                  uint32_t value,
+                  const struct timespec* timeout = nullptr) noexcept {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), futex_op,
+                   value, timeout, nullptr, 0);
+}
+
+// These constants are normally defined in libnuma's `<numaif.h>`, but we only
+// need a single `mbind()` call so we'll define them ourselves instead of
+// pulling in that dependency
+constexpr int mpol_preferred = 1;
+constexpr unsigned int mpol_mf_move = 1 << 1;
+
+/**
+ * Place the pages backing `[addr, addr + length)` on the given NUMA node,
+ * migrating any pages that have already been faulted in elsewhere. This is
+ * best effort: we prefer the node instead of strictly binding to it so
+ * allocations don't start failing when the node runs out of memory, and any
+ * errors are simply ignored.
+ */
+static void bind_to_numa_node(void* addr,
+                              size_t length,
+                              int32_t node) noexcept {
+    const unsigned long nodemask = 1UL << node;
+    syscall(SYS_mbind, addr, length, mpol_preferred, &nodemask,
+            sizeof(nodemask) * CHAR_BIT, mpol_mf_move);
+}
+
+/**
+ * Hint to the CPU that we're in a busy-wait loop so it can yield pipeline
+ * resources to the other hyperthread.
+ */
+static inline void cpu_pause() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Busy-wait until `predicate()` returns true or until the budget runs out,
+ * returning whether the predicate was satisfied. The clock is only checked
+ * once every few iterations since `clock_gettime()` would otherwise dominate
+ * the loop.
+ */
+template <typename P>
+static bool spin_wait_for(P predicate,
+                          std::chrono::microseconds budget) noexcept {
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    while (true) {
+        for (int i = 0; i < 64; i++) {
+            if (predicate()) {
+                return true;
+            }
+
+            cpu_pause();
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+    }
+}
+
 AudioShmBuffer::AudioShmBuffer(const Config& config)
     : config_(config),
       shm_fd_(shm_open(config.name.c_str(), O_RDWR | O_CREAT, 0600)) {
@@ -31,6 +114,8 @@ AudioShmBuffer::AudioShmBuffer(const Config& config)
             "Could not create shared memory object " + config_.name);
     }
 
+    ShmRegistry::register_object(config_.name);
+
     setup_mapping();
 }
 
@@ -39,9 +124,40 @@ AudioShmBuffer::~AudioShmBuffer() noexcept {
     // removed, so we'll do it on both sides to reduce the chance that we leak
     // shared memory
     if (!is_moved_) {
-        munmap(shm_bytes_, config_.size);
+        // Wake up any thread blocked on one of the futex words on either side
+        // so we don't end up with threads waiting on a doorbell that will
+        // never be rung again
+        if (doorbell_) {
+            terminate_doorbell();
+            munmap(doorbell_, doorbell_reserved_size);
+        }
+
+        // The gang doorbell object is shared by the whole group and the
+        // group host's gang listener keeps its own mapping, so it's only
+        // unmapped here. The group host removes the object when it shuts
+        // down, and `GangDispatcher` sweeps up objects left behind by
+        // crashed group hosts.
+        if (gang_ring_) {
+            munmap(gang_ring_, gang_reserved_size);
+            close(gang_fd_);
+            ShmRegistry::unregister_object(gang_mapped_name_);
+        }
+
+        munmap(shm_bytes_, shm_size_);
         close(shm_fd_);
         shm_unlink(config_.name.c_str());
+        ShmRegistry::unregister_object(config_.name);
+
+        // The shared sidechain object may still be mapped by other instances
+        // in the group. Those mappings stay valid after the unlink, and the
+        // instances that keep using them mapped the same inode so they also
+        // keep sharing it with each other.
+        if (shared_input_bytes_) {
+            munmap(shared_input_bytes_, shared_input_size_);
+            close(shared_input_fd_);
+            shm_unlink(shared_input_mapped_name_.c_str());
+            ShmRegistry::unregister_object(shared_input_mapped_name_);
+        }
     }
 }
 
@@ -49,7 +165,23 @@ AudioShmBuffer::AudioShmBuffer(AudioShmBuffer&& o) noexcept
     : config_(std::move(o.config_)),
       shm_fd_(std::move(o.shm_fd_)),
       shm_bytes_(std::move(o.shm_bytes_)),
-      shm_size_(std::move(o.shm_size_)) {
+      shm_size_(std::move(o.shm_size_)),
+      input_copy_plan_(std::move(o.input_copy_plan_)),
+      output_copy_plan_(std::move(o.output_copy_plan_)),
+      shared_input_fd_(std::move(o.shared_input_fd_)),
+      shared_input_bytes_(std::move(o.shared_input_bytes_)),
+      shared_input_size_(std::move(o.shared_input_size_)),
+      shared_input_mapped_name_(std::move(o.shared_input_mapped_name_)),
+      shared_input_generation_(std::move(o.shared_input_generation_)),
+      gang_fd_(std::move(o.gang_fd_)),
+      gang_ring_(std::move(o.gang_ring_)),
+      gang_mapped_name_(std::move(o.gang_mapped_name_)),
+      doorbell_(std::move(o.doorbell_)),
+      last_ring_generation_(std::move(o.last_ring_generation_)),
+      last_completion_generation_(std::move(o.last_completion_generation_)),
+      last_rpc_ring_generation_(std::move(o.last_rpc_ring_generation_)),
+      last_rpc_completion_generation_(
+          std::move(o.last_rpc_completion_generation_)) {
     o.is_moved_ = true;
 }
 
@@ -58,6 +190,22 @@ AudioShmBuffer& AudioShmBuffer::operator=(AudioShmBuffer&& o) noexcept {
     shm_fd_ = std::move(o.shm_fd_);
     shm_bytes_ = std::move(o.shm_bytes_);
     shm_size_ = std::move(o.shm_size_);
+    input_copy_plan_ = std::move(o.input_copy_plan_);
+    output_copy_plan_ = std::move(o.output_copy_plan_);
+    shared_input_fd_ = std::move(o.shared_input_fd_);
+    shared_input_bytes_ = std::move(o.shared_input_bytes_);
+    shared_input_size_ = std::move(o.shared_input_size_);
+    shared_input_mapped_name_ = std::move(o.shared_input_mapped_name_);
+    shared_input_generation_ = std::move(o.shared_input_generation_);
+    gang_fd_ = std::move(o.gang_fd_);
+    gang_ring_ = std::move(o.gang_ring_);
+    gang_mapped_name_ = std::move(o.gang_mapped_name_);
+    doorbell_ = std::move(o.doorbell_);
+    last_ring_generation_ = std::move(o.last_ring_generation_);
+    last_completion_generation_ = std::move(o.last_completion_generation_);
+    last_rpc_ring_generation_ = std::move(o.last_rpc_ring_generation_);
+    last_rpc_completion_generation_ =
+        std::move(o.last_rpc_completion_generation_);
     o.is_moved_ = true;
 
     return *this;
@@ -74,10 +222,33 @@ void AudioShmBuffer::resize(const Config& new_config) {
     setup_mapping();
 }
 
+void AudioShmBuffer::trim() noexcept {
+    // The doorbell page has to stay intact since the futex words are
+    // monotonically increasing generation counters that both sides keep local
+    // copies of. Zeroing those would permanently desync the doorbell.
+    const size_t start = config_.doorbell_enabled ? doorbell_reserved_size : 0;
+    if (shm_size_ <= start) {
+        return;
+    }
+
+    // This drops the backing pages while keeping the object at its full size,
+    // so all of the offsets in `config_` and the mapping itself stay valid.
+    // Touching the buffers again simply faults in fresh zeroed pages. tmpfs
+    // has supported hole punching for ages, but this is still best effort.
+    fallocate(shm_fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+              static_cast<off_t>(start),
+              static_cast<off_t>(shm_size_ - start));
+}
+
 void AudioShmBuffer::setup_mapping() {
+    // The backing file and the mapping are kept at their high watermark. When
+    // the new layout fits within what we've already mapped, there's nothing
+    // to do: the offsets in `config_` have already been updated, and
+    // shrinking the mapping now would just mean growing it again the next
+    // time the host switches back to its larger buffer size.
     // Apparently you get a `Resource temporarily unavailable` when calling
     // `ftruncate()` with a size of 0 on shared memory
-    if (config_.size > 0) {
+    if (config_.size > shm_size_ && config_.size > 0) {
         // I don't think this can fail
         assert(ftruncate(shm_fd_, config_.size) == 0);
 
@@ -115,7 +286,813 @@ void AudioShmBuffer::setup_mapping() {
                     "Could not map shared memory");
             }
         }
+
+        // `MAP_HUGETLB` cannot be used with file descriptors created through
+        // `shm_open()`, but tmpfs does support transparent huge pages when
+        // asked for them. This is best effort since it depends on
+        // `/sys/kernel/mm/transparent_hugepage/shmem_enabled`, so we'll just
+        // ignore any errors here.
+        if (config_.huge_pages) {
+            madvise(shm_bytes_, config_.size, MADV_HUGEPAGE);
+        }
+
+        // With `MAP_LOCKED` the prefault above places the pages on whichever
+        // side mapped the buffer first, which on a multi-socket machine may
+        // leave the other side with remote memory accesses on every block.
+        // With the `numa_node` option set we'll place them deliberately
+        // instead. `MPOL_MF_MOVE` also migrates pages the other side already
+        // faulted in.
+        if (config_.numa_node >= 0 &&
+            static_cast<size_t>(config_.numa_node) <
+                sizeof(unsigned long) * CHAR_BIT) {
+            bind_to_numa_node(shm_bytes_, config_.size, config_.numa_node);
+        }
+
+        shm_size_ = config_.size;
+    }
+
+    // The doorbell needs its own mapping of the first page because
+    // `mremap()` is free to move `shm_bytes_` around during a resize while
+    // another thread is blocked on one of the futex words. This mapping is
+    // created exactly once and will remain stable for the lifetime of this
+    // object. We don't need `MAP_LOCKED` here since the same physical page is
+    // already covered by the (locked, when possible) audio mapping above.
+    if (config_.doorbell_enabled && !doorbell_) {
+        assert(config_.size >= doorbell_reserved_size);
+        void* mapping = mmap(nullptr, doorbell_reserved_size,
+                             PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::system_error(
+                std::error_code(errno, std::system_category()),
+                "Could not map shared memory doorbell");
+        }
+
+        doorbell_ = static_cast<Doorbell*>(mapping);
+    }
+
+    setup_shared_input_mapping();
+    setup_gang_mapping();
+
+    // Even when the mapping itself was left alone the offset tables in
+    // `config_` may have changed, so the flat plans always get rebuilt here
+    rebuild_copy_plans();
+}
+
+void AudioShmBuffer::setup_shared_input_mapping() {
+    // A layout change can move an instance to a differently named shared
+    // object (the layout is encoded in the name), or drop the sharing
+    // entirely. The old mapping is only unmapped, not unlinked: other
+    // instances in the group may still be using the object, and the
+    // destructor takes care of the eventual unlink.
+    if (shared_input_bytes_ &&
+        (config_.shared_input_name != shared_input_mapped_name_ ||
+         config_.shared_input_size > shared_input_size_)) {
+        munmap(shared_input_bytes_, shared_input_size_);
+        close(shared_input_fd_);
+        ShmRegistry::unregister_object(shared_input_mapped_name_);
+        shared_input_bytes_ = nullptr;
+        shared_input_fd_ = -1;
+        shared_input_size_ = 0;
+        shared_input_mapped_name_.clear();
+    }
+
+    if (config_.shared_input_name.empty() || shared_input_bytes_) {
+        return;
+    }
+
+    // Unlike the instance's own buffer this object is created by whichever
+    // sharing instance gets here first, and the others just open the same
+    // object. Every opener calls `ftruncate()` with the same size, which is a
+    // no-op for everyone but the first.
+    shared_input_fd_ =
+        shm_open(config_.shared_input_name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (shared_input_fd_ == -1) {
+        throw std::system_error(
+            std::error_code(errno, std::system_category()),
+            "Could not create shared sidechain object " +
+                config_.shared_input_name);
+    }
+
+    assert(ftruncate(shared_input_fd_, config_.shared_input_size) == 0);
+
+    shared_input_bytes_ = static_cast<uint8_t*>(
+        mmap(nullptr, config_.shared_input_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED, shared_input_fd_, 0));
+    if (shared_input_bytes_ == MAP_FAILED) {
+        shared_input_bytes_ = nullptr;
+        close(shared_input_fd_);
+        shared_input_fd_ = -1;
+        throw std::system_error(std::error_code(errno, std::system_category()),
+                                "Could not map shared sidechain object");
+    }
+
+    if (config_.huge_pages) {
+        madvise(shared_input_bytes_, config_.shared_input_size, MADV_HUGEPAGE);
+    }
+
+    shared_input_size_ = config_.shared_input_size;
+    shared_input_mapped_name_ = config_.shared_input_name;
+    ShmRegistry::register_object(shared_input_mapped_name_);
+}
+
+void AudioShmBuffer::setup_gang_mapping() {
+    if (config_.gang_name.empty() || config_.gang_name == gang_mapped_name_) {
+        return;
+    }
+
+    // Like the shared sidechain object, this object is created by whichever
+    // group member gets here first, and everyone else just opens the same
+    // object. The Wine side always maps it before sending the buffer config
+    // to the native side, so both sides are guaranteed to agree on whether
+    // gang dispatch is active.
+    gang_fd_ = shm_open(config_.gang_name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (gang_fd_ == -1) {
+        throw std::system_error(
+            std::error_code(errno, std::system_category()),
+            "Could not create gang doorbell object " + config_.gang_name);
+    }
+
+    assert(ftruncate(gang_fd_, gang_reserved_size) == 0);
+
+    void* mapping = mmap(nullptr, gang_reserved_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, gang_fd_, 0);
+    if (mapping == MAP_FAILED) {
+        close(gang_fd_);
+        gang_fd_ = -1;
+        throw std::system_error(std::error_code(errno, std::system_category()),
+                                "Could not map gang doorbell object");
+    }
+
+    gang_ring_ = static_cast<std::atomic<uint32_t>*>(mapping);
+    gang_mapped_name_ = config_.gang_name;
+    ShmRegistry::register_object(gang_mapped_name_);
+}
+
+bool AudioShmBuffer::try_claim_shared_input_write() noexcept {
+    if (!shared_input_bytes_) {
+        return true;
+    }
+
+    auto& generation =
+        reinterpret_cast<SharedInputHeader*>(shared_input_bytes_)->generation;
+
+    // Instances that started processing at the same time stay in lockstep,
+    // and within a block the first one to get here wins the claim. An
+    // instance added to the session later starts with a lower counter and
+    // simply never claims the write, which is still correct as long as at
+    // least one instance does.
+    const uint64_t own_generation = ++shared_input_generation_;
+    uint64_t shared_generation = generation.load(std::memory_order_acquire);
+    while (shared_generation < own_generation) {
+        if (generation.compare_exchange_weak(shared_generation, own_generation,
+                                             std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AudioShmBuffer::rebuild_copy_plans() noexcept {
+    input_copy_plan_.clear();
+    for (size_t bus = 0; bus < config_.input_offsets.size(); bus++) {
+        const bool shared = is_shared_input_bus(static_cast<uint32_t>(bus));
+        for (size_t channel = 0; channel < config_.input_offsets[bus].size();
+             channel++) {
+            input_copy_plan_.push_back(
+                {.shm_pointer =
+                     shared ? shared_input_bytes_ +
+                                  config_.shared_input_offsets[bus][channel]
+                            : shm_bytes_ + config_.input_offsets[bus][channel],
+                 .bus = static_cast<uint32_t>(bus),
+                 .channel = static_cast<uint32_t>(channel),
+                 .shared_input = shared});
+        }
+    }
+
+    output_copy_plan_.clear();
+    for (size_t bus = 0; bus < config_.output_offsets.size(); bus++) {
+        for (size_t channel = 0; channel < config_.output_offsets[bus].size();
+             channel++) {
+            output_copy_plan_.push_back(
+                {.shm_pointer =
+                     shm_bytes_ + config_.output_offsets[bus][channel],
+                 .bus = static_cast<uint32_t>(bus),
+                 .channel = static_cast<uint32_t>(channel),
+                 .shared_input = false});
+        }
+    }
+}
+
+uint8_t* AudioShmBuffer::doorbell_payload() noexcept {
+    assert(doorbell_);
+    return reinterpret_cast<uint8_t*>(doorbell_) +
+           (doorbell_reserved_size - doorbell_payload_size);
+}
+
+void AudioShmBuffer::ring(uint32_t message) noexcept {
+    doorbell_->message.store(message, std::memory_order_relaxed);
+    doorbell_->ring.fetch_add(1, std::memory_order_release);
+
+    // With gang dispatch active nobody is waiting on this instance's own
+    // ring word. Instead we'll ring the gang doorbell shared by every
+    // instance in the group, and the group host's gang listener picks this
+    // ring up by scanning the registered instances' generation counters. One
+    // thread thus wakes up for a whole block boundary's worth of rings.
+    if (gang_ring_) {
+        gang_ring_->fetch_add(1, std::memory_order_release);
+        futex(*gang_ring_, FUTEX_WAKE, 1);
+        return;
+    }
+
+    // With `audio_busy_poll` the other side is guaranteed to be polling the
+    // generation counter, so the wakeup syscall can be skipped entirely
+    if (!config_.busy_poll) {
+        futex(doorbell_->ring, FUTEX_WAKE, 1);
+    }
+}
+
+uint32_t AudioShmBuffer::wait_for_ring() noexcept {
+    const uint32_t last_generation = last_ring_generation_;
+
+    // In the zero-syscall busy polling mode there's no futex to fall back
+    // to, we'll just keep polling until the other side bumps the counter.
+    // Shutdown is handled by `terminate_doorbell()` bumping it as well.
+    if (config_.busy_poll) {
+        while (doorbell_->ring.load(std::memory_order_acquire) ==
+               last_generation) {
+            cpu_pause();
+        }
+
+        last_ring_generation_ += 1;
+
+        return doorbell_->message.load(std::memory_order_acquire);
+    }
+
+    // With the `audio_spin_us` option set we'll burn a bit of CPU before
+    // going to sleep, since the futex wakeup costs a couple microseconds
+    if (config_.spin_wait_us > 0) {
+        spin_wait_for(
+            [&]() {
+                return doorbell_->ring.load(std::memory_order_acquire) !=
+                       last_generation;
+            },
+            std::chrono::microseconds(config_.spin_wait_us));
+    }
+
+    while (doorbell_->ring.load(std::memory_order_acquire) ==
+           last_generation) {
+        // This can spuriously return on signals or when the generation already
+        // changed, hence the loop
+        futex(doorbell_->ring, FUTEX_WAIT, last_generation);
+    }
+
+    last_ring_generation_ += 1;
+
+    return doorbell_->message.load(std::memory_order_acquire);
+}
+
+std::optional<uint32_t> AudioShmBuffer::poll_ring() noexcept {
+    if (doorbell_->ring.load(std::memory_order_acquire) ==
+        last_ring_generation_) {
+        return std::nullopt;
+    }
+
+    last_ring_generation_ += 1;
+
+    return doorbell_->message.load(std::memory_order_acquire);
+}
+
+void AudioShmBuffer::prefetch_request_area(uint32_t bank) noexcept {
+    constexpr size_t prefetch_line_size = 64;
+    // A couple cache lines of events covers the typical handful of MIDI
+    // events per block
+    constexpr size_t event_prefetch_size = 1024;
+    // Prefetching entire input buffers for a whole gang's worth of instances
+    // would thrash the caches, so only the head of every channel gets staged
+    constexpr size_t channel_prefetch_size = 4096;
+
+    // Read-only prefetches with low temporal locality, so the lines land in
+    // the cache levels shared with the worker that will run the cycle.
+    // Prefetches never fault, so reading past the end of a region is fine.
+    const auto prefetch_region = [](const uint8_t* data, size_t size) {
+        for (size_t offset = 0; offset < size; offset += prefetch_line_size) {
+            __builtin_prefetch(data + offset, 0, 1);
+        }
+    };
+
+    // The cycle's metadata and the mirror structs all live in the reserved
+    // doorbell page
+    prefetch_region(doorbell_payload(), doorbell_payload_size);
+
+    if (bank < config_.event_offsets.size()) {
+        prefetch_region(event_area_ptr(bank), event_prefetch_size);
+    }
+
+    const auto& input_offsets =
+        bank == 1 && !config_.input_offsets_secondary.empty()
+            ? config_.input_offsets_secondary
+            : config_.input_offsets;
+    for (const auto& bus : input_offsets) {
+        for (const uint32_t offset : bus) {
+            prefetch_region(shm_bytes_ + offset, channel_prefetch_size);
+        }
+    }
+}
+
+void AudioShmBuffer::ring_completion() noexcept {
+    doorbell_->completion.fetch_add(1, std::memory_order_release);
+    // See `ring()`
+    if (!config_.busy_poll) {
+        futex(doorbell_->completion, FUTEX_WAKE, 1);
+    }
+}
+
+std::optional<uint32_t> AudioShmBuffer::wait_for_completion(
+    std::chrono::milliseconds timeout) noexcept {
+    const uint32_t last_generation = last_completion_generation_;
+
+    // In the zero-syscall busy polling mode the timeout becomes the polling
+    // budget, so the caller still gets a chance to check whether the Wine
+    // process is alive before waiting again
+    if (config_.busy_poll) {
+        if (!spin_wait_for(
+                [&]() {
+                    return doorbell_->completion.load(
+                               std::memory_order_acquire) != last_generation;
+                },
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    timeout))) {
+            return std::nullopt;
+        }
+
+        last_completion_generation_ += 1;
+
+        return doorbell_->message.load(std::memory_order_acquire);
+    }
+
+    // Same spin-then-block approach as in `wait_for_ring()`
+    if (config_.spin_wait_us > 0) {
+        spin_wait_for(
+            [&]() {
+                return doorbell_->completion.load(
+                           std::memory_order_acquire) != last_generation;
+            },
+            std::chrono::microseconds(config_.spin_wait_us));
+    }
+
+    const struct timespec timeout_spec {
+        .tv_sec = static_cast<time_t>(timeout.count() / 1000),
+        .tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000),
+    };
+    while (doorbell_->completion.load(std::memory_order_acquire) ==
+           last_generation) {
+        if (futex(doorbell_->completion, FUTEX_WAIT, last_generation,
+                  &timeout_spec) == -1 &&
+            errno == ETIMEDOUT) {
+            // The caller can now check whether the Wine process is still
+            // running before waiting again
+            if (doorbell_->completion.load(std::memory_order_acquire) ==
+                last_generation) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    last_completion_generation_ += 1;
+
+    return doorbell_->message.load(std::memory_order_acquire);
+}
+
+void AudioShmBuffer::ring_rpc() noexcept {
+    doorbell_->rpc_message.store(doorbell_message_process,
+                                 std::memory_order_relaxed);
+    doorbell_->rpc_ring.fetch_add(1, std::memory_order_release);
+    // See `ring()`
+    if (!config_.busy_poll) {
+        futex(doorbell_->rpc_ring, FUTEX_WAKE, 1);
+    }
+}
+
+uint32_t AudioShmBuffer::wait_for_rpc_ring() noexcept {
+    const uint32_t last_generation = last_rpc_ring_generation_;
+
+    // Same pure polling approach as in `wait_for_ring()`
+    if (config_.busy_poll) {
+        while (doorbell_->rpc_ring.load(std::memory_order_acquire) ==
+               last_generation) {
+            cpu_pause();
+        }
+
+        last_rpc_ring_generation_ += 1;
+
+        return doorbell_->rpc_message.load(std::memory_order_acquire);
+    }
+
+    // Same spin-then-block approach as in `wait_for_ring()`
+    if (config_.spin_wait_us > 0) {
+        spin_wait_for(
+            [&]() {
+                return doorbell_->rpc_ring.load(std::memory_order_acquire) !=
+                       last_generation;
+            },
+            std::chrono::microseconds(config_.spin_wait_us));
+    }
+
+    while (doorbell_->rpc_ring.load(std::memory_order_acquire) ==
+           last_generation) {
+        futex(doorbell_->rpc_ring, FUTEX_WAIT, last_generation);
+    }
+
+    last_rpc_ring_generation_ += 1;
+
+    return doorbell_->rpc_message.load(std::memory_order_acquire);
+}
+
+void AudioShmBuffer::ring_rpc_completion() noexcept {
+    doorbell_->rpc_completion.fetch_add(1, std::memory_order_release);
+    // See `ring()`
+    if (!config_.busy_poll) {
+        futex(doorbell_->rpc_completion, FUTEX_WAKE, 1);
+    }
+}
+
+std::optional<uint32_t> AudioShmBuffer::wait_for_rpc_completion(
+    std::chrono::milliseconds timeout) noexcept {
+    const uint32_t last_generation = last_rpc_completion_generation_;
+
+    // Same polling-with-budget approach as in `wait_for_completion()`
+    if (config_.busy_poll) {
+        if (!spin_wait_for(
+                [&]() {
+                    return doorbell_->rpc_completion.load(
+                               std::memory_order_acquire) != last_generation;
+                },
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    timeout))) {
+            return std::nullopt;
+        }
+
+        last_rpc_completion_generation_ += 1;
+
+        return doorbell_->rpc_message.load(std::memory_order_acquire);
+    }
+
+    if (config_.spin_wait_us > 0) {
+        spin_wait_for(
+            [&]() {
+                return doorbell_->rpc_completion.load(
+                           std::memory_order_acquire) != last_generation;
+            },
+            std::chrono::microseconds(config_.spin_wait_us));
+    }
+
+    const struct timespec timeout_spec {
+        .tv_sec = static_cast<time_t>(timeout.count() / 1000),
+        .tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000),
+    };
+    while (doorbell_->rpc_completion.load(std::memory_order_acquire) ==
+           last_generation) {
+        if (futex(doorbell_->rpc_completion, FUTEX_WAIT, last_generation,
+                  &timeout_spec) == -1 &&
+            errno == ETIMEDOUT) {
+            if (doorbell_->rpc_completion.load(std::memory_order_acquire) ==
+                last_generation) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    last_rpc_completion_generation_ += 1;
+
+    return doorbell_->rpc_message.load(std::memory_order_acquire);
+}
+
+void AudioShmBuffer::terminate_doorbell() noexcept {
+    doorbell_->message.store(doorbell_message_terminate,
+                             std::memory_order_relaxed);
+    doorbell_->rpc_message.store(doorbell_message_terminate,
+                                 std::memory_order_relaxed);
+    doorbell_->ring.fetch_add(1, std::memory_order_release);
+    doorbell_->completion.fetch_add(1, std::memory_order_release);
+    doorbell_->rpc_ring.fetch_add(1, std::memory_order_release);
+    doorbell_->rpc_completion.fetch_add(1, std::memory_order_release);
+    futex(doorbell_->ring, FUTEX_WAKE, INT_MAX);
+    futex(doorbell_->completion, FUTEX_WAKE, INT_MAX);
+    futex(doorbell_->rpc_ring, FUTEX_WAKE, INT_MAX);
+    futex(doorbell_->rpc_completion, FUTEX_WAKE, INT_MAX);
+}
+
+HeartbeatBuffer::HeartbeatBuffer(const std::string& name, bool create) noexcept
+    : name_(name), owner_(create) {
+    const int fd =
+        create ? shm_open(name.c_str(), O_RDWR | O_CREAT, 0600)
+               : shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd == -1) {
+        return;
+    }
+
+    // A single page is the minimum for a shared mapping anyways. If any of
+    // this fails we'll just leave the heartbeat inactive, it's only used for
+    // diagnostics.
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+    if (ftruncate(fd, page_size) == 0) {
+        void* mapping = mmap(nullptr, page_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            word_ = reinterpret_cast<std::atomic<uint32_t>*>(mapping);
+        }
+    }
+
+    // The mapping keeps the object alive, so the descriptor isn't needed
+    // anymore
+    close(fd);
+
+    if (!word_ && create) {
+        shm_unlink(name.c_str());
+    }
+    if (word_) {
+        // Both the creating and the opening side register the object, so it
+        // only gets swept up once neither of them is running anymore
+        ShmRegistry::register_object(name_);
+    }
+}
+
+HeartbeatBuffer::~HeartbeatBuffer() noexcept {
+    if (word_) {
+        munmap(word_, sysconf(_SC_PAGE_SIZE));
+        ShmRegistry::unregister_object(name_);
+    }
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+std::string HeartbeatBuffer::name_for(
+    const std::string& endpoint_base_dir_name) {
+    // The audio buffers are named the same way, since the endpoint base
+    // directory's name is already unique per plugin instance
+    return endpoint_base_dir_name + "-heartbeat";
+}
+
+XrunRing::XrunRing(const std::string& name) noexcept : name_(name) {
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        return;
+    }
+
+    // Like the heartbeat this is diagnostics only, so if any of this fails
+    // we'll just leave the ring inactive. A single page comfortably fits the
+    // header plus a useful amount of records.
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+    if (ftruncate(fd, page_size) == 0) {
+        void* mapping = mmap(nullptr, page_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            header_ = reinterpret_cast<XrunRingHeader*>(mapping);
+            records_ = reinterpret_cast<XrunRecord*>(header_ + 1);
+
+            header_->magic = XrunRingHeader::magic_value;
+            header_->version = XrunRingHeader::current_version;
+            header_->capacity = static_cast<uint32_t>(
+                (page_size - sizeof(XrunRingHeader)) / sizeof(XrunRecord));
+            header_->padding = 0;
+            header_->sequence.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // The mapping keeps the object alive, so the descriptor isn't needed
+    // anymore
+    close(fd);
+
+    if (!header_) {
+        shm_unlink(name.c_str());
+    } else {
+        ShmRegistry::register_object(name_);
+    }
+}
+
+XrunRing::~XrunRing() noexcept {
+    if (header_) {
+        munmap(header_, sysconf(_SC_PAGE_SIZE));
+        ShmRegistry::unregister_object(name_);
+    }
+    shm_unlink(name_.c_str());
+}
+
+void XrunRing::push(const XrunRecord& record) noexcept {
+    if (!header_) {
+        return;
+    }
+
+    // Deadline misses are rare and the ring is only read by external
+    // diagnostics tools, so a record being overwritten while it's being read
+    // is acceptable and no further synchronization is needed. Claiming the
+    // slot with an atomic increment does keep concurrently glitching
+    // instances within one bridge from clobbering the same slot.
+    const uint64_t sequence =
+        header_->sequence.fetch_add(1, std::memory_order_relaxed);
+    records_[sequence % header_->capacity] = record;
+}
+
+std::string XrunRing::name_for(const std::string& endpoint_base_dir_name) {
+    return endpoint_base_dir_name + "-xruns";
+}
+
+InstanceStatsBlock::InstanceStatsBlock(const std::string& name) noexcept
+    : name_(name) {
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        return;
+    }
+
+    // Diagnostics only, so any failure just leaves the block inactive. A
+    // single page is the minimum for a shared mapping anyways.
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+    if (ftruncate(fd, page_size) == 0) {
+        void* mapping = mmap(nullptr, page_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            stats_ = reinterpret_cast<InstanceStats*>(mapping);
+            stats_->magic = InstanceStats::magic_value;
+            stats_->version = InstanceStats::current_version;
+        }
     }
 
-    shm_size_ = config_.size;
+    // The mapping keeps the object alive, so the descriptor isn't needed
+    // anymore
+    close(fd);
+
+    if (!stats_) {
+        shm_unlink(name.c_str());
+    } else {
+        ShmRegistry::register_object(name_);
+    }
+}
+
+InstanceStatsBlock::~InstanceStatsBlock() noexcept {
+    if (stats_) {
+        munmap(stats_, sysconf(_SC_PAGE_SIZE));
+        ShmRegistry::unregister_object(name_);
+    }
+    shm_unlink(name_.c_str());
+}
+
+void InstanceStatsBlock::record_process_call(uint64_t duration_us,
+                                             uint32_t sample_frames,
+                                             uint32_t sample_rate) noexcept {
+    if (!stats_) {
+        return;
+    }
+
+    stats_->last_sample_frames.store(sample_frames, std::memory_order_relaxed);
+    stats_->sample_rate.store(sample_rate, std::memory_order_relaxed);
+    stats_->process_calls.fetch_add(1, std::memory_order_relaxed);
+    stats_->process_time_us.fetch_add(duration_us, std::memory_order_relaxed);
+
+    uint64_t current_max =
+        stats_->max_process_time_us.load(std::memory_order_relaxed);
+    while (current_max < duration_us &&
+           !stats_->max_process_time_us.compare_exchange_weak(
+               current_max, duration_us, std::memory_order_relaxed)) {
+    }
+}
+
+std::string InstanceStatsBlock::name_for(
+    const std::string& endpoint_base_dir_name) {
+    return endpoint_base_dir_name + "-stats";
+}
+
+/**
+ * Guards this process' registered shared memory object names below.
+ */
+static std::mutex shm_registry_mutex{};
+
+/**
+ * The names of the objects this process currently has mapped, with a
+ * registration count per name since the shared sidechain and gang doorbell
+ * objects get registered by every instance that uses them.
+ */
+static std::unordered_map<std::string, size_t> shm_registry_entries{};
+
+/**
+ * This process' registry file, named after its PID.
+ */
+static fs::path shm_registry_file() {
+    return fs::path(ShmRegistry::registry_directory) /
+           std::to_string(getpid());
+}
+
+/**
+ * Rewrite this process' registry file to match `shm_registry_entries`,
+ * removing the file when there's nothing left to record. The contents are
+ * written to a temporary file first so a concurrent sweep never reads a
+ * half-written registry. The caller must hold `shm_registry_mutex`.
+ */
+static void write_shm_registry_file() {
+    const fs::path registry_file = shm_registry_file();
+    if (shm_registry_entries.empty()) {
+        fs::remove(registry_file);
+        return;
+    }
+
+    fs::create_directories(registry_file.parent_path());
+
+    const fs::path temp_file = registry_file.string() + ".tmp";
+    {
+        std::ofstream file(temp_file,
+                           std::ofstream::trunc | std::ofstream::binary);
+        for (const auto& [name, count] : shm_registry_entries) {
+            file << name << '\n';
+        }
+    }
+
+    fs::rename(temp_file, registry_file);
+}
+
+void ShmRegistry::register_object(const std::string& name) noexcept {
+    try {
+        std::lock_guard lock(shm_registry_mutex);
+        if (++shm_registry_entries[name] == 1) {
+            write_shm_registry_file();
+        }
+    } catch (...) {
+        // When the registry can't be maintained the object just leaks on a
+        // crash, like it always used to
+    }
+
+    // Every process sweeps up after previously crashed sessions exactly
+    // once, right after recording its own first object
+    static std::once_flag reclaim_flag{};
+    std::call_once(reclaim_flag, []() { reclaim_orphans(); });
+}
+
+void ShmRegistry::unregister_object(const std::string& name) noexcept {
+    try {
+        std::lock_guard lock(shm_registry_mutex);
+        const auto entry = shm_registry_entries.find(name);
+        if (entry == shm_registry_entries.end()) {
+            return;
+        }
+
+        if (--entry->second == 0) {
+            shm_registry_entries.erase(entry);
+        }
+        write_shm_registry_file();
+    } catch (...) {
+    }
+}
+
+void ShmRegistry::reclaim_orphans() noexcept {
+    try {
+        // Objects recorded by a process that's still running have to be left
+        // alone even when another recorded owner is gone, since segments
+        // like the shared sidechain object are mapped by multiple processes
+        std::unordered_set<std::string> live_names{};
+        std::vector<std::pair<fs::path, std::vector<std::string>>> orphans{};
+        std::error_code err;
+        for (const auto& candidate :
+             fs::directory_iterator(registry_directory, err)) {
+            // This also skips the temporary files used for atomic rewrites
+            const std::string file_name = candidate.path().filename().string();
+            if (file_name.empty() ||
+                file_name.find_first_not_of("0123456789") !=
+                    std::string::npos) {
+                continue;
+            }
+            const pid_t pid = static_cast<pid_t>(std::stol(file_name));
+
+            std::vector<std::string> names{};
+            std::ifstream file(candidate.path(), std::ifstream::binary);
+            for (std::string line; std::getline(file, line);) {
+                // Only names written by our own processes should ever end up
+                // in the registry, but since these are about to be unlinked
+                // it doesn't hurt to be careful with unexpected contents
+                if (line.starts_with("yabridge-") &&
+                    line.find('/') == std::string::npos) {
+                    names.push_back(std::move(line));
+                }
+            }
+
+            // NOTE: A recycled PID keeps an orphan's segments alive until
+            //       that unrelated process also exits. That's the safe
+            //       direction to err in, and the next sweep gets them.
+            if (pid_running(pid)) {
+                live_names.insert(names.begin(), names.end());
+            } else {
+                orphans.emplace_back(candidate.path(), std::move(names));
+            }
+        }
+
+        for (const auto& [registry_file, names] : orphans) {
+            for (const auto& name : names) {
+                if (!live_names.contains(name)) {
+                    shm_unlink(name.c_str());
+                }
+            }
+
+            fs::remove(registry_file, err);
+        }
+    } catch (...) {
+    }
 }
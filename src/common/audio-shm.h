@@ -16,11 +16,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include <llvm/small-vector.h>
 #include <sys/mman.h>
 
+#include "bitsery/traits/small-vector.h"
+
 /**
  * A shared memory object that allows audio buffers to be shared between the
  * native plugin and the Wine plugin host. This is intended as an optimization,
@@ -47,6 +53,54 @@
  */
 class AudioShmBuffer {
    public:
+    /**
+     * A `[bus][channel]` table of byte offsets into the shared memory object.
+     * The inline capacities cover the typical case of one or two busses with
+     * up to 7.1 surround audio, so these tables normally never touch the
+     * heap. Plugins with more channels than that still work, the spilled
+     * elements just end up in a single heap allocation per table.
+     */
+    using ChannelOffsets = llvm::SmallVector<uint32_t, 8>;
+    using BusOffsets = llvm::SmallVector<ChannelOffsets, 4>;
+
+    /**
+     * Per-channel pointers into the mapped shared memory object, laid out to
+     * mirror `BusOffsets`. These are precomputed once after (re)mapping the
+     * buffer so the audio threads can point the plugin API's buffer structs
+     * directly at the shared memory without recomputing anything.
+     */
+    using ChannelPointers = llvm::SmallVector<void*, 8>;
+    using BusPointers = llvm::SmallVector<ChannelPointers, 4>;
+
+    /**
+     * A single entry in the flat copy plans returned by `input_copy_plan()`
+     * and `output_copy_plan()`. The nested offset tables are convenient for
+     * negotiating and serializing the layout, but walking them during every
+     * process call costs two levels of indexing per channel. These plans
+     * flatten the negotiated layout into one linear array of (shared memory
+     * pointer, bus, channel) entries once per (re)mapping, so the per-block
+     * copy loops become a single tight walk whose overhead no longer depends
+     * on how the channels are spread out over busses.
+     */
+    struct CopyPlanEntry {
+        /**
+         * Where this channel's samples live in the mapped shared memory
+         * object. Like the channel pointer accessors below, this address
+         * might change after a call to `resize()`.
+         */
+        uint8_t* shm_pointer;
+        uint32_t bus;
+        uint32_t channel;
+        /**
+         * Whether this channel lives in the shared sidechain object instead
+         * of this instance's own buffer. When it does, the copy should be
+         * skipped unless `try_claim_shared_input_write()` returned true for
+         * this block.
+         */
+        bool shared_input;
+    };
+    using CopyPlan = llvm::SmallVector<CopyPlanEntry, 16>;
+
     /**
      * The parameters needed for creating, configuring and connecting to a
      * shared audio buffer object. This is done on the Wine plugin host. For
@@ -74,6 +128,61 @@ class AudioShmBuffer {
          */
         uint32_t size;
 
+        /**
+         * Whether the first `doorbell_reserved_size` bytes of the shared
+         * memory object are reserved for a futex based doorbell. With the
+         * doorbell enabled both sides can signal each other directly through
+         * the shared memory object instead of going through a socket round
+         * trip for every processed audio buffer. This is set up on the Wine
+         * side, and when enabled all audio channel offsets start after the
+         * reserved region.
+         */
+        bool doorbell_enabled = false;
+
+        /**
+         * Whether the mapping should be backed by (transparent) huge pages.
+         * Large multi-bus 64-bit configurations can span hundreds of regular
+         * 4 KiB pages, and backing those with 2 MiB pages avoids TLB misses
+         * during the per-block copies. This is set from the `audio_huge_pages`
+         * option on the Wine side so both sides apply the same advice.
+         */
+        bool huge_pages = false;
+
+        /**
+         * When nonzero, the doorbell and RPC wait functions first
+         * busy-wait for this many microseconds before falling back to a
+         * blocking futex wait. At small buffer sizes the scheduler wakeup on
+         * either side of the doorbell costs a couple microseconds each, so
+         * low latency setups can trade some CPU time for consistently
+         * shorter audio round trips. This is set from the `audio_spin_us`
+         * option on the Wine side so both sides use the same budget.
+         */
+        uint32_t spin_wait_us = 0;
+
+        /**
+         * When set, the doorbell and RPC wait functions poll the doorbell
+         * words indefinitely and the ring functions skip the futex wakeup,
+         * so the steady-state handoff makes no syscalls at all on either
+         * side. The waits that normally use a timeout to detect a dead peer
+         * use the timeout as their polling budget instead, so liveness
+         * checking keeps working. This is set from the `audio_busy_poll`
+         * option on the Wine side so both sides agree on the protocol, which
+         * matters because a side that skips the wakeup would leave a
+         * blocking peer stuck forever.
+         */
+        bool busy_poll = false;
+
+        /**
+         * The NUMA node the buffer's pages should be placed on, or `-1` when
+         * no explicit placement is requested. Shared memory follows a
+         * first-touch policy, so without this the pages land on whichever
+         * node happened to fault them in first. This is set from the
+         * `numa_node` option on the Wine side, and both sides apply the same
+         * binding since either of them may be the first to map a newly grown
+         * buffer.
+         */
+        int32_t numa_node = -1;
+
         /**
          * Offsets **in bytes** within the shared memory object for an input
          * audio channel, indexed by `[bus][channel]`. For VST2 plugins the bus
@@ -86,27 +195,154 @@ class AudioShmBuffer {
          * samples and then just not use the latter half if the host ends up
          * using 32-bit samples.
          */
-        std::vector<std::vector<uint32_t>> input_offsets;
+        BusOffsets input_offsets;
         /**
          * Offsets **in bytes** within the shared memory object for an output
          * audio channel, indexed by `[bus][channel]`. See `input_offsets` for
          * more details.
          */
-        std::vector<std::vector<uint32_t>> output_offsets;
+        BusOffsets output_offsets;
+
+        /**
+         * When the one-block pipelining mode is enabled the buffer contains a
+         * second bank of input and output channels, laid out exactly like
+         * `input_offsets` and `output_offsets`. That way the native plugin
+         * side can write the next block's inputs to one bank while the Wine
+         * side is still processing the other bank. These will be empty when
+         * pipelining is not in use.
+         */
+        BusOffsets input_offsets_secondary;
+        BusOffsets output_offsets_secondary;
+
+        /**
+         * Offsets **in bytes** of the per-bank event areas, when the Wine
+         * side reserved them. These are fixed-capacity regions for passing
+         * plugin API event structs (e.g. `VstEvent`s for `effProcessEvents()`)
+         * in a flat layout alongside the audio, so the common case of a
+         * handful of events per block doesn't need to be serialized over a
+         * socket. This will be empty when no event area is in use, and it
+         * contains one offset per buffer bank otherwise.
+         */
+        llvm::SmallVector<uint32_t, 2> event_offsets;
+
+        /**
+         * When non-empty, the name of the tiny shared memory object holding
+         * the group host process's gang dispatch doorbell. This is used to
+         * implement the `audio_gang_dispatch` option: DAWs process their
+         * tracks in parallel, so all bridged instances in a group tend to
+         * receive their processing calls at the same block boundary, and
+         * each of those rings would wake up a separate thread in the group
+         * host process. With this set, `ring()` still bumps this instance's
+         * own generation counter but rings the shared gang word instead of
+         * the instance's own futex. The group host's single gang listener
+         * then scans the registered instances and fans the pending calls out
+         * to the audio worker pool, waking up one thread instead of one per
+         * instance. This is set on the Wine side, see `GangDispatcher`.
+         */
+        std::string gang_name = "";
+
+        /**
+         * When non-empty, the name of a second shared memory object holding
+         * sidechain input channels that are shared between multiple plugin
+         * instances in the same plugin group. This is used to implement the
+         * `shared_sidechain` option: when a host routes the same bus as
+         * sidechain input to several bridged instances, every native side
+         * would otherwise copy identical samples into its own buffer every
+         * block. With this set, `shared_input_offsets` point into the shared
+         * object instead and only one instance per block performs the copy,
+         * see `try_claim_shared_input_write()`. The first
+         * `shared_input_reserved_size` bytes of the object hold the claim
+         * header.
+         */
+        std::string shared_input_name = "";
+
+        /**
+         * The size of the shared sidechain object **in bytes**, including the
+         * reserved header.
+         */
+        uint32_t shared_input_size = 0;
+
+        /**
+         * Offsets **in bytes** within the shared sidechain object, indexed by
+         * `[bus][channel]` just like `input_offsets`. Busses that are not
+         * shared (at least the main input bus) have an empty entry here and
+         * keep using their `input_offsets` as usual.
+         */
+        BusOffsets shared_input_offsets;
 
         template <typename S>
         void serialize(S& s) {
             s.text1b(name, 1024);
             s.value4b(size);
+            s.value1b(doorbell_enabled);
+            s.value1b(huge_pages);
+            s.value4b(spin_wait_us);
+            s.value1b(busy_poll);
+            s.value4b(numa_node);
             s.container(input_offsets, 8192, [](S& s, auto& offsets) {
                 s.container4b(offsets, 8192);
             });
             s.container(output_offsets, 8192, [](S& s, auto& offsets) {
                 s.container4b(offsets, 8192);
             });
+            s.container(input_offsets_secondary, 8192,
+                        [](S& s, auto& offsets) {
+                            s.container4b(offsets, 8192);
+                        });
+            s.container(output_offsets_secondary, 8192,
+                        [](S& s, auto& offsets) {
+                            s.container4b(offsets, 8192);
+                        });
+            s.container4b(event_offsets, 8192);
+            s.text1b(gang_name, 1024);
+            s.text1b(shared_input_name, 1024);
+            s.value4b(shared_input_size);
+            s.container(shared_input_offsets, 8192, [](S& s, auto& offsets) {
+                s.container4b(offsets, 8192);
+            });
         }
     };
 
+    /**
+     * The number of bytes at the start of the shared memory object that are
+     * reserved for the `Doorbell` control block and its payload area when
+     * `Config::doorbell_enabled` is set. This is a full page so the audio
+     * buffers that come after it stay page aligned.
+     */
+    static constexpr uint32_t doorbell_reserved_size = 4096;
+
+    /**
+     * The number of bytes at the start of the shared sidechain object that
+     * are reserved for the write claim header, so the audio channels after it
+     * stay cache line aligned.
+     */
+    static constexpr uint32_t shared_input_reserved_size = 64;
+
+    /**
+     * The size of the gang dispatch doorbell object named by
+     * `Config::gang_name`. Only the leading generation counter is used, but
+     * a single page is the minimum for a shared mapping anyways.
+     */
+    static constexpr uint32_t gang_reserved_size = 4096;
+
+    /**
+     * The message sent along with a doorbell ring for a steady-state audio
+     * processing call. The metadata for the call will have been written to the
+     * doorbell's payload area.
+     */
+    static constexpr uint32_t doorbell_message_process = 1;
+    /**
+     * The message sent along with a doorbell ring when either side is shutting
+     * down. This wakes up both sides so neither can end up blocking on a futex
+     * wait forever during shutdown.
+     */
+    static constexpr uint32_t doorbell_message_terminate = 2;
+    /**
+     * The same as `doorbell_message_process`, but for a block written to the
+     * secondary buffer bank when the one-block pipelining mode is active.
+     */
+    static constexpr uint32_t doorbell_message_process_secondary = 3;
+
     /**
      * Connect to or create the shared memory object and map it to this
      * process's memory. The configuration is created on the Wine side using the
@@ -132,7 +368,11 @@ class AudioShmBuffer {
 
     /**
      * Adapt to a new buffer size or channel layout. The name of the buffer
-     * needs to remain the same.
+     * needs to remain the same. The backing file and the mapping are kept at
+     * their high watermark: when the new layout fits within the already
+     * mapped region this only updates the offsets without making any
+     * syscalls, so hosts toggling between a small live buffer size and a
+     * large render buffer size don't cause remaps on either side.
      *
      * @throw `std::invalid_argument` If the config is for a buffer with a
      *   different name.
@@ -140,6 +380,20 @@ class AudioShmBuffer {
      */
     void resize(const Config& new_config);
 
+    /**
+     * Release the backing pages of the audio buffers while keeping the
+     * mapping and the layout intact. This is used when hibernating a silent
+     * plugin instance, since idle buffers can still pin megabytes of locked
+     * resident memory per instance. The pages fault back in as fresh zeroed
+     * pages on the next write, so this may only be called when neither side
+     * is processing audio. The reserved doorbell page is left alone because
+     * its futex words are monotonically increasing generation counters that
+     * both sides keep local copies of. This is a best effort operation: if
+     * the kernel can't punch holes in the shared memory object the buffers
+     * just stay resident.
+     */
+    void trim() noexcept;
+
     inline size_t num_input_channels(const uint32_t bus) const {
         return config_.input_offsets[bus].size();
     }
@@ -148,14 +402,73 @@ class AudioShmBuffer {
         return config_.output_offsets[bus].size();
     }
 
+    /**
+     * Whether this buffer contains a second bank of audio channels for the
+     * one-block pipelining mode.
+     */
+    inline bool double_buffered() const noexcept {
+        return !config_.input_offsets_secondary.empty() ||
+               !config_.output_offsets_secondary.empty();
+    }
+
+    /**
+     * The precomputed flat copy plans covering every input and output channel
+     * in the primary buffer bank, in bus-major order. See `CopyPlanEntry` for
+     * the rationale. These are rebuilt whenever the layout or the mapping
+     * changes, so references to the plans should not be held across a call to
+     * `resize()`.
+     */
+    inline const CopyPlan& input_copy_plan() const noexcept {
+        return input_copy_plan_;
+    }
+
+    inline const CopyPlan& output_copy_plan() const noexcept {
+        return output_copy_plan_;
+    }
+
+    /**
+     * Whether this buffer routes some of its input busses through a shared
+     * sidechain object, see `Config::shared_input_name`.
+     */
+    inline bool has_shared_input() const noexcept {
+        return shared_input_bytes_ != nullptr;
+    }
+
+    /**
+     * Whether this input bus is backed by the shared sidechain object.
+     */
+    inline bool is_shared_input_bus(const uint32_t bus) const noexcept {
+        return shared_input_bytes_ &&
+               bus < config_.shared_input_offsets.size() &&
+               !config_.shared_input_offsets[bus].empty();
+    }
+
+    /**
+     * Claim this block's write to the shared sidechain object. All instances
+     * sharing the object receive identical samples from the host, so only the
+     * first instance to process a given block needs to copy them. This is
+     * tracked with a generation counter in the object's header: every caller
+     * bumps its own per-instance counter, and whoever moves the shared
+     * counter forward first performs the copy. Returns true when the caller
+     * should copy (also when there's no shared object at all), false when
+     * another instance has already claimed this block.
+     */
+    bool try_claim_shared_input_write() noexcept;
+
     /**
      * Get a pointer to the part of the buffer where this input audio channel is
      * stored in. Both the bus and the channel indices start at zero. These
-     * addresses might change after a call to `resize()`.
+     * addresses might change after a call to `resize()`. Busses backed by the
+     * shared sidechain object transparently resolve into that object.
      */
     template <typename T>
     // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
     T* input_channel_ptr(const uint32_t bus, const uint32_t channel) noexcept {
+        if (is_shared_input_bus(bus)) {
+            return reinterpret_cast<T*>(
+                shared_input_bytes_ +
+                config_.shared_input_offsets[bus][channel]);
+        }
         return reinterpret_cast<T*>(shm_bytes_ +
                                     config_.input_offsets[bus][channel]);
     }
@@ -164,6 +477,11 @@ class AudioShmBuffer {
     // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
     const T* input_channel_ptr(const uint32_t bus,
                                const uint32_t channel) const noexcept {
+        if (is_shared_input_bus(bus)) {
+            return reinterpret_cast<const T*>(
+                shared_input_bytes_ +
+                config_.shared_input_offsets[bus][channel]);
+        }
         return reinterpret_cast<const T*>(shm_bytes_ +
                                           config_.input_offsets[bus][channel]);
     }
@@ -188,9 +506,212 @@ class AudioShmBuffer {
                                           config_.output_offsets[bus][channel]);
     }
 
+    /**
+     * The same as `input_channel_ptr()`, but for a specific bank when using
+     * the double-buffered pipelining layout. Bank 0 refers to the regular
+     * offsets, bank 1 to the secondary bank.
+     */
+    template <typename T>
+    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+    T* input_channel_ptr(const uint32_t bank,
+                         const uint32_t bus,
+                         const uint32_t channel) noexcept {
+        return reinterpret_cast<T*>(
+            shm_bytes_ + (bank == 0
+                              ? config_.input_offsets[bus][channel]
+                              : config_.input_offsets_secondary[bus][channel]));
+    }
+
+    /**
+     * The same as `output_channel_ptr()`, but for a specific bank when using
+     * the double-buffered pipelining layout. Bank 0 refers to the regular
+     * offsets, bank 1 to the secondary bank.
+     */
+    template <typename T>
+    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+    T* output_channel_ptr(const uint32_t bank,
+                          const uint32_t bus,
+                          const uint32_t channel) noexcept {
+        return reinterpret_cast<T*>(
+            shm_bytes_ +
+            (bank == 0 ? config_.output_offsets[bus][channel]
+                       : config_.output_offsets_secondary[bus][channel]));
+    }
+
+    /**
+     * Whether the Wine side reserved event areas in this buffer's layout.
+     */
+    inline bool has_event_area() const noexcept {
+        return !config_.event_offsets.empty();
+    }
+
+    /**
+     * Get a pointer to the event area for the given buffer bank. May only be
+     * called when `has_event_area()` returns true. Like the audio channel
+     * pointers, these addresses might change after a call to `resize()`.
+     */
+    inline uint8_t* event_area_ptr(const uint32_t bank) noexcept {
+        return shm_bytes_ + config_.event_offsets[bank];
+    }
+
+    inline const uint8_t* event_area_ptr(const uint32_t bank) const noexcept {
+        return shm_bytes_ + config_.event_offsets[bank];
+    }
+
+    /**
+     * Whether this buffer has an active doorbell mapping. This requires
+     * `Config::doorbell_enabled` to have been set when the buffer was created.
+     */
+    inline bool has_doorbell() const noexcept { return doorbell_ != nullptr; }
+
+    /**
+     * A pointer to the doorbell's payload area. This is the remainder of the
+     * reserved doorbell page after the control block, and it can be used to
+     * pass small fixed size structs along with a ring without involving the
+     * sockets. May only be called when `has_doorbell()` returns true.
+     */
+    uint8_t* doorbell_payload() noexcept;
+
+    /**
+     * Ring the RPC futex pair's request word. The doorbell control block
+     * contains a second, independent request/response futex pair for small
+     * remote procedure calls that would otherwise go through a socket round
+     * trip, with the call's arguments written to a slot in the payload area
+     * beforehand. This is used for VST2 `getParameter()` and `setParameter()`
+     * calls, which are fixed size and often fired in rapid succession during
+     * parameter automation. The RPC lane is completely separate from the audio
+     * processing doorbell, so both can be in flight at the same time. May only
+     * be called when `has_doorbell()` returns true.
+     */
+    void ring_rpc() noexcept;
+
+    /**
+     * Block until the other side rings the RPC request word, returning the
+     * message passed along with it. Used by the serving side's dedicated RPC
+     * thread. May only be called when `has_doorbell()` returns true.
+     */
+    uint32_t wait_for_rpc_ring() noexcept;
+
+    /**
+     * Signal that the last RPC has finished and that its results have been
+     * written back to the payload area. May only be called when
+     * `has_doorbell()` returns true.
+     */
+    void ring_rpc_completion() noexcept;
+
+    /**
+     * Block until the other side signals RPC completion, with the same timeout
+     * and terminate semantics as `wait_for_completion()`. May only be called
+     * when `has_doorbell()` returns true.
+     */
+    std::optional<uint32_t> wait_for_rpc_completion(
+        std::chrono::milliseconds timeout) noexcept;
+
+    /**
+     * The size of the payload area returned by `doorbell_payload()` in bytes.
+     */
+    static constexpr size_t doorbell_payload_size =
+        doorbell_reserved_size - 64;
+
+    /**
+     * Ring the doorbell on the other side with the given message. Used on the
+     * native plugin side to start an audio processing cycle after the input
+     * buffers and the call's metadata have been written to the shared memory
+     * object. May only be called when `has_doorbell()` returns true.
+     */
+    void ring(uint32_t message) noexcept;
+
+    /**
+     * Block until the other side rings the doorbell, returning the message
+     * passed to `ring()`. Used on the Wine side's audio thread. May only be
+     * called when `has_doorbell()` returns true.
+     */
+    uint32_t wait_for_ring() noexcept;
+
+    /**
+     * Whether this buffer participates in gang dispatch, i.e.
+     * `Config::gang_name` was set and the gang doorbell object has been
+     * mapped.
+     */
+    inline bool has_gang() const noexcept { return gang_ring_ != nullptr; }
+
+    /**
+     * Check whether the other side has rung the processing doorbell without
+     * blocking, returning the message passed to `ring()` when it has. With
+     * gang dispatch nobody blocks on the per-instance ring word, so the
+     * group host's gang listener uses this to scan the registered instances
+     * after a gang wakeup. Like `wait_for_ring()` this may only ever be
+     * called from a single thread.
+     */
+    std::optional<uint32_t> poll_ring() noexcept;
+
+    /**
+     * Prefetch the data a pending processing cycle touches first into the
+     * cache hierarchy: the doorbell payload page holding the cycle's
+     * metadata, the bank's event area, and the head of the bank's input
+     * channels. The gang listener calls this for cycles that are queued
+     * behind other instances' cycles, so this part of the per-request setup
+     * overlaps with the processing that's already running instead of
+     * stalling on cold shared memory once a worker picks the cycle up. May
+     * only be called when `has_doorbell()` returns true.
+     */
+    void prefetch_request_area(uint32_t bank) noexcept;
+
+    /**
+     * Signal that the last audio processing cycle has finished. Used on the
+     * Wine side as the equivalent of the old `Ack` message. May only be called
+     * when `has_doorbell()` returns true.
+     */
+    void ring_completion() noexcept;
+
+    /**
+     * Block until the other side signals completion through
+     * `ring_completion()`, returning the current doorbell message. A nullopt
+     * is returned when the timeout expired instead. The caller should check
+     * for `doorbell_message_terminate` and whether the other side is still
+     * alive before retrying, since with futexes there's no equivalent of a
+     * socket getting closed when the Wine process dies. May only be called
+     * when `has_doorbell()` returns true.
+     */
+    std::optional<uint32_t> wait_for_completion(
+        std::chrono::milliseconds timeout) noexcept;
+
+    /**
+     * Ring all futex words with `doorbell_message_terminate` so any thread
+     * blocked on either side wakes up, including the RPC pair. Called from the
+     * destructor, but it can also be called explicitly before tearing down a
+     * bridge.
+     */
+    void terminate_doorbell() noexcept;
+
     Config config_;
 
    private:
+    /**
+     * The control block stored at the start of the shared memory object when
+     * the doorbell is enabled. Both futex words are monotonically increasing
+     * generation counters, and `message` always belongs to the most recent
+     * ring on either word.
+     */
+    struct Doorbell {
+        std::atomic<uint32_t> ring;
+        std::atomic<uint32_t> completion;
+        std::atomic<uint32_t> message;
+
+        /**
+         * The request/response pair for the RPC lane described in
+         * `ring_rpc()`. These work exactly like the audio processing doorbell
+         * words above, but they're rung from a different thread on both sides
+         * so the two lanes can be active at the same time.
+         */
+        std::atomic<uint32_t> rpc_ring;
+        std::atomic<uint32_t> rpc_completion;
+        std::atomic<uint32_t> rpc_message;
+    };
+
+    static_assert(sizeof(Doorbell) <= 64,
+                  "The doorbell control block may not overlap with the "
+                  "payload area");
     /**
      * Resize the shared memory object, and set up the memory mapping.
      *
@@ -198,6 +719,32 @@ class AudioShmBuffer {
      */
     void setup_mapping();
 
+    /**
+     * Create or open and map the shared sidechain object when
+     * `Config::shared_input_name` is set, and tear down a previous mapping
+     * when the name changed. Called from `setup_mapping()`.
+     *
+     * @throw std::system_error If the object could not be created or mapped.
+     */
+    void setup_shared_input_mapping();
+
+    /**
+     * Create or open and map the gang dispatch doorbell object when
+     * `Config::gang_name` is set. Called from `setup_mapping()`. The name
+     * never changes for the lifetime of the group host process, so a resize
+     * never remaps it.
+     *
+     * @throw std::system_error If the object could not be created or mapped.
+     */
+    void setup_gang_mapping();
+
+    /**
+     * Recompute the flat copy plans from `config_`'s offset tables and the
+     * current mapping. Called at the end of `setup_mapping()`, since both a
+     * layout change and an `mremap()` move invalidate the stored pointers.
+     */
+    void rebuild_copy_plans() noexcept;
+
     /**
      * The file descriptor for our shared memory object.
      */
@@ -207,9 +754,484 @@ class AudioShmBuffer {
      */
     uint8_t* shm_bytes_ = nullptr;
     /**
-     * The size of the mapped shared memory area, used for remapping.
+     * The size of the mapped shared memory area. This can be larger than
+     * `config_.size` since the mapping is never shrunk, see `resize()`.
      */
     size_t shm_size_ = 0;
 
+    /**
+     * The flat copy plans described by `CopyPlanEntry`, covering the primary
+     * bank's input and output channels respectively.
+     */
+    CopyPlan input_copy_plan_;
+    CopyPlan output_copy_plan_;
+
+    /**
+     * The header stored at the start of the shared sidechain object. The
+     * generation counter implements the per-block write claim described in
+     * `try_claim_shared_input_write()`.
+     */
+    struct SharedInputHeader {
+        std::atomic<uint64_t> generation;
+    };
+
+    static_assert(sizeof(SharedInputHeader) <= shared_input_reserved_size,
+                  "The shared sidechain header may not overlap with the "
+                  "audio channels");
+
+    /**
+     * The file descriptor and mapping for the shared sidechain object, when
+     * `Config::shared_input_name` is set. Unlike `shm_bytes_` this object is
+     * shared between multiple plugin instances, so its name keeps track of
+     * what's currently mapped across `resize()` calls.
+     */
+    int shared_input_fd_ = -1;
+    uint8_t* shared_input_bytes_ = nullptr;
+    size_t shared_input_size_ = 0;
+    std::string shared_input_mapped_name_;
+
+    /**
+     * The file descriptor and mapped generation counter of the gang dispatch
+     * doorbell object, when `Config::gang_name` is set. Like the shared
+     * sidechain object this is shared between all of the group's instances,
+     * and the group host's gang listener has its own mapping of the same
+     * object. The destructor only unmaps it: the group host removes the
+     * object when it shuts down, and objects left behind by crashed group
+     * hosts get swept up by `GangDispatcher` the next time a group starts.
+     */
+    int gang_fd_ = -1;
+    std::atomic<uint32_t>* gang_ring_ = nullptr;
+    std::string gang_mapped_name_;
+
+    /**
+     * This instance's own block counter for the shared sidechain write claim.
+     * Only ever touched from the audio thread that repopulates the buffers.
+     */
+    uint64_t shared_input_generation_ = 0;
+
+    /**
+     * A separate, stable mapping of the first page of the shared memory
+     * object when the doorbell is enabled. `shm_bytes_` can move around when
+     * the buffers get resized through `mremap()`, so threads blocking on the
+     * futex words need a mapping that never moves for the lifetime of this
+     * object.
+     */
+    Doorbell* doorbell_ = nullptr;
+
+    /**
+     * The ring and completion generations we last observed in
+     * `wait_for_ring()` and `wait_for_completion()`. These don't need to be
+     * atomic since each of the two wait functions is only ever called from a
+     * single thread on a single side.
+     */
+    uint32_t last_ring_generation_ = 0;
+    uint32_t last_completion_generation_ = 0;
+
+    /**
+     * The same for the RPC futex pair. The RPC waits happen on dedicated
+     * threads separate from the audio threads, but again only ever on a
+     * single thread per side.
+     */
+    uint32_t last_rpc_ring_generation_ = 0;
+    uint32_t last_rpc_completion_generation_ = 0;
+
     bool is_moved_ = false;
 };
+
+/**
+ * A tiny shared memory object holding a single heartbeat word for a bridged
+ * plugin instance. The Wine plugin host's event loop bumps the generation
+ * counter once per tick, so the native plugin can tell whether the host's GUI
+ * thread is still making progress with a single atomic load instead of
+ * having to send a message over a socket and wait for a blocking timeout.
+ * This is used to warn the user when the Wine host appears to have locked up
+ * while a dispatcher call would otherwise just silently block forever.
+ *
+ * The native plugin creates the object before spawning the host process, and
+ * the Wine side opens the existing object. Both construction and opening are
+ * best effort: when the object can't be set up, for instance because the two
+ * sides run different yabridge versions, the heartbeat simply stays inactive.
+ */
+class HeartbeatBuffer {
+   public:
+    /**
+     * Create or open the shared memory object backing the heartbeat word.
+     *
+     * @param name The name of the shared memory object, from `name_for()`.
+     * @param create Whether to create the object. The creating side also
+     *   unlinks it again on destruction. This should be set to `true` on the
+     *   native plugin side, and `false` on the Wine host side.
+     */
+    HeartbeatBuffer(const std::string& name, bool create) noexcept;
+
+    /**
+     * Unmap the heartbeat word, and remove the shared memory object if this
+     * side created it.
+     */
+    ~HeartbeatBuffer() noexcept;
+
+    HeartbeatBuffer(const HeartbeatBuffer&) = delete;
+    HeartbeatBuffer& operator=(const HeartbeatBuffer&) = delete;
+    HeartbeatBuffer(HeartbeatBuffer&&) = delete;
+    HeartbeatBuffer& operator=(HeartbeatBuffer&&) = delete;
+
+    /**
+     * The name of the heartbeat object for a bridged plugin instance. Both
+     * sides derive this from the instance's unique socket endpoint base
+     * directory, so no extra handshaking is needed.
+     */
+    static std::string name_for(const std::string& endpoint_base_dir_name);
+
+    /**
+     * Whether the shared memory object was set up successfully.
+     */
+    inline bool active() const noexcept { return word_ != nullptr; }
+
+    /**
+     * Increment the heartbeat generation. Called from the Wine host's event
+     * loop, a no-op when the heartbeat is inactive.
+     */
+    inline void bump() noexcept {
+        if (word_) {
+            word_->fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * The current heartbeat generation. This stays at zero until the Wine
+     * host's event loop has started ticking, and returns zero when the
+     * heartbeat is inactive.
+     */
+    inline uint32_t generation() const noexcept {
+        return word_ ? word_->load(std::memory_order_relaxed) : 0;
+    }
+
+    /**
+     * The heartbeat word used by `bump()`, needed to register the heartbeat
+     * with the Wine host's event loop. May only be called when `active()`
+     * returns true.
+     */
+    inline std::atomic<uint32_t>& word() noexcept { return *word_; }
+
+   private:
+    std::string name_;
+    bool owner_;
+    std::atomic<uint32_t>* word_ = nullptr;
+};
+
+/**
+ * A single audio processing deadline miss recorded by the native plugin. The
+ * layout is fixed and read straight out of the shared memory object by
+ * `yabridgectl xruns`, so the fields must stay in sync with the parser in
+ * `tools/yabridgectl/src/xruns.rs`.
+ */
+struct XrunRecord {
+    /**
+     * When the miss happened, in microseconds since the Unix epoch. This uses
+     * the wall clock so it can be correlated with the host's own xrun logs.
+     */
+    uint64_t timestamp_us;
+    /**
+     * The object instance ID of the plugin instance within the bridge for
+     * VST3 and CLAP plugins, or zero for VST2 plugins since those bridge a
+     * single instance per endpoint.
+     */
+    uint64_t instance_id;
+    /**
+     * The size of the processed block in samples.
+     */
+    uint32_t sample_frames;
+    /**
+     * The deadline for the block, `sample_frames` divided by the sample rate.
+     */
+    uint32_t deadline_us;
+    /**
+     * How long the entire bridged processing call took.
+     */
+    uint32_t duration_us;
+    /**
+     * Time spent writing the host's input buffers to the shared audio
+     * buffers.
+     */
+    uint32_t copy_in_us;
+    /**
+     * Time spent waiting on the Wine plugin host. This covers both the
+     * bridging round trip and the plugin's own processing, which we cannot
+     * tell apart from the native side.
+     */
+    uint32_t round_trip_us;
+    /**
+     * Time spent copying the processed outputs back to the host's buffers.
+     */
+    uint32_t copy_out_us;
+};
+
+static_assert(sizeof(XrunRecord) == 40);
+
+/**
+ * The header at the start of an `XrunRing`'s shared memory object, directly
+ * followed by `capacity` instances of `XrunRecord`.
+ */
+struct XrunRingHeader {
+    /**
+     * The expected value of the `magic` field, the bytes `xrun` read as a
+     * little endian word.
+     */
+    static constexpr uint32_t magic_value = 0x6e757278;
+    /**
+     * The current value of the `version` field. This should be bumped
+     * whenever the layout of this header or of `XrunRecord` changes, so old
+     * `yabridgectl` versions don't misparse the ring.
+     */
+    static constexpr uint32_t current_version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    /**
+     * The number of record slots following this header.
+     */
+    uint32_t capacity;
+    uint32_t padding;
+    /**
+     * The total number of deadline misses recorded since the instance
+     * started. Record `n` lives in slot `n % capacity`, so the last
+     * `min(sequence, capacity)` records are valid.
+     */
+    std::atomic<uint64_t> sequence;
+};
+
+static_assert(sizeof(XrunRingHeader) == 24);
+
+/**
+ * A small shared memory ring of `XrunRecord`s for a bridged plugin instance.
+ * When a processing call on the native side overruns the deadline implied by
+ * the block size and sample rate, a record with a phase breakdown gets pushed
+ * here. `yabridgectl xruns` then reads these objects straight from
+ * `/dev/shm`, turning 'something glitched' into 'this instance's plugin
+ * spent 9 milliseconds in process'.
+ *
+ * Only the native plugin writes to the ring and external tools parse the
+ * backing file directly, so unlike the heartbeat there is no opening side.
+ * Setup is best effort: when the object can't be created, records are simply
+ * dropped.
+ */
+class XrunRing {
+   public:
+    /**
+     * Create the shared memory object backing the ring. When this fails the
+     * ring stays inactive and `push()` becomes a no-op.
+     *
+     * @param name The name of the shared memory object, from `name_for()`.
+     */
+    explicit XrunRing(const std::string& name) noexcept;
+
+    /**
+     * Unmap the ring and remove the shared memory object.
+     */
+    ~XrunRing() noexcept;
+
+    XrunRing(const XrunRing&) = delete;
+    XrunRing& operator=(const XrunRing&) = delete;
+    XrunRing(XrunRing&&) = delete;
+    XrunRing& operator=(XrunRing&&) = delete;
+
+    /**
+     * The name of the xrun ring for a bridged plugin instance, derived from
+     * the instance's unique socket endpoint base directory just like the
+     * audio buffers and the heartbeat.
+     */
+    static std::string name_for(const std::string& endpoint_base_dir_name);
+
+    /**
+     * Whether the shared memory object was set up successfully.
+     */
+    inline bool active() const noexcept { return header_ != nullptr; }
+
+    /**
+     * Record a deadline miss, overwriting the oldest record once the ring is
+     * full. A no-op when the ring is inactive.
+     */
+    void push(const XrunRecord& record) noexcept;
+
+   private:
+    std::string name_;
+    XrunRingHeader* header_ = nullptr;
+    XrunRecord* records_ = nullptr;
+};
+
+/**
+ * The live statistics counters exposed by a bridged plugin instance through
+ * shared memory. The layout is fixed and read straight out of the object by
+ * `yabridgectl top`, so the fields must stay in sync with the parser in
+ * `tools/yabridgectl/src/top.rs`. All counters are free-running totals since
+ * the instance started, so readers can compute rates and recent means by
+ * sampling them twice and diffing.
+ */
+struct InstanceStats {
+    /**
+     * The expected value of the `magic` field, the bytes `stat` read as a
+     * little endian word.
+     */
+    static constexpr uint32_t magic_value = 0x74617473;
+    /**
+     * The current value of the `version` field. This should be bumped
+     * whenever the layout changes, so old `yabridgectl` versions don't
+     * misparse the block.
+     */
+    static constexpr uint32_t current_version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    /**
+     * The size of the most recently processed block in samples.
+     */
+    std::atomic<uint32_t> last_sample_frames;
+    /**
+     * The instance's current sample rate in Hz, or zero when the host hasn't
+     * set one yet.
+     */
+    std::atomic<uint32_t> sample_rate;
+    /**
+     * The total number of bridged audio processing calls.
+     */
+    std::atomic<uint64_t> process_calls;
+    /**
+     * The total time spent inside bridged audio processing calls, in
+     * microseconds.
+     */
+    std::atomic<uint64_t> process_time_us;
+    /**
+     * The longest single bridged audio processing call, in microseconds.
+     */
+    std::atomic<uint64_t> max_process_time_us;
+    /**
+     * The total number of events the host has passed to the plugin, like
+     * MIDI events.
+     */
+    std::atomic<uint64_t> events;
+};
+
+static_assert(sizeof(InstanceStats) == 48);
+
+/**
+ * A tiny shared memory object holding an `InstanceStats` block for a bridged
+ * plugin instance. The native side bumps the counters as part of the audio
+ * processing and event dispatching paths, and `yabridgectl top` reads all
+ * running instances' blocks straight from `/dev/shm` to show a live view of
+ * the bridge's own overhead.
+ *
+ * Like the xrun ring, only the native plugin writes to the block and
+ * external tools parse the backing file directly. Setup is best effort: when
+ * the object can't be created, the counters are simply not kept.
+ */
+class InstanceStatsBlock {
+   public:
+    /**
+     * Create the shared memory object backing the stats block. When this
+     * fails the block stays inactive and the counters become no-ops.
+     *
+     * @param name The name of the shared memory object, from `name_for()`.
+     */
+    explicit InstanceStatsBlock(const std::string& name) noexcept;
+
+    /**
+     * Unmap the stats block and remove the shared memory object.
+     */
+    ~InstanceStatsBlock() noexcept;
+
+    InstanceStatsBlock(const InstanceStatsBlock&) = delete;
+    InstanceStatsBlock& operator=(const InstanceStatsBlock&) = delete;
+    InstanceStatsBlock(InstanceStatsBlock&&) = delete;
+    InstanceStatsBlock& operator=(InstanceStatsBlock&&) = delete;
+
+    /**
+     * The name of the stats block for a bridged plugin instance, derived
+     * from the instance's unique socket endpoint base directory just like
+     * the audio buffers, the heartbeat and the xrun ring.
+     */
+    static std::string name_for(const std::string& endpoint_base_dir_name);
+
+    /**
+     * Whether the shared memory object was set up successfully.
+     */
+    inline bool active() const noexcept { return stats_ != nullptr; }
+
+    /**
+     * Account a finished bridged audio processing call. A no-op when the
+     * block is inactive.
+     */
+    void record_process_call(uint64_t duration_us,
+                             uint32_t sample_frames,
+                             uint32_t sample_rate) noexcept;
+
+    /**
+     * Account a batch of events passed from the host to the plugin. A no-op
+     * when the block is inactive.
+     */
+    inline void add_events(uint64_t num_events) noexcept {
+        if (stats_) {
+            stats_->events.fetch_add(num_events, std::memory_order_relaxed);
+        }
+    }
+
+   private:
+    std::string name_;
+    InstanceStats* stats_ = nullptr;
+};
+
+/**
+ * Tracks which shared memory objects are owned by which processes, so
+ * segments left behind by crashed or killed sessions can be removed again.
+ * All of the objects above are unlinked from destructors, which never run
+ * when a host process segfaults or gets killed by the DAW. The audio buffers
+ * in particular can be tens of megabytes per instance, so on systems with a
+ * long uptime these leaks can add up to gigabytes of locked tmpfs memory.
+ *
+ * Every process that maps yabridge shared memory objects keeps a registry
+ * file at `/dev/shm/yabridge-shm-registry/<pid>` listing the objects it
+ * currently has mapped, one name per line. The registry lives in `/dev/shm`
+ * itself so its lifetime always matches that of the segments it describes.
+ * The first object a process registers also triggers `reclaim_orphans()`,
+ * which unlinks all segments whose recorded owners are no longer running.
+ * `yabridgectl gc` performs the same sweep on demand, so the file format
+ * must stay in sync with the implementation in
+ * `tools/yabridgectl/src/gc.rs`.
+ *
+ * Everything here is best effort and never throws: when the registry can't
+ * be maintained the segments simply behave as they did before, and cleaning
+ * them up is left to a reboot.
+ */
+class ShmRegistry {
+   public:
+    /**
+     * Record that this process has mapped the shared memory object with the
+     * given name. Objects shared between instances, like the sidechain and
+     * gang doorbell objects, can be registered multiple times and stay
+     * registered until the last registration is undone. The first
+     * registration in a process also sweeps up orphaned segments from
+     * earlier sessions, see `reclaim_orphans()`.
+     */
+    static void register_object(const std::string& name) noexcept;
+
+    /**
+     * Undo a `register_object()` call after unmapping an object. When the
+     * last object is unregistered the process' registry file is removed
+     * again.
+     */
+    static void unregister_object(const std::string& name) noexcept;
+
+    /**
+     * Unlink all shared memory objects whose recorded owning processes are
+     * no longer running, along with their stale registry files. Objects
+     * also registered by a process that's still alive are left alone. This
+     * runs automatically when a process registers its first object, so
+     * every newly started bridge cleans up after previously crashed ones.
+     */
+    static void reclaim_orphans() noexcept;
+
+    /**
+     * The directory containing the per-process registry files.
+     */
+    static constexpr char registry_directory[] =
+        "/dev/shm/yabridge-shm-registry";
+};
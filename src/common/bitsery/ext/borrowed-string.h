@@ -0,0 +1,136 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cassert>
+#include <string_view>
+
+#include <bitsery/details/adapter_utils.h>
+#include <bitsery/details/serialization_common.h>
+#include <bitsery/traits/core/traits.h>
+
+namespace bitsery {
+namespace ext {
+
+/**
+ * The buffer the message currently being deserialized on this thread was
+ * received into, or a null pointer outside of `BorrowedBufferScope`. Stored
+ * per thread because every socket receive happens on the thread that will
+ * also run the handler.
+ *
+ * @see BorrowedBufferScope
+ * @see BorrowedString
+ */
+inline const uint8_t*& borrowed_receive_buffer() noexcept {
+    thread_local const uint8_t* buffer_data = nullptr;
+    return buffer_data;
+}
+
+/**
+ * Marks the buffer a received message is being deserialized from, so
+ * `BorrowedString` fields can alias that buffer instead of copying bytes out
+ * of it. `read_object()` and `read_vst2_event()` install this right before
+ * deserializing, after any decompression has replaced the buffer's contents.
+ * The previous value is restored on destruction since deserializing one
+ * message can in theory trigger deserializing another on the same thread.
+ */
+class BorrowedBufferScope {
+   public:
+    BorrowedBufferScope(const uint8_t* buffer_data) noexcept
+        : previous_(borrowed_receive_buffer()) {
+        borrowed_receive_buffer() = buffer_data;
+    }
+
+    ~BorrowedBufferScope() noexcept { borrowed_receive_buffer() = previous_; }
+
+    BorrowedBufferScope(const BorrowedBufferScope&) = delete;
+    BorrowedBufferScope& operator=(const BorrowedBufferScope&) = delete;
+
+   private:
+    const uint8_t* previous_;
+};
+
+/**
+ * An adapter for serializing `std::string_view`s. On the wire this is
+ * identical to `text1b()`, but instead of copying the bytes into an owned
+ * `std::string` the deserialized view aliases the receive buffer directly.
+ * This avoids an allocation and a copy for every string that crosses the
+ * socket, at the cost of a strict lifetime requirement: the view is only
+ * valid while the receive buffer still holds the message, so it must not be
+ * retained past the message handler and must be copied before the thread
+ * performs another socket operation. See `passthrough_event()` for an example
+ * of the latter.
+ *
+ * On the serializing side the view can simply point at the sender's own
+ * data, like the host's string argument in `DefaultDataConverter::read_data()`,
+ * which also avoids copying the string into the message object first.
+ */
+class BorrowedString {
+   public:
+    /**
+     * @param max_size The maximum string size, passed to the same size check
+     *   a `text1b()` call with this limit would perform.
+     */
+    BorrowedString(size_t max_size) : max_size_(max_size) {}
+
+    template <typename Ser, typename Fnc>
+    void serialize(Ser& ser, const std::string_view& string, Fnc&&) const {
+        details::writeSize(ser.adapter(), string.size());
+        // Default constructed views contain a null pointer, which shouldn't
+        // be passed to the adapter even with a zero size
+        if (!string.empty()) {
+            ser.adapter().template writeBuffer<1>(
+                reinterpret_cast<const uint8_t*>(string.data()),
+                string.size());
+        }
+    }
+
+    template <typename Des, typename Fnc>
+    void deserialize(Des& des, std::string_view& string, Fnc&&) const {
+        size_t size = 0;
+        details::readSize(
+            des.adapter(), size, max_size_,
+            std::integral_constant<bool, Des::TConfig::CheckDataErrors>{});
+
+        // The adapter only exposes read positions, so the buffer itself comes
+        // from the scope installed by the receiving function
+        assert(borrowed_receive_buffer());
+        const size_t read_pos = des.adapter().currentReadPos();
+        string = std::string_view(reinterpret_cast<const char*>(
+                                      borrowed_receive_buffer() + read_pos),
+                                  size);
+        des.adapter().currentReadPos(read_pos + size);
+    }
+
+   private:
+    size_t max_size_;
+};
+
+}  // namespace ext
+
+namespace traits {
+
+template <>
+struct ExtensionTraits<ext::BorrowedString, std::string_view> {
+    using TValue = void;
+    static constexpr bool SupportValueOverload = false;
+    static constexpr bool SupportObjectOverload = true;
+    static constexpr bool SupportLambdaOverload = false;
+};
+
+}  // namespace traits
+}  // namespace bitsery
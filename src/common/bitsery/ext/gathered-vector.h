@@ -0,0 +1,174 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <bitsery/details/adapter_utils.h>
+#include <bitsery/details/serialization_common.h>
+#include <bitsery/traits/core/traits.h>
+#include <llvm/small-vector.h>
+
+namespace bitsery {
+namespace ext {
+
+/**
+ * A span of bytes `write_object()` should send straight from the message
+ * object instead of from the serialization buffer. `stream_offset` is the
+ * position within the serialized byte stream where the span's bytes belong.
+ * Since the bytes are never written to the serialization buffer, this is also
+ * the adapter's write position at the moment the span was registered, and
+ * multiple segments can share the same offset when they're adjacent on the
+ * wire.
+ *
+ * @see GatheredVector
+ */
+struct GatheredSegment {
+    size_t stream_offset;
+    const uint8_t* data;
+    size_t size;
+};
+
+/**
+ * The gathered segments registered while serializing the message currently
+ * being written on this thread, or a null pointer when no `GatherScope` is
+ * active.
+ *
+ * @see GatherScope
+ * @see GatheredVector
+ */
+inline llvm::SmallVectorImpl<GatheredSegment>*&
+active_gather_segments() noexcept {
+    thread_local llvm::SmallVectorImpl<GatheredSegment>* segments = nullptr;
+    return segments;
+}
+
+/**
+ * Collects the segments `GatheredVector` fields register while a message is
+ * being serialized. `write_object()` installs this around its serialization
+ * call and then interleaves the segments with the serialization buffer's
+ * contents in the gathered socket write. The previous sink is restored on
+ * destruction, mirroring `BorrowedBufferScope` on the receiving side.
+ */
+class GatherScope {
+   public:
+    GatherScope() noexcept : previous_(active_gather_segments()) {
+        active_gather_segments() = &segments_;
+    }
+
+    ~GatherScope() noexcept { active_gather_segments() = previous_; }
+
+    GatherScope(const GatherScope&) = delete;
+    GatherScope& operator=(const GatherScope&) = delete;
+
+    /**
+     * The segments registered within this scope, ordered by stream offset
+     * since serialization only moves forwards.
+     */
+    const llvm::SmallVectorImpl<GatheredSegment>& segments() const noexcept {
+        return segments_;
+    }
+
+   private:
+    llvm::SmallVector<GatheredSegment, 4> segments_;
+    llvm::SmallVectorImpl<GatheredSegment>* previous_;
+};
+
+/**
+ * An adapter for serializing byte vectors. On the wire this is identical to
+ * `container1b()`, but when the vector is large and the message is being
+ * serialized for `write_object()`, the bytes are not copied into the
+ * serialization buffer at all. Only the size prefix is serialized, and the
+ * span is registered as a `GatheredSegment` pointing at the message object's
+ * own storage. `write_object()` then passes the span to the kernel as an
+ * extra entry of its gathered socket write, so state chunks and other bulk
+ * payloads go from the application's data structure into the kernel without
+ * first being assembled into an intermediate buffer.
+ *
+ * Outside of a `GatherScope`, and for vectors below `gather_threshold`, this
+ * degrades to the same copy `container1b()` would perform, so ad hoc
+ * serialization to a plain buffer keeps working unchanged.
+ */
+class GatheredVector {
+   public:
+    /**
+     * Spans smaller than this are copied into the serialization buffer as
+     * before. Below this point the bookkeeping for an extra `iovec` entry
+     * costs more than the copy it saves.
+     */
+    static constexpr size_t gather_threshold = 4096;
+
+    /**
+     * @param max_size The maximum vector size, passed to the same size check
+     *   a `container1b()` call with this limit would perform.
+     */
+    GatheredVector(size_t max_size) : max_size_(max_size) {}
+
+    template <typename Ser, typename Fnc>
+    void serialize(Ser& ser, const std::vector<uint8_t>& data, Fnc&&) const {
+        details::writeSize(ser.adapter(), data.size());
+        if (data.empty()) {
+            return;
+        }
+
+        llvm::SmallVectorImpl<GatheredSegment>* const segments =
+            active_gather_segments();
+        if (segments && data.size() >= gather_threshold) {
+            // The message object stays alive until `write_object()` finishes
+            // its synchronous socket write, so the segment can safely point
+            // at the vector's storage
+            segments->push_back(GatheredSegment{
+                .stream_offset = ser.adapter().currentWritePos(),
+                .data = data.data(),
+                .size = data.size()});
+        } else {
+            ser.adapter().template writeBuffer<1>(data.data(), data.size());
+        }
+    }
+
+    template <typename Des, typename Fnc>
+    void deserialize(Des& des, std::vector<uint8_t>& data, Fnc&&) const {
+        size_t size = 0;
+        details::readSize(
+            des.adapter(), size, max_size_,
+            std::integral_constant<bool, Des::TConfig::CheckDataErrors>{});
+
+        data.resize(size);
+        if (size > 0) {
+            des.adapter().template readBuffer<1>(data.data(), size);
+        }
+    }
+
+   private:
+    size_t max_size_;
+};
+
+}  // namespace ext
+
+namespace traits {
+
+template <>
+struct ExtensionTraits<ext::GatheredVector, std::vector<uint8_t>> {
+    using TValue = void;
+    static constexpr bool SupportValueOverload = false;
+    static constexpr bool SupportObjectOverload = true;
+    static constexpr bool SupportLambdaOverload = false;
+};
+
+}  // namespace traits
+}  // namespace bitsery
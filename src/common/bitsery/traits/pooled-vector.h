@@ -0,0 +1,37 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <bitsery/traits/core/std_defaults.h>
+
+#include "../../pooled-vector.h"
+
+namespace bitsery {
+namespace traits {
+
+// Deserializing a container into a `PooledVector` resizes it to the received
+// element count and then deserializes into the retained elements, so after a
+// few processing cycles these deserializations stop allocating entirely
+
+template <typename T, unsigned N>
+struct ContainerTraits<PooledVector<T, N>>
+    : public StdContainer<PooledVector<T, N>, true, true> {
+    // The storage needs to be contiguous for this to work
+};
+
+}  // namespace traits
+}  // namespace bitsery
@@ -0,0 +1,39 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <span>
+
+#include <bitsery/traits/core/std_defaults.h>
+
+namespace bitsery {
+namespace traits {
+
+// These traits let a `std::span` be used as a (fixed size, non-owning) input
+// buffer for deserialization, so data can be read directly out of a memory
+// mapped cache file without copying it to an owned buffer first
+
+template <typename T>
+struct ContainerTraits<std::span<T>>
+    : public StdContainer<std::span<T>, false, true> {};
+
+template <typename T>
+struct BufferAdapterTraits<std::span<T>>
+    : public StdContainerForBufferAdapter<std::span<T>, false> {};
+
+}  // namespace traits
+}  // namespace bitsery
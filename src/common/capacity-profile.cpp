@@ -0,0 +1,148 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "capacity-profile.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+/**
+ * The macro name written for every counter, in `CapacityCounter` order. The
+ * names match the `YABRIDGE_PROFILE_<name>` macros consumed in
+ * `src/common/serialization/capacities.h`.
+ */
+constexpr std::array<const char*, num_capacity_counters>
+    capacity_counter_names{
+        "VST2_EVENTS",
+        "VST2_SYSEX_EVENTS",
+        "CLAP_EVENTS",
+        "CLAP_NOTE_EVENTS",
+        "CLAP_PARAM_VALUE_EVENTS",
+        "CLAP_PARAM_MOD_EVENTS",
+        "CLAP_MIDI_EVENTS",
+        "AUDIO_BUSES",
+        "VST3_PARAMETER_QUEUES",
+        "VST3_PARAMETER_POINTS",
+        "AUDIO_MESSAGE_BUFFER",
+    };
+
+constexpr char macro_prefix[] = "#define YABRIDGE_PROFILE_";
+
+}  // namespace
+
+std::array<std::atomic_size_t, num_capacity_counters>
+    CapacityProfile::counters_{};
+
+void CapacityProfile::write_profile() noexcept {
+    const char* path = getenv("YABRIDGE_CAPACITY_PROFILE_FILE");
+    if (!path || !*path) {
+        return;
+    }
+
+    std::array<size_t, num_capacity_counters> maxima;
+    for (size_t i = 0; i < num_capacity_counters; i++) {
+        maxima[i] = counters_[i].load(std::memory_order_relaxed);
+    }
+
+    // The native plugin and the Wine plugin host both export when a plugin
+    // gets unloaded, and the whole point of the file is to accumulate maxima
+    // over many sessions, so the file is merged into under an exclusive lock
+    // rather than overwritten
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1 || flock(fd, LOCK_EX) == -1) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    std::string previous{};
+    char chunk[4096];
+    ssize_t bytes_read;
+    while ((bytes_read = read(fd, chunk, sizeof(chunk))) > 0) {
+        previous.append(chunk, static_cast<size_t>(bytes_read));
+    }
+
+    // Anything that's not one of our own `#define` lines (like the comment
+    // banner below) is simply skipped, so hand-merged or annotated profiles
+    // keep working
+    size_t line_start = 0;
+    while (line_start < previous.size()) {
+        size_t line_end = previous.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = previous.size();
+        }
+
+        const std::string line =
+            previous.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+        if (line.compare(0, sizeof(macro_prefix) - 1, macro_prefix) != 0) {
+            continue;
+        }
+
+        const size_t name_start = sizeof(macro_prefix) - 1;
+        const size_t name_end = line.find(' ', name_start);
+        if (name_end == std::string::npos) {
+            continue;
+        }
+
+        const std::string name = line.substr(name_start, name_end - name_start);
+        const size_t value =
+            std::strtoull(line.c_str() + name_end + 1, nullptr, 10);
+        for (size_t i = 0; i < num_capacity_counters; i++) {
+            if (name == capacity_counter_names[i]) {
+                maxima[i] = std::max(maxima[i], value);
+                break;
+            }
+        }
+    }
+
+    std::string output =
+        "// Capacity profile exported by yabridge, see\n"
+        "// src/common/capacity-profile.h. Consume with\n"
+        "// -Dcapacity-profile=<absolute path to this file>. The values are\n"
+        "// high-water marks merged over every session that exported into\n"
+        "// this file.\n";
+    for (size_t i = 0; i < num_capacity_counters; i++) {
+        output += macro_prefix;
+        output += capacity_counter_names[i];
+        output += ' ';
+        output += std::to_string(maxima[i]);
+        output += '\n';
+    }
+
+    if (ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0) {
+        size_t written = 0;
+        while (written < output.size()) {
+            const ssize_t result = write(fd, output.data() + written,
+                                         output.size() - written);
+            if (result <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(result);
+        }
+    }
+
+    // This also releases the lock
+    close(fd);
+}
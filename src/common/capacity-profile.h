@@ -0,0 +1,134 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// The inline capacities of the small vectors used in the messages in
+// `src/common/serialization/` are guesses at what real sessions need, see
+// `src/common/serialization/capacities.h`. This file contains the other half
+// of the profile-guided tuning loop for those guesses: the serialization code
+// records the high-water marks of the quantities those capacities have to
+// cover - events per block, buses per plugin, parameter queue sizes, audio
+// message sizes - and when the `YABRIDGE_CAPACITY_PROFILE_FILE` environment
+// variable is set to a file path, the maxima are written to that file when a
+// plugin gets unloaded. The file is itself a C++ header defining one macro
+// per counter, so a profile collected from real sessions can be fed straight
+// back into a build with `-Dcapacity-profile=<path>` to set the capacities at
+// compile time.
+//
+// Exports merge into the file instead of overwriting it: the existing
+// per-counter values are read back under an exclusive `flock()` and the
+// maxima of both are written out again. Pointing every process at the same
+// file thus accumulates a profile covering all plugins and sessions it was
+// collected from, with no separate merge tool needed. Recording an
+// observation is a relaxed atomic load plus, only when a new maximum is seen,
+// a compare-exchange, so like the message traffic accounting in
+// `src/common/communication/common.h` the counters are always on.
+
+/**
+ * The profiled quantities. Every counter corresponds to one macro in the
+ * exported profile header and to one capacity in
+ * `src/common/serialization/capacities.h`, see `capacity_counter_names` in
+ * `capacity-profile.cpp` for the macro names.
+ */
+enum class CapacityCounter : size_t {
+    /**
+     * VST2 events per `effProcessEvents()` call.
+     */
+    vst2_events,
+    /**
+     * SysEx events among those.
+     */
+    vst2_sysex_events,
+    /**
+     * CLAP events per processed block, across all event types.
+     */
+    clap_events,
+    /**
+     * CLAP note events per processed block.
+     */
+    clap_note_events,
+    /**
+     * CLAP parameter value events per processed block.
+     */
+    clap_param_value_events,
+    /**
+     * CLAP parameter modulation events per processed block.
+     */
+    clap_param_mod_events,
+    /**
+     * CLAP MIDI events per processed block.
+     */
+    clap_midi_events,
+    /**
+     * Audio input or output buses per plugin instance, whichever is higher.
+     */
+    audio_buses,
+    /**
+     * VST3 parameter change queues per processed block.
+     */
+    vst3_parameter_queues,
+    /**
+     * VST3 parameter change points per processed block, across all queues.
+     */
+    vst3_parameter_points,
+    /**
+     * The capacity the audio thread serialization buffers grew to, in bytes.
+     */
+    audio_message_buffer,
+};
+
+/**
+ * The number of counters in `CapacityCounter`.
+ */
+constexpr size_t num_capacity_counters =
+    static_cast<size_t>(CapacityCounter::audio_message_buffer) + 1;
+
+/**
+ * The process wide high-water marks for the profiled quantities. See the
+ * comment at the top of this file for how these close the loop back to the
+ * compile time capacities.
+ */
+class CapacityProfile {
+   public:
+    /**
+     * Record an observed value for a counter, keeping the maximum. Safe to
+     * call from the audio threads.
+     */
+    static void observe(CapacityCounter counter, size_t value) noexcept {
+        std::atomic_size_t& maximum = counters_[static_cast<size_t>(counter)];
+        size_t current = maximum.load(std::memory_order_relaxed);
+        while (value > current &&
+               !maximum.compare_exchange_weak(current, value,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Merge this process' high-water marks into the profile header named by
+     * the `YABRIDGE_CAPACITY_PROFILE_FILE` environment variable. A no-op when
+     * the variable is not set. Called through `Sockets::log_telemetry()` when
+     * a plugin gets unloaded, and best effort like the rest of the telemetry.
+     */
+    static void write_profile() noexcept;
+
+   private:
+    static std::array<std::atomic_size_t, num_capacity_counters> counters_;
+};
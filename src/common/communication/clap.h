@@ -59,14 +59,16 @@ class ClapAudioThreadSockets {
                                          std::to_string(instance_id) + ".sock"))
                        .string(),
                    // The Wine side will end up listening for control messages
-                   !listen),
+                   !listen,
+                   SocketBufferConfig::audio()),
           callback_(
               io_context,
               (endpoint_base_dir / ("plugin_host_audio_thread_callback_" +
                                     std::to_string(instance_id) + ".sock"))
                   .string(),
               // And the plugin side for callbacks
-              listen) {}
+              listen,
+              SocketBufferConfig::audio()) {}
 
     void connect() {
         control_.connect();
@@ -138,19 +140,24 @@ class ClapSockets final : public Sockets {
           host_plugin_main_thread_control_(
               io_context,
               (base_dir_ / "host_plugin_main_thread_control.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::control()),
           plugin_host_main_thread_callback_(
               io_context,
               (base_dir_ / "plugin_host_main_thread_callback.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::control()),
           io_context_(io_context) {}
 
     // NOLINTNEXTLINE(clang-analyzer-optin.cplusplus.VirtualCall)
-    ~ClapSockets() noexcept override { close(); }
+    ~ClapSockets() noexcept override {
+        log_telemetry();
+        close();
+    }
 
     void connect() override {
-        host_plugin_main_thread_control_.connect();
-        plugin_host_main_thread_callback_.connect();
+        connect_sockets_parallel<Thread>(host_plugin_main_thread_control_,
+                                         plugin_host_main_thread_callback_);
     }
 
     void close() override {
@@ -300,7 +307,7 @@ class ClapSockets final : public Sockets {
         typename T::Response response_object;
         return audio_thread_sockets_.at(object.instance_id)
             .control_.receive_into(object, response_object, logging,
-                                   audio_thread_buffer());
+                                   audio_thread_buffer(), false);
     }
 
     /**
@@ -314,7 +321,7 @@ class ClapSockets final : public Sockets {
         typename T::Response response_object;
         return audio_thread_sockets_.at(object_ref.get().instance_id)
             .control_.receive_into(object_ref, response_object, logging,
-                                   audio_thread_buffer());
+                                   audio_thread_buffer(), false);
     }
 
     /**
@@ -331,7 +338,7 @@ class ClapSockets final : public Sockets {
         std::optional<std::pair<ClapLogger&, bool>> logging) {
         return audio_thread_sockets_.at(request_ref.get().instance_id)
             .control_.receive_into(request_ref, response_ref, logging,
-                                   audio_thread_buffer());
+                                   audio_thread_buffer(), false);
     }
 
     /**
@@ -350,7 +357,7 @@ class ClapSockets final : public Sockets {
         std::optional<std::pair<ClapLogger&, bool>> logging) {
         typename T::Response response_object;
         return audio_thread_sockets_.at(object.owner_instance_id)
-            .callback_.receive_into(object, response_object, logging);
+            .callback_.receive_into(object, response_object, logging, false);
     }
 
     /**
@@ -379,7 +386,14 @@ class ClapSockets final : public Sockets {
      * being sent.
      */
     SerializationBufferBase& audio_thread_buffer() {
-        thread_local SerializationBuffer<2048> audio_thread_buffer{};
+        thread_local SerializationBuffer<capacities::audio_message_buffer>
+            audio_thread_buffer{};
+
+        // The capacity only exceeds the initial size when a message didn't
+        // fit, which is exactly what the profile needs to know to size the
+        // buffer for the next build
+        CapacityProfile::observe(CapacityCounter::audio_message_buffer,
+                                 audio_thread_buffer.capacity());
 
         return audio_thread_buffer;
     }
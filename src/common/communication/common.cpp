@@ -16,8 +16,24 @@
 
 #include "common.h"
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <sstream>
+#include <vector>
+
+#ifdef WITH_ALLOC_TRACKING
+#include <execinfo.h>
+
+#include <cstdlib>
+#include <new>
+#endif
+
+#ifdef WITH_LZ4
+#include <lz4.h>
+
+#include <cstring>
+#endif
 
 #include "../utils.h"
 
@@ -29,6 +45,575 @@ namespace fs = ghc::filesystem;
 constexpr char alphanumeric_characters[] =
     "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
 
+/**
+ * All currently live serialization buffer monitors, for
+ * `SerializationBufferMonitor::log_all()`. Monitors register themselves on
+ * construction and unregister on destruction.
+ */
+static std::mutex buffer_monitors_mutex{};
+static std::vector<SerializationBufferMonitor*> buffer_monitors{};
+
+SerializationBufferMonitor::SerializationBufferMonitor(std::string description)
+    : description_(std::move(description)) {
+    std::lock_guard lock(buffer_monitors_mutex);
+    buffer_monitors.push_back(this);
+}
+
+SerializationBufferMonitor::~SerializationBufferMonitor() noexcept {
+    std::lock_guard lock(buffer_monitors_mutex);
+    buffer_monitors.erase(
+        std::find(buffer_monitors.begin(), buffer_monitors.end(), this));
+}
+
+void SerializationBufferMonitor::log_all(Logger& logger) {
+    std::lock_guard lock(buffer_monitors_mutex);
+
+    logger.log("Serialization buffer usage:");
+    for (const auto* monitor : buffer_monitors) {
+        logger.log(
+            "  " + monitor->description_ + ": " +
+            std::to_string(
+                monitor->current_capacity_.load(std::memory_order_relaxed)) +
+            " bytes allocated, high-water mark " +
+            std::to_string(
+                monitor->high_water_mark_.load(std::memory_order_relaxed)) +
+            " bytes");
+    }
+}
+
+#ifdef WITH_LZ4
+SerializationBufferBase& compression_scratch_buffer() {
+    thread_local SerializationBuffer<256> buffer{};
+
+    return buffer;
+}
+
+std::optional<size_t> compress_message(const SerializationBufferBase& buffer,
+                                       size_t size,
+                                       SerializationBufferBase& compressed) {
+    // LZ4's block API is limited to messages of just under 2 GB. Nothing ever
+    // comes close to that, and such a message would have failed to allocate
+    // long before it got here.
+    assert(size <= LZ4_MAX_INPUT_SIZE);
+
+    const size_t bound =
+        static_cast<size_t>(LZ4_compressBound(static_cast<int>(size)));
+    compressed.resize_for_overwrite(sizeof(uint64_t) + bound);
+
+    const uint64_t uncompressed_size = size;
+    std::memcpy(compressed.data(), &uncompressed_size,
+                sizeof(uncompressed_size));
+
+    const int compressed_size = LZ4_compress_default(
+        reinterpret_cast<const char*>(buffer.data()),
+        reinterpret_cast<char*>(compressed.data() + sizeof(uncompressed_size)),
+        static_cast<int>(size), static_cast<int>(bound));
+    if (compressed_size <= 0) [[unlikely]] {
+        return std::nullopt;
+    }
+
+    const size_t total_size =
+        sizeof(uncompressed_size) + static_cast<size_t>(compressed_size);
+    if (total_size >= size) {
+        return std::nullopt;
+    }
+
+    return total_size;
+}
+
+size_t decompress_message(const SerializationBufferBase& buffer,
+                          size_t size,
+                          SerializationBufferBase& decompressed) {
+    uint64_t uncompressed_size = 0;
+    if (size < sizeof(uncompressed_size)) [[unlikely]] {
+        throw std::runtime_error("Received a malformed compressed message");
+    }
+    std::memcpy(&uncompressed_size, buffer.data(), sizeof(uncompressed_size));
+
+    decompressed.resize_for_overwrite(uncompressed_size);
+    const int result = LZ4_decompress_safe(
+        reinterpret_cast<const char*>(buffer.data() +
+                                      sizeof(uncompressed_size)),
+        reinterpret_cast<char*>(decompressed.data()),
+        static_cast<int>(size - sizeof(uncompressed_size)),
+        static_cast<int>(uncompressed_size));
+    if (result < 0 || static_cast<uint64_t>(result) != uncompressed_size)
+        [[unlikely]] {
+        throw std::runtime_error("Received a corrupt compressed message");
+    }
+
+    return uncompressed_size;
+}
+#endif  // WITH_LZ4
+
+SerializationBufferBase& gather_splice_buffer() {
+    thread_local SerializationBuffer<256> buffer{};
+
+    return buffer;
+}
+
+size_t splice_gathered_message(
+    const SerializationBufferBase& buffer,
+    size_t serialized_size,
+    const llvm::SmallVectorImpl<bitsery::ext::GatheredSegment>& segments,
+    SerializationBufferBase& spliced) {
+    size_t total_size = serialized_size;
+    for (const auto& segment : segments) {
+        total_size += segment.size;
+    }
+
+    spliced.resize_for_overwrite(total_size);
+
+    uint8_t* write_pos = spliced.data();
+    size_t read_pos = 0;
+    for (const auto& segment : segments) {
+        const size_t slice_size = segment.stream_offset - read_pos;
+        write_pos = std::copy_n(buffer.data() + read_pos, slice_size,
+                                write_pos);
+        read_pos = segment.stream_offset;
+
+        write_pos = std::copy_n(segment.data, segment.size, write_pos);
+    }
+    std::copy_n(buffer.data() + read_pos, serialized_size - read_pos,
+                write_pos);
+
+    return total_size;
+}
+
+SerializationBufferPool& SerializationBufferPool::instance() {
+    static SerializationBufferPool pool{};
+    return pool;
+}
+
+SerializationBufferPool::Checkout SerializationBufferPool::checkout() {
+    {
+        std::lock_guard lock(mutex_);
+        if (!buffers_.empty()) {
+            std::unique_ptr<SerializationBuffer<256>> buffer =
+                std::move(buffers_.back());
+            buffers_.pop_back();
+
+            return Checkout(std::move(buffer));
+        }
+    }
+
+    return Checkout(std::make_unique<SerializationBuffer<256>>());
+}
+
+void SerializationBufferPool::release(
+    std::unique_ptr<SerializationBuffer<256>> buffer) noexcept {
+    std::lock_guard lock(mutex_);
+
+    monitor_.track(*buffer);
+    if (buffers_.size() < max_idle_buffers) {
+        buffers_.push_back(std::move(buffer));
+    }
+}
+
+#ifdef WITH_ALLOC_TRACKING
+namespace {
+
+/**
+ * Per-message-type allocation totals, updated from
+ * `AllocationTracker::Scope`'s destructor and dumped with
+ * `AllocationTracker::log_all()`.
+ */
+struct AllocationStats {
+    uint64_t messages = 0;
+    uint64_t messages_with_allocations = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+
+    /**
+     * The symbolized backtrace of the first allocation seen for this message
+     * type. The raw frame addresses are captured in the replaced `operator
+     * new` and symbolized after the scope has ended, since the symbolization
+     * itself allocates.
+     */
+    std::vector<std::string> first_allocation_backtrace;
+};
+
+constexpr int max_backtrace_frames = 32;
+
+// These are written from the replaced allocation operators below, so they
+// must never allocate themselves
+thread_local bool tracking_active = false;
+thread_local uint64_t thread_allocations = 0;
+thread_local uint64_t thread_allocated_bytes = 0;
+thread_local std::array<void*, max_backtrace_frames> first_backtrace_frames;
+thread_local int first_backtrace_depth = 0;
+
+std::mutex allocation_stats_mutex{};
+std::map<std::string_view, AllocationStats> allocation_stats{};
+
+/**
+ * The common part of the replaced `operator new` variants. Counts the
+ * allocation when an `AllocationTracker::Scope` is active on this thread and
+ * captures the backtrace of the first allocation within the scope.
+ */
+void* tracked_allocate(std::size_t size) noexcept {
+    if (tracking_active) {
+        thread_allocations += 1;
+        thread_allocated_bytes += size;
+
+        if (first_backtrace_depth == 0) {
+            // `backtrace()` can allocate internally the first time it's
+            // called, so the marker value prevents infinite recursion (that
+            // nested allocation then just gets counted as a regular one)
+            first_backtrace_depth = -1;
+            first_backtrace_depth = backtrace(first_backtrace_frames.data(),
+                                              max_backtrace_frames);
+        }
+    }
+
+    return std::malloc(size);
+}
+
+}  // namespace
+
+// With the `alloc-tracking` build option enabled the global allocation
+// operators are replaced with counting versions. The deallocation operators
+// have to be replaced alongside them to keep the pairing well defined, even
+// though freeing with `std::free()` matches what the defaults do anyway. The
+// sized and array `operator delete` variants forward to these.
+
+void* operator new(std::size_t size) {
+    if (void* pointer = tracked_allocate(size)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+    if (void* pointer = tracked_allocate(size)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return tracked_allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return tracked_allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+AllocationTracker::Scope::Scope(std::string_view description) noexcept
+    : description_(description) {
+    thread_allocations = 0;
+    thread_allocated_bytes = 0;
+    first_backtrace_depth = 0;
+    tracking_active = true;
+}
+
+AllocationTracker::Scope::~Scope() noexcept {
+    // Updating the registry below allocates, so tracking has to stop first
+    tracking_active = false;
+
+    std::lock_guard lock(allocation_stats_mutex);
+    AllocationStats& stats = allocation_stats[description_];
+    stats.messages += 1;
+    if (thread_allocations > 0) {
+        stats.messages_with_allocations += 1;
+        stats.allocations += thread_allocations;
+        stats.allocated_bytes += thread_allocated_bytes;
+
+        if (stats.first_allocation_backtrace.empty() &&
+            first_backtrace_depth > 0) {
+            char** symbols = backtrace_symbols(first_backtrace_frames.data(),
+                                               first_backtrace_depth);
+            if (symbols) {
+                for (int frame = 0; frame < first_backtrace_depth; frame++) {
+                    stats.first_allocation_backtrace.push_back(symbols[frame]);
+                }
+                std::free(symbols);
+            }
+        }
+    }
+}
+
+void AllocationTracker::log_all(Logger& logger) {
+    std::lock_guard lock(allocation_stats_mutex);
+
+    logger.log("Audio thread allocations per message type:");
+    for (const auto& [description, stats] : allocation_stats) {
+        if (stats.allocations == 0) {
+            logger.log("  " + std::string(description) +
+                       ": no allocations over " +
+                       std::to_string(stats.messages) + " messages");
+            continue;
+        }
+
+        logger.log("  " + std::string(description) + ": " +
+                   std::to_string(stats.allocations) + " allocations (" +
+                   std::to_string(stats.allocated_bytes) + " bytes) over " +
+                   std::to_string(stats.messages_with_allocations) + " of " +
+                   std::to_string(stats.messages) + " messages");
+        if (!stats.first_allocation_backtrace.empty()) {
+            logger.log("    first allocation backtrace:");
+            for (const auto& frame : stats.first_allocation_backtrace) {
+                logger.log("      " + frame);
+            }
+        }
+    }
+}
+#else
+void AllocationTracker::log_all(Logger& /*logger*/) {}
+#endif
+
+/**
+ * All currently live round-trip latency histograms, for
+ * `RoundTripLatencyHistogram::log_all()`. Histograms register themselves on
+ * construction and unregister on destruction.
+ */
+static std::mutex latency_histograms_mutex{};
+static std::vector<RoundTripLatencyHistogram*> latency_histograms{};
+
+RoundTripLatencyHistogram::RoundTripLatencyHistogram(std::string description)
+    : description_(std::move(description)) {
+    std::lock_guard lock(latency_histograms_mutex);
+    latency_histograms.push_back(this);
+}
+
+RoundTripLatencyHistogram::~RoundTripLatencyHistogram() noexcept {
+    std::lock_guard lock(latency_histograms_mutex);
+    latency_histograms.erase(std::find(latency_histograms.begin(),
+                                       latency_histograms.end(), this));
+}
+
+void RoundTripLatencyHistogram::log_all(Logger& logger) {
+    std::lock_guard lock(latency_histograms_mutex);
+
+    logger.log("Round-trip latencies per message type:");
+    for (const auto* histogram : latency_histograms) {
+        // Concurrent `record()` calls can slightly skew a percentile here,
+        // but since this is diagnostics output a snapshot that's off by a
+        // message or two doesn't matter
+        std::array<uint64_t, major_bucket_count * sub_bucket_count> counts;
+        uint64_t total = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            counts[i] = histogram->counts_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        if (total == 0) {
+            continue;
+        }
+
+        const auto percentile = [&](double fraction) -> uint64_t {
+            const auto target = static_cast<uint64_t>(
+                std::ceil(static_cast<double>(total) * fraction));
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < counts.size(); i++) {
+                cumulative += counts[i];
+                if (cumulative >= target) {
+                    return bucket_lower_bound(i);
+                }
+            }
+
+            return histogram->max_us_.load(std::memory_order_relaxed);
+        };
+
+        logger.log(
+            "  " + histogram->description_ + ": n=" + std::to_string(total) +
+            ", p50 " + std::to_string(percentile(0.50)) + " us, p95 " +
+            std::to_string(percentile(0.95)) + " us, p99 " +
+            std::to_string(percentile(0.99)) + " us, max " +
+            std::to_string(
+                histogram->max_us_.load(std::memory_order_relaxed)) +
+            " us");
+    }
+}
+
+/**
+ * All currently live dispatch timing tables, for
+ * `DispatchTimingTable::log_all()`. Tables register themselves on
+ * construction and unregister on destruction.
+ */
+static std::mutex timing_tables_mutex{};
+static std::vector<DispatchTimingTable*> timing_tables{};
+
+DispatchTimingTable::DispatchTimingTable(std::string description)
+    : description_(std::move(description)) {
+    std::lock_guard lock(timing_tables_mutex);
+    timing_tables.push_back(this);
+}
+
+DispatchTimingTable::~DispatchTimingTable() noexcept {
+    std::lock_guard lock(timing_tables_mutex);
+    timing_tables.erase(
+        std::find(timing_tables.begin(), timing_tables.end(), this));
+}
+
+DispatchTimingTable::Entry& DispatchTimingTable::entry(std::string_view name) {
+    std::lock_guard lock(entries_mutex_);
+    auto it = entries_.find(name);
+    if (it == entries_.end()) {
+        it = entries_.try_emplace(std::string(name)).first;
+    }
+
+    return it->second;
+}
+
+void DispatchTimingTable::log_all(Logger& logger) {
+    std::lock_guard lock(timing_tables_mutex);
+
+    logger.log("Time spent in message handlers:");
+    for (auto* table : timing_tables) {
+        std::lock_guard entries_lock(table->entries_mutex_);
+        if (table->entries_.empty()) {
+            continue;
+        }
+
+        // Snapshotted so the rows can be sorted by cumulative duration, the
+        // way `strace -c` sorts its summary. Concurrent `record()` calls can
+        // slightly skew a row here, but for diagnostics output a snapshot
+        // that's off by a call or two doesn't matter.
+        struct Row {
+            std::string_view name;
+            uint64_t invocations;
+            uint64_t total_ns;
+            uint64_t max_ns;
+        };
+        std::vector<Row> rows{};
+        rows.reserve(table->entries_.size());
+        uint64_t table_total_ns = 0;
+        for (const auto& [name, entry] : table->entries_) {
+            const Row row{
+                .name = name,
+                .invocations =
+                    entry.invocations.load(std::memory_order_relaxed),
+                .total_ns = entry.total_ns.load(std::memory_order_relaxed),
+                .max_ns = entry.max_ns.load(std::memory_order_relaxed)};
+            if (row.invocations == 0) {
+                continue;
+            }
+
+            table_total_ns += row.total_ns;
+            rows.push_back(row);
+        }
+        if (rows.empty()) {
+            continue;
+        }
+
+        std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+            return a.total_ns > b.total_ns;
+        });
+
+        logger.log("  " + table->description_ + ":");
+        for (const Row& row : rows) {
+            const uint64_t percentage =
+                table_total_ns > 0 ? (row.total_ns * 100) / table_total_ns
+                                   : 0;
+            logger.log("    " + std::string(row.name) + ": " +
+                       std::to_string(percentage) + "%, n=" +
+                       std::to_string(row.invocations) + ", total " +
+                       std::to_string(row.total_ns / 1'000) + " us, mean " +
+                       std::to_string(row.total_ns /
+                                      (row.invocations * 1'000)) +
+                       " us, max " + std::to_string(row.max_ns / 1'000) +
+                       " us");
+        }
+    }
+}
+
+/**
+ * All registered message traffic entry blocks, for
+ * `MessageTrafficTable::log_all()`. The entries are function local statics in
+ * `message_traffic_entry()`, so blocks are only ever added and never removed.
+ */
+static std::mutex traffic_entries_mutex{};
+static std::vector<std::pair<const MessageTrafficTable::Entry*, size_t>>
+    traffic_entries{};
+
+void MessageTrafficTable::register_entries(const Entry* entries,
+                                           size_t num_entries) {
+    std::lock_guard lock(traffic_entries_mutex);
+    traffic_entries.emplace_back(entries, num_entries);
+}
+
+void MessageTrafficTable::log_all(Logger& logger) {
+    std::lock_guard lock(traffic_entries_mutex);
+
+    // Snapshotted so the rows can be sorted by total bytes. Concurrent
+    // `record()` calls can slightly skew a row here, but for diagnostics
+    // output a snapshot that's off by a message or two doesn't matter.
+    struct Row {
+        std::string_view name;
+        uint64_t messages;
+        uint64_t bytes;
+    };
+    std::vector<Row> rows{};
+    for (const auto& [entries, num_entries] : traffic_entries) {
+        for (size_t i = 0; i < num_entries; i++) {
+            const Row row{
+                .name = entries[i].name,
+                .messages = entries[i].messages.load(std::memory_order_relaxed),
+                .bytes = entries[i].bytes.load(std::memory_order_relaxed)};
+            if (row.messages == 0) {
+                continue;
+            }
+
+            rows.push_back(row);
+        }
+    }
+    if (rows.empty()) {
+        return;
+    }
+
+    std::sort(rows.begin(), rows.end(),
+              [](const Row& a, const Row& b) { return a.bytes > b.bytes; });
+
+    logger.log("Serialized bytes written per message type:");
+    for (const Row& row : rows) {
+        logger.log("  " + std::string(row.name) +
+                   ": n=" + std::to_string(row.messages) + ", " +
+                   std::to_string(row.bytes) + " bytes");
+    }
+}
+
+/**
+ * The effective buffer sizes per socket endpoint, for
+ * `SocketBufferSizeTable::log_all()`. Keyed by the endpoint's filename so the
+ * pooled secondary sockets on an endpoint share a single entry. Entries are
+ * never removed: in a group host the endpoint names of unloaded plugins keep
+ * their last recorded sizes, which is also the most useful thing to show.
+ */
+static std::mutex socket_buffer_sizes_mutex{};
+static std::map<std::string, std::pair<int, int>> socket_buffer_sizes{};
+
+void SocketBufferSizeTable::record(const std::string& description,
+                                   int send_size,
+                                   int receive_size) {
+    std::lock_guard lock(socket_buffer_sizes_mutex);
+    socket_buffer_sizes[description] = std::pair(send_size, receive_size);
+}
+
+void SocketBufferSizeTable::log_all(Logger& logger) {
+    std::lock_guard lock(socket_buffer_sizes_mutex);
+    if (socket_buffer_sizes.empty()) {
+        return;
+    }
+
+    logger.log("Effective kernel socket buffer sizes per endpoint:");
+    for (const auto& [description, sizes] : socket_buffer_sizes) {
+        logger.log("  " + description +
+                   ": SO_SNDBUF=" + std::to_string(sizes.first) +
+                   ", SO_RCVBUF=" + std::to_string(sizes.second));
+    }
+}
+
 ghc::filesystem::path generate_endpoint_base(const std::string& plugin_name) {
     fs::path temp_directory = get_temporary_directory();
 
@@ -16,8 +16,18 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <string_view>
 #include <variant>
 
 #include <bitsery/adapter/buffer.h>
@@ -28,14 +38,22 @@
 #include "../wine-host/use-linux-asio.h"
 #endif
 #include <llvm/small-vector.h>
+#include <asio/error.hpp>
+#include <asio/executor_work_guard.hpp>
 #include <asio/io_context.hpp>
 #include <asio/local/stream_protocol.hpp>
+#include <asio/post.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 #include <ghc/filesystem.hpp>
 
+#include "../bitsery/ext/borrowed-string.h"
+#include "../bitsery/ext/gathered-vector.h"
 #include "../bitsery/traits/small-vector.h"
+#include "../capacity-profile.h"
 #include "../logging/common.h"
+#include "../logging/message-record.h"
+#include "../tracepoints.h"
 #include "../utils.h"
 
 // Our input and output adapters for binary serialization always expect the data
@@ -80,6 +98,558 @@ using SerializationBuffer = llvm::SmallVector<uint8_t, N>;
  */
 using SerializationBufferBase = llvm::SmallVectorImpl<uint8_t>;
 
+/**
+ * Tracks the capacity of a long lived serialization buffer, and shrinks the
+ * buffer back when it has clearly grown past what's still needed. These
+ * buffers grow to fit the largest message ever sent over their socket and
+ * then hold on to that memory, so a single big preset load would otherwise
+ * leave every socket pinning megabytes for the rest of the session. Monitors
+ * register themselves in a global registry, so the current capacities and
+ * high-water marks of all live buffers can be dumped to the log with
+ * `log_all()`.
+ */
+class SerializationBufferMonitor {
+   public:
+    /**
+     * The buffer capacity in bytes above which a buffer is eligible for
+     * shrinking. This is large enough that the buffers used for audio
+     * processing messages will normally never reach it.
+     */
+    static constexpr size_t shrink_threshold = 1 << 20;
+
+    /**
+     * The number of messages a buffer may stay above `shrink_threshold`
+     * before we reclaim the memory. If the buffer was grown by a one-off
+     * message like a preset load it will stay small afterwards, and if large
+     * messages are still being sent then the buffer simply grows back,
+     * costing a single allocation once every this many messages.
+     */
+    static constexpr size_t messages_until_shrink = 64;
+
+    /**
+     * @param description A description of the buffer this monitor tracks,
+     *   usually the socket endpoint's filename. Shown in `log_all()`.
+     */
+    SerializationBufferMonitor(std::string description);
+
+    /**
+     * Unregisters this monitor from the registry.
+     */
+    ~SerializationBufferMonitor() noexcept;
+
+    SerializationBufferMonitor(const SerializationBufferMonitor&) = delete;
+    SerializationBufferMonitor& operator=(const SerializationBufferMonitor&) =
+        delete;
+
+    /**
+     * Update the telemetry for a buffer, and shrink the buffer back to its
+     * initial capacity once it has spent `messages_until_shrink` consecutive
+     * messages above `shrink_threshold`. Should be called once per processed
+     * message, from the thread that owns the buffer.
+     */
+    template <size_t N>
+    void track(SerializationBuffer<N>& buffer) noexcept {
+        const size_t capacity = buffer.capacity();
+        if (capacity > high_water_mark_.load(std::memory_order_relaxed)) {
+            high_water_mark_.store(capacity, std::memory_order_relaxed);
+        }
+
+        if (capacity <= shrink_threshold) {
+            messages_above_threshold_ = 0;
+        } else if (++messages_above_threshold_ >= messages_until_shrink) {
+            // NOTE: There's no `.shrink_to_fit()` implementation for
+            //       `llvm::SmallVector`, so we'll just reinitialize the
+            //       buffer since we don't need the old data
+            buffer = SerializationBuffer<N>{};
+            messages_above_threshold_ = 0;
+        }
+
+        current_capacity_.store(buffer.capacity(), std::memory_order_relaxed);
+    }
+
+    /**
+     * Write the descriptions, current capacities and high-water marks of all
+     * live serialization buffers to the log. Called through
+     * `Sockets::log_telemetry()` when the verbosity is set to `all_events`,
+     * so running with full debug logging shows where session memory went when
+     * a plugin gets unloaded.
+     */
+    static void log_all(Logger& logger);
+
+   private:
+    const std::string description_;
+
+    /**
+     * The number of consecutive messages the buffer's capacity has spent
+     * above `shrink_threshold`. Only accessed from the owning thread.
+     */
+    size_t messages_above_threshold_ = 0;
+
+    // These are atomic because `log_all()` reads them from another thread
+    std::atomic_size_t high_water_mark_ = 0;
+    std::atomic_size_t current_capacity_ = 0;
+};
+
+/**
+ * A process wide pool of serialization buffers for the control message paths.
+ * Every receive loop and every blocking control round trip used to own a
+ * buffer that grew to fit that socket's largest historical message, so a
+ * single plugin instance could pin half a dozen buffers each sized for a
+ * different one-off message. With the pool a buffer is checked out per
+ * message and returned after the round trip, so the buffers rotate between
+ * sockets and a buffer grown by one large message (like a preset load) is
+ * reused for the next large message no matter which socket that arrives on.
+ * The audio threads keep using their own persistent thread local buffers,
+ * since those need to stay allocation free and are never contended.
+ *
+ * The freelist is guarded by a mutex, just like the secondary socket and
+ * request object pools. These paths all end in a blocking syscall, so a
+ * fancier lock-free list wouldn't buy anything.
+ */
+class SerializationBufferPool {
+   public:
+    /**
+     * A buffer handed out by `checkout()`. Returns the buffer to the pool
+     * when it goes out of scope.
+     */
+    class Checkout {
+       public:
+        explicit Checkout(
+            std::unique_ptr<SerializationBuffer<256>> buffer) noexcept
+            : buffer_(std::move(buffer)) {}
+
+        ~Checkout() noexcept {
+            if (buffer_) {
+                instance().release(std::move(buffer_));
+            }
+        }
+
+        Checkout(const Checkout&) = delete;
+        Checkout& operator=(const Checkout&) = delete;
+
+        Checkout(Checkout&&) noexcept = default;
+        Checkout& operator=(Checkout&&) noexcept = default;
+
+        SerializationBufferBase& operator*() noexcept { return *buffer_; }
+
+       private:
+        std::unique_ptr<SerializationBuffer<256>> buffer_;
+    };
+
+    /**
+     * Fetch the process wide pool, creating it on first use. Like
+     * `AdHocAcceptorContext` this lives for the remainder of the process.
+     */
+    static SerializationBufferPool& instance();
+
+    /**
+     * Check out a buffer for a single message round trip, reusing a pooled
+     * buffer when one is available.
+     */
+    Checkout checkout();
+
+   private:
+    SerializationBufferPool() noexcept = default;
+
+    /**
+     * Called from `Checkout`'s destructor. Updates the capacity telemetry so
+     * ballooned buffers are shrunk again, and returns the buffer to the
+     * freelist unless the pool is already full.
+     */
+    void release(std::unique_ptr<SerializationBuffer<256>> buffer) noexcept;
+
+    /**
+     * The maximum number of idle buffers kept around. Buffers released while
+     * the pool is full are simply freed. The inline capacity of `buffers_`
+     * matches this so releasing a buffer never has to allocate.
+     */
+    static constexpr size_t max_idle_buffers = 16;
+
+    /**
+     * Tracks capacity telemetry and shrinking for all pooled buffers
+     * together, since the buffers no longer have a fixed owner.
+     */
+    SerializationBufferMonitor monitor_{"(buffer pool)"};
+
+    std::mutex mutex_;
+    llvm::SmallVector<std::unique_ptr<SerializationBuffer<256>>,
+                      max_idle_buffers>
+        buffers_;
+};
+
+/**
+ * Tracks the round-trip durations of the messages sent over a socket in a
+ * log-linear histogram, HDR-histogram style. Values are bucketed by their
+ * position of the highest set bit with sixteen linear sub-buckets per power
+ * of two, so the relative error stays around 6% regardless of whether a call
+ * took twenty microseconds or twenty milliseconds while the whole histogram
+ * is just a fixed-size array of counters. Recording a value is two relaxed
+ * atomic operations and can safely be done from the audio threads.
+ *
+ * Like `SerializationBufferMonitor`, histograms register themselves in a
+ * global registry so the latency distributions of all message types can be
+ * dumped to the log with `log_all()`.
+ */
+class RoundTripLatencyHistogram {
+   public:
+    /**
+     * The number of linear sub-buckets per power of two. Sixteen sub-buckets
+     * bound the quantization error at 1/16th of the recorded value.
+     */
+    static constexpr size_t sub_bucket_count = 16;
+
+    /**
+     * The number of power-of-two major buckets. Thirty major buckets cover
+     * durations up to a couple of hours in microseconds, and anything longer
+     * than that is clamped into the last bucket.
+     */
+    static constexpr size_t major_bucket_count = 30;
+
+    /**
+     * @param description A description of the messages this histogram tracks,
+     *   usually the socket endpoint's filename followed by the message type's
+     *   name. Shown in `log_all()`.
+     */
+    RoundTripLatencyHistogram(std::string description);
+
+    /**
+     * Unregisters this histogram from the registry.
+     */
+    ~RoundTripLatencyHistogram() noexcept;
+
+    RoundTripLatencyHistogram(const RoundTripLatencyHistogram&) = delete;
+    RoundTripLatencyHistogram& operator=(const RoundTripLatencyHistogram&) =
+        delete;
+
+    /**
+     * Record a single round-trip duration in microseconds.
+     */
+    void record(uint64_t duration_us) noexcept {
+        counts_[bucket_index(duration_us)].fetch_add(
+            1, std::memory_order_relaxed);
+
+        uint64_t current_max = max_us_.load(std::memory_order_relaxed);
+        while (duration_us > current_max &&
+               !max_us_.compare_exchange_weak(current_max, duration_us,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Write the p50/p95/p99/max round-trip durations of all live histograms
+     * to the log. Called through `Sockets::log_telemetry()` when the
+     * verbosity is set to `all_events`, next to the serialization buffer
+     * telemetry, so running with full debug logging prints the latency
+     * distributions when a plugin gets unloaded.
+     */
+    static void log_all(Logger& logger);
+
+   private:
+    /**
+     * The index of the bucket a duration is counted in.
+     */
+    static size_t bucket_index(uint64_t duration_us) noexcept {
+        if (duration_us < sub_bucket_count) {
+            // The first major bucket stores values below sixteen exactly
+            return duration_us;
+        }
+
+        const size_t shift = std::bit_width(duration_us) - 5;
+        const size_t major = shift + 1;
+        if (major >= major_bucket_count) {
+            return (major_bucket_count * sub_bucket_count) - 1;
+        }
+
+        return (major * sub_bucket_count) +
+               ((duration_us >> shift) - sub_bucket_count);
+    }
+
+    /**
+     * The smallest duration counted in a bucket, used when reporting
+     * percentiles.
+     */
+    static uint64_t bucket_lower_bound(size_t index) noexcept {
+        const size_t major = index / sub_bucket_count;
+        const size_t sub = index % sub_bucket_count;
+        if (major == 0) {
+            return sub;
+        }
+
+        return static_cast<uint64_t>(sub_bucket_count + sub) << (major - 1);
+    }
+
+    const std::string description_;
+
+    /**
+     * The bucketed counts. These are atomic because round trips on different
+     * sockets of the same handler can finish concurrently, and because
+     * `log_all()` reads them from another thread.
+     */
+    std::array<std::atomic_uint64_t, major_bucket_count * sub_bucket_count>
+        counts_{};
+
+    /**
+     * The largest duration ever recorded. Tracked separately since the last
+     * buckets are too coarse to report a meaningful maximum from.
+     */
+    std::atomic_uint64_t max_us_ = 0;
+};
+
+/**
+ * Accumulates the time spent inside the message handlers, tallied per VST2
+ * opcode or per interface method. Where `RoundTripLatencyHistogram` measures
+ * a call's full round trip on the sending side, these tables measure just the
+ * handler's portion of it on the receiving side - on the Wine side that's
+ * effectively the time spent inside the plugin - so the two together show how
+ * the time divides between the plugin and the bridging overhead. The summary
+ * dumped through `log_all()` answers "where did the time go" like `strace -c`
+ * does for syscalls, without needing an external profiler that would have to
+ * reach across the Wine boundary.
+ *
+ * Like the other telemetry in this file, tables register themselves in a
+ * global registry so all of them can be dumped to the log with `log_all()`.
+ */
+class DispatchTimingTable {
+   public:
+    /**
+     * The cumulative tally for a single opcode or method. Recording a
+     * duration is a handful of relaxed atomic operations, so this can safely
+     * be done from the audio threads.
+     */
+    struct Entry {
+        std::atomic_uint64_t invocations{};
+        std::atomic_uint64_t total_ns{};
+        std::atomic_uint64_t max_ns{};
+
+        /**
+         * Add a single handler invocation to the tally.
+         */
+        void record(uint64_t duration_ns) noexcept {
+            invocations.fetch_add(1, std::memory_order_relaxed);
+            total_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+
+            uint64_t current_max = max_ns.load(std::memory_order_relaxed);
+            while (duration_ns > current_max &&
+                   !max_ns.compare_exchange_weak(current_max, duration_ns,
+                                                 std::memory_order_relaxed)) {
+            }
+        }
+    };
+
+    /**
+     * @param description A description of the handlers this table covers,
+     *   usually the socket endpoint's filename. Shown in `log_all()`.
+     */
+    DispatchTimingTable(std::string description);
+
+    /**
+     * Unregisters this table from the registry.
+     */
+    ~DispatchTimingTable() noexcept;
+
+    DispatchTimingTable(const DispatchTimingTable&) = delete;
+    DispatchTimingTable& operator=(const DispatchTimingTable&) = delete;
+
+    /**
+     * Get the entry for an opcode or method name, creating it the first time
+     * the name is seen. The returned reference stays valid for this table's
+     * lifetime since the map's nodes are stable, so callers that already key
+     * their calls by something cheaper than a name (like a VST2 opcode) can
+     * cache it.
+     */
+    Entry& entry(std::string_view name);
+
+    /**
+     * Write the per-opcode invocation counts and cumulative, mean and
+     * maximum durations of all live tables to the log, with the rows sorted
+     * by cumulative duration. Called through `Sockets::log_telemetry()` when
+     * the verbosity is set to `all_events`, next to the other telemetry.
+     */
+    static void log_all(Logger& logger);
+
+   private:
+    const std::string description_;
+
+    /**
+     * The tallies, keyed by opcode or method name. A `std::map` is used
+     * because its nodes are stable, so the references handed out by
+     * `entry()` stay valid while new names get added. The transparent
+     * comparator allows lookups with the `std::string_view`s produced by
+     * `type_name()` without allocating.
+     */
+    std::map<std::string, Entry, std::less<>> entries_;
+    std::mutex entries_mutex_;
+};
+
+/**
+ * Counts the messages and serialized bytes written to the sockets, tallied
+ * per message type. Where the other telemetry in this file measures time and
+ * memory, this table measures wire traffic: which message types actually
+ * dominate a session's socket usage, so serialization work can be ranked by
+ * real traffic instead of guesses. Each side tallies the messages it writes,
+ * so a side's dump covers both the requests it sent and the responses it
+ * returned. Unlike the other telemetry the accounting itself is always on -
+ * recording a message is two relaxed atomic additions on counters that exist
+ * per message type, see `message_traffic_entry()` - and the totals are dumped
+ * through `Sockets::log_telemetry()` next to the other telemetry so users can
+ * attach them to performance reports.
+ */
+class MessageTrafficTable {
+   public:
+    /**
+     * The cumulative tally for a single message type.
+     */
+    struct Entry {
+        std::string_view name;
+        std::atomic_uint64_t messages{};
+        std::atomic_uint64_t bytes{};
+
+        /**
+         * Add a single written message to the tally.
+         */
+        void record(uint64_t num_bytes) noexcept {
+            messages.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(num_bytes, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Register a block of entries so `log_all()` can find them. The entries
+     * are the function local statics in `message_traffic_entry()`, so they
+     * have static storage duration and never need to be unregistered.
+     */
+    static void register_entries(const Entry* entries, size_t num_entries);
+
+    /**
+     * Write the per-message-type message counts and byte totals to the log,
+     * with the rows sorted by total bytes. Called through
+     * `Sockets::log_telemetry()` when the verbosity is set to `all_events`,
+     * next to the other telemetry.
+     */
+    static void log_all(Logger& logger);
+};
+
+/**
+ * The traffic entry `write_object()` records into for the `Request<T>`
+ * variants, tallied per variant alternative. The entries live in a static
+ * array indexed by the variant index, so after the first message of a type
+ * the lookup is free of locks and name comparisons and can be done from the
+ * audio threads.
+ */
+template <typename... Ts>
+MessageTrafficTable::Entry& message_traffic_entry(
+    const std::variant<Ts...>& object) {
+    static std::array<MessageTrafficTable::Entry, sizeof...(Ts)> entries{
+        MessageTrafficTable::Entry{type_name<Ts>()}...};
+    [[maybe_unused]] static const bool registered =
+        (MessageTrafficTable::register_entries(entries.data(), sizeof...(Ts)),
+         true);
+
+    return entries[object.index()];
+}
+
+/**
+ * The same, but for all other message types. Composite request types that
+ * wrap their variant in a struct (like `Vst3AudioProcessorRequest`) are
+ * unwrapped through their `get_request_variant()` overload so their tally is
+ * also kept per alternative, and everything else, including all response
+ * types, gets a single entry per type.
+ *
+ * @overload
+ */
+template <typename T>
+MessageTrafficTable::Entry& message_traffic_entry(const T& object) {
+    if constexpr (requires { get_request_variant(object); }) {
+        return message_traffic_entry(get_request_variant(object));
+    } else {
+        static MessageTrafficTable::Entry entry{type_name<T>()};
+        [[maybe_unused]] static const bool registered =
+            (MessageTrafficTable::register_entries(&entry, 1), true);
+
+        return entry;
+    }
+}
+
+/**
+ * The effective kernel buffer sizes of every connected socket, keyed by the
+ * socket endpoint's filename. The sizes requested through
+ * `SocketBufferConfig` get clamped by the kernel against its configured
+ * minimum and the `wmem_max`/`rmem_max` limits, so the table dumped through
+ * `Sockets::log_telemetry()` shows what the kernel actually granted rather
+ * than what was asked for.
+ */
+class SocketBufferSizeTable {
+   public:
+    /**
+     * Record the buffer sizes read back from a socket after its
+     * `SocketBufferConfig` was applied. Sockets on the same endpoint (the
+     * pooled secondary sockets) share a single row, since they always get
+     * the same configuration.
+     */
+    static void record(const std::string& description,
+                       int send_size,
+                       int receive_size);
+
+    /**
+     * Write the effective buffer sizes of all connected sockets to the log.
+     * Called through `Sockets::log_telemetry()` when the verbosity is set to
+     * `all_events`, next to the other telemetry.
+     */
+    static void log_all(Logger& logger);
+};
+
+/**
+ * Counts heap allocations made while servicing audio thread messages, to
+ * catch allocation regressions in the serialization code before a release.
+ * This is only compiled in when the `alloc-tracking` build option is enabled,
+ * in which case the global `operator new` and `operator delete` are replaced
+ * with counting versions in `common.cpp`. Without that option everything here
+ * compiles down to nothing, so the call sites don't need to be guarded.
+ *
+ * Usage mirrors the other telemetry in this file: the message handlers in
+ * `TypedMessageHandler::receive_messages()` open a `Scope` with the message
+ * type's name around every message handled on an audio thread, and the
+ * per-message-type totals are dumped through `Sockets::log_telemetry()` when
+ * a plugin gets unloaded. The backtrace of the first allocation seen for a
+ * message type is also recorded, so a regression comes with a pointer to the
+ * offending code instead of just a number.
+ */
+class AllocationTracker {
+   public:
+    /**
+     * Attributes all allocations made on this thread between construction and
+     * destruction to `description`. The string view must point to storage
+     * that outlives the process since it's used as a registry key after the
+     * scope ends; the static strings produced by `type_name()` satisfy this.
+     * These scopes must not be nested.
+     */
+    class Scope {
+       public:
+#ifdef WITH_ALLOC_TRACKING
+        Scope(std::string_view description) noexcept;
+        ~Scope() noexcept;
+#else
+        Scope(std::string_view) noexcept {}
+#endif
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+#ifdef WITH_ALLOC_TRACKING
+       private:
+        std::string_view description_;
+#endif
+    };
+
+    /**
+     * Write the per-message-type allocation totals to the log. Called through
+     * `Sockets::log_telemetry()` when the verbosity is set to `all_events`,
+     * next to the other telemetry. A no-op without the `alloc-tracking` build
+     * option.
+     */
+    static void log_all(Logger& logger);
+};
+
 namespace asio {
 
 // These are copied verbatim `asio::buffer(std::vector<PodType, Allocator>&,
@@ -117,6 +687,90 @@ ASIO_NODISCARD inline mutable_buffer buffer(
 
 }  // namespace asio
 
+/**
+ * Serialized messages of at least this many bytes are LZ4 compressed before
+ * they're written to the socket when yabridge was built with `-Dlz4=true`.
+ * State chunks and preset name tables tend to compress very well, so this cuts
+ * the transfer time for things like DAW autosaves roughly in proportion to the
+ * achieved compression ratio. Messages below this size aren't worth the
+ * compressor round trip and are always sent as is.
+ */
+constexpr size_t compression_threshold = 64 * 1024;
+
+/**
+ * The top bit of the message size header written by `write_object()`. When
+ * set, the payload is an LZ4 block prefixed with the uncompressed message size
+ * as another `uint64_t`, and the rest of the header contains the compressed
+ * size. Both sides of a bridge are always built from the same yabridge
+ * version, so whether compression can be used is already settled at compile
+ * time and no runtime negotiation is needed. Messages below
+ * `compression_threshold` and messages on the audio lanes never have this bit
+ * set.
+ */
+constexpr uint64_t compressed_message_flag = 1ull << 63;
+
+#ifdef WITH_LZ4
+/**
+ * The thread local scratch buffer used for compressing and decompressing
+ * messages. Like the serialization buffers themselves this grows to fit the
+ * largest message handled on the thread, so after warmup (de)compression
+ * doesn't allocate.
+ */
+SerializationBufferBase& compression_scratch_buffer();
+
+/**
+ * Compress the first `size` bytes of `buffer` into an LZ4 block written to
+ * `compressed`, prefixed with the uncompressed size as a `uint64_t`.
+ *
+ * @return The total number of bytes written to `compressed`, or a nullopt when
+ *   the data did not actually get smaller. Incompressible data should be sent
+ *   as is since compressing it would only add work on both sides.
+ */
+std::optional<size_t> compress_message(const SerializationBufferBase& buffer,
+                                       size_t size,
+                                       SerializationBufferBase& compressed);
+
+/**
+ * The inverse of `compress_message()`. Decompresses the `size` byte payload at
+ * the start of `buffer` into `decompressed`.
+ *
+ * @return The uncompressed message size.
+ *
+ * @throw std::runtime_error When the compressed data is malformed.
+ */
+size_t decompress_message(const SerializationBufferBase& buffer,
+                          size_t size,
+                          SerializationBufferBase& decompressed);
+#endif  // WITH_LZ4
+
+/**
+ * The thread local scratch buffer `write_object()` splices gathered messages
+ * into when it does need the payload as a single contiguous block after all,
+ * for message recording and compression. This is separate from
+ * `compression_scratch_buffer()` because compression reads from one buffer
+ * while writing to the other.
+ */
+SerializationBufferBase& gather_splice_buffer();
+
+/**
+ * Rebuild the contiguous payload of a message whose `GatheredVector` fields
+ * were skipped during serialization, by interleaving the serialization
+ * buffer's contents with the gathered segments in stream order.
+ *
+ * @param buffer The serialization buffer.
+ * @param serialized_size The number of bytes in `buffer`, which excludes the
+ *   gathered segments.
+ * @param segments The segments registered while serializing.
+ * @param spliced The buffer the full payload is spliced into.
+ *
+ * @return The total payload size written to `spliced`.
+ */
+size_t splice_gathered_message(
+    const SerializationBufferBase& buffer,
+    size_t serialized_size,
+    const llvm::SmallVectorImpl<bitsery::ext::GatheredSegment>& segments,
+    SerializationBufferBase& spliced);
+
 /**
  * Serialize an object using bitsery and write it to a socket. This will write
  * both the size of the serialized object and the object itself over the socket.
@@ -125,6 +779,10 @@ ASIO_NODISCARD inline mutable_buffer buffer(
  * @param object The object to write to the stream.
  * @param buffer The buffer to write to. This is useful for sending audio and
  *   chunk data since that can vary in size by a lot.
+ * @param allow_compression Whether large messages may be LZ4 compressed in
+ *   builds with compression support. The audio lanes pass `false` here:
+ *   they're latency bound rather than throughput bound, and their messages
+ *   should stay small enough to never hit the size threshold anyways.
  *
  * @warning This operation is not atomic, and calling this function with the
  *   same socket from multiple threads at once will cause issues with the
@@ -135,22 +793,119 @@ ASIO_NODISCARD inline mutable_buffer buffer(
 template <typename T, typename Socket>
 inline void write_object(Socket& socket,
                          const T& object,
-                         SerializationBufferBase& buffer) {
-    const size_t size =
+                         SerializationBufferBase& buffer,
+                         [[maybe_unused]] bool allow_compression = true) {
+    // Large `GatheredVector` fields (state chunks, binary attributes) are not
+    // copied into the serialization buffer. They only register where in the
+    // byte stream their bytes belong, and those spans are then passed to the
+    // kernel as extra entries of the gathered write below.
+    const bitsery::ext::GatherScope gather_scope{};
+    const size_t serialized_size =
         bitsery::quickSerialization<OutputAdapter<SerializationBufferBase>>(
             buffer, object);
+    const auto& gather_segments = gather_scope.segments();
+
+    size_t size = serialized_size;
+    for (const auto& segment : gather_segments) {
+        size += segment.size;
+    }
+
+    // Always-on traffic accounting, so the telemetry dump can rank message
+    // types by how many bytes they actually put on the wire. The serialized
+    // size is recorded before compression, since the point is to rank
+    // serialization targets.
+    message_traffic_entry(object).record(size);
+
+    // Message recording and compression both need the payload as a single
+    // contiguous block, so when either applies to a gathered message the
+    // segments are spliced back in first and the message is handled as if
+    // they never existed. Neither path gets slower than before: the splice
+    // replaces the copy serialization itself used to perform.
+    const SerializationBufferBase* contiguous = &buffer;
+    if (!gather_segments.empty() &&
+        (message_recording_active()
+#ifdef WITH_LZ4
+         || (allow_compression && size >= compression_threshold)
+#endif
+             )) {
+        SerializationBufferBase& spliced = gather_splice_buffer();
+        splice_gathered_message(buffer, serialized_size, gather_segments,
+                                spliced);
+        contiguous = &spliced;
+    }
+    const bool is_contiguous =
+        gather_segments.empty() || contiguous != &buffer;
+
+    // With `YABRIDGE_MESSAGE_RECORD_FILE` set, the serialized payload is
+    // appended to the recording file so the session can later be played back
+    // with `yabridge-replay`. A single branch otherwise. We always record the
+    // uncompressed payload so recordings don't depend on build options. A
+    // message that is still gathered at this point cannot be recorded, but in
+    // that case recording is known to be inactive.
+    if (is_contiguous) {
+        record_message(MessageRecordDirection::sent, socket.native_handle(),
+                       contiguous->data(), size);
+    }
 
     // Tell the other side how large the object is so it can prepare a buffer
-    // large enough before sending the data
+    // large enough before sending the data. The size header and the payload
+    // are written with a single gathered write, so the entire message only
+    // costs one syscall and the receiving side only gets woken up once.
     // NOTE: We're writing these sizes as a 64 bit integers, **not** as pointer
     //       sized integers. This is to provide compatibility with the 32-bit
     //       bit bridge. This won't make any function difference aside from the
     //       32-bit host application having to convert between 64 and 32 bit
     //       integers.
-    asio::write(socket, asio::buffer(std::array<uint64_t, 1>{size}));
-    const size_t bytes_written =
-        asio::write(socket, asio::buffer(buffer, size));
-    assert(bytes_written == size);
+    std::array<uint64_t, 1> message_length{size};
+    if (is_contiguous) {
+        const uint8_t* payload = contiguous->data();
+        size_t payload_size = size;
+#ifdef WITH_LZ4
+        if (allow_compression && size >= compression_threshold) {
+            SerializationBufferBase& compressed = compression_scratch_buffer();
+            if (const std::optional<size_t> compressed_size =
+                    compress_message(*contiguous, size, compressed)) {
+                message_length[0] = *compressed_size | compressed_message_flag;
+                payload = compressed.data();
+                payload_size = *compressed_size;
+            }
+        }
+#endif
+        const size_t bytes_written = asio::write(
+            socket, std::array<asio::const_buffer, 2>{
+                        asio::buffer(message_length),
+                        asio::buffer(payload, payload_size)});
+        assert(bytes_written == sizeof(message_length) + payload_size);
+
+        YABRIDGE_PROBE2(message_sent, socket.native_handle(), payload_size);
+    } else {
+        // The gathered spans are sent straight from the message object. The
+        // buffer chain interleaves slices of the serialization buffer with
+        // the spans in stream order, so the kernel assembles the message and
+        // no userspace buffer ever holds the complete payload.
+        llvm::SmallVector<asio::const_buffer, 16> chain{};
+        chain.push_back(asio::buffer(message_length));
+
+        size_t read_pos = 0;
+        for (const auto& segment : gather_segments) {
+            if (segment.stream_offset > read_pos) {
+                chain.push_back(
+                    asio::const_buffer(buffer.data() + read_pos,
+                                       segment.stream_offset - read_pos));
+            }
+            chain.push_back(asio::const_buffer(segment.data, segment.size));
+            read_pos = segment.stream_offset;
+        }
+        if (read_pos < serialized_size) {
+            chain.push_back(asio::const_buffer(buffer.data() + read_pos,
+                                               serialized_size - read_pos));
+        }
+
+        const size_t bytes_written = asio::write(socket, chain);
+        assert(bytes_written == sizeof(message_length) + size);
+
+        YABRIDGE_PROBE2(message_sent, socket.native_handle(), size);
+    }
 }
 
 /**
@@ -188,18 +943,72 @@ inline T& read_object(Socket& socket,
                       SerializationBufferBase& buffer) {
     // See the note above on the use of `uint64_t` instead of `size_t`
     std::array<uint64_t, 1> message_length;
-    asio::read(socket, asio::buffer(message_length),
-               asio::transfer_exactly(sizeof(message_length)));
 
-    // Make sure the buffer is large enough
-    const size_t size = message_length[0];
-    buffer.resize(size);
+    // Since `write_object()` sends the size header and the payload with a
+    // single gathered write, a speculative scattered read into the existing
+    // buffer will normally return the header and the entire message with a
+    // single syscall. This cannot over-read into a subsequent message because
+    // all of our sockets use strict request-response framing, so there's never
+    // more than one unread inbound message on a socket. This is also why we
+    // don't need kernel provided message boundaries (i.e. `SOCK_SEQPACKET`):
+    // with at most one in-flight message per socket the size header already
+    // comes for free as part of the same syscall.
+    // NOTE: `resize_for_overwrite()` matters here. A regular `resize()` would
+    //       zero-fill the grown region, which is wasted work since the socket
+    //       read overwrites those bytes anyways.
+    buffer.resize_for_overwrite(buffer.capacity());
+    const size_t bytes_received = asio::read(
+        socket,
+        std::array<asio::mutable_buffer, 2>{asio::buffer(message_length),
+                                            asio::buffer(buffer)},
+        asio::transfer_at_least(sizeof(message_length)));
+
+    // Make sure the buffer is large enough. If the message didn't fit in the
+    // buffer in its entirety we'll read the remainder below. `asio::read/write`
+    // will handle all the packet splitting and merging for us, since local
+    // domain sockets have packet limits somewhere in the hundreds of kilobytes.
+    const bool is_compressed =
+        (message_length[0] & compressed_message_flag) != 0;
+    size_t size = message_length[0] & ~compressed_message_flag;
+    const size_t payload_received = bytes_received - sizeof(message_length);
+    assert(payload_received <= size);
+    if (buffer.size() < size) {
+        buffer.resize_for_overwrite(size);
+    }
+    if (payload_received < size) {
+        asio::read(socket,
+                   asio::mutable_buffer(buffer.data() + payload_received,
+                                        size - payload_received),
+                   asio::transfer_exactly(size - payload_received));
+    }
+
+    if (is_compressed) [[unlikely]] {
+#ifdef WITH_LZ4
+        // Decompressing into the scratch buffer and then swapping leaves the
+        // uncompressed message in `buffer` without an extra copy
+        SerializationBufferBase& decompressed = compression_scratch_buffer();
+        size = decompress_message(buffer, size, decompressed);
+        buffer.swap(decompressed);
+#else
+        // Both sides are built from the same source with the same options, so
+        // this can only happen when mixing incompatible builds
+        throw std::runtime_error(
+            "Received an LZ4 compressed message, but this yabridge build was "
+            "compiled without compression support");
+#endif
+    }
 
-    // `asio::read/write` will handle all the packet splitting and
-    // merging for us, since local domain sockets have packet limits somewhere
-    // in the hundreds of kilobytes
-    asio::read(socket, asio::buffer(buffer), asio::transfer_exactly(size));
+    // See the matching call in `write_object()`. Recording both directions
+    // means a recording made with the environment variable set for just one
+    // of the two processes still captures the full conversation.
+    record_message(MessageRecordDirection::received, socket.native_handle(),
+                   buffer.data(), size);
 
+    YABRIDGE_PROBE2(message_received, socket.native_handle(), size);
+
+    // Any `BorrowedString` fields in the object will alias this buffer
+    // instead of copying bytes out of it, see `bitsery::ext::BorrowedString`
+    const bitsery::ext::BorrowedBufferScope borrowed_scope(buffer.data());
     auto [_, success] =
         bitsery::quickDeserialization<InputAdapter<SerializationBufferBase>>(
             {buffer.begin(), size}, object);
@@ -284,7 +1093,19 @@ class Sockets {
      * @see Sockets::connect
      */
     Sockets(const ghc::filesystem::path& endpoint_base_dir)
-        : base_dir_(endpoint_base_dir) {}
+        : base_dir_(endpoint_base_dir) {
+        // The sockets themselves live in the abstract socket namespace these
+        // days so they don't need any endpoint files, but the directory still
+        // holds the verbosity control file. The socket handlers used to
+        // create this directory as a side effect of binding their endpoints.
+        ghc::filesystem::create_directories(base_dir_);
+
+        // The log verbosity of a running bridge can be changed by writing a
+        // new level to this file with `yabridgectl log-level`. Since this
+        // constructor runs on both the native and the Wine side with the
+        // same base directory, the level changes on both sides at once.
+        Logger::watch_verbosity_control_file(base_dir_ / "verbosity");
+    }
 
     /**
      * Shuts down and closes all sockets and then cleans up the directory
@@ -344,12 +1165,210 @@ class Sockets {
     virtual void close() = 0;
 
     /**
-     * The base directory for our socket endpoints. All `*_endpoint` variables
-     * below are files within this directory.
+     * The base directory for our socket endpoints. The sockets themselves are
+     * abstract namespace sockets whose names are derived from paths within
+     * this directory, so the directory only contains the verbosity control
+     * file these days.
+     *
+     * @see as_abstract_endpoint
      */
     const ghc::filesystem::path base_dir_;
+
+   protected:
+    /**
+     * With full debug logging enabled we'll dump the serialization buffer and
+     * round-trip latency telemetry when a plugin gets unloaded, to make it
+     * easy to see where session memory and bridging time went. This needs to
+     * be called at the start of the derived classes' destructors since the
+     * socket handlers owning this telemetry are members of those classes, and
+     * they would already have been destroyed by the time this base class'
+     * destructor runs.
+     */
+    void log_telemetry() noexcept {
+        try {
+            // With the `YABRIDGE_CAPACITY_PROFILE_FILE` environment variable
+            // set this merges the session's capacity high-water marks into
+            // the profile header, see `src/common/capacity-profile.h`. A
+            // no-op otherwise.
+            CapacityProfile::write_profile();
+
+            Logger logger = Logger::create_from_environment();
+            if (logger.verbosity() >= Logger::Verbosity::all_events) {
+                SerializationBufferMonitor::log_all(logger);
+                RoundTripLatencyHistogram::log_all(logger);
+                DispatchTimingTable::log_all(logger);
+                MessageTrafficTable::log_all(logger);
+                SocketBufferSizeTable::log_all(logger);
+                ThreadRegistry::instance().log_threads(logger);
+#ifdef WITH_ALLOC_TRACKING
+                AllocationTracker::log_all(logger);
+#endif
+            }
+        } catch (...) {
+            // Logging is best effort, especially during shutdown
+        }
+    }
+};
+
+/**
+ * Connect multiple socket handlers at the same time, using one thread per
+ * socket. Every socket pair has its own endpoint and thus its own
+ * accept/connect handshake, but doing those handshakes one by one still adds
+ * up when a plugin uses a handful of sockets. Connecting them all in parallel
+ * makes the total setup time the maximum of the individual handshakes instead
+ * of their sum. Exceptions thrown on the connecting threads are rethrown on
+ * the calling thread after all of them have finished.
+ *
+ * @tparam Thread The thread implementation to use. On the Linux side this
+ *   should be `std::jthread` and on the Wine side this should be
+ *   `Win32Thread`.
+ */
+template <typename Thread, typename... Ts>
+void connect_sockets_parallel(Ts&... sockets) {
+    std::mutex thrown_exception_mutex{};
+    std::exception_ptr thrown_exception = nullptr;
+
+    {
+        const std::array<Thread, sizeof...(Ts)> connect_threads{Thread([&]() {
+            try {
+                sockets.connect();
+            } catch (...) {
+                // The first failure is the interesting one, the other sockets
+                // will likely fail for the same reason
+                std::lock_guard lock(thrown_exception_mutex);
+                if (!thrown_exception) {
+                    thrown_exception = std::current_exception();
+                }
+            }
+        })...};
+    }
+
+    if (thrown_exception) {
+        std::rethrow_exception(thrown_exception);
+    }
+}
+
+/**
+ * Move a socket endpoint into the Linux abstract socket namespace by
+ * prefixing its name with a null byte. Abstract sockets don't exist on the
+ * filesystem, so setting one up involves no directory creation or `stat()`
+ * calls, and the kernel removes the name again as soon as the last socket
+ * bound to it is closed. That also means a crashed session can't leave stale
+ * endpoint files behind that a new instance would first have to clean up. The
+ * path-shaped name derived from the endpoint base directory is kept as-is
+ * since it's already unique per instance, and it keeps diagnostics readable.
+ *
+ * All per-instance sockets go through this. The group host's socket is the
+ * exception and remains a filesystem socket, since that's a long-lived,
+ * user-visible rendezvous point that other processes need to be able to
+ * discover.
+ */
+inline asio::local::stream_protocol::endpoint as_abstract_endpoint(
+    const asio::local::stream_protocol::endpoint& endpoint) {
+    std::string name = endpoint.path();
+    if (name.empty() || name[0] == '\0') {
+        return endpoint;
+    }
+
+    name.insert(name.begin(), '\0');
+    return asio::local::stream_protocol::endpoint(name);
+}
+
+/**
+ * The kernel socket buffer sizes (`SO_SNDBUF`/`SO_RCVBUF`) applied to a
+ * socket when it gets connected or accepted. The kernel's defaults are a
+ * poor fit in both directions: the latency-critical audio lanes only ever
+ * have a single small request-response pair in flight, so the default couple
+ * hundred kilobytes of kernel buffering can only mask backpressure, while a
+ * large control message doesn't fit the default at all and needs multiple
+ * sender-receiver wakeup cycles to drain. Every socket handler therefore
+ * takes one of the per-lane presets below, and the sizes the kernel actually
+ * granted are surfaced through `SocketBufferSizeTable`.
+ */
+struct SocketBufferConfig {
+    /**
+     * The requested `SO_SNDBUF` size in bytes, or zero to keep the kernel's
+     * default. The kernel doubles the requested value to account for its
+     * bookkeeping overhead and clamps it between its configured minimum and
+     * the `wmem_max` limit.
+     */
+    int send_size = 0;
+
+    /**
+     * The requested `SO_RCVBUF` size in bytes, or zero to keep the kernel's
+     * default. Doubled and clamped against `rmem_max` just like the send
+     * size.
+     */
+    int receive_size = 0;
+
+    /**
+     * The preset for the request-response control and callback lanes. These
+     * carry everything from empty function calls to entire preset chunks, so
+     * they get buffers large enough to hand a sizable serialized message to
+     * the kernel in one write instead of waking up the receiver once per
+     * buffer refill.
+     */
+    static constexpr SocketBufferConfig control() noexcept {
+        return SocketBufferConfig{.send_size = 1 << 20,
+                                  .receive_size = 1 << 20};
+    }
+
+    /**
+     * The preset for the latency-critical audio lanes. The audio buffers
+     * themselves travel through shared memory, so the messages on these
+     * sockets are small and strictly request-response. Small kernel buffers
+     * are all they need, and a blocked receiver then shows up as
+     * backpressure on the sender instead of as silently growing queues.
+     */
+    static constexpr SocketBufferConfig audio() noexcept {
+        return SocketBufferConfig{.send_size = 1 << 16,
+                                  .receive_size = 1 << 16};
+    }
 };
 
+/**
+ * Apply a `SocketBufferConfig` to a connected or accepted socket, and record
+ * the sizes the kernel actually granted in the `SocketBufferSizeTable`. This
+ * is called from the socket handlers for their primary sockets as well as
+ * for every secondary socket they connect or accept, since kernel buffer
+ * sizes are a per-socket property. Errors are ignored: the kernel clamps
+ * out-of-range values instead of rejecting them, and a socket that keeps its
+ * default sizes still works fine.
+ */
+inline void apply_socket_buffer_config(
+    asio::local::stream_protocol::socket& socket,
+    const SocketBufferConfig& config,
+    const asio::local::stream_protocol::endpoint& endpoint) noexcept {
+    std::error_code err;
+    if (config.send_size > 0) {
+        socket.set_option(asio::socket_base::send_buffer_size(config.send_size),
+                          err);
+    }
+    if (config.receive_size > 0) {
+        socket.set_option(
+            asio::socket_base::receive_buffer_size(config.receive_size), err);
+    }
+
+    asio::socket_base::send_buffer_size effective_send{};
+    asio::socket_base::receive_buffer_size effective_receive{};
+    socket.get_option(effective_send, err);
+    if (err) {
+        return;
+    }
+    socket.get_option(effective_receive, err);
+    if (err) {
+        return;
+    }
+
+    try {
+        SocketBufferSizeTable::record(
+            ghc::filesystem::path(endpoint.path()).filename().string(),
+            effective_send.value(), effective_receive.value());
+    } catch (const std::bad_alloc&) {
+        // Recording the effective sizes is diagnostics only
+    }
+}
+
 /**
  * A single, long-living socket
  */
@@ -364,17 +1383,21 @@ class SocketHandler {
      * @param listen If `true`, start listening on the sockets. Incoming
      *   connections will be accepted when `connect()` gets called. This should
      *   be set to `true` on the plugin side, and `false` on the Wine host side.
+     * @param buffer_config The kernel buffer sizes to apply to the socket at
+     *   connect time, usually one of the per-lane presets on
+     *   `SocketBufferConfig`.
      *
      * @see Sockets::connect
      */
     SocketHandler(asio::io_context& io_context,
                   asio::local::stream_protocol::endpoint endpoint,
-                  bool listen)
-        : endpoint_(endpoint), socket_(io_context) {
+                  bool listen,
+                  SocketBufferConfig buffer_config = {})
+        : endpoint_(as_abstract_endpoint(endpoint)),
+          buffer_config_(buffer_config),
+          socket_(io_context) {
         if (listen) {
-            ghc::filesystem::create_directories(
-                ghc::filesystem::path(endpoint.path()).parent_path());
-            acceptor_.emplace(io_context, endpoint);
+            acceptor_.emplace(io_context, endpoint_);
         }
     }
 
@@ -389,6 +1412,8 @@ class SocketHandler {
         } else {
             socket_.connect(endpoint_);
         }
+
+        apply_socket_buffer_config(socket_, buffer_config_, endpoint_);
     }
 
     /**
@@ -502,13 +1527,17 @@ class SocketHandler {
      */
     template <typename T, std::invocable<T&, SerializationBufferBase&> F>
     void receive_multi(F&& callback) {
-        SerializationBuffer<256> buffer{};
         T object;
         while (true) {
             try {
-                receive_single<T>(object, buffer);
-
-                callback(object, buffer);
+                // The buffer is checked out per message, so a buffer grown by
+                // one large message can serve all of the process' sockets
+                // instead of every receive loop growing its own
+                SerializationBufferPool::Checkout buffer =
+                    SerializationBufferPool::instance().checkout();
+
+                receive_single<T>(object, *buffer);
+                callback(object, *buffer);
             } catch (const std::system_error&) {
                 // This happens when the sockets got closed because the plugin
                 // is being shut down
@@ -519,6 +1548,12 @@ class SocketHandler {
 
    private:
     asio::local::stream_protocol::endpoint endpoint_;
+
+    /**
+     * The kernel buffer sizes applied to the socket in `connect()`.
+     */
+    const SocketBufferConfig buffer_config_;
+
     asio::local::stream_protocol::socket socket_;
 
     /**
@@ -528,6 +1563,73 @@ class SocketHandler {
     std::optional<asio::local::stream_protocol::acceptor> acceptor_;
 };
 
+/**
+ * The IO context and accompanying thread used by
+ * `AdHocSocketHandler::receive_multi()` to asynchronously accept secondary
+ * socket connections. Every receive loop used to create its own IO context and
+ * spawn a dedicated thread to run it. Since those loops exist per plugin
+ * instance (and for VST3 and CLAP per audio processor socket), a session with
+ * many bridged instances would spend dozens of threads doing nothing but
+ * waiting for secondary connections that rarely arrive. Accepting a connection
+ * involves no blocking work, so all of those acceptors can be serviced by this
+ * single process wide reactor instead. This halves the number of threads the
+ * Wine plugin host needs per VST3 plugin instance.
+ *
+ * The context is created lazily on first use and runs for the remainder of the
+ * process. This mirrors `SharedIoContext` on the native plugin side, except
+ * that socket endpoints never outlive the process so simple static storage
+ * suffices here.
+ *
+ * @tparam Thread The thread implementation to use. On the Linux side this
+ *   should be `std::jthread` and on the Wine side this should be
+ *   `Win32Thread`.
+ */
+template <typename Thread>
+class AdHocAcceptorContext {
+   public:
+    /**
+     * Fetch the shared IO context, starting the reactor thread if this is the
+     * first use.
+     */
+    static asio::io_context& get() {
+        static AdHocAcceptorContext instance{};
+        return instance.context_;
+    }
+
+   private:
+    AdHocAcceptorContext()
+        : work_guard_(context_.get_executor()), handler_([&]() {
+              const ThreadRegistry::Guard thread_guard =
+                  ThreadRegistry::instance().register_thread(
+                      "adhoc-acceptor");
+
+              // Accepting connections should not interfere with any
+              // (realtime) work
+              set_realtime_priority(false);
+
+              context_.run();
+          }) {}
+
+    ~AdHocAcceptorContext() noexcept {
+        work_guard_.reset();
+        context_.stop();
+    }
+
+    asio::io_context context_;
+
+    /**
+     * Keeps `context_.run()` from returning while there are no pending
+     * operations, since acceptors come and go with plugin instances.
+     */
+    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
+
+    /**
+     * The thread that runs `context_`. Declared last so the implicit join
+     * during destruction happens after the context has been stopped.
+     */
+    Thread handler_;
+};
+
 /**
  * There are situations where we can not know in advance how many sockets we
  * need. The main example of this are VST2 `dispatcher()` and `audioMaster()`
@@ -540,13 +1642,19 @@ class SocketHandler {
  *   way as every other `SocketHandler` socket. When we want to send data and
  *   the socket is primary socket is not currently being written to, we'll just
  *   use that. On the listening side we'll read from this in a loop.
- * - On the listening side we also have a second thread asynchronously listening
- *   for new connections on the socket endpoint. When the sending side wants to
- *   send data and the primary socket is in use, it will instantiate a new
- *   connection to same socket endpoint and it will send the data over that
- *   socket instead. On the listening side the new connection will be accepted,
- *   and a newly spawned thread will handle incoming connection just like it
- *   would for the primary socket.
+ * - On the listening side we also asynchronously listen for new connections on
+ *   the socket endpoint, using the process wide `AdHocAcceptorContext`
+ *   reactor shared between all sockets. When the sending side wants to
+ *   send data and the primary socket is in use, it will grab a connected
+ *   secondary socket from a pool, only establishing a new connection when the
+ *   pool is empty, and it will send the data over that socket instead. The
+ *   socket is returned to the pool afterwards so subsequent concurrent
+ *   requests don't have to pay any connection setup costs. On the listening
+ *   side every one of these connections is handled by its own worker thread
+ *   that stays parked in a blocking read between requests, just like the
+ *   thread handling the primary socket. The pool can also be pre-warmed with
+ *   the `spare_sockets` option so even the first concurrent request doesn't
+ *   have to establish a connection or spawn a thread.
  *
  * @tparam Thread The thread implementation to use. On the Linux side this
  *   should be `std::jthread` and on the Wine side this should be `Win32Thread`.
@@ -565,18 +1673,70 @@ class AdHocSocketHandler {
      * @param listen If `true`, start listening on the sockets. Incoming
      *   connections will be accepted when `connect()` gets called. This should
      *   be set to `true` on the plugin side, and `false` on the Wine host side.
+     * @param buffer_config The kernel buffer sizes to apply to the primary
+     *   socket and every secondary socket, usually one of the per-lane
+     *   presets on `SocketBufferConfig`.
      *
      * @see Sockets::connect
      */
     AdHocSocketHandler(asio::io_context& io_context,
                        asio::local::stream_protocol::endpoint endpoint,
-                       bool listen)
-        : io_context_(io_context), endpoint_(endpoint), socket_(io_context) {
+                       bool listen,
+                       SocketBufferConfig buffer_config = {})
+        : io_context_(io_context),
+          endpoint_(as_abstract_endpoint(endpoint)),
+          buffer_config_(buffer_config),
+          socket_(io_context) {
         if (listen) {
-            ghc::filesystem::create_directories(
-                ghc::filesystem::path(endpoint.path()).parent_path());
-            acceptor_.emplace(io_context, endpoint);
+            acceptor_.emplace(io_context, endpoint_);
+        }
+    }
+
+    /**
+     * The endpoint for the primary socket. Used by derived classes to
+     * describe this socket in diagnostics.
+     */
+    const asio::local::stream_protocol::endpoint& endpoint() const noexcept {
+        return endpoint_;
+    }
+
+    /**
+     * Get the round-trip latency histogram for a message type sent over this
+     * socket pair, creating it the first time the message type is seen. Used
+     * by subclasses to record per-message-type round-trip durations. The
+     * histogram's description is the endpoint's filename followed by the
+     * message type's name, matching `SerializationBufferMonitor`'s
+     * descriptions.
+     */
+    RoundTripLatencyHistogram& latency_histogram(
+        std::string_view message_type) {
+        std::lock_guard lock(latency_histograms_mutex_);
+        auto it = latency_histograms_.find(message_type);
+        if (it == latency_histograms_.end()) {
+            it = latency_histograms_
+                     .try_emplace(std::string(message_type),
+                                  ghc::filesystem::path(endpoint_.path())
+                                          .filename()
+                                          .string() +
+                                      " " + std::string(message_type))
+                     .first;
         }
+
+        return it->second;
+    }
+
+    /**
+     * Get the cumulative timing entry for a message type handled on this
+     * socket pair, creating it the first time the message type is seen. Used
+     * by subclasses on the receiving side to tally the time spent inside the
+     * message handlers, which on the Wine side is effectively the time spent
+     * inside the plugin.
+     *
+     * @see DispatchTimingTable
+     */
+    DispatchTimingTable::Entry& dispatch_timing_entry(
+        std::string_view message_type) {
+        return dispatch_timings_.entry(message_type);
     }
 
    public:
@@ -590,14 +1750,17 @@ class AdHocSocketHandler {
             acceptor_->accept(socket_);
 
             // As mentioned in `acceptor's` docstring, this acceptor will be
-            // recreated in `receive_multi()` on another context, and
-            // potentially on the other side of the connection in the case
-            // where we're handling `plugin_host_callback_` VST2 events
+            // recreated in `receive_multi()` on the shared acceptor context,
+            // and potentially on the other side of the connection in the case
+            // where we're handling `plugin_host_callback_` VST2 events.
+            // Closing it also releases the abstract socket name, so the new
+            // acceptor can bind to the same endpoint again.
             acceptor_.reset();
-            ghc::filesystem::remove(endpoint_.path());
         } else {
             socket_.connect(endpoint_);
         }
+
+        apply_socket_buffer_config(socket_, buffer_config_, endpoint_);
     }
 
     /**
@@ -611,6 +1774,18 @@ class AdHocSocketHandler {
                          err);
         socket_.close();
 
+        // Closing the pooled secondary sockets will also cause the worker
+        // threads parked on the other end of those connections to shut down
+        {
+            std::lock_guard pool_lock(socket_pool_mutex_);
+            for (auto& pooled_socket : socket_pool_) {
+                pooled_socket.shutdown(
+                    asio::local::stream_protocol::socket::shutdown_both, err);
+                pooled_socket.close(err);
+            }
+            socket_pool_.clear();
+        }
+
         while (currently_listening_) {
             // If another thread is currently calling `receive_multi()`, we'll
             // spinlock until that function has exited. We would otherwise get a
@@ -618,6 +1793,20 @@ class AdHocSocketHandler {
         }
     }
 
+    /**
+     * Set the number of spare secondary socket connections that should be kept
+     * around for concurrent requests, based on the `spare_sockets` option.
+     * These connections are established after the first event sent from this
+     * side has been processed, since only at that point we know for sure that
+     * the remote side is accepting secondary connections. Regardless of this
+     * setting, secondary sockets created on demand are always returned to the
+     * pool for reuse. This should only be called on the sending side of this
+     * socket pair.
+     */
+    void set_spare_sockets(uint32_t num_sockets) noexcept {
+        target_spare_sockets_ = num_sockets;
+    }
+
    protected:
     /**
      * Serialize and send an event over a socket. This is used for both the host
@@ -626,7 +1815,8 @@ class AdHocSocketHandler {
      * for details on the parameters and return value of this function.
      *
      * As described above, if this function is currently being called from
-     * another thread, then this will create a new socket connection and send
+     * another thread, then this will grab a connected secondary socket from
+     * the pool (or establish a new connection if the pool is empty) and send
      * the event there instead.
      *
      * @param callback A function that will be called with a reference to a
@@ -643,10 +1833,16 @@ class AdHocSocketHandler {
         constexpr bool returns_void = std::is_void_v<
             std::invoke_result_t<F, asio::local::stream_protocol::socket&>>;
 
-        // XXX: Maybe at some point we should benchmark how often this
-        //      ad hoc socket spawning mechanism gets used. If some hosts
-        //      for instance consistently and repeatedly trigger this then
-        //      we might be able to do some optimizations there.
+        // When a spare socket pool size has been configured we'll establish
+        // those connections the first time we know the remote side is
+        // accepting secondary connections, i.e. after it has processed at
+        // least one event sent from this side
+        if (target_spare_sockets_ > 0 && sent_first_event_ &&
+            !spare_sockets_prewarmed_.load(std::memory_order_relaxed))
+            [[unlikely]] {
+            prewarm_spare_sockets();
+        }
+
         std::unique_lock lock(write_mutex_, std::try_to_lock);
         if (lock.owns_lock()) {
             // This was used to always block when sending the first message,
@@ -663,11 +1859,22 @@ class AdHocSocketHandler {
             }
         } else {
             try {
-                asio::local::stream_protocol::socket secondary_socket(
-                    io_context_);
-                secondary_socket.connect(endpoint_);
+                asio::local::stream_protocol::socket secondary_socket =
+                    acquire_secondary_socket();
+
+                // The socket is returned to the pool afterwards so it can be
+                // reused for later concurrent requests. If the callback
+                // throws, then the socket is simply destroyed instead since it
+                // may be left with a partially written message.
+                if constexpr (returns_void) {
+                    callback(secondary_socket);
+                    release_secondary_socket(std::move(secondary_socket));
+                } else {
+                    auto result = callback(secondary_socket);
+                    release_secondary_socket(std::move(secondary_socket));
 
-                return callback(secondary_socket);
+                    return result;
+                }
             } catch (const std::system_error&) {
                 // So, what do we do when noone is listening on the endpoint
                 // yet? This can happen with plugin groups when the Wine
@@ -712,10 +1919,12 @@ class AdHocSocketHandler {
      * @param primary_callback A function that will do a single read cycle for
      *   the primary socket socket that should do a single read cycle. This is
      *   called in a loop so it shouldn't do any looping itself.
-     * @param secondary_callback A function that will be called when we receive
-     *   an incoming connection on a secondary socket. This would often do the
-     *   same thing as `primary_callback`, but secondary sockets may need some
-     *   different handling.
+     * @param secondary_callback A function that will do a single read cycle
+     *   for a secondary socket. Like `primary_callback` this is called in a
+     *   loop, since the sending side reuses secondary connections for
+     *   subsequent concurrent requests. This would often do the same thing as
+     *   `primary_callback`, but secondary sockets may need some different
+     *   handling.
      */
     template <std::invocable<asio::local::stream_protocol::socket&> F,
               std::invocable<asio::local::stream_protocol::socket&> G>
@@ -729,57 +1938,95 @@ class AdHocSocketHandler {
         currently_listening_ = true;
 
         // As described above we'll handle incoming requests for `socket` on
-        // this thread. We'll also listen for incoming connections on `endpoint`
-        // on another thread. For any incoming connection we'll spawn a new
-        // thread to handle the request. When `socket` closes and this loop
-        // breaks, the listener and any still active threads will be cleaned up
-        // before this function exits.
-        asio::io_context secondary_context{};
-
-        // The previous acceptor has already been shut down by
-        // `AdHocSocketHandler::connect()`
-        acceptor_.emplace(secondary_context, endpoint_);
-
-        // This works the exact same was as `active_plugins` and
-        // `next_plugin_id` in `GroupBridge`
-        std::unordered_map<size_t, Thread> active_secondary_requests{};
-        std::atomic_size_t next_request_id{};
-        std::mutex active_secondary_requests_mutex{};
-        accept_requests(
-            *acceptor_, logger,
-            [&](asio::local::stream_protocol::socket secondary_socket) {
-                const size_t request_id = next_request_id.fetch_add(1);
-
-                // We have to make sure to keep moving these sockets into the
-                // threads that will handle them
-                std::lock_guard lock(active_secondary_requests_mutex);
-                active_secondary_requests[request_id] = Thread(
-                    [&, request_id](
-                        asio::local::stream_protocol::socket secondary_socket) {
-                        secondary_callback(secondary_socket);
-
-                        // When we have processed this request, we'll join the
-                        // thread again with the thread that's handling
-                        // `secondary_context`
-                        asio::post(secondary_context, [&, request_id]() {
-                            std::lock_guard lock(
-                                active_secondary_requests_mutex);
-
-                            // The join is implicit because we're using
-                            // `std::jthread`/`Win32Thread`
-                            active_secondary_requests.erase(request_id);
-                        });
-                    },
-                    std::move(secondary_socket));
-            });
-
-        Thread secondary_requests_handler([&]() {
-            pthread_setname_np(pthread_self(), "adhoc-acceptor");
-
-            // Any secondary threads should not be realtime
-            set_realtime_priority(false);
-
-            secondary_context.run();
+        // this thread. Incoming connections on `endpoint` are accepted
+        // asynchronously on the process wide `AdHocAcceptorContext` reactor,
+        // and every accepted connection is then handled by its own worker
+        // thread. Since that reactor outlives this receive loop, everything
+        // the completion handlers touch is kept in a reference counted state
+        // object instead of on this stack frame. The previous acceptor has
+        // already been shut down by `AdHocSocketHandler::connect()`.
+        struct SecondaryRequestState {
+            SecondaryRequestState(
+                asio::io_context& context,
+                const asio::local::stream_protocol::endpoint& endpoint,
+                std::decay_t<G> callback)
+                : acceptor(context, endpoint),
+                  secondary_callback(std::move(callback)) {}
+
+            // Only used from the shared reactor thread after construction
+            asio::local::stream_protocol::acceptor acceptor;
+            std::decay_t<G> secondary_callback;
+
+            // This works the exact same was as `active_plugins` and
+            // `next_plugin_id` in `GroupBridge`
+            std::unordered_map<size_t, Thread> active_requests;
+            std::atomic_size_t next_request_id{};
+            std::mutex mutex;
+            std::condition_variable finished_cv;
+        };
+
+        asio::io_context& acceptor_context =
+            AdHocAcceptorContext<Thread>::get();
+        const auto state = std::make_shared<SecondaryRequestState>(
+            acceptor_context, endpoint_, std::forward<G>(secondary_callback));
+
+        // All acceptor operations happen on the reactor thread so they cannot
+        // race with the shutdown sequence at the end of this function
+        asio::post(acceptor_context, [state, logger,
+                                      buffer_config = buffer_config_,
+                                      endpoint = endpoint_]() {
+            accept_requests(
+                state, logger,
+                [state, buffer_config, endpoint](
+                    asio::local::stream_protocol::socket secondary_socket) {
+                    // The kernel buffer sizes are a per-socket property, so
+                    // the lane's configuration also has to be applied to
+                    // every accepted secondary connection
+                    apply_socket_buffer_config(secondary_socket, buffer_config,
+                                               endpoint);
+
+                    const size_t request_id =
+                        state->next_request_id.fetch_add(1);
+
+                    // We have to make sure to keep moving these sockets into
+                    // the threads that will handle them
+                    std::lock_guard lock(state->mutex);
+                    state->active_requests[request_id] = Thread(
+                        [state, request_id](
+                            asio::local::stream_protocol::socket
+                                secondary_socket) {
+                            // The sending side keeps secondary sockets around
+                            // in a pool so they can be reused for subsequent
+                            // concurrent requests. We'll keep serving requests
+                            // on this connection until it gets closed, with
+                            // this thread parked in a blocking read in the
+                            // meantime.
+                            try {
+                                while (true) {
+                                    state->secondary_callback(
+                                        secondary_socket);
+                                }
+                            } catch (const std::system_error&) {
+                                // The sending side has closed this socket, or
+                                // we're shutting down
+                            }
+
+                            // When the connection gets dropped, we'll join the
+                            // thread again from the reactor thread
+                            asio::post(state->acceptor.get_executor(),
+                                       [state, request_id]() {
+                                           std::lock_guard lock(state->mutex);
+
+                                           // The join is implicit because
+                                           // we're using
+                                           // `std::jthread`/`Win32Thread`
+                                           state->active_requests.erase(
+                                               request_id);
+                                           state->finished_cv.notify_all();
+                                       });
+                        },
+                        std::move(secondary_socket));
+                });
         });
 
         // Now we'll handle reads on the primary socket in a loop until the
@@ -794,12 +2041,20 @@ class AdHocSocketHandler {
             }
         }
 
-        // After the primary socket gets terminated (during shutdown) we'll make
-        // sure all outstanding jobs have been processed and then drop all work
-        // from the IO context
-        std::lock_guard lock(active_secondary_requests_mutex);
-        secondary_context.stop();
-        acceptor_.reset();
+        // After the primary socket gets terminated (during shutdown) we'll
+        // stop accepting new connections and wait for the still active worker
+        // threads to exit, since their callbacks may reference state owned by
+        // our caller. The sending side closes its pooled connections as part
+        // of its own shutdown, which is what breaks those workers out of
+        // their blocking reads.
+        asio::post(acceptor_context, [state]() {
+            std::error_code err;
+            state->acceptor.close(err);
+        });
+
+        std::unique_lock lock(state->mutex);
+        state->finished_cv.wait(
+            lock, [&]() { return state->active_requests.empty(); });
 
         currently_listening_ = false;
     }
@@ -813,29 +2068,45 @@ class AdHocSocketHandler {
     template <std::invocable<asio::local::stream_protocol::socket&> F>
     void receive_multi(std::optional<std::reference_wrapper<Logger>> logger,
                        F&& callback) {
-        receive_multi(logger, callback, std::forward<F>(callback));
+        // Passed as an lvalue on purpose, since the secondary callback gets
+        // copied into the shared state object and the primary callback should
+        // not be moved from
+        receive_multi(logger, callback, callback);
     }
 
    private:
     /**
      * Used in `receive_multi()` to asynchronously listen for secondary socket
-     * connections. After `callback()` returns this function will continue to be
-     * called until the IO context gets stopped.
+     * connections on the shared `AdHocAcceptorContext` reactor. After
+     * `callback()` returns this function will continue to be called until the
+     * acceptor gets closed.
      *
-     * @param acceptor The acceptor we will be listening on.
+     * @param state The reference counted state object owning the acceptor.
+     *   The completion handler keeps it alive so the acceptor can safely
+     *   outlive the receive loop that created it.
      * @param logger A logger instance for logging connection errors. This
      *   should only be passed on the plugin side.
      * @param callback A function that handles the new socket connection.
      */
-    template <std::invocable<asio::local::stream_protocol::socket> F>
-    void accept_requests(asio::local::stream_protocol::acceptor& acceptor,
-                         std::optional<std::reference_wrapper<Logger>> logger,
-                         F&& callback) {
+    template <typename State,
+              std::invocable<asio::local::stream_protocol::socket> F>
+    static void accept_requests(
+        std::shared_ptr<State> state,
+        std::optional<std::reference_wrapper<Logger>> logger,
+        F&& callback) {
+        auto& acceptor = state->acceptor;
         acceptor.async_accept(
-            [&, logger, callback](
+            [state = std::move(state), logger,
+             callback = std::forward<F>(callback)](
                 const std::error_code& error,
-                asio::local::stream_protocol::socket secondary_socket) {
+                asio::local::stream_protocol::socket secondary_socket) mutable {
                 if (error) {
+                    // The acceptor gets closed when the receive loop shuts
+                    // down, so there's nothing to report there
+                    if (error == asio::error::operation_aborted) {
+                        return;
+                    }
+
                     // On the Wine side it's expected that the primary socket
                     // connection will be dropped during shutdown, so we can
                     // silently ignore any related socket errors on the Wine
@@ -851,29 +2122,95 @@ class AdHocSocketHandler {
 
                 callback(std::move(secondary_socket));
 
-                accept_requests(acceptor, logger, callback);
+                accept_requests(std::move(state), logger, std::move(callback));
             });
     }
 
+    /**
+     * Take a connected secondary socket from the pool, or establish a new
+     * connection when the pool is empty. The caller should hand the socket
+     * back with `release_secondary_socket()` after a successful request so it
+     * can be reused.
+     */
+    asio::local::stream_protocol::socket acquire_secondary_socket() {
+        {
+            std::lock_guard pool_lock(socket_pool_mutex_);
+            if (!socket_pool_.empty()) {
+                asio::local::stream_protocol::socket secondary_socket =
+                    std::move(socket_pool_.back());
+                socket_pool_.pop_back();
+
+                return secondary_socket;
+            }
+        }
+
+        asio::local::stream_protocol::socket secondary_socket(io_context_);
+        secondary_socket.connect(endpoint_);
+        apply_socket_buffer_config(secondary_socket, buffer_config_, endpoint_);
+
+        return secondary_socket;
+    }
+
+    /**
+     * Return a secondary socket to the pool after use.
+     */
+    void release_secondary_socket(
+        asio::local::stream_protocol::socket secondary_socket) {
+        std::lock_guard pool_lock(socket_pool_mutex_);
+        socket_pool_.push_back(std::move(secondary_socket));
+    }
+
+    /**
+     * Fill the socket pool up to the number of connections set through
+     * `set_spare_sockets()`. This is done on a best effort basis. If the
+     * remote side turns out to not be accepting secondary connections, then
+     * the pool will simply be grown on demand instead.
+     */
+    void prewarm_spare_sockets() noexcept {
+        if (spare_sockets_prewarmed_.exchange(true)) {
+            return;
+        }
+
+        try {
+            std::lock_guard pool_lock(socket_pool_mutex_);
+            while (socket_pool_.size() < target_spare_sockets_) {
+                asio::local::stream_protocol::socket spare_socket(io_context_);
+                spare_socket.connect(endpoint_);
+                apply_socket_buffer_config(spare_socket, buffer_config_,
+                                           endpoint_);
+                socket_pool_.push_back(std::move(spare_socket));
+            }
+        } catch (const std::system_error&) {
+        }
+    }
+
     /**
      * The main IO context. New sockets created during `send()` will be
-     * bound to this context. In `receive_multi()` we'll create a new IO context
-     * since we want to do all listening there on a dedicated thread.
+     * bound to this context. In `receive_multi()` the acceptor for secondary
+     * connections is instead bound to the shared `AdHocAcceptorContext`.
      */
     asio::io_context& io_context_;
 
     asio::local::stream_protocol::endpoint endpoint_;
+
+    /**
+     * The kernel buffer sizes applied to the primary socket in `connect()`
+     * and to every secondary socket this handler connects or accepts.
+     */
+    const SocketBufferConfig buffer_config_;
+
     asio::local::stream_protocol::socket socket_;
 
     /**
      * This acceptor will be used once synchronously on the listening side
      * during `Sockets::connect()`. When `AdHocSocketHandler::receive_multi()`
-     * is then called, we'll recreate the acceptor to asynchronously listen for
-     * new incoming socket connections on `endpoint` using. This is important,
-     * because on the case of `Vst2Sockets`'s' `plugin_host_callback_` the
-     * acceptor is first accepts an initial socket on the plugin side (like all
-     * sockets), but all additional incoming connections of course have to be
-     * listened for on the plugin side.
+     * is then called, a new acceptor bound to the shared
+     * `AdHocAcceptorContext` will asynchronously listen for new incoming
+     * socket connections on `endpoint` instead. This is important, because on
+     * the case of `Vst2Sockets`'s' `plugin_host_callback_` the acceptor is
+     * first accepts an initial socket on the plugin side (like all sockets),
+     * but all additional incoming connections of course have to be listened
+     * for on the plugin side.
      */
     std::optional<asio::local::stream_protocol::acceptor> acceptor_;
 
@@ -889,10 +2226,33 @@ class AdHocSocketHandler {
 
     /**
      * A mutex that locks the primary `socket`. If this is locked, then any new
-     * events will be sent over a new socket instead.
+     * events will be sent over a secondary socket instead.
      */
     std::mutex write_mutex_;
 
+    /**
+     * Connected secondary sockets that are not currently in use. Reusing these
+     * connections avoids paying socket connection and thread creation costs in
+     * the middle of time-sensitive calls whenever two requests overlap. On the
+     * listening side every connection in this pool has a worker thread parked
+     * in a blocking read.
+     */
+    llvm::SmallVector<asio::local::stream_protocol::socket, 4> socket_pool_;
+    std::mutex socket_pool_mutex_;
+
+    /**
+     * The number of spare secondary sockets to establish ahead of time, set
+     * through `set_spare_sockets()` based on the `spare_sockets` option.
+     */
+    std::atomic_uint32_t target_spare_sockets_ = 0;
+
+    /**
+     * Whether we have already tried to pre-warm the socket pool. This happens
+     * at most once, on the first `send()` call after the remote side has
+     * processed an event from this side.
+     */
+    std::atomic_bool spare_sockets_prewarmed_ = false;
+
     /**
      * Indicates whether or not the remove has processed an event we sent from
      * this side. When a Windows VST2 plugin performs a host callback in its
@@ -901,6 +2261,27 @@ class AdHocSocketHandler {
      * this fallback behaviour should only happen during initialization.
      */
     std::atomic_bool sent_first_event_ = false;
+
+    /**
+     * The round-trip latency histograms for the message types sent over this
+     * socket pair, lazily created by `latency_histogram()`. Keyed by the
+     * message type's name. A `std::map` is used because its nodes are stable,
+     * so the returned references stay valid while new message types get
+     * added. The transparent comparator allows lookups with the
+     * `std::string_view`s produced by `type_name()` without allocating.
+     */
+    std::map<std::string, RoundTripLatencyHistogram, std::less<>>
+        latency_histograms_;
+    std::mutex latency_histograms_mutex_;
+
+    /**
+     * The cumulative handler timings for the message types received on this
+     * socket pair, see `dispatch_timing_entry()`. This stays empty on the
+     * sending side of a socket pair, and `DispatchTimingTable::log_all()`
+     * skips empty tables.
+     */
+    DispatchTimingTable dispatch_timings_{
+        ghc::filesystem::path(endpoint_.path()).filename().string()};
 };
 
 /**
@@ -940,15 +2321,20 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
      */
     TypedMessageHandler(asio::io_context& io_context,
                         asio::local::stream_protocol::endpoint endpoint,
-                        bool listen)
-        : AdHocSocketHandler<Thread>(io_context, endpoint, listen) {}
+                        bool listen,
+                        SocketBufferConfig buffer_config = {})
+        : AdHocSocketHandler<Thread>(io_context,
+                                     endpoint,
+                                     listen,
+                                     buffer_config) {}
 
     /**
      * Serialize and send an event over a socket and return the appropriate
      * response.
      *
      * As described above, if this function is currently being called from
-     * another thread, then this will create a new socket connection and send
+     * another thread, then this will grab a connected secondary socket from
+     * the pool (or establish a new connection if the pool is empty) and send
      * the event there instead.
      *
      * @param object The request object to send. Often a marker struct to ask
@@ -995,6 +2381,8 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
      * an existing object.
      *
      * @param response_object The object to deserialize into.
+     * @param allow_compression Whether large requests may be LZ4 compressed,
+     *   see `write_object()`. The audio thread senders pass `false` here.
      *
      * @overload ClapMessageHandler::send_message
      */
@@ -1003,14 +2391,19 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
         const T& object,
         typename T::Response& response_object,
         std::optional<std::pair<LoggerImpl&, bool>> logging,
-        SerializationBufferBase& buffer) {
+        SerializationBufferBase& buffer,
+        bool allow_compression = true) {
         using TResponse = typename T::Response;
 
         // Since a lot of messages just return a `tresult`, we can't filter out
         // responses based on the response message type. Instead, we'll just
         // only print the responses when the request was not filtered out.
+        // The `would_log_control_messages()` gate turns disabled logging into
+        // a single inlined branch instead of an out of line `log_request()`
+        // call for every message
         bool should_log_response = false;
-        if (logging) {
+        if (logging && logging->first.would_log_control_messages())
+            [[unlikely]] {
             auto [logger, is_host_plugin] = *logging;
             should_log_response = logger.log_request(is_host_plugin, object);
         }
@@ -1026,15 +2419,29 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
 #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
 #endif
 
+        // Round-trip durations are recorded per message type, so the latency
+        // distribution of this bridge instance's calls can be inspected with
+        // `RoundTripLatencyHistogram::log_all()`. The measurement includes
+        // any time spent waiting for the primary socket since that's part of
+        // the latency the host observes.
+        RoundTripLatencyHistogram& histogram =
+            this->latency_histogram(type_name<T>());
+        const auto send_start = std::chrono::steady_clock::now();
+
         // A socket only handles a single request at a time as to prevent
         // messages from arriving out of order. `AdHocSocketHandler::send()`
         // will either use a long-living primary socket, or if that's currently
         // in use it will spawn a new socket for us.
         this->send([&](asio::local::stream_protocol::socket& socket) {
-            write_object(socket, Request(object), buffer);
+            write_object(socket, Request(object), buffer, allow_compression);
             read_object<TResponse>(socket, response_object, buffer);
         });
 
+        histogram.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - send_start)
+                .count()));
+
 #pragma GCC diagnostic pop
 
         if (should_log_response) {
@@ -1054,10 +2461,12 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
     typename T::Response& receive_into(
         const T& object,
         typename T::Response& response_object,
-        std::optional<std::pair<LoggerImpl&, bool>> logging) {
-        SerializationBuffer<256> buffer{};
+        std::optional<std::pair<LoggerImpl&, bool>> logging,
+        bool allow_compression = true) {
+        SerializationBufferPool::Checkout buffer =
+            SerializationBufferPool::instance().checkout();
         return receive_into(object, response_object, std::move(logging),
-                            buffer);
+                            *buffer, allow_compression);
     }
 
     /**
@@ -1097,34 +2506,41 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
                           F&& callback) {
         // Reading, processing, and writing back the response for the requests
         // we receive works in the same way regardless of which socket we're
-        // using
+        // using. The request object to deserialize into is provided by the
+        // caller so it can be recycled between messages, see below.
         const auto process_message =
-            [&](asio::local::stream_protocol::socket& socket) {
+            [&](asio::local::stream_protocol::socket& socket,
+                Request& request_object) {
                 // The persistent buffer is only used when the
-                // `persistent_buffers` template value is enabled, but we'll
-                // always use the thread local persistent object. Because of
-                // loading and storing state the buffer can grow a lot in size
-                // which is why we might not want to reuse that for tasks that
-                // don't need to be realtime safe, but the object has a fixed
-                // size. Normally reusing this object doesn't make much sense
-                // since it's a variant and it will likely have to be recreated
-                // every time, but on the audio processor side we store the
-                // actual variant within an object and we then use some hackery
-                // to always keep the large process data object in memory.
-                // NOTE: Unlike the VST2 version, this persistent buffer is only
-                //       used for audio thread messages
+                // `persistent_buffers` template value is enabled, but the
+                // request objects are always reused. Because of loading and
+                // storing state the buffer can grow a lot in size which is
+                // why we might not want to reuse that for tasks that don't
+                // need to be realtime safe, but the object has a fixed size.
+                // NOTE: Unlike the VST2 version, this persistent buffer is
+                //       only used for audio thread messages
                 thread_local SerializationBuffer<256> persistent_buffer{};
-                thread_local Request persistent_object;
+
+                // The control sockets instead check out a pooled buffer per
+                // message and return it after the response has been written,
+                // see `SerializationBufferPool`
+                std::optional<SerializationBufferPool::Checkout> pooled_buffer;
+                if constexpr (!persistent_buffers) {
+                    pooled_buffer.emplace(
+                        SerializationBufferPool::instance().checkout());
+                }
 
                 auto& request =
                     persistent_buffers
-                        ? read_object<Request>(socket, persistent_object,
+                        ? read_object<Request>(socket, request_object,
                                                persistent_buffer)
-                        : read_object<Request>(socket, persistent_object);
+                        : read_object<Request>(socket, request_object,
+                                               **pooled_buffer);
 
                 // See the comment in `receive_into()` for more information
                 bool should_log_response = false;
-                if (logging) {
+                if (logging && logging->first.would_log_control_messages())
+                    [[unlikely]] {
                     should_log_response = std::visit(
                         [&](const auto& object) {
                             auto [logger, is_host_plugin] = *logging;
@@ -1141,30 +2557,149 @@ class TypedMessageHandler : public AdHocSocketHandler<Thread> {
                 // We do the visiting here using a templated lambda. This way we
                 // always know for sure that the function returns the correct
                 // type, and we can scrap a lot of boilerplate elsewhere.
+                // NOTE: The object is visited by reference on purpose. The
+                //       thread local persistent object above already keeps the
+                //       fully deserialized request alive between calls (and
+                //       `bitsery::ext::InPlaceVariant` deserializes into the
+                //       existing alternative when the message type repeats),
+                //       so copying the request out of the variant here would
+                //       reintroduce an allocation for every nested vector on
+                //       the audio thread. Handlers are free to move heap data
+                //       out of the request, since the next deserialization
+                //       will simply refill those fields.
                 std::visit(
-                    [&]<typename T>(T object) {
+                    [&]<typename T>(T& object) {
+                        // With the `alloc-tracking` build option enabled,
+                        // allocations made while handling audio thread
+                        // messages get counted per message type. The scope
+                        // also covers serializing the response below.
+                        [[maybe_unused]] std::optional<
+                            AllocationTracker::Scope>
+                            allocation_scope;
+                        if constexpr (persistent_buffers) {
+                            allocation_scope.emplace(type_name<T>());
+                        }
+
+                        // The time spent inside the handler is tallied per
+                        // message type, so the table dumped through
+                        // `DispatchTimingTable::log_all()` shows which
+                        // interface methods the time went to. On the Wine
+                        // side the handler's duration is effectively the
+                        // time spent inside the plugin.
+                        DispatchTimingTable::Entry& timing_entry =
+                            this->dispatch_timing_entry(type_name<T>());
+                        const auto dispatch_start =
+                            std::chrono::steady_clock::now();
+
                         typename T::Response response = callback(object);
 
+                        timing_entry.record(static_cast<uint64_t>(
+                            std::chrono::duration_cast<
+                                std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() -
+                                dispatch_start)
+                                .count()));
+
                         if (should_log_response) {
                             auto [logger, is_host_plugin] = *logging;
                             logger.log_response(!is_host_plugin, response);
                         }
 
+                        // `persistent_buffers` is only enabled on the audio
+                        // lanes, whose responses should never be compressed
                         if constexpr (persistent_buffers) {
-                            write_object(socket, response, persistent_buffer);
+                            write_object(socket, response, persistent_buffer,
+                                         false);
                         } else {
-                            write_object(socket, response);
+                            write_object(socket, response, **pooled_buffer);
                         }
                     },
                     // See above
                     get_request_variant(request));
+
+                if constexpr (persistent_buffers) {
+                    // Since these buffers are persistent we'll also track
+                    // their sizes, so they can be reclaimed if they somehow
+                    // balloon and their usage shows up in the telemetry dump
+                    thread_local SerializationBufferMonitor buffer_monitor(
+                        ghc::filesystem::path(this->endpoint().path())
+                            .filename()
+                            .string() +
+                        " (thread local)");
+                    buffer_monitor.track(persistent_buffer);
+                }
             };
 
         this->receive_multi(
             logging ? std::optional(std::ref(logging->first.logger_))
                     : std::nullopt,
-            process_message);
+            [&](asio::local::stream_protocol::socket& socket) {
+                // Normally reusing this object wouldn't make much sense since
+                // it's a variant and it will likely have to be recreated
+                // every time, but `bitsery::ext::InPlaceVariant` deserializes
+                // into the existing alternative when the message type
+                // repeats, and on the audio processor side we store the
+                // actual variant within an object and we then use some
+                // hackery to always keep the large process data object in
+                // memory
+                thread_local Request persistent_object;
+
+                process_message(socket, persistent_object);
+            },
+            [&](asio::local::stream_protocol::socket& socket) {
+                // Every message received on an ad hoc socket is handled on a
+                // freshly spawned thread, so a thread local object would be
+                // constructed and destroyed for every message. Instead we'll
+                // recycle the request objects through a freelist, since some
+                // hosts hammer the control sockets with hundreds of messages
+                // per second when polling the editor and those spill over
+                // onto ad hoc sockets whenever they overlap.
+                std::unique_ptr<Request> slot = acquire_request_slot();
+                process_message(socket, *slot);
+                release_request_slot(std::move(slot));
+            });
     }
+
+   private:
+    /**
+     * Grab a recycled request object from `request_pool_`, or allocate a new
+     * one if the pool is empty.
+     */
+    std::unique_ptr<Request> acquire_request_slot() {
+        {
+            std::lock_guard lock(request_pool_mutex_);
+            if (!request_pool_.empty()) {
+                std::unique_ptr<Request> slot =
+                    std::move(request_pool_.back());
+                request_pool_.pop_back();
+
+                return slot;
+            }
+        }
+
+        return std::make_unique<Request>();
+    }
+
+    /**
+     * Return a request object to `request_pool_` so the next ad hoc socket
+     * message can reuse it. If handling a message throws (because the socket
+     * got closed), the object is simply destroyed instead.
+     */
+    void release_request_slot(std::unique_ptr<Request> slot) {
+        std::lock_guard lock(request_pool_mutex_);
+        request_pool_.push_back(std::move(slot));
+    }
+
+    /**
+     * A freelist of `Request` objects for the ad hoc sockets. The primary
+     * socket's receive loop deserializes into a thread local object that
+     * stays alive between messages, but the ad hoc sockets get a new thread
+     * per message, so without this pool the variants would have to be
+     * reconstructed from scratch every time. The pool's size is bounded by
+     * the maximum number of concurrent ad hoc requests.
+     */
+    std::mutex request_pool_mutex_;
+    llvm::SmallVector<std::unique_ptr<Request>, 8> request_pool_;
 };
 
 /**
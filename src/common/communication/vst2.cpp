@@ -16,6 +16,119 @@
 
 #include "vst2.h"
 
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+void send_chunk_memfd(asio::local::stream_protocol::socket& socket,
+                      const ChunkStream& chunk) {
+    // The data pointer is only set on the sending side, receiving a
+    // `ChunkStream` and then trying to send it again would be a bug
+    assert(chunk.data);
+
+    const int memfd = memfd_create("yabridge-chunk", MFD_CLOEXEC);
+    if (memfd == -1) {
+        throw std::system_error(std::error_code(errno, std::system_category()),
+                                "Could not create a memfd for the chunk");
+    }
+
+    if (ftruncate(memfd, chunk.size) == -1) {
+        close(memfd);
+        throw std::system_error(std::error_code(errno, std::system_category()),
+                                "Could not resize the chunk memfd");
+    }
+
+    void* mapping =
+        mmap(nullptr, chunk.size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (mapping == MAP_FAILED) {
+        close(memfd);
+        throw std::system_error(std::error_code(errno, std::system_category()),
+                                "Could not map the chunk memfd");
+    }
+
+    std::copy_n(chunk.data, chunk.size, static_cast<uint8_t*>(mapping));
+    munmap(mapping, chunk.size);
+
+    // File descriptors can only be sent alongside regular data, so we'll
+    // attach the descriptor to a single placeholder byte
+    uint8_t placeholder = 0;
+    iovec placeholder_buffer{.iov_base = &placeholder,
+                             .iov_len = sizeof(placeholder)};
+
+    alignas(cmsghdr) char control_buffer[CMSG_SPACE(sizeof(int))]{};
+    msghdr message{};
+    message.msg_iov = &placeholder_buffer;
+    message.msg_iovlen = 1;
+    message.msg_control = control_buffer;
+    message.msg_controllen = sizeof(control_buffer);
+
+    cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+    control_message->cmsg_level = SOL_SOCKET;
+    control_message->cmsg_type = SCM_RIGHTS;
+    control_message->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(control_message), &memfd, sizeof(int));
+
+    // Asio puts its sockets in non-blocking mode, so we may need to wait
+    // until the socket becomes writable again
+    while (sendmsg(socket.native_handle(), &message, 0) == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket.wait(asio::socket_base::wait_write);
+        } else if (errno != EINTR) {
+            close(memfd);
+            throw std::system_error(
+                std::error_code(errno, std::system_category()),
+                "Could not send the chunk memfd");
+        }
+    }
+
+    close(memfd);
+}
+
+ReceivedChunkMapping receive_chunk_memfd(
+    asio::local::stream_protocol::socket& socket,
+    size_t size) {
+    uint8_t placeholder = 0;
+    iovec placeholder_buffer{.iov_base = &placeholder,
+                             .iov_len = sizeof(placeholder)};
+
+    alignas(cmsghdr) char control_buffer[CMSG_SPACE(sizeof(int))]{};
+    msghdr message{};
+    message.msg_iov = &placeholder_buffer;
+    message.msg_iovlen = 1;
+    message.msg_control = control_buffer;
+    message.msg_controllen = sizeof(control_buffer);
+
+    while (recvmsg(socket.native_handle(), &message, MSG_CMSG_CLOEXEC) == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            socket.wait(asio::socket_base::wait_read);
+        } else if (errno != EINTR) {
+            throw std::system_error(
+                std::error_code(errno, std::system_category()),
+                "Could not receive the chunk memfd");
+        }
+    }
+
+    const cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+    if (!control_message || control_message->cmsg_level != SOL_SOCKET ||
+        control_message->cmsg_type != SCM_RIGHTS) {
+        throw std::runtime_error(
+            "Expected a file descriptor alongside the chunk response");
+    }
+
+    int memfd;
+    std::memcpy(&memfd, CMSG_DATA(control_message), sizeof(int));
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, memfd, 0);
+    close(memfd);
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(std::error_code(errno, std::system_category()),
+                                "Could not map the received chunk");
+    }
+
+    return ReceivedChunkMapping(static_cast<const uint8_t*>(mapping), size);
+}
+
 Vst2Event::Payload DefaultDataConverter::read_data(const int /*opcode*/,
                                                    const int /*index*/,
                                                    const intptr_t /*value*/,
@@ -28,9 +141,13 @@ Vst2Event::Payload DefaultDataConverter::read_data(const int /*opcode*/,
     // some plugins don't zero out their string buffers when sending host
     // callbacks, we will explicitely list all callbacks that expect a string in
     // `DispatchDataConverter` and `HostCallbackDataConverter`.
+    // The view points directly at the host's buffer. That buffer stays valid
+    // for the duration of the synchronous dispatcher call, which includes
+    // serializing the event, so the string never has to be copied into the
+    // event object.
     const char* str = static_cast<const char*>(data);
     if (str[0] != 0) {
-        return std::string(str);
+        return std::string_view(str);
     } else {
         return WantsString{};
     }
@@ -75,5 +192,24 @@ Vst2EventResult DefaultDataConverter::send_event(
     const Vst2Event& event,
     SerializationBufferBase& buffer) const {
     write_object(socket, event, buffer);
-    return read_object<Vst2EventResult>(socket, buffer);
+
+    // Large `effSetChunk()` chunks are streamed right after the serialized
+    // event instead of being embedded in it, see `ChunkStream`
+    if (const ChunkStream* chunk = std::get_if<ChunkStream>(&event.payload)) {
+        send_chunk_stream(socket, *chunk);
+    }
+
+    Vst2EventResult response = read_object<Vst2EventResult>(socket, buffer);
+
+    // And the other way around, large `effGetChunk()` results arrive as a
+    // memfd sent right after the serialized response. We'll map the region
+    // and point the payload at it, so the chunk can be handed to the host
+    // without copying it. The mapping replaces the one from the previous
+    // `effGetChunk()` call, matching the lifetime the VST2 API requires.
+    if (ChunkStream* chunk = std::get_if<ChunkStream>(&response.payload)) {
+        received_chunk_mapping_ = receive_chunk_memfd(socket, chunk->size);
+        chunk->data = received_chunk_mapping_->data();
+    }
+
+    return response;
 }
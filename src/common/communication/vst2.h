@@ -16,13 +16,66 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstring>
+#include <limits>
+
+#include <sys/mman.h>
 
 #include "../logging/vst2.h"
 #include "../serialization/vst2.h"
 #include "../utils.h"
 #include "common.h"
 
+/**
+ * An RAII wrapper around a large `effGetChunk()` result that was received as a
+ * memfd passed over the socket and then mapped into our address space, see
+ * `receive_chunk_memfd()`. The region is unmapped on destruction.
+ */
+class ReceivedChunkMapping {
+   public:
+    /**
+     * Take ownership of a mapped chunk region. Use `receive_chunk_memfd()`
+     * instead of constructing this directly.
+     */
+    ReceivedChunkMapping(const uint8_t* data, size_t size) noexcept
+        : data_(data), size_(size) {}
+
+    ~ReceivedChunkMapping() noexcept {
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+
+    ReceivedChunkMapping(const ReceivedChunkMapping&) = delete;
+    ReceivedChunkMapping& operator=(const ReceivedChunkMapping&) = delete;
+
+    ReceivedChunkMapping(ReceivedChunkMapping&& o) noexcept
+        : data_(o.data_), size_(o.size_) {
+        o.data_ = nullptr;
+    }
+    ReceivedChunkMapping& operator=(ReceivedChunkMapping&& o) noexcept {
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        data_ = o.data_;
+        size_ = o.size_;
+        o.data_ = nullptr;
+
+        return *this;
+    }
+
+    /**
+     * A pointer to the start of the mapped chunk.
+     */
+    const uint8_t* data() const noexcept { return data_; }
+
+   private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
 /**
  * Encodes the base behavior for reading from and writing to the `data` argument
  * for event dispatch functions. This provides base functionality for these
@@ -89,8 +142,244 @@ class DefaultDataConverter {
         asio::local::stream_protocol::socket& socket,
         const Vst2Event& event,
         SerializationBufferBase& buffer) const;
+
+   private:
+    /**
+     * The mapping for the last large `effGetChunk()` result received through
+     * `receive_chunk_memfd()`. The host reads the chunk directly from this
+     * mapped region. Per the VST2 contract that pointer only has to stay
+     * valid until the next `effGetChunk()` call, at which point we'll replace
+     * the mapping.
+     */
+    mutable std::optional<ReceivedChunkMapping> received_chunk_mapping_;
 };
 
+/**
+ * Write a `ChunkStream` payload's bytes to the socket. This is called right
+ * after writing the serialized event or response the `ChunkStream` is part of,
+ * so the receiving side knows exactly how many bytes will follow. The bytes
+ * are written directly from the original chunk buffer, so large plugin states
+ * never have to be staged in a serialization buffer.
+ */
+inline void send_chunk_stream(asio::local::stream_protocol::socket& socket,
+                              const ChunkStream& chunk) {
+    // The data pointer is only set on the sending side, receiving a
+    // `ChunkStream` and then trying to send it again would be a bug
+    assert(chunk.data);
+    asio::write(socket, asio::const_buffer(chunk.data, chunk.size));
+}
+
+/**
+ * Read the chunk bytes following a serialized event or response containing a
+ * `ChunkStream` payload, and replace that payload with a `ChunkData` object
+ * containing those bytes. This happens immediately after deserializing the
+ * message, so the rest of the code never has to know whether a chunk was
+ * streamed or embedded in the message.
+ */
+template <typename Payload>
+void receive_chunk_stream_into(asio::local::stream_protocol::socket& socket,
+                               Payload& payload) {
+    ChunkData chunk{};
+    chunk.buffer.resize(std::get<ChunkStream>(payload).size);
+    asio::read(socket, asio::buffer(chunk.buffer),
+               asio::transfer_exactly(chunk.buffer.size()));
+
+    payload = std::move(chunk);
+}
+
+/**
+ * Copy a large `effGetChunk()` result into a fresh memfd and pass the file
+ * descriptor over the socket using `SCM_RIGHTS`. The other side maps the
+ * region with `receive_chunk_memfd()` and hands the host a pointer straight
+ * into the mapping, so the chunk only gets copied once in total. Called right
+ * after writing the serialized response the `ChunkStream` is part of.
+ */
+void send_chunk_memfd(asio::local::stream_protocol::socket& socket,
+                      const ChunkStream& chunk);
+
+/**
+ * Receive the memfd sent by `send_chunk_memfd()` and map `size` bytes of it
+ * into our address space. The counterpart to `send_chunk_memfd()`.
+ */
+ReceivedChunkMapping receive_chunk_memfd(
+    asio::local::stream_protocol::socket& socket,
+    size_t size);
+
+/**
+ * The marker written to the upper 32 bits of the 64 bit size header to
+ * identify a fast path dispatcher frame, see `is_fast_path_event()`. Regular
+ * serialized messages are always much smaller than 4 GiB, so a size header
+ * with any of its upper 32 bits set can never belong to a legitimate bitsery
+ * message. Both sides always come from the same yabridge build (this is
+ * verified during initialization), so the formats don't need any further
+ * negotiation.
+ */
+constexpr uint64_t vst2_fast_frame_marker = 0xfa57'2e76'0000'0000;
+constexpr uint64_t vst2_fast_frame_marker_mask = 0xffff'ffff'0000'0000;
+
+/**
+ * Whether an event can be sent as a fast path frame instead of going through
+ * the generic bitsery serialization. This covers the payloadless dispatcher
+ * opcodes with a plain integer result, which make up the majority of the
+ * remaining dispatcher traffic. These events fit in a fixed 16 byte request
+ * frame and an 8 byte response frame, see `send_fast_event()`.
+ *
+ * `effSetSampleRate()` is deliberately not part of the table since it passes
+ * the sample rate through the option parameter, and `effClose()` has special
+ * shutdown handling on both sides. `effSetProgram()` used to be part of the
+ * table, but its response now carries the new program's full state so the
+ * host's follow-up reads can be answered locally, see `Vst2ProgramBundle`.
+ */
+inline bool is_fast_path_event(const Vst2Event& event) noexcept {
+    switch (event.opcode) {
+        case effGetProgram:
+        case effSetBlockSize:
+        case effEditClose:
+        case effEditIdle:
+        case effCanBeAutomated:
+        case effGetPlugCategory:
+        case effGetVendorVersion:
+        case effGetTailSize:
+        case effIdle:
+        case effGetVstVersion:
+        case effBeginSetProgram:
+        case effEndSetProgram:
+        case effStartProcess:
+        case effStopProcess:
+        case effSetProcessPrecision:
+            break;
+        default:
+            return false;
+    }
+
+    // The response to all of the above events is a plain integer, see
+    // `passthrough_event()`, but the event itself can only be encoded in a
+    // fast path frame when the index and value parameters fit in 32 bit
+    // integers. In practice they always do for these opcodes.
+    return std::holds_alternative<std::nullptr_t>(event.payload) &&
+           !event.value_payload && event.option == 0.0f &&
+           event.value >= std::numeric_limits<int32_t>::min() &&
+           event.value <= std::numeric_limits<int32_t>::max();
+}
+
+/**
+ * Send an event that passed the `is_fast_path_event()` check as a fixed 16
+ * byte frame and read back the bare 64 bit return value, skipping bitsery on
+ * both sides. The frame consists of the marked size header with the opcode in
+ * its lower 32 bits, followed by the index and value parameters as packed 32
+ * bit integers.
+ *
+ * @relates read_vst2_event
+ */
+inline Vst2EventResult send_fast_event(
+    asio::local::stream_protocol::socket& socket,
+    const Vst2Event& event) {
+    const std::array<uint64_t, 2> frame{
+        vst2_fast_frame_marker | static_cast<uint32_t>(event.opcode),
+        (static_cast<uint64_t>(static_cast<uint32_t>(event.index)) << 32) |
+            static_cast<uint32_t>(static_cast<int32_t>(event.value))};
+    asio::write(socket, asio::buffer(frame));
+
+    int64_t return_value = 0;
+    asio::read(socket,
+               asio::mutable_buffer(&return_value, sizeof(return_value)),
+               asio::transfer_exactly(sizeof(return_value)));
+
+    return Vst2EventResult{.return_value = return_value,
+                           .payload = nullptr,
+                           .value_payload = std::nullopt};
+}
+
+/**
+ * Read either a regular serialized `Vst2Event` or a fast path frame sent by
+ * `send_fast_event()` into `event`. This mirrors `read_object()`, except that
+ * the size header is inspected for the fast path marker before deserializing.
+ *
+ * @return Whether the event arrived as a fast path frame, in which case the
+ *   response should be written back as a bare 64 bit return value instead of
+ *   a serialized `Vst2EventResult`.
+ */
+inline bool read_vst2_event(asio::local::stream_protocol::socket& socket,
+                            Vst2Event& event,
+                            SerializationBufferBase& buffer) {
+    std::array<uint64_t, 1> header;
+    buffer.resize_for_overwrite(buffer.capacity());
+    const size_t bytes_received = asio::read(
+        socket,
+        std::array<asio::mutable_buffer, 2>{asio::buffer(header),
+                                            asio::buffer(buffer)},
+        asio::transfer_at_least(sizeof(header)));
+    const size_t payload_received = bytes_received - sizeof(header);
+
+    if ((header[0] & vst2_fast_frame_marker_mask) == vst2_fast_frame_marker) {
+        uint64_t packed_arguments = 0;
+        if (payload_received < sizeof(packed_arguments)) {
+            asio::read(socket,
+                       asio::mutable_buffer(
+                           buffer.data() + payload_received,
+                           sizeof(packed_arguments) - payload_received),
+                       asio::transfer_exactly(sizeof(packed_arguments) -
+                                              payload_received));
+        }
+        std::memcpy(&packed_arguments, buffer.data(),
+                    sizeof(packed_arguments));
+
+        event.opcode = static_cast<int32_t>(
+            static_cast<uint32_t>(header[0] & 0xffffffff));
+        event.index =
+            static_cast<int32_t>(static_cast<uint32_t>(packed_arguments >> 32));
+        event.value = static_cast<int32_t>(
+            static_cast<uint32_t>(packed_arguments & 0xffffffff));
+        event.option = 0.0f;
+        event.payload = nullptr;
+        event.value_payload.reset();
+
+        return true;
+    }
+
+    // This is a regular serialized event, and the rest of it is read and
+    // deserialized exactly like `read_object()` would, including the handling
+    // for LZ4 compressed messages. Large chunks are streamed separately so
+    // events rarely hit the compression threshold, but nothing rules it out.
+    const bool is_compressed = (header[0] & compressed_message_flag) != 0;
+    size_t size = header[0] & ~compressed_message_flag;
+    assert(payload_received <= size);
+    if (buffer.size() < size) {
+        buffer.resize_for_overwrite(size);
+    }
+    if (payload_received < size) {
+        asio::read(socket,
+                   asio::mutable_buffer(buffer.data() + payload_received,
+                                        size - payload_received),
+                   asio::transfer_exactly(size - payload_received));
+    }
+
+    if (is_compressed) [[unlikely]] {
+#ifdef WITH_LZ4
+        SerializationBufferBase& decompressed = compression_scratch_buffer();
+        size = decompress_message(buffer, size, decompressed);
+        buffer.swap(decompressed);
+#else
+        throw std::runtime_error(
+            "Received an LZ4 compressed message, but this yabridge build was "
+            "compiled without compression support");
+#endif
+    }
+
+    // The event's string payload, if any, will alias this buffer instead of
+    // being copied into an owned string, see `bitsery::ext::BorrowedString`
+    const bitsery::ext::BorrowedBufferScope borrowed_scope(buffer.data());
+    auto [_, success] =
+        bitsery::quickDeserialization<InputAdapter<SerializationBufferBase>>(
+            {buffer.begin(), size}, event);
+    if (!success) [[unlikely]] {
+        throw std::runtime_error("Deserialization failure in call: " +
+                                 std::string(__PRETTY_FUNCTION__));
+    }
+
+    return false;
+}
+
 /**
  * An instance of `AdHocSocketHandler` that can handle VST2 `dispatcher()` and
  * `audioMaster()` events.
@@ -139,8 +428,12 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
      */
     Vst2EventHandler(asio::io_context& io_context,
                      asio::local::stream_protocol::endpoint endpoint,
-                     bool listen)
-        : AdHocSocketHandler<Thread>(io_context, endpoint, listen) {}
+                     bool listen,
+                     SocketBufferConfig buffer_config = {})
+        : AdHocSocketHandler<Thread>(io_context,
+                                     endpoint,
+                                     listen,
+                                     buffer_config) {}
 
     /**
      * Serialize and send an event over a socket. This is used for both the host
@@ -197,6 +490,15 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
                               .payload = std::move(payload),
                               .value_payload = std::move(value_payload)};
 
+        // Round-trip durations are recorded per opcode, so the latency
+        // distribution of this bridge instance's events can be inspected
+        // with `RoundTripLatencyHistogram::log_all()`. The only caller that
+        // doesn't pass a logger is the Wine side sending `audioMaster()`
+        // callbacks, so without one the opcode belongs to a host callback.
+        RoundTripLatencyHistogram& histogram =
+            opcode_histogram(logging ? logging->second : false, opcode);
+        const auto send_start = std::chrono::steady_clock::now();
+
         // A socket only handles a single request at a time as to prevent
         // messages from arriving out of order. `AdHocSocketHandler::send()`
         // will either use a long-living primary socket, or if that's currently
@@ -204,13 +506,28 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
         // `DefaultDataConverter::send_event()` to actually write and read data
         // from the socket, so we can override this for specific function calls
         // that potentially need to have their responses handled on the same
-        // calling thread (i.e. mutual recursion).
+        // calling thread (i.e. mutual recursion). Payloadless dispatcher
+        // events with an integer result skip the serialization altogether and
+        // are sent as fixed size frames instead. This is only done for
+        // `dispatch()` events since the opcode tables for the two directions
+        // overlap, and the mutually recursive sequences that require the
+        // converter's `send_event()` override only occur for host callbacks.
+        const bool is_dispatch = logging && logging->second;
         const Vst2EventResult response =
             this->send([&](asio::local::stream_protocol::socket& socket) {
+                if (is_dispatch && is_fast_path_event(event)) {
+                    return send_fast_event(socket, event);
+                }
+
                 return data_converter.send_event(socket, event,
                                                  serialization_buffer());
             });
 
+        histogram.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - send_start)
+                .count()));
+
         if (logging) {
             auto [logger, is_dispatch] = *logging;
             logger.log_event_response(is_dispatch, opcode,
@@ -254,7 +571,8 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
                 bool on_main_thread) {
                 SerializationBufferBase& buffer = serialization_buffer();
 
-                auto event = read_object<Vst2Event>(socket, buffer);
+                Vst2Event event{};
+                const bool fast_frame = read_vst2_event(socket, event, buffer);
                 if (logging) {
                     auto [logger, is_dispatch] = *logging;
                     logger.log_event(is_dispatch, event.opcode, event.index,
@@ -262,7 +580,31 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
                                      event.value_payload);
                 }
 
+                // Large `effSetChunk()` chunks are streamed over the socket
+                // right after the serialized event, see `ChunkStream`. After
+                // this the callback only ever sees regular `ChunkData`.
+                if (std::holds_alternative<ChunkStream>(event.payload)) {
+                    receive_chunk_stream_into(socket, event.payload);
+                }
+
+                // The handler's duration is tallied per opcode, so the table
+                // dumped through `DispatchTimingTable::log_all()` shows which
+                // opcodes the time went to. On the Wine side (which receives
+                // these events without a logger, so `is_dispatch` is derived
+                // accordingly) that's effectively the time spent inside the
+                // plugin's `dispatcher()`.
+                DispatchTimingTable::Entry& timing_entry =
+                    opcode_timing_entry(logging ? logging->second : true,
+                                        event.opcode);
+                const auto dispatch_start = std::chrono::steady_clock::now();
+
                 Vst2EventResult response = callback(event, on_main_thread);
+
+                timing_entry.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - dispatch_start)
+                        .count()));
+
                 if (logging) {
                     auto [logger, is_dispatch] = *logging;
                     logger.log_event_response(
@@ -270,7 +612,36 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
                         response.payload, response.value_payload);
                 }
 
+                // The sender of a fast path frame is waiting for a bare 64
+                // bit return value. These events always produce payloadless
+                // responses, see `is_fast_path_event()`.
+                if (fast_frame) {
+                    assert(std::holds_alternative<std::nullptr_t>(
+                               response.payload) &&
+                           !response.value_payload);
+
+                    const int64_t return_value = response.return_value;
+                    asio::write(socket,
+                                asio::const_buffer(&return_value,
+                                                   sizeof(return_value)));
+
+                    return;
+                }
+
                 write_object(socket, response, buffer);
+
+                // Large `effGetChunk()` responses are passed along as a
+                // memfd right after the serialized response, so the native
+                // side can hand the host a pointer into the mapped region
+                // without copying the chunk again. The chunk buffer is owned
+                // by the plugin and stays valid at least until the next
+                // dispatcher call, which can only happen after the native
+                // side has received the memfd because of the strict
+                // request-response sequencing on these sockets.
+                if (const ChunkStream* chunk =
+                        std::get_if<ChunkStream>(&response.payload)) {
+                    send_chunk_memfd(socket, *chunk);
+                }
             };
 
         this->receive_multi(
@@ -285,6 +656,66 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
     }
 
    private:
+    /**
+     * Get the round-trip latency histogram for an opcode, creating it the
+     * first time the opcode is seen. The opcode's name is only formatted on
+     * that first call, so recording an event's duration never builds strings.
+     */
+    RoundTripLatencyHistogram& opcode_histogram(bool is_dispatch, int opcode) {
+        std::lock_guard lock(opcode_histograms_mutex_);
+        auto it = opcode_histograms_.find(opcode);
+        if (it == opcode_histograms_.end()) {
+            const std::string opcode_name =
+                opcode_to_string(is_dispatch, opcode)
+                    .value_or("opcode " + std::to_string(opcode));
+            it = opcode_histograms_
+                     .emplace(opcode, &this->latency_histogram(opcode_name))
+                     .first;
+        }
+
+        return *it->second;
+    }
+
+    /**
+     * Maps opcodes to their histograms in the base class'
+     * `latency_histograms_` map, which is keyed by name instead of by opcode.
+     * The pointers stay valid because that map's nodes are stable.
+     */
+    std::map<int, RoundTripLatencyHistogram*> opcode_histograms_;
+    std::mutex opcode_histograms_mutex_;
+
+    /**
+     * Get the dispatch timing entry for an opcode handled on this socket,
+     * creating it the first time the opcode is seen. This works just like
+     * `opcode_histogram()`: the opcode's name is only formatted on that
+     * first call, so tallying an event's handler duration never builds
+     * strings.
+     */
+    DispatchTimingTable::Entry& opcode_timing_entry(bool is_dispatch,
+                                                    int opcode) {
+        std::lock_guard lock(opcode_timing_entries_mutex_);
+        auto it = opcode_timing_entries_.find(opcode);
+        if (it == opcode_timing_entries_.end()) {
+            const std::string opcode_name =
+                opcode_to_string(is_dispatch, opcode)
+                    .value_or("opcode " + std::to_string(opcode));
+            it = opcode_timing_entries_
+                     .emplace(opcode,
+                              &this->dispatch_timing_entry(opcode_name))
+                     .first;
+        }
+
+        return *it->second;
+    }
+
+    /**
+     * Maps opcodes to their entries in the base class' timing table, which
+     * is keyed by name instead of by opcode. The pointers stay valid because
+     * the table's nodes are stable.
+     */
+    std::map<int, DispatchTimingTable::Entry*> opcode_timing_entries_;
+    std::mutex opcode_timing_entries_mutex_;
+
     /**
      * Unlike our VST3 implementation, in the VST2 implementation there's no
      * separation between potentially real time critical events that will be
@@ -300,18 +731,17 @@ class Vst2EventHandler : public AdHocSocketHandler<Thread> {
         constexpr size_t initial_events_size = sizeof(DynamicVstEvents);
         thread_local SerializationBuffer<initial_events_size> buffer{};
 
-        // This buffer is already pretty large, but it can still grow immensely
-        // when sending and receiving preset data. In such cases we do want to
-        // reallocate the buffer on the next event to free up memory again. This
-        // won't happen during audio processing.
-        if (buffer.size() > initial_events_size * 2) {
-            // NOTE: There's no `.shrink_to_fit()` implementation here, so we'll
-            //       just YOLO it and reinitialize the vector since we don't
-            //       need the old data
-            buffer = SerializationBuffer<initial_events_size>{};
-            // buffer.resize(initial_events_size);
-            // buffer.shrink_to_fit();
-        }
+        // This buffer is already pretty large, but it can still grow when
+        // sending and receiving large objects. The monitor reclaims the
+        // memory once it's clear it's no longer needed, and its telemetry
+        // shows up in the buffer usage dump. This won't happen during audio
+        // processing.
+        thread_local SerializationBufferMonitor buffer_monitor(
+            ghc::filesystem::path(this->endpoint().path())
+                .filename()
+                .string() +
+            " (thread local)");
+        buffer_monitor.track(buffer);
 
         return buffer;
     }
@@ -353,32 +783,39 @@ class Vst2Sockets final : public Sockets {
           host_plugin_dispatch_(
               io_context,
               (base_dir_ / "host_plugin_dispatch.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::control()),
           plugin_host_callback_(
               io_context,
               (base_dir_ / "plugin_host_callback.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::control()),
           host_plugin_parameters_(
               io_context,
               (base_dir_ / "host_plugin_parameters.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::audio()),
           host_plugin_process_replacing_(
               io_context,
               (base_dir_ / "host_plugin_process_replacing.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::audio()),
           host_plugin_control_(
               io_context,
               (base_dir_ / "host_plugin_control.sock").string(),
-              listen) {}
+              listen,
+              SocketBufferConfig::control()) {}
 
-    ~Vst2Sockets() noexcept override { close(); }
+    ~Vst2Sockets() noexcept override {
+        log_telemetry();
+        close();
+    }
 
     void connect() override {
-        host_plugin_dispatch_.connect();
-        plugin_host_callback_.connect();
-        host_plugin_parameters_.connect();
-        host_plugin_process_replacing_.connect();
-        host_plugin_control_.connect();
+        connect_sockets_parallel<Thread>(
+            host_plugin_dispatch_, plugin_host_callback_,
+            host_plugin_parameters_, host_plugin_process_replacing_,
+            host_plugin_control_);
     }
 
     void close() override {
@@ -465,12 +902,25 @@ Vst2EventResult passthrough_event(AEffect* plugin,
 
     auto read_payload_fn = overload{
         [](const std::nullptr_t&) -> void* { return nullptr; },
-        [](const std::string& s) -> void* {
-            return const_cast<char*>(s.c_str());
+        [&](const std::string_view& s) -> void* {
+            // The view aliases the receive buffer, and that buffer gets
+            // reused the moment the plugin makes a nested host callback from
+            // this thread. Copying the string to the stack buffer keeps it
+            // valid for the entire dispatcher call without touching the heap.
+            const size_t length = std::min(s.size(), string_buffer.size() - 1);
+            std::copy_n(s.data(), length, string_buffer.data());
+            string_buffer[length] = 0;
+
+            return string_buffer.data();
         },
         [](const ChunkData& chunk) -> void* {
             return const_cast<uint8_t*>(chunk.buffer.data());
         },
+        [](const ChunkStream&) -> void* {
+            // Streamed chunks are converted to `ChunkData` immediately after
+            // the event has been received, so this will never be visited
+            return nullptr;
+        },
         [](const native_size_t& window_handle) -> void* {
             // This is the X11 window handle that the editor should reparent
             // itself to. We have a special wrapper around the dispatch function
@@ -489,6 +939,11 @@ Vst2EventResult passthrough_event(AEffect* plugin,
         [](DynamicSpeakerArrangement& speaker_arrangement) -> void* {
             return &speaker_arrangement.as_c_speaker_arrangement();
         },
+        [](const Vst2HostBufferMap&) -> void* {
+            // Events with this payload get intercepted in `Vst2Bridge::run()`
+            // and never reach the plugin, see `vst2_map_host_buffers_opcode`
+            return nullptr;
+        },
         [](const WantsAEffectUpdate&) -> void* {
             // The host will never actually ask for an updated `AEffect` object
             // since that should not be a thing. This is purely a meant as a
@@ -550,6 +1005,17 @@ Vst2EventResult passthrough_event(AEffect* plugin,
             // value from the event determines how much data the plugin has
             // written
             const uint8_t* chunk_data = *static_cast<uint8_t**>(data);
+
+            // Sample library plugins can have states of hundreds of
+            // megabytes. Those are passed along as a memfd instead of being
+            // copied into the response, see `ChunkStream`.
+            if (static_cast<size_t>(return_value) >=
+                chunk_streaming_threshold) {
+                return ChunkStream{
+                    .size = static_cast<uint64_t>(return_value),
+                    .data = chunk_data};
+            }
+
             return ChunkData{
                 std::vector<uint8_t>(chunk_data, chunk_data + return_value)};
         },
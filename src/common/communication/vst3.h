@@ -17,6 +17,8 @@
 #pragma once
 
 #include <future>
+#include <memory>
+#include <shared_mutex>
 #include <variant>
 
 #include "../logging/vst3.h"
@@ -69,19 +71,24 @@ class Vst3Sockets final : public Sockets {
           host_plugin_control_(
               io_context,
               (base_dir_ / "host_plugin_control.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::control()),
           plugin_host_callback_(
               io_context,
               (base_dir_ / "plugin_host_callback.sock").string(),
-              listen),
+              listen,
+              SocketBufferConfig::control()),
           io_context_(io_context) {}
 
     // NOLINTNEXTLINE(clang-analyzer-optin.cplusplus.VirtualCall)
-    ~Vst3Sockets() noexcept override { close(); }
+    ~Vst3Sockets() noexcept override {
+        log_telemetry();
+        close();
+    }
 
     void connect() override {
-        host_plugin_control_.connect();
-        plugin_host_callback_.connect();
+        connect_sockets_parallel<Thread>(host_plugin_control_,
+                                         plugin_host_callback_);
     }
 
     void close() override {
@@ -93,7 +100,7 @@ class Vst3Sockets final : public Sockets {
         // This map should be empty at this point, but who knows
         std::lock_guard lock(audio_processor_sockets_mutex_);
         for (auto& [instance_id, socket] : audio_processor_sockets_) {
-            socket.close();
+            socket->close();
         }
     }
 
@@ -107,13 +114,16 @@ class Vst3Sockets final : public Sockets {
     void add_audio_processor_and_connect(size_t instance_id) {
         std::lock_guard lock(audio_processor_sockets_mutex_);
         audio_processor_sockets_.try_emplace(
-            instance_id, io_context_,
-            (base_dir_ / ("host_plugin_audio_processor_" +
-                          std::to_string(instance_id) + ".sock"))
-                .string(),
-            false);
+            instance_id,
+            std::make_unique<TypedMessageHandler<Thread, Vst3Logger,
+                                                 Vst3AudioProcessorRequest>>(
+                io_context_,
+                (base_dir_ / ("host_plugin_audio_processor_" +
+                              std::to_string(instance_id) + ".sock"))
+                    .string(),
+                false, SocketBufferConfig::audio()));
 
-        audio_processor_sockets_.at(instance_id).connect();
+        audio_processor_sockets_.at(instance_id)->connect();
     }
 
     /**
@@ -141,20 +151,23 @@ class Vst3Sockets final : public Sockets {
         {
             std::lock_guard lock(audio_processor_sockets_mutex_);
             audio_processor_sockets_.try_emplace(
-                instance_id, io_context_,
-                (base_dir_ / ("host_plugin_audio_processor_" +
-                              std::to_string(instance_id) + ".sock"))
-                    .string(),
-                true);
+                instance_id,
+                std::make_unique<TypedMessageHandler<
+                    Thread, Vst3Logger, Vst3AudioProcessorRequest>>(
+                    io_context_,
+                    (base_dir_ / ("host_plugin_audio_processor_" +
+                                  std::to_string(instance_id) + ".sock"))
+                        .string(),
+                    true, SocketBufferConfig::audio()));
         }
 
         socket_listening_latch.set_value();
-        audio_processor_sockets_.at(instance_id).connect();
+        audio_processor_handler(instance_id).connect();
 
         // This `true` indicates that we want to reuse our serialization and
         // receiving buffers for all calls. This slightly reduces the amount of
         // allocations in the audio processing loop.
-        audio_processor_sockets_.at(instance_id)
+        audio_processor_handler(instance_id)
             .template receive_messages<true>(std::nullopt,
                                              std::forward<F>(callback));
     }
@@ -173,7 +186,7 @@ class Vst3Sockets final : public Sockets {
     bool remove_audio_processor(size_t instance_id) {
         std::lock_guard lock(audio_processor_sockets_mutex_);
         if (audio_processor_sockets_.contains(instance_id)) {
-            audio_processor_sockets_.at(instance_id).close();
+            audio_processor_sockets_.at(instance_id)->close();
             audio_processor_sockets_.erase(instance_id);
 
             return true;
@@ -197,9 +210,9 @@ class Vst3Sockets final : public Sockets {
         const T& object,
         std::optional<std::pair<Vst3Logger&, bool>> logging) {
         typename T::Response response_object;
-        return audio_processor_sockets_.at(object.instance_id)
+        return audio_processor_handler(object.instance_id)
             .receive_into(object, response_object, logging,
-                          audio_processor_buffer());
+                          audio_processor_buffer(), false);
     }
 
     /**
@@ -211,9 +224,9 @@ class Vst3Sockets final : public Sockets {
         const MessageReference<T>& object_ref,
         std::optional<std::pair<Vst3Logger&, bool>> logging) {
         typename T::Response response_object;
-        return audio_processor_sockets_.at(object_ref.get().instance_id)
+        return audio_processor_handler(object_ref.get().instance_id)
             .receive_into(object_ref, response_object, logging,
-                          audio_processor_buffer());
+                          audio_processor_buffer(), false);
     }
 
     /**
@@ -228,9 +241,9 @@ class Vst3Sockets final : public Sockets {
         const MessageReference<T>& request_ref,
         typename T::Response& response_ref,
         std::optional<std::pair<Vst3Logger&, bool>> logging) {
-        return audio_processor_sockets_.at(request_ref.get().instance_id)
+        return audio_processor_handler(request_ref.get().instance_id)
             .receive_into(request_ref, response_ref, logging,
-                          audio_processor_buffer());
+                          audio_processor_buffer(), false);
     }
 
     /**
@@ -261,11 +274,31 @@ class Vst3Sockets final : public Sockets {
      * is being sent.
      */
     SerializationBufferBase& audio_processor_buffer() {
-        thread_local SerializationBuffer<2048> audio_processor_buffer{};
+        thread_local SerializationBuffer<capacities::audio_message_buffer>
+            audio_processor_buffer{};
+
+        // The capacity only exceeds the initial size when a message didn't
+        // fit, which is exactly what the profile needs to know to size the
+        // buffer for the next build
+        CapacityProfile::observe(CapacityCounter::audio_message_buffer,
+                                 audio_processor_buffer.capacity());
 
         return audio_processor_buffer;
     }
 
+    /**
+     * Look up the handler for an instance's dedicated audio processor socket.
+     * This takes a shared lock, since with a hundred or more instances the
+     * host may well be instantiating new plugin objects (which rehashes the
+     * map) while other instances are processing audio.
+     */
+    TypedMessageHandler<Thread, Vst3Logger, Vst3AudioProcessorRequest>&
+    audio_processor_handler(size_t instance_id) {
+        std::shared_lock lock(audio_processor_sockets_mutex_);
+
+        return *audio_processor_sockets_.at(instance_id);
+    }
+
     asio::io_context& io_context_;
 
     /**
@@ -273,10 +306,22 @@ class Vst3Sockets final : public Sockets {
      * both of those) will get a dedicated socket. These functions are always
      * called in a hot loop, so there should not be any waiting or additional
      * thread or socket creation happening there.
+     *
+     * The handlers are stored behind a `unique_ptr` so references to them stay
+     * valid when the map rehashes as more instances get added.
+     *
+     * NOTE: Multiplexing all instances onto a single connection would need an
+     *       instance ID routing layer, and more importantly it would break the
+     *       invariant that every instance's messages are deserialized by the
+     *       same thread into the same persistent request object, which the
+     *       allocation-free processing path and the parameter layout delta
+     *       encoding both rely on. The parked per-instance threads are cheap
+     *       in comparison.
      */
     std::unordered_map<
         size_t,
-        TypedMessageHandler<Thread, Vst3Logger, Vst3AudioProcessorRequest>>
+        std::unique_ptr<
+            TypedMessageHandler<Thread, Vst3Logger, Vst3AudioProcessorRequest>>>
         audio_processor_sockets_;
-    std::mutex audio_processor_sockets_mutex_;
+    std::shared_mutex audio_processor_sockets_mutex_;
 };
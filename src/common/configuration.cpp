@@ -17,13 +17,98 @@
 #include "configuration.h"
 
 #include <fnmatch.h>
+#include <cctype>
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
 
 #include "toml++.h"
 #include "utils.h"
 
 namespace fs = ghc::filesystem;
 
+/**
+ * Parse a `yabridge.toml` file, or reuse a previously parsed copy if the file
+ * has not been modified since. Every plugin instance parses its configuration
+ * file during initialization, so without this a session with a hundred
+ * instances would run the TOML parser a hundred times on the exact same file.
+ * The glob matching over the parsed sections still happens per instance since
+ * it depends on the plugin's path. Because entries are keyed on the file's
+ * modification time, editing the file still takes effect for every instance
+ * loaded after the change without needing any file watchers.
+ *
+ * @throw toml::parse_error If the file could not be parsed.
+ */
+static toml::table parse_config_file(const fs::path& config_path) {
+    static std::mutex parse_cache_mutex;
+    static std::unordered_map<std::string, std::pair<int64_t, toml::table>>
+        parse_cache;
+
+    std::error_code err;
+    const fs::file_time_type mtime = fs::last_write_time(config_path, err);
+    if (err) {
+        return toml::parse_file(config_path.string());
+    }
+    const int64_t mtime_ticks = mtime.time_since_epoch().count();
+
+    {
+        std::lock_guard lock(parse_cache_mutex);
+        if (const auto it = parse_cache.find(config_path.string());
+            it != parse_cache.end() && it->second.first == mtime_ticks) {
+            return it->second.second;
+        }
+    }
+
+    toml::table table = toml::parse_file(config_path.string());
+
+    {
+        std::lock_guard lock(parse_cache_mutex);
+        parse_cache[config_path.string()] = std::pair(mtime_ticks, table);
+    }
+
+    return table;
+}
+
+/**
+ * Detect which host adaptation profile applies to the host this plugin is
+ * being loaded in, based on the name of the process's executable. Since
+ * yabridge is a library loaded into the host, that executable is the host
+ * binary itself. Returns a nullopt when the host isn't one we ship a profile
+ * for.
+ *
+ * @see Configuration::apply_host_profile
+ */
+static std::optional<std::string> detect_host_profile() noexcept {
+    std::error_code err;
+    const fs::path host_binary = fs::read_symlink("/proc/self/exe", err);
+    if (err) {
+        return std::nullopt;
+    }
+
+    // Hosts ship differently named binaries across versions and
+    // distributions (e.g. `reaper`, `REAPER`, `BitwigPluginHost-X64`,
+    // `ardour-8.6.0`), so the matching is deliberately loose
+    std::string host_name = host_binary.filename().string();
+    for (char& character : host_name) {
+        character = static_cast<char>(
+            std::tolower(static_cast<unsigned char>(character)));
+    }
+
+    if (host_name.find("reaper") != std::string::npos) {
+        return "reaper";
+    }
+    if (host_name.find("bitwig") != std::string::npos) {
+        return "bitwig";
+    }
+    // Mixbus is built on top of Ardour and talks to plugins the same way
+    if (host_name.find("ardour") != std::string::npos ||
+        host_name.find("mixbus") != std::string::npos) {
+        return "ardour";
+    }
+
+    return std::nullopt;
+}
+
 Configuration::Configuration() noexcept {}
 
 Configuration::Configuration(const fs::path& config_path,
@@ -34,7 +119,7 @@ Configuration::Configuration(const fs::path& config_path,
     // otherwise be impossible to spot. We'll also have to sort all tables by
     // the location in the file since tomlplusplus internally uses ordered maps
     // so otherwise we'll get the tables sorted by key instead.
-    toml::table table = toml::parse_file(config_path.string());
+    toml::table table = parse_config_file(config_path);
 
     // This table stores its children in an ordered map and it will thus be
     // sorted lexicographically. For our uses we want sections from the start of
@@ -72,16 +157,160 @@ Configuration::Configuration(const fs::path& config_path,
         matched_file = config_path;
         matched_pattern = pattern;
 
+        // The `profile` key needs to be handled before all other options,
+        // since host adaptation profiles provide alternative defaults that
+        // explicitly configured options should always override
+        if (const toml::node* profile_node = table.get("profile")) {
+            if (const auto parsed_value = profile_node->as_string()) {
+                profile = parsed_value->get();
+            } else {
+                invalid_options.emplace_back("profile");
+            }
+        }
+        apply_host_profile();
+
         // If the table is missing some fields then they will simply be left at
         // their defaults. At this point I'd really wish C++ could do pattern
         // matching.
         for (const auto& [key, value] : table) {
-            if (key == "group") {
+            if (key == "async_state_transitions") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    async_state_transitions = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_affinity") {
+                if (const auto parsed_value = value.as_string()) {
+                    audio_affinity = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_busy_poll") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    audio_busy_poll = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_deadline_ms") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    audio_deadline_ms =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_gang_dispatch") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    audio_gang_dispatch = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_huge_pages") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    audio_huge_pages = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_pipelining") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    audio_pipelining = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_spin_us") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    audio_spin_us = static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_zero_copy_input") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    audio_zero_copy_input = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "audio_zero_copy_output") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    audio_zero_copy_output = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "automate_coalesce") {
+                // This option takes either a boolean, which uses a window of
+                // one audio block, or a fixed window in milliseconds
+                if (const auto parsed_value = value.as_boolean()) {
+                    if (*parsed_value) {
+                        automate_coalesce = 0;
+                    } else {
+                        automate_coalesce = std::nullopt;
+                    }
+                } else if (const auto parsed_value = value.as_integer();
+                           parsed_value && parsed_value->get() > 0) {
+                    automate_coalesce =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "bypass_passthrough") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    bypass_passthrough = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "group") {
                 if (const auto parsed_value = value.as_string()) {
                     group = parsed_value->get();
                 } else {
                     invalid_options.emplace_back(key);
                 }
+            } else if (key == "group_cpu_quota") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    group_cpu_quota =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "group_cpus") {
+                if (const auto parsed_value = value.as_string()) {
+                    group_cpus = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "group_daemon") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    group_daemon = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "group_memory_limit") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    group_memory_limit =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "group_shards") {
+                // This option takes either a shard count or the string
+                // `"auto"`, which creates one shard per last level cache
+                // cluster
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    group_shards = static_cast<uint32_t>(parsed_value->get());
+                } else if (const auto parsed_value = value.as_string();
+                           parsed_value && parsed_value->get() == "auto") {
+                    group_shards = static_cast<uint32_t>(llc_cluster_count());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "group_trusted") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    group_trusted = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
             } else if (key == "disable_pipes") {
                 // This option can be either enabled or disable with a boolean,
                 // or it can be set to an absolute path
@@ -103,6 +332,12 @@ Configuration::Configuration(const fs::path& config_path,
                 } else {
                     invalid_options.emplace_back(key);
                 }
+            } else if (key == "editor_deferred_open") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    editor_deferred_open = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
             } else if (key == "editor_disable_host_scaling") {
                 if (const auto parsed_value = value.as_boolean()) {
                     editor_disable_host_scaling = parsed_value->get();
@@ -115,6 +350,14 @@ Configuration::Configuration(const fs::path& config_path,
                 } else {
                     invalid_options.emplace_back(key);
                 }
+            } else if (key == "editor_keepalive_ms") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    editor_keepalive_ms =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
             } else if (key == "editor_xembed") {
                 if (const auto parsed_value = value.as_boolean()) {
                     editor_xembed = parsed_value->get();
@@ -132,18 +375,105 @@ Configuration::Configuration(const fs::path& config_path,
                 } else {
                     invalid_options.emplace_back(key);
                 }
+            } else if (key == "hibernate_after") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    hibernate_after =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
             } else if (key == "hide_daw") {
                 if (const auto parsed_value = value.as_boolean()) {
                     hide_daw = parsed_value->get();
                 } else {
                     invalid_options.emplace_back(key);
                 }
+            } else if (key == "main_affinity") {
+                if (const auto parsed_value = value.as_string()) {
+                    main_affinity = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "notification_dedup_ms") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    notification_dedup_ms =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "numa_node") {
+                // This option takes either a node number or the string
+                // `"auto"`, which resolves to the node of the thread that's
+                // loading the plugin. Since we're being loaded by the host,
+                // that's one of the host's own threads.
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    numa_node = static_cast<uint32_t>(parsed_value->get());
+                } else if (const auto parsed_value = value.as_string();
+                           parsed_value && parsed_value->get() == "auto") {
+                    numa_node = current_numa_node();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "offline_direct_processing") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    offline_direct_processing = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "overload_priority") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    overload_priority =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "profile") {
+                // Already handled above, since the profile's defaults have
+                // to be applied before the other options
+            } else if (key == "shared_sidechain") {
+                if (const auto parsed_value = value.as_string()) {
+                    shared_sidechain = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "snapshot_interval") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    snapshot_interval =
+                        static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "spare_sockets") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    spare_sockets = static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
             } else if (key == "vst3_prefer_32bit") {
                 if (const auto parsed_value = value.as_boolean()) {
                     vst3_prefer_32bit = parsed_value->get();
                 } else {
                     invalid_options.emplace_back(key);
                 }
+            } else if (key == "vst3_sample_accurate_splitting") {
+                if (const auto parsed_value = value.as_boolean()) {
+                    vst3_sample_accurate_splitting = parsed_value->get();
+                } else {
+                    invalid_options.emplace_back(key);
+                }
+            } else if (key == "warm_hosts") {
+                if (const auto parsed_value = value.as_integer();
+                    parsed_value && parsed_value->get() >= 0) {
+                    warm_hosts = static_cast<uint32_t>(parsed_value->get());
+                } else {
+                    invalid_options.emplace_back(key);
+                }
             } else {
                 unknown_options.emplace_back(key);
             }
@@ -151,6 +481,59 @@ Configuration::Configuration(const fs::path& config_path,
 
         break;
     }
+
+    // When no section in the file matches this plugin, the host's profile
+    // still applies, just like when there's no `yabridge.toml` at all
+    if (!matched_file) {
+        apply_host_profile();
+    }
+}
+
+void Configuration::apply_host_profile() noexcept {
+    if (profile && *profile == "none") {
+        return;
+    }
+
+    const std::optional<std::string> profile_name =
+        profile ? profile : detect_host_profile();
+    if (!profile_name) {
+        return;
+    }
+
+    if (*profile_name == "reaper") {
+        // REAPER implements (but doesn't use) drag-and-drop on its FX
+        // windows, which would otherwise swallow files dragged onto plugin
+        // editors
+        editor_force_dnd = true;
+        // REAPER polls every visible parameter at UI rate, so host callbacks
+        // regularly overlap with dispatcher calls while an editor is open
+        spare_sockets = 2;
+        // By default REAPER doesn't split its blocks for sample-accurate
+        // automation, so splitting them on the Wine side sends the
+        // automation curves in a single round trip per block
+        vst3_sample_accurate_splitting = true;
+    } else if (*profile_name == "bitwig") {
+        // Bitwig streams note expressions and parameter changes from its own
+        // engine threads, so concurrent calls on the secondary sockets are
+        // the norm rather than the exception. Bitwig already splits its
+        // blocks sample-accurately itself, so no Wine side splitting is
+        // needed.
+        spare_sockets = 2;
+    } else if (*profile_name == "ardour") {
+        // Ardour splits blocks at automation points itself, so the audio
+        // round trips are often much smaller than the configured buffer
+        // size. A short busy-wait keeps the scheduler wakeup latency from
+        // dominating those small blocks.
+        audio_spin_us = 50;
+        spare_sockets = 1;
+    } else {
+        // An explicitly configured profile we don't know about gets reported
+        // the same way as an option with a wrong argument type
+        invalid_options.emplace_back("profile");
+        return;
+    }
+
+    matched_profile = profile_name;
 }
 
 std::chrono::steady_clock::duration Configuration::event_loop_interval()
@@ -78,6 +78,249 @@ class Configuration {
      */
     std::optional<std::string> group;
 
+    /**
+     * If enabled, the group host process will keep running as a daemon after
+     * all plugins have exited instead of shutting down after a few seconds of
+     * being idle. Since the process also sticks around with Wine fully booted
+     * before the first plugin in a session gets loaded, this makes even that
+     * first instantiation near-instant. The group host can also be started
+     * ahead of time, for instance from a login script, by passing `daemon` as
+     * a third argument to `yabridge-host.exe group`. This option has no effect
+     * when the `group` setting is not also set.
+     */
+    bool group_daemon = false;
+
+    /**
+     * When set to a nonzero percentage, the Wine plugin host process's total
+     * CPU time is capped at this percentage of a single CPU, so `150` allows
+     * one and a half cores worth of processing. This uses a cgroup v2 CPU
+     * quota and thus requires the cgroup hierarchy to be delegated, for
+     * instance by running the group host as a daemon under a systemd user
+     * service. Like `frame_rate`, the whole host process shares one quota, so
+     * for plugin groups the first loaded plugin's setting wins.
+     */
+    uint32_t group_cpu_quota = 0;
+
+    /**
+     * When set, the entire Wine plugin host process is restricted to this set
+     * of CPUs, using the same `taskset(1)` list format as `audio_affinity`.
+     * Unlike `audio_affinity` and `main_affinity` this covers every thread in
+     * the process, including threads spawned by the plugins themselves. This
+     * uses the cgroup v2 cpuset controller when it's delegated and falls back
+     * to regular scheduler affinity otherwise. The per-thread affinity
+     * options can still narrow this down further for individual threads.
+     */
+    std::optional<std::string> group_cpus;
+
+    /**
+     * When set to a nonzero number of MiB, the Wine plugin host process's
+     * memory use is capped at this limit through a cgroup v2 memory limit.
+     * Like `group_cpu_quota` this requires a delegated cgroup hierarchy, and
+     * the first loaded plugin's setting wins for plugin groups.
+     */
+    uint32_t group_memory_limit = 0;
+
+    /**
+     * When set to a value larger than one, a declared plugin group is
+     * transparently split across this many host processes. Grouping
+     * everything into one process saves memory, but a huge group eventually
+     * bottlenecks on that single process's main thread. With sharding every
+     * plugin is deterministically assigned to a shard based on its file path,
+     * so all instances of the same plugin still end up in the same process
+     * and can keep communicating with each other. The value is either a shard
+     * count or the string `"auto"`, which creates one shard per last level
+     * cache cluster so each process's threads stay within a CCX/LLC domain.
+     */
+    uint32_t group_shards = 0;
+
+    /**
+     * If enabled, the group host process skips the watchdog that
+     * periodically checks whether the native host processes behind its
+     * hosted plugins are still running, leaving the passive shared memory
+     * heartbeat as the only liveness signal. This removes the watchdog's
+     * monitor thread and the mutex it takes on plugin lifetime paths. Only
+     * meant for locked-down setups like render farms where something else
+     * already manages the host processes: if a native host dies without
+     * cleaning up, its plugins in the group host will linger. This option
+     * has no effect when the `group` setting is not also set.
+     */
+    bool group_trusted = false;
+
+    /**
+     * If enabled, activation and processing state transitions
+     * (`IAudioProcessor::setProcessing()` and `IComponent::setActive()` for
+     * VST3 plugins, `clap_plugin::start_processing()`/`stop_processing()`
+     * for CLAP plugins) are sent from a background thread while the calling
+     * thread continues immediately, and the next processing call waits for
+     * the transition to finish. Hosts toggle these on their audio threads
+     * when enabling or disabling tracks, and waiting for a full round trip
+     * per instance there causes audible hiccups when many instances get
+     * toggled at once. This is not enabled by default because the host
+     * always sees the transition succeed: the actual result only arrives
+     * later and can then only be logged, and queries the host makes before
+     * the next processing call may reach the plugin while the transition is
+     * still in progress.
+     */
+    bool async_state_transitions = false;
+
+    /**
+     * When set, the Wine plugin host's audio threads will be pinned to this
+     * set of CPUs. The value uses the same list format as `taskset(1)`, so
+     * `"2,4-7"` restricts the threads to CPUs 2 and 4 through 7. This can be
+     * used together with `main_affinity` to co-locate a plugin's threads on
+     * sibling cores, or to keep the bridged processing away from cores that
+     * are reserved for the host. Only the Wine side is pinned: on the native
+     * side the audio calls run on the host's own audio threads, and we should
+     * never touch those.
+     */
+    std::optional<std::string> audio_affinity;
+
+    /**
+     * If enabled, both sides of the shared memory audio doorbell will poll
+     * the doorbell's status words indefinitely instead of ever touching a
+     * futex, making the steady-state audio handoff completely free of
+     * syscalls. Unlike `audio_spin_us` there's no fallback to a blocking
+     * wait, so the Wine side burns a full core whenever the host is
+     * processing audio. This should therefore only be used together with
+     * `audio_affinity` to give that polling loop a dedicated core. Meant for
+     * ultra low latency setups running at very small buffer sizes, where
+     * even a generous spin budget occasionally misses and eats a scheduler
+     * wakeup. Currently only used for VST2 plugins, since those use the
+     * doorbell based audio processing path.
+     */
+    bool audio_busy_poll = false;
+
+    /**
+     * When set to a nonzero number of milliseconds, a processing call that
+     * hasn't received its response from the Wine plugin host within this
+     * deadline returns silence to the host instead of blocking. The late
+     * block is discarded when it does arrive, and processing resumes with
+     * the next block after that. This turns a plugin hanging inside its
+     * process function into an isolated, logged glitch on that one instance
+     * instead of a frozen session, at the cost of dropped audio whenever the
+     * deadline is set tighter than the plugin's actual worst case. This is
+     * not enabled by default because a plugin's state can end up out of sync
+     * with the audio the host has received whenever blocks get dropped.
+     * Currently only used for VST2 plugins, since those use the doorbell
+     * based audio processing path.
+     */
+    uint32_t audio_deadline_ms = 0;
+
+    /**
+     * If enabled, all plugins hosted in the same group host process will
+     * funnel their audio processing rings through one shared gang doorbell.
+     * DAWs process their tracks in parallel, so at every block boundary the
+     * group host normally eats one scheduler wakeup per instance before any
+     * audio has been processed. With gang dispatch a single listener thread
+     * wakes up once, finds every instance that rang, and fans the processing
+     * calls out to the worker pool. Currently only used for VST2 plugins,
+     * since those use the doorbell based audio processing path.
+     */
+    bool audio_gang_dispatch = false;
+
+    /**
+     * If enabled, the shared memory audio buffers will be backed by
+     * transparent huge pages where the kernel allows it. The buffers are
+     * already locked into memory when the user's memlock limits permit, but
+     * with many large multi-bus 64-bit instances the regular 4 KiB pages can
+     * still cause TLB pressure during the per-block copies. Requires
+     * `/sys/kernel/mm/transparent_hugepage/shmem_enabled` to be set to
+     * `advise` (or `always`/`within_size`) to have any effect.
+     */
+    bool audio_huge_pages = false;
+
+    /**
+     * If enabled, audio processing will be pipelined with one block of
+     * latency. The native plugin side then writes the next block's inputs to
+     * one bank of the shared memory audio buffers while the Wine plugin host
+     * is still processing the other bank, and the host receives the previous
+     * block's outputs. This overlaps the host-side copies with the Wine-side
+     * processing at the cost of one buffer of added latency, which can help a
+     * lot in sessions running many bridged instances. Currently supported for
+     * VST2 plugins.
+     */
+    bool audio_pipelining = false;
+
+    /**
+     * When set to a nonzero number of microseconds, both sides of the shared
+     * memory audio doorbell will busy-wait for that long before falling back
+     * to a blocking futex wait. This trades CPU time for shaving the
+     * scheduler wakeup latency off of every audio round trip, which can be
+     * worthwhile in low latency setups running at very small buffer sizes.
+     * Currently only used for VST2 plugins, since those use the doorbell
+     * based audio processing path.
+     */
+    uint32_t audio_spin_us = 0;
+
+    /**
+     * If enabled, yabridge tries to detect whether the host's input buffers
+     * live in shared, file backed memory (as they do for hosts that run
+     * their processing graph directly on PipeWire's memfd backed buffers).
+     * When they do, the Wine plugin host maps those buffers read-only and
+     * the plugin reads the inputs straight from the host's own memory,
+     * skipping the input copy into the shared memory audio buffers entirely.
+     * The copy path remains the automatic fallback whenever the detection
+     * fails or the host starts processing from different buffers. This is
+     * not enabled by default because most hosts use plain private memory for
+     * their buffers (in which case this option simply does nothing), and
+     * because the rare misbehaving plugin that writes to its input buffers
+     * would crash on the read-only mapping instead of getting away with it.
+     * Has no effect in combination with `audio_pipelining`, since that mode
+     * hands the host's buffers back before the Wine side is done reading
+     * them. Currently only supported for VST2 plugins.
+     */
+    bool audio_zero_copy_input = false;
+
+    /**
+     * The output counterpart to `audio_zero_copy_input`. If enabled and the
+     * host's output buffers turn out to live in shared, file backed memory,
+     * the Wine plugin host maps those buffers read-write and the plugin
+     * writes its outputs straight into the host's own memory before the Wine
+     * side signals completion. The native side's work after waking up then
+     * shrinks to a flag check instead of a copy on the host's audio thread.
+     * The copy path remains the automatic fallback whenever the detection
+     * fails or the host starts processing from different buffers. Like the
+     * input variant this does nothing for hosts using plain private memory,
+     * has no effect in combination with `audio_pipelining`, and is also
+     * skipped when `audio_deadline_ms` is set since a block that misses its
+     * deadline could otherwise still write into buffers the host has already
+     * moved on from. Only used for the `processReplacing()` code path, the
+     * ancient accumulating `process()` always copies. Currently only
+     * supported for VST2 plugins.
+     */
+    bool audio_zero_copy_output = false;
+
+    /**
+     * When set, successive `audioMasterAutomate()` callbacks for the same
+     * parameter are coalesced on the Wine side: the first callback in a burst
+     * is forwarded immediately, and further value changes within the window
+     * only forward the most recent value once the window expires. Plugins
+     * with internal MIDI learn fire this callback for every control tick, so
+     * a hardware controller sweep otherwise generates thousands of callback
+     * round trips per second. Setting the option to `true` uses a window of
+     * one audio block, the value can also be a number of milliseconds for a
+     * fixed window (stored here, with `0` meaning the one-block default).
+     * This is not enabled by default because the host no longer records
+     * every intermediate automation value, just a sample of the sweep at
+     * most one window apart. Currently supported for VST2 plugins.
+     */
+    std::optional<uint32_t> automate_coalesce;
+
+    /**
+     * If enabled, blocks where the host has engaged the plugin's soft bypass
+     * through `effSetBypass()` are handled on the native side by copying the
+     * inputs straight to the outputs, skipping the round trip to the Wine
+     * plugin host entirely. Blocks whose inputs are digital silence are
+     * handled the same way when the plugin has declared that it has no tail.
+     * Both shortcuts only apply while the plugin reports no latency, since a
+     * plain copy would otherwise break the host's delay compensation. This is
+     * not enabled by default because the bypassed plugin no longer runs at
+     * all: metering and other UI animations freeze, and plugins that
+     * crossfade their bypass will have that transition cut short. Currently
+     * only supported for VST2 plugins.
+     */
+    bool bypass_passthrough = false;
+
     /**
      * If enabled, we'll redirect the plugin's STDOUT and STDERR streams to this
      * file instead of using pipes to intersperse it with yabridge's other
@@ -103,6 +346,22 @@ class Configuration {
      */
     bool editor_coordinate_hack = false;
 
+    /**
+     * If set to `true`, `effEditOpen()` returns to the host immediately and
+     * the plugin's actual editor creation runs right afterwards on the Wine
+     * plugin host's GUI thread. Some plugins take hundreds of milliseconds
+     * to build their GUI, and all of that time normally blocks the host's UI
+     * thread. The host's already embedded wrapper window acts as a
+     * placeholder until the plugin has embedded itself into it. Any
+     * subsequent editor interaction waits for the deferred open to finish
+     * first, so hosts that query `effEditGetRect()` right after opening the
+     * editor won't see any benefit from this. Currently supported for VST2
+     * plugins. This is not enabled by default because the host is told that
+     * the editor opened before the plugin got the chance to refuse, although
+     * plugins that advertise an editor in practice never do.
+     */
+    bool editor_deferred_open = false;
+
     /**
      * If set to `true`, we'll remove the `XdndAware` property all ancestor
      * windows in `editor.cpp`. This is needed for REAPER as REAPER implements
@@ -112,6 +371,19 @@ class Configuration {
      */
     bool editor_force_dnd = false;
 
+    /**
+     * When set to a nonzero number of milliseconds, closing a plugin's editor
+     * keeps the editor's window tree alive but hidden for this long instead
+     * of destroying it. Reopening the editor within that period reuses the
+     * parked windows, skipping the Win32 window creation and the X11
+     * embedding dance that otherwise make reopening a GUI noticeably slower
+     * than it is for native plugins. The parked windows are destroyed when
+     * the period expires without a reopen. This is not enabled by default
+     * because the rare plugin that expects a freshly created window on every
+     * `effEditOpen()` could misbehave when handed the same window again.
+     */
+    uint32_t editor_keepalive_ms = 0;
+
     /**
      * Use XEmbed instead of yabridge's normal editor embedding method. Wine's
      * XEmbed support is not very polished yet and tends to lead to rendering
@@ -124,14 +396,29 @@ class Configuration {
      * The number of times per second we'll handle the event loop. In most
      * plugins this also controls the plugin editor GUI's refresh rate.
      *
-     * This defaults to 60 fps, but we'll store it in an optional as we only
-     * want to show it in the startup message if this setting has explicitly
-     * been set.
+     * When not set, the Wine plugin host fills this in with the refresh rate
+     * of the fastest connected display, falling back to 60 fps when that
+     * cannot be detected. We'll store it in an optional as we only want to
+     * show it in the startup message if this setting has explicitly been
+     * set.
      *
      * @relates event_loop_interval
      */
     std::optional<float> frame_rate;
 
+    /**
+     * When set to a nonzero number of seconds, the Wine plugin host suspends
+     * a plugin instance after it hasn't processed any audio for this long,
+     * and the backing pages of the shared memory audio buffers are released.
+     * Big template sessions keep hundreds of bridged instances alive but
+     * silent for hours, and a suspended plugin can free its internal
+     * processing buffers. The instance is resumed transparently when the
+     * next audio block arrives or when its editor gets opened. Instances
+     * whose editor is already open are never hibernated. Currently supported
+     * for VST2 plugins.
+     */
+    uint32_t hibernate_after = 0;
+
     /**
      * When this option is enabled, we'll report some random other string
      * instead of the actual name of the host when the plugin queries it. This
@@ -141,6 +428,78 @@ class Configuration {
      */
     bool hide_daw = false;
 
+    /**
+     * When set, the Wine plugin host's main GUI and event loop thread as well
+     * as the native plugin's host callback handling threads will be pinned to
+     * this set of CPUs, using the same `taskset(1)` list format as
+     * `audio_affinity`. Since the main thread is shared by every plugin in a
+     * plugin group, the setting from the last loaded plugin wins there, just
+     * like `frame_rate`.
+     */
+    std::optional<std::string> main_affinity;
+
+    /**
+     * When set to a nonzero number of milliseconds, identical change
+     * notifications fired by the plugin in rapid succession
+     * (`audioMasterIOChanged()`, `IComponentHandler::restartComponent()`
+     * with the same flags, and the CLAP rescan and latency callbacks)
+     * collapse into a single forwarded callback per window. Some plugins
+     * fire dozens of these during a preset load, and every one of them
+     * costs a bridged round trip plus an expensive re-query or graph
+     * rebuild on the host's side. The first notification of a burst is
+     * always forwarded immediately, and when later identical ones were
+     * absorbed a single trailing notification follows once the window
+     * closes, so the host's final re-query still observes the plugin's
+     * settled state. Notifications that differ from the last forwarded one
+     * are never held back.
+     */
+    uint32_t notification_dedup_ms = 0;
+
+    /**
+     * When set, the Wine plugin host process will be pinned to the CPUs of
+     * this NUMA node, and the shared memory audio buffers will have their
+     * pages placed on the same node. On multi-socket machines those pages
+     * otherwise end up on whichever node happened to fault them in first,
+     * leaving one side of the bridge doing remote memory accesses on every
+     * processed block. The value is either a node number or the string
+     * `"auto"`, in which case the node of the thread that loaded the plugin
+     * is used. Explicit `audio_affinity` and `main_affinity` lists still
+     * override the CPU pinning per thread.
+     */
+    std::optional<uint32_t> numa_node;
+
+    /**
+     * If enabled, offline (faster-than-realtime) rendering runs directly on
+     * the instance's dedicated Wine audio thread instead of being handed off
+     * to the GUI thread for every block. That detour exists purely as a
+     * precaution for plugins like T-RackS 5 that hang when offline processing
+     * happens on an audio thread, but it costs two extra thread hand-offs per
+     * block and makes the render compete with GUI and event loop work. With
+     * this option set consecutive offline blocks are processed back-to-back
+     * on a single thread, which can speed up bounces considerably in
+     * IPC-bound sessions. Supported for VST3 and CLAP plugins, since those
+     * are the versions with the GUI thread precaution.
+     */
+    bool offline_direct_processing = false;
+
+    /**
+     * This instance's priority for the process wide overload governor. When
+     * a session overloads the CPU every instance misses its deadlines
+     * equally and the whole mix glitches at once, while the user would
+     * usually rather sacrifice a background layer than the master bus.
+     * Instances in a plugin group that set this option report every block's
+     * processing time against its real time budget, and when a sustained
+     * share of blocks overruns that budget, the instance with the lowest
+     * priority gets switched into an economy mode where its blocks are
+     * bypassed (inputs copied to the outputs) instead of processed, freeing
+     * up its entire DSP cost. The governor keeps degrading instances from
+     * the bottom up while the overload persists and restores them from the
+     * top down once the load has stayed down for a while. Instances that
+     * don't set this option never take part and are never degraded.
+     * Currently only supported for VST2 plugins.
+     */
+    std::optional<uint32_t> overload_priority;
+
     /**
      * Disable `IPlugViewContentScaleSupport::setContentScaleFactor()`. Wine
      * does not properly implement fractional DPI scaling, so without this
@@ -152,6 +511,63 @@ class Configuration {
      */
     bool editor_disable_host_scaling = false;
 
+    /**
+     * The name of the host adaptation profile to use. Every host stresses the
+     * bridge differently, so yabridge ships tuned defaults for a few known
+     * hosts that get applied automatically based on the name of the host's
+     * executable. A profile only provides alternative defaults: any option
+     * that's set explicitly in `yabridge.toml` always takes precedence. This
+     * option can be used to force a specific profile, and setting it to
+     * `"none"` disables the automatic detection altogether. The profile that
+     * ended up being applied is stored in `matched_profile`.
+     *
+     * @see apply_host_profile
+     */
+    std::optional<std::string> profile;
+
+    /**
+     * When set, all of this plugin's auxiliary (sidechain) input busses are
+     * backed by a single shared memory region shared with every other
+     * instance in the same plugin group that uses the same tag, and only one
+     * of those instances copies the sidechain samples each block. This is an
+     * opt-in assertion by the user that the host routes the exact same bus as
+     * sidechain input to all tagged instances: when ten bridged compressors
+     * listen to the same bus, the host otherwise writes identical samples
+     * into ten separate regions every block. Instances whose sidechain
+     * layouts or buffer sizes don't match automatically end up in separate
+     * regions, so a wrong tag degrades back to per-instance copies rather
+     * than corrupting audio. Currently supported for VST3 plugins.
+     */
+    std::optional<std::string> shared_sidechain;
+
+    /**
+     * When set to a nonzero number of seconds, the Wine plugin host
+     * periodically saves a snapshot of the plugin's state (its
+     * `effGetChunk()` data) to a spool directory, and it removes that
+     * snapshot again on a clean shutdown. When one plugin takes down a group
+     * host process, every plugin in the group dies with it along with any
+     * unsaved tweaks. With snapshots enabled, reloading those plugins
+     * restores the last snapshot left behind by the crashed process
+     * automatically. A host that restores its own saved state afterwards
+     * still wins, since that restore happens after the plugin has been
+     * loaded. Currently supported for VST2 plugins.
+     */
+    uint32_t snapshot_interval = 0;
+
+    /**
+     * The number of spare secondary socket connections to keep around for the
+     * sockets that handle concurrent dispatcher and host callback calls. When
+     * two requests on such a socket overlap (for instance when a plugin's GUI
+     * is opened while automation is running), the second request normally has
+     * to establish a new socket connection, and the other side has to spawn a
+     * thread to handle it. With this option set those connections are
+     * established ahead of time, with pre-started worker threads parked on the
+     * other end, so concurrent requests never pay any setup costs. Secondary
+     * connections created on demand are always reused, so this option only
+     * affects the first few concurrent requests.
+     */
+    uint32_t spare_sockets = 0;
+
     /**
      * If a merged bundle contains both the 64-bit and the 32-bit versions of a
      * Windows VST3 plugin (in the `x86_64-win` and the `x86-win` directories),
@@ -161,6 +577,32 @@ class Configuration {
      */
     bool vst3_prefer_32bit = false;
 
+    /**
+     * If enabled, the Wine plugin host splits VST3 process calls into
+     * sequential sub-block process calls at the sample offsets of the
+     * incoming automation points, the way hosts that do sample-accurate
+     * automation split their blocks themselves. A host that's configured not
+     * to split its blocks can then send one block with its automation curves
+     * in a single round trip instead of bridging every sub-block separately,
+     * while plugins that only read the first automation point per block still
+     * get sample-accurate values. Sub-blocks are at least 16 samples long and
+     * a block is split at most 32 ways, so pathological per-sample ramps
+     * can't explode into hundreds of process calls.
+     */
+    bool vst3_sample_accurate_splitting = false;
+
+    /**
+     * The number of generic Wine plugin host processes to keep pre-booted per
+     * Wine prefix and architecture. The first plugin load normally pays the
+     * full Wine process startup cost, which can take multiple seconds on a
+     * cold start. With this option set, individually hosted plugins are handed
+     * to one of these pre-booted processes instead of starting a new Wine
+     * process, and a replacement warm host gets spawned in the background to
+     * keep the pool filled. This has no effect on plugins that are part of a
+     * plugin group, since those already share a single long-lived process.
+     */
+    uint32_t warm_hosts = 0;
+
     /**
      * The path to the configuration file that was parsed.
      */
@@ -171,6 +613,14 @@ class Configuration {
      */
     std::optional<std::string> matched_pattern;
 
+    /**
+     * The name of the host adaptation profile that was applied, if any. This
+     * is purely informational, like `matched_file` and `matched_pattern`.
+     *
+     * @see apply_host_profile
+     */
+    std::optional<std::string> matched_profile;
+
     /**
      * Options with a wrong argument type. These will be printed separately from
      * `unknown_options` to avoid confusion.
@@ -184,6 +634,20 @@ class Configuration {
      */
     std::vector<std::string> unknown_options;
 
+    /**
+     * Apply the host adaptation profile named by the `profile` option, or
+     * the profile matching the host this plugin is being loaded in when that
+     * option is not set. The host is detected from the name of this process's
+     * executable, which is the host binary itself since we're a library
+     * loaded into the host. Profiles bundle tuned defaults for the way a
+     * particular host talks to its plugins, so this must be called _before_
+     * options from a matched `yabridge.toml` section are applied: explicitly
+     * configured options always override the profile's defaults. Does
+     * nothing when the host isn't recognized or when the profile is set to
+     * `"none"`.
+     */
+    void apply_host_profile() noexcept;
+
     /**
      * The delay in milliseconds between calls to the event loop and to
      * `effEditIdle` for VST2 plugins. This is based on `frame_rate`.
@@ -194,22 +658,64 @@ class Configuration {
     void serialize(S& s) {
         s.ext(group, bitsery::ext::InPlaceOptional(),
               [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.value1b(group_daemon);
+        s.value4b(group_cpu_quota);
+        s.ext(group_cpus, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.value4b(group_memory_limit);
+        s.value4b(group_shards);
+        s.value1b(group_trusted);
+        s.value1b(async_state_transitions);
+        s.ext(audio_affinity, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.value1b(audio_busy_poll);
+        s.value4b(audio_deadline_ms);
+        s.value1b(audio_gang_dispatch);
+        s.value1b(audio_huge_pages);
+        s.value1b(audio_pipelining);
+        s.value4b(audio_spin_us);
+        s.value1b(audio_zero_copy_input);
+        s.value1b(audio_zero_copy_output);
+        s.ext(automate_coalesce, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.value4b(v); });
+        s.value1b(bypass_passthrough);
 
         s.ext(disable_pipes, bitsery::ext::InPlaceOptional(),
               [](S& s, auto& v) { s.ext(v, bitsery::ext::GhcPath{}); });
         s.value1b(editor_coordinate_hack);
+        s.value1b(editor_deferred_open);
         s.value1b(editor_force_dnd);
+        s.value4b(editor_keepalive_ms);
         s.value1b(editor_xembed);
         s.ext(frame_rate, bitsery::ext::InPlaceOptional(),
               [](S& s, auto& v) { s.value4b(v); });
+        s.value4b(hibernate_after);
         s.value1b(hide_daw);
+        s.ext(main_affinity, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.value4b(notification_dedup_ms);
+        s.ext(numa_node, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.value4b(v); });
+        s.value1b(offline_direct_processing);
+        s.ext(overload_priority, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.value4b(v); });
         s.value1b(editor_disable_host_scaling);
+        s.ext(profile, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.ext(shared_sidechain, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.value4b(snapshot_interval);
+        s.value4b(spare_sockets);
         s.value1b(vst3_prefer_32bit);
+        s.value1b(vst3_sample_accurate_splitting);
+        s.value4b(warm_hosts);
 
         s.ext(matched_file, bitsery::ext::InPlaceOptional(),
               [](S& s, auto& v) { s.ext(v, bitsery::ext::GhcPath{}); });
         s.ext(matched_pattern, bitsery::ext::InPlaceOptional(),
               [](S& s, auto& v) { s.text1b(v, 4096); });
+        s.ext(matched_profile, bitsery::ext::InPlaceOptional(),
+              [](S& s, auto& v) { s.text1b(v, 4096); });
 
         s.container(invalid_options, 1024,
                     [](S& s, auto& v) { s.text1b(v, 4096); });
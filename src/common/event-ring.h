@@ -0,0 +1,184 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * A lock-free single-producer/single-consumer ring buffer for variable sized
+ * records, layered over a region inside one of our shared memory objects.
+ * This is used to pass output events produced by the plugin on the Wine side
+ * back to the native plugin without serializing them as part of the process
+ * response message. The Wine side pushes raw event structs as the plugin
+ * produces them, and the native side drains them when writing the results
+ * back to the host.
+ *
+ * This object is just a view over the shared memory region, so both sides
+ * create their own instance and attach it to the same region. The read and
+ * write positions live inside the region itself as free-running counters on
+ * separate cache lines, which requires the data capacity to be a power of
+ * two. Since there is only ever one producer and one consumer thread per ring
+ * (the audio threads on either side), no further synchronization is needed.
+ */
+class ShmEventRing {
+   public:
+    /**
+     * The space reserved at the start of the region for the read and write
+     * positions. These get their own cache lines so the producer and the
+     * consumer don't false-share.
+     */
+    static constexpr uint32_t header_size = 128;
+
+    /**
+     * The total region size needed for a ring with the given data capacity.
+     * The capacity must be a power of two.
+     */
+    static constexpr uint32_t region_size(uint32_t capacity) noexcept {
+        return header_size + capacity;
+    }
+
+    ShmEventRing() noexcept = default;
+
+    /**
+     * Attach this view to a shared memory region of
+     * `region_size(capacity)` bytes. The side that created the shared memory
+     * object should pass `initialize = true` to reset the positions, the
+     * other side attaches to the already initialized region. This should be
+     * called again after the underlying buffer has been resized, since the
+     * mapping may have moved.
+     */
+    void attach(uint8_t* region, uint32_t capacity, bool initialize) noexcept {
+        // The capacity needs to be a power of two so the free-running
+        // positions can be masked into offsets
+        assert((capacity & (capacity - 1)) == 0);
+
+        header_ = reinterpret_cast<Header*>(region);
+        data_ = region + header_size;
+        capacity_ = capacity;
+
+        if (initialize) {
+            header_->write_pos.store(0, std::memory_order_relaxed);
+            header_->read_pos.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Whether `attach()` has been called on this view.
+     */
+    inline bool attached() const noexcept { return header_ != nullptr; }
+
+    /**
+     * Copy a record into the ring. May only be called from the producer side.
+     *
+     * @return Whether the record fit. When the ring is full the caller should
+     *   fall back to sending the event through the sockets instead.
+     */
+    bool try_push(const void* record, uint32_t size) noexcept {
+        const uint32_t total = aligned_record_size(size);
+
+        const uint32_t read_pos =
+            header_->read_pos.load(std::memory_order_acquire);
+        uint32_t write_pos =
+            header_->write_pos.load(std::memory_order_relaxed);
+
+        // We reserve one extra record header's worth of space in case we need
+        // to write a wrap marker below
+        if (capacity_ - (write_pos - read_pos) < total + record_header_size) {
+            return false;
+        }
+
+        uint32_t offset = write_pos & (capacity_ - 1);
+        if (offset + total > capacity_) {
+            // The record would straddle the end of the region, so we'll write
+            // a wrap marker and continue from the start. Since all records
+            // are padded to eight bytes there's always room for the marker.
+            *reinterpret_cast<uint32_t*>(data_ + offset) = wrap_marker;
+            write_pos += capacity_ - offset;
+            if (capacity_ - (write_pos - read_pos) <
+                total + record_header_size) {
+                return false;
+            }
+
+            offset = 0;
+        }
+
+        *reinterpret_cast<uint32_t*>(data_ + offset) = size;
+        std::memcpy(data_ + offset + record_header_size, record, size);
+        header_->write_pos.store(write_pos + total, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Call `callback` with a `(const uint8_t* record, uint32_t size)` pair
+     * for every record currently in the ring, in push order, and mark them as
+     * consumed. May only be called from the consumer side.
+     */
+    template <typename F>
+    void drain(F&& callback) noexcept {
+        const uint32_t write_pos =
+            header_->write_pos.load(std::memory_order_acquire);
+        uint32_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+
+        while (read_pos != write_pos) {
+            const uint32_t offset = read_pos & (capacity_ - 1);
+            const uint32_t size =
+                *reinterpret_cast<const uint32_t*>(data_ + offset);
+            if (size == wrap_marker) {
+                read_pos += capacity_ - offset;
+                continue;
+            }
+
+            callback(data_ + offset + record_header_size, size);
+            read_pos += aligned_record_size(size);
+        }
+
+        header_->read_pos.store(read_pos, std::memory_order_release);
+    }
+
+   private:
+    /**
+     * Every record is prefixed with its size. The header is padded to eight
+     * bytes so the record data is always eight byte aligned and can be
+     * reinterpreted as an event struct directly.
+     */
+    static constexpr uint32_t record_header_size = 8;
+
+    /**
+     * A size value marking the rest of the region up to the wrap around
+     * point as unused.
+     */
+    static constexpr uint32_t wrap_marker = 0xffffffff;
+
+    static constexpr uint32_t aligned_record_size(uint32_t size) noexcept {
+        return (record_header_size + size + 7) & ~static_cast<uint32_t>(7);
+    }
+
+    struct Header {
+        alignas(64) std::atomic<uint32_t> write_pos;
+        alignas(64) std::atomic<uint32_t> read_pos;
+    };
+
+    static_assert(sizeof(Header) <= header_size);
+
+    Header* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    uint32_t capacity_ = 0;
+};
@@ -0,0 +1,132 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// A binary trace sink for the per-block audio messages. The human-readable
+// logging enabled with `YABRIDGE_DEBUG_LEVEL=2` builds large strings on the
+// audio threads, which makes full tracing expensive under load. When the
+// `YABRIDGE_BINARY_TRACE_FILE` environment variable is set to a file path,
+// the process call traffic is instead appended to that file as fixed-size
+// binary records that can be rendered into the usual human-readable form
+// offline with the `yabridge-trace` tool (`src/tools/trace/main.cpp`). The
+// records use the host machine's native byte order. The file is opened with
+// `O_APPEND` and every record is written in a single `write()` call so
+// multiple processes can safely share it, and the monotonic timestamps share
+// an epoch across those processes. When the environment variable is not set
+// this all reduces to a single branch.
+
+/**
+ * The kind of event a `BinaryTraceRecord` describes.
+ */
+enum class BinaryTraceEventType : uint16_t {
+    vst3_process_request = 1,
+    vst3_process_response = 2,
+    clap_process_request = 3,
+    clap_process_response = 4,
+};
+
+/**
+ * A single fixed-size record in the binary trace file. See the comment at the
+ * top of this file for the format's semantics. `version` should always
+ * contain `binary_trace_format_version` so the offline tool can reject files
+ * written by an incompatible yabridge version.
+ */
+struct BinaryTraceRecord {
+    /**
+     * Monotonic timestamp in microseconds. The offline tool derives call
+     * durations from the deltas between request and response records.
+     */
+    uint64_t timestamp_us;
+
+    /**
+     * The instance ID of the plugin instance the call belongs to, or zero for
+     * response records since those don't carry their instance ID.
+     */
+    uint64_t instance_id;
+
+    /**
+     * The number of (input or output) events in the block.
+     */
+    uint32_t num_events;
+
+    /**
+     * The number of samples in the block, or zero for response records.
+     */
+    uint32_t num_samples;
+
+    uint16_t event_type;
+    uint16_t version;
+
+    /**
+     * The process ID of the writing process, so traces from a plugin group
+     * can be untangled.
+     */
+    uint32_t pid;
+};
+
+constexpr uint16_t binary_trace_format_version = 1;
+
+static_assert(sizeof(BinaryTraceRecord) == 32,
+              "The binary trace record format should stay fixed-size");
+
+/**
+ * Append a record to the binary trace file when binary tracing is enabled,
+ * and do nothing otherwise. Safe to call from the audio threads: the only
+ * work done here is filling a 32 byte struct and a single `write()`.
+ */
+inline void binary_trace_event(BinaryTraceEventType event_type,
+                               uint64_t instance_id,
+                               uint32_t num_events,
+                               uint32_t num_samples) noexcept {
+    static const int trace_fd = []() {
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        const char* trace_path = getenv("YABRIDGE_BINARY_TRACE_FILE");
+        if (!trace_path || trace_path[0] == '\0') {
+            return -1;
+        }
+
+        return open(trace_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    0644);
+    }();
+    if (trace_fd == -1) {
+        return;
+    }
+
+    BinaryTraceRecord record{};
+    record.timestamp_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    record.instance_id = instance_id;
+    record.num_events = num_events;
+    record.num_samples = num_samples;
+    record.event_type = static_cast<uint16_t>(event_type);
+    record.version = binary_trace_format_version;
+    record.pid = static_cast<uint32_t>(getpid());
+
+    // We don't care about the occasional lost record if the disk is full
+    [[maybe_unused]] const ssize_t result =
+        write(trace_fd, &record, sizeof(record));
+}
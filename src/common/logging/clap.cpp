@@ -18,12 +18,15 @@
 
 #include <bitset>
 
+#include "../tracepoints.h"
+#include "binary-trace.h"
+
 ClapLogger::ClapLogger(Logger& generic_logger) : logger_(generic_logger) {}
 
 void ClapLogger::log_extension_query(const char* where,
                                      bool result,
                                      const char* extension_id) {
-    if (logger_.verbosity_ >= Logger::Verbosity::all_events) [[unlikely]] {
+    if (logger_.verbosity() >= Logger::Verbosity::all_events) [[unlikely]] {
         assert(where && extension_id);
 
         std::ostringstream message;
@@ -125,22 +128,10 @@ bool ClapLogger::log_request(bool is_host_plugin,
 
 bool ClapLogger::log_request(
     bool is_host_plugin,
-    const clap::ext::audio_ports::plugin::Count& request) {
-    return log_request_base(is_host_plugin, [&](auto& message) {
-        message << request.instance_id
-                << ": clap_plugin_audio_ports::count(is_input = "
-                << (request.is_input ? "true" : "false") << ")";
-    });
-}
-
-bool ClapLogger::log_request(
-    bool is_host_plugin,
-    const clap::ext::audio_ports::plugin::Get& request) {
+    const clap::ext::audio_ports::plugin::GetPorts& request) {
     return log_request_base(is_host_plugin, [&](auto& message) {
         message << request.instance_id
-                << ": clap_plugin_audio_ports::get(index = " << request.index
-                << "is_input = " << (request.is_input ? "true" : "false")
-                << ", *info)";
+                << ": clap_plugin_audio_ports::get(..., *info) (batched)";
     });
 }
 
@@ -310,22 +301,10 @@ bool ClapLogger::log_request(bool is_host_plugin,
 
 bool ClapLogger::log_request(
     bool is_host_plugin,
-    const clap::ext::note_ports::plugin::Count& request) {
+    const clap::ext::note_ports::plugin::GetPorts& request) {
     return log_request_base(is_host_plugin, [&](auto& message) {
         message << request.instance_id
-                << ": clap_plugin_note_ports::count(is_input = "
-                << (request.is_input ? "true" : "false") << ")";
-    });
-}
-
-bool ClapLogger::log_request(
-    bool is_host_plugin,
-    const clap::ext::note_ports::plugin::Get& request) {
-    return log_request_base(is_host_plugin, [&](auto& message) {
-        message << request.instance_id
-                << ": clap_plugin_note_ports::get(index = " << request.index
-                << "is_input = " << (request.is_input ? "true" : "false")
-                << ", *info)";
+                << ": clap_plugin_note_ports::get(..., *info) (batched)";
     });
 }
 
@@ -413,13 +392,34 @@ bool ClapLogger::log_request(bool is_host_plugin,
     });
 }
 
+bool ClapLogger::log_request(
+    bool is_host_plugin,
+    const clap::ext::state::plugin::SaveContinue& request) {
+    return log_request_base(is_host_plugin, [&](auto& message) {
+        message << request.instance_id
+                << ": clap_plugin_state::save(clap_ostream_t*) (next chunk)";
+    });
+}
+
+bool ClapLogger::log_request(
+    bool is_host_plugin,
+    const clap::ext::state::plugin::LoadChunk& request) {
+    return log_request_base(is_host_plugin, [&](auto& message) {
+        message << request.instance_id
+                << ": clap_plugin_state::load(stream = <clap_istream_t*>) "
+                   "(chunk containing "
+                << request.data.size() << " bytes)";
+    });
+}
+
 bool ClapLogger::log_request(bool is_host_plugin,
                              const clap::ext::state::plugin::Load& request) {
     return log_request_base(is_host_plugin, [&](auto& message) {
         message
             << request.instance_id
-            << ": clap_plugin_state::load(stream = <clap_istream_t* containing "
-            << request.stream.size() << " bytes>)";
+            << ": clap_plugin_state::load(stream = <clap_istream_t*>) (final "
+               "chunk containing "
+            << request.data.size() << " bytes)";
     });
 }
 
@@ -453,9 +453,25 @@ bool ClapLogger::log_request(bool is_host_plugin,
     });
 }
 
+#ifndef YABRIDGE_NO_AUDIO_PATH_LOGGING
 bool ClapLogger::log_request(
     bool is_host_plugin,
     const MessageReference<clap::plugin::Process>& request_wrapper) {
+    binary_trace_event(BinaryTraceEventType::clap_process_request,
+                       request_wrapper.get().instance_id,
+                       static_cast<uint32_t>(
+                           request_wrapper.get().process.in_events_.size()),
+                       request_wrapper.get().process.frames_count_);
+    YABRIDGE_PROBE2(clap_process_request, request_wrapper.get().instance_id,
+                    request_wrapper.get().process.frames_count_);
+
+    // In the sampled logging mode most process calls are skipped to keep the
+    // log volume manageable on long sessions
+    if (!logger_.should_log_sampled_audio_event(
+            request_wrapper.get().process.in_events_.size())) {
+        return false;
+    }
+
     return log_request_base(
         is_host_plugin, Logger::Verbosity::all_events, [&](auto& message) {
             // This is incredibly verbose, but if you're really a plugin that
@@ -520,6 +536,7 @@ bool ClapLogger::log_request(
                     << " events>, out_events = <clap_out_events_t*>>)";
         });
 }
+#endif  // YABRIDGE_NO_AUDIO_PATH_LOGGING
 
 bool ClapLogger::log_request(bool is_host_plugin,
                              const clap::ext::params::plugin::Flush& request) {
@@ -828,16 +845,13 @@ void ClapLogger::log_response(bool is_host_plugin,
 
 void ClapLogger::log_response(
     bool is_host_plugin,
-    const clap::ext::audio_ports::plugin::GetResponse& response) {
+    const clap::ext::audio_ports::plugin::GetPortsResponse& response,
+    bool from_cache) {
     log_response_base(is_host_plugin, [&](auto& message) {
-        if (response.result) {
-            message << "true, <clap_audio_port_info_t* for \""
-                    << response.result->name
-                    << "\", id = " << response.result->id
-                    << ", channel_count = " << response.result->channel_count
-                    << ">";
-        } else {
-            message << "false";
+        message << "<clap_audio_port_info_t*> for " << response.inputs.size()
+                << " input and " << response.outputs.size() << " output ports";
+        if (from_cache) {
+            message << " (from cache)";
         }
     });
 }
@@ -922,13 +936,13 @@ void ClapLogger::log_response(
 
 void ClapLogger::log_response(
     bool is_host_plugin,
-    const clap::ext::note_ports::plugin::GetResponse& response) {
+    const clap::ext::note_ports::plugin::GetPortsResponse& response,
+    bool from_cache) {
     log_response_base(is_host_plugin, [&](auto& message) {
-        if (response.result) {
-            message << "true, <clap_note_port_info_t* for \""
-                    << response.result->name << "\">";
-        } else {
-            message << "false";
+        message << "<clap_note_port_info_t*> for " << response.inputs.size()
+                << " input and " << response.outputs.size() << " output ports";
+        if (from_cache) {
+            message << " (from cache)";
         }
     });
 }
@@ -995,15 +1009,24 @@ void ClapLogger::log_response(
     bool is_host_plugin,
     const clap::ext::state::plugin::SaveResponse& response) {
     log_response_base(is_host_plugin, [&](auto& message) {
-        if (response.result) {
-            message << "true, <clap_ostream_t* containing "
-                    << response.result->size() << " bytes>";
+        if (response.first_chunk) {
+            message << "true, <chunk containing "
+                    << response.first_chunk->data.size() << " bytes"
+                    << (response.first_chunk->is_last ? ", last" : "") << ">";
         } else {
             message << "false";
         }
     });
 }
 
+void ClapLogger::log_response(bool is_host_plugin,
+                              const clap::stream::StreamChunk& response) {
+    log_response_base(is_host_plugin, [&](auto& message) {
+        message << "<chunk containing " << response.data.size() << " bytes"
+                << (response.is_last ? ", last" : "") << ">";
+    });
+}
+
 void ClapLogger::log_response(
     bool is_host_plugin,
     const clap::ext::voice_info::plugin::GetResponse& response) {
@@ -1022,8 +1045,17 @@ void ClapLogger::log_response(
     });
 }
 
+#ifndef YABRIDGE_NO_AUDIO_PATH_LOGGING
 void ClapLogger::log_response(bool is_host_plugin,
                               const clap::plugin::ProcessResponse& response) {
+    binary_trace_event(BinaryTraceEventType::clap_process_response, 0,
+                       response.output_data.out_events
+                           ? static_cast<uint32_t>(
+                                 response.output_data.out_events->size())
+                           : 0,
+                       0);
+    YABRIDGE_PROBE(clap_process_response);
+
     log_response_base(is_host_plugin, [&](auto& message) {
         // This is incredibly verbose, but if you're really a plugin that
         // handles processing in a weird way you're going to need all of this
@@ -1076,6 +1108,7 @@ void ClapLogger::log_response(bool is_host_plugin,
                 << response.output_data.out_events->size() << " events>";
     });
 }
+#endif  // YABRIDGE_NO_AUDIO_PATH_LOGGING
 
 void ClapLogger::log_response(bool is_host_plugin, const Configuration&) {
     log_response_base(is_host_plugin,
@@ -41,7 +41,19 @@ class ClapLogger {
      *
      * @see Logger::verbosity
      */
-    inline Logger::Verbosity verbosity() { return logger_.verbosity_; }
+    inline Logger::Verbosity verbosity() { return logger_.verbosity(); }
+
+    /**
+     * Whether the `log_request()`/`log_response()` overloads below can log
+     * anything at the current verbosity level. Everything they print requires
+     * at least `Verbosity::most_events`, so when this returns false the
+     * message handlers skip those out of line calls - and the argument
+     * evaluation they imply - with a single branch on the relaxed atomic
+     * verbosity load.
+     */
+    inline bool would_log_control_messages() const noexcept {
+        return logger_.verbosity() >= Logger::Verbosity::most_events;
+    }
 
     /**
      * Log calls to `clap_plugin::get_extension()` and
@@ -89,9 +101,7 @@ class ClapLogger {
     bool log_request(bool is_host_plugin, const clap::plugin::Activate&);
     bool log_request(bool is_host_plugin, const clap::plugin::Deactivate&);
     bool log_request(bool is_host_plugin,
-                     const clap::ext::audio_ports::plugin::Count&);
-    bool log_request(bool is_host_plugin,
-                     const clap::ext::audio_ports::plugin::Get&);
+                     const clap::ext::audio_ports::plugin::GetPorts&);
     bool log_request(bool is_host_plugin,
                      const clap::ext::audio_ports_config::plugin::Count&);
     bool log_request(bool is_host_plugin,
@@ -125,9 +135,7 @@ class ClapLogger {
     bool log_request(bool is_host_plugin,
                      const clap::ext::note_name::plugin::Get&);
     bool log_request(bool is_host_plugin,
-                     const clap::ext::note_ports::plugin::Count&);
-    bool log_request(bool is_host_plugin,
-                     const clap::ext::note_ports::plugin::Get&);
+                     const clap::ext::note_ports::plugin::GetPorts&);
     bool log_request(bool is_host_plugin,
                      const clap::ext::params::plugin::GetInfos&);
     bool log_request(bool is_host_plugin,
@@ -145,6 +153,10 @@ class ClapLogger {
                      const clap::ext::render::plugin::Set&);
     bool log_request(bool is_host_plugin,
                      const clap::ext::state::plugin::Save&);
+    bool log_request(bool is_host_plugin,
+                     const clap::ext::state::plugin::SaveContinue&);
+    bool log_request(bool is_host_plugin,
+                     const clap::ext::state::plugin::LoadChunk&);
     bool log_request(bool is_host_plugin,
                      const clap::ext::state::plugin::Load&);
     bool log_request(bool is_host_plugin,
@@ -154,8 +166,17 @@ class ClapLogger {
     bool log_request(bool is_host_plugin, const clap::plugin::StartProcessing&);
     bool log_request(bool is_host_plugin, const clap::plugin::StopProcessing&);
     bool log_request(bool is_host_plugin, const clap::plugin::Reset&);
+#ifdef YABRIDGE_NO_AUDIO_PATH_LOGGING
+    // See `audio_path_logging_enabled`, in stripped builds these per-block
+    // messages compile down to nothing
+    inline bool log_request(bool,
+                            const MessageReference<clap::plugin::Process>&) {
+        return false;
+    }
+#else
     bool log_request(bool is_host_plugin,
                      const MessageReference<clap::plugin::Process>&);
+#endif
     bool log_request(bool is_host_plugin,
                      const clap::ext::params::plugin::Flush&);
     bool log_request(bool is_host_plugin, const clap::ext::tail::plugin::Get&);
@@ -214,7 +235,8 @@ class ClapLogger {
     void log_response(bool is_host_plugin,
                       const clap::plugin::ActivateResponse&);
     void log_response(bool is_host_plugin,
-                      const clap::ext::audio_ports::plugin::GetResponse&);
+                      const clap::ext::audio_ports::plugin::GetPortsResponse&,
+                      bool from_cache = false);
     void log_response(
         bool is_host_plugin,
         const clap::ext::audio_ports_config::plugin::GetResponse&);
@@ -227,7 +249,8 @@ class ClapLogger {
     void log_response(bool is_host_plugin,
                       const clap::ext::note_name::plugin::GetResponse&);
     void log_response(bool is_host_plugin,
-                      const clap::ext::note_ports::plugin::GetResponse&);
+                      const clap::ext::note_ports::plugin::GetPortsResponse&,
+                      bool from_cache = false);
     void log_response(bool is_host_plugin,
                       const clap::ext::params::plugin::GetInfosResponse&,
                       bool from_cache = false);
@@ -241,12 +264,17 @@ class ClapLogger {
                       const clap::ext::params::plugin::FlushResponse&);
     void log_response(bool is_host_plugin,
                       const clap::ext::state::plugin::SaveResponse&);
+    void log_response(bool is_host_plugin, const clap::stream::StreamChunk&);
     void log_response(bool is_host_plugin,
                       const clap::ext::voice_info::plugin::GetResponse&);
 
     // Audio thread control message responses
+#ifdef YABRIDGE_NO_AUDIO_PATH_LOGGING
+    inline void log_response(bool, const clap::plugin::ProcessResponse&) {}
+#else
     void log_response(bool is_host_plugin,
                       const clap::plugin::ProcessResponse&);
+#endif
 
     // Main thread callback responses
     void log_response(bool is_host_plugin, const Configuration&);
@@ -287,7 +315,7 @@ class ClapLogger {
     bool log_request_base(bool is_host_plugin,
                           Logger::Verbosity min_verbosity,
                           F callback) {
-        if (logger_.verbosity_ >= min_verbosity) [[unlikely]] {
+        if (logger_.verbosity() >= min_verbosity) [[unlikely]] {
             std::ostringstream message;
             if (is_host_plugin) {
                 message << "[host -> plugin] >> ";
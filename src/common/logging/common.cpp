@@ -21,6 +21,8 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 /**
  * The environment variable indicating whether to log to a file. Will log to
@@ -41,17 +43,173 @@ constexpr char logging_verbosity_environment_variable[] =
  */
 constexpr char editor_tracing_flag[] = "+editor";
 
+/**
+ * The `YABRIDGE_DEBUG_LEVEL` flag for enabling sampled audio path logging.
+ *
+ * @see Logger::should_log_sampled_audio_event
+ */
+constexpr char sampled_audio_logging_flag[] = "+sampled";
+
+AsyncLogSink::AsyncLogSink(std::shared_ptr<std::ostream> stream)
+    : stream_(stream) {
+    // See the class docstring for the scheme these sequence numbers implement
+    for (size_t i = 0; i < ring_size; i++) {
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    writer_thread_ = std::jthread([this]() { run(); });
+}
+
+AsyncLogSink::~AsyncLogSink() noexcept {
+    shutting_down_.store(true, std::memory_order_release);
+
+    // This wakes the writer up one last time so it can drain whatever is still
+    // queued before `writer_thread_`'s destructor joins it
+    messages_available_.release();
+}
+
+void AsyncLogSink::write(std::string&& message) noexcept {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = ring_[pos & (ring_size - 1)];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const intptr_t difference =
+            static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (difference == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                   std::memory_order_relaxed)) {
+                slot.message = std::move(message);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                messages_available_.release();
+
+                return;
+            }
+        } else if (difference < 0) {
+            // The ring is full. Dropping the message is the whole point of
+            // this backend: blocking here would stall the (audio) thread that
+            // produced it, which is much worse than a gap in the log.
+            overflow_count_.fetch_add(1, std::memory_order_relaxed);
+
+            return;
+        } else {
+            // Another producer claimed this slot before we could, try again
+            // at the new tail position
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogSink::run() noexcept {
+    const ThreadRegistry::Guard thread_guard =
+        ThreadRegistry::instance().register_thread("log-writer");
+
+    while (true) {
+        messages_available_.acquire();
+
+        const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Slot& slot = ring_[pos & (ring_size - 1)];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) ==
+            0) {
+            dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+
+            *stream_ << slot.message << std::flush;
+
+            // Don't keep large formatted messages alive in the ring
+            slot.message = std::string();
+            slot.sequence.store(pos + ring_size, std::memory_order_release);
+        } else if (shutting_down_.load(std::memory_order_acquire)) {
+            // This token was the shutdown signal from the destructor rather
+            // than a queued message, and the queue has been fully drained
+            break;
+        }
+
+        // Report any messages we had to drop because the ring was full, so
+        // the gap in the log at least doesn't go unnoticed
+        if (const size_t num_dropped =
+                overflow_count_.exchange(0, std::memory_order_relaxed);
+            num_dropped > 0) {
+            *stream_ << "yabridge: dropped " << num_dropped
+                     << " log messages because the log buffer overflowed"
+                     << std::endl;
+        }
+    }
+}
+
 Logger::Logger(std::shared_ptr<std::ostream> stream,
                Verbosity verbosity_level,
                bool editor_tracing,
+               bool sampled_audio_logging,
                std::string prefix,
                bool prefix_timestamp)
-    : verbosity_(verbosity_level),
-      editor_tracing_(editor_tracing),
-      stream_(stream),
+    : editor_tracing_(editor_tracing),
+      sampled_audio_logging_(sampled_audio_logging),
+      verbosity_(verbosity_level),
+      sink_(std::make_shared<AsyncLogSink>(stream)),
       prefix_(prefix),
       prefix_timestamp_(prefix_timestamp) {}
 
+void Logger::watch_verbosity_control_file(const ghc::filesystem::path& path) {
+    // The files being watched, alongside the last modification time a level
+    // was applied for. The files typically don't exist until `yabridgectl
+    // log-level` creates them.
+    static std::mutex control_files_mutex{};
+    static std::vector<
+        std::pair<ghc::filesystem::path, ghc::filesystem::file_time_type>>
+        control_files{};
+
+    // The watcher thread is started lazily when the first file gets
+    // registered. It polls the registered files once per second, which is
+    // cheap enough to always leave enabled: for each file that's just a
+    // single `stat()` while nothing changes.
+    static std::jthread watcher_thread{};
+
+    std::lock_guard lock(control_files_mutex);
+    for (const auto& [existing_path, last_applied] : control_files) {
+        if (existing_path == path) {
+            return;
+        }
+    }
+
+    control_files.emplace_back(path, ghc::filesystem::file_time_type::min());
+
+    if (!watcher_thread.joinable()) {
+        watcher_thread = std::jthread([](std::stop_token st) {
+            using namespace std::literals::chrono_literals;
+
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("log-level-watch");
+
+            // The sleep is broken up into small steps so the thread doesn't
+            // delay process shutdown by up to a full polling interval
+            size_t ticks = 0;
+            while (!st.stop_requested()) {
+                std::this_thread::sleep_for(50ms);
+                if (++ticks % 20 != 0) {
+                    continue;
+                }
+
+                std::lock_guard lock(control_files_mutex);
+                for (auto& [control_path, last_applied] : control_files) {
+                    std::error_code err;
+                    const auto modified_at =
+                        ghc::filesystem::last_write_time(control_path, err);
+                    if (err || modified_at == last_applied) {
+                        continue;
+                    }
+                    last_applied = modified_at;
+
+                    std::ifstream control_file(control_path.string());
+                    int level;
+                    if (control_file >> level) {
+                        set_runtime_verbosity_override(level);
+                    }
+                }
+            }
+        });
+    }
+}
+
 Logger Logger::create_from_environment(std::string prefix,
                                        std::shared_ptr<std::ostream> stream,
                                        bool prefix_timestamp) {
@@ -62,13 +220,24 @@ Logger Logger::create_from_environment(std::string prefix,
     std::string file_path = file_path_env ? std::string(file_path_env) : "";
     std::string verbosity = verbosity_env ? std::string(verbosity_env) : "";
 
-    // Editor debug tracing is an optional flag that can be added to any debug
-    // level (and technically it will also work fine if it's the only option,
-    // but you're not supposed to do that ;))
-    const bool editor_tracing = verbosity.ends_with(editor_tracing_flag);
-    if (editor_tracing) {
-        verbosity =
-            verbosity.substr(0, verbosity.size() - strlen(editor_tracing_flag));
+    // Editor debug tracing and sampled audio logging are optional flags that
+    // can be added to any debug level in any order (and technically they will
+    // also work fine as the only option, but you're not supposed to do that
+    // ;))
+    bool editor_tracing = false;
+    bool sampled_audio_logging = false;
+    while (true) {
+        if (verbosity.ends_with(editor_tracing_flag)) {
+            editor_tracing = true;
+            verbosity = verbosity.substr(
+                0, verbosity.size() - strlen(editor_tracing_flag));
+        } else if (verbosity.ends_with(sampled_audio_logging_flag)) {
+            sampled_audio_logging = true;
+            verbosity = verbosity.substr(
+                0, verbosity.size() - strlen(sampled_audio_logging_flag));
+        } else {
+            break;
+        }
     }
 
     // Default to `Verbosity::basic` if the environment variable has not
@@ -99,8 +268,8 @@ Logger Logger::create_from_environment(std::string prefix,
         }
     }
 
-    return Logger(stream, verbosity_level, editor_tracing, prefix,
-                  prefix_timestamp);
+    return Logger(stream, verbosity_level, editor_tracing,
+                  sampled_audio_logging, prefix, prefix_timestamp);
 }
 
 Logger Logger::create_wine_stderr() {
@@ -143,5 +312,5 @@ void Logger::log(const std::string& message) {
     // stream to prevent two messages from being put on the same row
     formatted_message << std::endl;
 
-    *stream_ << formatted_message.str() << std::flush;
+    sink_->write(formatted_message.str());
 }
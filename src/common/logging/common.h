@@ -16,9 +16,13 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <ostream>
+#include <semaphore>
+#include <thread>
 
 // The chainloader needs to be able to use the logger without pulling in a bunch
 // of Boost things
@@ -33,17 +37,131 @@
 
 #include "../utils.h"
 
+/**
+ * Whether logging for the per-block audio path messages is compiled in. The
+ * `audio-path-logging` meson option can be set to false to strip those log
+ * calls from the binaries entirely so the hot paths don't even branch into the
+ * logger wrappers, which can be worthwhile for dedicated high performance
+ * builds (think render farms). Everything else stays runtime-switchable
+ * through `YABRIDGE_DEBUG_LEVEL`.
+ */
+#ifdef YABRIDGE_NO_AUDIO_PATH_LOGGING
+constexpr bool audio_path_logging_enabled = false;
+#else
+constexpr bool audio_path_logging_enabled = true;
+#endif
+
+/**
+ * An asynchronous sink `Logger` writes its formatted messages to. Messages are
+ * enqueued onto a bounded lock-free multiple-producer single-consumer ring
+ * buffer that gets drained to the output stream by a dedicated writer thread.
+ * This matters when the verbosity is raised to diagnose an issue: the log
+ * calls made from audio threads then no longer block on disk writes, which
+ * used to cause the exact dropouts one would be trying to debug. When the ring
+ * overflows messages are counted and dropped instead of blocking the producer,
+ * and the number of dropped messages is reported once the writer catches up.
+ *
+ * The trade-off is that the last few messages before a hard crash may not have
+ * hit the disk yet. The writer thread flushes after every message to keep that
+ * window as small as possible.
+ */
+class AsyncLogSink {
+   public:
+    /**
+     * Start the writer thread for an output stream. Every `Logger` created
+     * through one of the factory functions gets its own sink.
+     */
+    AsyncLogSink(std::shared_ptr<std::ostream> stream);
+
+    /**
+     * Drains any remaining messages to the stream before shutting the writer
+     * thread down.
+     */
+    ~AsyncLogSink() noexcept;
+
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+    AsyncLogSink(AsyncLogSink&&) = delete;
+    AsyncLogSink& operator=(AsyncLogSink&&) = delete;
+
+    /**
+     * Enqueue an already formatted message, including the trailing linefeed.
+     * If the ring is full the message is dropped and counted instead, since
+     * blocking here would defeat the point of this class.
+     */
+    void write(std::string&& message) noexcept;
+
+   private:
+    /**
+     * The writer thread's entry point. Waits for messages, writes them to
+     * `stream_`, and exits after the queue has been drained during shutdown.
+     */
+    void run() noexcept;
+
+    /**
+     * The size of the ring buffer. Must be a power of two. At the highest
+     * verbosity level a plugin produces a couple hundred messages per audio
+     * processing cycle at most, so this should give the writer plenty of room
+     * to catch up.
+     */
+    static constexpr size_t ring_size = 4096;
+
+    /**
+     * A slot in the ring buffer, following Vyukov's bounded MPMC queue design.
+     * The sequence number encodes whether the slot is free to be written to
+     * (`== pos`), ready to be consumed (`== pos + 1`), or still in use by a
+     * producer or the consumer (anything else).
+     */
+    struct Slot {
+        std::atomic_size_t sequence;
+        std::string message;
+    };
+
+    /**
+     * The output stream to write the log messages to. Typically either STDERR
+     * or a file stream.
+     */
+    std::shared_ptr<std::ostream> stream_;
+
+    std::array<Slot, ring_size> ring_;
+    std::atomic_size_t enqueue_pos_ = 0;
+    std::atomic_size_t dequeue_pos_ = 0;
+
+    /**
+     * The number of messages dropped because the ring was full. The writer
+     * thread reports and resets this whenever it has caught up again.
+     */
+    std::atomic_size_t overflow_count_ = 0;
+
+    /**
+     * Signals the writer thread that there's a message to write, or that it
+     * should shut down after draining the queue.
+     */
+    std::counting_semaphore<> messages_available_{0};
+
+    std::atomic_bool shutting_down_ = false;
+
+    /**
+     * The dedicated writer thread. This only touches the output stream, so
+     * unlike the threads that interact with plugins this can safely be a
+     * regular `std::jthread` even on the Wine side. Declared last so it's the
+     * first thing to stop during destruction.
+     */
+    std::jthread writer_thread_;
+};
+
 /**
  * Super basic logging facility meant for debugging malfunctioning VST
  * plugins. This is also used to redirect the output of the Wine process
  * because DAWs like Bitwig hide this from you, making it hard to debug
  * crashing plugins.
  *
- * @note This does not do any synchronisation. While this should technically
- *   be causing problems in concurrent use, writing strings to fstreams from
- *   multiple threads at the same time doesn't seem to produce corrupted text if
- *   you're writing an entire string at once even though the messages may be
- *   slightly out of order.
+ * @note Messages are formatted on the calling thread but written to the
+ *   output stream asynchronously through `AsyncLogSink`, so raising the
+ *   verbosity no longer causes log calls from audio threads to block on disk
+ *   writes. Messages produced by different threads may still end up slightly
+ *   out of order, just like they could with the old synchronous fstream
+ *   writes.
  */
 class Logger {
    public:
@@ -85,6 +203,9 @@ class Logger {
      * @param editor_tracing Whether we should enable debug tracing for the
      *   editor window handling. If we end up adding more of these options, we
      *   should move to a bitfield or something.
+     * @param sampled_audio_logging Whether to only log a sample of the
+     *   per-block audio messages instead of every single one, see
+     *   `should_log_sampled_audio_event()`.
      * @param prefix An optional prefix for the logger. Useful for differentiate
      *   messages coming from the Wine plugin host. Should end with a single
      *   space character.
@@ -97,6 +218,7 @@ class Logger {
     Logger(std::shared_ptr<std::ostream> stream,
            Verbosity verbosity_level,
            bool editor_tracing,
+           bool sampled_audio_logging,
            std::string prefix = "",
            bool prefix_timestamp = true);
 
@@ -183,7 +305,7 @@ class Logger {
      */
     template <invocable_returning<std::string> F>
     void log_trace(F&& fn) {
-        if (verbosity_ >= Verbosity::all_events) [[unlikely]] {
+        if (verbosity() >= Verbosity::all_events) [[unlikely]] {
             log(fn());
         }
     }
@@ -202,11 +324,81 @@ class Logger {
         }
     }
 
+    /**
+     * The number of audio processing calls between two logged messages in the
+     * sampled logging mode.
+     */
+    static constexpr size_t sampled_audio_logging_interval = 64;
+
+    /**
+     * Decide whether a per-block audio message should be logged. Without the
+     * `+sampled` flag in `YABRIDGE_DEBUG_LEVEL` this always returns true.
+     * With the flag only one out of every `sampled_audio_logging_interval`
+     * process calls gets logged, with one exception: whenever a block
+     * contains more events than any block before it, that block is always
+     * logged. This cuts the log volume by roughly two orders of magnitude on
+     * long sessions while the anomalous blocks that are usually the
+     * interesting ones still show up.
+     *
+     * @param num_events The number of input events in the current block.
+     */
+    bool should_log_sampled_audio_event(size_t num_events) noexcept {
+        if (!sampled_audio_logging_) [[likely]] {
+            return true;
+        }
+
+        // Event count spikes are always worth logging, and these don't count
+        // towards the sampling interval
+        if (num_events >
+            max_observed_audio_events_.load(std::memory_order_relaxed)) {
+            max_observed_audio_events_.store(num_events,
+                                             std::memory_order_relaxed);
+            return true;
+        }
+
+        return audio_message_counter_.fetch_add(1, std::memory_order_relaxed) %
+                   sampled_audio_logging_interval ==
+               0;
+    }
+
     /**
      * The verbosity level of this logger instance. Based on this certain
-     * messages may or may not be shown.
+     * messages may or may not be shown. This is normally the level the logger
+     * was created with, but it can be overridden for the entire process at
+     * runtime through `set_runtime_verbosity_override()`.
      */
-    const Verbosity verbosity_;
+    Verbosity verbosity() const noexcept {
+        const int override_level =
+            runtime_verbosity_override_.load(std::memory_order_relaxed);
+        return override_level >= 0 ? static_cast<Verbosity>(override_level)
+                                   : verbosity_;
+    }
+
+    /**
+     * Override the verbosity of every logger in this process at runtime, or
+     * pass a negative value to revert back to the level the loggers were
+     * created with. Used by `watch_verbosity_control_file()` so the verbosity
+     * of a long running session can be raised without reloading the plugin.
+     */
+    static void set_runtime_verbosity_override(int level) noexcept {
+        runtime_verbosity_override_.store(level, std::memory_order_relaxed);
+    }
+
+    /**
+     * Start watching a verbosity control file if it isn't being watched
+     * already. The `yabridgectl log-level` command writes a verbosity level
+     * to the `verbosity` file inside a bridge's socket directory, and a
+     * watcher thread polls the registered files every second, applying
+     * changed levels through `set_runtime_verbosity_override()`. The override
+     * is process wide, so in a group host process changing one plugin's level
+     * affects every plugin hosted there.
+     *
+     * Called from `Sockets::Sockets()`, which runs on both the native and the
+     * Wine side with the same base directory, so writing the file changes the
+     * verbosity on both sides at the same time.
+     */
+    static void watch_verbosity_control_file(
+        const ghc::filesystem::path& path);
 
     /**
      * If this is set to true, then we'll print debug traces for the plugin
@@ -214,12 +406,49 @@ class Logger {
      */
     const bool editor_tracing_;
 
+    /**
+     * If this is set to true, then only a sample of the per-block audio
+     * messages gets logged.
+     *
+     * @see should_log_sampled_audio_event
+     */
+    const bool sampled_audio_logging_;
+
    private:
     /**
-     * The output stream to write the log messages to. Typically either STDERR
-     * or a file stream.
+     * The process wide runtime verbosity override, or a negative value when
+     * no override is active.
+     *
+     * @see set_runtime_verbosity_override
      */
-    std::shared_ptr<std::ostream> stream_;
+    static inline std::atomic_int runtime_verbosity_override_ = -1;
+
+    /**
+     * The verbosity level this logger was created with.
+     *
+     * @see verbosity
+     */
+    const Verbosity verbosity_;
+
+    /**
+     * The number of per-block audio messages considered for sampling so far.
+     *
+     * @see should_log_sampled_audio_event
+     */
+    std::atomic_size_t audio_message_counter_ = 0;
+
+    /**
+     * The largest number of input events seen in a single block so far. Used
+     * to always log blocks with anomalously many events in the sampled
+     * logging mode.
+     */
+    std::atomic_size_t max_observed_audio_events_ = 0;
+
+    /**
+     * The sink that asynchronously writes our formatted messages to the output
+     * stream.
+     */
+    std::shared_ptr<AsyncLogSink> sink_;
 
     /**
      * A prefix that gets prepended before every message.
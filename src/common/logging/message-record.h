@@ -0,0 +1,162 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+// A record/replay sink for the raw message streams sent through
+// `write_object()` and `read_object()`. When the
+// `YABRIDGE_MESSAGE_RECORD_FILE` environment variable is set to a file path,
+// every message is appended to that file as a fixed-size header followed by
+// the message's already-serialized bitsery payload. Unlike the fixed-size
+// records written with `YABRIDGE_BINARY_TRACE_FILE` this captures the
+// complete traffic, so a session recorded from a problematic host can later
+// be played back deterministically with the `yabridge-replay` tool
+// (`src/tools/replay/main.cpp`) at the original or at accelerated timing.
+//
+// The header uses the host machine's native byte order. The file is opened
+// with `O_APPEND` and every record is written with a single `writev()` call
+// so the processes on both sides of the bridge can safely share it, and the
+// monotonic timestamps share an epoch across those processes. Records from
+// different sockets are interleaved in the file and can be untangled again
+// using the writing process' ID and the socket's file descriptor. When the
+// environment variable is not set this all reduces to a single branch.
+
+/**
+ * Whether a `MessageRecordHeader` describes a message this process sent or
+ * one it received. Since both sides of the bridge can record to the same
+ * file, the same message can show up twice: once as sent by one process and
+ * once as received by the other.
+ */
+enum class MessageRecordDirection : uint16_t {
+    sent = 1,
+    received = 2,
+};
+
+/**
+ * The fixed-size header preceding every recorded payload. See the comment at
+ * the top of this file for the format's semantics. `version` should always
+ * contain `message_record_format_version` so the offline tool can reject
+ * files written by an incompatible yabridge version.
+ */
+struct MessageRecordHeader {
+    /**
+     * Monotonic timestamp in microseconds. The replayer derives the pacing
+     * between messages from the deltas between these.
+     */
+    uint64_t timestamp_us;
+
+    /**
+     * The process ID of the writing process, so the streams recorded by the
+     * native plugin and by the Wine plugin host can be told apart.
+     */
+    uint32_t pid;
+
+    /**
+     * The file descriptor of the socket the message was sent over or
+     * received from within the writing process. Together with `pid` this
+     * identifies a single socket's request-response stream within the
+     * recording.
+     */
+    uint32_t stream_id;
+
+    /**
+     * The size of the serialized payload following this header, in bytes.
+     */
+    uint32_t payload_size;
+
+    uint16_t direction;
+    uint16_t version;
+};
+
+constexpr uint16_t message_record_format_version = 1;
+
+static_assert(sizeof(MessageRecordHeader) == 24,
+              "The message record header format should stay fixed-size");
+
+/**
+ * The file descriptor of the message recording file, or -1 when message
+ * recording is not enabled. The environment variable is only consulted once
+ * since it cannot change for a running process.
+ */
+inline int message_record_fd() noexcept {
+    static const int record_fd = []() {
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        const char* record_path = getenv("YABRIDGE_MESSAGE_RECORD_FILE");
+        if (!record_path || record_path[0] == '\0') {
+            return -1;
+        }
+
+        return open(record_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    0644);
+    }();
+
+    return record_fd;
+}
+
+/**
+ * Whether `YABRIDGE_MESSAGE_RECORD_FILE` is set. `write_object()` checks this
+ * to decide whether a gathered message needs to be spliced back into a single
+ * contiguous payload so it can be recorded.
+ */
+inline bool message_recording_active() noexcept {
+    return message_record_fd() != -1;
+}
+
+/**
+ * Append a message to the recording file when message recording is enabled,
+ * and do nothing otherwise. Called from `write_object()` and `read_object()`
+ * with the serialized payload. Safe to call from the audio threads: the only
+ * work done here is filling a 24 byte header and a single `writev()`.
+ */
+inline void record_message(MessageRecordDirection direction,
+                           int stream_id,
+                           const uint8_t* payload,
+                           size_t payload_size) noexcept {
+    const int record_fd = message_record_fd();
+    if (record_fd == -1) {
+        return;
+    }
+
+    MessageRecordHeader header{};
+    header.timestamp_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    header.pid = static_cast<uint32_t>(getpid());
+    header.stream_id = static_cast<uint32_t>(stream_id);
+    header.payload_size = static_cast<uint32_t>(payload_size);
+    header.direction = static_cast<uint16_t>(direction);
+    header.version = message_record_format_version;
+
+    // The header and the payload are appended with a single gathered write so
+    // records written by different threads and processes don't interleave. We
+    // don't care about the occasional lost record if the disk is full.
+    const std::array<iovec, 2> chunks{
+        iovec{.iov_base = &header, .iov_len = sizeof(header)},
+        iovec{.iov_base = const_cast<uint8_t*>(payload),
+              .iov_len = payload_size}};
+    [[maybe_unused]] const ssize_t result =
+        writev(record_fd, chunks.data(), chunks.size());
+}
@@ -16,9 +16,222 @@
 
 #pragma once
 
+#include <array>
+
 #include "../serialization/vst2.h"
 #include "common.h"
 
+/**
+ * The storage size for an opcode name in `Vst2OpcodeInfo`. The longest known
+ * name, `audioMasterGetNumAutomatableParameters`, is 38 characters.
+ */
+constexpr size_t vst2_opcode_name_size = 40;
+
+/**
+ * Static properties of a VST2 opcode, looked up through the compile time tables
+ * defined below.
+ */
+struct Vst2OpcodeInfo {
+    /**
+     * The opcode's name from `aeffectx.h`, or an empty string if the opcode is
+     * not listed there. This is stored inline instead of as a pointer to a
+     * string literal so the tables below contain no pointers at all. Pointer
+     * members would need load time relocations, moving the tables to writable
+     * `.data.rel.ro` pages that every host process dirties with its own
+     * private copy. Without them the tables live in `.rodata` and all host
+     * processes running the same binary share a single physical copy.
+     */
+    char name[vst2_opcode_name_size] = {};
+    /**
+     * Whether the event is called tens of times per second and should thus be
+     * hidden from the logs below `Verbosity::all_events`.
+     */
+    bool is_noisy = false;
+};
+
+/**
+ * The size of the lookup tables below. These cover every known opcode, and
+ * since the opcodes are small contiguous integers a flat array lets us resolve
+ * an opcode's properties with a single indexed load instead of walking a large
+ * switch statement on every `dispatch()` call.
+ */
+constexpr size_t vst2_dispatch_opcode_table_size = effSetProcessPrecision + 1;
+constexpr size_t vst2_host_opcode_table_size =
+    audioMasterGetInputSpeakerArrangement + 1;
+
+/**
+ * Compile time opcode -> `Vst2OpcodeInfo` table for a plugin's `dispatch()`
+ * function. Unknown opcodes map to a default constructed `Vst2OpcodeInfo`.
+ */
+constexpr std::array<Vst2OpcodeInfo, vst2_dispatch_opcode_table_size>
+    vst2_dispatch_opcode_table = []() {
+        std::array<Vst2OpcodeInfo, vst2_dispatch_opcode_table_size> table{};
+        table[effOpen] = {"effOpen", false};
+        table[effClose] = {"effClose", false};
+        table[effSetProgram] = {"effSetProgram", false};
+        table[effGetProgram] = {"effGetProgram", false};
+        table[effSetProgramName] = {"effSetProgramName", false};
+        table[effGetProgramName] = {"effGetProgramName", false};
+        table[effGetParamLabel] = {"effGetParamLabel", false};
+        table[effGetParamDisplay] = {"effGetParamDisplay", false};
+        table[effGetParamName] = {"effGetParamName", false};
+        table[effSetSampleRate] = {"effSetSampleRate", false};
+        table[effSetBlockSize] = {"effSetBlockSize", false};
+        table[effMainsChanged] = {"effMainsChanged", false};
+        table[effEditGetRect] = {"effEditGetRect", false};
+        table[effEditOpen] = {"effEditOpen", false};
+        table[effEditClose] = {"effEditClose", false};
+        table[effEditIdle] = {"effEditIdle", true};
+        table[effEditTop] = {"effEditTop", false};
+        table[effIdentify] = {"effIdentify", false};
+        table[effGetChunk] = {"effGetChunk", false};
+        table[effSetChunk] = {"effSetChunk", false};
+        table[effProcessEvents] = {"effProcessEvents", true};
+        table[effCanBeAutomated] = {"effCanBeAutomated", false};
+        table[effGetProgramNameIndexed] = {"effGetProgramNameIndexed", false};
+        table[effGetPlugCategory] = {"effGetPlugCategory", false};
+        table[effGetEffectName] = {"effGetEffectName", false};
+        table[effGetParameterProperties] = {"effGetParameterProperties", false};
+        table[effGetVendorString] = {"effGetVendorString", false};
+        table[effGetProductString] = {"effGetProductString", false};
+        table[effGetVendorVersion] = {"effGetVendorVersion", false};
+        table[effCanDo] = {"effCanDo", false};
+        table[effIdle] = {"effIdle", true};
+        table[effGetVstVersion] = {"effGetVstVersion", false};
+        table[effBeginSetProgram] = {"effBeginSetProgram", false};
+        table[effEndSetProgram] = {"effEndSetProgram", false};
+        table[effShellGetNextPlugin] = {"effShellGetNextPlugin", false};
+        table[effBeginLoadBank] = {"effBeginLoadBank", false};
+        table[effBeginLoadProgram] = {"effBeginLoadProgram", false};
+        table[effStartProcess] = {"effStartProcess", false};
+        table[effStopProcess] = {"effStopProcess", false};
+        table[effGetInputProperties] = {"effGetInputProperties", false};
+        table[effGetOutputProperties] = {"effGetOutputProperties", false};
+        table[effGetMidiKeyName] = {"effGetMidiKeyName", false};
+        table[effSetSpeakerArrangement] = {"effSetSpeakerArrangement", false};
+        table[effGetSpeakerArrangement] = {"effGetSpeakerArrangement", false};
+        table[effString2Parameter] = {"effString2Parameter", false};
+        table[effSetBypass] = {"effSetBypass", false};
+        table[effVendorSpecific] = {"effVendorSpecific", false};
+        table[effGetTailSize] = {"effGetTailSize", true};
+        table[effSetProcessPrecision] = {"effSetProcessPrecision", false};
+
+        return table;
+    }();
+
+/**
+ * The same table for the host callback function's opcodes.
+ *
+ * NOTE: REAPER's `audioMasterDeadBeef` extension opcode is a large negative
+ *       number and thus deliberately not part of this table.
+ */
+constexpr std::array<Vst2OpcodeInfo, vst2_host_opcode_table_size>
+    vst2_host_opcode_table = []() {
+        std::array<Vst2OpcodeInfo, vst2_host_opcode_table_size> table{};
+        table[audioMasterAutomate] = {"audioMasterAutomate", false};
+        table[audioMasterVersion] = {"audioMasterVersion", false};
+        table[audioMasterCurrentId] = {"audioMasterCurrentId", false};
+        table[audioMasterIdle] = {"audioMasterIdle", false};
+        table[audioMasterPinConnected] = {"audioMasterPinConnected", false};
+        table[audioMasterWantMidi] = {"audioMasterWantMidi", false};
+        table[audioMasterGetTime] = {"audioMasterGetTime", true};
+        table[audioMasterProcessEvents] = {"audioMasterProcessEvents", false};
+        table[audioMasterSetTime] = {"audioMasterSetTime", false};
+        table[audioMasterTempoAt] = {"audioMasterTempoAt", false};
+        table[audioMasterGetNumAutomatableParameters] = {
+            "audioMasterGetNumAutomatableParameters", false};
+        table[audioMasterGetParameterQuantization] = {
+            "audioMasterGetParameterQuantization", false};
+        table[audioMasterIOChanged] = {"audioMasterIOChanged", false};
+        table[audioMasterNeedIdle] = {"audioMasterNeedIdle", false};
+        table[audioMasterSizeWindow] = {"audioMasterSizeWindow", false};
+        table[audioMasterGetSampleRate] = {"audioMasterGetSampleRate", false};
+        table[audioMasterGetBlockSize] = {"audioMasterGetBlockSize", false};
+        table[audioMasterGetInputLatency] = {"audioMasterGetInputLatency",
+                                             false};
+        table[audioMasterGetOutputLatency] = {"audioMasterGetOutputLatency",
+                                              false};
+        table[audioMasterGetPreviousPlug] = {"audioMasterGetPreviousPlug",
+                                             false};
+        table[audioMasterGetNextPlug] = {"audioMasterGetNextPlug", false};
+        table[audioMasterWillReplaceOrAccumulate] = {
+            "audioMasterWillReplaceOrAccumulate", false};
+        table[audioMasterGetCurrentProcessLevel] = {
+            "audioMasterGetCurrentProcessLevel", true};
+        table[audioMasterGetAutomationState] = {"audioMasterGetAutomationState",
+                                                false};
+        table[audioMasterOfflineStart] = {"audioMasterOfflineStart", false};
+        table[audioMasterOfflineRead] = {"audioMasterOfflineRead", false};
+        table[audioMasterOfflineWrite] = {"audioMasterOfflineWrite", false};
+        table[audioMasterOfflineGetCurrentPass] = {
+            "audioMasterOfflineGetCurrentPass", false};
+        table[audioMasterOfflineGetCurrentMetaPass] = {
+            "audioMasterOfflineGetCurrentMetaPass", false};
+        table[audioMasterSetOutputSampleRate] = {
+            "audioMasterSetOutputSampleRate", false};
+        table[audioMasterGetSpeakerArrangement] = {
+            "audioMasterGetSpeakerArrangement", false};
+        table[audioMasterGetVendorString] = {"audioMasterGetVendorString",
+                                             false};
+        table[audioMasterGetProductString] = {"audioMasterGetProductString",
+                                              false};
+        table[audioMasterGetVendorVersion] = {"audioMasterGetVendorVersion",
+                                              false};
+        table[audioMasterVendorSpecific] = {"audioMasterVendorSpecific", false};
+        table[audioMasterSetIcon] = {"audioMasterSetIcon", false};
+        table[audioMasterCanDo] = {"audioMasterCanDo", false};
+        table[audioMasterGetLanguage] = {"audioMasterGetLanguage", false};
+        table[audioMasterOpenWindow] = {"audioMasterOpenWindow", false};
+        table[audioMasterCloseWindow] = {"audioMasterCloseWindow", false};
+        table[audioMasterGetDirectory] = {"audioMasterGetDirectory", false};
+        table[audioMasterUpdateDisplay] = {"audioMasterUpdateDisplay", false};
+        table[audioMasterBeginEdit] = {"audioMasterBeginEdit", false};
+        table[audioMasterEndEdit] = {"audioMasterEndEdit", false};
+        table[audioMasterOpenFileSelector] = {"audioMasterOpenFileSelector",
+                                              false};
+        table[audioMasterCloseFileSelector] = {"audioMasterCloseFileSelector",
+                                               false};
+        table[audioMasterEditFile] = {"audioMasterEditFile", false};
+        table[audioMasterGetChunkFile] = {"audioMasterGetChunkFile", false};
+        table[audioMasterGetInputSpeakerArrangement] = {
+            "audioMasterGetInputSpeakerArrangement", false};
+
+        return table;
+    }();
+
+/**
+ * The result for opcodes that are not part of the tables above. Unknown
+ * opcodes have an empty name and are never noisy.
+ */
+constexpr Vst2OpcodeInfo vst2_unknown_opcode_info{};
+
+/**
+ * Look up the static properties of an opcode in the tables defined above.
+ * Unknown and out of range opcodes, including vendor specific extensions like
+ * `audioMasterDeadBeef`, result in `vst2_unknown_opcode_info`. The entry is
+ * returned by reference since the names are stored inline in the table.
+ *
+ * @param is_dispatch Whether to use opcodes for the `dispatch` function. Will
+ *   use the host callback function's opcodes if set to false.
+ * @param opcode The opcode of the event.
+ */
+constexpr const Vst2OpcodeInfo& vst2_opcode_info(bool is_dispatch,
+                                                 int opcode) noexcept {
+    if (is_dispatch) {
+        if (opcode >= 0 &&
+            static_cast<size_t>(opcode) < vst2_dispatch_opcode_table.size()) {
+            return vst2_dispatch_opcode_table[opcode];
+        }
+    } else {
+        if (opcode >= 0 &&
+            static_cast<size_t>(opcode) < vst2_host_opcode_table.size()) {
+            return vst2_host_opcode_table[opcode];
+        }
+    }
+
+    return vst2_unknown_opcode_info;
+}
+
 /**
  * Convert an event opcode to a human readable string for debugging purposes.
  * See `src/include/vestige/aeffectx.h` for a complete list of these opcodes.
@@ -47,28 +260,61 @@ class Vst2Logger {
     inline void log(const std::string& message) { logger_.log(message); }
 
     // The following functions are for logging specific events, they are only
-    // enabled for verbosity levels higher than 1 (i.e. `Verbosity::events`)
-    void log_get_parameter(int index);
-    void log_get_parameter_response(float vlaue);
-    void log_set_parameter(int index, float value);
-    void log_set_parameter_response();
+    // enabled for verbosity levels higher than 1 (i.e. `Verbosity::events`).
+    // The verbosity gate is inlined here so that with logging disabled every
+    // call costs a single branch on the relaxed atomic verbosity load, without
+    // marshalling any of the arguments into an out of line call. These
+    // functions run for every `dispatch()` and `getParameter()`/
+    // `setParameter()` call, so this is one of the few places where the call
+    // overhead itself shows up on dispatch heavy hosts.
+    inline void log_get_parameter(int index) {
+        if (is_enabled()) [[unlikely]] {
+            log_get_parameter_unchecked(index);
+        }
+    }
+    inline void log_get_parameter_response(float value) {
+        if (is_enabled()) [[unlikely]] {
+            log_get_parameter_response_unchecked(value);
+        }
+    }
+    inline void log_set_parameter(int index, float value) {
+        if (is_enabled()) [[unlikely]] {
+            log_set_parameter_unchecked(index, value);
+        }
+    }
+    inline void log_set_parameter_response() {
+        if (is_enabled()) [[unlikely]] {
+            log_set_parameter_response_unchecked();
+        }
+    }
     // If `is_dispatch` is `true`, then use opcode names from the plugin's
     // dispatch function. Otherwise use names for the host callback function
     // opcodes.
-    void log_event(bool is_dispatch,
-                   int opcode,
-                   int index,
-                   intptr_t value,
-                   const Vst2Event::Payload& payload,
-                   float option,
-                   const std::optional<Vst2Event::Payload>& value_payload);
-    void log_event_response(
+    inline void log_event(
+        bool is_dispatch,
+        int opcode,
+        int index,
+        intptr_t value,
+        const Vst2Event::Payload& payload,
+        float option,
+        const std::optional<Vst2Event::Payload>& value_payload) {
+        if (is_enabled()) [[unlikely]] {
+            log_event_unchecked(is_dispatch, opcode, index, value, payload,
+                                option, value_payload);
+        }
+    }
+    inline void log_event_response(
         bool is_dispatch,
         int opcode,
         intptr_t return_value,
         const Vst2EventResult::Payload& payload,
         const std::optional<Vst2EventResult::Payload>& value_payload,
-        bool from_cache = false);
+        bool from_cache = false) {
+        if (is_enabled()) [[unlikely]] {
+            log_event_response_unchecked(is_dispatch, opcode, return_value,
+                                         payload, value_payload, from_cache);
+        }
+    }
 
     /**
      * @see Logger::log_trace
@@ -78,12 +324,57 @@ class Vst2Logger {
         logger_.log_trace(std::forward<F>(fn));
     }
 
+    /**
+     * The same as `log_trace()`, except that these calls are stripped from
+     * the binary entirely when the `audio-path-logging` meson option is
+     * disabled. Used for the traces around the per-block audio processing
+     * callbacks.
+     *
+     * @see audio_path_logging_enabled
+     */
+    template <invocable_returning<std::string> F>
+    inline void log_audio_trace(F&& fn) {
+        if constexpr (audio_path_logging_enabled) {
+            logger_.log_trace(std::forward<F>(fn));
+        }
+    }
+
     /**
      * The underlying logger instance we're wrapping.
      */
     Logger& logger_;
 
    private:
+    /**
+     * Whether the event logging functions above can log anything at all.
+     * Everything they print requires at least `Verbosity::most_events`.
+     */
+    inline bool is_enabled() const noexcept {
+        return logger_.verbosity() >= Logger::Verbosity::most_events;
+    }
+
+    // The out of line bodies of the logging functions above. These assume the
+    // verbosity check has already been performed.
+    void log_get_parameter_unchecked(int index);
+    void log_get_parameter_response_unchecked(float value);
+    void log_set_parameter_unchecked(int index, float value);
+    void log_set_parameter_response_unchecked();
+    void log_event_unchecked(
+        bool is_dispatch,
+        int opcode,
+        int index,
+        intptr_t value,
+        const Vst2Event::Payload& payload,
+        float option,
+        const std::optional<Vst2Event::Payload>& value_payload);
+    void log_event_response_unchecked(
+        bool is_dispatch,
+        int opcode,
+        intptr_t return_value,
+        const Vst2EventResult::Payload& payload,
+        const std::optional<Vst2EventResult::Payload>& value_payload,
+        bool from_cache);
+
     /**
      * Determine whether an event should be filtered based on the current
      * verbosity level.
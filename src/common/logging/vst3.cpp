@@ -21,6 +21,8 @@
 #include <public.sdk/source/vst/utility/stringconvert.h>
 
 #include "../serialization/vst3.h"
+#include "../tracepoints.h"
+#include "binary-trace.h"
 
 /**
  * Format a `YaBStream` object as a string so we don't have to repeat this
@@ -46,7 +48,18 @@ std::string format_bstream(const YaBStream& stream) {
         formatted << "for \""
                   << VST3::StringConvert::convert(*stream.file_name_) << "\" ";
     }
-    formatted << "containing " << stream.size() << " bytes>";
+    if (const std::optional<StateDiff>& diff = stream.diff()) {
+        size_t changed_size = 0;
+        for (const StateDiffRegion& region : diff->regions) {
+            changed_size += region.data.size();
+        }
+
+        formatted << "containing " << diff->total_size << " bytes, sent as "
+                  << (diff->is_incremental ? "a diff of " : "a full state of ")
+                  << changed_size << " bytes>";
+    } else {
+        formatted << "containing " << stream.size() << " bytes>";
+    }
 
     return formatted.str();
 }
@@ -57,7 +70,7 @@ void Vst3Logger::log_query_interface(
     const char* where,
     tresult result,
     const std::optional<Steinberg::FUID>& uid) {
-    if (logger_.verbosity_ >= Logger::Verbosity::all_events) [[unlikely]] {
+    if (logger_.verbosity() >= Logger::Verbosity::all_events) [[unlikely]] {
         std::string uid_string = uid ? format_uid(*uid) : "<unknown_pointer>";
 
         std::ostringstream message;
@@ -210,6 +223,18 @@ bool Vst3Logger::log_request(bool is_host_plugin,
     });
 }
 
+bool Vst3Logger::log_request(
+    bool is_host_plugin,
+    const YaConnectionPoint::BypassConnectionProxy& request) {
+    return log_request_base(is_host_plugin, [&](auto& message) {
+        message << request.instance_id
+                << ": IConnectionPoint::notify() messages will now be "
+                   "delivered directly to instance "
+                << request.other_instance_id
+                << ", bypassing the host's connection proxy";
+    });
+}
+
 bool Vst3Logger::log_request(
     bool is_host_plugin,
     const YaContextMenuTarget::ExecuteMenuItem& request) {
@@ -256,7 +281,8 @@ bool Vst3Logger::log_request(
     bool is_host_plugin,
     const YaEditController::GetParamValueByString& request) {
     return log_request_base(is_host_plugin, [&](auto& message) {
-        std::string param_title = VST3::StringConvert::convert(request.string);
+        std::string param_title =
+            VST3::StringConvert::convert(request.string.c_str());
         message << request.instance_id
                 << ": IEditController::getParamValueByString(id = "
                 << request.id << ", string = \"" << param_title
@@ -296,6 +322,16 @@ bool Vst3Logger::log_request(
     });
 }
 
+bool Vst3Logger::log_request(
+    bool is_host_plugin,
+    const YaEditController::GetParamNormalizedMulti& request) {
+    return log_request_base(is_host_plugin, [&](auto& message) {
+        message << request.instance_id
+                << ": IEditController::getParamNormalized(...) (batched, "
+                << request.ids.size() << " parameters)";
+    });
+}
+
 bool Vst3Logger::log_request(
     bool is_host_plugin,
     const YaEditController::SetParamNormalized& request) {
@@ -492,7 +528,7 @@ bool Vst3Logger::log_request(
                    "busIndex = "
                 << request.bus_index << ", channel = " << request.channel
                 << ", id = " << request.id << ", string = \""
-                << VST3::StringConvert::convert(request.string)
+                << VST3::StringConvert::convert(request.string.c_str())
                 << "\", &valueNormalized)";
     });
 }
@@ -785,6 +821,14 @@ bool Vst3Logger::log_request(bool is_host_plugin,
     });
 }
 
+bool Vst3Logger::log_request(bool is_host_plugin,
+                             const YaUnitInfo::GetUnitInfos& request) {
+    return log_request_base(is_host_plugin, [&](auto& message) {
+        message << request.instance_id
+                << ": IUnitInfo::getUnitInfo(..., &info) (batched)";
+    });
+}
+
 bool Vst3Logger::log_request(bool is_host_plugin,
                              const YaUnitInfo::GetProgramListCount& request) {
     return log_request_base(is_host_plugin, [&](auto& message) {
@@ -984,9 +1028,31 @@ bool Vst3Logger::log_request(bool is_host_plugin,
     });
 }
 
+#ifndef YABRIDGE_NO_AUDIO_PATH_LOGGING
 bool Vst3Logger::log_request(
     bool is_host_plugin,
     const MessageReference<YaAudioProcessor::Process>& request_wrapper) {
+    binary_trace_event(BinaryTraceEventType::vst3_process_request,
+                       request_wrapper.get().instance_id,
+                       request_wrapper.get().data.input_events_
+                           ? static_cast<uint32_t>(
+                                 request_wrapper.get()
+                                     .data.input_events_->num_events())
+                           : 0,
+                       static_cast<uint32_t>(
+                           request_wrapper.get().data.num_samples_));
+    YABRIDGE_PROBE2(vst3_process_request, request_wrapper.get().instance_id,
+                    request_wrapper.get().data.num_samples_);
+
+    // In the sampled logging mode most process calls are skipped to keep the
+    // log volume manageable on long sessions
+    if (!logger_.should_log_sampled_audio_event(
+            request_wrapper.get().data.input_events_
+                ? request_wrapper.get().data.input_events_->num_events()
+                : 0)) {
+        return false;
+    }
+
     return log_request_base(
         is_host_plugin, Logger::Verbosity::all_events, [&](auto& message) {
             // This is incredibly verbose, but if you're really a plugin that
@@ -1063,6 +1129,7 @@ bool Vst3Logger::log_request(
                     << request.data.symbolic_sample_size_ << ">)";
         });
 }
+#endif  // YABRIDGE_NO_AUDIO_PATH_LOGGING
 
 bool Vst3Logger::log_request(bool is_host_plugin,
                              const YaAudioProcessor::GetTailSamples& request) {
@@ -1180,6 +1247,16 @@ bool Vst3Logger::log_request(bool is_host_plugin,
     });
 }
 
+bool Vst3Logger::log_request(
+    bool is_host_plugin,
+    const YaComponentHandler::PerformEditBatch& request) {
+    return log_request_base(is_host_plugin, [&](auto& message) {
+        message << request.owner_instance_id
+                << ": IComponentHandler::performEdit(<" << request.edits.size()
+                << " batched edits>)";
+    });
+}
+
 bool Vst3Logger::log_request(bool is_host_plugin,
                              const YaComponentHandler::EndEdit& request) {
     return log_request_base(is_host_plugin, [&](auto& message) {
@@ -1479,13 +1556,23 @@ void Vst3Logger::log_response(
     });
 }
 
+void Vst3Logger::log_response(
+    bool is_host_plugin,
+    const YaEditController::GetParamNormalizedMultiResponse& response) {
+    log_response_base(is_host_plugin, [&](auto& message) {
+        message << "<ParamValue> for " << response.values.size()
+                << " parameters";
+    });
+}
+
 void Vst3Logger::log_response(
     bool is_host_plugin,
     const YaEditController::GetParamStringByValueResponse& response) {
     log_response_base(is_host_plugin, [&](auto& message) {
         message << response.result.string();
         if (response.result == Steinberg::kResultOk) {
-            std::string value = VST3::StringConvert::convert(response.string);
+            std::string value =
+                VST3::StringConvert::convert(response.string.c_str());
             message << ", \"" << value << "\"";
         }
     });
@@ -1558,7 +1645,8 @@ void Vst3Logger::log_response(
     log_response_base(is_host_plugin, [&](auto& message) {
         message << response.result.string();
         if (response.result == Steinberg::kResultOk) {
-            message << ", \"" << VST3::StringConvert::convert(response.string)
+            message << ", \""
+                    << VST3::StringConvert::convert(response.string.c_str())
                     << "\"";
         }
     });
@@ -1684,6 +1772,17 @@ void Vst3Logger::log_response(bool is_host_plugin,
     });
 }
 
+void Vst3Logger::log_response(bool is_host_plugin,
+                              const YaUnitInfo::GetUnitInfosResponse& response,
+                              bool from_cache) {
+    log_response_base(is_host_plugin, [&](auto& message) {
+        message << "<UnitInfo> for " << response.infos.size() << " units";
+        if (from_cache) {
+            message << " (from cache)";
+        }
+    });
+}
+
 void Vst3Logger::log_response(
     bool is_host_plugin,
     const YaUnitInfo::GetProgramListInfoResponse& response) {
@@ -1703,7 +1802,8 @@ void Vst3Logger::log_response(
     log_response_base(is_host_plugin, [&](auto& message) {
         message << response.result.string();
         if (response.result == Steinberg::kResultOk) {
-            message << ", \"" << VST3::StringConvert::convert(response.name)
+            message << ", \""
+                    << VST3::StringConvert::convert(response.name.c_str())
                     << "\"";
         }
     });
@@ -1716,7 +1816,8 @@ void Vst3Logger::log_response(
         message << response.result.string();
         if (response.result == Steinberg::kResultOk) {
             message << ", \""
-                    << VST3::StringConvert::convert(response.attribute_value)
+                    << VST3::StringConvert::convert(
+                           response.attribute_value.c_str())
                     << "\"";
         }
     });
@@ -1728,7 +1829,8 @@ void Vst3Logger::log_response(
     log_response_base(is_host_plugin, [&](auto& message) {
         message << response.result.string();
         if (response.result == Steinberg::kResultOk) {
-            message << ", \"" << VST3::StringConvert::convert(response.name)
+            message << ", \""
+                    << VST3::StringConvert::convert(response.name.c_str())
                     << "\"";
         }
     });
@@ -1772,9 +1874,20 @@ void Vst3Logger::log_response(
     });
 }
 
+#ifndef YABRIDGE_NO_AUDIO_PATH_LOGGING
 void Vst3Logger::log_response(
     bool is_host_plugin,
     const YaAudioProcessor::ProcessResponse& response) {
+    binary_trace_event(BinaryTraceEventType::vst3_process_response, 0,
+                       (response.output_data.output_events &&
+                        *response.output_data.output_events)
+                           ? static_cast<uint32_t>(
+                                 (*response.output_data.output_events)
+                                     ->num_events())
+                           : 0,
+                       0);
+    YABRIDGE_PROBE(vst3_process_response);
+
     log_response_base(is_host_plugin, [&](auto& message) {
         message << response.result.string();
 
@@ -1824,6 +1937,7 @@ void Vst3Logger::log_response(
         }
     });
 }
+#endif  // YABRIDGE_NO_AUDIO_PATH_LOGGING
 
 void Vst3Logger::log_response(
     bool is_host_plugin,
@@ -1911,7 +2025,8 @@ void Vst3Logger::log_response(
     log_response_base(is_host_plugin, [&](auto& message) {
         message << response.result.string();
         if (response.result == Steinberg::kResultOk) {
-            std::string value = VST3::StringConvert::convert(response.name);
+            std::string value =
+                VST3::StringConvert::convert(response.name.c_str());
             message << ", \"" << value << "\"";
         }
     });
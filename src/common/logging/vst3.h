@@ -35,6 +35,18 @@ class Vst3Logger {
      */
     inline void log(const std::string& message) { logger_.log(message); }
 
+    /**
+     * Whether the `log_request()`/`log_response()` overloads below can log
+     * anything at the current verbosity level. Everything they print requires
+     * at least `Verbosity::most_events`, so when this returns false the
+     * message handlers skip those out of line calls - and the argument
+     * evaluation they imply - with a single branch on the relaxed atomic
+     * verbosity load.
+     */
+    inline bool would_log_control_messages() const noexcept {
+        return logger_.verbosity() >= Logger::Verbosity::most_events;
+    }
+
     /**
      * Log calls to `FUnknown::queryInterface`. This will separately log about
      * successful queries, queries for interfaces the object did not implement,
@@ -77,6 +89,8 @@ class Vst3Logger {
     bool log_request(bool is_host_plugin, const YaConnectionPoint::Connect&);
     bool log_request(bool is_host_plugin, const YaConnectionPoint::Disconnect&);
     bool log_request(bool is_host_plugin, const YaConnectionPoint::Notify&);
+    bool log_request(bool is_host_plugin,
+                     const YaConnectionPoint::BypassConnectionProxy&);
     bool log_request(bool is_host_plugin,
                      const YaContextMenuTarget::ExecuteMenuItem&);
     bool log_request(bool is_host_plugin,
@@ -93,6 +107,8 @@ class Vst3Logger {
                      const YaEditController::PlainParamToNormalized&);
     bool log_request(bool is_host_plugin,
                      const YaEditController::GetParamNormalized&);
+    bool log_request(bool is_host_plugin,
+                     const YaEditController::GetParamNormalizedMulti&);
     bool log_request(bool is_host_plugin,
                      const YaEditController::SetParamNormalized&);
     bool log_request(bool is_host_plugin,
@@ -169,6 +185,7 @@ class Vst3Logger {
     bool log_request(bool is_host_plugin, const YaUnitData::SetUnitData&);
     bool log_request(bool is_host_plugin, const YaUnitInfo::GetUnitCount&);
     bool log_request(bool is_host_plugin, const YaUnitInfo::GetUnitInfo&);
+    bool log_request(bool is_host_plugin, const YaUnitInfo::GetUnitInfos&);
     bool log_request(bool is_host_plugin,
                      const YaUnitInfo::GetProgramListCount&);
     bool log_request(bool is_host_plugin,
@@ -201,8 +218,18 @@ class Vst3Logger {
                      const YaAudioProcessor::SetupProcessing&);
     bool log_request(bool is_host_plugin,
                      const YaAudioProcessor::SetProcessing&);
+#ifdef YABRIDGE_NO_AUDIO_PATH_LOGGING
+    // See `audio_path_logging_enabled`, in stripped builds these per-block
+    // messages compile down to nothing
+    inline bool log_request(
+        bool,
+        const MessageReference<YaAudioProcessor::Process>&) {
+        return false;
+    }
+#else
     bool log_request(bool is_host_plugin,
                      const MessageReference<YaAudioProcessor::Process>&);
+#endif
     bool log_request(bool is_host_plugin,
                      const YaAudioProcessor::GetTailSamples&);
     bool log_request(bool is_host_plugin,
@@ -223,6 +250,8 @@ class Vst3Logger {
     bool log_request(bool is_host_plugin, const YaComponentHandler::BeginEdit&);
     bool log_request(bool is_host_plugin,
                      const YaComponentHandler::PerformEdit&);
+    bool log_request(bool is_host_plugin,
+                     const YaComponentHandler::PerformEditBatch&);
     bool log_request(bool is_host_plugin, const YaComponentHandler::EndEdit&);
     bool log_request(bool is_host_plugin,
                      const YaComponentHandler::RestartComponent&);
@@ -272,6 +301,9 @@ class Vst3Logger {
     void log_response(bool is_host_plugin,
                       const YaEditController::GetParameterInfosResponse&,
                       bool from_cache = false);
+    void log_response(
+        bool is_host_plugin,
+        const YaEditController::GetParamNormalizedMultiResponse&);
     void log_response(bool is_host_plugin,
                       const YaEditController::GetParamStringByValueResponse&);
     void log_response(bool is_host_plugin,
@@ -310,6 +342,9 @@ class Vst3Logger {
                       const YaUnitData::GetUnitDataResponse&);
     void log_response(bool is_host_plugin,
                       const YaUnitInfo::GetUnitInfoResponse&);
+    void log_response(bool is_host_plugin,
+                      const YaUnitInfo::GetUnitInfosResponse&,
+                      bool from_cache = false);
     void log_response(bool is_host_plugin,
                       const YaUnitInfo::GetProgramListInfoResponse&);
     void log_response(bool is_host_plugin,
@@ -327,8 +362,12 @@ class Vst3Logger {
     // Audio processor control message responses
     void log_response(bool is_host_plugin,
                       const YaAudioProcessor::GetBusArrangementResponse&);
+#ifdef YABRIDGE_NO_AUDIO_PATH_LOGGING
+    inline void log_response(bool, const YaAudioProcessor::ProcessResponse&) {}
+#else
     void log_response(bool is_host_plugin,
                       const YaAudioProcessor::ProcessResponse&);
+#endif
     void log_response(bool is_host_plugin,
                       const YaComponent::GetControllerClassIdResponse&);
     void log_response(bool is_host_plugin,
@@ -389,7 +428,7 @@ class Vst3Logger {
     bool log_request_base(bool is_host_plugin,
                           Logger::Verbosity min_verbosity,
                           F callback) {
-        if (logger_.verbosity_ >= min_verbosity) [[unlikely]] {
+        if (logger_.verbosity() >= min_verbosity) [[unlikely]] {
             std::ostringstream message;
             if (is_host_plugin) {
                 message << "[host -> plugin] >> ";
@@ -16,15 +16,22 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <mutex>
 #include <optional>
 #include <type_traits>
+#include <vector>
 
 #ifdef __WINE__
 #include "../wine-host/use-linux-asio.h"
 #endif
 #include <asio/dispatch.hpp>
 #include <asio/io_context.hpp>
+#include <function2/function2.hpp>
+
+#include "utils.h"
 
 /**
  * A helper to allow mutually recursive calling sequences with remote function
@@ -49,22 +56,47 @@
  * thread 2:            \-----waiting for fn() to return-----/
  * ```
  *
- * Here `fork(fn)` will call the function `fn` on a new thread (which presumably
- * does some blocking socket operations), and `handle(foo)` will call `foo()` on
- * the thread that originally called `fork(fn)`. If the function passed to
- * `handle()` also calls `fork()` (or more likely, the function pass to
+ * Here `fork(fn)` will call the function `fn` on another thread (which
+ * presumably does some blocking socket operations), and `handle(foo)` will
+ * call `foo()` on the thread that originally called `fork(fn)`. If the
+ * function passed to `handle()` also calls `fork()` (or more likely, the
+ * function passed to
  * `handle()` calls an unmanaged plugin/host function that ends up performing a
  * mutually recursive callback), then this sequence allows for arbitrarily
  * nested mutual recursion.
  *
+ * The sending threads come from a small pool of parked threads owned by this
+ * helper. GUI-heavy plugins can trigger these mutually recursive calling
+ * sequences dozens of times per second, so spawning a fresh thread for every
+ * `fork()` would pay a `pthread_create()` (or `CreateThread()`) every time. A
+ * parked thread only costs a wakeup.
+ *
  * @tparam Thread The thread implementation to use. On the Linux side this
  *   should be `std::jthread` and on the Wine side this should be `Win32Thread`.
  */
 template <typename Thread>
 class MutualRecursionHelper {
    public:
+    MutualRecursionHelper() noexcept = default;
+
+    /**
+     * Unpark all idle sending threads so they can terminate. There can be no
+     * active `fork()` calls at this point since those block the calling thread
+     * for as long as the sending thread is doing work.
+     */
+    ~MutualRecursionHelper() noexcept {
+        {
+            std::lock_guard lock(sending_pool_mutex_);
+            shutting_down_ = true;
+        }
+        sending_work_available_.notify_all();
+    }
+
+    MutualRecursionHelper(const MutualRecursionHelper&) = delete;
+    MutualRecursionHelper& operator=(const MutualRecursionHelper&) = delete;
+
     /**
-     * Run `fn` from a new thread, during calls to `handle()` and
+     * Run `fn` from another thread, during calls to `handle()` and
      * `maybe_handle()` on this thread. See the docstring on
      * `MutualRecursionHelper` for more information on this mechanism.
      *
@@ -96,9 +128,12 @@ class MutualRecursionHelper {
         auto work_guard = asio::make_work_guard(*current_io_context);
 
         // We will call the function from another thread so we can handle calls
-        // to `handle()`/`maybe_handle()` from this thread
+        // to `handle()`/`maybe_handle()` from this thread. The references
+        // captured here stay valid because this function blocks in
+        // `current_io_context->run()` and on the future below until the task
+        // has finished.
         std::promise<Result> response_promise{};
-        Thread sending_thread([&]() {
+        submit([&]() {
             const Result response = fn();
 
             // Stop accepting additional work to be run from the calling thread
@@ -175,6 +210,56 @@ class MutualRecursionHelper {
     }
 
    private:
+    /**
+     * Run `task` on one of the parked sending threads, spawning an additional
+     * thread for the pool when all of them are busy. Threads are never
+     * terminated until this object gets dropped, so the pool's size converges
+     * on the deepest level of mutual recursion that has occurred so far.
+     */
+    void submit(fu2::unique_function<void()> task) {
+        std::unique_lock lock(sending_pool_mutex_);
+        pending_tasks_.push_back(std::move(task));
+        if (idle_sending_threads_ == 0) {
+            sending_threads_.emplace_back([this]() { sending_thread_loop(); });
+        }
+        lock.unlock();
+
+        sending_work_available_.notify_one();
+    }
+
+    /**
+     * The main loop for the sending threads spawned in `submit()`. These
+     * threads park on `sending_work_available_` between tasks, and terminate
+     * when the helper is being dropped.
+     */
+    void sending_thread_loop() {
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("recursion");
+
+        std::unique_lock lock(sending_pool_mutex_);
+        while (true) {
+            idle_sending_threads_ += 1;
+            sending_work_available_.wait(lock, [&]() {
+                return shutting_down_ || !pending_tasks_.empty();
+            });
+            idle_sending_threads_ -= 1;
+
+            // There can't be any tasks left at shutdown since `fork()` blocks
+            // its caller, but draining the queue first is free
+            if (pending_tasks_.empty()) {
+                break;
+            }
+
+            fu2::unique_function<void()> task =
+                std::move(pending_tasks_.front());
+            pending_tasks_.pop_front();
+
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
     /**
      * These IO contexts will let us call functions from the thread that's
      * currently calling `fork()` while we're waiting for the passed function to
@@ -187,4 +272,20 @@ class MutualRecursionHelper {
      */
     std::vector<std::shared_ptr<asio::io_context>> mutual_recursion_contexts_;
     std::mutex mutual_recursion_contexts_mutex_;
+
+    /**
+     * Protects all of the sending thread pool state below.
+     */
+    std::mutex sending_pool_mutex_;
+    std::condition_variable sending_work_available_;
+    std::deque<fu2::unique_function<void()>> pending_tasks_;
+    size_t idle_sending_threads_ = 0;
+    bool shutting_down_ = false;
+
+    /**
+     * The parked sending threads. This has to be the last field so the
+     * destructors join these threads while the synchronization primitives
+     * above are still alive.
+     */
+    std::vector<Thread> sending_threads_;
 };
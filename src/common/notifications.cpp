@@ -18,9 +18,14 @@
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <sstream>
+#include <thread>
 
 #include <dbus/dbus.h>
 #include <dlfcn.h>
@@ -139,9 +144,16 @@ bool setup_libdbus() {
     return true;
 }
 
-bool send_notification(const std::string& title,
-                       const std::string body,
-                       std::optional<ghc::filesystem::path> origin) {
+/**
+ * Synchronously deliver a notification over D-Bus. This is only ever called
+ * from the background delivery thread spawned in `send_notification()`, since
+ * both the lazy D-Bus setup and `dbus_connection_flush()` can block for a
+ * while when the session bus is slow.
+ */
+static bool deliver_notification(const std::string& title,
+                                 const std::string& body,
+                                 const std::optional<ghc::filesystem::path>&
+                                     origin) {
     // The first time this function is called we'll need to set up the D-Bus
     // interface. Previously yabridge relied on notify-send, but some distros
     // don't install that by default.
@@ -234,4 +246,109 @@ bool send_notification(const std::string& title,
     return result;
 }
 
+/**
+ * Repeats of a notification within this window get dropped. During plugin
+ * scanning dozens of plugins can fail with the exact same message in quick
+ * succession, and one notification carries that information just as well as
+ * thirty.
+ */
+constexpr std::chrono::seconds notification_deduplication_window(10);
+
+/**
+ * A notification queued for delivery by the background thread.
+ */
+struct Notification {
+    std::string title;
+    std::string body;
+    std::optional<ghc::filesystem::path> origin;
+};
+
+/**
+ * The queue behind `send_notification()`, drained by a lazily started
+ * background thread. Everything lives in one struct behind a function local
+ * static so the worker gets stopped and joined before the fields it uses are
+ * destroyed.
+ */
+struct NotificationQueue {
+    std::mutex mutex;
+    std::condition_variable_any notifications_available;
+    std::deque<Notification> pending;
+
+    /**
+     * When each message was last queued, keyed by its title and body. Used to
+     * drop repeats within `notification_deduplication_window`.
+     */
+    std::map<std::string, std::chrono::steady_clock::time_point>
+        recently_queued;
+
+    /**
+     * The delivery thread, started when the first notification gets queued.
+     * Anything still pending when the process shuts down gets dropped, which
+     * is fine for diagnostics that also go to the log.
+     */
+    std::jthread worker;
+};
+
+static NotificationQueue& notification_queue() {
+    static NotificationQueue queue{};
+    return queue;
+}
+
+bool send_notification(const std::string& title,
+                       std::string body,
+                       std::optional<ghc::filesystem::path> origin) {
+    NotificationQueue& queue = notification_queue();
+
+    std::unique_lock lock(queue.mutex);
+
+    // Deduplicate repeated messages. The map stays tiny because yabridge only
+    // sends a handful of distinct diagnostics, so there's no need to prune
+    // old entries.
+    const auto now = std::chrono::steady_clock::now();
+    const std::string deduplication_key = title + '\n' + body;
+    if (const auto last_queued = queue.recently_queued.find(deduplication_key);
+        last_queued != queue.recently_queued.end() &&
+        now - last_queued->second < notification_deduplication_window) {
+        return true;
+    }
+    queue.recently_queued[deduplication_key] = now;
+
+    queue.pending.push_back(Notification{.title = title,
+                                         .body = std::move(body),
+                                         .origin = std::move(origin)});
+
+    // Delivery happens on a background thread because connecting to and
+    // flushing a slow session bus can block for long enough to be noticeable
+    // during plugin scanning, and error reporting should never add latency
+    if (!queue.worker.joinable()) {
+        queue.worker = std::jthread([&queue](std::stop_token st) {
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("notifications");
+
+            std::unique_lock lock(queue.mutex);
+            while (queue.notifications_available.wait(
+                lock, st, [&]() { return !queue.pending.empty(); })) {
+                while (!queue.pending.empty()) {
+                    const Notification notification =
+                        std::move(queue.pending.front());
+                    queue.pending.pop_front();
+
+                    // The actual D-Bus traffic happens with the lock released
+                    // so a stalled bus can't block new `send_notification()`
+                    // calls
+                    lock.unlock();
+                    deliver_notification(notification.title,
+                                         notification.body,
+                                         notification.origin);
+                    lock.lock();
+                }
+            }
+        });
+    }
+
+    queue.notifications_available.notify_one();
+
+    return true;
+}
+
 #undef LIBDBUS_FUNCTIONS
@@ -28,6 +28,12 @@
  * Used for diagnostics when a plugin fails to load since the user may not be
  * checking the output in a terminal.
  *
+ * The notification is queued and delivered from a background thread, since
+ * connecting to and flushing a slow session bus can otherwise stall plugin
+ * scanning and bridge startup. Repeats of a notification queued in quick
+ * succession are deduplicated, so thirty plugins failing with the same
+ * message result in a single notification.
+ *
  * @param title The title (or technically, summary) of the notification.
  * @param body The message to display. This can contain line feeds, and it any
  *   HTML tags and XML escape sequences will be automatically escaped. The
@@ -36,9 +42,10 @@
  *   notification will append a 'Source: <XXX.so>' hyperlink to the body so the
  *   user can more easily navigate to the plugin's path.
  *
- * @return Whether the notification was sent. This will be false if
- *   `libdbus-1.so` is not available.
+ * @return Whether the notification was queued. Delivery itself is
+ *   asynchronous and best effort, and duplicates that were suppressed also
+ *   count as queued.
  */
 bool send_notification(const std::string& title,
-                       const std::string body,
+                       std::string body,
                        std::optional<ghc::filesystem::path> origin);
@@ -0,0 +1,119 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include <llvm/small-vector.h>
+
+/**
+ * A sequence container that retains both its capacity and its elements when it
+ * shrinks. Shrinking only moves the logical end of the container, and growing
+ * again reuses the elements that are still sitting in the storage beyond that
+ * end. When the element type itself owns heap storage (nested vectors,
+ * strings), this means that repeatedly deserializing differently shaped
+ * messages into the same object stops producing malloc/free pairs once every
+ * element has reached its high water mark, similar to an arena that gets reset
+ * in between messages.
+ *
+ * This is used for the nested containers in the VST3 process data, where the
+ * number of parameter change queues and events varies from block to block and
+ * a plain vector would destroy and reconstruct the spilled elements on the
+ * audio thread. Like `llvm::SmallVector` the first `N` elements are stored
+ * inline.
+ *
+ * Only the small part of the vector interface used by the serialization
+ * wrappers is implemented here.
+ */
+template <typename T, unsigned N>
+class PooledVector {
+   public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    T* begin() noexcept { return storage_.begin(); }
+    T* end() noexcept { return storage_.begin() + size_; }
+    const T* begin() const noexcept { return storage_.begin(); }
+    const T* end() const noexcept { return storage_.begin() + size_; }
+
+    T& operator[](size_t index) noexcept { return storage_[index]; }
+    const T& operator[](size_t index) const noexcept {
+        return storage_[index];
+    }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    /**
+     * Move the logical end of the container back to the start. The elements
+     * are kept alive so they can be reused later.
+     */
+    void clear() noexcept { size_ = 0; }
+
+    void reserve(size_t capacity) { storage_.reserve(capacity); }
+
+    /**
+     * Resize the container. Growing within the retained storage reuses the
+     * existing elements as is, so the caller should always overwrite them.
+     */
+    void resize(size_t new_size) {
+        if (new_size > storage_.size()) {
+            storage_.resize(new_size);
+        }
+        size_ = new_size;
+    }
+
+    void push_back(const T& value) {
+        if (size_ < storage_.size()) {
+            storage_[size_] = value;
+        } else {
+            storage_.push_back(value);
+        }
+        size_++;
+    }
+
+    void push_back(T&& value) {
+        if (size_ < storage_.size()) {
+            storage_[size_] = std::move(value);
+        } else {
+            storage_.push_back(std::move(value));
+        }
+        size_++;
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (size_ < storage_.size()) {
+            storage_[size_] = T(std::forward<Args>(args)...);
+        } else {
+            storage_.emplace_back(std::forward<Args>(args)...);
+        }
+
+        return storage_[size_++];
+    }
+
+   private:
+    /**
+     * The actual elements. This only ever grows, and `size_` determines how
+     * many of these elements are currently in use.
+     */
+    llvm::SmallVector<T, N> storage_;
+    size_t size_ = 0;
+};
@@ -0,0 +1,146 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+
+// The inline capacities for the small vectors in the serialized messages,
+// and the initial sizes of the audio thread serialization buffers. A block
+// that fits within these capacities serializes without touching the heap, so
+// they should cover normal sessions without wasting memory on the worst case
+// imaginable. The defaults below are educated guesses, but they can also be
+// set from measurements: the serialization code records the high-water marks
+// of these quantities (see `src/common/capacity-profile.h`), and building
+// with `-Dcapacity-profile=<path to an exported profile>` includes the
+// profile header here so the capacities match the sessions the profile was
+// collected from. Profiled values are used verbatim, so a profile containing
+// a pathological outlier (say, a plugin that once sent ten thousand events
+// in one block) is worth a look before building with it.
+
+#ifdef YABRIDGE_CAPACITY_PROFILE_FILE
+#include YABRIDGE_CAPACITY_PROFILE_FILE
+#endif
+
+// clang-format off
+#ifndef YABRIDGE_PROFILE_VST2_EVENTS
+#define YABRIDGE_PROFILE_VST2_EVENTS 64
+#endif
+#ifndef YABRIDGE_PROFILE_VST2_SYSEX_EVENTS
+#define YABRIDGE_PROFILE_VST2_SYSEX_EVENTS 8
+#endif
+#ifndef YABRIDGE_PROFILE_CLAP_EVENTS
+#define YABRIDGE_PROFILE_CLAP_EVENTS 128
+#endif
+#ifndef YABRIDGE_PROFILE_CLAP_NOTE_EVENTS
+#define YABRIDGE_PROFILE_CLAP_NOTE_EVENTS 32
+#endif
+#ifndef YABRIDGE_PROFILE_CLAP_PARAM_VALUE_EVENTS
+#define YABRIDGE_PROFILE_CLAP_PARAM_VALUE_EVENTS 32
+#endif
+#ifndef YABRIDGE_PROFILE_CLAP_PARAM_MOD_EVENTS
+#define YABRIDGE_PROFILE_CLAP_PARAM_MOD_EVENTS 32
+#endif
+#ifndef YABRIDGE_PROFILE_CLAP_MIDI_EVENTS
+#define YABRIDGE_PROFILE_CLAP_MIDI_EVENTS 32
+#endif
+#ifndef YABRIDGE_PROFILE_AUDIO_BUSES
+#define YABRIDGE_PROFILE_AUDIO_BUSES 8
+#endif
+#ifndef YABRIDGE_PROFILE_VST3_PARAMETER_QUEUES
+#define YABRIDGE_PROFILE_VST3_PARAMETER_QUEUES 16
+#endif
+#ifndef YABRIDGE_PROFILE_VST3_PARAMETER_POINTS
+#define YABRIDGE_PROFILE_VST3_PARAMETER_POINTS 64
+#endif
+#ifndef YABRIDGE_PROFILE_AUDIO_MESSAGE_BUFFER
+#define YABRIDGE_PROFILE_AUDIO_MESSAGE_BUFFER 2048
+#endif
+// clang-format on
+
+namespace capacities {
+
+/**
+ * VST2 events per `effProcessEvents()` call, see
+ * `DynamicVstEvents::events_`. At least 1 since the size of the
+ * accompanying `VstEvents` buffer is computed as `capacity - 1` extra
+ * pointers, which would wrap around for a profile collected without any
+ * VST2 plugins.
+ */
+constexpr size_t vst2_events =
+    YABRIDGE_PROFILE_VST2_EVENTS > 0 ? YABRIDGE_PROFILE_VST2_EVENTS : 1;
+
+/**
+ * SysEx events per `effProcessEvents()` call, see
+ * `DynamicVstEvents::sysex_data_`.
+ */
+constexpr size_t vst2_sysex_events = YABRIDGE_PROFILE_VST2_SYSEX_EVENTS;
+
+/**
+ * CLAP events per processed block across all event types, see
+ * `clap::events::EventList::order_`.
+ */
+constexpr size_t clap_events = YABRIDGE_PROFILE_CLAP_EVENTS;
+
+/**
+ * CLAP note events per processed block.
+ */
+constexpr size_t clap_note_events = YABRIDGE_PROFILE_CLAP_NOTE_EVENTS;
+
+/**
+ * CLAP parameter value events per processed block.
+ */
+constexpr size_t clap_param_value_events =
+    YABRIDGE_PROFILE_CLAP_PARAM_VALUE_EVENTS;
+
+/**
+ * CLAP parameter modulation events per processed block.
+ */
+constexpr size_t clap_param_mod_events =
+    YABRIDGE_PROFILE_CLAP_PARAM_MOD_EVENTS;
+
+/**
+ * CLAP MIDI events per processed block.
+ */
+constexpr size_t clap_midi_events = YABRIDGE_PROFILE_CLAP_MIDI_EVENTS;
+
+/**
+ * Audio input or output buses per plugin instance, used for the bus metadata
+ * vectors in the VST3 and CLAP process data.
+ */
+constexpr size_t audio_buses = YABRIDGE_PROFILE_AUDIO_BUSES;
+
+/**
+ * VST3 parameter change queues per processed block, see
+ * `YaParameterChanges`.
+ */
+constexpr size_t vst3_parameter_queues =
+    YABRIDGE_PROFILE_VST3_PARAMETER_QUEUES;
+
+/**
+ * VST3 parameter change points per processed block across all queues, see
+ * `YaParameterChanges`.
+ */
+constexpr size_t vst3_parameter_points =
+    YABRIDGE_PROFILE_VST3_PARAMETER_POINTS;
+
+/**
+ * The initial capacity in bytes of the thread local serialization buffers
+ * used for the VST3 and CLAP audio thread messages.
+ */
+constexpr size_t audio_message_buffer = YABRIDGE_PROFILE_AUDIO_MESSAGE_BUFFER;
+
+}  // namespace capacities
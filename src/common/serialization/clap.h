@@ -61,8 +61,7 @@ using ClapMainThreadControlRequest =
                  clap::plugin::Destroy,
                  clap::plugin::Activate,
                  clap::plugin::Deactivate,
-                 clap::ext::audio_ports::plugin::Count,
-                 clap::ext::audio_ports::plugin::Get,
+                 clap::ext::audio_ports::plugin::GetPorts,
                  clap::ext::audio_ports_config::plugin::Count,
                  clap::ext::audio_ports_config::plugin::Get,
                  clap::ext::audio_ports_config::plugin::Select,
@@ -81,8 +80,7 @@ using ClapMainThreadControlRequest =
                  clap::ext::latency::plugin::Get,
                  clap::ext::note_name::plugin::Count,
                  clap::ext::note_name::plugin::Get,
-                 clap::ext::note_ports::plugin::Count,
-                 clap::ext::note_ports::plugin::Get,
+                 clap::ext::note_ports::plugin::GetPorts,
                  clap::ext::params::plugin::GetInfos,
                  clap::ext::params::plugin::GetValue,
                  clap::ext::params::plugin::ValueToText,
@@ -90,6 +88,8 @@ using ClapMainThreadControlRequest =
                  clap::ext::render::plugin::HasHardRealtimeRequirement,
                  clap::ext::render::plugin::Set,
                  clap::ext::state::plugin::Save,
+                 clap::ext::state::plugin::SaveContinue,
+                 clap::ext::state::plugin::LoadChunk,
                  clap::ext::state::plugin::Load,
                  clap::ext::voice_info::plugin::Get>;
 
@@ -235,3 +235,14 @@ inline ClapAudioThreadControlRequest::Payload& get_request_variant(
     ClapAudioThreadControlRequest& request) noexcept {
     return request.payload;
 }
+
+/**
+ * The same for const objects, used by `message_traffic_entry()` so the
+ * traffic accounting is also kept per variant alternative for these requests.
+ *
+ * @overload
+ */
+inline const ClapAudioThreadControlRequest::Payload& get_request_variant(
+    const ClapAudioThreadControlRequest& request) noexcept {
+    return request.payload;
+}
@@ -16,147 +16,294 @@
 
 #include "events.h"
 
+#include "../../capacity-profile.h"
 #include "../../utils.h"
 
 namespace clap {
 namespace events {
 
-std::optional<Event> Event::parse(const clap_event_header_t& generic_event) {
-    std::optional<decltype(Event::payload)> payload;
-    if (generic_event.space_id == CLAP_CORE_EVENT_SPACE_ID) {
-        switch (generic_event.type) {
-            case CLAP_EVENT_NOTE_ON:
-            case CLAP_EVENT_NOTE_OFF:
-            case CLAP_EVENT_NOTE_CHOKE:
-            case CLAP_EVENT_NOTE_END: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_note_t&>(generic_event);
-
-                // The original event type can be restored from the header
-                payload = payload::Note{.event = event};
-            } break;
-            case CLAP_EVENT_NOTE_EXPRESSION: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_note_expression_t&>(
-                        generic_event);
-                payload = payload::NoteExpression{.event = event};
-            } break;
-            case CLAP_EVENT_PARAM_VALUE: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_param_value_t&>(
-                        generic_event);
-                payload = payload::ParamValue{.event = event};
-            } break;
-            case CLAP_EVENT_PARAM_MOD: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_param_mod_t&>(
-                        generic_event);
-                payload = payload::ParamMod{.event = event};
-            } break;
-            case CLAP_EVENT_PARAM_GESTURE_BEGIN:
-            case CLAP_EVENT_PARAM_GESTURE_END: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_param_gesture_t&>(
-                        generic_event);
-                payload = payload::ParamGesture{.event = event};
-            } break;
-            case CLAP_EVENT_TRANSPORT: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_transport_t&>(
-                        generic_event);
-                payload = payload::Transport{.event = event};
-            } break;
-            case CLAP_EVENT_MIDI: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_midi_t&>(generic_event);
-                payload = payload::Midi{.event = event};
-            } break;
-            case CLAP_EVENT_MIDI_SYSEX: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_midi_sysex_t&>(
-                        generic_event);
-
-                assert(event.buffer);
-                const auto sysex_payload = payload::MidiSysex{
-                    .event =
-                        clap_event_midi_sysex_t{
-                            .header = event.header,
-                            .port_index = event.port_index,
-                            // The buffer and size fields will be restored
-                            // during the `get_header()` call. Nulling the
-                            // pointer and zeroing the size should make
-                            // incorrect usage much easier to spot than leaving
-                            // them dangling.
-                            .buffer = nullptr,
-                            .size = 0},
-                    .buffer =
-                        std::string(reinterpret_cast<const char*>(event.buffer),
-                                    event.size)};
-            } break;
-            case CLAP_EVENT_MIDI2: {
-                const auto& event =
-                    reinterpret_cast<const clap_event_midi2_t&>(generic_event);
-                payload = payload::Midi2{.event = event};
-            } break;
-        }
+EventList::EventList() noexcept {}
+
+bool EventList::push_event(const clap_event_header_t& generic_event) {
+    if (generic_event.space_id != CLAP_CORE_EVENT_SPACE_ID) {
+        return false;
     }
 
-    if (payload) {
-        return Event{.payload = std::move(*payload)};
-    } else {
-        return std::nullopt;
+    switch (generic_event.type) {
+        case CLAP_EVENT_NOTE_ON:
+        case CLAP_EVENT_NOTE_OFF:
+        case CLAP_EVENT_NOTE_CHOKE:
+        case CLAP_EVENT_NOTE_END: {
+            // The original event type can be restored from the header
+            note_events_.push_back(
+                reinterpret_cast<const clap_event_note_t&>(generic_event));
+            order_.push_back(
+                make_order_entry(EventType::note, note_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_NOTE_EXPRESSION: {
+            note_expression_events_.push_back(
+                reinterpret_cast<const clap_event_note_expression_t&>(
+                    generic_event));
+            order_.push_back(
+                make_order_entry(EventType::note_expression,
+                                 note_expression_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_PARAM_VALUE: {
+            param_value_events_.push_back(
+                reinterpret_cast<const clap_event_param_value_t&>(
+                    generic_event));
+            order_.push_back(make_order_entry(
+                EventType::param_value, param_value_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_PARAM_MOD: {
+            param_mod_events_.push_back(
+                reinterpret_cast<const clap_event_param_mod_t&>(
+                    generic_event));
+            order_.push_back(make_order_entry(EventType::param_mod,
+                                              param_mod_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_PARAM_GESTURE_BEGIN:
+        case CLAP_EVENT_PARAM_GESTURE_END: {
+            param_gesture_events_.push_back(
+                reinterpret_cast<const clap_event_param_gesture_t&>(
+                    generic_event));
+            order_.push_back(make_order_entry(
+                EventType::param_gesture, param_gesture_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_TRANSPORT: {
+            transport_events_.push_back(
+                reinterpret_cast<const clap_event_transport_t&>(
+                    generic_event));
+            order_.push_back(make_order_entry(EventType::transport,
+                                              transport_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_MIDI: {
+            midi_events_.push_back(
+                reinterpret_cast<const clap_event_midi_t&>(generic_event));
+            order_.push_back(
+                make_order_entry(EventType::midi, midi_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_MIDI_SYSEX: {
+            const auto& event =
+                reinterpret_cast<const clap_event_midi_sysex_t&>(
+                    generic_event);
+
+            assert(event.buffer);
+            sysex_events_.push_back(MidiSysex{
+                .event =
+                    clap_event_midi_sysex_t{
+                        .header = event.header,
+                        .port_index = event.port_index,
+                        // The buffer and size fields will be restored in
+                        // `order_entry_header()`. Nulling the pointer and
+                        // zeroing the size should make incorrect usage much
+                        // easier to spot than leaving them dangling.
+                        .buffer = nullptr,
+                        .size = 0},
+                .buffer =
+                    std::string(reinterpret_cast<const char*>(event.buffer),
+                                event.size)});
+            order_.push_back(make_order_entry(EventType::midi_sysex,
+                                              sysex_events_.size() - 1));
+        } break;
+        case CLAP_EVENT_MIDI2: {
+            midi2_events_.push_back(
+                reinterpret_cast<const clap_event_midi2_t&>(generic_event));
+            order_.push_back(
+                make_order_entry(EventType::midi2, midi2_events_.size() - 1));
+        } break;
+        default: {
+            return false;
+        } break;
     }
-}
 
-const clap_event_header_t* Event::get() const {
-    return std::visit(
-        overload{[](payload::MidiSysex& event) -> const clap_event_header_t* {
-                     // These events contain heap data pointers. We store this
-                     // data using an `std::string` alongside the event struct,
-                     // but we can only set the pointer here just before
-                     // returning the event in case it was moved inbetween
-                     // deserialization and this function being called.
-                     event.event.buffer =
-                         reinterpret_cast<const uint8_t*>(event.buffer.data());
-                     event.event.size = event.buffer.size();
-
-                     return &event.event.header;
-                 },
-                 [](const auto& event) -> const clap_event_header_t* {
-                     return &event.event.header;
-                 }},
-        payload);
+    return true;
 }
 
-EventList::EventList() noexcept {}
+const clap_event_header_t* EventList::order_entry_header(
+    uint32_t entry) const {
+    const uint32_t index = order_entry_index(entry);
+    switch (order_entry_type(entry)) {
+        case EventType::note:
+            return &note_events_[index].header;
+        case EventType::note_expression:
+            return &note_expression_events_[index].header;
+        case EventType::param_value:
+            return &param_value_events_[index].header;
+        case EventType::param_mod:
+            return &param_mod_events_[index].header;
+        case EventType::param_gesture:
+            return &param_gesture_events_[index].header;
+        case EventType::transport:
+            return &transport_events_[index].header;
+        case EventType::midi:
+            return &midi_events_[index].header;
+        case EventType::midi_sysex: {
+            // These events contain heap data pointers. We store this data
+            // using an `std::string` alongside the event struct, but we can
+            // only set the pointer here just before returning the event in
+            // case the pool was reallocated inbetween deserialization and
+            // this function being called.
+            MidiSysex& event = sysex_events_[index];
+            event.event.buffer =
+                reinterpret_cast<const uint8_t*>(event.buffer.data());
+            event.event.size = event.buffer.size();
+
+            return &event.event.header;
+        }
+        case EventType::midi2:
+            return &midi2_events_[index].header;
+    }
+
+    return nullptr;
+}
 
 void EventList::repopulate(const clap_input_events_t& in_events) {
-    events_.clear();
+    clear();
 
     const uint32_t num_events = in_events.size(&in_events);
     for (uint32_t i = 0; i < num_events; i++) {
         const clap_event_header_t* event = in_events.get(&in_events, i);
         assert(event);
 
-        if (std::optional<Event> parsed_event = Event::parse(*event);
-            parsed_event) {
-            events_.emplace_back(std::move(*parsed_event));
+        push_event(*event);
+    }
+
+    observe_profile();
+}
+
+void EventList::append_coalescing(const clap_input_events_t& in_events) {
+    const uint32_t num_events = in_events.size(&in_events);
+    for (uint32_t i = 0; i < num_events; i++) {
+        const clap_event_header_t* event = in_events.get(&in_events, i);
+        assert(event);
+
+        // A new value for a parameter we already store a value event for
+        // simply overwrites the old event in place. The event keeps its
+        // original position in the order index, which doesn't matter since
+        // only the last value is meaningful.
+        if (event->space_id == CLAP_CORE_EVENT_SPACE_ID &&
+            event->type == CLAP_EVENT_PARAM_VALUE) {
+            const auto& value_event =
+                reinterpret_cast<const clap_event_param_value_t&>(*event);
+
+            bool coalesced = false;
+            for (clap_event_param_value_t& pending : param_value_events_) {
+                if (pending.param_id == value_event.param_id &&
+                    pending.note_id == value_event.note_id &&
+                    pending.port_index == value_event.port_index &&
+                    pending.channel == value_event.channel &&
+                    pending.key == value_event.key) {
+                    pending = value_event;
+                    coalesced = true;
+                    break;
+                }
+            }
+            if (coalesced) {
+                continue;
+            }
         }
+
+        push_event(*event);
     }
+
+    observe_profile();
+}
+
+void EventList::observe_profile() const noexcept {
+    CapacityProfile::observe(CapacityCounter::clap_events, order_.size());
+    CapacityProfile::observe(CapacityCounter::clap_note_events,
+                             note_events_.size());
+    CapacityProfile::observe(CapacityCounter::clap_param_value_events,
+                             param_value_events_.size());
+    CapacityProfile::observe(CapacityCounter::clap_param_mod_events,
+                             param_mod_events_.size());
+    CapacityProfile::observe(CapacityCounter::clap_midi_events,
+                             midi_events_.size());
 }
 
 void EventList::clear() noexcept {
-    events_.clear();
+    order_.clear();
+    note_events_.clear();
+    note_expression_events_.clear();
+    param_value_events_.clear();
+    param_mod_events_.clear();
+    param_gesture_events_.clear();
+    transport_events_.clear();
+    midi_events_.clear();
+    sysex_events_.clear();
+    midi2_events_.clear();
 }
 
 void EventList::write_back_outputs(
     const clap_output_events_t& out_events) const {
-    for (const auto& event : events_) {
+    for (const uint32_t entry : order_) {
         // We'll ignore the result here, we can't handle it anyways and maybe
         // some hosts will return `false` for events they don't recognize
         // instead of only when out of memory
-        out_events.try_push(&out_events, event.get());
+        out_events.try_push(&out_events, order_entry_header(entry));
+    }
+}
+
+void EventList::offload_prefix_to_ring(ShmEventRing& ring) {
+    size_t num_offloaded = 0;
+    for (const uint32_t entry : order_) {
+        // SysEx events contain a pointer to heap data that wouldn't be valid
+        // on the other side, so those have to go through the serialized path.
+        // Stopping at the first event we can't push keeps the event order
+        // intact, since the native side drains the ring first.
+        if (order_entry_type(entry) == EventType::midi_sysex) {
+            break;
+        }
+
+        const clap_event_header_t* header = order_entry_header(entry);
+        if (!ring.try_push(header, header->size)) {
+            break;
+        }
+
+        num_offloaded++;
     }
+
+    if (num_offloaded == 0) {
+        return;
+    }
+    if (num_offloaded == order_.size()) {
+        clear();
+        return;
+    }
+
+    // Events are appended to their pools in arrival order, so the offloaded
+    // prefix of the order index references exactly a prefix of every pool.
+    // Drop those prefixes and shift the remaining indices down. Since the
+    // ring is rarely full this partial offload case should hardly ever be
+    // hit.
+    std::array<uint32_t, num_event_types> num_consumed{};
+    for (size_t i = 0; i < num_offloaded; i++) {
+        num_consumed[static_cast<size_t>(order_entry_type(order_[i]))]++;
+    }
+
+    order_.erase(order_.begin(), order_.begin() + num_offloaded);
+    for (uint32_t& entry : order_) {
+        // The index occupies the entry's low bits, so this leaves the type
+        // bits untouched
+        entry -= num_consumed[static_cast<size_t>(order_entry_type(entry))];
+    }
+
+    const auto drop_pool_prefix = [&num_consumed](auto& pool, EventType type) {
+        const uint32_t num_events = num_consumed[static_cast<size_t>(type)];
+        if (num_events > 0) {
+            pool.erase(pool.begin(), pool.begin() + num_events);
+        }
+    };
+
+    drop_pool_prefix(note_events_, EventType::note);
+    drop_pool_prefix(note_expression_events_, EventType::note_expression);
+    drop_pool_prefix(param_value_events_, EventType::param_value);
+    drop_pool_prefix(param_mod_events_, EventType::param_mod);
+    drop_pool_prefix(param_gesture_events_, EventType::param_gesture);
+    drop_pool_prefix(transport_events_, EventType::transport);
+    drop_pool_prefix(midi_events_, EventType::midi);
+    drop_pool_prefix(midi2_events_, EventType::midi2);
 }
 
 const clap_input_events_t* EventList::input_events() {
@@ -178,7 +325,7 @@ uint32_t CLAP_ABI EventList::in_size(const struct clap_input_events* list) {
     assert(list && list->ctx);
     auto self = static_cast<const EventList*>(list->ctx);
 
-    return self->events_.size();
+    return self->order_.size();
 }
 
 const clap_event_header_t* CLAP_ABI
@@ -186,8 +333,8 @@ EventList::in_get(const struct clap_input_events* list, uint32_t index) {
     assert(list && list->ctx);
     auto self = static_cast<const EventList*>(list->ctx);
 
-    if (index < self->events_.size()) {
-        return self->events_[index].get();
+    if (index < self->order_.size()) {
+        return self->order_entry_header(self->order_[index]);
     } else {
         return nullptr;
     }
@@ -198,10 +345,7 @@ bool CLAP_ABI EventList::out_try_push(const struct clap_output_events* list,
     assert(list && list->ctx && event);
     auto self = static_cast<EventList*>(list->ctx);
 
-    if (std::optional<Event> parsed_event = Event::parse(*event);
-        parsed_event) {
-        self->events_.emplace_back(std::move(*parsed_event));
-    }
+    self->push_event(*event);
 
     // We'll pretend we accepted the event even if we don't recognize it
     return true;
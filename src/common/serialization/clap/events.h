@@ -16,16 +16,18 @@
 
 #pragma once
 
+#include <array>
 #include <string>
-#include <variant>
+#include <type_traits>
 
+#include <bitsery/traits/array.h>
 #include <bitsery/traits/string.h>
 #include <clap/events.h>
 #include <llvm/small-vector.h>
 
-#include "../bitsery/ext/in-place-variant.h"
-#include "../bitsery/ext/native-pointer.h"
+#include "../../event-ring.h"
 #include "../bitsery/traits/small-vector.h"
+#include "../capacities.h"
 #include "../common.h"
 
 // Serialization messages for `clap/events.h`
@@ -34,102 +36,37 @@ namespace clap {
 namespace events {
 
 /**
- * The actual event data. `clap::events::Event` stores these as a variant.
- * Ideally we'd store only the non-header payload data, but the
- * `clap_input_events::get()` function requires us to return a pointer to the
- * header, so if we did that then we'd need to create a second buffer containing
- * the serialzed events.
+ * The data capacity of the single-producer/single-consumer ring buffer
+ * reserved at the start of a CLAP instance's shared memory object. Output
+ * events produced by the plugin during processing are pushed into this ring
+ * as raw event structs on the Wine side instead of being serialized as part
+ * of the process response. Must be a power of two.
  */
-namespace payload {
+constexpr uint32_t output_event_ring_capacity = 8192;
 
 /**
- * The payload for `clap_event_note`. This is used for multiple event types,
- * which are encoded through `event.header.type`.
+ * Serialize a fixed size CLAP event struct by copying it as raw bytes. Notes
+ * and parameter values make up practically all real world event traffic, and
+ * since those are plain fixed size structs we can write them with a single
+ * copy instead of going through the field based serializer. Variable length
+ * events (SysEx) still use the field based path.
+ *
+ * NOTE: This assumes that both sides use the same struct layout. That holds
+ *       because CLAP support is disabled in the 32-bit yabridge builds, so
+ *       the native plugin and the Wine plugin host always run on the same
+ *       architecture. The cookie pointers in `clap_event_param_{value,mod}_t`
+ *       would otherwise need the `bitsery::ext::NativePointer` treatment.
  */
-struct Note {
-    clap_event_note_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
-
-/**
- * The payload for `clap_event_note_expression`.
- */
-struct NoteExpression {
-    clap_event_note_expression_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
-
-/**
- * The payload for `clap_event_param_value`.
- */
-struct ParamValue {
-    clap_event_param_value_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
-
-/**
- * The payload for `clap_event_param_mod`.
- */
-struct ParamMod {
-    clap_event_param_mod_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
-
-/**
- * The payload for `clap_event_param_gesture`. This is used for multiple event
- * types, which are encoded through `event.header.type`.
- */
-struct ParamGesture {
-    clap_event_param_gesture_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
-
-/**
- * The payload for `clap_event_transport`.
- */
-struct Transport {
-    clap_event_transport_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
-
-/**
- * The payload for `clap_event_midi`.
- */
-struct Midi {
-    clap_event_midi_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
-};
+template <typename S, typename T>
+inline void serialize_flat_event(S& s, T& event) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    s.container1b(reinterpret_cast<std::array<uint8_t, sizeof(T)>&>(event));
+}
 
 /**
- * The payload for `clap_event_midi_sysex`.
+ * A `clap_event_midi_sysex_t` along with its variable length data. The other
+ * event types are stored and serialized as their raw structs, but SysEx events
+ * contain a pointer to heap data so they need special handling.
  */
 struct MidiSysex {
     clap_event_midi_sysex_t event;
@@ -166,70 +103,52 @@ struct MidiSysex {
 };
 
 /**
- * The payload for `clap_event_midi2`.
+ * The event type pools in `EventList`. Multiple CLAP event types can map to
+ * the same pool, like the four note event types that all use
+ * `clap_event_note_t`. The original event type is encoded in the stored
+ * event's header.
  */
-struct Midi2 {
-    clap_event_midi2_t event;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.object(event);
-    }
+enum class EventType : uint8_t {
+    note,
+    note_expression,
+    param_value,
+    param_mod,
+    param_gesture,
+    transport,
+    midi,
+    midi_sysex,
+    midi2,
 };
 
-}  // namespace payload
+constexpr size_t num_event_types = 9;
 
 /**
- * Encodes a CLAP event. These can be parsed from a `clap_event_header_t*` and
- * reconstructed back to a `clap_event_header`.
+ * An entry in `EventList`'s order index, packing the pool an event lives in
+ * together with its index into that pool. 24 bits is plenty for the index
+ * since event lists are capped at `1 << 16` events anyways.
  */
-struct alignas(16) Event {
-    /**
-     * Parse a CLAP event. Returns a nullopt if yabridge does not support the
-     * event.
-     */
-    static std::optional<Event> parse(const clap_event_header_t& generic_event);
-
-    /**
-     * Get the `clap_event_header_t*` representation for this event. The pointer
-     * is valid as long as this struct isn't moved.
-     */
-    const clap_event_header_t* get() const;
+constexpr uint32_t make_order_entry(EventType type, uint32_t index) noexcept {
+    return (static_cast<uint32_t>(type) << 24) | index;
+}
 
-    /**
-     * The actual event data. These also contain the header because storing the
-     * entire `clap_event_*_t` struct is the only way to serialize the event
-     * list in a way that doesn't require us to create a second event list in
-     * that format after deserializing the events. An alternative would be to
-     * write the event in the proper format to a buffer before returning it from
-     * `clap_input_events::get()`, but that would cause unexpected lifetime
-     * issues.
-     */
-    mutable std::variant<
-        payload::Note,
-        payload::NoteExpression,
-        payload::ParamValue,
-        payload::ParamMod,
-        payload::ParamGesture,
-        // Most events are about the same length, but having the transport in
-        // here sadly doubles this struct's size
-        // TODO: Pack the events at some point, this will require special
-        //       handling for SysEx events
-        payload::Transport,
-        payload::Midi,
-        payload::MidiSysex,
-        payload::Midi2>
-        payload;
+constexpr EventType order_entry_type(uint32_t entry) noexcept {
+    return static_cast<EventType>(entry >> 24);
+}
 
-    template <typename S>
-    void serialize(S& s) {
-        s.ext(payload, bitsery::ext::InPlaceVariant{});
-    }
-};
+constexpr uint32_t order_entry_index(uint32_t entry) noexcept {
+    return entry & 0x00ff'ffffu;
+}
 
 /**
  * A list storing one or more CLAP events. Can be used for both input and output
  * events.
+ *
+ * Events are stored in type-segregated pools of raw `clap_event_*_t` structs,
+ * with a separate index recording the original event order. This keeps every
+ * pool densely packed so the whole list serializes as a handful of `memcpy`s,
+ * and the inline pool capacities mean realistic event blocks never allocate.
+ * This matters for polyphonic modulation heavy synths, where a single process
+ * call can come with hundreds of parameter modulation events.
  */
 class EventList {
    public:
@@ -246,6 +165,17 @@ class EventList {
      */
     void repopulate(const clap_input_events_t& in_events);
 
+    /**
+     * Append events from a `clap_input_events_t` to this object without
+     * clearing it first, overwriting an already stored parameter value event
+     * in place when a new value arrives for the same parameter. Only the last
+     * value matters when a parameter changes multiple times within the same
+     * flush window, so this keeps a burst of per-parameter
+     * `clap_plugin_params::flush()` calls from growing the list beyond one
+     * event per parameter.
+     */
+    void append_coalescing(const clap_input_events_t& in_events);
+
     /**
      * Remove all events. Used at the start of the process function for the
      * output event list.
@@ -257,6 +187,18 @@ class EventList {
      */
     void write_back_outputs(const clap_output_events_t& out_events) const;
 
+    /**
+     * Move the longest possible prefix of this list's events into the shared
+     * memory event ring as raw event structs, so they don't have to be
+     * serialized as part of the process response. Used on the Wine side after
+     * the process call. This stops at the first SysEx event, since those
+     * contain a pointer to variable length data, and when the ring is full.
+     * The remaining events stay in this list and take the regular serialized
+     * path, which keeps the original event order intact because the native
+     * side drains the ring before writing back this list.
+     */
+    void offload_prefix_to_ring(ShmEventRing& ring);
+
     /**
      * Get a `clap_input_events_t` interface for this event list that the plugin
      * can read the events from. This is only valid as long as this object is
@@ -280,15 +222,80 @@ class EventList {
     /**
      * Return the number of events we store. Used in debug logs.
      */
-    inline size_t size() const noexcept { return events_.size(); }
+    inline size_t size() const noexcept { return order_.size(); }
 
     template <typename S>
     void serialize(S& s) {
-        s.container(events_, 1 << 16);
+        // The order index and the per-pool counts are the only structural
+        // overhead on the wire, the event bodies themselves are written as
+        // raw bytes
+        s.container4b(order_, 1 << 16);
+
+        const auto flat_pool = [](S& serializer, auto& pool) {
+            serializer.container(pool, 1 << 16, [](S& s, auto& event) {
+                serialize_flat_event(s, event);
+            });
+        };
+
+        flat_pool(s, note_events_);
+        flat_pool(s, note_expression_events_);
+        flat_pool(s, param_value_events_);
+        flat_pool(s, param_mod_events_);
+        flat_pool(s, param_gesture_events_);
+        flat_pool(s, transport_events_);
+        flat_pool(s, midi_events_);
+        s.container(sysex_events_, 1 << 16);
+        flat_pool(s, midi2_events_);
     }
 
    private:
-    llvm::SmallVector<Event, 64> events_;
+    /**
+     * Parse a CLAP event and append it to the matching pool and the order
+     * index. Returns `false` if yabridge does not support the event, in which
+     * case it is skipped.
+     */
+    bool push_event(const clap_event_header_t& generic_event);
+
+    /**
+     * Get the `clap_event_header_t*` for an entry in `order_`. The pointer is
+     * valid until the pools are modified. For SysEx events this also restores
+     * the event's buffer pointer, which is why `sysex_events_` is mutable.
+     */
+    const clap_event_header_t* order_entry_header(uint32_t entry) const;
+
+    /**
+     * Record the current pool sizes in the capacity profile high-water
+     * marks, see `src/common/capacity-profile.h`. Called after reading a
+     * block's events from the host or the plugin.
+     */
+    void observe_profile() const noexcept;
+
+    /**
+     * The order in which the events were pushed, as created by
+     * `make_order_entry()`. `clap_input_events_t` indices map directly onto
+     * this list.
+     */
+    llvm::SmallVector<uint32_t, capacities::clap_events> order_;
+
+    // The type-segregated event pools. The inline capacities are based on
+    // what a busy project produces in a single process call, so going through
+    // the heap should be rare. The larger pools can also be sized from a
+    // capacity profile, see `../capacities.h`.
+    llvm::SmallVector<clap_event_note_t, capacities::clap_note_events>
+        note_events_;
+    llvm::SmallVector<clap_event_note_expression_t, 16> note_expression_events_;
+    llvm::SmallVector<clap_event_param_value_t,
+                      capacities::clap_param_value_events>
+        param_value_events_;
+    llvm::SmallVector<clap_event_param_mod_t,
+                      capacities::clap_param_mod_events>
+        param_mod_events_;
+    llvm::SmallVector<clap_event_param_gesture_t, 8> param_gesture_events_;
+    llvm::SmallVector<clap_event_transport_t, 2> transport_events_;
+    llvm::SmallVector<clap_event_midi_t, capacities::clap_midi_events>
+        midi_events_;
+    mutable llvm::SmallVector<MidiSysex, 2> sysex_events_;
+    llvm::SmallVector<clap_event_midi2_t, 8> midi2_events_;
 
     // These are populated in the `input_events()` and `output_events()` methods
     clap_input_events_t input_events_vtable_{};
@@ -310,64 +317,10 @@ void serialize(S& s, clap_event_header_t& event_header) {
     s.value4b(event_header.flags);
 }
 
-template <typename S>
-void serialize(S& s, clap_event_note_t& event) {
-    s.object(event.header);
-    s.value4b(event.note_id);
-    s.value2b(event.port_index);
-    s.value2b(event.channel);
-    s.value2b(event.key);
-    s.value8b(event.velocity);
-}
-
-template <typename S>
-void serialize(S& s, clap_event_note_expression_t& event) {
-    s.object(event.header);
-    s.value4b(event.expression_id);
-    s.value4b(event.note_id);
-    s.value2b(event.port_index);
-    s.value2b(event.channel);
-    s.value2b(event.key);
-    s.value8b(event.value);
-}
-
-template <typename S>
-void serialize(S& s, clap_event_param_value_t& event) {
-    s.object(event.header);
-    s.value4b(event.param_id);
-    // The cookie is a pointer. Using `native_size_t`/the host system's pointer
-    // size here will allow bridged 32-bit plugins to work correctly.
-    // XXX: This will silently blow up when using 32-bit yabridge on a 64-bit
-    //      system with 64-bit plugins, but that's such a specific use case that
-    //      we won't even bother. Building 32-bit yabridge with CLAP support on
-    //      64-bit symbols has been disabled to prevent this from being an
-    //      issue.
-    s.ext(event.cookie, bitsery::ext::NativePointer{});
-    s.value4b(event.note_id);
-    s.value2b(event.port_index);
-    s.value2b(event.channel);
-    s.value2b(event.key);
-    s.value8b(event.value);
-}
-
-template <typename S>
-void serialize(S& s, clap_event_param_mod_t& event) {
-    s.object(event.header);
-    s.value4b(event.param_id);
-    // Same as the above
-    s.ext(event.cookie, bitsery::ext::NativePointer{});
-    s.value4b(event.note_id);
-    s.value2b(event.port_index);
-    s.value2b(event.channel);
-    s.value2b(event.key);
-    s.value8b(event.amount);
-}
-
-template <typename S>
-void serialize(S& s, clap_event_param_gesture_t& event) {
-    s.object(event.header);
-    s.value4b(event.param_id);
-}
+// Most fixed size event structs are serialized as raw bytes by
+// `clap::events::serialize_flat_event()`, so they don't need field based
+// serialization functions here. The transport event does get one since it's
+// also serialized as part of `clap::process::Process`.
 
 template <typename S>
 void serialize(S& s, clap_event_transport_t& event) {
@@ -387,20 +340,6 @@ void serialize(S& s, clap_event_transport_t& event) {
     s.value2b(event.tsig_denom);
 }
 
-template <typename S>
-void serialize(S& s, clap_event_midi_t& event) {
-    s.object(event.header);
-    s.value2b(event.port_index);
-    s.container1b(event.data);
-}
-
 // `clap_event_midi_sysex_t` can't be serialized without special handling, so
-// we'll serialize it directly inside of `clap::events::payload::MidiSysex` to
-// reduce the risk of this causing problems in the future
-
-template <typename S>
-void serialize(S& s, clap_event_midi2_t& event) {
-    s.object(event.header);
-    s.value2b(event.port_index);
-    s.container4b(event.data);
-}
+// we'll serialize it directly inside of `clap::events::MidiSysex` to reduce
+// the risk of this causing problems in the future
@@ -69,49 +69,44 @@ struct NotePortInfo {
 namespace plugin {
 
 /**
- * Message struct for `clap_plugin_note_ports::count()`.
+ * The response to the `clap::ext::note_ports::plugin::GetPorts` message
+ * defined below.
  */
-struct Count {
-    using Response = PrimitiveResponse<uint32_t>;
-
-    native_size_t instance_id;
-    bool is_input;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.value8b(instance_id);
-        s.value1b(is_input);
-    }
-};
-
-/**
- * The response to the `clap::ext::note_ports::plugin::Get` message defined
- * below.
- */
-struct GetResponse {
-    std::optional<NotePortInfo> result;
+struct GetPortsResponse {
+    /**
+     * The infos for all of the plugin's input and output note ports. If the
+     * plugin somehow returned an error for a port that should be in range,
+     * then this contains a nullopt value.
+     */
+    std::vector<std::optional<NotePortInfo>> inputs;
+    std::vector<std::optional<NotePortInfo>> outputs;
 
     template <typename S>
     void serialize(S& s) {
-        s.ext(result, bitsery::ext::InPlaceOptional());
+        s.container(inputs, 1 << 14, [](S& s, auto& v) {
+            s.ext(v, bitsery::ext::InPlaceOptional{});
+        });
+        s.container(outputs, 1 << 14, [](S& s, auto& v) {
+            s.ext(v, bitsery::ext::InPlaceOptional{});
+        });
     }
 };
 
 /**
- * Message struct for `clap_plugin_note_ports::get()`.
+ * Message struct for querying all of the plugin's note ports at once using
+ * `clap_plugin_note_ports::count()` and `clap_plugin_note_ports::get()`.
+ * Hosts tend to re-query the entire port layout around every activation, so
+ * just like the parameter infos this information is cached on the native side
+ * until the plugin asks the host to rescan its note ports.
  */
-struct Get {
-    using Response = GetResponse;
+struct GetPorts {
+    using Response = GetPortsResponse;
 
     native_size_t instance_id;
-    uint32_t index;
-    bool is_input;
 
     template <typename S>
     void serialize(S& s) {
         s.value8b(instance_id);
-        s.value4b(index);
-        s.value1b(is_input);
     }
 };
 
@@ -33,16 +33,24 @@ namespace plugin {
  * The response to the `clap::ext::state::plugin::Save` message defined below.
  */
 struct SaveResponse {
-    std::optional<clap::stream::Stream> result;
+    /**
+     * The first chunk of the saved state, or a nullopt if the plugin's save
+     * function returned false. When `first_chunk->is_last` is not set the
+     * native side pulls the rest of the state with `SaveContinue` messages.
+     */
+    std::optional<clap::stream::StreamChunk> first_chunk;
 
     template <typename S>
     void serialize(S& s) {
-        s.ext(result, bitsery::ext::InPlaceOptional());
+        s.ext(first_chunk, bitsery::ext::InPlaceOptional());
     }
 };
 
 /**
- * Message struct for `clap_plugin_state::save()`.
+ * Message struct for `clap_plugin_state::save()`. The state is transferred in
+ * `clap::stream::transfer_chunk_size` windows so large states don't have to
+ * be duplicated into a serialization buffer in one piece and don't block the
+ * control socket for the entire transfer.
  */
 struct Save {
     using Response = SaveResponse;
@@ -56,18 +64,58 @@ struct Save {
 };
 
 /**
- * Message struct for `clap_plugin_state::load()`.
+ * Message struct for pulling the next chunk of a state save started with the
+ * `Save` message defined above. Only sent when the previous chunk's `is_last`
+ * field was not set.
+ */
+struct SaveContinue {
+    using Response = clap::stream::StreamChunk;
+
+    native_size_t instance_id;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value8b(instance_id);
+    }
+};
+
+/**
+ * Message struct for streaming a chunk of the state passed to
+ * `clap_plugin_state::load()` ahead of the final `Load` message defined
+ * below. The Wine side appends these chunks to a per-instance buffer, and the
+ * native side only reads the next chunk from the host's stream after the
+ * previous one has been acknowledged.
+ */
+struct LoadChunk {
+    using Response = Ack;
+
+    native_size_t instance_id;
+    std::vector<uint8_t> data;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value8b(instance_id);
+        s.ext(data,
+              bitsery::ext::GatheredVector{clap::stream::transfer_chunk_size});
+    }
+};
+
+/**
+ * Message struct for `clap_plugin_state::load()`. Contains the state's final
+ * chunk, any earlier chunks will have already been transferred with the
+ * `LoadChunk` message defined above.
  */
 struct Load {
     using Response = PrimitiveResponse<bool>;
 
     native_size_t instance_id;
-    clap::stream::Stream stream;
+    std::vector<uint8_t> data;
 
     template <typename S>
     void serialize(S& s) {
         s.value8b(instance_id);
-        s.object(stream);
+        s.ext(data,
+              bitsery::ext::GatheredVector{clap::stream::transfer_chunk_size});
     }
 };
 
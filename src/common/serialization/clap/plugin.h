@@ -24,6 +24,7 @@
 #include <clap/plugin.h>
 
 #include "../../bitsery/ext/in-place-optional.h"
+#include "../../utils.h"
 #include "../audio-shm.h"
 #include "../common.h"
 #include "host.h"
@@ -329,20 +330,19 @@ struct Process {
     clap::process::Process process;
 
     /**
-     * We'll periodically synchronize the realtime priority setting of the
+     * We'll periodically synchronize the realtime scheduling parameters of the
      * host's audio thread with the Wine plugin host. We'll do this
      * approximately every ten seconds, as doing this getting and setting
      * scheduler information has a non trivial amount of overhead (even if it's
      * only a single microsoecond).
      */
-    std::optional<int> new_realtime_priority;
+    std::optional<RealtimeParameters> new_realtime_parameters;
 
     template <typename S>
     void serialize(S& s) {
         s.value8b(instance_id);
         s.object(process);
-        s.ext(new_realtime_priority, bitsery::ext::InPlaceOptional{},
-              [](S& s, int& priority) { s.value4b(priority); });
+        s.ext(new_realtime_parameters, bitsery::ext::InPlaceOptional{});
     }
 };
 
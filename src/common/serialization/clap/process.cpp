@@ -16,9 +16,35 @@
 
 #include "process.h"
 
+#include <algorithm>
+
+#include "../../audio-copy.h"
+#include "../../capacity-profile.h"
+
 namespace clap {
 namespace process {
 
+/**
+ * Check whether two transport structs are identical in every field except for
+ * the song position. We can't just `memcmp()` the entire struct because of the
+ * padding between the header and the first 64-bit field.
+ */
+static bool transport_equal_except_song_pos(
+    const clap_event_transport_t& a,
+    const clap_event_transport_t& b) noexcept {
+    return a.header.size == b.header.size && a.header.time == b.header.time &&
+           a.header.space_id == b.header.space_id &&
+           a.header.type == b.header.type &&
+           a.header.flags == b.header.flags && a.flags == b.flags &&
+           a.tempo == b.tempo && a.tempo_inc == b.tempo_inc &&
+           a.loop_start_beats == b.loop_start_beats &&
+           a.loop_end_beats == b.loop_end_beats &&
+           a.loop_start_seconds == b.loop_start_seconds &&
+           a.loop_end_seconds == b.loop_end_seconds &&
+           a.bar_start == b.bar_start && a.bar_number == b.bar_number &&
+           a.tsig_num == b.tsig_num && a.tsig_denom == b.tsig_denom;
+}
+
 Process::Process() noexcept {}
 
 void Process::repopulate(const clap_process_t& process,
@@ -38,9 +64,44 @@ void Process::repopulate(const clap_process_t& process,
     steady_time_ = process.steady_time;
     frames_count_ = process.frames_count;
 
+    // The transport barely ever changes unpredictably between blocks, so
+    // instead of retransmitting the full struct every cycle we encode it
+    // relative to the previous block's transport that's still cached in
+    // `transport_`. The Wine side applies the exact same state transitions to
+    // its own cached copy in `reconstruct()`, so during steady playback only
+    // the single coding byte hits the wire.
     if (process.transport) {
-        transport_.emplace(*process.transport);
+        const clap_event_transport_t& transport = *process.transport;
+        if (transport_ && transport_equal_except_song_pos(transport,
+                                                          *transport_)) {
+            const clap_beattime beats_delta =
+                transport.song_pos_beats - transport_->song_pos_beats;
+            const clap_sectime seconds_delta =
+                transport.song_pos_seconds - transport_->song_pos_seconds;
+            if (beats_delta == 0 && seconds_delta == 0) {
+                transport_coding_ = TransportCoding::Unchanged;
+            } else if (beats_delta == transport_beats_delta_ &&
+                       seconds_delta == transport_seconds_delta_) {
+                transport_coding_ = TransportCoding::Advanced;
+            } else {
+                transport_coding_ = TransportCoding::Full;
+                transport_beats_delta_ = beats_delta;
+                transport_seconds_delta_ = seconds_delta;
+            }
+        } else {
+            transport_coding_ = TransportCoding::Full;
+            transport_beats_delta_ = 0;
+            transport_seconds_delta_ = 0;
+        }
+
+        if (transport_coding_ == TransportCoding::Full) {
+            transport_wire_ = transport;
+        }
+        transport_.emplace(transport);
     } else {
+        transport_coding_ = TransportCoding::None;
+        transport_beats_delta_ = 0;
+        transport_seconds_delta_ = 0;
         transport_.reset();
     }
 
@@ -66,29 +127,9 @@ void Process::repopulate(const clap_process_t& process,
         if (process.audio_inputs[port].data32) {
             audio_inputs_type_[port] =
                 clap::audio_buffer::AudioBufferType::Float32;
-
-            // We copy the actual input audio for every bus to the shared memory
-            // object
-            for (uint32_t channel = 0;
-                 channel < process.audio_inputs[port].channel_count;
-                 channel++) {
-                std::copy_n(process.audio_inputs[port].data32[channel],
-                            frames_count_,
-                            shared_audio_buffers.input_channel_ptr<float>(
-                                port, channel));
-            }
         } else if (process.audio_inputs[port].data64) {
             audio_inputs_type_[port] =
                 clap::audio_buffer::AudioBufferType::Double64;
-
-            for (uint32_t channel = 0;
-                 channel < process.audio_inputs[port].channel_count;
-                 channel++) {
-                std::copy_n(process.audio_inputs[port].data64[channel],
-                            frames_count_,
-                            shared_audio_buffers.input_channel_ptr<double>(
-                                port, channel));
-            }
         } else {
             // Only reasonable-ish (it's still not reasonable) time where
             // neither of the pointers is set
@@ -96,6 +137,76 @@ void Process::repopulate(const clap_process_t& process,
         }
     }
 
+    // We copy the actual input audio for every bus to the shared memory
+    // object. Instead of walking the nested offset tables port-by-port, this
+    // uses the flat copy plan the shared memory object precomputed for the
+    // negotiated layout, so the loop's overhead is independent of the port
+    // topology. Constant channels only need their first frame: the host may
+    // have flagged the channel through the constant mask, and for unflagged
+    // channels we do a cheap scan for digital silence ourselves since silent
+    // inputs are very common in large sessions. The Wine side splats the
+    // first frame across the rest of the buffer for flagged channels,
+    // replacing a read-and-write copy with a store-only fill.
+    for (const auto& entry : shared_audio_buffers.input_copy_plan()) {
+        // The plan covers the plugin's entire negotiated layout, and the
+        // entries are in port-major order. The per-port channel counts have
+        // been capped to what the host provided above.
+        if (entry.bus >= process.audio_inputs_count) {
+            break;
+        }
+        if (entry.channel >= audio_inputs_[entry.bus].channel_count) {
+            continue;
+        }
+
+        if (audio_inputs_type_[entry.bus] ==
+            clap::audio_buffer::AudioBufferType::Double64) {
+            const double* host_buffer =
+                process.audio_inputs[entry.bus].data64[entry.channel];
+            double* shm_buffer =
+                reinterpret_cast<double*>(entry.shm_pointer);
+            if (entry.channel < 64) {
+                const uint64_t channel_bit = 1ull << entry.channel;
+                if (process.audio_inputs[entry.bus].constant_mask &
+                    channel_bit) {
+                    if (frames_count_ > 0) {
+                        shm_buffer[0] = host_buffer[0];
+                    }
+                    continue;
+                } else if (audio_copy::is_silent(host_buffer, frames_count_)) {
+                    audio_inputs_[entry.bus].constant_mask |= channel_bit;
+                    if (frames_count_ > 0) {
+                        shm_buffer[0] = 0.0;
+                    }
+                    continue;
+                }
+            }
+
+            audio_copy::convert_copy_n(host_buffer, frames_count_, shm_buffer);
+        } else {
+            const float* host_buffer =
+                process.audio_inputs[entry.bus].data32[entry.channel];
+            float* shm_buffer = reinterpret_cast<float*>(entry.shm_pointer);
+            if (entry.channel < 64) {
+                const uint64_t channel_bit = 1ull << entry.channel;
+                if (process.audio_inputs[entry.bus].constant_mask &
+                    channel_bit) {
+                    if (frames_count_ > 0) {
+                        shm_buffer[0] = host_buffer[0];
+                    }
+                    continue;
+                } else if (audio_copy::is_silent(host_buffer, frames_count_)) {
+                    audio_inputs_[entry.bus].constant_mask |= channel_bit;
+                    if (frames_count_ > 0) {
+                        shm_buffer[0] = 0.0f;
+                    }
+                    continue;
+                }
+            }
+
+            audio_copy::convert_copy_n(host_buffer, frames_count_, shm_buffer);
+        }
+    }
+
     audio_outputs_.resize(process.audio_outputs_count);
     audio_outputs_type_.resize(process.audio_outputs_count);
     for (size_t port = 0; port < process.audio_outputs_count; port++) {
@@ -124,13 +235,52 @@ void Process::repopulate(const clap_process_t& process,
     }
 
     in_events_.repopulate(*process.in_events);
+
+    CapacityProfile::observe(
+        CapacityCounter::audio_buses,
+        std::max(audio_inputs_.size(), audio_outputs_.size()));
 }
 
 const clap_process_t& Process::reconstruct(
-    std::vector<std::vector<void*>>& input_pointers,
-    std::vector<std::vector<void*>>& output_pointers) {
+    AudioShmBuffer::BusPointers& input_pointers,
+    AudioShmBuffer::BusPointers& output_pointers) {
     reconstructed_process_data_.steady_time = steady_time_;
     reconstructed_process_data_.frames_count = frames_count_;
+
+    // Apply the deduplicated transport from the wire to our cached copy of
+    // the previous block's transport. These transitions mirror the ones in
+    // `repopulate()` exactly, which is also why a full transport is first
+    // deserialized into `transport_wire_`: we still need the previous song
+    // position here to keep the cached deltas in sync with the plugin side.
+    switch (transport_coding_) {
+        case TransportCoding::None:
+            transport_beats_delta_ = 0;
+            transport_seconds_delta_ = 0;
+            transport_.reset();
+            break;
+        case TransportCoding::Full:
+            if (transport_ && transport_equal_except_song_pos(transport_wire_,
+                                                              *transport_)) {
+                transport_beats_delta_ = transport_wire_.song_pos_beats -
+                                         transport_->song_pos_beats;
+                transport_seconds_delta_ = transport_wire_.song_pos_seconds -
+                                           transport_->song_pos_seconds;
+            } else {
+                transport_beats_delta_ = 0;
+                transport_seconds_delta_ = 0;
+            }
+            transport_.emplace(transport_wire_);
+            break;
+        case TransportCoding::Unchanged:
+            assert(transport_);
+            break;
+        case TransportCoding::Advanced:
+            assert(transport_);
+            transport_->song_pos_beats += transport_beats_delta_;
+            transport_->song_pos_seconds += transport_seconds_delta_;
+            break;
+    }
+
     reconstructed_process_data_.transport = transport_ ? &*transport_ : nullptr;
 
     // The actual audio data is contained within a shared memory object, and the
@@ -155,6 +305,36 @@ const clap_process_t& Process::reconstruct(
                     reinterpret_cast<double**>(input_pointers[port].data());
                 break;
         }
+
+        // The native plugin side only copies the first frame for channels
+        // whose constant mask bit is set. Plugins are allowed to ignore the
+        // mask and read the full buffer, so we'll splat that first frame
+        // across the rest of the buffer here. This is a store-only fill
+        // instead of the read-and-write copy it replaces.
+        for (uint32_t channel = 0;
+             channel < audio_inputs_[port].channel_count && channel < 64;
+             channel++) {
+            if ((audio_inputs_[port].constant_mask & (1ull << channel)) == 0 ||
+                frames_count_ == 0) {
+                continue;
+            }
+
+            switch (audio_inputs_type_[port]) {
+                case clap::audio_buffer::AudioBufferType::Float32:
+                default: {
+                    float* buffer =
+                        reinterpret_cast<float*>(input_pointers[port][channel]);
+                    std::fill_n(buffer + 1, frames_count_ - 1, buffer[0]);
+                    break;
+                }
+                case clap::audio_buffer::AudioBufferType::Double64: {
+                    double* buffer = reinterpret_cast<double*>(
+                        input_pointers[port][channel]);
+                    std::fill_n(buffer + 1, frames_count_ - 1, buffer[0]);
+                    break;
+                }
+            }
+        }
     }
     for (size_t port = 0; port < audio_outputs_.size(); port++) {
         switch (audio_outputs_type_[port]) {
@@ -168,6 +348,12 @@ const clap_process_t& Process::reconstruct(
                     reinterpret_cast<double**>(output_pointers[port].data());
                 break;
         }
+
+        // The output constant mask is for the plugin to set. Clearing it here
+        // makes sure that the constant fill in `write_back_outputs()` only
+        // ever acts on mask bits the plugin actually set during this block,
+        // and not on stale values provided by the host.
+        audio_outputs_[port].constant_mask = 0;
     }
 
     reconstructed_process_data_.audio_inputs = audio_inputs_.data();
@@ -201,37 +387,85 @@ Process::Response& Process::create_response() noexcept {
 }
 
 void Process::write_back_outputs(const clap_process_t& process,
-                                 const AudioShmBuffer& shared_audio_buffers) {
+                                 const AudioShmBuffer& shared_audio_buffers,
+                                 ShmEventRing* output_event_ring) {
     assert(process.audio_outputs && process.out_events);
 
+    // Most output events were pushed into the shared memory ring as raw event
+    // structs on the Wine side. Only SysEx events and ring overflow end up in
+    // the serialized `out_events_` list, and the Wine side stops offloading
+    // at the first such event so draining the ring first preserves the
+    // original event order.
+    if (output_event_ring && output_event_ring->attached()) {
+        output_event_ring->drain(
+            [&process](const uint8_t* record, uint32_t /*size*/) {
+                process.out_events->try_push(
+                    process.out_events,
+                    reinterpret_cast<const clap_event_header_t*>(record));
+            });
+    }
+
     assert(audio_outputs_.size() == process.audio_outputs_count);
     for (size_t port = 0; port < audio_outputs_.size(); port++) {
         process.audio_outputs[port].constant_mask =
             audio_outputs_[port].constant_mask;
         // Don't think the plugin is supposed to change this, but uh may as well
         process.audio_outputs[port].latency = audio_outputs_[port].latency;
+    }
 
-        // `audio_outputs_[port].channel_count` is the minimum of the plugin's
-        // and the host's channel count
-        for (size_t channel = 0; channel < audio_outputs_[port].channel_count;
-             channel++) {
-            // We copy the output audio for every bus from the shared memory
-            // object back to the buffer provided by the host
-            switch (audio_outputs_type_[port]) {
-                case clap::audio_buffer::AudioBufferType::Float32:
-                default:
-                    std::copy_n(shared_audio_buffers.output_channel_ptr<float>(
-                                    port, channel),
-                                process.frames_count,
-                                process.audio_outputs[port].data32[channel]);
+    // We copy the output audio for every bus from the shared memory object
+    // back to the buffer provided by the host, again through the flat
+    // precomputed copy plan rather than the nested offset tables.
+    // `audio_outputs_[port].channel_count` is the minimum of the plugin's and
+    // the host's channel count.
+    for (const auto& entry : shared_audio_buffers.output_copy_plan()) {
+        if (entry.bus >= process.audio_outputs_count) {
+            break;
+        }
+        if (entry.channel >= audio_outputs_[entry.bus].channel_count) {
+            continue;
+        }
+
+        // If the plugin marked an output channel as constant then the buffer
+        // can be filled from its first frame instead of copied in full. The
+        // constant mask itself has already been written back above, and in
+        // practice these constants are almost always silence.
+        const bool constant =
+            entry.channel < 64 &&
+            (audio_outputs_[entry.bus].constant_mask &
+             (1ull << entry.channel)) &&
+            process.frames_count > 0;
+
+        switch (audio_outputs_type_[entry.bus]) {
+            case clap::audio_buffer::AudioBufferType::Float32:
+            default:
+                if (constant) {
+                    std::fill_n(
+                        process.audio_outputs[entry.bus].data32[entry.channel],
+                        process.frames_count,
+                        reinterpret_cast<const float*>(entry.shm_pointer)[0]);
                     break;
-                case clap::audio_buffer::AudioBufferType::Double64:
-                    std::copy_n(shared_audio_buffers.output_channel_ptr<double>(
-                                    port, channel),
-                                process.frames_count,
-                                process.audio_outputs[port].data64[channel]);
+                }
+
+                audio_copy::convert_copy_n(
+                    reinterpret_cast<const float*>(entry.shm_pointer),
+                    process.frames_count,
+                    process.audio_outputs[entry.bus].data32[entry.channel]);
+                break;
+            case clap::audio_buffer::AudioBufferType::Double64:
+                if (constant) {
+                    std::fill_n(
+                        process.audio_outputs[entry.bus].data64[entry.channel],
+                        process.frames_count,
+                        reinterpret_cast<const double*>(entry.shm_pointer)[0]);
                     break;
-            }
+                }
+
+                audio_copy::convert_copy_n(
+                    reinterpret_cast<const double*>(entry.shm_pointer),
+                    process.frames_count,
+                    process.audio_outputs[entry.bus].data64[entry.channel]);
+                break;
         }
     }
 
@@ -22,7 +22,7 @@
 #include <llvm/small-vector.h>
 
 #include "../../audio-shm.h"
-#include "../../bitsery/ext/in-place-optional.h"
+#include "../capacities.h"
 #include "audio-buffer.h"
 #include "events.h"
 
@@ -31,6 +31,39 @@
 namespace clap {
 namespace process {
 
+/**
+ * How the transport information is encoded on the wire for a process call.
+ * During steady playback the transport either doesn't change at all or only
+ * the song position advances by the same amount every block, so in those
+ * cases we can send a single byte instead of the full
+ * `clap_event_transport_t` struct and reconstruct the transport on the Wine
+ * side from the previous block's transport. Both sides keep their cached
+ * transport and song position deltas in the persistent `Process` objects, so
+ * they stay in sync as long as every serialized `Process` is reconstructed
+ * exactly once.
+ */
+enum class TransportCoding : uint8_t {
+    /**
+     * The host didn't provide any transport information.
+     */
+    None,
+    /**
+     * The full transport struct follows on the wire.
+     */
+    Full,
+    /**
+     * The transport is byte-for-byte identical to the previous block's
+     * transport.
+     */
+    Unchanged,
+    /**
+     * The song position advanced by the same amount as it did during the
+     * previous block, and all other fields are identical. The receiving side
+     * reapplies its cached deltas to its cached transport.
+     */
+    Advanced,
+};
+
 /**
  * A serializable wrapper around `clap_process_t`. This works exactly the same
  * as the process data wrapper for VST3. At the start of a process cycle all
@@ -96,8 +129,8 @@ class Process {
      * in our `clap::audio_buffer::AudioBuffer` serialization wrapper.
      */
     const clap_process_t& reconstruct(
-        std::vector<std::vector<void*>>& input_pointers,
-        std::vector<std::vector<void*>>& output_pointers);
+        AudioShmBuffer::BusPointers& input_pointers,
+        AudioShmBuffer::BusPointers& output_pointers);
 
     /**
      * A serializable wrapper around the output fields of `clap_process_t`, so
@@ -150,17 +183,28 @@ class Process {
     /**
      * Write all of this output data back to the host's `clap_process_t` object.
      * During this process we'll also write the output audio from the
-     * corresponding shared memory audio buffers back.
+     * corresponding shared memory audio buffers back. If an output event ring
+     * is passed, then the events the Wine side pushed into that ring are
+     * drained to the host first, before the (remaining) events that were
+     * serialized as part of the response.
      */
     void write_back_outputs(const clap_process_t& process,
-                            const AudioShmBuffer& shared_audio_buffers);
+                            const AudioShmBuffer& shared_audio_buffers,
+                            ShmEventRing* output_event_ring = nullptr);
 
     template <typename S>
     void serialize(S& s) {
         s.value8b(steady_time_);
         s.value4b(frames_count_);
 
-        s.ext(transport_, bitsery::ext::InPlaceOptional{});
+        // The transport is only sent in full when it changed unpredictably
+        // compared to the previous block. During steady playback this is a
+        // single byte, and `repopulate()`/`reconstruct()` apply the same
+        // state transitions to the cached `transport_` on both sides.
+        s.value1b(transport_coding_);
+        if (transport_coding_ == TransportCoding::Full) {
+            s.object(transport_wire_);
+        }
 
         // Both `audio_inputs_` and `audio_outputs_` only store metadata. The
         // actual audio is sent using an accompanying `AudioShmBuffer` object.
@@ -181,22 +225,50 @@ class Process {
     int64_t steady_time_ = 0;
     uint32_t frames_count_ = 0;
 
-    // This is an optional field
+    // This is an optional field. It doubles as the per-instance transport
+    // cache for the deduplication described in `TransportCoding`: since this
+    // object persists between process calls on both sides, after
+    // `repopulate()` (plugin side) or `reconstruct()` (Wine side) this always
+    // contains the current block's transport, which the next block's coding
+    // is relative to.
     std::optional<clap_event_transport_t> transport_;
 
+    /**
+     * How the transport is encoded on the wire for this block, decided in
+     * `repopulate()` and applied to `transport_` in `reconstruct()`.
+     */
+    TransportCoding transport_coding_ = TransportCoding::None;
+
+    /**
+     * The staging area for a `TransportCoding::Full` transport. We can't
+     * deserialize directly into `transport_` because `reconstruct()` still
+     * needs the previous block's song position to update the cached deltas.
+     */
+    clap_event_transport_t transport_wire_{};
+
+    /**
+     * The song position deltas between the previous two blocks that both had
+     * transport information, used to reconstruct a
+     * `TransportCoding::Advanced` transport. Kept in lockstep on both sides.
+     */
+    clap_beattime transport_beats_delta_ = 0;
+    clap_sectime transport_seconds_delta_ = 0;
+
     /**
      * The audio input buffers for every port. We'll only serialize the metadata
      * During `reconstruct()` the channel pointers pointers in these objects
      * will be set to point to our shared memory surface that holds the actual
      * audio data.
      */
-    llvm::SmallVector<clap_audio_buffer_t, 8> audio_inputs_;
+    llvm::SmallVector<clap_audio_buffer_t, capacities::audio_buses>
+        audio_inputs_;
     /**
      * The types corresponding to each buffer in `audio_inputs_`. This needs to
      * be serialized separately since this information is encoded by setting one
      * of the two pointers instead of through a flag.
      */
-    llvm::SmallVector<clap::audio_buffer::AudioBufferType, 8>
+    llvm::SmallVector<clap::audio_buffer::AudioBufferType,
+                      capacities::audio_buses>
         audio_inputs_type_;
 
     /**
@@ -205,13 +277,15 @@ class Process {
      * objects will be set to point to our shared memory surface that holds the
      * actual audio data.
      */
-    llvm::SmallVector<clap_audio_buffer_t, 8> audio_outputs_;
+    llvm::SmallVector<clap_audio_buffer_t, capacities::audio_buses>
+        audio_outputs_;
     /**
      * The types corresponding to each buffer in `audio_outputs_`. This needs to
      * be serialized separately since this information is encoded by setting one
      * of the two pointers instead of through a flag.
      */
-    llvm::SmallVector<clap::audio_buffer::AudioBufferType, 8>
+    llvm::SmallVector<clap::audio_buffer::AudioBufferType,
+                      capacities::audio_buses>
         audio_outputs_type_;
 
     clap::events::EventList in_events_;
@@ -19,36 +19,30 @@
 namespace clap {
 namespace stream {
 
-/**
- * We'll try to read the host's `clap_istream_t` in 1 MB chunks.
- */
-constexpr size_t read_chunk_size = 1 << 20;
-
 Stream::Stream() {}
 
-Stream::Stream(const clap_istream_t& original) {
-    // CLAP streams have no length indication. A plugin could do something like
-    // prepending the stream's length to the stream, but we can't do that. So
-    // instead we'll try to read in 1 MB chunks until we reach end of file. Even
-    // if the stream's size is over 1 MB, the host may still return less than 1
-    // MB at a time at its discretion.
-    size_t stream_length = 0;
-    while (true) {
-        // Start by reserving enough capacity to read 1 MB
-        buffer_.resize(stream_length + read_chunk_size);
-        const int64_t num_bytes_read = original.read(
-            &original, buffer_.data() + stream_length, read_chunk_size);
-
-        // We're done when we reach the end of the file
-        if (num_bytes_read <= 0) {
-            break;
-        }
+void Stream::append(const std::vector<uint8_t>& data) {
+    buffer_.insert(buffer_.end(), data.begin(), data.end());
+}
 
-        stream_length += num_bytes_read;
-    }
+StreamChunk Stream::take_chunk() {
+    const size_t num_bytes =
+        std::min(transfer_chunk_size, buffer_.size() - read_pos_);
+
+    StreamChunk chunk{
+        .data = std::vector<uint8_t>(
+            buffer_.data() + read_pos_,
+            buffer_.data() + read_pos_ + num_bytes),
+        .is_last = false};
+    read_pos_ += num_bytes;
+    chunk.is_last = read_pos_ == buffer_.size();
 
-    // Trim the excess reserved space
-    buffer_.resize(stream_length);
+    return chunk;
+}
+
+void Stream::clear() noexcept {
+    buffer_.clear();
+    read_pos_ = 0;
 }
 
 const clap_ostream_t* Stream::ostream() {
@@ -65,21 +59,6 @@ const clap_istream_t* Stream::istream() {
     return &istream_vtable_;
 }
 
-void Stream::write_to_stream(const clap_ostream_t& original) const {
-    // The host may not let us write the whole stream all at once, so we need to
-    // keep track of how many bytes we've written and keep going until
-    // everything has been written back to the host.
-    size_t num_bytes_written = 0;
-    while (num_bytes_written < buffer_.size()) {
-        const int64_t actual_written_bytes =
-            original.write(&original, buffer_.data() + num_bytes_written,
-                           buffer_.size() - num_bytes_written);
-        assert(actual_written_bytes > 0);
-
-        num_bytes_written += actual_written_bytes;
-    }
-}
-
 int64_t CLAP_ABI Stream::ostream_write(const struct clap_ostream* stream,
                                        const void* buffer,
                                        uint64_t size) {
@@ -113,5 +92,44 @@ int64_t CLAP_ABI Stream::istream_read(const struct clap_istream* stream,
     return static_cast<int64_t>(num_bytes_read);
 }
 
+std::vector<uint8_t> read_chunk_from_stream(const clap_istream_t& original) {
+    // CLAP streams have no length indication, so we'll keep reading until the
+    // chunk is full or we reach the end of the stream. Even if more data is
+    // available the host may still return less than we ask for at a time at
+    // its discretion.
+    std::vector<uint8_t> chunk(transfer_chunk_size);
+    size_t chunk_length = 0;
+    while (chunk_length < transfer_chunk_size) {
+        const int64_t num_bytes_read =
+            original.read(&original, chunk.data() + chunk_length,
+                          transfer_chunk_size - chunk_length);
+        if (num_bytes_read <= 0) {
+            break;
+        }
+
+        chunk_length += num_bytes_read;
+    }
+
+    chunk.resize(chunk_length);
+
+    return chunk;
+}
+
+void write_chunk_to_stream(const clap_ostream_t& original,
+                           const std::vector<uint8_t>& data) {
+    // The host may not let us write the whole chunk all at once, so we need to
+    // keep track of how many bytes we've written and keep going until
+    // everything has been written back to the host.
+    size_t num_bytes_written = 0;
+    while (num_bytes_written < data.size()) {
+        const int64_t actual_written_bytes =
+            original.write(&original, data.data() + num_bytes_written,
+                           data.size() - num_bytes_written);
+        assert(actual_written_bytes > 0);
+
+        num_bytes_written += actual_written_bytes;
+    }
+}
+
 }  // namespace stream
 }  // namespace clap
@@ -21,34 +21,77 @@
 #include <bitsery/traits/vector.h>
 #include <clap/stream.h>
 
+#include "../../bitsery/ext/gathered-vector.h"
+
 // Serialization messages for `clap/stream.h`
 
 namespace clap {
 namespace stream {
 
 /**
- * A serialization wrapper around streams that can be used as both a
- * `clap_istream_t` and a `clap_ostream_t`.
+ * The window size used when transferring state streams over the socket. State
+ * is sent in chunks of at most this size instead of as a single message, so a
+ * huge sampler state never has to be duplicated into a serialization buffer
+ * in one piece and doesn't monopolize the control socket for the entire
+ * transfer.
+ */
+constexpr size_t transfer_chunk_size = 1 << 20;
+
+/**
+ * A single window of a chunked state transfer. The side holding the state
+ * sends these one at a time, and the other side requests or sends the next
+ * chunk only after the previous one has been handled. That means at most one
+ * chunk is in flight, which bounds the memory overhead and provides natural
+ * back-pressure.
+ */
+struct StreamChunk {
+    std::vector<uint8_t> data;
+    /**
+     * Whether this is the transfer's last chunk. The receiving side keeps
+     * pulling chunks until this is set.
+     */
+    bool is_last;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.ext(data, bitsery::ext::GatheredVector{transfer_chunk_size});
+        s.value1b(is_last);
+    }
+};
+
+/**
+ * A buffer around streamed state that can be used as both a `clap_istream_t`
+ * and a `clap_ostream_t`. Used on the Wine side to collect the state written
+ * by the plugin during `clap_plugin_state::save()` before it is pulled to the
+ * native side in chunks, and to reassemble received chunks before handing
+ * them to `clap_plugin_state::load()`.
  */
 class Stream {
    public:
     /**
      * Create an empty stream that can be written to by the plugin using
-     * `ostream()`, and then written back to the host using
-     * `write_to_ostream()`.
+     * `ostream()` or filled with received transfer chunks using `append()`.
      */
     Stream();
 
     /**
-     * Read a `clap_istream_t` from the host to a buffer. The results are
-     * written to a buffer that can be serialized and send to the other side.
+     * Append a received transfer chunk's data to this stream.
+     */
+    void append(const std::vector<uint8_t>& data);
+
+    /**
+     * Pop the next transfer chunk from this stream. This shares the read
+     * cursor with `istream_read()`, so a stream should be either read by the
+     * plugin or sent over the socket, not both.
      */
-    Stream(const clap_istream_t& original);
+    StreamChunk take_chunk();
 
     /**
-     * The buffer's size in bytes, used for logging.
+     * Remove all buffered data and reset the read cursor. Called after the
+     * plugin has consumed a reassembled stream so the next transfer starts
+     * from a clean slate.
      */
-    inline size_t size() const noexcept { return buffer_.size(); }
+    void clear() noexcept;
 
     /**
      * Get a `clap_ostream_t` for this buffer that the plugin can write to. This
@@ -61,16 +104,6 @@ class Stream {
      */
     const clap_istream_t* istream();
 
-    /**
-     * Write the entire buffer to a host provided `clap_ostream_t`.
-     */
-    void write_to_stream(const clap_ostream_t& original) const;
-
-    template <typename S>
-    void serialize(S& s) {
-        s.container1b(buffer_, 50 << 20);
-    }
-
    protected:
     static int64_t CLAP_ABI ostream_write(const struct clap_ostream* stream,
                                           const void* buffer,
@@ -93,5 +126,21 @@ class Stream {
     clap_istream_t istream_vtable_{};
 };
 
+/**
+ * Read the next transfer chunk from a host provided `clap_istream_t`. This
+ * keeps reading until the chunk is full or the stream ends, since the host
+ * may return short reads at its discretion. An empty result indicates the end
+ * of the stream.
+ */
+std::vector<uint8_t> read_chunk_from_stream(const clap_istream_t& original);
+
+/**
+ * Write a received transfer chunk's data to a host provided `clap_ostream_t`,
+ * retrying until everything has been written since the host may not accept
+ * the whole chunk at once.
+ */
+void write_chunk_to_stream(const clap_ostream_t& original,
+                           const std::vector<uint8_t>& data);
+
 }  // namespace stream
 }  // namespace clap
@@ -17,10 +17,12 @@
 #pragma once
 
 #include <bitsery/traits/string.h>
+#include <bitsery/traits/vector.h>
 
 #include <cstddef>
 #include <cstdint>
 #include <type_traits>
+#include <vector>
 
 #include "../configuration.h"
 #include "../plugins.h"
@@ -93,6 +95,17 @@ struct HostRequest {
     std::string plugin_path;
     std::string endpoint_base_dir;
     pid_t parent_pid;
+    /**
+     * The path to the `yabridge-host-32.exe` binary when the plugin needs the
+     * 32-bit bitbridge host, and an empty string otherwise. A group host
+     * process that receives a request with this field set doesn't load the
+     * plugin itself, since a 64-bit process can't load 32-bit libraries.
+     * Instead it delegates the request to a companion 32-bit group host
+     * process that it spawns on demand. This way 32-bit plugins can join the
+     * same plugin group as their 64-bit counterparts, with the regular group
+     * host acting as the group's single entry point.
+     */
+    std::string bitbridge_host_path;
 
     template <typename S>
     void serialize(S& s) {
@@ -100,6 +113,7 @@ struct HostRequest {
         s.text1b(plugin_path, 4096);
         s.text1b(endpoint_base_dir, 4096);
         s.value4b(parent_pid);
+        s.text1b(bitbridge_host_path, 4096);
     }
 };
 
@@ -128,6 +142,100 @@ struct HostResponse {
     }
 };
 
+/**
+ * The maximum number of plugin instances a single `GroupStatsResponse` can
+ * describe. Group host processes will never host anywhere near this many
+ * plugins at once, this limit only exists because bitsery requires an upper
+ * bound for container serialization.
+ */
+constexpr size_t max_group_instances = 8192;
+
+/**
+ * The load counters for a single plugin instance hosted by a group host
+ * process, as reported in a `GroupStatsResponse`. All counters are running
+ * totals since the plugin was loaded, except for `process_call_ewma_ns` which
+ * is an exponentially weighted moving average over recent audio processing
+ * calls.
+ *
+ * @relates GroupStatsResponse
+ */
+struct GroupInstanceStats {
+    /**
+     * The group host's own identifier for this instance. These are handed out
+     * sequentially in plugin load order.
+     */
+    native_size_t plugin_id;
+    /**
+     * The path to the plugin .dll file or bundle this instance has loaded.
+     */
+    std::string plugin_path;
+    /**
+     * CPU time in nanoseconds spent inside the plugin's audio processing
+     * function.
+     */
+    uint64_t audio_cpu_ns;
+    /**
+     * CPU time in nanoseconds spent handling host-to-plugin dispatcher calls,
+     * including the GUI related ones that run on the plugin's event loop
+     * thread.
+     */
+    uint64_t gui_cpu_ns;
+    /**
+     * The number of audio processing calls handled for this instance.
+     */
+    uint64_t process_call_count;
+    /**
+     * An exponentially weighted moving average of the wall clock duration of
+     * recent audio processing calls, in nanoseconds.
+     */
+    uint64_t process_call_ewma_ns;
+    /**
+     * The number of host-to-plugin dispatcher calls handled for this
+     * instance.
+     */
+    uint64_t event_count;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value8b(plugin_id);
+        s.text1b(plugin_path, 4096);
+        s.value8b(audio_cpu_ns);
+        s.value8b(gui_cpu_ns);
+        s.value8b(process_call_count);
+        s.value8b(process_call_ewma_ns);
+        s.value8b(event_count);
+    }
+};
+
+/**
+ * The response to a load statistics query sent to a group host process.
+ * Sending a `HostRequest` with its `plugin_type` field set to
+ * `PluginType::unknown` is treated as such a query instead of a request to
+ * host a plugin, and the group host replies with this object instead of the
+ * usual `HostResponse`. `yabridge-host.exe stats <socket>` uses this to
+ * attribute a group process's resource usage to the individual plugin
+ * instances it is hosting.
+ */
+struct GroupStatsResponse {
+    /**
+     * The group host process's PID, so the numbers can be matched with the
+     * process shown in `top`.
+     */
+    pid_t pid;
+    /**
+     * The statistics for every plugin instance that has finished
+     * initializing, in load order.
+     */
+    std::vector<GroupInstanceStats> instances;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value4b(pid);
+        s.container(instances, max_group_instances,
+                    [](S& s, GroupInstanceStats& stats) { s.object(stats); });
+    }
+};
+
 /**
  * A reference wrapper similar `std::reference_wrapper<T>` that supports default
  * initializing (which is of course UB, but we need this for serialization) and
@@ -0,0 +1,111 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "state-diff.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+StateDiff StateDiffEncoder::encode(const std::vector<uint8_t>& state) {
+    StateDiff diff{.total_size = state.size(),
+                   .is_incremental = false,
+                   .regions = {}};
+
+    // Diffing is only possible when the state kept its size. In practice
+    // states that change size also change wholesale, so there's no point in
+    // trying to match up blocks across an insertion.
+    if (state.size() == last_state_.size() && !state.empty()) {
+        std::vector<StateDiffRegion> regions{};
+        size_t changed_bytes = 0;
+        const size_t size = state.size();
+        for (size_t block_start = 0; block_start < size;
+             block_start += state_diff_block_size) {
+            const size_t block_length =
+                std::min(state_diff_block_size, size - block_start);
+            if (std::memcmp(state.data() + block_start,
+                            last_state_.data() + block_start,
+                            block_length) == 0) {
+                continue;
+            }
+
+            if (!regions.empty() &&
+                regions.back().offset + regions.back().data.size() ==
+                    block_start) {
+                regions.back().data.insert(
+                    regions.back().data.end(), state.data() + block_start,
+                    state.data() + block_start + block_length);
+            } else {
+                regions.push_back(StateDiffRegion{
+                    .offset = block_start,
+                    .data = std::vector<uint8_t>(
+                        state.data() + block_start,
+                        state.data() + block_start + block_length)});
+            }
+            changed_bytes += block_length;
+        }
+
+        // When most of the state changed anyways a full transfer is simpler
+        // and avoids the per-region bookkeeping on both sides
+        if (changed_bytes * 2 < size) {
+            for (const StateDiffRegion& region : regions) {
+                std::copy(region.data.begin(), region.data.end(),
+                          last_state_.begin() +
+                              static_cast<ptrdiff_t>(region.offset));
+            }
+
+            diff.is_incremental = true;
+            diff.regions = std::move(regions);
+            return diff;
+        }
+    }
+
+    last_state_ = state;
+    diff.regions.push_back(StateDiffRegion{.offset = 0, .data = state});
+    return diff;
+}
+
+void StateDiffDecoder::apply(const StateDiff& diff,
+                             std::vector<uint8_t>& state) {
+    if (diff.is_incremental) {
+        if (last_state_.size() != diff.total_size) {
+            throw std::runtime_error(
+                "Received an incremental state diff that doesn't match the "
+                "retained state");
+        }
+
+        for (const StateDiffRegion& region : diff.regions) {
+            if (region.offset + region.data.size() > last_state_.size()) {
+                throw std::runtime_error(
+                    "Received an out of bounds state diff region");
+            }
+
+            std::copy(region.data.begin(), region.data.end(),
+                      last_state_.begin() +
+                          static_cast<ptrdiff_t>(region.offset));
+        }
+    } else {
+        assert(diff.regions.size() <= 1);
+        if (diff.regions.empty()) {
+            last_state_.clear();
+        } else {
+            last_state_ = diff.regions.front().data;
+        }
+    }
+
+    state = last_state_;
+}
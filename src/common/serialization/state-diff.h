@@ -0,0 +1,129 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <bitsery/traits/vector.h>
+
+#include "../bitsery/ext/gathered-vector.h"
+
+// Block level diffing for repeated state transfers. Hosts fetch the complete
+// plugin state on every autosave, and successive snapshots of the same
+// instance are usually nearly identical. Instead of sending the whole state
+// every time, the sending side retains a copy of the last transferred state
+// and only sends the ranges that changed since then, and the receiving side
+// patches its own retained copy with those ranges to reconstruct the full
+// state. Both sides' retained copies advance in lockstep because the states
+// travel over a strict request-response socket, so no generation tracking is
+// needed.
+
+/**
+ * The granularity the retained states are compared at. Changed blocks that
+ * are adjacent get merged into a single region.
+ */
+constexpr size_t state_diff_block_size = 4096;
+
+/**
+ * The maximum size of a transferred state, matching `max_vector_stream_size`
+ * from the VST3 serialization since these diffs are currently only applied to
+ * `YaBStream`s.
+ */
+constexpr size_t state_diff_max_size = 50 << 20;
+
+/**
+ * A contiguous changed range within a state, as part of a `StateDiff`.
+ */
+struct StateDiffRegion {
+    uint64_t offset;
+    std::vector<uint8_t> data;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value8b(offset);
+        s.ext(data, bitsery::ext::GatheredVector{state_diff_max_size});
+    }
+};
+
+/**
+ * A state encoded as a set of changes relative to the last transferred state,
+ * produced by `StateDiffEncoder::encode()` and turned back into the full
+ * state by `StateDiffDecoder::apply()`.
+ */
+struct StateDiff {
+    /**
+     * The size of the full state this diff reconstructs.
+     */
+    uint64_t total_size;
+
+    /**
+     * Whether `regions` contains only the changed ranges. When false this is
+     * a full transfer and `regions` holds a single region with the entire
+     * state, which happens on the first transfer, when the state changed
+     * size, and when so much changed that a diff wouldn't save anything.
+     */
+    bool is_incremental;
+
+    std::vector<StateDiffRegion> regions;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value8b(total_size);
+        s.value1b(is_incremental);
+        s.container(regions,
+                    (state_diff_max_size / state_diff_block_size) + 1);
+    }
+};
+
+/**
+ * The sending side of a state diff pair. Every plugin instance owns one of
+ * these for its `getState()` transfers, with the matching `StateDiffDecoder`
+ * living on the other side of the socket.
+ */
+class StateDiffEncoder {
+   public:
+    /**
+     * Encode `state` as a diff against the last encoded state, retaining a
+     * copy for the next call. Falls back to a full transfer when the state
+     * changed size or when at least half of its blocks changed.
+     */
+    StateDiff encode(const std::vector<uint8_t>& state);
+
+   private:
+    std::vector<uint8_t> last_state_;
+};
+
+/**
+ * The receiving side of a state diff pair.
+ */
+class StateDiffDecoder {
+   public:
+    /**
+     * Reconstruct the full state described by `diff`, patching this decoder's
+     * retained copy with the changed regions and then copying the result to
+     * `state`.
+     *
+     * @throw std::runtime_error If an incremental diff doesn't match the
+     *   retained state. This would indicate a logic error, since the encoder
+     *   always diffs against the last state it sent us.
+     */
+    void apply(const StateDiff& diff, std::vector<uint8_t>& state);
+
+   private:
+    std::vector<uint8_t> last_state_;
+};
@@ -16,6 +16,8 @@
 
 #include "vst2.h"
 
+#include "../capacity-profile.h"
+
 AEffect& update_aeffect(AEffect& plugin,
                         const AEffect& updated_plugin) noexcept {
     plugin.magic = updated_plugin.magic;
@@ -36,9 +38,12 @@ AEffect& update_aeffect(AEffect& plugin,
 
 DynamicVstEvents::DynamicVstEvents() noexcept {}
 
-DynamicVstEvents::DynamicVstEvents(const VstEvents& c_events)
-    : events_(c_events.numEvents) {
-    // Copy from the C-style array into a vector for serialization
+DynamicVstEvents::DynamicVstEvents(const VstEvents& c_events) {
+    // Copy from the C-style array into a vector for serialization. Since
+    // every element gets overwritten in full right below there's no need to
+    // zero-initialize the store first, this happens on every
+    // `effProcessEvents()` call.
+    events_.resize_for_overwrite(static_cast<size_t>(c_events.numEvents));
     for (int i = 0; i < c_events.numEvents; i++) {
         events_[i] = *c_events.events[i];
 
@@ -51,6 +56,22 @@ DynamicVstEvents::DynamicVstEvents(const VstEvents& c_events)
                 i, std::string(sysex_event->sysexDump, sysex_event->byteSize));
         }
     }
+
+    CapacityProfile::observe(CapacityCounter::vst2_events, events_.size());
+    CapacityProfile::observe(CapacityCounter::vst2_sysex_events,
+                             sysex_data_.size());
+}
+
+DynamicVstEvents::DynamicVstEvents(const VstEvent* flat_events,
+                                   size_t num_events) {
+    // The event area contains the `VstEvent` structs themselves in a flat
+    // array rather than the array of pointers used in `VstEvents`, so we can
+    // just copy them over as-is, again without zero-initializing the store
+    // first
+    events_.resize_for_overwrite(num_events);
+    std::copy_n(flat_events, num_events, events_.begin());
+
+    CapacityProfile::observe(CapacityCounter::vst2_events, num_events);
 }
 
 VstEvents& DynamicVstEvents::as_c_events() {
@@ -74,13 +95,16 @@ VstEvents& DynamicVstEvents::as_c_events() {
         sizeof(VstEvents) +
         ((events_.size() - 1) *
          sizeof(VstEvent*));  // NOLINT(bugprone-sizeof-expression)
-    vst_events_buffer_.resize(buffer_size);
+    // Since we'll write the entire header and pointer array below we can skip
+    // zeroing the buffer here
+    vst_events_buffer_.resize_for_overwrite(buffer_size);
 
     // Now we can populate the VLA with pointers to the objects in the `events`
     // vector
     VstEvents* vst_events =
         reinterpret_cast<VstEvents*>(vst_events_buffer_.data());
     vst_events->numEvents = static_cast<int>(events_.size());
+    vst_events->reserved = nullptr;
     std::transform(events_.begin(), events_.end(), vst_events->events,
                    [](VstEvent& event) -> VstEvent* { return &event; });
 
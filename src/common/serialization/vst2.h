@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <variant>
 
 #include <bitsery/traits/array.h>
@@ -24,11 +25,14 @@
 #include <vestige/aeffectx.h>
 
 #include "../audio-shm.h"
+#include "../bitsery/ext/borrowed-string.h"
+#include "../bitsery/ext/gathered-vector.h"
 #include "../bitsery/ext/in-place-optional.h"
 #include "../bitsery/ext/in-place-variant.h"
 #include "../bitsery/traits/small-vector.h"
 #include "../utils.h"
 #include "../vst24.h"
+#include "capacities.h"
 #include "common.h"
 
 // These constants are limits used by bitsery
@@ -83,7 +87,62 @@ struct ChunkData {
 
     template <typename S>
     void serialize(S& s) {
-        s.container1b(buffer, binary_buffer_size);
+        // Chunk bodies are written to the socket straight from this vector
+        // instead of being copied into the serialization buffer first
+        s.ext(buffer, bitsery::ext::GatheredVector{binary_buffer_size});
+    }
+};
+
+/**
+ * The chunk size in bytes above which `effGetChunk()` and `effSetChunk()`
+ * payloads are streamed over the socket outside of the serialized message
+ * instead of being embedded in a `ChunkData`. Sample library plugins can have
+ * states of hundreds of megabytes, and staging those through the
+ * serialization buffers would otherwise require several extra copies of the
+ * entire state.
+ */
+constexpr size_t chunk_streaming_threshold = 1 << 20;
+
+/**
+ * An alternative to `ChunkData` used for chunks larger than
+ * `chunk_streaming_threshold`. Only the chunk's size is part of the
+ * serialized message, and how the actual bytes travel depends on the
+ * direction:
+ *
+ * - For `effSetChunk()` events the native side writes the chunk bytes to the
+ *   socket directly from the host's buffer right after the serialized event,
+ *   and the receiving side reads them straight into a `ChunkData`'s vector
+ *   and replaces this payload with that object.
+ * - For `effGetChunk()` responses the Wine side copies the plugin's chunk
+ *   into a memfd and passes the file descriptor over the Unix domain socket,
+ *   so the native side can map the region and hand the host a pointer into
+ *   it without any further copies.
+ *
+ * This keeps the serialization buffers small and avoids copying the state
+ * several additional times. See `send_chunk_stream()`, `send_chunk_memfd()`
+ * and friends in `../communication/vst2.h`.
+ */
+struct ChunkStream {
+    using Response = std::nullptr_t;
+
+    /**
+     * The total size of the chunk in bytes.
+     */
+    uint64_t size;
+
+    /**
+     * A pointer to the chunk bytes on the sending side, so the streaming code
+     * can write them out without copying them into the message first. This is
+     * not serialized and will thus be a null pointer on the receiving side,
+     * with one exception: for `effGetChunk()` responses,
+     * `DefaultDataConverter::send_event()` points this at the received memfd
+     * mapping so the chunk can be handed to the host without copying it.
+     */
+    const uint8_t* data = nullptr;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value8b(size);
     }
 };
 
@@ -110,6 +169,14 @@ class alignas(16) DynamicVstEvents {
 
     explicit DynamicVstEvents(const VstEvents& c_events);
 
+    /**
+     * Reconstruct the events from a flat `VstEvent` array read from the
+     * shared memory object's event area. Since SysEx events contain pointers
+     * they always go through the sockets instead, so this does not need to
+     * consider them.
+     */
+    DynamicVstEvents(const VstEvent* flat_events, size_t num_events);
+
     /**
      * Construct a `VstEvents` struct from the events vector. This contains a
      * pointer to that vector's elements, so the returned object should not
@@ -125,7 +192,7 @@ class alignas(16) DynamicVstEvents {
      * the `sysex_data_` field before dumping everything to
      * `vst_events_buffer_`.
      */
-    llvm::SmallVector<VstEvent, 64> events_;
+    llvm::SmallVector<VstEvent, capacities::vst2_events> events_;
 
     /**
      * If the host or a plugin sends SysEx data, then we will store that data
@@ -135,7 +202,9 @@ class alignas(16) DynamicVstEvents {
      * an event in `events`. There's no 'SmallUnorderedMap' equivalent to the
      * `SmallVector`.
      */
-    llvm::SmallVector<std::pair<native_size_t, std::string>, 8> sysex_data_;
+    llvm::SmallVector<std::pair<native_size_t, std::string>,
+                      capacities::vst2_sysex_events>
+        sysex_data_;
 
     template <typename S>
     void serialize(S& s) {
@@ -165,7 +234,7 @@ class alignas(16) DynamicVstEvents {
     llvm::SmallVector<
         uint8_t,
         sizeof(VstEvents) +
-            ((64 - 1) *
+            ((capacities::vst2_events - 1) *
              sizeof(VstEvent*))>  // NOLINT(bugprone-sizeof-expression)
         vst_events_buffer_;
 };
@@ -316,6 +385,167 @@ struct WantsString {
     void serialize(S&) {}
 };
 
+/**
+ * A yabridge-internal dispatcher opcode used to fetch a plugin's entire
+ * program name table in a single round trip instead of one
+ * `effGetProgramNameIndexed()` call per program. This event gets intercepted
+ * in `Vst2Bridge::run()` before it could ever reach the plugin. The value is
+ * deliberately far outside of the range used by VST2's own opcodes, and both
+ * sides always come from the same yabridge build (this is verified during
+ * initialization) so the value doesn't need any further negotiation.
+ *
+ * @relates Vst2ProgramNames
+ * @relates Vst2PluginBridge::prefetch_program_names
+ */
+constexpr int vst2_get_program_names_opcode = 16384;
+
+/**
+ * The maximum number of program names in a `Vst2ProgramNames` response. Only
+ * used as a bitsery limit, `AEffect::numPrograms` is far smaller in practice.
+ */
+constexpr size_t max_program_names = 1 << 16;
+
+/**
+ * The response to a `vst2_get_program_names_opcode` event, containing the
+ * plugin's program names indexed by program number. Sent back with a return
+ * value of 0 and an empty table when the plugin doesn't support
+ * `effGetProgramNameIndexed()`, in which case the native side falls back to
+ * forwarding the host's individual queries.
+ */
+struct Vst2ProgramNames {
+    std::vector<std::string> names;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container(names, max_program_names, [](S& s, std::string& name) {
+            s.text1b(name, max_string_length);
+        });
+    }
+};
+
+/**
+ * The maximum number of parameter values in a `Vst2ProgramBundle`. Only used
+ * as a bitsery limit, `AEffect::numParams` is far smaller in practice.
+ */
+constexpr size_t max_program_parameters = 1 << 16;
+
+/**
+ * The response to an `effSetProgram()` event. Hosts follow a program change
+ * by re-reading every parameter value and the `AEffect` fields across the
+ * bridge, one call at a time. The Wine side bundles the new program's full
+ * state into the `effSetProgram()` response instead, and the native side
+ * answers those follow-up reads locally, see
+ * `Vst2PluginBridge::program_values_cache_`.
+ */
+struct Vst2ProgramBundle {
+    /**
+     * The `AEffect` fields after the program change, applied with
+     * `update_aeffect()` just like the `effOpen()` response.
+     */
+    AEffect aeffect;
+    /**
+     * Every parameter's value after the program change, indexed by parameter
+     * number. Left empty when the plugin reports more parameters than
+     * `max_program_parameters`, in which case the host's reads are simply
+     * forwarded again.
+     */
+    std::vector<float> values;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.object(aeffect);
+        s.container4b(values, max_program_parameters);
+    }
+};
+
+/**
+ * A yabridge-internal dispatcher opcode used by the `audio_zero_copy_input`
+ * option to hand the Wine plugin host a description of the host's own input
+ * buffers when those turn out to live in shareable memory, see
+ * `Vst2HostBufferMap`. Like `vst2_get_program_names_opcode` this event gets
+ * intercepted in `Vst2Bridge::run()` and never reaches the plugin.
+ *
+ * @relates Vst2HostBufferMap
+ */
+constexpr int vst2_map_host_buffers_opcode = 16385;
+
+/**
+ * The maximum number of channels in a `Vst2HostBufferMap`. Only used as a
+ * bitsery limit, `AEffect::numInputs` is far smaller in practice.
+ */
+constexpr size_t max_mapped_input_channels = 1 << 16;
+
+/**
+ * Sent with a `vst2_map_host_buffers_opcode` event when the
+ * `audio_zero_copy_input` or `audio_zero_copy_output` option is enabled and
+ * the host's buffers were detected to live in shared, file backed memory.
+ * This happens for instance when the host runs its processing graph directly
+ * on top of PipeWire's memfd backed buffers. Every channel names an open file
+ * descriptor in the native host process along with the byte offset of the
+ * channel's buffer within that file. The Wine plugin host resolves these
+ * descriptors through `/proc/<pid>/fd/` and maps input buffers read-only,
+ * after which processing calls flagged with
+ * `Vst2ProcessMetadata::use_mapped_inputs` read the host's buffers directly
+ * and the native side skips the input copy into the shared memory object
+ * entirely. Output buffers are mapped read-write, and processing calls
+ * flagged with `Vst2ProcessMetadata::use_mapped_outputs` let the plugin write
+ * straight into them before the Wine side signals completion, so the native
+ * side's post-wake work shrinks to a flag check instead of a copy on the
+ * host's audio thread. Either channel list may be empty when only one
+ * direction could be mapped or was requested. A return value of 0 indicates
+ * that the mapping failed, in which case the native side just keeps copying.
+ */
+struct Vst2HostBufferMap {
+    struct Channel {
+        /**
+         * The file descriptor backing the channel's buffer, valid in the
+         * native host process.
+         */
+        int32_t fd;
+        /**
+         * The byte offset of the channel's buffer within that file.
+         */
+        uint64_t offset;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.value4b(fd);
+            s.value8b(offset);
+        }
+    };
+
+    /**
+     * The process ID of the native host process, used to resolve the file
+     * descriptors through procfs.
+     */
+    int32_t pid;
+    /**
+     * The size of every channel's buffer in bytes, derived from the maximum
+     * block size the host announced through `effSetBlockSize()`.
+     */
+    uint64_t channel_size;
+    /**
+     * One entry per input channel, in channel order. May be empty when only
+     * the outputs are being mapped.
+     */
+    std::vector<Channel> channels;
+    /**
+     * One entry per output channel, in channel order. May be empty when only
+     * the inputs are being mapped.
+     */
+    std::vector<Channel> output_channels;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value4b(pid);
+        s.value8b(channel_size);
+        s.container(channels, max_mapped_input_channels,
+                    [](S& s, Channel& channel) { s.object(channel); });
+        s.container(output_channels, max_mapped_input_channels,
+                    [](S& s, Channel& channel) { s.object(channel); });
+    }
+};
+
 /**
  * AN instance of this should be sent back as a response to an incoming event.
  */
@@ -340,7 +570,10 @@ struct Vst2EventResult {
                                  AEffect,
                                  AudioShmBuffer::Config,
                                  ChunkData,
+                                 ChunkStream,
                                  DynamicSpeakerArrangement,
+                                 Vst2ProgramBundle,
+                                 Vst2ProgramNames,
                                  VstIOProperties,
                                  VstMidiKeyName,
                                  VstParameterProperties,
@@ -398,12 +631,13 @@ struct Vst2Event {
      *
      * - A null pointer, used for simple events.
      * - A char pointer to a null terminated string, used for passing strings to
-     *   the plugin such as when renaming presets. Bitsery handles the
-     *   serialization for us.
-     *
-     *   NOTE: Bitsery does not support null terminated C-strings without a
-     *         known size. We can replace `std::string` with `char*` once it
-     *         does for clarity's sake.
+     *   the plugin such as when renaming presets. These are stored as
+     *   `std::string_view`s serialized with `bitsery::ext::BorrowedString`, so
+     *   neither side has to copy the string into an owned object: the sending
+     *   side's view points directly at the host's buffer, and after
+     *   deserializing the view aliases the receive buffer. This does mean the
+     *   view is only valid for the duration of the message handler, see
+     *   `passthrough_event()` for the implications.
      *
      * - A byte vector for handling chunk data during `effSetChunk()`. We can't
      *   reuse the regular string handling here since the data may contain null
@@ -431,12 +665,14 @@ struct Vst2Event {
      * @relates passthrough_event
      */
     using Payload = std::variant<std::nullptr_t,
-                                 std::string,
+                                 std::string_view,
                                  native_size_t,
                                  AEffect,
                                  ChunkData,
+                                 ChunkStream,
                                  DynamicVstEvents,
                                  DynamicSpeakerArrangement,
+                                 Vst2HostBufferMap,
                                  WantsAEffectUpdate,
                                  WantsAudioShmBufferConfig,
                                  WantsChunkBuffer,
@@ -486,8 +722,10 @@ template <typename S>
 void serialize(S& s, Vst2Event::Payload& payload) {
     s.ext(payload,
           bitsery::ext::InPlaceVariant{[](S&, std::nullptr_t&) {},
-                                       [](S& s, std::string& string) {
-                                           s.text1b(string, max_string_length);
+                                       [](S& s, std::string_view& string) {
+                                           s.ext(string,
+                                                 bitsery::ext::BorrowedString(
+                                                     max_string_length));
                                        },
                                        [](S& s, native_size_t& window_handle) {
                                            s.value8b(window_handle);
@@ -551,6 +789,39 @@ struct Vst2ProcessRequest {
      */
     bool double_precision;
 
+    /**
+     * A bitmask of input channels that only contain digital silence. VST2 has
+     * no silence flags, so the native plugin side detects these with a cheap
+     * scan. The input copy into the shared memory object is skipped for these
+     * channels and the Wine side zeroes them out instead, which replaces a
+     * read-and-write copy with a store-only fill. Only the first 64 channels
+     * can be flagged; any channels beyond that are always copied.
+     */
+    uint64_t silent_input_channels;
+
+    /**
+     * Whether the Wine side should read the inputs for this block straight
+     * from the host's own buffers instead of from the shared memory object,
+     * see `Vst2HostBufferMap`. Only set with the `audio_zero_copy_input`
+     * option enabled, after the Wine side has acknowledged the mapping and
+     * when the host's channel pointers still match the mapped set. The
+     * silent channel bitmask above is always zero for these blocks since
+     * the mapped buffers are read-only on the Wine side.
+     */
+    bool use_mapped_inputs;
+
+    /**
+     * Whether the Wine side should let the plugin write its outputs for this
+     * block straight into the host's own buffers instead of into the shared
+     * memory object, see `Vst2HostBufferMap`. Only set with the
+     * `audio_zero_copy_output` option enabled, after the Wine side has
+     * acknowledged a mapping that covers the outputs and when the host's
+     * output pointers still match the mapped set. The native side then skips
+     * the copy out of the shared memory object after the Wine side signals
+     * completion.
+     */
+    bool use_mapped_outputs;
+
     /**
      * We'll prefetch the current transport information as part of handling an
      * audio processing call. This lets us a void an unnecessary callback (or in
@@ -566,27 +837,422 @@ struct Vst2ProcessRequest {
     int current_process_level;
 
     /**
-     * We'll periodically synchronize the realtime priority setting of the
+     * We'll periodically synchronize the realtime scheduling parameters of the
      * host's audio thread with the Wine plugin host. We'll do this
      * approximately every ten seconds, as doing this getting and setting
      * scheduler information has a non trivial amount of overhead (even if it's
      * only a single microsoecond).
      */
-    std::optional<int> new_realtime_priority;
+    std::optional<RealtimeParameters> new_realtime_parameters;
 
     template <typename S>
     void serialize(S& s) {
         s.value4b(sample_frames);
         s.value1b(double_precision);
+        s.value8b(silent_input_channels);
+        s.value1b(use_mapped_inputs);
+        s.value1b(use_mapped_outputs);
 
         s.ext(current_time_info, bitsery::ext::InPlaceOptional{});
         s.value4b(current_process_level);
 
-        s.ext(new_realtime_priority, bitsery::ext::InPlaceOptional{},
-              [](S& s, int& priority) { s.value4b(priority); });
+        s.ext(new_realtime_parameters, bitsery::ext::InPlaceOptional{});
+    }
+};
+
+/**
+ * A trivially copyable mirror of `Vst2ProcessRequest` that fits in the
+ * doorbell payload area of an `AudioShmBuffer`. During steady-state audio
+ * processing we'll write this struct directly to the shared memory object and
+ * ring the doorbell instead of serializing a `Vst2ProcessRequest` over the
+ * audio socket, skipping the socket round trip entirely. The socket remains in
+ * use only as a fallback for buffers without a doorbell.
+ */
+struct Vst2ProcessMetadata {
+    int32_t sample_frames;
+    uint8_t double_precision;
+    uint8_t has_time_info;
+    uint8_t has_new_realtime_parameters;
+    /**
+     * The number of `VstEvent`s the native plugin side has written to this
+     * bank's event area in the shared memory object. Zero when the events
+     * were sent through the dispatcher socket instead, which still happens
+     * for SysEx events and for batches larger than `vst2_shm_max_events`.
+     */
+    uint32_t num_shm_events;
+    /**
+     * The buffer bank the inputs were written to when the one-block
+     * pipelining mode is active. Always 0 otherwise. With pipelining the
+     * payload area contains one `Vst2ProcessMetadata` slot per bank, so the
+     * next block's metadata can be written while the previous block is still
+     * being processed.
+     */
+    uint8_t bank;
+    /**
+     * Whether the inputs should be read from the host's mapped buffers, see
+     * `Vst2ProcessRequest::use_mapped_inputs`.
+     */
+    uint8_t use_mapped_inputs;
+    /**
+     * Whether the outputs should be written to the host's mapped buffers, see
+     * `Vst2ProcessRequest::use_mapped_outputs`.
+     */
+    uint8_t use_mapped_outputs;
+    /**
+     * The silent input channel bitmask, see
+     * `Vst2ProcessRequest::silent_input_channels`.
+     */
+    uint64_t silent_input_channels;
+    int32_t current_process_level;
+    int32_t new_realtime_policy;
+    int32_t new_realtime_priority;
+    VstTimeInfo time_info;
+
+    /**
+     * Copy the fields from a `Vst2ProcessRequest` built on the native plugin
+     * side.
+     */
+    void from_request(const Vst2ProcessRequest& request) noexcept {
+        bank = 0;
+        num_shm_events = 0;
+        sample_frames = request.sample_frames;
+        double_precision = request.double_precision;
+        use_mapped_inputs = request.use_mapped_inputs;
+        use_mapped_outputs = request.use_mapped_outputs;
+        silent_input_channels = request.silent_input_channels;
+        has_time_info = request.current_time_info.has_value();
+        if (request.current_time_info) {
+            time_info = *request.current_time_info;
+        }
+        current_process_level = request.current_process_level;
+        has_new_realtime_parameters =
+            request.new_realtime_parameters.has_value();
+        if (request.new_realtime_parameters) {
+            new_realtime_policy = request.new_realtime_parameters->policy;
+            new_realtime_priority = request.new_realtime_parameters->priority;
+        } else {
+            new_realtime_policy = 0;
+            new_realtime_priority = 0;
+        }
+    }
+
+    /**
+     * The inverse of `from_request()`, used on the Wine side so the doorbell
+     * code path can reuse the same processing function as the socket based
+     * path.
+     */
+    void to_request(Vst2ProcessRequest& request) const noexcept {
+        request.sample_frames = sample_frames;
+        request.double_precision = double_precision;
+        request.use_mapped_inputs = use_mapped_inputs;
+        request.use_mapped_outputs = use_mapped_outputs;
+        request.silent_input_channels = silent_input_channels;
+        if (has_time_info) {
+            request.current_time_info = time_info;
+        } else {
+            request.current_time_info.reset();
+        }
+        request.current_process_level = current_process_level;
+        if (has_new_realtime_parameters) {
+            request.new_realtime_parameters =
+                RealtimeParameters{.policy = new_realtime_policy,
+                                   .priority = new_realtime_priority};
+        } else {
+            request.new_realtime_parameters.reset();
+        }
     }
 };
 
+static_assert(std::is_trivially_copyable_v<Vst2ProcessMetadata>,
+              "This struct gets memcpy'd into shared memory");
+static_assert(sizeof(Vst2ProcessMetadata) * 2 <=
+                  AudioShmBuffer::doorbell_payload_size,
+              "The process metadata slots (one per bank for the pipelining "
+              "mode) need to fit in the doorbell payload area");
+
+/**
+ * A persistently valid mirror of the `VstTimeInfo` prefetched on the native
+ * plugin side, laid out in the doorbell payload area right after the
+ * `Vst2ProcessMetadata` slots. The native side refreshes this before ringing
+ * the doorbell for a block. This lets the Wine side answer
+ * `audioMasterGetTime()` calls made outside of an audio processing call, for
+ * instance from a GUI thread, with at most one block old transport
+ * information instead of doing a full callback over the socket. Since those
+ * reads can happen concurrently with the next block's refresh, the mirror is
+ * synchronized with a sequence lock.
+ */
+struct Vst2TimeInfoMirror {
+    /**
+     * Incremented to an odd value before and to an even value after every
+     * refresh. Zero means that no time information has been written yet.
+     */
+    std::atomic<uint32_t> sequence;
+    VstTimeInfo time_info;
+
+    /**
+     * Store new transport information. Called on the native plugin side right
+     * before ringing the doorbell for a block.
+     */
+    void write(const VstTimeInfo& new_time_info) noexcept {
+        const uint32_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        time_info = new_time_info;
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    /**
+     * Try to read the last written transport information. Returns a nullopt
+     * when nothing has been written yet or when a refresh is currently in
+     * progress, in which case the caller should fall back to the socket based
+     * callback.
+     */
+    std::optional<VstTimeInfo> read() const noexcept {
+        VstTimeInfo result;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            if (before == 0 || (before & 1) != 0) {
+                return std::nullopt;
+            }
+
+            result = time_info;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after);
+
+        return result;
+    }
+};
+
+/**
+ * The offset of the `Vst2TimeInfoMirror` within the doorbell payload area.
+ * The first two slots of that area are taken up by the `Vst2ProcessMetadata`
+ * for each buffer bank.
+ */
+constexpr size_t vst2_time_info_mirror_offset = 2 * sizeof(Vst2ProcessMetadata);
+
+static_assert(vst2_time_info_mirror_offset + sizeof(Vst2TimeInfoMirror) <=
+                  AudioShmBuffer::doorbell_payload_size,
+              "The time info mirror needs to fit in the doorbell payload area "
+              "after the process metadata slots");
+
+/**
+ * The mailbox slot for `getParameter()` and `setParameter()` calls made
+ * through the shared memory object's RPC futex pair instead of the parameters
+ * socket. These calls have tiny fixed size arguments and results, and hosts
+ * fire them in rapid succession during parameter automation, so once the
+ * shared memory object exists they can skip the kernel socket layer entirely.
+ * The parameters socket remains in use for calls made before
+ * `effMainsChanged()` has set up the buffers.
+ *
+ * The native plugin side fills this slot and rings the RPC request word, and
+ * the Wine side writes the result back to the same slot before ringing the
+ * RPC completion word. Since the calls on both sides are serialized (by
+ * `parameters_mutex_` on the native side and by the single serving thread on
+ * the Wine side) the slot itself doesn't need any synchronization.
+ */
+struct Vst2ParameterMailbox {
+    int32_t index;
+    /**
+     * Whether this is a `setParameter()` call. Mirrors the `value` optional in
+     * the `Parameter` struct used on the socket based path.
+     */
+    uint8_t is_set;
+    /**
+     * The new value for `setParameter()`, or the plugin's current value as
+     * written back by the Wine side for `getParameter()`.
+     */
+    float value;
+
+    /**
+     * Fill the slot from the `Parameter` that would otherwise have been sent
+     * over the parameters socket. Called on the native plugin side.
+     */
+    void write_request(const Parameter& request) noexcept {
+        index = request.index;
+        is_set = request.value.has_value();
+        if (request.value) {
+            value = *request.value;
+        }
+    }
+
+    /**
+     * Read the Wine side's result back into a `ParameterResult`, so the
+     * mailbox path can share the rest of the call handling with the socket
+     * based path. For `setParameter()` the result only acts as an
+     * acknowledgement and doesn't contain a value.
+     */
+    void read_response(ParameterResult& response) const noexcept {
+        if (is_set) {
+            response.value.reset();
+        } else {
+            response.value = value;
+        }
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<Vst2ParameterMailbox>,
+              "This struct gets accessed directly in shared memory");
+
+/**
+ * The offset of the `Vst2ParameterMailbox` within the doorbell payload area,
+ * right after the time info mirror.
+ */
+constexpr size_t vst2_parameter_mailbox_offset =
+    vst2_time_info_mirror_offset + sizeof(Vst2TimeInfoMirror);
+
+static_assert(vst2_parameter_mailbox_offset + sizeof(Vst2ParameterMailbox) <=
+                  AudioShmBuffer::doorbell_payload_size,
+              "The parameter mailbox needs to fit in the doorbell payload "
+              "area after the time info mirror");
+
+/**
+ * A canonical mirror of the value fields of the Wine side's `AEffect`, laid
+ * out in the doorbell payload area right after the parameter mailbox. The
+ * Wine side republishes these fields after every processed block when any of
+ * them changed, and the native `Vst2PluginBridge` compares the sequence
+ * counter at each process call boundary and refreshes its own `AEffect` copy
+ * from the mirror when it did. This makes changes like a new `initialDelay`
+ * visible to the host one block sooner, without the `WantsAEffectUpdate` or
+ * `audioMasterIOChanged()` round trip that otherwise pulls these values
+ * across. Those socket based updates remain in place for the changes made
+ * outside of audio processing, and for hosts that never enable audio
+ * processing in the first place.
+ *
+ * Like `Vst2TimeInfoMirror` this is synchronized with a sequence lock, since
+ * the native side's reads can race with the Wine side's republish for the
+ * next bank when audio pipelining is enabled.
+ */
+struct Vst2AEffectMirror {
+    /**
+     * Incremented to an odd value before and to an even value after every
+     * republish. Zero means that nothing has been published yet.
+     */
+    std::atomic<uint32_t> sequence;
+
+    // These mirror the fields copied by `update_aeffect()`
+    int32_t magic;
+    int32_t numPrograms;
+    int32_t numParams;
+    int32_t numInputs;
+    int32_t numOutputs;
+    int32_t flags;
+    int32_t initialDelay;
+    int32_t empty3a;
+    int32_t empty3b;
+    float unkown_float;
+    int32_t uniqueID;
+    int32_t version;
+
+    /**
+     * Publish the current values from the Wine side's `AEffect`. This only
+     * bumps the sequence counter when any of the mirrored fields actually
+     * changed, so steady-state blocks don't invalidate the native side's
+     * copy. There's only a single writer (the Wine side's audio thread), so
+     * the comparison doesn't need any synchronization.
+     */
+    void update(const AEffect& plugin) noexcept {
+        if (magic == plugin.magic && numPrograms == plugin.numPrograms &&
+            numParams == plugin.numParams && numInputs == plugin.numInputs &&
+            numOutputs == plugin.numOutputs && flags == plugin.flags &&
+            initialDelay == plugin.initialDelay &&
+            empty3a == plugin.empty3a && empty3b == plugin.empty3b &&
+            unkown_float == plugin.unkown_float &&
+            uniqueID == plugin.uniqueID && version == plugin.version &&
+            sequence.load(std::memory_order_relaxed) != 0) {
+            return;
+        }
+
+        const uint32_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        magic = plugin.magic;
+        numPrograms = plugin.numPrograms;
+        numParams = plugin.numParams;
+        numInputs = plugin.numInputs;
+        numOutputs = plugin.numOutputs;
+        flags = plugin.flags;
+        initialDelay = plugin.initialDelay;
+        empty3a = plugin.empty3a;
+        empty3b = plugin.empty3b;
+        unkown_float = plugin.unkown_float;
+        uniqueID = plugin.uniqueID;
+        version = plugin.version;
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    /**
+     * Refresh `plugin` from the mirror when it has been republished since
+     * `last_seen_sequence`. Returns the sequence counter belonging to the
+     * copied snapshot, or a nullopt when the mirror hasn't changed or when a
+     * republish was in progress. In the latter case no fields are modified
+     * and the next block's check will simply pick the new values up, so
+     * there's no need to spin.
+     */
+    std::optional<uint32_t> read_if_changed(
+        AEffect& plugin,
+        uint32_t last_seen_sequence) const noexcept {
+        const uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before == last_seen_sequence || before == 0 ||
+            (before & 1) != 0) {
+            return std::nullopt;
+        }
+
+        AEffect snapshot = plugin;
+        snapshot.magic = magic;
+        snapshot.numPrograms = numPrograms;
+        snapshot.numParams = numParams;
+        snapshot.numInputs = numInputs;
+        snapshot.numOutputs = numOutputs;
+        snapshot.flags = flags;
+        snapshot.initialDelay = initialDelay;
+        snapshot.empty3a = empty3a;
+        snapshot.empty3b = empty3b;
+        snapshot.unkown_float = unkown_float;
+        snapshot.uniqueID = uniqueID;
+        snapshot.version = version;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before) {
+            return std::nullopt;
+        }
+
+        update_aeffect(plugin, snapshot);
+        return before;
+    }
+};
+
+/**
+ * The offset of the `Vst2AEffectMirror` within the doorbell payload area,
+ * right after the parameter mailbox.
+ */
+constexpr size_t vst2_aeffect_mirror_offset =
+    vst2_parameter_mailbox_offset + sizeof(Vst2ParameterMailbox);
+
+static_assert(vst2_aeffect_mirror_offset + sizeof(Vst2AEffectMirror) <=
+                  AudioShmBuffer::doorbell_payload_size,
+              "The AEffect mirror needs to fit in the doorbell payload area "
+              "after the parameter mailbox");
+
+/**
+ * The maximum number of events per processing cycle that can be passed
+ * through the shared memory object's event area instead of being serialized
+ * over the dispatcher socket. This covers the common case of a handful of
+ * MIDI events per block without any allocations or serialization. Larger
+ * batches and SysEx events (which contain pointers to variable length data)
+ * still use the socket based `effProcessEvents()` path.
+ */
+constexpr size_t vst2_shm_max_events = 64;
+
+/**
+ * The size of the per-bank event area laid out in the shared memory object
+ * after the doorbell page, as used in `Vst2Bridge::setup_shared_audio_buffers`
+ * on the Wine side.
+ */
+constexpr size_t vst2_event_area_size = vst2_shm_max_events * sizeof(VstEvent);
+
 /**
  * The serialization function for `AEffect` structs. This will s serialize all
  * of the values but it will not touch any of the pointer fields. That way you
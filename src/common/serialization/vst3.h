@@ -73,6 +73,7 @@ using Vst3ControlRequest =
                  YaConnectionPoint::Connect,
                  YaConnectionPoint::Disconnect,
                  YaConnectionPoint::Notify,
+                 YaConnectionPoint::BypassConnectionProxy,
                  YaContextMenuTarget::ExecuteMenuItem,
                  YaEditController::SetComponentState,
                  YaEditController::GetParameterInfos,
@@ -81,6 +82,7 @@ using Vst3ControlRequest =
                  YaEditController::NormalizedParamToPlain,
                  YaEditController::PlainParamToNormalized,
                  YaEditController::GetParamNormalized,
+                 YaEditController::GetParamNormalizedMulti,
                  YaEditController::SetParamNormalized,
                  YaEditController::SetComponentHandler,
                  YaEditController::CreateView,
@@ -125,6 +127,7 @@ using Vst3ControlRequest =
                  YaUnitData::SetUnitData,
                  YaUnitInfo::GetUnitCount,
                  YaUnitInfo::GetUnitInfo,
+                 YaUnitInfo::GetUnitInfos,
                  YaUnitInfo::GetProgramListCount,
                  YaUnitInfo::GetProgramListInfo,
                  YaUnitInfo::GetProgramName,
@@ -236,6 +239,17 @@ inline Vst3AudioProcessorRequest::Payload& get_request_variant(
     return request.payload;
 }
 
+/**
+ * The same for const objects, used by `message_traffic_entry()` so the
+ * traffic accounting is also kept per variant alternative for these requests.
+ *
+ * @overload
+ */
+inline const Vst3AudioProcessorRequest::Payload& get_request_variant(
+    const Vst3AudioProcessorRequest& request) noexcept {
+    return request.payload;
+}
+
 /**
  * When we do a callback from the Wine plugin host to the plugin, this encodes
  * the information we want or the operation we want to perform. A request of
@@ -246,6 +260,7 @@ using Vst3CallbackRequest =
                  WantsConfiguration,
                  YaComponentHandler::BeginEdit,
                  YaComponentHandler::PerformEdit,
+                 YaComponentHandler::PerformEditBatch,
                  YaComponentHandler::EndEdit,
                  YaComponentHandler::RestartComponent,
                  YaComponentHandler2::SetDirty,
@@ -21,6 +21,7 @@
 #include <bitsery/ext/std_map.h>
 #include <pluginterfaces/vst/ivstmessage.h>
 
+#include "../../bitsery/ext/gathered-vector.h"
 #include "../../bitsery/ext/in-place-optional.h"
 #include "base.h"
 
@@ -110,7 +111,7 @@ class YaAttributeList : public Steinberg::Vst::IAttributeList {
         s.ext(attrs_binary_, bitsery::ext::StdMap{1 << 20},
               [](S& s, std::string& key, std::vector<uint8_t>& value) {
                   s.text1b(key, 1024);
-                  s.container1b(value, 1 << 20);
+                  s.ext(value, bitsery::ext::GatheredVector{1 << 20});
               });
     }
 
@@ -66,6 +66,29 @@ const Steinberg::Vst::TChar* u16string_to_tchar_pointer(
 #endif
 }
 
+U16String128::U16String128(const Steinberg::Vst::TChar* string) noexcept {
+#ifdef __WINE__
+    static_assert(sizeof(Steinberg::Vst::TChar) == sizeof(char16_t));
+    const char16_t* characters = reinterpret_cast<const char16_t*>(string);
+#else
+    const char16_t* characters = static_cast<const char16_t*>(string);
+#endif
+
+    while (size_ < max_length && characters[size_] != 0) {
+        chars_[size_] = characters[size_];
+        size_++;
+    }
+}
+
+const Steinberg::Vst::TChar* U16String128::c_str() const noexcept {
+#ifdef __WINE__
+    static_assert(sizeof(Steinberg::Vst::TChar) == sizeof(char16_t));
+    return reinterpret_cast<const Steinberg::Vst::TChar*>(chars_.data());
+#else
+    return static_cast<const Steinberg::Vst::TChar*>(chars_.data());
+#endif
+}
+
 // GCC 12.2's `std::to_array()` throws spurious array access out of bounds
 // warnings
 #pragma GCC diagnostic push
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <string>
 #include <vector>
@@ -69,6 +70,70 @@ std::u16string tchar_pointer_to_u16string(const Steinberg::Vst::TChar* string,
 const Steinberg::Vst::TChar* u16string_to_tchar_pointer(
     const std::u16string& string) noexcept;
 
+/**
+ * The wire representation for strings bounded by VST3's fixed size UTF-16
+ * `String128` type. These used to be sent as `std::u16string`, but hosts call
+ * functions like `IEditController::getParamStringByValue()` on every
+ * parameter display refresh and the temporary strings were a steady source of
+ * heap allocations. This type stores the characters in an inline, always null
+ * terminated buffer instead. The interface is just big enough for our
+ * serialization and `String128` copying needs.
+ */
+class U16String128 {
+   public:
+    /**
+     * The maximum string length in UTF-16 code units, excluding the null
+     * terminator. One less than the size of a `String128` so the write back
+     * to an actual `String128` always has room for the terminator.
+     */
+    static constexpr size_t max_length =
+        std::extent_v<Steinberg::Vst::String128> - 1;
+
+    // Needed for bitsery's container traits
+    using value_type = char16_t;
+
+    U16String128() noexcept {}
+
+    /**
+     * Copy a null terminated UTF-16 string into this object. Strings longer
+     * than `max_length` are truncated.
+     *
+     * NOTE: This is implicit on purpose so host and plugin provided `TChar*`
+     *       strings can be assigned directly to message fields.
+     */
+    U16String128(const Steinberg::Vst::TChar* string) noexcept;
+
+    /**
+     * Get a null terminated string that can be passed directly to functions
+     * taking a `TChar*` string.
+     */
+    const Steinberg::Vst::TChar* c_str() const noexcept;
+
+    inline char16_t* begin() noexcept { return chars_.data(); }
+    inline const char16_t* begin() const noexcept { return chars_.data(); }
+    inline char16_t* end() noexcept { return chars_.data() + size_; }
+    inline const char16_t* end() const noexcept {
+        return chars_.data() + size_;
+    }
+    inline size_t size() const noexcept { return size_; }
+
+    /**
+     * Change the string's length, maintaining the null terminator. Used by
+     * bitsery when deserializing.
+     */
+    inline void resize(size_t new_size) noexcept {
+        size_ = std::min(new_size, max_length);
+        chars_[size_] = 0;
+    }
+
+   private:
+    /**
+     * The characters plus a null terminator at `chars_[size_]`.
+     */
+    std::array<char16_t, max_length + 1> chars_{0};
+    size_t size_ = 0;
+};
+
 /**
  * Both `TUID` (`int8_t[16]`) and `FIDString` (`char*`) are hard to work with
  * because you can't just copy them. So when serializing/deserializing them
@@ -198,3 +263,23 @@ class UniversalTResult {
 
     Value universal_result_;
 };
+
+// Teach bitsery how to serialize a `U16String128` with `text2b()`, just like
+// an `std::u16string`
+
+namespace bitsery {
+namespace traits {
+
+template <>
+struct ContainerTraits<U16String128>
+    : public StdContainer<U16String128, true, true> {};
+
+template <>
+struct TextTraits<U16String128> {
+    using TValue = char16_t;
+    static constexpr bool addNUL = false;
+    static size_t length(const U16String128& str) { return str.size(); }
+};
+
+}  // namespace traits
+}  // namespace bitsery
@@ -135,10 +135,31 @@ tresult YaBStream::write_back(Steinberg::IBStream* stream) const {
     return Steinberg::kResultOk;
 }
 
+void YaBStream::encode_against(StateDiffEncoder& encoder) {
+    assert(!diff_);
+
+    diff_ = encoder.encode(buffer_);
+    buffer_.clear();
+    seek_position_ = 0;
+}
+
+void YaBStream::decode_against(StateDiffDecoder& decoder) {
+    if (!diff_) {
+        return;
+    }
+
+    decoder.apply(*diff_, buffer_);
+    diff_.reset();
+}
+
 size_t YaBStream::size() const noexcept {
     return buffer_.size();
 }
 
+const std::optional<StateDiff>& YaBStream::diff() const noexcept {
+    return diff_;
+}
+
 tresult PLUGIN_API YaBStream::read(void* buffer,
                                    int32 numBytes,
                                    int32* numBytesRead) {
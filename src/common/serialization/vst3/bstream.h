@@ -21,6 +21,8 @@
 #include <pluginterfaces/base/ibstream.h>
 #include <pluginterfaces/vst/ivstattributes.h>
 
+#include "../../bitsery/ext/gathered-vector.h"
+#include "../state-diff.h"
 #include "attribute-list.h"
 #include "base.h"
 
@@ -63,11 +65,34 @@ class YaBStream : public Steinberg::IBStream,
      */
     tresult write_back(Steinberg::IBStream* stream) const;
 
+    /**
+     * Replace the buffer with a block level diff against the encoder's
+     * retained copy of the last transferred state before sending this stream
+     * over a socket. Used on the Wine side for `getState()` responses, since
+     * hosts fetch the full state on every autosave and successive snapshots
+     * are usually nearly identical. The receiving side has to reconstruct the
+     * buffer with `decode_against()` before using the stream.
+     */
+    void encode_against(StateDiffEncoder& encoder);
+
+    /**
+     * Reconstruct the full buffer from the diff produced by
+     * `encode_against()` on the other side, patching the decoder's retained
+     * copy. A no-op for streams that weren't diffed.
+     */
+    void decode_against(StateDiffDecoder& decoder);
+
     /**
      * Return the buffer's, used in the logging messages.
      */
     size_t size() const noexcept;
 
+    /**
+     * The diff this stream's buffer was replaced with by `encode_against()`,
+     * if it hasn't been decoded yet. Used in the logging messages.
+     */
+    const std::optional<StateDiff>& diff() const noexcept;
+
     // From `IBstream`
     tresult PLUGIN_API read(void* buffer,
                             int32 numBytes,
@@ -90,7 +115,10 @@ class YaBStream : public Steinberg::IBStream,
 
     template <typename S>
     void serialize(S& s) {
-        s.container1b(buffer_, max_vector_stream_size);
+        s.ext(buffer_, bitsery::ext::GatheredVector{max_vector_stream_size});
+        // When the stream was diffed with `encode_against()` the buffer above
+        // is empty and the state travels as changed ranges instead
+        s.ext(diff_, bitsery::ext::InPlaceOptional{});
         // The seek position should always be initialized at 0
 
         s.value1b(supports_stream_attributes_);
@@ -121,6 +149,11 @@ class YaBStream : public Steinberg::IBStream,
    private:
     std::vector<uint8_t> buffer_;
     int64_t seek_position_ = 0;
+
+    /**
+     * A diff replacing `buffer_` during transfer, see `encode_against()`.
+     */
+    std::optional<StateDiff> diff_;
 };
 
 #pragma GCC diagnostic pop
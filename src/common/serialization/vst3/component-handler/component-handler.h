@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include <llvm/small-vector.h>
 #include <pluginterfaces/vst/ivsteditcontroller.h>
 
+#include "../../../bitsery/traits/small-vector.h"
 #include "../../common.h"
 #include "../base.h"
 
@@ -108,6 +110,43 @@ class YaComponentHandler : public Steinberg::Vst::IComponentHandler {
     performEdit(Steinberg::Vst::ParamID id,
                 Steinberg::Vst::ParamValue valueNormalized) override = 0;
 
+    /**
+     * Message to pass through a sequence of coalesced
+     * `IComponentHandler::performEdit(id, value_normalized)` calls to the
+     * component handler provided by the host. Dragging a knob in a plugin's
+     * editor can produce one `performEdit()` call per mouse move, and doing a
+     * full socket round trip for every one of those adds up. During an active
+     * edit `Vst3ComponentHandlerProxyImpl` instead accumulates the values for
+     * up to one GUI frame and ships them as a single message, and the native
+     * plugin replays them on the host's component handler in call order.
+     */
+    struct PerformEditBatch {
+        using Response = UniversalTResult;
+
+        native_size_t owner_instance_id;
+
+        /**
+         * The accumulated `(id, value_normalized)` pairs, in call order.
+         */
+        llvm::SmallVector<
+            std::pair<Steinberg::Vst::ParamID, Steinberg::Vst::ParamValue>,
+            16>
+            edits;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.value8b(owner_instance_id);
+            s.container(
+                edits, 1 << 16,
+                [](S& s,
+                   std::pair<Steinberg::Vst::ParamID,
+                             Steinberg::Vst::ParamValue>& edit) {
+                    s.value4b(edit.first);
+                    s.value8b(edit.second);
+                });
+        }
+    };
+
     /**
      * Message to pass through a call to `IComponentHandler::endEdit(id)` to the
      * component handler provided by the host.
@@ -16,11 +16,10 @@
 
 #pragma once
 
-#include <llvm/small-vector.h>
 #include <pluginterfaces/vst/ivstevents.h>
 
 #include "../../bitsery/ext/in-place-variant.h"
-#include "../../bitsery/traits/small-vector.h"
+#include "../../bitsery/traits/pooled-vector.h"
 #include "base.h"
 
 #pragma GCC diagnostic push
@@ -267,7 +266,12 @@ class YaEventList : public Steinberg::Vst::IEventList {
     }
 
    private:
-    llvm::SmallVector<YaEvent, 64> events_;
+    /**
+     * The events. Some event types own heap storage (SysEx data and note
+     * expression text), so we use a `PooledVector` here to keep those
+     * allocations alive when the event count shrinks in between blocks.
+     */
+    PooledVector<YaEvent, 64> events_;
 };
 
 #pragma GCC diagnostic pop
@@ -73,12 +73,12 @@ class YaHostApplication : public Steinberg::Vst::IHostApplication {
      */
     struct GetNameResponse {
         UniversalTResult result;
-        std::u16string name;
+        U16String128 name;
 
         template <typename S>
         void serialize(S& s) {
             s.object(result);
-            s.text2b(name, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(name, U16String128::max_length);
         }
     };
 
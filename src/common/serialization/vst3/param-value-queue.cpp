@@ -16,29 +16,18 @@
 
 #include "param-value-queue.h"
 
+#include "parameter-changes.h"
+
 YaParamValueQueue::YaParamValueQueue() noexcept {FUNKNOWN_CTOR}
 
 YaParamValueQueue::~YaParamValueQueue() noexcept {
     FUNKNOWN_DTOR
 }
 
-void YaParamValueQueue::clear_for_parameter(
-    Steinberg::Vst::ParamID parameter_id) noexcept {
-    parameter_id_ = parameter_id;
-    queue_.clear();
-}
-
-void YaParamValueQueue::repopulate(
-    Steinberg::Vst::IParamValueQueue& original_queue) {
-    parameter_id_ = original_queue.getParameterId();
-
-    // Copy over all points to our vector
-    queue_.resize(original_queue.getPointCount());
-    for (int i = 0; i < original_queue.getPointCount(); i++) {
-        // We're skipping the assertions here and just assume that the function
-        // returns `kResultOk`
-        original_queue.getPoint(i, queue_[i].first, queue_[i].second);
-    }
+void YaParamValueQueue::update(YaParameterChanges& parameter_changes,
+                               int32 queue_index) noexcept {
+    parameter_changes_ = &parameter_changes;
+    queue_index_ = queue_index;
 }
 
 #pragma GCC diagnostic push
@@ -48,44 +37,27 @@ IMPLEMENT_FUNKNOWN_METHODS(YaParamValueQueue,
                            Steinberg::Vst::IParamValueQueue::iid)
 #pragma GCC diagnostic pop
 
-void YaParamValueQueue::write_back_outputs(
-    Steinberg::Vst::IParamValueQueue& output_queue) const {
-    // We don't need this value
-    int32 index;
-    for (const auto& [sample_offset, value] : queue_) {
-        // We don't check for `kResultOk` here
-        output_queue.addPoint(sample_offset, value, index);
-    }
-}
-
 Steinberg::Vst::ParamID PLUGIN_API YaParamValueQueue::getParameterId() {
-    return parameter_id_;
+    return parameter_changes_->queue_parameter_id(queue_index_);
 }
 
 int32 PLUGIN_API YaParamValueQueue::getPointCount() {
-    return static_cast<int32>(queue_.size());
+    return parameter_changes_->queue_num_points(queue_index_);
 }
 
 tresult PLUGIN_API YaParamValueQueue::getPoint(
     int32 index,
-    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
     int32& sampleOffset /*out*/,
     Steinberg::Vst::ParamValue& value /*out*/) {
-    // Indices are signed integers, fun
-    if (index >= 0 && index < static_cast<int32>(queue_.size())) {
-        sampleOffset = queue_[index].first;
-        value = queue_[index].second;
-
-        return Steinberg::kResultOk;
-    } else {
-        return Steinberg::kInvalidArgument;
-    }
+    return parameter_changes_->queue_get_point(queue_index_, index,
+                                               sampleOffset, value);
 }
+
 tresult PLUGIN_API YaParamValueQueue::addPoint(int32 sampleOffset,
                                                Steinberg::Vst::ParamValue value,
                                                int32& index /*out*/) {
-    index = static_cast<int32>(queue_.size());
-    queue_.push_back({sampleOffset, value});
+    index = parameter_changes_->queue_add_point(queue_index_, sampleOffset,
+                                                value);
 
     return Steinberg::kResultOk;
 }
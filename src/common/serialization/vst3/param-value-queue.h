@@ -16,51 +16,39 @@
 
 #pragma once
 
-#include <llvm/small-vector.h>
 #include <pluginterfaces/vst/ivstparameterchanges.h>
 
-#include "../../bitsery/traits/small-vector.h"
 #include "base.h"
 
+class YaParameterChanges;
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wnon-virtual-dtor"
 
 /**
- * Wraps around `IParamValueQueue` for serializing a queue containing changes to
- * a single parameter during the current processing cycle. Used in
- * `YaParameterChanges`.
+ * A non-owning `IParamValueQueue` view into the flat parameter change storage
+ * in `YaParameterChanges`. The actual parameter IDs, sample offsets, and
+ * values live in that object's struct-of-arrays layout, and these views only
+ * identify a queue by its index. `YaParameterChanges::getParameterData()` and
+ * `YaParameterChanges::addParameterData()` refresh the view every time they
+ * hand one out, so a view always reads from and writes to the object it was
+ * just obtained from.
  */
-class alignas(16) YaParamValueQueue : public Steinberg::Vst::IParamValueQueue {
+class YaParamValueQueue : public Steinberg::Vst::IParamValueQueue {
    public:
-    /**
-     * We only provide a default constructor here, because we need to fill the
-     * existing object with new data every processing cycle to avoid
-     * reallocating a new object every time.
-     */
     YaParamValueQueue() noexcept;
 
     virtual ~YaParamValueQueue() noexcept;
 
     /**
-     * Clear this queue in place so that it can be used to write parameter data
-     * to. Used in `YaParameterChanges::addParameterData`.
+     * Point this view at one of `parameter_changes`' queues. Called whenever
+     * the view gets handed out.
      */
-    void clear_for_parameter(Steinberg::Vst::ParamID parameter_id) noexcept;
-
-    /**
-     * Read data from an `IParamValueQueue` object into this existing object.
-     */
-    void repopulate(Steinberg::Vst::IParamValueQueue& original_queue);
+    void update(YaParameterChanges& parameter_changes,
+                int32 queue_index) noexcept;
 
     DECLARE_FUNKNOWN_METHODS
 
-    /**
-     * Write this queue back the output parameter changes object on the
-     * `ProcessData` object provided by the host.
-     */
-    void write_back_outputs(
-        Steinberg::Vst::IParamValueQueue& output_queue) const;
-
     // From `IParamValueQueue`
     Steinberg::Vst::ParamID PLUGIN_API getParameterId() override;
     int32 PLUGIN_API getPointCount() override;
@@ -72,31 +60,15 @@ class alignas(16) YaParamValueQueue : public Steinberg::Vst::IParamValueQueue {
                                 Steinberg::Vst::ParamValue value,
                                 int32& index /*out*/) override;
 
-    template <typename S>
-    void serialize(S& s) {
-        s.value4b(parameter_id_);
-        // TODO: Does bitsery have a built in way to serialize pairs?
-        s.container(queue_, 1 << 16, [](S& s, std::pair<int32, double>& pair) {
-            s.value4b(pair.first);
-            s.value8b(pair.second);
-        });
-    }
-
+   private:
     /**
-     * For `IParamValueQueue::getParameterId`.
+     * The object whose flat arrays this queue is a view into.
      */
-    Steinberg::Vst::ParamID parameter_id_;
-
-   private:
+    YaParameterChanges* parameter_changes_ = nullptr;
     /**
-     * The actual parameter changes queue. The specification doesn't mention
-     * that this should be a priority queue or something, but I'd assume both
-     * the plugin and the host will insert the values in chronological order
-     * (because, why would they not?).
-     *
-     * This contains pairs of `(sample_offset, value)`.
+     * The index of the queue within that object.
      */
-    llvm::SmallVector<std::pair<int32, Steinberg::Vst::ParamValue>, 16> queue_;
+    int32 queue_index_ = 0;
 };
 
 #pragma GCC diagnostic pop
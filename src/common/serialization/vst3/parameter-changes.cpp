@@ -16,25 +16,229 @@
 
 #include "parameter-changes.h"
 
-YaParameterChanges::YaParameterChanges() noexcept {FUNKNOWN_CTOR}
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../../capacity-profile.h"
+
+YaParameterChanges::YaParameterChanges() noexcept : queue_offsets_{0} {
+    FUNKNOWN_CTOR
+}
 
 YaParameterChanges::~YaParameterChanges() noexcept {
     FUNKNOWN_DTOR
 }
 
 void YaParameterChanges::clear() noexcept {
-    queues_.clear();
+    layout_unchanged_ = false;
+    parameter_ids_.clear();
+    queue_offsets_.clear();
+    queue_offsets_.push_back(0);
+    sample_offsets_.clear();
+    values_.clear();
+    has_ramps_ = false;
+    ramp_point_counts_.clear();
 }
 
 void YaParameterChanges::repopulate(
     Steinberg::Vst::IParameterChanges& original_queues) {
-    // Copy over all parameter change queues
-    const size_t num_queues = original_queues.getParameterCount();
-    queues_.resize(num_queues);
-    for (size_t i = 0; i < num_queues; i++) {
-        queues_[i].repopulate(
-            *original_queues.getParameterData(static_cast<int>(i)));
+    // Copy all queues over to our flat struct-of-arrays storage
+    const int32 num_queues = original_queues.getParameterCount();
+    parameter_ids_.resize_for_overwrite(num_queues);
+    queue_offsets_.resize_for_overwrite(num_queues + 1);
+    queue_offsets_[0] = 0;
+    sample_offsets_.clear();
+    values_.clear();
+
+    for (int32 i = 0; i < num_queues; i++) {
+        Steinberg::Vst::IParamValueQueue* queue =
+            original_queues.getParameterData(i);
+        parameter_ids_[i] = queue->getParameterId();
+
+        const int32 num_points = queue->getPointCount();
+        for (int32 j = 0; j < num_points; j++) {
+            int32 sample_offset;
+            Steinberg::Vst::ParamValue value;
+            // We're skipping the assertions here and just assume that the
+            // function returns `kResultOk`
+            queue->getPoint(j, sample_offset, value);
+
+            sample_offsets_.push_back(sample_offset);
+            values_.push_back(value);
+        }
+
+        queue_offsets_[i + 1] = static_cast<int32>(sample_offsets_.size());
+    }
+
+    CapacityProfile::observe(CapacityCounter::vst3_parameter_queues,
+                             parameter_ids_.size());
+    CapacityProfile::observe(CapacityCounter::vst3_parameter_points,
+                             sample_offsets_.size());
+}
+
+void YaParameterChanges::encode_layout_delta(
+    llvm::SmallVectorImpl<Steinberg::Vst::ParamID>& previous_layout) {
+    layout_unchanged_ =
+        parameter_ids_.size() == previous_layout.size() &&
+        std::equal(parameter_ids_.begin(), parameter_ids_.end(),
+                   previous_layout.begin());
+    if (!layout_unchanged_) {
+        previous_layout.assign(parameter_ids_.begin(), parameter_ids_.end());
+    }
+}
+
+void YaParameterChanges::decode_layout_delta(
+    llvm::SmallVectorImpl<Steinberg::Vst::ParamID>& previous_layout) {
+    if (layout_unchanged_) {
+        // Both sides update their layout caches on every block, so these can
+        // never go out of sync
+        assert(num_queues() == previous_layout.size());
+        parameter_ids_.assign(previous_layout.begin(), previous_layout.end());
+    } else {
+        previous_layout.assign(parameter_ids_.begin(), parameter_ids_.end());
+    }
+}
+
+bool YaParameterChanges::is_linear_ramp(int32 begin,
+                                        int32 end) const noexcept {
+    const int32 num_points = end - begin;
+    const int32 first_offset = sample_offsets_[begin];
+    const int32 total_span = sample_offsets_[end - 1] - first_offset;
+
+    // The points have to be evenly spaced, or the offsets can't be
+    // reproduced from just the endpoints and the point count
+    if (total_span <= 0 || total_span % (num_points - 1) != 0) {
+        return false;
+    }
+    const int32 step = total_span / (num_points - 1);
+
+    const double first_value = values_[begin];
+    const double slope = (values_[end - 1] - first_value) / total_span;
+    for (int32 j = 1; j < num_points - 1; j++) {
+        if (sample_offsets_[begin + j] != first_offset + (j * step)) {
+            return false;
+        }
+        const double expected = first_value + (slope * (j * step));
+        if (std::abs(values_[begin + j] - expected) > ramp_tolerance) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void YaParameterChanges::encode_ramps() {
+    const size_t queues = num_queues();
+    ramp_point_counts_.resize_for_overwrite(queues);
+    has_ramps_ = false;
+
+    // Collapsed queues shrink to two points, so the points can be compacted
+    // towards the front of the flat arrays in a single forward pass
+    int32 write_pos = 0;
+    for (size_t i = 0; i < queues; i++) {
+        const int32 begin = queue_offsets_[i];
+        const int32 end = queue_offsets_[i + 1];
+        const int32 num_points = end - begin;
+        const bool is_ramp =
+            num_points >= min_ramp_points && is_linear_ramp(begin, end);
+
+        queue_offsets_[i] = write_pos;
+        if (is_ramp) {
+            ramp_point_counts_[i] = num_points;
+            has_ramps_ = true;
+
+            sample_offsets_[write_pos] = sample_offsets_[begin];
+            values_[write_pos] = values_[begin];
+            sample_offsets_[write_pos + 1] = sample_offsets_[end - 1];
+            values_[write_pos + 1] = values_[end - 1];
+            write_pos += 2;
+        } else {
+            ramp_point_counts_[i] = 0;
+
+            // The write position can only trail the read position, so these
+            // forward copies are fine with the ranges overlapping
+            std::copy(sample_offsets_.begin() + begin,
+                      sample_offsets_.begin() + end,
+                      sample_offsets_.begin() + write_pos);
+            std::copy(values_.begin() + begin, values_.begin() + end,
+                      values_.begin() + write_pos);
+            write_pos += num_points;
+        }
+    }
+
+    queue_offsets_[queues] = write_pos;
+    sample_offsets_.resize(write_pos);
+    values_.resize(write_pos);
+}
+
+void YaParameterChanges::decode_ramps() {
+    if (!has_ramps_) {
+        return;
     }
+
+    const size_t queues = num_queues();
+    assert(ramp_point_counts_.size() == queues);
+
+    int32 total_points = 0;
+    for (size_t i = 0; i < queues; i++) {
+        total_points += ramp_point_counts_[i] != 0
+                            ? ramp_point_counts_[i]
+                            : queue_offsets_[i + 1] - queue_offsets_[i];
+    }
+
+    // Expanding only ever moves points towards the back, so the queues can
+    // be expanded in place back to front
+    sample_offsets_.resize(total_points);
+    values_.resize(total_points);
+
+    int32 next_start = total_points;
+    queue_offsets_[queues] = total_points;
+    for (size_t i = queues; i-- > 0;) {
+        const int32 begin = queue_offsets_[i];
+
+        int32 new_begin;
+        if (const int32 num_points = ramp_point_counts_[i]; num_points != 0) {
+            // A collapsed ramp, stored as just its two endpoints
+            const int32 first_offset = sample_offsets_[begin];
+            const int32 last_offset = sample_offsets_[begin + 1];
+            const double first_value = values_[begin];
+            const double last_value = values_[begin + 1];
+            const int32 step = (last_offset - first_offset) / (num_points - 1);
+            const double slope =
+                (last_value - first_value) / (last_offset - first_offset);
+
+            new_begin = next_start - num_points;
+            for (int32 j = 0; j < num_points - 1; j++) {
+                sample_offsets_[new_begin + j] = first_offset + (j * step);
+                values_[new_begin + j] = first_value + (slope * (j * step));
+            }
+
+            // The endpoints are restored exactly as the host sent them
+            sample_offsets_[next_start - 1] = last_offset;
+            values_[next_start - 1] = last_value;
+        } else {
+            const int32 num_points = queue_offsets_[i + 1] - begin;
+            new_begin = next_start - num_points;
+            std::copy_backward(sample_offsets_.begin() + begin,
+                               sample_offsets_.begin() + begin + num_points,
+                               sample_offsets_.begin() + next_start);
+            std::copy_backward(values_.begin() + begin,
+                               values_.begin() + begin + num_points,
+                               values_.begin() + next_start);
+        }
+
+        // The compressed offset at `i + 1` was still needed above to locate
+        // this queue's points, but from here on only the expanded offset is
+        if (i + 1 < queues) {
+            queue_offsets_[i + 1] = next_start;
+        }
+        next_start = new_begin;
+    }
+
+    // `queue_offsets_[0]` is always zero, and every other offset was updated
+    // as the queue before it was expanded
+    assert(next_start == 0);
 }
 
 #pragma GCC diagnostic push
@@ -45,30 +249,84 @@ IMPLEMENT_FUNKNOWN_METHODS(YaParameterChanges,
 #pragma GCC diagnostic pop
 
 size_t YaParameterChanges::num_parameters() const {
-    return queues_.size();
+    return num_queues();
 }
 
 void YaParameterChanges::write_back_outputs(
     Steinberg::Vst::IParameterChanges& output_queues) const {
-    for (auto& queue : queues_) {
-        // We don't need this, but the SDK requires us to need this
+    for (size_t i = 0; i < num_queues(); i++) {
+        // We don't need these, but the SDK requires us to need these
         int32 output_queue_index;
         if (Steinberg::Vst::IParamValueQueue* output_queue =
-                output_queues.addParameterData(queue.parameter_id_,
+                output_queues.addParameterData(parameter_ids_[i],
                                                output_queue_index)) {
-            queue.write_back_outputs(*output_queue);
+            int32 point_index;
+            for (int32 point = queue_offsets_[i]; point < queue_offsets_[i + 1];
+                 point++) {
+                // We don't check for `kResultOk` here
+                output_queue->addPoint(sample_offsets_[point], values_[point],
+                                       point_index);
+            }
         }
     }
 }
 
+Steinberg::Vst::ParamID YaParameterChanges::queue_parameter_id(
+    int32 queue_index) const noexcept {
+    return parameter_ids_[queue_index];
+}
+
+int32 YaParameterChanges::queue_num_points(int32 queue_index) const noexcept {
+    return queue_offsets_[queue_index + 1] - queue_offsets_[queue_index];
+}
+
+tresult YaParameterChanges::queue_get_point(
+    int32 queue_index,
+    int32 point_index,
+    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+    int32& sample_offset /*out*/,
+    Steinberg::Vst::ParamValue& value /*out*/) const noexcept {
+    // Indices are signed integers, fun
+    if (point_index >= 0 && point_index < queue_num_points(queue_index)) {
+        const int32 point = queue_offsets_[queue_index] + point_index;
+        sample_offset = sample_offsets_[point];
+        value = values_[point];
+
+        return Steinberg::kResultOk;
+    } else {
+        return Steinberg::kInvalidArgument;
+    }
+}
+
+int32 YaParameterChanges::queue_add_point(int32 queue_index,
+                                          int32 sample_offset,
+                                          Steinberg::Vst::ParamValue value) {
+    // Plugins fill one queue at a time, so in practice this insertion always
+    // happens at the very end of the flat arrays and the loop below only
+    // bumps the final total-count element
+    const int32 insert_position = queue_offsets_[queue_index + 1];
+    const int32 point_index = insert_position - queue_offsets_[queue_index];
+    sample_offsets_.insert(sample_offsets_.begin() + insert_position,
+                           sample_offset);
+    values_.insert(values_.begin() + insert_position, value);
+    for (size_t i = queue_index + 1; i < queue_offsets_.size(); i++) {
+        queue_offsets_[i]++;
+    }
+
+    return point_index;
+}
+
 int32 PLUGIN_API YaParameterChanges::getParameterCount() {
-    return static_cast<int32>(queues_.size());
+    return static_cast<int32>(num_queues());
 }
 
 Steinberg::Vst::IParamValueQueue* PLUGIN_API
 YaParameterChanges::getParameterData(int32 index) {
-    if (index < static_cast<int32>(queues_.size())) {
-        return &queues_[index];
+    if (index < static_cast<int32>(num_queues())) {
+        ensure_views();
+        queue_views_[index].update(*this, index);
+
+        return &queue_views_[index];
     } else {
         return nullptr;
     }
@@ -77,12 +335,21 @@ YaParameterChanges::getParameterData(int32 index) {
 Steinberg::Vst::IParamValueQueue* PLUGIN_API
 YaParameterChanges::addParameterData(const Steinberg::Vst::ParamID& id,
                                      int32& index /*out*/) {
-    index = static_cast<int32>(queues_.size());
+    index = static_cast<int32>(num_queues());
 
-    // Tiny hack, resizing avoids calling the constructor the second time we
-    // resize the vector to the same size
-    queues_.resize(queues_.size() + 1);
-    queues_[index].clear_for_parameter(id);
+    parameter_ids_.push_back(id);
+    // The new queue starts out empty, so its start offset is the current end
+    // of the flat arrays
+    queue_offsets_.push_back(queue_offsets_.back());
 
-    return &queues_[index];
+    ensure_views();
+    queue_views_[index].update(*this, index);
+
+    return &queue_views_[index];
+}
+
+void YaParameterChanges::ensure_views() noexcept {
+    if (queue_views_.size() < num_queues()) {
+        queue_views_.resize(num_queues());
+    }
 }
@@ -20,6 +20,7 @@
 #include <pluginterfaces/vst/ivstparameterchanges.h>
 
 #include "../../bitsery/traits/small-vector.h"
+#include "../capacities.h"
 #include "base.h"
 #include "param-value-queue.h"
 
@@ -29,6 +30,15 @@
 /**
  * Wraps around `IParameterChanges` for serialization purposes. Used in
  * `YaProcessData`.
+ *
+ * Instead of mirroring the SDK's object graph of queue objects that each own
+ * a vector of points, the queues are stored in a struct-of-arrays layout: one
+ * flat array of parameter IDs, one flat array with each queue's starting
+ * offset, and flat arrays with all queues' sample offsets and values
+ * back-to-back. This (de)serializes as four plain memcpy-able arrays without
+ * any per-queue bookkeeping or allocations, and the `IParamValueQueue`
+ * objects handed to the plugin and the host are just views into these arrays,
+ * see `YaParamValueQueue`.
  */
 class YaParameterChanges : public Steinberg::Vst::IParameterChanges {
    public:
@@ -68,6 +78,85 @@ class YaParameterChanges : public Steinberg::Vst::IParameterChanges {
     void write_back_outputs(
         Steinberg::Vst::IParameterChanges& output_queues) const;
 
+    /**
+     * Check whether this block's queues target the exact same parameters as
+     * the previous block's, and update `previous_layout` accordingly. Hosts
+     * send automation as queues for mostly the same parameter IDs block after
+     * block, so when the layout is unchanged we skip serializing the IDs and
+     * only transmit the points. Called on the native plugin side right after
+     * repopulating these queues, with a layout cache that persists for the
+     * lifetime of the audio processor instance. The Wine side keeps an
+     * identical cache and restores the IDs with `decode_layout_delta()`, so
+     * both caches always stay in lockstep.
+     */
+    void encode_layout_delta(
+        llvm::SmallVectorImpl<Steinberg::Vst::ParamID>& previous_layout);
+
+    /**
+     * The receiving counterpart to `encode_layout_delta()`. Restores the
+     * parameter IDs from `previous_layout` if they were omitted from the
+     * message, and updates the cached layout otherwise. Called on the Wine
+     * side right after deserializing the process data.
+     */
+    void decode_layout_delta(
+        llvm::SmallVectorImpl<Steinberg::Vst::ParamID>& previous_layout);
+
+    /**
+     * Collapse queues whose points form a linear ramp down to their two
+     * endpoints. Hosts rendering automation curves emit densely sampled
+     * linear segments - up to one point every few samples - so during
+     * automation-heavy playback almost all of the process data consists of
+     * points that are exactly interpolable from their segment's endpoints.
+     * Such queues are transmitted as just the endpoint pair plus the
+     * original point count, and `decode_ramps()` synthesizes the identical
+     * point queue again on the Wine side. Called on the native plugin side
+     * right after repopulating these queues. Values are reconstructed by
+     * linear interpolation, so a point can end up a rounding error (less
+     * than `ramp_tolerance`, far below automation resolution) away from the
+     * host's original value.
+     */
+    void encode_ramps();
+
+    /**
+     * The receiving counterpart to `encode_ramps()`. Expands the collapsed
+     * ramp queues back into full point queues, so the plugin sees the same
+     * densely sampled automation the host produced. Called on the Wine side
+     * right after deserializing the process data.
+     */
+    void decode_ramps();
+
+    // The following accessors back the `YaParamValueQueue` views, with
+    // `queue_index` identifying the queue a view points at
+
+    /**
+     * The parameter ID a queue contains changes for. For
+     * `IParamValueQueue::getParameterId()`.
+     */
+    Steinberg::Vst::ParamID queue_parameter_id(
+        int32 queue_index) const noexcept;
+
+    /**
+     * The number of points in a queue. For
+     * `IParamValueQueue::getPointCount()`.
+     */
+    int32 queue_num_points(int32 queue_index) const noexcept;
+
+    /**
+     * Fetch a point from a queue. For `IParamValueQueue::getPoint()`.
+     */
+    tresult queue_get_point(int32 queue_index,
+                            int32 point_index,
+                            int32& sample_offset,
+                            Steinberg::Vst::ParamValue& value) const noexcept;
+
+    /**
+     * Append a point to a queue, returning the new point's index within that
+     * queue. For `IParamValueQueue::addPoint()`.
+     */
+    int32 queue_add_point(int32 queue_index,
+                          int32 sample_offset,
+                          Steinberg::Vst::ParamValue value);
+
     // From `IParameterChanges`
     int32 PLUGIN_API getParameterCount() override;
     Steinberg::Vst::IParamValueQueue* PLUGIN_API
@@ -78,14 +167,115 @@ class YaParameterChanges : public Steinberg::Vst::IParameterChanges {
 
     template <typename S>
     void serialize(S& s) {
-        s.container(queues_, 1 << 16);
+        s.boolValue(layout_unchanged_);
+        if (!layout_unchanged_) {
+            s.container4b(parameter_ids_, 1 << 16);
+        }
+        s.container4b(queue_offsets_, (1 << 16) + 1);
+        s.container4b(sample_offsets_, 1 << 20);
+        s.container8b(values_, 1 << 20);
+        s.boolValue(has_ramps_);
+        if (has_ramps_) {
+            s.container4b(ramp_point_counts_, 1 << 16);
+        }
     }
 
+    /**
+     * The maximum distance between a point's value and the linear
+     * interpolation of its segment's endpoints for the segment to still
+     * count as a ramp. Hosts generate ramp points incrementally, so the
+     * points drift a few ULPs away from the exact line. This is orders of
+     * magnitude below any audible automation resolution.
+     */
+    static constexpr double ramp_tolerance = 1e-9;
+
+    /**
+     * The minimum number of points for collapsing a queue to be worthwhile.
+     */
+    static constexpr int32 min_ramp_points = 4;
+
    private:
     /**
-     * The parameter value changes queues.
+     * The number of queues. `queue_offsets_` always contains one more element
+     * than there are queues, see below.
+     */
+    size_t num_queues() const noexcept { return queue_offsets_.size() - 1; }
+
+    /**
+     * Make sure there's a view object for every queue. The views themselves
+     * get pointed at their queue whenever they're handed out.
+     */
+    void ensure_views() noexcept;
+
+    /**
+     * Whether this block's queues target the same parameter IDs as the
+     * previous block's, in the same order. If this is the case the IDs are
+     * not part of the message and the receiving side restores them from its
+     * own cached layout. Only used for the input parameter changes, output
+     * queues always take the full path. See `encode_layout_delta()`.
+     */
+    bool layout_unchanged_ = false;
+
+    /**
+     * The parameter ID every queue contains changes for.
+     */
+    llvm::SmallVector<Steinberg::Vst::ParamID,
+                      capacities::vst3_parameter_queues>
+        parameter_ids_;
+    /**
+     * Each queue's starting index in `sample_offsets_` and `values_`, with
+     * the total point count as an extra final element. This always contains
+     * one more element than `parameter_ids_`, and queue `i`'s points are
+     * stored at the indices `[queue_offsets_[i], queue_offsets_[i + 1])`.
+     */
+    llvm::SmallVector<int32, capacities::vst3_parameter_queues>
+        queue_offsets_;
+    /**
+     * All queues' sample offsets, back-to-back.
+     */
+    llvm::SmallVector<int32, capacities::vst3_parameter_points>
+        sample_offsets_;
+    /**
+     * All queues' values, back-to-back.
+     */
+    llvm::SmallVector<Steinberg::Vst::ParamValue,
+                      capacities::vst3_parameter_points>
+        values_;
+
+    /**
+     * Check whether a queue's points, stored at the indices `[begin, end)`
+     * of `sample_offsets_` and `values_`, form an evenly spaced linear ramp
+     * that `decode_ramps()` can reproduce from its endpoints.
+     */
+    bool is_linear_ramp(int32 begin, int32 end) const noexcept;
+
+    /**
+     * Whether any queue was collapsed by `encode_ramps()`. When this is
+     * false the ramp point counts are not part of the message, so blocks
+     * without ramps (and all output parameter changes) only pay a single
+     * byte for this optimization.
+     */
+    bool has_ramps_ = false;
+
+    /**
+     * For every queue the number of points it held before `encode_ramps()`
+     * collapsed it down to its endpoints, or zero for queues whose points
+     * were transmitted verbatim. Only meaningful when `has_ramps_` is set.
+     */
+    llvm::SmallVector<int32, capacities::vst3_parameter_queues>
+        ramp_point_counts_;
+
+    /**
+     * The view objects handed out through `getParameterData()` and
+     * `addParameterData()`. Not serialized.
+     *
+     * NOTE: Like the queue objects this replaces, growing this vector can
+     *       invalidate previously handed out views. Plugins and hosts don't
+     *       hold on to queues across `addParameterData()` calls, so this has
+     *       never been an issue in practice.
      */
-    llvm::SmallVector<YaParamValueQueue, 16> queues_;
+    llvm::SmallVector<YaParamValueQueue, capacities::vst3_parameter_queues>
+        queue_views_;
 };
 
 #pragma GCC diagnostic pop
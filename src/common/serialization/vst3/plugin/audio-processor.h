@@ -20,6 +20,7 @@
 
 #include "../../../audio-shm.h"
 #include "../../../bitsery/ext/in-place-optional.h"
+#include "../../../utils.h"
 #include "../../common.h"
 #include "../base.h"
 #include "../process-data.h"
@@ -253,21 +254,20 @@ class YaAudioProcessor : public Steinberg::Vst::IAudioProcessor {
         YaProcessData data;
 
         /**
-         * We'll periodically synchronize the realtime priority setting of the
-         * host's audio thread with the Wine plugin host. We'll do this
+         * We'll periodically synchronize the realtime scheduling parameters of
+         * the host's audio thread with the Wine plugin host. We'll do this
          * approximately every ten seconds, as doing this getting and setting
          * scheduler information has a non trivial amount of overhead (even if
          * it's only a single microsoecond).
          */
-        std::optional<int> new_realtime_priority;
+        std::optional<RealtimeParameters> new_realtime_parameters;
 
         template <typename S>
         void serialize(S& s) {
             s.value8b(instance_id);
             s.object(data);
 
-            s.ext(new_realtime_priority, bitsery::ext::InPlaceOptional{},
-                  [](S& s, int& priority) { s.value4b(priority); });
+            s.ext(new_realtime_parameters, bitsery::ext::InPlaceOptional{});
         }
     };
 
@@ -205,6 +205,35 @@ class YaConnectionPoint : public Steinberg::Vst::IConnectionPoint {
     virtual tresult PLUGIN_API
     notify(Steinberg::Vst::IMessage* message) override = 0;
 
+    /**
+     * Message to tell the Wine plugin host that this object's connection
+     * peer turned out to be another bridged object in the same process, even
+     * though the host connected them through a connection proxy. This happens
+     * when the host's proxy delivers our peer discovery message only after
+     * `IConnectionPoint::connect()` has returned, in which case we have
+     * already set up the proxied connection. The Wine plugin host will then
+     * deliver `notify()` calls from this object directly to the other object
+     * instead of routing every message through the native plugin and the
+     * host's connection proxy, saving two socket round trips per message.
+     */
+    struct BypassConnectionProxy {
+        using Response = Ack;
+
+        native_size_t instance_id;
+
+        /**
+         * The instance ID of the object `notify()` calls should be delivered
+         * to directly.
+         */
+        native_size_t other_instance_id;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.value8b(instance_id);
+            s.value8b(other_instance_id);
+        }
+    };
+
    protected:
     ConstructArgs arguments_;
 };
@@ -150,12 +150,12 @@ class YaEditController : public Steinberg::Vst::IEditController {
      */
     struct GetParamStringByValueResponse {
         UniversalTResult result;
-        std::u16string string;
+        U16String128 string;
 
         template <typename S>
         void serialize(S& s) {
             s.object(result);
-            s.text2b(string, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(string, U16String128::max_length);
         }
     };
 
@@ -212,13 +212,13 @@ class YaEditController : public Steinberg::Vst::IEditController {
         native_size_t instance_id;
 
         Steinberg::Vst::ParamID id;
-        std::u16string string;
+        U16String128 string;
 
         template <typename S>
         void serialize(S& s) {
             s.value8b(instance_id);
             s.value4b(id);
-            s.text2b(string, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(string, U16String128::max_length);
         }
     };
 
@@ -298,6 +298,43 @@ class YaEditController : public Steinberg::Vst::IEditController {
     virtual Steinberg::Vst::ParamValue PLUGIN_API
     getParamNormalized(Steinberg::Vst::ParamID id) override = 0;
 
+    /**
+     * The current normalized values for all parameters requested through a
+     * `GetParamNormalizedMulti`, in the same order as the requested IDs.
+     *
+     * @see GetParamNormalizedMulti
+     */
+    struct GetParamNormalizedMultiResponse {
+        std::vector<Steinberg::Vst::ParamValue> values;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.container8b(values, 1 << 16);
+        }
+    };
+
+    /**
+     * Fetch the current values for multiple parameters using a single round
+     * trip, as if `IEditController::getParamNormalized()` was called for
+     * every ID. Hosts like REAPER poll every visible parameter at UI rate,
+     * and without this every one of those polls would be a separate message.
+     * The native plugin side uses this to refresh its entire parameter value
+     * cache at once, see `Vst3PluginProxyImpl::getParamNormalized()`.
+     */
+    struct GetParamNormalizedMulti {
+        using Response = GetParamNormalizedMultiResponse;
+
+        native_size_t instance_id;
+
+        std::vector<Steinberg::Vst::ParamID> ids;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.value8b(instance_id);
+            s.container4b(ids, 1 << 16);
+        }
+    };
+
     /**
      * Message to pass through a call to
      * `IEditController::setParamNormalized(id, value)` to the Wine plugin host.
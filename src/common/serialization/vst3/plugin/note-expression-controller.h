@@ -143,12 +143,12 @@ class YaNoteExpressionController
      */
     struct GetNoteExpressionStringByValueResponse {
         UniversalTResult result;
-        std::u16string string;
+        U16String128 string;
 
         template <typename S>
         void serialize(S& s) {
             s.object(result);
-            s.text2b(string, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(string, U16String128::max_length);
         }
     };
 
@@ -213,7 +213,7 @@ class YaNoteExpressionController
         int32 bus_index;
         int16 channel;
         Steinberg::Vst::NoteExpressionTypeID id;
-        std::u16string string;
+        U16String128 string;
 
         template <typename S>
         void serialize(S& s) {
@@ -221,7 +221,7 @@ class YaNoteExpressionController
             s.value4b(bus_index);
             s.value2b(channel);
             s.value4b(id);
-            s.text2b(string, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(string, U16String128::max_length);
         }
     };
 
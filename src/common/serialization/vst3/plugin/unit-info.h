@@ -18,6 +18,7 @@
 
 #include <pluginterfaces/vst/ivstunits.h>
 
+#include "../../../bitsery/ext/in-place-optional.h"
 #include "../../common.h"
 #include "../base.h"
 #include "../bstream.h"
@@ -118,6 +119,46 @@ class YaUnitInfo : public Steinberg::Vst::IUnitInfo {
     getUnitInfo(int32 unitIndex,
                 Steinberg::Vst::UnitInfo& info /*out*/) override = 0;
 
+    /**
+     * The plugin's entire unit hierarchy.
+     *
+     * @see GetUnitInfos
+     */
+    struct GetUnitInfosResponse {
+        /**
+         * All of the plugin's unit infos. If the plugin somehow returned an
+         * error for a unit that should be in range, then this contains a
+         * nullopt value.
+         */
+        std::vector<std::optional<Steinberg::Vst::UnitInfo>> infos;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.container(infos, 1 << 16, [](S& s, auto& v) {
+                s.ext(v, bitsery::ext::InPlaceOptional{});
+            });
+        }
+    };
+
+    /**
+     * Fetch the plugin's entire unit hierarchy using both
+     * `IUnitInfo::getUnitCount()` and `IUnitInfo::getUnitInfo()`. Hosts walk
+     * the unit tree by calling these functions repeatedly, so just like the
+     * parameter information in `YaEditController::GetParameterInfos` this is
+     * queried all at once and then cached on the native plugin side until the
+     * plugin triggers a component restart.
+     */
+    struct GetUnitInfos {
+        using Response = GetUnitInfosResponse;
+
+        native_size_t instance_id;
+
+        template <typename S>
+        void serialize(S& s) {
+            s.value8b(instance_id);
+        }
+    };
+
     /**
      * Message to pass through a call to `IUnitInfo::getProgramListCount()` to
      * the Wine plugin host.
@@ -179,12 +220,12 @@ class YaUnitInfo : public Steinberg::Vst::IUnitInfo {
      */
     struct GetProgramNameResponse {
         UniversalTResult result;
-        std::u16string name;
+        U16String128 name;
 
         template <typename S>
         void serialize(S& s) {
             s.object(result);
-            s.text2b(name, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(name, U16String128::max_length);
         }
     };
 
@@ -220,12 +261,12 @@ class YaUnitInfo : public Steinberg::Vst::IUnitInfo {
      */
     struct GetProgramInfoResponse {
         UniversalTResult result;
-        std::u16string attribute_value;
+        U16String128 attribute_value;
 
         template <typename S>
         void serialize(S& s) {
             s.object(result);
-            s.text2b(attribute_value, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(attribute_value, U16String128::max_length);
         }
     };
 
@@ -289,12 +330,12 @@ class YaUnitInfo : public Steinberg::Vst::IUnitInfo {
      */
     struct GetProgramPitchNameResponse {
         UniversalTResult result;
-        std::u16string name;
+        U16String128 name;
 
         template <typename S>
         void serialize(S& s) {
             s.object(result);
-            s.text2b(name, std::extent_v<Steinberg::Vst::String128>);
+            s.text2b(name, U16String128::max_length);
         }
     };
 
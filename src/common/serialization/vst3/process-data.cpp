@@ -16,6 +16,10 @@
 
 #include "process-data.h"
 
+#include <algorithm>
+
+#include "../../audio-copy.h"
+#include "../../capacity-profile.h"
 #include "../../utils.h"
 
 YaProcessData::YaProcessData() noexcept {}
@@ -42,21 +46,65 @@ void YaProcessData::repopulate(const Steinberg::Vst::ProcessData& process_data,
             static_cast<int32>(shared_audio_buffers.num_input_channels(bus)),
             process_data.inputs[bus].numChannels);
         inputs_[bus].silenceFlags = process_data.inputs[bus].silenceFlags;
+    }
 
-        // We copy the actual input audio for every bus to the shared memory
-        // object
-        for (int channel = 0; channel < inputs_[bus].numChannels; channel++) {
-            if (process_data.symbolicSampleSize == Steinberg::Vst::kSample64) {
-                std::copy_n(process_data.inputs[bus].channelBuffers64[channel],
-                            process_data.numSamples,
-                            shared_audio_buffers.input_channel_ptr<double>(
-                                bus, channel));
-            } else {
-                std::copy_n(process_data.inputs[bus].channelBuffers32[channel],
-                            process_data.numSamples,
-                            shared_audio_buffers.input_channel_ptr<float>(
-                                bus, channel));
+    // We copy the actual input audio for every bus to the shared memory
+    // object. Instead of walking the nested offset tables bus-by-bus, this
+    // uses the flat copy plan the shared memory object precomputed for the
+    // negotiated layout, so the loop's overhead is independent of the bus
+    // topology. Channels that only contain silence are skipped: the host's
+    // silence flags act as a fast hint, and for unflagged channels we do a
+    // cheap scan ourselves since many hosts never set the flags. The Wine
+    // side zeroes out the flagged channels instead, replacing a
+    // read-and-write copy with a store-only fill. Only the first 64 channels
+    // can be flagged because `silenceFlags` is a 64-bit mask.
+    //
+    // With the `shared_sidechain` option the sidechain busses of multiple
+    // instances are backed by one shared region that the host fills with
+    // identical samples, so only the first instance to process a block
+    // copies them and everyone else skips those channels.
+    const bool write_shared_input =
+        shared_audio_buffers.try_claim_shared_input_write();
+    for (const auto& entry : shared_audio_buffers.input_copy_plan()) {
+        // The plan covers the plugin's entire negotiated layout, and the
+        // entries are in bus-major order. The per-bus channel counts have
+        // been capped to what the host provided above.
+        if (entry.bus >= static_cast<uint32_t>(process_data.numInputs)) {
+            break;
+        }
+        Steinberg::Vst::AudioBusBuffers& bus_buffers = inputs_[entry.bus];
+        if (static_cast<int32>(entry.channel) >= bus_buffers.numChannels) {
+            continue;
+        }
+        if (entry.shared_input && !write_shared_input) {
+            continue;
+        }
+
+        const Steinberg::uint64 channel_bit = 1ull << (entry.channel & 63);
+        if (process_data.symbolicSampleSize == Steinberg::Vst::kSample64) {
+            const double* host_buffer =
+                process_data.inputs[entry.bus].channelBuffers64[entry.channel];
+            if (entry.channel < 64 &&
+                ((bus_buffers.silenceFlags & channel_bit) ||
+                 audio_copy::is_silent(host_buffer, process_data.numSamples))) {
+                bus_buffers.silenceFlags |= channel_bit;
+                continue;
             }
+
+            std::copy_n(host_buffer, process_data.numSamples,
+                        reinterpret_cast<double*>(entry.shm_pointer));
+        } else {
+            const float* host_buffer =
+                process_data.inputs[entry.bus].channelBuffers32[entry.channel];
+            if (entry.channel < 64 &&
+                ((bus_buffers.silenceFlags & channel_bit) ||
+                 audio_copy::is_silent(host_buffer, process_data.numSamples))) {
+                bus_buffers.silenceFlags |= channel_bit;
+                continue;
+            }
+
+            std::copy_n(host_buffer, process_data.numSamples,
+                        reinterpret_cast<float*>(entry.shm_pointer));
         }
     }
 
@@ -71,6 +119,9 @@ void YaProcessData::repopulate(const Steinberg::Vst::ProcessData& process_data,
         outputs_[bus].silenceFlags = process_data.outputs[bus].silenceFlags;
     }
 
+    CapacityProfile::observe(CapacityCounter::audio_buses,
+                             std::max(inputs_.size(), outputs_.size()));
+
     // Even though `ProcessData::inputParamterChanges` is mandatory, the VST3
     // validator will pass a null pointer here
     if (process_data.inputParameterChanges) {
@@ -80,6 +131,17 @@ void YaProcessData::repopulate(const Steinberg::Vst::ProcessData& process_data,
         input_parameter_changes_.clear();
     }
 
+    // During dense automation the queues mostly target the same parameters
+    // block after block, in which case we can skip sending the parameter IDs
+    // again. The Wine side restores them from its own cached layout in
+    // `reconstruct()`.
+    input_parameter_changes_.encode_layout_delta(input_parameter_layout_);
+
+    // Densely sampled linear automation ramps are collapsed down to their
+    // endpoints, and the Wine side synthesizes the full point queues again in
+    // `reconstruct()`
+    input_parameter_changes_.encode_ramps();
+
     // The existence of the output parameter changes object indicates whether or
     // not the host provides this for the plugin
     if (process_data.outputParameterChanges) {
@@ -116,8 +178,18 @@ void YaProcessData::repopulate(const Steinberg::Vst::ProcessData& process_data,
 }
 
 Steinberg::Vst::ProcessData& YaProcessData::reconstruct(
-    std::vector<std::vector<void*>>& input_pointers,
-    std::vector<std::vector<void*>>& output_pointers) {
+    AudioShmBuffer::BusPointers& input_pointers,
+    AudioShmBuffer::BusPointers& output_pointers) {
+    // If the input parameter change queues target the same parameters as the
+    // previous block's, then their IDs were not part of the message and we'll
+    // restore them from the cached layout, see
+    // `YaParameterChanges::encode_layout_delta()`
+    input_parameter_changes_.decode_layout_delta(input_parameter_layout_);
+
+    // Collapsed automation ramps are expanded back into their full point
+    // queues, see `YaParameterChanges::encode_ramps()`
+    input_parameter_changes_.decode_ramps();
+
     reconstructed_process_data_.processMode = process_mode_;
     reconstructed_process_data_.symbolicSampleSize = symbolic_sample_size_;
     reconstructed_process_data_.numSamples = num_samples_;
@@ -138,10 +210,39 @@ Steinberg::Vst::ProcessData& YaProcessData::reconstruct(
     for (size_t bus = 0; bus < inputs_.size(); bus++) {
         inputs_[bus].channelBuffers32 =
             reinterpret_cast<float**>(input_pointers[bus].data());
+
+        // The native plugin side skips the input copy for channels whose
+        // silence flag is set, so the shared memory still contains whatever
+        // the last non-silent block left behind. Plugins are allowed to ignore
+        // the silence flags and read the buffers anyway, so we'll zero those
+        // channels out here. This is a store-only fill instead of the
+        // read-and-write copy it replaces.
+        for (int channel = 0;
+             channel < inputs_[bus].numChannels && channel < 64; channel++) {
+            if ((inputs_[bus].silenceFlags & (1ull << channel)) == 0) {
+                continue;
+            }
+
+            if (symbolic_sample_size_ == Steinberg::Vst::kSample64) {
+                std::fill_n(
+                    reinterpret_cast<double*>(input_pointers[bus][channel]),
+                    num_samples_, 0.0);
+            } else {
+                std::fill_n(
+                    reinterpret_cast<float*>(input_pointers[bus][channel]),
+                    num_samples_, 0.0f);
+            }
+        }
     }
     for (size_t bus = 0; bus < outputs_.size(); bus++) {
         outputs_[bus].channelBuffers32 =
             reinterpret_cast<float**>(output_pointers[bus].data());
+
+        // The output silence flags are for the plugin to set. Clearing them
+        // here makes sure that the zero-fill in `write_back_outputs()` only
+        // ever acts on flags the plugin actually set during this block, and
+        // not on stale values provided by the host.
+        outputs_[bus].silenceFlags = 0;
     }
 
     reconstructed_process_data_.inputs = inputs_.data();
@@ -203,27 +304,56 @@ void YaProcessData::write_back_outputs(
     assert(static_cast<int32>(outputs_.size()) == process_data.numOutputs);
     for (int bus = 0; bus < process_data.numOutputs; bus++) {
         process_data.outputs[bus].silenceFlags = outputs_[bus].silenceFlags;
+    }
+
+    // We copy the output audio for every bus from the shared memory object
+    // back to the buffer provided by the host, again through the flat
+    // precomputed copy plan rather than the nested offset tables.
+    // NOTE: Some hosts, like Carla, provide more output channels than what
+    //       the plugin wants. We'll have already capped
+    //       `outputs[bus].numChannels` to the number of channels requested
+    //       by the plugin during `YaProcessData::repopulate()`.
+    for (const auto& entry : shared_audio_buffers.output_copy_plan()) {
+        if (entry.bus >= static_cast<uint32_t>(process_data.numOutputs)) {
+            break;
+        }
+        const Steinberg::Vst::AudioBusBuffers& bus_buffers =
+            outputs_[entry.bus];
+        if (static_cast<int32>(entry.channel) >= bus_buffers.numChannels) {
+            continue;
+        }
 
-        // NOTE: Some hosts, like Carla, provide more output channels than what
-        //       the plugin wants. We'll have already capped
-        //       `outputs[bus].numChannels` to the number of channels requested
-        //       by the plugin during `YaProcessData::repopulate()`.
-        for (int channel = 0; channel < outputs_[bus].numChannels; channel++) {
-            // We copy the output audio for every bus from the shared memory
-            // object back to the buffer provided by the host
+        // If the plugin flagged an output channel as silent then the host
+        // buffer can simply be zeroed out instead of copied from the shared
+        // memory object. The silence flags themselves have already been
+        // written back above.
+        if (entry.channel < 64 &&
+            (bus_buffers.silenceFlags & (1ull << entry.channel))) {
             if (process_data.symbolicSampleSize == Steinberg::Vst::kSample64) {
-                std::copy_n(
-                    shared_audio_buffers.output_channel_ptr<double>(bus,
-                                                                    channel),
-                    process_data.numSamples,
-                    process_data.outputs[bus].channelBuffers64[channel]);
+                std::fill_n(
+                    process_data.outputs[entry.bus]
+                        .channelBuffers64[entry.channel],
+                    process_data.numSamples, 0.0);
             } else {
-                std::copy_n(
-                    shared_audio_buffers.output_channel_ptr<float>(bus,
-                                                                   channel),
-                    process_data.numSamples,
-                    process_data.outputs[bus].channelBuffers32[channel]);
+                std::fill_n(
+                    process_data.outputs[entry.bus]
+                        .channelBuffers32[entry.channel],
+                    process_data.numSamples, 0.0f);
             }
+
+            continue;
+        }
+
+        if (process_data.symbolicSampleSize == Steinberg::Vst::kSample64) {
+            std::copy_n(reinterpret_cast<const double*>(entry.shm_pointer),
+                        process_data.numSamples,
+                        process_data.outputs[entry.bus]
+                            .channelBuffers64[entry.channel]);
+        } else {
+            std::copy_n(reinterpret_cast<const float*>(entry.shm_pointer),
+                        process_data.numSamples,
+                        process_data.outputs[entry.bus]
+                            .channelBuffers32[entry.channel]);
         }
     }
 
@@ -18,11 +18,14 @@
 
 #include <variant>
 
+#include <llvm/small-vector.h>
 #include <pluginterfaces/vst/ivstaudioprocessor.h>
 
 #include "../../audio-shm.h"
 #include "../../bitsery/ext/in-place-optional.h"
 #include "../../bitsery/ext/in-place-variant.h"
+#include "../../bitsery/traits/small-vector.h"
+#include "../capacities.h"
 #include "base.h"
 #include "event-list.h"
 #include "parameter-changes.h"
@@ -91,8 +94,8 @@ class YaProcessData {
      * single precision audio.
      */
     Steinberg::Vst::ProcessData& reconstruct(
-        std::vector<std::vector<void*>>& input_pointers,
-        std::vector<std::vector<void*>>& output_pointers);
+        AudioShmBuffer::BusPointers& input_pointers,
+        AudioShmBuffer::BusPointers& output_pointers);
 
     /**
      * A serializable wrapper around the output fields of `ProcessData`, so we
@@ -205,7 +208,9 @@ class YaProcessData {
      * be set to point to our shared memory surface that holds the actual audio
      * data.
      */
-    llvm::SmallVector<Steinberg::Vst::AudioBusBuffers, 8> inputs_;
+    llvm::SmallVector<Steinberg::Vst::AudioBusBuffers,
+                      capacities::audio_buses>
+        inputs_;
 
     /**
      * This contains metadata about the output buffers for every bus. During
@@ -213,7 +218,9 @@ class YaProcessData {
      * be set to point to our shared memory surface that holds the actual audio
      * data.
      */
-    llvm::SmallVector<Steinberg::Vst::AudioBusBuffers, 8> outputs_;
+    llvm::SmallVector<Steinberg::Vst::AudioBusBuffers,
+                      capacities::audio_buses>
+        outputs_;
 
     /**
      * Incoming parameter changes.
@@ -244,6 +251,19 @@ class YaProcessData {
     std::optional<Steinberg::Vst::ProcessContext> process_context_;
 
    private:
+    /**
+     * The parameter IDs targeted by the previous block's input parameter
+     * change queues, used for the layout delta described in
+     * `YaParameterChanges::encode_layout_delta()`. This is not serialized.
+     * The plugin side updates it in `repopulate()` and the Wine side in
+     * `reconstruct()`, which stay in lockstep because both sides keep this
+     * object alive for the lifetime of the audio processor instance and
+     * update it on every block.
+     */
+    llvm::SmallVector<Steinberg::Vst::ParamID,
+                      capacities::vst3_parameter_queues>
+        input_parameter_layout_;
+
     // These last few members are used on the Wine plugin host side to
     // reconstruct the original `ProcessData` object. Here we also initialize
     // these `output*` fields so the Windows VST3 plugin can write to them
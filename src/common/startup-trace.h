@@ -0,0 +1,82 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+// A tiny tracing facility for profiling plugin startup latency. When the
+// `YABRIDGE_TRACE_STARTUP` environment variable is set to a file path, the
+// chainloaders, the plugin bridges, and the Wine plugin host append a
+// timestamped line to that file for every startup phase they pass through.
+// Each line is tab separated in the format `<pid>\t<monotonic_us>\t<phase>`.
+// The monotonic clock has the same epoch in every process, so events from the
+// native plugin and the spawned Wine processes can be interleaved and diffed
+// directly. The file is opened with `O_APPEND` and written in single small
+// `write()` calls so multiple processes can safely share it. When the
+// environment variable is not set this all reduces to a single branch, so the
+// events can stay in release builds.
+
+/**
+ * Append a single event to the startup trace when tracing is enabled, and do
+ * nothing otherwise. `phase` should be a short identifier without whitespace,
+ * like `sockets-connect-begin`.
+ */
+inline void startup_trace_event(const char* phase) noexcept {
+    static const int trace_fd = []() {
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        const char* trace_path = getenv("YABRIDGE_TRACE_STARTUP");
+        if (!trace_path || trace_path[0] == '\0') {
+            return -1;
+        }
+
+        return open(trace_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    0644);
+    }();
+    if (trace_fd == -1) {
+        return;
+    }
+
+    const long long now_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+
+    char line[256];
+    const int length = snprintf(line, sizeof(line), "%d\t%lld\t%s\n", getpid(),
+                                now_us, phase);
+    if (length > 0 && static_cast<size_t>(length) < sizeof(line)) {
+        // We don't care about the occasional lost event if the disk is full
+        [[maybe_unused]] const ssize_t result = write(trace_fd, line, length);
+    }
+}
+
+/**
+ * Report the first audio processing callback in this process. This marks the
+ * end of the startup sequence, and it only emits an event the first time it
+ * gets called so it's safe to call from the audio threads.
+ */
+inline void startup_trace_first_audio() noexcept {
+    static std::once_flag first_audio_flag;
+    std::call_once(first_audio_flag,
+                   []() { startup_trace_event("first-audio-callback"); });
+}
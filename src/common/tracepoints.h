@@ -0,0 +1,56 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+// USDT/SystemTap static tracepoints at yabridge's bridging boundaries,
+// compiled in when the `tracepoints` build option is enabled (this requires
+// the `sys/sdt.h` header from SystemTap). The probes let `perf` and bpftrace
+// follow a call across the process boundary with nanosecond timestamps and
+// without recompiling or attaching anything to Wine's internals, e.g.:
+//
+//     perf buildid-cache --add ~/.local/share/yabridge/yabridge-host.exe.so
+//     perf record -e sdt_yabridge:* -p <pid>
+//     bpftrace -e 'usdt:*:yabridge:message_sent { @bytes = hist(arg1); }'
+//
+// A probe site compiles down to a single `nop` instruction until a tracer
+// arms it, so the `tracepoints` option is safe to leave enabled in regular
+// builds. The following probes exist:
+//
+// - `message_sent(fd, bytes)` and `message_received(fd, bytes)` in
+//   `write_object()`/`read_object()`, for every message crossing a socket.
+// - `process_start(bridge)`/`process_end(bridge)` and
+//   `dispatch_start(bridge)`/`dispatch_end(bridge)` around the plugin's
+//   audio processing and dispatcher calls on the Wine side, see
+//   `HostBridge::ScopedLoadTimer`.
+// - `vst2_process_request(sample_frames)`, `vst3_process_request(instance,
+//   sample_frames)` and `clap_process_request(instance, sample_frames)` with
+//   matching `*_process_response()` probes on the native plugin side.
+// - `event_loop_tick()` for every tick of the Wine side's shared GUI event
+//   loop, see `MainContext`.
+
+#ifdef WITH_TRACEPOINTS
+#include <sys/sdt.h>
+
+#define YABRIDGE_PROBE(name) DTRACE_PROBE(yabridge, name)
+#define YABRIDGE_PROBE1(name, arg1) DTRACE_PROBE1(yabridge, name, arg1)
+#define YABRIDGE_PROBE2(name, arg1, arg2) \
+    DTRACE_PROBE2(yabridge, name, arg1, arg2)
+#else
+#define YABRIDGE_PROBE(name)
+#define YABRIDGE_PROBE1(name, arg1)
+#define YABRIDGE_PROBE2(name, arg1, arg2)
+#endif
@@ -18,9 +18,21 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+
 #include <sched.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <xmmintrin.h>
 
+#include "logging/common.h"
+
 namespace fs = ghc::filesystem;
 
 using namespace std::literals::string_view_literals;
@@ -51,22 +63,234 @@ fs::path get_temporary_directory() {
     }
 }
 
-std::optional<int> get_realtime_priority() noexcept {
+std::optional<RealtimeParameters> get_realtime_parameters() noexcept {
+    const int policy = sched_getscheduler(0);
     sched_param current_params{};
-    if (sched_getparam(0, &current_params) == 0 &&
+    if ((policy == SCHED_FIFO || policy == SCHED_RR) &&
+        sched_getparam(0, &current_params) == 0 &&
         current_params.sched_priority > 0) {
-        return current_params.sched_priority;
+        return RealtimeParameters{.policy = policy,
+                                  .priority = current_params.sched_priority};
     } else {
         return std::nullopt;
     }
 }
 
+bool set_realtime_parameters(const RealtimeParameters& parameters) noexcept {
+    sched_param params{.sched_priority = parameters.priority};
+    return sched_setscheduler(0, parameters.policy, &params) == 0;
+}
+
 bool set_realtime_priority(bool sched_fifo, int priority) noexcept {
     sched_param params{.sched_priority = (sched_fifo ? priority : 0)};
     return sched_setscheduler(0, sched_fifo ? SCHED_FIFO : SCHED_OTHER,
                               &params) == 0;
 }
 
+bool set_cpu_affinity(const std::string& cpu_list) noexcept {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    // The list contains comma separated CPU numbers or inclusive
+    // `<start>-<end>` ranges, just like the argument to `taskset(1)`. We'll
+    // reject the entire list if any part of it cannot be parsed so a typo
+    // doesn't silently pin everything to the wrong cores.
+    const char* pos = cpu_list.data();
+    const char* const end = cpu_list.data() + cpu_list.size();
+    while (pos < end) {
+        unsigned int range_start = 0;
+        const auto [start_end, start_error] =
+            std::from_chars(pos, end, range_start);
+        if (start_error != std::errc() || range_start >= CPU_SETSIZE) {
+            return false;
+        }
+
+        unsigned int range_end = range_start;
+        pos = start_end;
+        if (pos < end && *pos == '-') {
+            const auto [end_end, end_error] =
+                std::from_chars(pos + 1, end, range_end);
+            if (end_error != std::errc() || range_end < range_start ||
+                range_end >= CPU_SETSIZE) {
+                return false;
+            }
+
+            pos = end_end;
+        }
+
+        for (unsigned int cpu = range_start; cpu <= range_end; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+
+        if (pos < end) {
+            if (*pos != ',') {
+                return false;
+            }
+
+            pos++;
+        }
+    }
+
+    if (CPU_COUNT(&cpus) == 0) {
+        return false;
+    }
+
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+bool set_numa_node_affinity(unsigned int node) noexcept {
+    // Sysfs lists the node's CPUs in the same `taskset(1)` format
+    // `set_cpu_affinity()` already parses
+    std::ifstream cpulist_file("/sys/devices/system/node/node" +
+                               std::to_string(node) + "/cpulist");
+    std::string cpu_list;
+    if (!cpulist_file.is_open() || !std::getline(cpulist_file, cpu_list)) {
+        return false;
+    }
+
+    return set_cpu_affinity(cpu_list);
+}
+
+std::optional<unsigned int> current_numa_node() noexcept {
+    // glibc only gained a `getcpu()` wrapper fairly recently, so we'll use the
+    // syscall directly
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return std::nullopt;
+    }
+
+    return node;
+}
+
+size_t llc_cluster_count() noexcept {
+    // Every CPU that shares a last level cache reports the same
+    // `shared_cpu_list`, so the number of unique values over all CPUs is the
+    // number of cache clusters. The list for a CPU can be read in one line.
+    std::set<std::string> clusters{};
+    for (unsigned int cpu = 0;; cpu++) {
+        std::ifstream shared_cpus_file(
+            "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+            "/cache/index3/shared_cpu_list");
+        if (!shared_cpus_file.is_open()) {
+            break;
+        }
+
+        std::string shared_cpus;
+        std::getline(shared_cpus_file, shared_cpus);
+        clusters.insert(shared_cpus);
+    }
+
+    // Systems without an L3 cache don't have an `index3` directory at all, in
+    // which case there's nothing meaningful to shard along
+    return std::max<size_t>(clusters.size(), 1);
+}
+
+/**
+ * The absolute sysfs path of the cgroup this process currently belongs to, or
+ * a nullopt when the system doesn't use the unified cgroup v2 hierarchy.
+ */
+static std::optional<std::string> current_cgroup_path() noexcept {
+    // The unified hierarchy's entry looks like `0::/user.slice/.../app.scope`
+    std::ifstream cgroup_file("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(cgroup_file, line)) {
+        if (line.rfind("0::", 0) == 0) {
+            return "/sys/fs/cgroup" + line.substr(3);
+        }
+    }
+
+    return std::nullopt;
+}
+
+/**
+ * Write a value to one of a cgroup's control files, returning whether the
+ * kernel accepted it.
+ */
+static bool write_cgroup_file(const std::string& path,
+                              const std::string& value) noexcept {
+    std::ofstream file(path);
+    file << value;
+    file.flush();
+
+    return file.good();
+}
+
+void apply_process_resource_limits(const std::string& name,
+                                   const std::optional<std::string>& cpus,
+                                   uint32_t cpu_quota_percent,
+                                   uint32_t memory_limit_mb) noexcept {
+    // All plugins in a plugin group share this process, so the first loaded
+    // plugin's limits win
+    static std::once_flag limits_applied;
+    std::call_once(limits_applied, [&]() {
+        bool quota_applied = cpu_quota_percent == 0;
+        bool memory_applied = memory_limit_mb == 0;
+        bool cpus_applied = !cpus;
+
+        // The limits are configured in a new child cgroup next to wherever
+        // the process currently sits in the hierarchy, since sibling
+        // processes shouldn't be affected. This requires the current cgroup
+        // to be delegated to the user: enabling the controllers for the
+        // child fails with EBUSY when the current cgroup also contains other
+        // processes, which is exactly the situation where we wouldn't be
+        // allowed to impose limits anyway.
+        if (const auto cgroup = current_cgroup_path()) {
+            write_cgroup_file(*cgroup + "/cgroup.subtree_control",
+                              "+cpu +memory");
+            // cpuset is often not delegated even when cpu and memory are, so
+            // it's enabled separately to keep one missing controller from
+            // rejecting the entire write
+            write_cgroup_file(*cgroup + "/cgroup.subtree_control", "+cpuset");
+
+            const std::string child = *cgroup + "/yabridge-" + name;
+            mkdir(child.c_str(), 0755);
+
+            // Limits only affect us after the process has been moved into
+            // the child, so failing this move means none of them apply
+            if (write_cgroup_file(child + "/cgroup.procs",
+                                  std::to_string(getpid()))) {
+                if (!quota_applied) {
+                    // cpu.max takes a quota and a period in microseconds
+                    quota_applied = write_cgroup_file(
+                        child + "/cpu.max",
+                        std::to_string(cpu_quota_percent * 1000) + " 100000");
+                }
+                if (!memory_applied) {
+                    memory_applied = write_cgroup_file(
+                        child + "/memory.max",
+                        std::to_string(static_cast<uint64_t>(memory_limit_mb) *
+                                       1024 * 1024));
+                }
+                if (!cpus_applied) {
+                    // cpuset.cpus uses the same list format as taskset(1)
+                    cpus_applied =
+                        write_cgroup_file(child + "/cpuset.cpus", *cpus);
+                }
+            }
+        }
+
+        // The CPU set can always be applied through the scheduler instead.
+        // Since this runs before the worker threads get spawned, they all
+        // inherit the affinity.
+        if (!cpus_applied) {
+            cpus_applied = set_cpu_affinity(*cpus);
+        }
+
+        if (!quota_applied || !memory_applied || !cpus_applied) {
+            std::cerr << "WARNING: Could not apply the configured"
+                      << (!quota_applied ? " CPU quota" : "")
+                      << (!memory_applied ? " memory limit" : "")
+                      << (!cpus_applied ? " CPU set" : "")
+                      << ". This requires a delegated cgroup v2 hierarchy,"
+                      << std::endl;
+            std::cerr << "         for instance by running the group host as "
+                         "a daemon under a systemd user service."
+                      << std::endl;
+        }
+    });
+}
+
 std::optional<rlim_t> get_memlock_limit() noexcept {
     rlimit limits{};
     if (getrlimit(RLIMIT_MEMLOCK, &limits) == 0) {
@@ -94,6 +318,89 @@ bool is_watchdog_timer_disabled() {
     return disable_watchdog_env && disable_watchdog_env == "1"sv;
 }
 
+ThreadRegistry& ThreadRegistry::instance() noexcept {
+    static ThreadRegistry instance{};
+    return instance;
+}
+
+ThreadRegistry::Guard::Guard(uint64_t token) noexcept : token_(token) {}
+
+ThreadRegistry::Guard::~Guard() noexcept {
+    if (is_active_) {
+        ThreadRegistry::instance().unregister_thread(token_);
+    }
+}
+
+ThreadRegistry::Guard::Guard(Guard&& o) noexcept : token_(o.token_) {
+    o.is_active_ = false;
+}
+
+ThreadRegistry::Guard& ThreadRegistry::Guard::operator=(Guard&& o) noexcept {
+    if (is_active_) {
+        ThreadRegistry::instance().unregister_thread(token_);
+    }
+
+    token_ = o.token_;
+    is_active_ = o.is_active_;
+    o.is_active_ = false;
+
+    return *this;
+}
+
+ThreadRegistry::Guard ThreadRegistry::register_thread(
+    const std::string& role,
+    std::optional<size_t> instance_id) noexcept {
+    const std::string name =
+        instance_id ? role + "-" + std::to_string(*instance_id) : role;
+
+    // `pthread_setname_np()` rejects names longer than the kernel's fifteen
+    // character `comm` limit outright instead of truncating them, so we'll do
+    // the truncation ourselves. The registry keeps the full name.
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+    std::lock_guard lock(threads_mutex_);
+    const uint64_t token = next_token_++;
+    threads_.push_back(Entry{.token = token,
+                             .name = name,
+                             // Winelib builds target older glibc versions
+                             // without a `gettid()` wrapper
+                             .tid = static_cast<pid_t>(syscall(SYS_gettid)),
+                             .handle = pthread_self()});
+
+    return Guard(token);
+}
+
+void ThreadRegistry::unregister_thread(uint64_t token) noexcept {
+    std::lock_guard lock(threads_mutex_);
+    threads_.erase(std::find_if(
+        threads_.begin(), threads_.end(),
+        [token](const Entry& entry) { return entry.token == token; }));
+}
+
+void ThreadRegistry::log_threads(Logger& logger) noexcept {
+    std::lock_guard lock(threads_mutex_);
+
+    logger.log("Live threads:");
+    for (const Entry& entry : threads_) {
+        // The handle is guaranteed to still belong to a running thread, see
+        // the note on `Entry::handle`
+        std::string cpu_time = "unknown";
+        clockid_t clock_id;
+        timespec cpu{};
+        if (pthread_getcpuclockid(entry.handle, &clock_id) == 0 &&
+            clock_gettime(clock_id, &cpu) == 0) {
+            cpu_time = std::to_string(static_cast<uint64_t>(cpu.tv_sec) *
+                                          1000 +
+                                      static_cast<uint64_t>(cpu.tv_nsec) /
+                                          1'000'000) +
+                       " ms";
+        }
+
+        logger.log("  tid " + std::to_string(entry.tid) + ": " + entry.name +
+                   ", cpu " + cpu_time);
+    }
+}
+
 size_t strlcpy_buffer(char* dst, const std::string& src, size_t size) {
     if (size == 0) {
         return src.size();
@@ -216,26 +523,8 @@ std::string url_encode_path(std::string path) {
     return escaped;
 }
 
-ScopedFlushToZero::ScopedFlushToZero() noexcept {
-    old_ftz_mode_ = _MM_GET_FLUSH_ZERO_MODE();
-    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
-}
-
-ScopedFlushToZero::~ScopedFlushToZero() noexcept {
-    if (old_ftz_mode_) {
-        _MM_SET_FLUSH_ZERO_MODE(*old_ftz_mode_);
+void ensure_flush_to_zero() noexcept {
+    if (_MM_GET_FLUSH_ZERO_MODE() != _MM_FLUSH_ZERO_ON) {
+        _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
     }
 }
-
-ScopedFlushToZero::ScopedFlushToZero(ScopedFlushToZero&& o) noexcept
-    : old_ftz_mode_(std::move(o.old_ftz_mode_)) {
-    o.old_ftz_mode_.reset();
-}
-
-ScopedFlushToZero& ScopedFlushToZero::operator=(
-    ScopedFlushToZero&& o) noexcept {
-    old_ftz_mode_ = std::move(o.old_ftz_mode_);
-    o.old_ftz_mode_.reset();
-
-    return *this;
-}
@@ -16,13 +16,25 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include <pthread.h>
 #include <sys/resource.h>
+#include <sys/types.h>
 #include <ghc/filesystem.hpp>
 
 #define YABRIDGE_EXPORT __attribute__((visibility("default")))
 
+// Forward declaration for `ThreadRegistry::log_threads()`, since the logging
+// headers include this file
+class Logger;
+
 /**
  * The interval in seconds between synchronizing the Wine plugin host's audio
  * thread scheduling priority with the host's audio thread.
@@ -73,6 +85,25 @@ struct overload : Ts... {
 template <class... Ts>
 overload(Ts...) -> overload<Ts...>;
 
+/**
+ * Get a human readable name for a type at compile time, e.g.
+ * `YaAudioProcessor::Process`. This is sliced out of the compiler's
+ * `__PRETTY_FUNCTION__` output since that's the only way to get at these
+ * names without RTTI or manual registration. Both the GCC and the Clang
+ * formats are handled.
+ */
+template <typename T>
+constexpr std::string_view type_name() noexcept {
+    const std::string_view pretty_function = __PRETTY_FUNCTION__;
+
+    // GCC formats this as `... [with T = Foo; ...]`, and Clang as
+    // `... [T = Foo]`
+    const size_t start = pretty_function.find("T = ") + 4;
+    const size_t end = pretty_function.find_first_of(";]", start);
+
+    return pretty_function.substr(start, end - start);
+}
+
 /**
  * Return the path to the directory for story temporary files. This will be
  * `$XDG_RUNTIME_DIR` if set, and `/tmp` otherwise.
@@ -80,11 +111,45 @@ overload(Ts...) -> overload<Ts...>;
 ghc::filesystem::path get_temporary_directory();
 
 /**
- * Get the current thread's scheduling priority if the thread is using
- * `SCHED_FIFO`. Returns a nullopt of the calling thread is not under realtime
- * scheduling.
+ * The realtime scheduling parameters of a thread. Since both the native plugin
+ * and the Wine plugin host run under the same kernel we can send the raw
+ * `sched.h` policy constants over the socket as is.
+ */
+struct RealtimeParameters {
+    /**
+     * The scheduling policy, either `SCHED_FIFO` or `SCHED_RR`.
+     */
+    int32_t policy;
+
+    /**
+     * The realtime priority within that policy. This will always be positive.
+     */
+    int32_t priority;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value4b(policy);
+        s.value4b(priority);
+    }
+};
+
+/**
+ * Get the current thread's realtime scheduling policy and priority. Returns a
+ * nullopt if the calling thread is not under `SCHED_FIFO` or `SCHED_RR`
+ * scheduling. We use this to mirror the scheduling of the host's audio thread
+ * on the Wine plugin host's audio threads, since some hosts use round robin
+ * scheduling instead of FIFO scheduling.
+ */
+std::optional<RealtimeParameters> get_realtime_parameters() noexcept;
+
+/**
+ * Apply realtime scheduling parameters fetched on the host's audio thread with
+ * `get_realtime_parameters()` to the calling thread.
+ *
+ * @return Whether the operation was successful or not. This will fail if the
+ *   user does not have the privileges to set realtime priorities.
  */
-std::optional<int> get_realtime_priority() noexcept;
+bool set_realtime_parameters(const RealtimeParameters& parameters) noexcept;
 
 /**
  * Set the scheduling policy to `SCHED_FIFO` with priority 5 for this process.
@@ -95,8 +160,9 @@ std::optional<int> get_realtime_priority() noexcept;
  *   to `SCHED_FIFO`. Otherwise reset it back to `SCHWED_OTHER`.
  * @param priority The scheduling priority to use. The exact value usually
  *   doesn't really matter unless there are a lot of other active `SCHED_FIFO`
- *   background tasks. We'll use 5 as a default, but we'll periodically copy the
- *   priority set by the host on the audio threads.
+ *   background tasks. We'll use 5 as a default, but on the audio threads we'll
+ *   periodically copy the host's scheduling parameters with
+ *   `set_realtime_parameters()`.
  *
  * @return Whether the operation was successful or not. This will fail if the
  *   user does not have the privileges to set realtime priorities.
@@ -109,6 +175,76 @@ std::optional<int> get_realtime_priority() noexcept;
  */
 bool set_realtime_priority(bool sched_fifo, int priority = 5) noexcept;
 
+/**
+ * Pin the calling thread to the set of CPUs described by a `taskset(1)`-style
+ * list, e.g. `2,4-7` for CPUs 2 and 4 through 7. Used to implement the
+ * `audio_affinity` and `main_affinity` options from `yabridge.toml`.
+ *
+ * @return Whether the operation was successful or not. This will fail if the
+ *   list could not be parsed, if it doesn't contain any usable CPUs, or if the
+ *   `sched_setaffinity()` call itself failed.
+ */
+bool set_cpu_affinity(const std::string& cpu_list) noexcept;
+
+/**
+ * Pin the calling thread to the CPUs belonging to a NUMA node. Used to
+ * implement the `numa_node` option from `yabridge.toml`. The node's CPU list
+ * is read from sysfs, which conveniently uses the same format
+ * `set_cpu_affinity()` parses. Threads spawned afterwards inherit the
+ * affinity, so doing this early in a process pins the entire process to the
+ * node.
+ *
+ * @return Whether the operation was successful or not. This will fail if the
+ *   node does not exist or if the CPUs could not be pinned.
+ */
+bool set_numa_node_affinity(unsigned int node) noexcept;
+
+/**
+ * The NUMA node the calling thread is currently running on, or a nullopt if
+ * this could not be determined. Used to resolve the `numa_node = "auto"`
+ * option to a concrete node on the native plugin side.
+ */
+std::optional<unsigned int> current_numa_node() noexcept;
+
+/**
+ * The number of last level cache clusters on this system, so the number of
+ * CPU groups that share an L3 cache. On AMD processors these are the CCXs, on
+ * most Intel processors there's one cluster per physical package. Used to
+ * resolve the `group_shards = "auto"` option to a concrete shard count, so a
+ * large plugin group can be split into one host process per cache cluster.
+ * Returns 1 when the topology can't be read from sysfs.
+ */
+size_t llc_cluster_count() noexcept;
+
+/**
+ * Apply process wide resource limits to this Wine plugin host. Used to
+ * implement the `group_cpus`, `group_cpu_quota` and `group_memory_limit`
+ * options from `yabridge.toml`. When the cgroup v2 hierarchy is delegated to
+ * the user (for instance when the group host runs as a daemon under a systemd
+ * user service), this creates a `yabridge-<name>` child cgroup next to the
+ * process's current position in the hierarchy, configures the limits there,
+ * and moves the process into it. Without delegation the CPU set falls back to
+ * `sched_setaffinity()`, which threads spawned afterwards inherit, and a
+ * warning is printed for the limits that have no such fallback. Only the
+ * first call in a process has any effect, since all plugins in a plugin group
+ * share one process.
+ *
+ * @param name The scope name used for the cgroup directory, normally the
+ *   plugin group's name.
+ * @param cpus The set of CPUs the process may run on, in the same
+ *   `taskset(1)` list format as `set_cpu_affinity()` takes. Unconstrained
+ *   when a nullopt.
+ * @param cpu_quota_percent The CPU time budget as a percentage of a single
+ *   CPU, so 150 allows one and a half cores worth of CPU time. Zero leaves
+ *   the quota unlimited.
+ * @param memory_limit_mb The memory limit in MiB. Zero leaves memory use
+ *   unlimited.
+ */
+void apply_process_resource_limits(const std::string& name,
+                                   const std::optional<std::string>& cpus,
+                                   uint32_t cpu_quota_percent,
+                                   uint32_t memory_limit_mb) noexcept;
+
 /**
  * Get the (soft) `RLIMIT_MEMLOCK` resource limit. If this is set to some low
  * value, then we'll print a warning during initialization because mapping
@@ -140,6 +276,129 @@ std::optional<rlim_t> get_rttime_limit() noexcept;
  */
 bool is_watchdog_timer_disabled();
 
+/**
+ * The process wide registry of the threads yabridge spawns. A single bridged
+ * instance runs many threads (ad-hoc socket handlers, `Win32Thread` workers,
+ * audio listeners), and in a group host process running dozens of plugins
+ * those all look alike in a profiler. Threads register themselves here with a
+ * role and, when they work for a specific plugin instance, that instance's
+ * identifier. Registration applies the combined name to the kernel with
+ * `pthread_setname_np()`, truncated to the fifteen character `comm` limit so
+ * `perf` and `/proc/<pid>/task/<tid>/comm` pick it up, while the registry
+ * keeps the untruncated name together with the Linux thread ID.
+ * `log_threads()` dumps every live thread along with its CPU time, read
+ * through the thread's `pthread_getcpuclockid()` clock.
+ */
+class ThreadRegistry {
+   public:
+    /**
+     * The registry shared by every thread in this process.
+     */
+    static ThreadRegistry& instance() noexcept;
+
+    ThreadRegistry(const ThreadRegistry&) = delete;
+    ThreadRegistry& operator=(const ThreadRegistry&) = delete;
+
+    ThreadRegistry(ThreadRegistry&&) = delete;
+    ThreadRegistry& operator=(ThreadRegistry&&) = delete;
+
+    /**
+     * The RAII guard returned by `register_thread()`. The calling thread
+     * stays listed in the registry for as long as this guard is alive, so it
+     * should be created at the top of the thread's entry point and kept on
+     * the stack for the thread's entire run. That also guarantees the
+     * registered `pthread_t` handle stays valid for every listed thread.
+     */
+    class Guard {
+       public:
+        Guard(uint64_t token) noexcept;
+        ~Guard() noexcept;
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        Guard(Guard&& o) noexcept;
+        Guard& operator=(Guard&& o) noexcept;
+
+       private:
+        /**
+         * Used to facilitate moves.
+         */
+        bool is_active_ = true;
+
+        /**
+         * Identifies this registration within the registry, since the same
+         * role can be registered by multiple threads.
+         */
+        uint64_t token_;
+    };
+
+    /**
+     * Register the calling thread and set its kernel-visible thread name.
+     * This replaces direct `pthread_setname_np()` calls in the thread entry
+     * points.
+     *
+     * @param role A short name for what the thread does, e.g. `audio` or
+     *   `group-stdio`.
+     * @param instance_id The plugin instance the thread belongs to, if it
+     *   works for a single instance. This gets appended to the role, the
+     *   same way the per-instance audio threads were already named.
+     */
+    Guard register_thread(
+        const std::string& role,
+        std::optional<size_t> instance_id = std::nullopt) noexcept;
+
+    /**
+     * Write a list of all currently registered threads to the log, including
+     * each thread's name, Linux thread ID, and consumed CPU time. Called
+     * through `Sockets::log_telemetry()` when the verbosity is set to
+     * `all_events`, next to the other telemetry.
+     */
+    void log_threads(Logger& logger) noexcept;
+
+   private:
+    ThreadRegistry() noexcept = default;
+
+    /**
+     * Called from `Guard`'s destructor.
+     */
+    void unregister_thread(uint64_t token) noexcept;
+
+    /**
+     * A live, registered thread.
+     */
+    struct Entry {
+        uint64_t token;
+
+        /**
+         * The full name, without the truncation `pthread_setname_np()`
+         * imposes on the kernel-visible version.
+         */
+        std::string name;
+
+        /**
+         * The Linux thread ID, for correlating the dump with `perf` output
+         * and `/proc/<pid>/task/`.
+         */
+        pid_t tid;
+
+        /**
+         * Used to read the thread's CPU clock in `log_threads()`. Only valid
+         * while the entry is registered, which the guard's placement inside
+         * the thread's entry point guarantees.
+         */
+        pthread_t handle;
+    };
+
+    std::vector<Entry> threads_;
+    std::mutex threads_mutex_;
+
+    /**
+     * The token handed to the next registration.
+     */
+    uint64_t next_token_ = 1;
+};
+
 /**
  * Escape XML entities within a string. Used inside of desktop notifications.
  */
@@ -178,30 +437,16 @@ size_t strlcpy_buffer(char dst[N], const std::string& src) {
 size_t strlcpy_buffer(char* dst, const std::string& src, size_t size);
 
 /**
- * A RAII wrapper that will temporarily enable the FTZ flag so that denormals
- * are automatically flushed to zero, returning to whatever the flag was
- * previously when it drops out of scope.
+ * Enable the FTZ flag for the calling thread if it isn't enabled already, so
+ * denormals are automatically flushed to zero. This replaces the old RAII
+ * wrapper that saved and restored the flag around every processing call:
+ * writing MXCSR serializes the pipeline, and the threads that run plugin
+ * audio code want FTZ enabled for their entire lifetime anyway. Reading the
+ * register is cheap, so calling this at the start of every processing call
+ * only costs a write when something (usually the plugin itself) changed the
+ * mode in between.
  */
-class ScopedFlushToZero {
-   public:
-    ScopedFlushToZero() noexcept;
-    ~ScopedFlushToZero() noexcept;
-
-    ScopedFlushToZero(const ScopedFlushToZero&) = delete;
-    ScopedFlushToZero& operator=(const ScopedFlushToZero&) = delete;
-
-    ScopedFlushToZero(ScopedFlushToZero&&) noexcept;
-    ScopedFlushToZero& operator=(ScopedFlushToZero&&) noexcept;
-
-   private:
-    /**
-     * The previous FTZ mode. When we use this on the Wine side, this should
-     * always be disabled. But, we'll make sure to do it correctly anyhow so we
-     * don't accidentally end up disabling FTZ somewhere where it should be
-     * enabled.
-     */
-    std::optional<unsigned int> old_ftz_mode_;
-};
+void ensure_flush_to_zero() noexcept;
 
 /**
  * A helper to temporarily cache a value. Calling `ScopedValueCache::set(x)`
@@ -210,7 +455,7 @@ class ScopedFlushToZero {
  * be returned.
  *
  * @note This class provides no thread safety guarantees. If thread safety is
- *   needed, then you should use mutexes around the getter and the setter.
+ *   needed, then you should use `AtomicValueCache` instead.
  */
 template <typename T>
 class ScopedValueCache {
@@ -292,7 +537,7 @@ class ScopedValueCache {
  *   the cache will this be very imprecise.
  *
  * @note This class provides no thread safety guarantees. If thread safety is
- *   needed, then you should use mutexes around the getter and the setter.
+ *   needed, then you should use `AtomicTimedValueCache` instead.
  */
 template <typename T>
 class TimedValueCache {
@@ -334,3 +579,198 @@ class TimedValueCache {
     T value_;
     time_t valid_until_ = 0;
 };
+
+/**
+ * A single value protected by a sequence lock, the building block for the
+ * thread safe value caches below. Readers copy the value out and retry if a
+ * write raced with the copy, and writers serialize among themselves through
+ * the sequence word, so neither side ever touches a mutex. Only usable for
+ * trivially copyable types, since a reader's copy can race with a concurrent
+ * write and thus has to be a plain byte copy that may be thrown away.
+ */
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+class SeqlockValue {
+   public:
+    /**
+     * Return a copy of the stored value. Lock-free, this only retries while a
+     * concurrent `store()` is copying the value in.
+     */
+    T load() const noexcept {
+        T result;
+        while (true) {
+            const uint32_t sequence_before =
+                sequence_.load(std::memory_order_acquire);
+            if ((sequence_before & 1) != 0) {
+                // A write is in progress, which only lasts for the duration
+                // of a copy
+                continue;
+            }
+
+            result = value_;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == sequence_before) {
+                return result;
+            }
+        }
+    }
+
+    /**
+     * Replace the stored value. Concurrent writers serialize through the
+     * sequence word, with the odd sequence number doubling as a tiny spinlock
+     * held for the duration of a copy.
+     */
+    void store(const T& new_value) noexcept {
+        uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        while ((sequence & 1) != 0 ||
+               !sequence_.compare_exchange_weak(sequence, sequence + 1,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+            if ((sequence & 1) != 0) {
+                sequence = sequence_.load(std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+        value_ = new_value;
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+   private:
+    T value_{};
+    std::atomic<uint32_t> sequence_{0};
+};
+
+/**
+ * A thread safe alternative to `ScopedValueCache`, for values that get cached
+ * on one thread and read from others, like the transport information
+ * prefetched at the start of an audio processing cycle that the plugin may
+ * then ask for from any of its own threads. The guard based API is the same,
+ * but `get()` returns a copy instead of a pointer since the stored value can
+ * be overwritten concurrently. Backed by the sequence lock above, so readers
+ * never block the writer and vice versa. Only usable for trivially copyable
+ * types.
+ */
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+class AtomicValueCache {
+   public:
+    AtomicValueCache() noexcept {}
+
+    AtomicValueCache(const AtomicValueCache&) = delete;
+    AtomicValueCache& operator=(const AtomicValueCache&) = delete;
+
+    // Moving is impossible because of the guard
+    AtomicValueCache(AtomicValueCache&&) = delete;
+    AtomicValueCache& operator=(AtomicValueCache&&) = delete;
+
+    /**
+     * Return a copy of the cached value, if we're currently caching a value.
+     * Will return a nullopt when this is not the case.
+     */
+    std::optional<T> get() const noexcept { return value_.load(); }
+
+    /**
+     * A guard that will reset the cached value on the `AtomicValueCache` when
+     * it drops out of scope.
+     */
+    class Guard {
+       public:
+        Guard(SeqlockValue<std::optional<T>>& cached_value) noexcept
+            : cached_value_(&cached_value) {}
+        ~Guard() noexcept {
+            if (cached_value_) {
+                cached_value_->store(std::nullopt);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        Guard(Guard&& o) noexcept : cached_value_(o.cached_value_) {
+            o.cached_value_ = nullptr;
+        }
+        Guard& operator=(Guard&& o) noexcept {
+            cached_value_ = o.cached_value_;
+            o.cached_value_ = nullptr;
+
+            return *this;
+        }
+
+       private:
+        SeqlockValue<std::optional<T>>* cached_value_;
+    };
+
+    /**
+     * Temporarily cache `new_value`. This value will be cached as long as the
+     * returned guard is in scope. This guard should not outlive the
+     * `AtomicValueCache` object.
+     *
+     * @param new_value The cached value to store.
+     */
+    Guard set(const T& new_value) noexcept {
+        value_.store(std::optional(new_value));
+
+        return Guard(value_);
+    }
+
+   private:
+    SeqlockValue<std::optional<T>> value_;
+};
+
+/**
+ * A thread safe alternative to `TimedValueCache`, with the same imprecise
+ * `time()` based lifetimes. Extending a value's lifetime rewrites the whole
+ * entry through the sequence lock, which is fine for the rate these caches
+ * get hit at. Only usable for trivially copyable types.
+ */
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+class AtomicTimedValueCache {
+   public:
+    /**
+     * Return a copy of the cached value, if we're currently caching a value.
+     * Will return a nullopt when this is not the case.
+     */
+    std::optional<T> get() const noexcept {
+        const Entry entry = entry_.load();
+        return time(nullptr) <= entry.valid_until ? std::optional(entry.value)
+                                                  : std::nullopt;
+    }
+
+    /**
+     * The same as `get()`, except that the lifetime for the value will be
+     * reset to `lifetime_seconds` seconds from now, if the value was still
+     * active.
+     */
+    std::optional<T> get_and_keep_alive(
+        unsigned int lifetime_seconds) noexcept {
+        const time_t now = time(nullptr);
+        const Entry entry = entry_.load();
+        if (now > entry.valid_until) {
+            return std::nullopt;
+        }
+
+        // A concurrent `set()` can race with this and win, which is fine:
+        // either deadline keeps the value alive
+        entry_.store(Entry{entry.value, now + lifetime_seconds});
+
+        return entry.value;
+    }
+
+    /**
+     * Set the cached value for `lifetime_seconds` seconds.
+     */
+    void set(const T& value, unsigned int lifetime_seconds) noexcept {
+        entry_.store(Entry{value, time(nullptr) + lifetime_seconds});
+    }
+
+   private:
+    struct Entry {
+        T value{};
+        time_t valid_until = 0;
+    };
+
+    SeqlockValue<Entry> entry_;
+};
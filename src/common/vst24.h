@@ -63,6 +63,14 @@
  */
 [[maybe_unused]] constexpr int effString2Parameter = 27;
 
+/**
+ * Used by hosts to toggle a plugin's soft bypass, with the value argument set
+ * to 1 to engage the bypass and 0 to disengage it again. Plugins advertise
+ * support for this through the `effCanDo` "bypass" query. Found on the same
+ * list as above.
+ */
+[[maybe_unused]] constexpr int effSetBypass = 44;
+
 /**
  * Used by hosts to query the length of reverb tails (equivalent to
  * `IAudioProcessor::getTailSamples`). Found on the same list as above.
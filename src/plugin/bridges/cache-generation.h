@@ -0,0 +1,105 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * The shared invalidation protocol used by the native side's proxy caches.
+ * Every per-instance bridge or proxy object owns one of these counters, and
+ * bumps it whenever the plugin announces that something about it has changed:
+ * `restartComponent()` for VST3, `audioMasterIOChanged()` and
+ * `audioMasterUpdateDisplay()` for VST2, and the various rescan and changed
+ * callbacks for CLAP. Caches wrapped in `GenerationTagged` remember the
+ * generation their contents were filled at and discard them when the counter
+ * has moved on, so a stale read is structurally impossible: instead of every
+ * cache needing its own invalidation plumbing from every notification site,
+ * validation is a single atomic load at the point of use.
+ *
+ * Invalidations with a host-initiated cause (loading a state, writing a
+ * parameter, changing the processing setup) stay targeted at the specific
+ * caches they affect through `GenerationTagged::clear()`, since routing those
+ * through the shared counter would needlessly drop every other cache as well.
+ */
+class CacheGeneration {
+   public:
+    /**
+     * The current generation, to compare a cache's tag against. A single
+     * acquire load, cheap enough for per-call validation.
+     */
+    uint64_t current() const noexcept {
+        return generation_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Move to a new generation, invalidating every cache tagged with a
+     * previous one. Called whenever a plugin-initiated change notification
+     * passes through the native side.
+     */
+    void bump() noexcept {
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+
+   private:
+    /**
+     * Starts at 1 so a default constructed tag of 0 never matches and empty
+     * caches begin invalid.
+     */
+    std::atomic<uint64_t> generation_ = 1;
+};
+
+/**
+ * A cache container tagged with the generation its contents were filled at.
+ * All access goes through `checked()`, which empties the container first when
+ * the instance's `CacheGeneration` has moved past the tag. The wrapper
+ * deliberately has no other accessors, so there's no way to read an entry
+ * without the generation having been validated.
+ */
+template <typename T>
+class GenerationTagged {
+   public:
+    /**
+     * Validate the tag against the current generation and return the
+     * container, emptied first if its contents predate the generation. Must
+     * be called with the mutex guarding this cache held, like any other
+     * access would be.
+     */
+    T& checked(const CacheGeneration& generation) {
+        const uint64_t current = generation.current();
+        if (generation_ != current) {
+            value_ = T{};
+            generation_ = current;
+        }
+
+        return value_;
+    }
+
+    /**
+     * Discard the contents because of a host-initiated change that only
+     * affects this cache. The same locking requirement as `checked()`
+     * applies.
+     */
+    void clear() {
+        value_ = T{};
+        generation_ = 0;
+    }
+
+   private:
+    uint64_t generation_ = 0;
+    T value_;
+};
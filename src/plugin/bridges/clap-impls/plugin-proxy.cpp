@@ -16,6 +16,8 @@
 
 #include "plugin-proxy.h"
 
+#include <chrono>
+
 #include "../clap.h"
 
 ClapHostExtensions::ClapHostExtensions(const clap_host& host) noexcept
@@ -146,9 +148,43 @@ clap_plugin_proxy::clap_plugin_proxy(ClapPluginBridge& bridge,
       // getting that many of them
       pending_callbacks_(128) {}
 
-void clap_plugin_proxy::clear_param_info_cache() {
-    std::lock_guard lock(param_info_cache_mutex_);
-    param_info_cache_.clear();
+void clap_plugin_proxy::invalidate_caches() {
+    // The tagged caches empty themselves on their next access, so no locks
+    // need to be taken here
+    cache_generation_.bump();
+}
+
+void clap_plugin_proxy::launch_state_transition(
+    fu2::unique_function<void()> transition) {
+    // Transitions have to stay ordered with respect to each other, since
+    // concurrent requests over the sockets could otherwise be handled out of
+    // order on the Wine side
+    wait_for_state_transition();
+
+    state_transition_in_flight_.store(true, std::memory_order_release);
+    state_transition_thread_ =
+        std::jthread([this, transition = std::move(transition)]() mutable {
+            transition();
+
+            {
+                std::lock_guard lock(state_transition_mutex_);
+                state_transition_in_flight_.store(false,
+                                                  std::memory_order_release);
+            }
+            state_transition_cv_.notify_all();
+        });
+}
+
+void clap_plugin_proxy::wait_for_state_transition() noexcept {
+    if (!state_transition_in_flight_.load(std::memory_order_acquire))
+        [[likely]] {
+        return;
+    }
+
+    std::unique_lock lock(state_transition_mutex_);
+    state_transition_cv_.wait(lock, [&]() {
+        return !state_transition_in_flight_.load(std::memory_order_acquire);
+    });
 }
 
 bool CLAP_ABI clap_plugin_proxy::plugin_init(const struct clap_plugin* plugin) {
@@ -178,7 +214,12 @@ bool CLAP_ABI clap_plugin_proxy::plugin_init(const struct clap_plugin* plugin) {
 void CLAP_ABI
 clap_plugin_proxy::plugin_destroy(const struct clap_plugin* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
+
+    // With the `async_state_transitions` option enabled a processing state
+    // transition may still be in flight, and the destruction request has to
+    // stay ordered behind it
+    self->wait_for_state_transition();
 
     // This will clean everything related to this instance up on the Wine plugin
     // host side
@@ -198,6 +239,13 @@ bool CLAP_ABI clap_plugin_proxy::plugin_activate(
     assert(plugin && plugin->plugin_data);
     auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
+    // Used to derive the audio processing deadline in `plugin_process()`
+    self->last_sample_rate_.store(sample_rate, std::memory_order_relaxed);
+
+    // Activation has to stay ordered behind a pending processing state
+    // transition, see the `async_state_transitions` option
+    self->wait_for_state_transition();
+
     // NOTE: Plugins may perform latency change callbacks during this function,
     //       so we'll allow mutual recursion here just in case
     const clap::plugin::ActivateResponse response =
@@ -217,6 +265,13 @@ bool CLAP_ABI clap_plugin_proxy::plugin_activate(
             self->process_buffers_->resize(
                 *response.updated_audio_buffers_config);
         }
+
+        // The Wine side has already initialized the output event ring's
+        // positions, so we just attach our own view to it. This needs to
+        // happen again after a resize since the mapping may have moved.
+        self->output_event_ring_.attach(
+            self->process_buffers_->event_area_ptr(0),
+            clap::events::output_event_ring_capacity, false);
     }
 
     return response.result;
@@ -225,7 +280,12 @@ bool CLAP_ABI clap_plugin_proxy::plugin_activate(
 void CLAP_ABI
 clap_plugin_proxy::plugin_deactivate(const struct clap_plugin* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
+
+    // The host will have called `stop_processing()` before this, but with
+    // the `async_state_transitions` option enabled that transition may still
+    // be in flight
+    self->wait_for_state_transition();
 
     self->bridge_.send_mutually_recursive_main_thread_message(
         clap::plugin::Deactivate{.instance_id = self->instance_id()});
@@ -234,7 +294,29 @@ clap_plugin_proxy::plugin_deactivate(const struct clap_plugin* plugin) {
 bool CLAP_ABI
 clap_plugin_proxy::plugin_start_processing(const struct clap_plugin* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
+
+    // With the `async_state_transitions` option enabled the round trip
+    // happens on a background thread while the host's audio thread continues
+    // immediately, and the next `plugin_process()` call waits for it to
+    // finish. Hosts toggle the processing state of every instance on a track
+    // when enabling or disabling it, and doing all of those round trips
+    // sequentially on the audio thread causes audible hiccups. The downside
+    // is that the host always sees the transition succeed, so an actual
+    // failure can only be logged after the fact.
+    if (self->bridge_.config_.async_state_transitions) {
+        self->launch_state_transition([self]() {
+            if (!self->bridge_.send_audio_thread_message(
+                    clap::plugin::StartProcessing{
+                        .instance_id = self->instance_id()})) {
+                self->bridge_.logger_.log(
+                    "WARNING: The plugin returned an error from an "
+                    "asynchronous 'clap_plugin::start_processing()' call");
+            }
+        });
+
+        return true;
+    }
 
     return self->bridge_.send_audio_thread_message(
         clap::plugin::StartProcessing{.instance_id = self->instance_id()});
@@ -243,7 +325,18 @@ clap_plugin_proxy::plugin_start_processing(const struct clap_plugin* plugin) {
 void CLAP_ABI
 clap_plugin_proxy::plugin_stop_processing(const struct clap_plugin* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
+
+    // See `plugin_start_processing()` above
+    if (self->bridge_.config_.async_state_transitions) {
+        self->launch_state_transition([self]() {
+            self->bridge_.send_audio_thread_message(
+                clap::plugin::StopProcessing{
+                    .instance_id = self->instance_id()});
+        });
+
+        return;
+    }
 
     self->bridge_.send_audio_thread_message(
         clap::plugin::StopProcessing{.instance_id = self->instance_id()});
@@ -252,7 +345,11 @@ clap_plugin_proxy::plugin_stop_processing(const struct clap_plugin* plugin) {
 void CLAP_ABI
 clap_plugin_proxy::plugin_reset(const struct clap_plugin* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
+
+    // Resets have to stay ordered behind a pending processing state
+    // transition, see the `async_state_transitions` option
+    self->wait_for_state_transition();
 
     self->bridge_.send_audio_thread_message(
         clap::plugin::Reset{.instance_id = self->instance_id()});
@@ -264,13 +361,27 @@ clap_plugin_proxy::plugin_process(const struct clap_plugin* plugin,
     assert(plugin && plugin->plugin_data && process);
     auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    // We'll synchronize the scheduling priority of the audio thread on the Wine
-    // plugin host with that of the host's audio thread every once in a while
-    std::optional<int> new_realtime_priority = std::nullopt;
+    startup_trace_first_audio();
+
+    // With the `async_state_transitions` option enabled a processing state
+    // transition may still be in flight, and processing can only continue
+    // once it has finished. This is a single atomic load when there's no
+    // transition pending.
+    self->wait_for_state_transition();
+
+    // Timing brackets for the stats and deadline bookkeeping at the end of
+    // this function, see `PluginBridge::record_audio_processing_call()` for
+    // the phase breakdown they feed
+    const auto process_start = std::chrono::steady_clock::now();
+
+    // We'll synchronize the scheduling parameters of the audio thread on the
+    // Wine plugin host with those of the host's audio thread every once in a
+    // while
+    std::optional<RealtimeParameters> new_realtime_parameters = std::nullopt;
     time_t now = time(nullptr);
     if (now > self->last_audio_thread_priority_synchronization_ +
                   audio_thread_priority_synchronization_interval) {
-        new_realtime_priority = get_realtime_priority();
+        new_realtime_parameters = get_realtime_parameters();
         self->last_audio_thread_priority_synchronization_ = now;
     }
 
@@ -282,7 +393,7 @@ clap_plugin_proxy::plugin_process(const struct clap_plugin* plugin,
     self->process_request_.instance_id = self->instance_id();
     self->process_request_.process.repopulate(*process,
                                               *self->process_buffers_);
-    self->process_request_.new_realtime_priority = new_realtime_priority;
+    self->process_request_.new_realtime_parameters = new_realtime_parameters;
 
     // HACK: This is a bit ugly. This `clap::process::Process::Response` object
     //       actually contains pointers to the corresponding `YaProcessData`
@@ -302,16 +413,26 @@ clap_plugin_proxy::plugin_process(const struct clap_plugin* plugin,
 
     // We'll also receive the response into an existing object so we can also
     // avoid heap allocations there
+    const auto copy_in_end = std::chrono::steady_clock::now();
     self->bridge_.receive_audio_thread_message_into(
         MessageReference<clap::plugin::Process>(self->process_request_),
         self->process_response_);
+    const auto round_trip_end = std::chrono::steady_clock::now();
 
     // At this point the shared audio buffers should contain the output audio,
     // so we'll write that back to the host along with any metadata (which in
     // practice are only the silence flags), as well as any output parameter
     // changes and events
-    self->process_request_.process.write_back_outputs(*process,
-                                                      *self->process_buffers_);
+    self->process_request_.process.write_back_outputs(
+        *process, *self->process_buffers_, &self->output_event_ring_);
+
+    self->bridge_.record_audio_processing_call(
+        self->instance_id(),
+        self->last_sample_rate_.load(std::memory_order_relaxed),
+        process->frames_count,
+        process->in_events ? process->in_events->size(process->in_events) : 0,
+        process_start, copy_in_end - process_start,
+        round_trip_end - copy_in_end);
 
     return self->process_response_.result;
 }
@@ -375,17 +496,34 @@ clap_plugin_proxy::plugin_on_main_thread(const struct clap_plugin* plugin) {
     while (self->pending_callbacks_.try_pop(callback)) {
         callback();
     }
+
+    // Parameter flushes are deferred and batched so a burst of
+    // `clap_plugin_params::flush()` calls only crosses the bridge once
+    self->flush_pending_parameter_events();
 }
 
 uint32_t CLAP_ABI
 clap_plugin_proxy::ext_audio_ports_count(const clap_plugin_t* plugin,
                                          bool is_input) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    return self->bridge_.send_main_thread_message(
-        clap::ext::audio_ports::plugin::Count{
-            .instance_id = self->instance_id(), .is_input = is_input});
+    // The entire port layout is queried in a batch and then cached, since
+    // hosts tend to re-query it around every activation and these queries are
+    // on the transport start critical path. This cache is invalidated when
+    // the plugin asks the host to rescan its audio ports.
+    self->maybe_query_audio_ports();
+
+    std::lock_guard lock(self->audio_ports_cache_mutex_);
+    const auto& cache =
+        self->audio_ports_cache_.checked(self->cache_generation_);
+    if (!cache) {
+        // A rescan may have raced with the query above
+        return 0;
+    }
+
+    const auto& ports = is_input ? cache->inputs : cache->outputs;
+    return ports.size();
 }
 
 bool CLAP_ABI
@@ -394,17 +532,25 @@ clap_plugin_proxy::ext_audio_ports_get(const clap_plugin_t* plugin,
                                        bool is_input,
                                        clap_audio_port_info_t* info) {
     assert(plugin && plugin->plugin_data && info);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    const clap::ext::audio_ports::plugin::GetResponse response =
-        self->bridge_.send_main_thread_message(
-            clap::ext::audio_ports::plugin::Get{
-                .instance_id = self->instance_id(),
-                .index = index,
-                .is_input = is_input});
-    if (response.result) {
-        response.result->reconstruct(*info);
+    // See above
+    self->maybe_query_audio_ports();
+
+    std::lock_guard lock(self->audio_ports_cache_mutex_);
+    const auto& cache =
+        self->audio_ports_cache_.checked(self->cache_generation_);
+    if (!cache) {
+        return false;
+    }
+
+    const auto& ports = is_input ? cache->inputs : cache->outputs;
+    if (index >= ports.size()) {
+        return false;
+    }
 
+    if (const auto& port_info = ports[index]) {
+        port_info->reconstruct(*info);
         return true;
     } else {
         return false;
@@ -651,10 +797,28 @@ bool CLAP_ABI clap_plugin_proxy::ext_gui_hide(const clap_plugin_t* plugin) {
 uint32_t CLAP_ABI
 clap_plugin_proxy::ext_latency_get(const clap_plugin_t* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    return self->bridge_.send_main_thread_message(
+    // Some hosts re-query the latency every processing cycle while plugin
+    // delay compensation is active. The extension comes with a dedicated
+    // change notification, so the value can be served locally until the
+    // plugin calls `clap_host_latency::changed()`.
+    {
+        std::lock_guard lock(self->latency_cache_mutex_);
+        const auto& cache =
+            self->latency_cache_.checked(self->cache_generation_);
+        if (cache) {
+            return *cache;
+        }
+    }
+
+    const uint32_t latency = self->bridge_.send_main_thread_message(
         clap::ext::latency::plugin::Get{.instance_id = self->instance_id()});
+
+    std::lock_guard lock(self->latency_cache_mutex_);
+    self->latency_cache_.checked(self->cache_generation_) = latency;
+
+    return latency;
 }
 
 uint32_t CLAP_ABI
@@ -691,11 +855,20 @@ uint32_t CLAP_ABI
 clap_plugin_proxy::ext_note_ports_count(const clap_plugin_t* plugin,
                                         bool is_input) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    return self->bridge_.send_main_thread_message(
-        clap::ext::note_ports::plugin::Count{.instance_id = self->instance_id(),
-                                             .is_input = is_input});
+    // These are batched and cached exactly like the audio ports above
+    self->maybe_query_note_ports();
+
+    std::lock_guard lock(self->note_ports_cache_mutex_);
+    const auto& cache =
+        self->note_ports_cache_.checked(self->cache_generation_);
+    if (!cache) {
+        return 0;
+    }
+
+    const auto& ports = is_input ? cache->inputs : cache->outputs;
+    return ports.size();
 }
 
 bool CLAP_ABI
@@ -704,17 +877,25 @@ clap_plugin_proxy::ext_note_ports_get(const clap_plugin_t* plugin,
                                       bool is_input,
                                       clap_note_port_info_t* info) {
     assert(plugin && plugin->plugin_data && info);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    const clap::ext::note_ports::plugin::GetResponse response =
-        self->bridge_.send_main_thread_message(
-            clap::ext::note_ports::plugin::Get{
-                .instance_id = self->instance_id(),
-                .index = index,
-                .is_input = is_input});
-    if (response.result) {
-        response.result->reconstruct(*info);
+    // See above
+    self->maybe_query_note_ports();
 
+    std::lock_guard lock(self->note_ports_cache_mutex_);
+    const auto& cache =
+        self->note_ports_cache_.checked(self->cache_generation_);
+    if (!cache) {
+        return false;
+    }
+
+    const auto& ports = is_input ? cache->inputs : cache->outputs;
+    if (index >= ports.size()) {
+        return false;
+    }
+
+    if (const auto& port_info = ports[index]) {
+        port_info->reconstruct(*info);
         return true;
     } else {
         return false;
@@ -730,11 +911,11 @@ clap_plugin_proxy::ext_params_count(const clap_plugin_t* plugin) {
     // cached. This was needed in the VST3 bridge to work around a bug in
     // Kontakt (see the similarly named function there for more information),
     // and the CAP bridge does the same thing for consistency's sake. This cache
-    // is cleared when the plugin asks the host to rescan its parameters.
+    // is invalidated when the plugin asks the host to rescan its parameters.
     self->maybe_query_parameter_info();
 
     std::lock_guard lock(self->param_info_cache_mutex_);
-    return self->param_info_cache_.size();
+    return self->param_info_cache_.checked(self->cache_generation_).size();
 }
 
 bool CLAP_ABI
@@ -748,11 +929,13 @@ clap_plugin_proxy::ext_params_get_info(const clap_plugin_t* plugin,
     self->maybe_query_parameter_info();
 
     std::lock_guard lock(self->param_info_cache_mutex_);
-    if (param_index > self->param_info_cache_.size()) {
+    const auto& cache =
+        self->param_info_cache_.checked(self->cache_generation_);
+    if (param_index > cache.size()) {
         return false;
     }
 
-    if (const auto& info = self->param_info_cache_[param_index]) {
+    if (const auto& info = cache[param_index]) {
         info->reconstruct(*param_info);
         return true;
     } else {
@@ -832,22 +1015,36 @@ clap_plugin_proxy::ext_params_flush(const clap_plugin_t* plugin,
                                     const clap_input_events_t* in,
                                     const clap_output_events_t* out) {
     assert(plugin && plugin->plugin_data && in && out);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    // This will not allocate below 64 events. Since flush will primarily be
-    // called on the main thread, we don't really care about minimizing
-    // allocations beyond that point here.
-    clap::events::EventList events{};
-    events.repopulate(*in);
+    // Some hosts call this function once per changed parameter, which used to
+    // mean one trip across the bridge per call. Instead the events are
+    // accumulated here, with successive values for the same parameter
+    // coalesced into a single event, and one bridged flush is issued from
+    // `clap_plugin::on_main_thread()`. Output events returned by that
+    // deferred flush are handed back to the host during its next flush call,
+    // which `flush_pending_parameter_events()` prompts with
+    // `clap_host_params::request_flush()`.
+    bool should_schedule = false;
+    {
+        std::lock_guard lock(self->pending_flush_mutex_);
+        self->pending_flush_events_.append_coalescing(*in);
+
+        // Even a flush without any input events needs to cross the bridge
+        // eventually, since the plugin may have pending output events of its
+        // own to write to the flush's output list
+        if (!self->has_scheduled_flush_) {
+            self->has_scheduled_flush_ = true;
+            should_schedule = true;
+        }
 
-    // This may also be called on the audio thread and it is never called during
-    // process, so always using the audio thread here is safe
-    const clap::ext::params::plugin::FlushResponse response =
-        self->bridge_.send_audio_thread_message(
-            clap::ext::params::plugin::Flush{.instance_id = self->instance_id(),
-                                             .in = std::move(events)});
+        self->pending_flush_outputs_.write_back_outputs(*out);
+        self->pending_flush_outputs_.clear();
+    }
 
-    response.out.write_back_outputs(*out);
+    if (should_schedule) {
+        self->host_->request_callback(self->host_);
+    }
 }
 
 bool CLAP_ABI clap_plugin_proxy::ext_render_has_hard_realtime_requirement(
@@ -875,16 +1072,30 @@ bool CLAP_ABI clap_plugin_proxy::ext_state_save(const clap_plugin_t* plugin,
     assert(plugin && plugin->plugin_data && stream);
     auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
 
-    const clap::ext::state::plugin::SaveResponse response =
+    clap::ext::state::plugin::SaveResponse response =
         self->bridge_.send_main_thread_message(
             clap::ext::state::plugin::Save{.instance_id = self->instance_id()});
-    if (response.result) {
-        response.result->write_to_stream(*stream);
-
-        return true;
-    } else {
+    if (!response.first_chunk) {
         return false;
     }
+
+    // The state is pulled across the bridge in fixed size chunks, writing
+    // each chunk to the host's stream before requesting the next one. This
+    // way a huge sampler state never needs to be held in a serialization
+    // buffer in one piece.
+    clap::stream::StreamChunk chunk = std::move(*response.first_chunk);
+    while (true) {
+        clap::stream::write_chunk_to_stream(*stream, chunk.data);
+        if (chunk.is_last) {
+            break;
+        }
+
+        chunk = self->bridge_.send_main_thread_message(
+            clap::ext::state::plugin::SaveContinue{.instance_id =
+                                                       self->instance_id()});
+    }
+
+    return true;
 }
 
 bool CLAP_ABI clap_plugin_proxy::ext_state_load(const clap_plugin_t* plugin,
@@ -892,21 +1103,55 @@ bool CLAP_ABI clap_plugin_proxy::ext_state_load(const clap_plugin_t* plugin,
     assert(plugin && plugin->plugin_data && stream);
     auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
 
+    // The host's stream is forwarded in fixed size chunks as it is being
+    // read, with the next chunk only leaving after the previous one has been
+    // acknowledged. We always read one chunk ahead so the last chunk can be
+    // sent as part of the `Load` message itself.
+    std::vector<uint8_t> chunk = clap::stream::read_chunk_from_stream(*stream);
+    std::vector<uint8_t> next_chunk =
+        clap::stream::read_chunk_from_stream(*stream);
+    while (!next_chunk.empty()) {
+        self->bridge_.send_main_thread_message(
+            clap::ext::state::plugin::LoadChunk{
+                .instance_id = self->instance_id(),
+                .data = std::move(chunk)});
+
+        chunk = std::move(next_chunk);
+        next_chunk = clap::stream::read_chunk_from_stream(*stream);
+    }
+
     // NOTE: We need to be able to handle mutual recursion here. DPF will call
     //       `clap_host_params::rescan()` during state loading, and that
     //       callback needs to be handled on the main thread. Other plugins may
     //       also do latency change calblacks in this function.
     return self->bridge_.send_mutually_recursive_main_thread_message(
         clap::ext::state::plugin::Load{.instance_id = self->instance_id(),
-                                       .stream = *stream});
+                                       .data = std::move(chunk)});
 }
 
 uint32_t CLAP_ABI clap_plugin_proxy::ext_tail_get(const clap_plugin_t* plugin) {
     assert(plugin && plugin->plugin_data);
-    auto self = static_cast<const clap_plugin_proxy*>(plugin->plugin_data);
+    auto self = static_cast<clap_plugin_proxy*>(plugin->plugin_data);
 
-    return self->bridge_.send_audio_thread_message(
+    // Hosts tend to query the tail length every processing cycle to decide
+    // when they can stop processing a track. Like the latency, the extension
+    // has a dedicated change notification, so the value can be served locally
+    // until the plugin calls `clap_host_tail::changed()`.
+    {
+        std::lock_guard lock(self->tail_cache_mutex_);
+        const auto& cache = self->tail_cache_.checked(self->cache_generation_);
+        if (cache) {
+            return *cache;
+        }
+    }
+
+    const uint32_t tail = self->bridge_.send_audio_thread_message(
         clap::ext::tail::plugin::Get{.instance_id = self->instance_id()});
+
+    std::lock_guard lock(self->tail_cache_mutex_);
+    self->tail_cache_.checked(self->cache_generation_) = tail;
+
+    return tail;
 }
 
 bool CLAP_ABI clap_plugin_proxy::ext_voice_info_get(const clap_plugin_t* plugin,
@@ -933,11 +1178,69 @@ void clap_plugin_proxy::maybe_query_parameter_info() {
     // We'll assume that the plugin has at least one parameter. If it does not
     // have any parameters then everything will work as expected, except that
     // the parameter count is not cached.
-    if (param_info_cache_.empty()) {
+    auto& cache = param_info_cache_.checked(cache_generation_);
+    if (cache.empty()) {
         const clap::ext::params::plugin::GetInfosResponse response =
             bridge_.send_main_thread_message(
                 clap::ext::params::plugin::GetInfos{.instance_id =
                                                         instance_id()});
-        param_info_cache_ = std::move(response.infos);
+        cache = std::move(response.infos);
+    }
+}
+
+void clap_plugin_proxy::maybe_query_audio_ports() {
+    std::lock_guard lock(audio_ports_cache_mutex_);
+
+    auto& cache = audio_ports_cache_.checked(cache_generation_);
+    if (!cache) {
+        cache = bridge_.send_main_thread_message(
+            clap::ext::audio_ports::plugin::GetPorts{.instance_id =
+                                                         instance_id()});
+    }
+}
+
+void clap_plugin_proxy::maybe_query_note_ports() {
+    std::lock_guard lock(note_ports_cache_mutex_);
+
+    auto& cache = note_ports_cache_.checked(cache_generation_);
+    if (!cache) {
+        cache = bridge_.send_main_thread_message(
+            clap::ext::note_ports::plugin::GetPorts{.instance_id =
+                                                        instance_id()});
+    }
+}
+
+void clap_plugin_proxy::flush_pending_parameter_events() {
+    clap::events::EventList events{};
+    {
+        std::lock_guard lock(pending_flush_mutex_);
+        if (!has_scheduled_flush_) {
+            return;
+        }
+        has_scheduled_flush_ = false;
+
+        events = std::move(pending_flush_events_);
+        pending_flush_events_.clear();
+    }
+
+    // `clap_plugin_params::flush()` is never called during a process call, so
+    // using the audio thread socket from the main thread here is safe
+    clap::ext::params::plugin::FlushResponse response =
+        bridge_.send_audio_thread_message(clap::ext::params::plugin::Flush{
+            .instance_id = instance_id(), .in = std::move(events)});
+
+    if (response.out.size() > 0) {
+        {
+            std::lock_guard lock(pending_flush_mutex_);
+            pending_flush_outputs_.append_coalescing(
+                *response.out.input_events());
+        }
+
+        // The host only receives output events through the output list of a
+        // flush call, so prompt it for one so `ext_params_flush()` can write
+        // these events back
+        if (host_extensions_.params) {
+            host_extensions_.params->request_flush(host_);
+        }
     }
 }
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <future>
 #include <thread>
 #include <vector>
@@ -36,8 +38,12 @@
 #include <rigtorp/MPMCQueue.h>
 #include <function2/function2.hpp>
 
+#include "../../common/serialization/clap/events.h"
+#include "../../common/serialization/clap/ext/audio-ports.h"
+#include "../../common/serialization/clap/ext/note-ports.h"
 #include "../../common/serialization/clap/ext/params.h"
 #include "../../common/serialization/clap/plugin.h"
+#include "../cache-generation.h"
 
 // Forward declaration to avoid circular includes
 class ClapPluginBridge;
@@ -159,11 +165,15 @@ class clap_plugin_proxy {
     }
 
     /**
-     * Clear the parameter information cache. Needs to be called when the plugin
-     * calls `clap_host_params::rescan()`. This cache is used to fetch
-     * information for all parameters at once.
+     * Invalidate every cache kept by this object. Needs to be called when the
+     * plugin calls any of its rescan or changed host callbacks
+     * (`clap_host_params::rescan()`, `clap_host_audio_ports::rescan()`,
+     * `clap_host_note_ports::rescan()`, `clap_host_latency::changed()`, and
+     * `clap_host_tail::changed()`). This bumps a single generation counter,
+     * and the `GenerationTagged` caches below empty themselves the next time
+     * they're accessed with a stale tag.
      */
-    void clear_param_info_cache();
+    void invalidate_caches();
 
     /**
      * The `clap_host_t*` passed when creating the instance. Any callbacks made
@@ -306,6 +316,24 @@ class clap_plugin_proxy {
                                             clap_voice_info_t* info);
 
    private:
+    /**
+     * With the `async_state_transitions` option enabled, run a
+     * `start_processing()`/`stop_processing()` transition on a background
+     * thread while the host's audio thread continues immediately, see
+     * `plugin_start_processing()`. Transitions have to stay ordered with
+     * respect to each other, so this first waits for any previous transition
+     * to finish.
+     */
+    void launch_state_transition(fu2::unique_function<void()> transition);
+
+    /**
+     * Block until the transition launched by `launch_state_transition()` has
+     * finished, if one is still in flight. A single atomic load when there
+     * isn't one. Called from `plugin_process()` and from the lifecycle
+     * functions that have to stay ordered behind a pending transition.
+     */
+    void wait_for_state_transition() noexcept;
+
     /**
      * Query information for all of the plugin's parameters and writes the
      * results to `param_info_cache_` if necessary. Otherwise does nothing.
@@ -314,6 +342,33 @@ class clap_plugin_proxy {
      */
     void maybe_query_parameter_info();
 
+    /**
+     * Query all of the plugin's audio ports and write the results to
+     * `audio_ports_cache_` if necessary. Otherwise does nothing. Acquires a
+     * lock on the cache in the process, so it must not be locked before
+     * calling this function.
+     */
+    void maybe_query_audio_ports();
+
+    /**
+     * Query all of the plugin's note ports and write the results to
+     * `note_ports_cache_` if necessary. Otherwise does nothing. Acquires a
+     * lock on the cache in the process, so it must not be locked before
+     * calling this function.
+     */
+    void maybe_query_note_ports();
+
+    /**
+     * Send a single bridged `clap_plugin_params::flush()` containing all
+     * events accumulated in `pending_flush_events_` since the last one. Called
+     * from `clap_plugin::on_main_thread()` after `ext_params_flush()`
+     * scheduled a callback, so a burst of host flush calls results in only one
+     * trip across the bridge. Output events returned by the plugin are stashed
+     * in `pending_flush_outputs_` and the host is asked for another flush so
+     * it can pick them up.
+     */
+    void flush_pending_parameter_events();
+
     ClapPluginBridge& bridge_;
     size_t instance_id_;
     clap::plugin::Descriptor descriptor_;
@@ -325,6 +380,14 @@ class clap_plugin_proxy {
      */
     time_t last_audio_thread_priority_synchronization_ = 0;
 
+    /**
+     * The sample rate from the last `clap_plugin::activate()` call, used to
+     * derive the deadline for a processing call in
+     * `PluginBridge::record_audio_processing_call()`. Stays at zero until the host
+     * has activated the plugin.
+     */
+    std::atomic<double> last_sample_rate_ = 0.0;
+
     /**
      * A shared memory object to share audio buffers between the native plugin
      * and the Wine plugin host. Copying audio is the most significant source of
@@ -336,6 +399,15 @@ class clap_plugin_proxy {
      */
     std::optional<AudioShmBuffer> process_buffers_;
 
+    /**
+     * A view over the output event ring at the start of `process_buffers_`.
+     * The Wine side pushes the plugin's output events here as raw event
+     * structs, and we drain them when writing the process results back to the
+     * host. Reattached whenever the buffers get (re)created during
+     * `clap_plugin::activate()`.
+     */
+    ShmEventRing output_event_ring_;
+
     /**
      * We'll reuse the request objects for the process call so we can keep the
      * process data object (which contains vectors and other heap allocated data
@@ -394,13 +466,107 @@ class clap_plugin_proxy {
      */
     rigtorp::MPMCQueue<HostCallback> pending_callbacks_;
 
+    /**
+     * The generation counter backing all of the caches below. Bumped from
+     * `invalidate_caches()` whenever the plugin calls one of its rescan or
+     * changed host callbacks, which empties every tagged cache on its next
+     * access. Host-initiated causes don't need to touch this since there are
+     * none for these extensions: CLAP only lets these values change through
+     * the plugin-initiated notifications listed above.
+     */
+    CacheGeneration cache_generation_;
+
     /**
      * Caches the info structs for all of a plugin's parameters. This is queried
      * all at once the first time the interacts with the param extension. When
-     * the plugin asks the host to rescan its parameters, this cache is cleared.
-     * The `std::optional` is used to handle the case where a plugin may return
-     * `false` when querying info for a parameter that should be in range.
+     * the plugin asks the host to rescan its parameters, this cache is
+     * invalidated through `cache_generation_`. The `std::optional` is used to
+     * handle the case where a plugin may return `false` when querying info for
+     * a parameter that should be in range.
      */
-    std::vector<std::optional<clap::ext::params::ParamInfo>> param_info_cache_;
+    GenerationTagged<std::vector<std::optional<clap::ext::params::ParamInfo>>>
+        param_info_cache_;
     std::mutex param_info_cache_mutex_;
+
+    /**
+     * Caches the info structs for all of the plugin's audio ports. Hosts
+     * re-query the entire port layout around every activation, and those
+     * queries sit on the transport start critical path, so they're fetched in
+     * a single batch and then served locally. Invalidated through
+     * `cache_generation_` when the plugin asks the host to rescan its audio
+     * ports. Same nullopt considerations as with `param_info_cache_`.
+     */
+    GenerationTagged<
+        std::optional<clap::ext::audio_ports::plugin::GetPortsResponse>>
+        audio_ports_cache_;
+    std::mutex audio_ports_cache_mutex_;
+
+    /**
+     * Caches the info structs for all of the plugin's note ports, exactly like
+     * `audio_ports_cache_`. Invalidated when the plugin asks the host to
+     * rescan its note ports.
+     */
+    GenerationTagged<
+        std::optional<clap::ext::note_ports::plugin::GetPortsResponse>>
+        note_ports_cache_;
+    std::mutex note_ports_cache_mutex_;
+
+    /**
+     * Caches the plugin's reported latency. Some hosts re-query the latency
+     * every processing cycle while plugin delay compensation is active, and
+     * the extension comes with a dedicated change notification, so the value
+     * can be served locally until the plugin calls
+     * `clap_host_latency::changed()`.
+     */
+    GenerationTagged<std::optional<uint32_t>> latency_cache_;
+    std::mutex latency_cache_mutex_;
+
+    /**
+     * Caches the plugin's reported tail length, exactly like
+     * `latency_cache_`. Invalidated when the plugin calls
+     * `clap_host_tail::changed()`.
+     */
+    GenerationTagged<std::optional<uint32_t>> tail_cache_;
+    std::mutex tail_cache_mutex_;
+
+    /**
+     * Parameter events from `clap_plugin_params::flush()` calls that haven't
+     * crossed the bridge yet. Some hosts flush once per changed parameter,
+     * and bridging every one of those calls individually causes a message
+     * storm when many parameters are automated while the plugin is
+     * deactivated. Instead the events are accumulated here, with successive
+     * values for the same parameter coalesced into one event, and a single
+     * bridged flush is sent from `clap_plugin::on_main_thread()`.
+     */
+    clap::events::EventList pending_flush_events_;
+    /**
+     * Output events returned by the last deferred bridged flush. These are
+     * written back to the host during its next `clap_plugin_params::flush()`
+     * call, which we prompt with `clap_host_params::request_flush()`.
+     */
+    clap::events::EventList pending_flush_outputs_;
+    /**
+     * Whether a `clap_host::request_callback()` has already been issued for
+     * the currently accumulating flush, so a burst of flush calls only
+     * schedules one callback.
+     */
+    bool has_scheduled_flush_ = false;
+    std::mutex pending_flush_mutex_;
+
+    /**
+     * Whether a state transition launched by `launch_state_transition()` is
+     * still in flight. Set before the transition thread starts and cleared
+     * by that thread under `state_transition_mutex_` once the round trip has
+     * finished, see the `async_state_transitions` option.
+     */
+    std::atomic_bool state_transition_in_flight_ = false;
+    std::mutex state_transition_mutex_;
+    std::condition_variable state_transition_cv_;
+    /**
+     * The thread performing the current state transition, if any. Only
+     * assigned after the previous transition has finished, so the implicit
+     * join when assigning a new thread never blocks. Declared last so it's
+     * joined before any of the state it uses gets destroyed.
+     */
+    std::jthread state_transition_thread_;
 };
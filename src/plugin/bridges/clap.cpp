@@ -37,6 +37,12 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
     // host
     connect_sockets_guarded();
 
+    // This side sends the control messages, so concurrent requests can be
+    // handled over pre-established spare connections when the `spare_sockets`
+    // option is set
+    sockets_.host_plugin_main_thread_control_.set_spare_sockets(
+        config_.spare_sockets);
+
     // Now that communication is set up the Wine host can send callbacks to this
     // bridge class, and we can send control messages to the Wine host. This
     // messaging mechanism is how we relay the CLAP communication protocol. As a
@@ -44,7 +50,11 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
     // configuration.
     host_callback_handler_ = std::jthread([&]() {
         set_realtime_priority(true);
-        pthread_setname_np(pthread_self(), "host-callbacks");
+        if (config_.main_affinity) {
+            set_cpu_affinity(*config_.main_affinity);
+        }
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("host-callbacks");
 
         sockets_.plugin_host_main_thread_callback_.receive_messages(
             std::pair<ClapLogger&, bool>(logger_, false),
@@ -105,9 +115,14 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
 
                     run_on_main_thread(
                         plugin_proxy,
-                        [&, host = plugin_proxy.host_,
+                        [&, plugin_proxy = &plugin_proxy,
+                         host = plugin_proxy.host_,
                          audio_ports =
                              plugin_proxy.host_extensions_.audio_ports]() {
+                            // Audio port information is cached and fetched in
+                            // bulk as an optimization
+                            plugin_proxy->invalidate_caches();
+
                             audio_ports->rescan(host, request.flags);
                         })
                         .wait();
@@ -186,8 +201,13 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
 
                     run_on_main_thread(
                         plugin_proxy,
-                        [&, host = plugin_proxy.host_,
+                        [&, plugin_proxy = &plugin_proxy,
+                         host = plugin_proxy.host_,
                          latency = plugin_proxy.host_extensions_.latency]() {
+                            // The latency is cached as an optimization, and
+                            // the host will re-query it after this callback
+                            plugin_proxy->invalidate_caches();
+
                             latency->changed(host);
                         })
                         .wait();
@@ -235,9 +255,14 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
 
                     run_on_main_thread(
                         plugin_proxy,
-                        [&, host = plugin_proxy.host_,
+                        [&, plugin_proxy = &plugin_proxy,
+                         host = plugin_proxy.host_,
                          note_ports =
                              plugin_proxy.host_extensions_.note_ports]() {
+                            // Note port information is cached and fetched in
+                            // bulk as an optimization
+                            plugin_proxy->invalidate_caches();
+
                             note_ports->rescan(host, request.flags);
                         })
                         .wait();
@@ -256,7 +281,7 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
                          params = plugin_proxy.host_extensions_.params]() {
                             // Parameter information is cached and fetched in
                             // bulk as an optimization
-                            plugin_proxy->clear_param_info_cache();
+                            plugin_proxy->invalidate_caches();
 
                             params->rescan(host, request.flags);
                         })
@@ -313,13 +338,16 @@ ClapPluginBridge::ClapPluginBridge(const ghc::filesystem::path& plugin_path)
                 },
             });
     });
+
+    startup_trace_event("clap-bridge-ready");
 }
 
 ClapPluginBridge::~ClapPluginBridge() noexcept {
     try {
-        // Drop all work make sure all sockets are closed
+        // Drop all work make sure all sockets are closed. The remaining pipe
+        // operations on the shared IO context are cancelled when
+        // `plugin_host_` gets destroyed.
         plugin_host_->terminate();
-        io_context_.stop();
     } catch (const std::system_error&) {
         // It could be that the sockets have already been closed or that the
         // process has already exited (at which point we probably won't be
@@ -331,18 +359,31 @@ const void* ClapPluginBridge::get_factory(const char* factory_id) {
     assert(factory_id);
 
     if (strcmp(factory_id, CLAP_PLUGIN_FACTORY_ID) == 0) {
-        // We'll initialize the factory the first time it's requested
+        // We'll initialize the factory the first time it's requested. The
+        // descriptor list is static for a given plugin version, so it's served
+        // from an on-disk cache when possible to avoid a round trip through
+        // the Wine plugin host during plugin scans and session loads.
         if (!plugin_factory_) {
+            std::optional<clap::factory::plugin_factory::ListResponse>
+                response =
+                    load_cached_metadata<
+                        clap::factory::plugin_factory::ListResponse>(
+                        info_.windows_library_path_, "clap-factory");
+            if (!response) {
+                response = send_main_thread_message(
+                    clap::factory::plugin_factory::List{});
+                store_cached_metadata(info_.windows_library_path_,
+                                      "clap-factory", *response);
+            }
+
             // If the plugin does not support this factory type, then we'll also
             // return a null poitner
-            const clap::factory::plugin_factory::ListResponse response =
-                send_main_thread_message(clap::factory::plugin_factory::List{});
-            if (!response.descriptors) {
+            if (!response->descriptors) {
                 return nullptr;
             }
 
             plugin_factory_ = std::make_unique<clap_plugin_factory_proxy>(
-                *this, std::move(*response.descriptors));
+                *this, std::move(*response->descriptors));
         }
 
         return &plugin_factory_->plugin_factory_vtable;
@@ -384,8 +425,8 @@ void ClapPluginBridge::register_plugin_proxy(
         //      thread names from different plugins will clash. Not a huge
         //      deal probably, since duplicate thread names are still more
         //      useful than no thread names.
-        const std::string thread_name = "audio-" + std::to_string(instance_id);
-        pthread_setname_np(pthread_self(), thread_name.c_str());
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("audio", instance_id);
 
         // Certain CLAP extensions allow audio thread callbacks, so we need
         // a dedicated per-instance socket for that
@@ -424,6 +465,10 @@ void ClapPluginBridge::register_plugin_proxy(
                     const auto& [plugin_proxy, _] =
                         get_proxy(request.owner_instance_id);
 
+                    // The tail length is cached as an optimization, and the
+                    // host will re-query it after this callback
+                    plugin_proxy.invalidate_caches();
+
                     plugin_proxy.host_extensions_.tail->changed(
                         plugin_proxy.host_);
 
@@ -218,6 +218,19 @@ class ClapPluginBridge : PluginBridge<ClapSockets<std::jthread>> {
         return plugin.run_on_main_thread(std::forward<F>(fn));
     }
 
+    /**
+     * Exposed so `clap_plugin_proxy::plugin_process()` can update this
+     * instance's live stats block and record deadline misses to its xrun
+     * ring.
+     */
+    using PluginBridge<ClapSockets<std::jthread>>::record_audio_processing_call;
+
+    /**
+     * Exposed so `clap_plugin_proxy` can check this instance's compatibility
+     * options, like `async_state_transitions`.
+     */
+    using PluginBridge<ClapSockets<std::jthread>>::config_;
+
     /**
      * The logging facility used for this instance of yabridge. Wraps around
      * `PluginBridge::generic_logger`.
@@ -16,8 +16,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <iomanip>
+#include <memory>
 
 #include <sys/resource.h>
 
@@ -25,9 +29,11 @@
 #include <config.h>
 #include <version.h>
 
+#include "../../common/audio-shm.h"
 #include "../../common/configuration.h"
 #include "../../common/linking.h"
 #include "../../common/notifications.h"
+#include "../../common/startup-trace.h"
 #include "../../common/utils.h"
 #include "../host-process.h"
 
@@ -81,53 +87,44 @@ class PluginBridge {
     PluginBridge(PluginType plugin_type,
                  const ghc::filesystem::path& plugin_path,
                  F&& create_socket_instance)
-        : io_context_(),
+        : io_context_(SharedIoContext::get_or_create()),
           // This works for both individual files (VST2 and CLAP) and entire
           // directories (VST3)
           config_(load_config_for(plugin_path)),
           info_(plugin_type, plugin_path, config_.vst3_prefer_32bit),
-          sockets_(create_socket_instance(io_context_, info_)),
+          // Querying `wine --version` for the init message means booting
+          // Wine's loader, which can take over a hundred milliseconds. By
+          // starting the query here it runs concurrently with our socket
+          // setup, the host process spawn, and the rest of the
+          // initialization, and `log_init_message()` only has to wait for
+          // whatever part of that time is still left.
+          wine_version_(std::async(std::launch::async,
+                                   [this]() { return info_.wine_version(); })),
+          sockets_(create_socket_instance(io_context_->context_, info_)),
+          host_heartbeat_(
+              HeartbeatBuffer::name_for(sockets_.base_dir_.filename().string()),
+              true),
+          xrun_ring_(
+              XrunRing::name_for(sockets_.base_dir_.filename().string())),
+          instance_stats_(InstanceStatsBlock::name_for(
+              sockets_.base_dir_.filename().string())),
           generic_logger_(Logger::create_from_environment(
               create_logger_prefix(sockets_.base_dir_))),
-          plugin_host_(
-              config_.group
-                  ? std::unique_ptr<HostProcess>(std::make_unique<GroupHost>(
-                        io_context_,
-                        generic_logger_,
-                        config_,
-                        sockets_,
-                        info_,
-                        HostRequest{
-                            .plugin_type = plugin_type,
-                            .plugin_path = info_.windows_plugin_path_.string(),
-                            .endpoint_base_dir = sockets_.base_dir_.string(),
-                            .parent_pid = getpid()}))
-                  : std::unique_ptr<HostProcess>(
-                        std::make_unique<IndividualHost>(
-                            io_context_,
-                            generic_logger_,
-                            config_,
-                            sockets_,
-                            info_,
-                            HostRequest{.plugin_type = plugin_type,
-                                        .plugin_path =
-                                            info_.windows_plugin_path_.string(),
-                                        .endpoint_base_dir =
-                                            sockets_.base_dir_.string(),
-                                        .parent_pid = getpid()}))),
-          has_realtime_priority_(has_realtime_priority_promise_.get_future()),
-          wine_io_handler_([&]() {
-              // We no longer run this thread with realtime scheduling because
-              // plugins that produce a lot of FIXMEs could in theory cause
-              // dropouts that way, but we still need to run this from a thread
-              // to check whether we support it
-              has_realtime_priority_promise_.set_value(
-                  set_realtime_priority(true));
-              set_realtime_priority(false);
-              pthread_setname_np(pthread_self(), "wine-stdio");
-
-              io_context_.run();
-          }) {}
+          plugin_host_(create_host_process(
+              io_context_->context_,
+              generic_logger_,
+              config_,
+              sockets_,
+              info_,
+              // The bitbridge host path only gets filled in by `GroupHost`,
+              // since only group host processes delegate 32-bit plugins to a
+              // companion process. The other host types simply launch the
+              // host binary matching the plugin's architecture directly.
+              HostRequest{.plugin_type = plugin_type,
+                          .plugin_path = info_.windows_plugin_path_.string(),
+                          .endpoint_base_dir = sockets_.base_dir_.string(),
+                          .parent_pid = getpid(),
+                          .bitbridge_host_path = ""})) {}
 
     virtual ~PluginBridge() noexcept = default;
 
@@ -153,7 +150,7 @@ class PluginBridge {
                  << plugin_type_to_string(info_.plugin_type_) << "'"
                  << std::endl;
         init_msg << "realtime:      ";
-        if (has_realtime_priority_.get()) {
+        if (io_context_->has_realtime_priority()) {
             // Warn if `RLIMIT_RTTIME` is set to some low value. This can happen
             // when using PipeWire.
             if (auto rttime_limit = get_rttime_limit()) {
@@ -249,7 +246,7 @@ class PluginBridge {
             info_.wine_prefix_);
         init_msg << "'" << std::endl;
 
-        init_msg << "wine version:  '" << info_.wine_version() << "'"
+        init_msg << "wine version:  '" << wine_version_.get() << "'"
                  << std::endl;
         init_msg << std::endl;
 
@@ -269,6 +266,12 @@ class PluginBridge {
         init_msg << "hosting mode:  '";
         if (config_.group) {
             init_msg << "plugin group \"" << *config_.group << "\"";
+            if (config_.group_daemon) {
+                init_msg << " (daemon)";
+            }
+            if (config_.group_trusted) {
+                init_msg << " (trusted)";
+            }
         } else {
             init_msg << "individually";
         }
@@ -284,6 +287,52 @@ class PluginBridge {
 
         init_msg << "other options: ";
         std::vector<std::string> other_options;
+        if (config_.async_state_transitions) {
+            other_options.push_back("async state transitions");
+        }
+        if (config_.audio_affinity) {
+            other_options.push_back("audio: pinned to CPUs " +
+                                    *config_.audio_affinity);
+        }
+        if (config_.audio_busy_poll) {
+            other_options.push_back("audio: zero-syscall busy polling");
+        }
+        if (config_.audio_deadline_ms > 0) {
+            other_options.push_back(
+                "audio: " + std::to_string(config_.audio_deadline_ms) +
+                " ms response deadline");
+        }
+        if (config_.audio_gang_dispatch) {
+            other_options.push_back("audio: gang dispatch");
+        }
+        if (config_.audio_huge_pages) {
+            other_options.push_back("audio: huge page backed buffers");
+        }
+        if (config_.audio_pipelining) {
+            other_options.push_back("audio: one-block pipelining");
+        }
+        if (config_.audio_spin_us > 0) {
+            other_options.push_back("audio: spin wait for " +
+                                    std::to_string(config_.audio_spin_us) +
+                                    " us");
+        }
+        if (config_.audio_zero_copy_input) {
+            other_options.push_back("audio: zero-copy inputs");
+        }
+        if (config_.audio_zero_copy_output) {
+            other_options.push_back("audio: zero-copy outputs");
+        }
+        if (config_.automate_coalesce) {
+            other_options.push_back(
+                "automation: coalesced, " +
+                (*config_.automate_coalesce > 0
+                     ? std::to_string(*config_.automate_coalesce) +
+                           " ms window"
+                     : std::string("one block window")));
+        }
+        if (config_.bypass_passthrough) {
+            other_options.push_back("audio: local bypass passthrough");
+        }
         if (config_.disable_pipes) {
             other_options.push_back(
                 "hack: pipes disabled, plugin output will go to \"" +
@@ -292,12 +341,20 @@ class PluginBridge {
         if (config_.editor_coordinate_hack) {
             other_options.push_back("editor: coordinate hack");
         }
+        if (config_.editor_deferred_open) {
+            other_options.push_back("editor: deferred open");
+        }
         if (config_.editor_disable_host_scaling) {
             other_options.push_back("editor: no host DPI scaling");
         }
         if (config_.editor_force_dnd) {
             other_options.push_back("editor: force drag-and-drop");
         }
+        if (config_.editor_keepalive_ms > 0) {
+            other_options.push_back(
+                "editor: " + std::to_string(config_.editor_keepalive_ms) +
+                " ms keepalive");
+        }
         if (config_.editor_xembed) {
             other_options.push_back("editor: XEmbed");
         }
@@ -307,12 +364,85 @@ class PluginBridge {
                    << *config_.frame_rate << " fps";
             other_options.push_back(option.str());
         }
+        if (config_.group_cpu_quota > 0) {
+            other_options.push_back(
+                "group: CPU quota " +
+                std::to_string(config_.group_cpu_quota) + "%");
+        }
+        if (config_.group_cpus) {
+            other_options.push_back("group: restricted to CPUs " +
+                                    *config_.group_cpus);
+        }
+        if (config_.group_memory_limit > 0) {
+            other_options.push_back(
+                "group: memory limit " +
+                std::to_string(config_.group_memory_limit) + " MiB");
+        }
+        if (config_.group_shards > 1) {
+            other_options.push_back(
+                "group: split into " +
+                std::to_string(config_.group_shards) + " shards");
+        }
+        if (config_.hibernate_after > 0) {
+            other_options.push_back(
+                "hibernate silent instances after " +
+                std::to_string(config_.hibernate_after) + " seconds");
+        }
         if (config_.hide_daw) {
             other_options.push_back("hack: hide DAW name");
         }
+        if (config_.main_affinity) {
+            other_options.push_back("main thread: pinned to CPUs " +
+                                    *config_.main_affinity);
+        }
+        if (config_.notification_dedup_ms > 0) {
+            other_options.push_back(
+                "notifications: deduplicated within " +
+                std::to_string(config_.notification_dedup_ms) + " ms");
+        }
+        if (config_.numa_node) {
+            other_options.push_back("NUMA: pinned to node " +
+                                    std::to_string(*config_.numa_node));
+        }
+        if (config_.offline_direct_processing) {
+            other_options.push_back(
+                "audio: offline rendering on the audio thread");
+        }
+        if (config_.overload_priority) {
+            other_options.push_back(
+                "audio: overload priority " +
+                std::to_string(*config_.overload_priority));
+        }
+        if (config_.matched_profile) {
+            other_options.push_back("host profile: \"" +
+                                    *config_.matched_profile + "\"");
+        }
+        if (config_.shared_sidechain) {
+            other_options.push_back("audio: shared sidechain tag \"" +
+                                    *config_.shared_sidechain + "\"");
+        }
+        if (config_.snapshot_interval > 0) {
+            other_options.push_back(
+                "state snapshots every " +
+                std::to_string(config_.snapshot_interval) + " seconds");
+        }
+        if (config_.spare_sockets > 0) {
+            other_options.push_back(
+                "sockets: " + std::to_string(config_.spare_sockets) +
+                " pre-warmed spares");
+        }
         if (config_.vst3_prefer_32bit) {
             other_options.push_back("vst3: prefer 32-bit");
         }
+        if (config_.vst3_sample_accurate_splitting) {
+            other_options.push_back(
+                "vst3: sample-accurate splitting on the Wine side");
+        }
+        if (config_.warm_hosts > 0) {
+            other_options.push_back("hosts: " +
+                                    std::to_string(config_.warm_hosts) +
+                                    " pre-booted warm hosts");
+        }
         if (!other_options.empty()) {
             init_msg << join_quoted_strings(other_options) << std::endl;
         } else {
@@ -371,6 +501,7 @@ class PluginBridge {
      * TODO: Asynchronously connect our sockets so we can interrupt it, maybe
      */
     void connect_sockets_guarded() {
+        startup_trace_event("sockets-connect-begin");
 #ifndef WITH_WINEDBG
         // If the Wine process fails to start, then nothing will connect to the
         // sockets and we'll be hanging here indefinitely. To prevent this,
@@ -381,7 +512,8 @@ class PluginBridge {
         host_watchdog_handler_ = std::jthread([&](std::stop_token st) {
             using namespace std::literals::chrono_literals;
 
-            pthread_setname_np(pthread_self(), "watchdog");
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("watchdog");
 
             while (!st.stop_requested()) {
                 if (!plugin_host_->running()) {
@@ -411,6 +543,7 @@ class PluginBridge {
 #ifndef WITH_WINEDBG
         host_watchdog_handler_.request_stop();
 #endif
+        startup_trace_event("sockets-connect-end");
     }
 
     /**
@@ -438,7 +571,141 @@ class PluginBridge {
         }
     }
 
-    asio::io_context io_context_;
+    /**
+     * Warn the user once when the Wine plugin host's event loop has stopped
+     * making progress. This should be called right before sending a
+     * dispatcher call that will block on the host's GUI thread, so the user
+     * gets some feedback instead of the host application just freezing when
+     * the Wine host has locked up. Checking the heartbeat is a single atomic
+     * load, so this is safe to call on every dispatcher call.
+     *
+     * This only ever warns and never terminates anything, because a stalled
+     * event loop can also be completely benign. Modal Win32 dialogs for
+     * instance run their own message pump, which blocks our event loop for as
+     * long as the dialog stays open. Actual audio thread hangs are already
+     * detected through the shared memory audio buffer's timeouts.
+     */
+    void warn_on_stalled_host() noexcept {
+        using namespace std::chrono;
+
+        // The generation stays at zero until the Wine host's event loop has
+        // started ticking. Plugin scanning and Wine's boot process can take
+        // arbitrarily long, so we shouldn't try to detect stalls before then.
+        const uint32_t generation = host_heartbeat_.generation();
+        if (generation == 0) {
+            return;
+        }
+
+        const auto now_ticks = steady_clock::now().time_since_epoch().count();
+        if (generation != last_heartbeat_generation_.exchange(
+                              generation, std::memory_order_relaxed)) {
+            last_heartbeat_change_.store(now_ticks, std::memory_order_relaxed);
+            heartbeat_warning_issued_.store(false, std::memory_order_relaxed);
+            return;
+        }
+
+        // The event loop ticks every few milliseconds, so a couple of
+        // seconds without any progress means the GUI thread is well and
+        // truly stuck
+        const steady_clock::duration stalled_for(
+            now_ticks -
+            last_heartbeat_change_.load(std::memory_order_relaxed));
+        if (stalled_for > seconds(10) &&
+            !heartbeat_warning_issued_.exchange(true,
+                                                std::memory_order_relaxed)) {
+            generic_logger_.log(
+                "WARNING: The Wine plugin host's event loop has not made any");
+            generic_logger_.log(
+                "         progress for over ten seconds. If there's no modal");
+            generic_logger_.log(
+                "         dialog open, then the plugin has likely locked up");
+            generic_logger_.log(
+                "         and this call may block indefinitely.");
+        }
+    }
+
+    /**
+     * Account a finished audio processing call in this instance's live stats
+     * block, and check whether the call missed its deadline. When it did,
+     * push a phase breakdown to the instance's xrun ring so `yabridgectl
+     * xruns` can attribute the glitch. Called at the end of the processing
+     * functions in the format specific bridges. In the common case where the
+     * block made its deadline this is a clock read and a few relaxed atomic
+     * increments.
+     *
+     * @param instance_id The object instance ID for VST3 and CLAP plugins, or
+     *   zero for VST2 plugins.
+     * @param sample_rate The instance's current sample rate. When this is
+     *   still zero because the host never told us, no deadline can be derived
+     *   and only the stats counters are updated.
+     * @param sample_frames The size of the processed block.
+     * @param num_events The number of events the host passed along with this
+     *   block, zero for VST2 plugins since those deliver their events through
+     *   `effProcessEvents()` which is counted separately.
+     * @param process_start When the processing call entered the bridge.
+     * @param copy_in_time Time spent writing the host's inputs to the shared
+     *   audio buffers.
+     * @param round_trip_time Time spent waiting on the Wine plugin host,
+     *   covering the bridging round trip and the plugin's own processing.
+     */
+    void record_audio_processing_call(
+        uint64_t instance_id,
+        double sample_rate,
+        uint32_t sample_frames,
+        uint32_t num_events,
+        std::chrono::steady_clock::time_point process_start,
+        std::chrono::steady_clock::duration copy_in_time,
+        std::chrono::steady_clock::duration round_trip_time) noexcept {
+        using namespace std::chrono;
+
+        const auto duration =
+            duration_cast<microseconds>(steady_clock::now() - process_start);
+
+        instance_stats_.record_process_call(
+            static_cast<uint64_t>(duration.count()), sample_frames,
+            sample_rate > 0.0 ? static_cast<uint32_t>(sample_rate + 0.5) : 0);
+        if (num_events > 0) {
+            instance_stats_.add_events(num_events);
+        }
+
+        if (!xrun_ring_.active() || sample_rate <= 0.0) {
+            return;
+        }
+        const auto deadline = microseconds(static_cast<int64_t>(
+            static_cast<double>(sample_frames) * 1000000.0 / sample_rate));
+        if (duration <= deadline) {
+            return;
+        }
+
+        // Whatever wasn't spent copying inputs or waiting on the Wine host
+        // went into copying the outputs back, plus a sliver of bookkeeping
+        const auto copy_in = duration_cast<microseconds>(copy_in_time);
+        const auto round_trip = duration_cast<microseconds>(round_trip_time);
+        const auto copy_out =
+            std::max(duration - copy_in - round_trip, microseconds(0));
+
+        xrun_ring_.push(XrunRecord{
+            .timestamp_us = static_cast<uint64_t>(
+                duration_cast<microseconds>(
+                    system_clock::now().time_since_epoch())
+                    .count()),
+            .instance_id = instance_id,
+            .sample_frames = sample_frames,
+            .deadline_us = static_cast<uint32_t>(deadline.count()),
+            .duration_us = static_cast<uint32_t>(duration.count()),
+            .copy_in_us = static_cast<uint32_t>(copy_in.count()),
+            .round_trip_us = static_cast<uint32_t>(round_trip.count()),
+            .copy_out_us = static_cast<uint32_t>(copy_out.count())});
+    }
+
+    /**
+     * The process wide IO context shared between all bridged plugin instances.
+     * This services the Wine process STDIO relaying and deferred socket
+     * cleanup work from a single reactor thread instead of one mostly-idle
+     * thread per instance. This is declared first so it outlives everything
+     * that's bound to it, most importantly `plugin_host_`'s STDIO pipes.
+     */
+    std::shared_ptr<SharedIoContext> io_context_;
 
     /**
      * The configuration for this instance of yabridge. Set based on the values
@@ -453,6 +720,13 @@ class PluginBridge {
      */
     const PluginInfo info_;
 
+    /**
+     * The output of `wine --version`, queried on a background thread so the
+     * Wine loader's startup time overlaps with the rest of our
+     * initialization. Consumed exactly once by `log_init_message()`.
+     */
+    std::future<std::string> wine_version_;
+
     /**
      * The sockets used for communication with the Wine process.
      *
@@ -464,41 +738,43 @@ class PluginBridge {
     TSockets sockets_;
 
     /**
-     * The logging facility used for this instance of yabridge. See
-     * `Logger::create_from_env()` for how this is configured.
-     *
-     * @see Logger::create_from_env
+     * The heartbeat word shared with the Wine plugin host for this instance.
+     * The host's event loop bumps the generation counter once per tick, so
+     * `warn_on_stalled_host()` can detect a stuck GUI thread without sending
+     * anything over the sockets. This has to be created before
+     * `plugin_host_` spawns the host process, since the Wine side opens the
+     * existing object.
      */
-    Logger generic_logger_;
+    HeartbeatBuffer host_heartbeat_;
 
     /**
-     * The Wine process hosting our plugins. In the case of group hosts a
-     * `PluginBridge` instance doesn't actually own a process, but rather either
-     * spawns a new detached process or it connects to an existing one.
+     * The ring of recorded audio processing deadline misses for this
+     * instance, filled by `record_audio_processing_call()` and read by
+     * `yabridgectl xruns` straight from `/dev/shm`.
      */
-    std::unique_ptr<HostProcess> plugin_host_;
+    XrunRing xrun_ring_;
 
-   private:
     /**
-     * The promise belonging to `has_realtime_priority_` below.
+     * The live statistics counters for this instance, bumped by
+     * `record_audio_processing_call()` and the event dispatching paths, and
+     * read by `yabridgectl top` straight from `/dev/shm`.
      */
-    std::promise<bool> has_realtime_priority_promise_;
+    InstanceStatsBlock instance_stats_;
 
-   public:
     /**
-     * Whether this process runs with realtime priority. This is set on the
-     * thread that's relaying STDOUT and STDERR output from Wine, hence the need
-     * for a future. We won't change the scheduler properties on the thread
-     * that's initializing the plugin because some DAWs may do that from the UI
-     * thread.
+     * The logging facility used for this instance of yabridge. See
+     * `Logger::create_from_env()` for how this is configured.
+     *
+     * @see Logger::create_from_env
      */
-    std::future<bool> has_realtime_priority_;
+    Logger generic_logger_;
 
     /**
-     * Runs the Asio `io_context_` thread for logging the Wine process
-     * STDOUT and STDERR messages.
+     * The Wine process hosting our plugins. In the case of group hosts a
+     * `PluginBridge` instance doesn't actually own a process, but rather either
+     * spawns a new detached process or it connects to an existing one.
      */
-    std::jthread wine_io_handler_;
+    std::unique_ptr<HostProcess> plugin_host_;
 
    private:
     /**
@@ -509,4 +785,14 @@ class PluginBridge {
      * running.
      */
     std::jthread host_watchdog_handler_;
+
+    /**
+     * Bookkeeping for `warn_on_stalled_host()`. These track the last observed
+     * heartbeat generation, when it last changed (as a
+     * `std::chrono::steady_clock` tick count), and whether we have already
+     * warned about the current stall so we only do so once per episode.
+     */
+    std::atomic<uint32_t> last_heartbeat_generation_ = 0;
+    std::atomic<std::chrono::steady_clock::rep> last_heartbeat_change_ = 0;
+    std::atomic_bool heartbeat_warning_issued_ = false;
 };
@@ -16,9 +16,37 @@
 
 #include "vst2.h"
 
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "../../common/audio-copy.h"
+#include "../../common/tracepoints.h"
 #include "../../common/communication/vst2.h"
 #include "../utils.h"
 
+/**
+ * With the `audio_deadline_ms` option set, the number of consecutive blocks
+ * the host has to receive silence for before we log that the plugin looks
+ * stuck rather than just slow, see `do_process()`.
+ */
+constexpr uint32_t process_overrun_escalation_blocks = 16;
+
+/**
+ * With the `audio_zero_copy_input` or `audio_zero_copy_output` option
+ * enabled, the number of times we'll scan procfs and offer the host's
+ * buffers to the Wine plugin host for mapping before giving up, see
+ * `Vst2PluginBridge::try_use_mapped_host_buffers()`. Hosts whose buffers
+ * live in plain private memory can never map successfully, so we shouldn't
+ * keep rescanning for them forever.
+ */
+constexpr uint32_t max_host_buffer_map_attempts = 3;
+
 intptr_t dispatch_proxy(AEffect*, int, int, intptr_t, void*, float);
 void process_proxy(AEffect*, float**, float**, int);
 void process_replacing_proxy(AEffect*, float**, float**, int);
@@ -60,6 +88,11 @@ Vst2PluginBridge::Vst2PluginBridge(const ghc::filesystem::path& plugin_path,
     // host
     connect_sockets_guarded();
 
+    // This side sends the host's `dispatcher()` calls, so concurrent events
+    // can be handled over pre-established spare connections when the
+    // `spare_sockets` option is set
+    sockets_.host_plugin_dispatch_.set_spare_sockets(config_.spare_sockets);
+
     // Set up all pointers for our `AEffect` struct. We will fill this with data
     // from the VST plugin loaded in Wine at the end of this constructor.
     plugin_.ptr3 = this;
@@ -75,7 +108,11 @@ Vst2PluginBridge::Vst2PluginBridge(const ghc::filesystem::path& plugin_path,
     // lockstep anyway
     host_callback_handler_ = std::jthread([&]() {
         set_realtime_priority(true);
-        pthread_setname_np(pthread_self(), "host-callbacks");
+        if (config_.main_affinity) {
+            set_cpu_affinity(*config_.main_affinity);
+        }
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("host-callbacks");
 
         sockets_.plugin_host_callback_.receive_events(
             std::pair<Vst2Logger&, bool>(logger_, false),
@@ -151,6 +188,25 @@ Vst2PluginBridge::Vst2PluginBridge(const ghc::filesystem::path& plugin_path,
                                 .value_payload = std::nullopt};
                         }
                     } break;
+                    // The plugin is signalling that its parameters or
+                    // capabilities have changed. A single generation bump
+                    // invalidates every tagged cache on this instance, see
+                    // `cache_generation_`. The events themselves are still
+                    // passed through to the host below.
+                    case audioMasterUpdateDisplay:
+                    case audioMasterIOChanged: {
+                        cache_generation_.bump();
+                        // The plugin's program names may also have changed,
+                        // so a fresh table gets prefetched to replace the
+                        // invalidated one
+                        prefetch_program_names();
+                        // The plugin's tail may also have changed, so the
+                        // silence detection in `try_bypass_passthrough()`
+                        // stays disabled until the tail size gets queried
+                        // again
+                        last_reported_tail_size_.store(
+                            -1, std::memory_order_relaxed);
+                    } break;
                     case audioMasterDeadBeef:
                         logger_.log("");
                         logger_.log(
@@ -191,16 +247,17 @@ Vst2PluginBridge::Vst2PluginBridge(const ghc::filesystem::path& plugin_path,
     sockets_.host_plugin_control_.send(config_);
 
     update_aeffect(plugin_, initialized_plugin);
+
+    startup_trace_event("vst2-bridge-ready");
 }
 
 Vst2PluginBridge::~Vst2PluginBridge() noexcept {
     try {
-        // Drop all work make sure all sockets are closed
+        // Drop all work make sure all sockets are closed. The remaining pipe
+        // operations on the shared IO context are cancelled when
+        // `plugin_host_` gets destroyed, since the context itself keeps
+        // running for the other instances.
         plugin_host_->terminate();
-
-        // The `stop()` method will cause the IO context to just drop all of its
-        // outstanding work immediately
-        io_context_.stop();
     } catch (const std::system_error&) {
         // It could be that the sockets have already been closed or that the
         // process has already exited (at which point we probably won't be
@@ -208,16 +265,45 @@ Vst2PluginBridge::~Vst2PluginBridge() noexcept {
     }
 }
 
+/**
+ * Whether an opcode is an idempotent query whose response can be cached on
+ * the native side and replayed for identical queries, see
+ * `Vst2PluginBridge::dispatch_query_cache_`.
+ */
+bool is_idempotent_query_opcode(const int opcode) noexcept {
+    switch (opcode) {
+        case effCanDo:
+        case effGetEffectName:
+        case effGetVendorString:
+        case effGetProductString:
+        case effGetVendorVersion:
+        case effGetParameterProperties:
+            return true;
+        default:
+            return false;
+    }
+}
+
 class DispatchDataConverter : public DefaultDataConverter {
    public:
-    DispatchDataConverter(std::optional<AudioShmBuffer>& process_buffers,
-                          std::vector<uint8_t>& chunk_data,
-                          AEffect& plugin,
-                          VstRect& editor_rectangle) noexcept
+    DispatchDataConverter(
+        std::optional<AudioShmBuffer>& process_buffers,
+        std::vector<uint8_t>& chunk_data,
+        AEffect& plugin,
+        VstRect& editor_rectangle,
+        GenerationTagged<std::optional<std::vector<float>>>&
+            program_values_cache,
+        std::mutex& program_values_cache_mutex,
+        std::atomic<bool>& program_values_cache_armed,
+        const CacheGeneration& cache_generation) noexcept
         : process_buffers_(process_buffers),
           chunk_(chunk_data),
           plugin_(plugin),
-          rect_(editor_rectangle) {}
+          rect_(editor_rectangle),
+          program_values_cache_(program_values_cache),
+          program_values_cache_mutex_(program_values_cache_mutex),
+          program_values_cache_armed_(program_values_cache_armed),
+          cache_generation_(cache_generation) {}
 
     Vst2Event::Payload read_data(const int opcode,
                                  const int index,
@@ -261,6 +347,16 @@ class DispatchDataConverter : public DefaultDataConverter {
             case effSetChunk: {
                 const uint8_t* chunk_data = static_cast<const uint8_t*>(data);
 
+                // Sample library plugins can have states of hundreds of
+                // megabytes. Those are streamed over the socket directly from
+                // the host's buffer instead of being copied into the event,
+                // see `ChunkStream`. The host's buffer stays valid for the
+                // duration of this synchronous dispatcher call.
+                if (static_cast<size_t>(value) >= chunk_streaming_threshold) {
+                    return ChunkStream{.size = static_cast<uint64_t>(value),
+                                       .data = chunk_data};
+                }
+
                 // When the host passes a chunk it will use the value parameter
                 // to tell us its length
                 return ChunkData{
@@ -386,6 +482,23 @@ class DispatchDataConverter : public DefaultDataConverter {
                     std::get<AEffect>(response.payload);
                 update_aeffect(plugin_, updated_plugin);
             } break;
+            case effSetProgram: {
+                // The Wine side responds with the new program's full state
+                // so the host's follow-up reads can be answered locally, see
+                // `Vst2ProgramBundle`
+                if (const auto* bundle =
+                        std::get_if<Vst2ProgramBundle>(&response.payload)) {
+                    update_aeffect(plugin_, bundle->aeffect);
+
+                    if (!bundle->values.empty()) {
+                        std::lock_guard lock(program_values_cache_mutex_);
+                        program_values_cache_.checked(cache_generation_) =
+                            bundle->values;
+                        program_values_cache_armed_.store(
+                            true, std::memory_order_relaxed);
+                    }
+                }
+            } break;
             case effMainsChanged: {
                 if (const auto* audio_buffer_config =
                         std::get_if<AudioShmBuffer::Config>(
@@ -410,6 +523,17 @@ class DispatchDataConverter : public DefaultDataConverter {
                 *static_cast<VstRect**>(data) = &rect_;
             } break;
             case effGetChunk: {
+                // Large chunks arrive as a memfd mapping owned by
+                // `DefaultDataConverter`, see `ChunkStream`. We can hand the
+                // host a pointer straight into that mapping, which stays
+                // valid until the next `effGetChunk()` call.
+                if (const ChunkStream* chunk =
+                        std::get_if<ChunkStream>(&response.payload)) {
+                    *static_cast<uint8_t**>(data) =
+                        const_cast<uint8_t*>(chunk->data);
+                    break;
+                }
+
                 // Write the chunk data to some publically accessible place in
                 // `Vst2PluginBridge` and write a pointer to that struct to the
                 // data pointer
@@ -504,6 +628,11 @@ class DispatchDataConverter : public DefaultDataConverter {
     std::vector<uint8_t>& chunk_;
     AEffect& plugin_;
     VstRect& rect_;
+    GenerationTagged<std::optional<std::vector<float>>>&
+        program_values_cache_;
+    std::mutex& program_values_cache_mutex_;
+    std::atomic<bool>& program_values_cache_armed_;
+    const CacheGeneration& cache_generation_;
 };
 
 intptr_t Vst2PluginBridge::dispatch(AEffect* /*plugin*/,
@@ -529,8 +658,10 @@ intptr_t Vst2PluginBridge::dispatch(AEffect* /*plugin*/,
         return 0;
     }
 
-    DispatchDataConverter converter(process_buffers_, chunk_data_, plugin_,
-                                    editor_rectangle_);
+    DispatchDataConverter converter(
+        process_buffers_, chunk_data_, plugin_, editor_rectangle_,
+        program_values_cache_, program_values_cache_mutex_,
+        program_values_cache_armed_, cache_generation_);
 
     switch (opcode) {
         case effClose: {
@@ -585,6 +716,91 @@ intptr_t Vst2PluginBridge::dispatch(AEffect* /*plugin*/,
             logger_.log_event_response(true, opcode, 0, nullptr, std::nullopt);
             return 0;
         }; break;
+        case effIdle: {
+            // The deprecated counterpart to the `effEditIdle` handling above.
+            // The Wine side intercepts the plugin's `audioMasterNeedIdle()`
+            // and drives `effIdle` from a timer over there, so the idle calls
+            // made by hosts that still implement this don't need to cross the
+            // socket either.
+            logger_.log_event(true, opcode, index, value, nullptr, option,
+                              std::nullopt);
+            logger_.log_event_response(true, opcode, 0, nullptr, std::nullopt);
+            return 0;
+        }; break;
+        case effOpen: {
+            // Improperly coded plugins may only fill in some of their
+            // information during `effOpen()`, so any queries answered before
+            // this point should not be replayed afterwards. The event itself
+            // is still handled like any other event below.
+            clear_dispatch_query_cache();
+        } break;
+        case effSetProgramName:
+        case effSetChunk: {
+            // These events may change the plugin's program names, so the
+            // prefetched table can no longer be replayed. A fresh table gets
+            // fetched once the event has been handled below. Loading a state
+            // also changes the parameter values, so the values bundled with
+            // the last program change can't be replayed either.
+            clear_program_names_cache();
+            clear_program_values_cache();
+        } break;
+        case effMainsChanged: {
+            // Audio processing is about to be reinitialized or suspended, so
+            // there can no longer be a pipelined block in flight. The event
+            // itself is still handled like any other event below.
+            pipelining_block_in_flight_ = false;
+            pipelining_bank_ = 0;
+            pipelining_prev_sample_frames_ = 0;
+            pending_shm_events_.clear();
+        } break;
+        case effSetSampleRate: {
+            // Used by `record_audio_processing_call()` to derive the
+            // deadline for a processing call, see the end of `do_process()`.
+            // The event itself is still passed through below.
+            last_sample_rate_.store(option, std::memory_order_relaxed);
+        } break;
+        case effSetBlockSize: {
+            // With the `audio_zero_copy_input` option enabled the mapped
+            // host buffer sizes are derived from this value, so any existing
+            // mapping has to be renegotiated. The event itself is still
+            // passed through below.
+            last_block_size_.store(static_cast<int32_t>(value),
+                                   std::memory_order_relaxed);
+            if (config_.audio_zero_copy_input) {
+                reset_host_buffer_map();
+            }
+        } break;
+        case effSetBypass: {
+            // Used by `try_bypass_passthrough()` when the
+            // `bypass_passthrough` option is enabled. The event itself is
+            // still passed through below so the plugin can engage its own
+            // soft bypass, keeping its state consistent with the host's.
+            host_bypass_active_.store(value != 0, std::memory_order_relaxed);
+        } break;
+        case effProcessEvents: {
+            // Count the batch for the live stats block regardless of which
+            // path ends up delivering it
+            if (const auto* events = static_cast<const VstEvents*>(data);
+                events && events->numEvents > 0) {
+                instance_stats_.add_events(
+                    static_cast<uint64_t>(events->numEvents));
+            }
+
+            // Small batches of MIDI events can be passed to the Wine plugin
+            // host through the shared memory object's event area along with
+            // the next processing cycle instead of being serialized over the
+            // dispatcher socket. SysEx events and oversized batches still
+            // take the regular socket path below. Hosts don't inspect this
+            // function's return value, so we can return immediately.
+            if (process_buffers_ && process_buffers_->has_event_area() &&
+                try_stash_shm_events(*static_cast<const VstEvents*>(data))) {
+                logger_.log_event(true, opcode, index, value, nullptr, option,
+                                  std::nullopt);
+                logger_.log_event_response(true, opcode, 1, nullptr,
+                                           std::nullopt);
+                return 1;
+            }
+        } break;
         case effCanDo: {
             const std::string query(static_cast<const char*>(data));
 
@@ -612,19 +828,231 @@ intptr_t Vst2PluginBridge::dispatch(AEffect* /*plugin*/,
         } break;
     }
 
+    // When the program name table has been prefetched through
+    // `prefetch_program_names()`, the host's program enumeration can be
+    // answered locally instead of being forwarded one round trip at a time.
+    // Queries for indices outside of the cached table are still forwarded.
+    if (opcode == effGetProgramNameIndexed) {
+        std::unique_lock lock(program_names_cache_mutex_);
+        const auto& cache = program_names_cache_.checked(cache_generation_);
+        if (cache && index >= 0 &&
+            static_cast<size_t>(index) < cache->size()) {
+            const Vst2EventResult response{
+                .return_value = 1,
+                .payload = (*cache)[index],
+                .value_payload = std::nullopt};
+            lock.unlock();
+
+            logger_.log_event(true, opcode, index, value, WantsString{},
+                              option, std::nullopt);
+
+            converter.write_data(opcode, data, response);
+
+            const intptr_t return_value =
+                converter.return_value(opcode, response.return_value);
+            logger_.log_event_response(true, opcode, return_value,
+                                       response.payload,
+                                       response.value_payload, true);
+
+            return return_value;
+        }
+    }
+
+    // Hosts re-ask the idempotent query opcodes over and over again while
+    // their UI is open. REAPER for instance re-fetches `effCanDo` and the
+    // vendor and effect names many times per minute per plugin instance.
+    // Since the answers cannot change until the plugin reopens or calls
+    // `audioMasterUpdateDisplay()`/`audioMasterIOChanged()`, repeats can be
+    // answered locally by replaying the previous response instead of making
+    // a full round trip to the Wine plugin host.
+    if (is_idempotent_query_opcode(opcode)) {
+        const Vst2Event::Payload request_payload =
+            converter.read_data(opcode, index, value, data);
+        const std::string_view* query =
+            std::get_if<std::string_view>(&request_payload);
+        std::tuple<int, int, std::string> cache_key(
+            opcode, index, query ? std::string(*query) : std::string());
+
+        std::optional<Vst2EventResult> cached_response{};
+        {
+            std::lock_guard lock(dispatch_query_cache_mutex_);
+            auto& cache = dispatch_query_cache_.checked(cache_generation_);
+            if (const auto it = cache.find(cache_key); it != cache.end()) {
+                cached_response = it->second;
+            }
+        }
+
+        if (cached_response) {
+            logger_.log_event(true, opcode, index, value, request_payload,
+                              option, std::nullopt);
+
+            converter.write_data(opcode, data, *cached_response);
+            converter.write_value(opcode, value, *cached_response);
+
+            const intptr_t return_value = converter.return_value(
+                opcode, cached_response->return_value);
+            logger_.log_event_response(true, opcode, return_value,
+                                       cached_response->payload,
+                                       cached_response->value_payload, true);
+
+            return return_value;
+        }
+
+        const intptr_t return_value =
+            sockets_.host_plugin_dispatch_.send_event(
+                converter, std::pair<Vst2Logger&, bool>(logger_, true), opcode,
+                index, value, data, option);
+
+        // Rebuild the response from what the converter just wrote back to
+        // `data`, so the next identical query can be answered by replaying it
+        // through the same `write_data()` path
+        Vst2EventResult response{.return_value = return_value,
+                                 .payload = nullptr,
+                                 .value_payload = std::nullopt};
+        switch (opcode) {
+            case effGetEffectName:
+            case effGetVendorString:
+            case effGetProductString:
+                response.payload = std::string(static_cast<const char*>(data));
+                break;
+            case effGetParameterProperties:
+                response.payload =
+                    *static_cast<const VstParameterProperties*>(data);
+                break;
+        }
+
+        std::lock_guard lock(dispatch_query_cache_mutex_);
+        auto& cache = dispatch_query_cache_.checked(cache_generation_);
+        cache[std::move(cache_key)] = std::move(response);
+
+        return return_value;
+    }
+
+    // This call blocks until the Wine plugin host's GUI thread gets around to
+    // handling it, so if the host's event loop has stopped making progress
+    // we'll want to tell the user about that first
+    warn_on_stalled_host();
+
     // We don't reuse any buffers here like we do for audio processing. This
     // would be useful for chunk data, but since that's only needed when saving
     // and loading plugin state it's much better to have bitsery or our
     // receiving function temporarily allocate a large enough buffer rather than
     // to have a bunch of allocated memory sitting around doing nothing.
-    return sockets_.host_plugin_dispatch_.send_event(
+    const intptr_t return_value = sockets_.host_plugin_dispatch_.send_event(
         converter, std::pair<Vst2Logger&, bool>(logger_, true), opcode, index,
         value, data, option);
+
+    switch (opcode) {
+        case effOpen:
+            // Now that the plugin has fully initialized itself we can
+            // prefetch its program name table, so the host's program
+            // enumeration can be answered locally
+            prefetch_program_names();
+            break;
+        case effSetProgramName:
+        case effSetChunk:
+            // These may have changed the plugin's program names, so the
+            // table that was cleared before the event gets fetched again
+            prefetch_program_names();
+            break;
+        case effGetTailSize:
+            // The silence detection in `try_bypass_passthrough()` needs to
+            // know the plugin's tail size
+            last_reported_tail_size_.store(return_value,
+                                           std::memory_order_relaxed);
+            break;
+        case effMainsChanged:
+            // With the `bypass_passthrough` option enabled we'll query the
+            // tail size ourselves when audio processing gets resumed, since
+            // not every host does
+            if (config_.bypass_passthrough && value != 0) {
+                last_reported_tail_size_.store(
+                    sockets_.host_plugin_dispatch_.send_event(
+                        converter, std::pair<Vst2Logger&, bool>(logger_, true),
+                        effGetTailSize, 0, 0, nullptr, 0.0f),
+                    std::memory_order_relaxed);
+            }
+            break;
+    }
+
+    return return_value;
 }
 
 template <typename T, bool replacing>
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 void Vst2PluginBridge::do_process(T** inputs, T** outputs, int sample_frames) {
+    // Processing gives the plugin a chance to change its own parameter
+    // values, so the values bundled with the last program change can no
+    // longer be replayed. The flag keeps this to a single relaxed load per
+    // block while no cache is active.
+    if (program_values_cache_armed_.load(std::memory_order_relaxed))
+        [[unlikely]] {
+        clear_program_values_cache();
+    }
+
+    // With the `audio_deadline_ms` option set, a previous processing call may
+    // have overrun its deadline and handed silence back to the host while the
+    // Wine side was still processing the block. No new block can be rung
+    // until that late completion arrives, so in the meantime the host keeps
+    // receiving silence.
+    if (process_overrun_pending_) [[unlikely]] {
+        const std::optional<uint32_t> late_message =
+            process_buffers_->wait_for_completion(std::chrono::milliseconds(0));
+        if (!late_message) {
+            consecutive_process_overruns_ += 1;
+            if (consecutive_process_overruns_ ==
+                process_overrun_escalation_blocks) {
+                logger_.log(
+                    "The plugin has now been stuck inside of its process "
+                    "function for " +
+                    std::to_string(process_overrun_escalation_blocks) +
+                    " blocks in a row. The instance will keep outputting "
+                    "silence, and if the Wine process has died the watchdog "
+                    "will clean it up.");
+            }
+
+            if constexpr (replacing) {
+                for (int channel = 0; channel < plugin_.numOutputs;
+                     channel++) {
+                    std::fill_n(outputs[channel], sample_frames,
+                                static_cast<T>(0.0));
+                }
+            }
+            return;
+        }
+
+        // The late block's outputs belong to a block the host has already
+        // received silence for, so they're simply discarded and processing
+        // resumes with the current block
+        process_overrun_pending_ = false;
+        consecutive_process_overruns_ = 0;
+        if (*late_message == AudioShmBuffer::doorbell_message_terminate) {
+            return;
+        }
+
+        logger_.log(
+            "The plugin finished its overrun block, resuming normal audio "
+            "processing");
+    }
+
+    // With the `bypass_passthrough` option enabled, blocks where the host has
+    // engaged the plugin's soft bypass as well as silent blocks when the
+    // plugin has no tail are handled locally, without a round trip to the
+    // Wine plugin host
+    if (config_.bypass_passthrough &&
+        try_bypass_passthrough<T, replacing>(inputs, outputs, sample_frames)) {
+        return;
+    }
+
+    YABRIDGE_PROBE1(vst2_process_request, sample_frames);
+
+    // Timing brackets for the stats and deadline bookkeeping at the end of
+    // this function, see `record_audio_processing_call()` for the phase
+    // breakdown they feed
+    const auto process_start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration copy_in_time{};
+    std::chrono::steady_clock::duration round_trip_time{};
+
     // During audio processing we'll write the inputs to shared memory buffers,
     // and we'll then send this request alongside it with additional information
     // needed to process audio
@@ -651,15 +1079,16 @@ void Vst2PluginBridge::do_process(T** inputs, T** outputs, int sample_frames) {
     request.current_process_level = static_cast<int>(host_callback_function_(
         &plugin_, audioMasterGetCurrentProcessLevel, 0, 0, nullptr, 0.0));
 
-    // We'll synchronize the scheduling priority of the audio thread on the Wine
-    // plugin host with that of the host's audio thread every once in a while
+    // We'll synchronize the scheduling parameters of the audio thread on the
+    // Wine plugin host with those of the host's audio thread every once in a
+    // while
     const time_t now = time(nullptr);
     if (now > last_audio_thread_priority_synchronization_ +
                   audio_thread_priority_synchronization_interval) {
-        request.new_realtime_priority = get_realtime_priority();
+        request.new_realtime_parameters = get_realtime_parameters();
         last_audio_thread_priority_synchronization_ = now;
     } else {
-        request.new_realtime_priority.reset();
+        request.new_realtime_parameters.reset();
     }
 
     // We reuse this audio buffers object both for the request and the response
@@ -684,42 +1113,265 @@ void Vst2PluginBridge::do_process(T** inputs, T** outputs, int sample_frames) {
     // The host should have called `effMainsChanged()` before sending audio to
     // process
     assert(process_buffers_);
-    for (int channel = 0; channel < plugin_.numInputs; channel++) {
-        T* input_channel = process_buffers_->input_channel_ptr<T>(0, channel);
-        std::copy_n(inputs[channel], sample_frames, input_channel);
+
+    // Before ringing the doorbell we'll also refresh the time info mirror in
+    // the doorbell payload area, so the Wine side can answer
+    // `audioMasterGetTime()` calls made outside of this processing call
+    // without a callback over the socket
+    if (request.current_time_info) {
+        reinterpret_cast<Vst2TimeInfoMirror*>(
+            process_buffers_->doorbell_payload() +
+            vst2_time_info_mirror_offset)
+            ->write(*request.current_time_info);
     }
 
-    // After writing audio to the shared memory buffers, we'll send the
-    // processing request parameters to the Wine plugin host so it can start
-    // processing audio. This is why we don't need any explicit synchronisation.
-    sockets_.host_plugin_process_replacing_.send(request);
+    if (config_.audio_pipelining && process_buffers_->double_buffered()) {
+        // With the `audio_pipelining` option enabled we'll write this block's
+        // inputs to one bank of the shared memory object while the Wine plugin
+        // host may still be processing the previous block in the other bank.
+        // This overlaps the host-side copies with the Wine-side processing at
+        // the cost of one block of added latency.
+        const uint32_t bank = pipelining_bank_;
+        for (int channel = 0; channel < plugin_.numInputs; channel++) {
+            // Channels that only contain digital silence don't need to be
+            // copied. We'll flag them in the request instead and the Wine
+            // side zeroes them out, replacing a read-and-write copy with a
+            // store-only fill. VST2 has no silence flags, so a cheap scan is
+            // the best we can do here.
+            if (channel < 64 &&
+                audio_copy::is_silent(inputs[channel],
+                                      static_cast<size_t>(sample_frames))) {
+                request.silent_input_channels |= 1ull << channel;
+                continue;
+            }
 
-    // From the Wine side we'll send a zero byte struct back as an
-    // acknowledgement that audio processing has finished. At this point the
-    // audio will have been written to our buffers.
-    sockets_.host_plugin_process_replacing_.receive_single<Ack>();
+            T* input_channel =
+                process_buffers_->input_channel_ptr<T>(bank, 0, channel);
+            std::copy_n(inputs[channel], sample_frames, input_channel);
+        }
 
-    for (int channel = 0; channel < plugin_.numOutputs; channel++) {
-        const T* output_channel =
-            process_buffers_->output_channel_ptr<T>(0, channel);
+        // Each bank has its own metadata slot, so this can't overwrite the
+        // information belonging to a block that's still being processed
+        auto& metadata = reinterpret_cast<Vst2ProcessMetadata*>(
+            process_buffers_->doorbell_payload())[bank];
+        metadata.from_request(request);
+        metadata.bank = bank;
+
+        // MIDI events stashed during `effProcessEvents()` are passed along
+        // through this bank's event area
+        if (!pending_shm_events_.empty()) {
+            std::copy(pending_shm_events_.begin(), pending_shm_events_.end(),
+                      reinterpret_cast<VstEvent*>(
+                          process_buffers_->event_area_ptr(bank)));
+            metadata.num_shm_events =
+                static_cast<uint32_t>(pending_shm_events_.size());
+            pending_shm_events_.clear();
+        }
 
-        if constexpr (replacing) {
-            std::copy_n(output_channel, sample_frames, outputs[channel]);
-        } else {
-            // The old `process()` function expects the plugin to add its output
-            // to the accumulated values in `outputs`. Since no host is ever
-            // going to call this anyways we won't even bother with a separate
-            // implementation and we'll just add `processReplacing()` results to
-            // `outputs`.
-            // We could use `std::execution::unseq` here but that would require
-            // linking to TBB and since this probably won't ever be used anyways
-            // that's a bit of a waste.
-            std::transform(output_channel, output_channel + sample_frames,
-                           outputs[channel], outputs[channel],
-                           [](const T& new_value, T& current_value) -> T {
-                               return new_value + current_value;
-                           });
+        // Before ringing the doorbell for this block we do need to wait until
+        // the previous block has finished processing
+        copy_in_time = std::chrono::steady_clock::now() - process_start;
+        const bool have_previous_block = pipelining_block_in_flight_;
+        if (have_previous_block) {
+            pipelining_block_in_flight_ = false;
+            const auto wait_start = std::chrono::steady_clock::now();
+            if (!wait_for_process_completion()) {
+                // When the previous block overran its deadline the host gets
+                // silence, and this block's already written inputs are never
+                // rung. They'll simply be overwritten by a later block once
+                // the Wine side has caught up.
+                if constexpr (replacing) {
+                    if (process_overrun_pending_) {
+                        for (int channel = 0; channel < plugin_.numOutputs;
+                             channel++) {
+                            std::fill_n(outputs[channel], sample_frames,
+                                        static_cast<T>(0.0));
+                        }
+                    }
+                }
+                return;
+            }
+            round_trip_time = std::chrono::steady_clock::now() - wait_start;
+        }
+
+        process_buffers_->ring(
+            bank == 0 ? AudioShmBuffer::doorbell_message_process
+                      : AudioShmBuffer::doorbell_message_process_secondary);
+        pipelining_block_in_flight_ = true;
+
+        // While the Wine plugin host is processing this block, we'll hand the
+        // previous block's outputs from the other bank back to the host. If
+        // there is no previous block yet, or if the host suddenly changed its
+        // block size, then (the remainder of) the outputs will be zeroed out.
+        const uint32_t previous_bank = bank ^ 1;
+        const int previous_sample_frames =
+            have_previous_block
+                ? std::min(pipelining_prev_sample_frames_, sample_frames)
+                : 0;
+        for (int channel = 0; channel < plugin_.numOutputs; channel++) {
+            const T* output_channel = process_buffers_->output_channel_ptr<T>(
+                previous_bank, 0, channel);
+
+            if constexpr (replacing) {
+                std::copy_n(output_channel, previous_sample_frames,
+                            outputs[channel]);
+                std::fill(outputs[channel] + previous_sample_frames,
+                          outputs[channel] + sample_frames,
+                          static_cast<T>(0.0));
+            } else {
+                // See the note on accumulating outputs in the synchronous
+                // path below
+                std::transform(output_channel,
+                               output_channel + previous_sample_frames,
+                               outputs[channel], outputs[channel],
+                               [](const T& new_value, T& current_value) -> T {
+                                   return new_value + current_value;
+                               });
+            }
         }
+
+        pipelining_prev_sample_frames_ = sample_frames;
+        pipelining_bank_ = previous_bank;
+    } else {
+        // With the `audio_zero_copy_input` option enabled and the host's
+        // buffers successfully mapped on the Wine side, the plugin reads its
+        // inputs straight from the host's own buffers and both the input
+        // copy and the silent channel scan are skipped. With
+        // `audio_zero_copy_output` the plugin also writes its outputs
+        // straight into the host's buffers before signaling completion, so
+        // the copy out after the wait below is skipped as well. The
+        // pipelined path above can't use either since the host reuses its
+        // buffers for the next block while the Wine side is still working
+        // on the previous one.
+        if (config_.audio_zero_copy_input || config_.audio_zero_copy_output) {
+            // The accumulating `process()` path has to add the plugin's
+            // outputs to the host's buffers, so only `processReplacing()`
+            // can write them directly
+            const void* const* output_pointers = nullptr;
+            if constexpr (replacing) {
+                output_pointers =
+                    reinterpret_cast<const void* const*>(outputs);
+            }
+            std::tie(request.use_mapped_inputs, request.use_mapped_outputs) =
+                try_use_mapped_host_buffers(
+                    reinterpret_cast<const void* const*>(inputs),
+                    output_pointers, sizeof(T),
+                    static_cast<size_t>(sample_frames) * sizeof(T));
+        }
+
+        for (int channel = 0;
+             !request.use_mapped_inputs && channel < plugin_.numInputs;
+             channel++) {
+            // See the note on silent channels in the pipelining path above
+            if (channel < 64 &&
+                audio_copy::is_silent(inputs[channel],
+                                      static_cast<size_t>(sample_frames))) {
+                request.silent_input_channels |= 1ull << channel;
+                continue;
+            }
+
+            T* input_channel =
+                process_buffers_->input_channel_ptr<T>(0, channel);
+            std::copy_n(inputs[channel], sample_frames, input_channel);
+        }
+
+        // After writing audio to the shared memory buffers, we'll write the
+        // processing request parameters to the doorbell payload area in that
+        // same shared memory object and ring the doorbell so the Wine plugin
+        // host can start processing audio. This used to involve serializing a
+        // `Vst2ProcessRequest` over the audio socket, but at small buffer
+        // sizes those ~1500 socket round trips per second per instance added
+        // up. This is why we don't need any explicit synchronisation.
+        auto& metadata = *reinterpret_cast<Vst2ProcessMetadata*>(
+            process_buffers_->doorbell_payload());
+        metadata.from_request(request);
+
+        // MIDI events stashed during `effProcessEvents()` are passed along
+        // through the event area
+        if (!pending_shm_events_.empty()) {
+            std::copy(pending_shm_events_.begin(), pending_shm_events_.end(),
+                      reinterpret_cast<VstEvent*>(
+                          process_buffers_->event_area_ptr(0)));
+            metadata.num_shm_events =
+                static_cast<uint32_t>(pending_shm_events_.size());
+            pending_shm_events_.clear();
+        }
+
+        copy_in_time = std::chrono::steady_clock::now() - process_start;
+        process_buffers_->ring(AudioShmBuffer::doorbell_message_process);
+
+        // The Wine side will ring the completion futex when audio processing
+        // has finished, as the equivalent of the old `Ack` message. At this
+        // point the audio will have been written to our buffers.
+        if (!wait_for_process_completion()) {
+            // See the note on overruns in the pipelined path above
+            if constexpr (replacing) {
+                if (process_overrun_pending_) {
+                    for (int channel = 0; channel < plugin_.numOutputs;
+                         channel++) {
+                        std::fill_n(outputs[channel], sample_frames,
+                                    static_cast<T>(0.0));
+                    }
+                }
+            }
+            return;
+        }
+        round_trip_time =
+            std::chrono::steady_clock::now() - process_start - copy_in_time;
+
+        // When the outputs were written straight into the host's mapped
+        // buffers there's nothing left to do here, which is the whole point:
+        // the work on the host's audio thread after the plugin finishes
+        // shrinks to this flag check
+        for (int channel = 0;
+             !request.use_mapped_outputs && channel < plugin_.numOutputs;
+             channel++) {
+            const T* output_channel =
+                process_buffers_->output_channel_ptr<T>(0, channel);
+
+            if constexpr (replacing) {
+                std::copy_n(output_channel, sample_frames, outputs[channel]);
+            } else {
+                // The old `process()` function expects the plugin to add its
+                // output to the accumulated values in `outputs`. Since no host
+                // is ever going to call this anyways we won't even bother with
+                // a separate implementation and we'll just add
+                // `processReplacing()` results to `outputs`.
+                // We could use `std::execution::unseq` here but that would
+                // require linking to TBB and since this probably won't ever be
+                // used anyways that's a bit of a waste.
+                std::transform(output_channel, output_channel + sample_frames,
+                               outputs[channel], outputs[channel],
+                               [](const T& new_value, T& current_value) -> T {
+                                   return new_value + current_value;
+                               });
+            }
+        }
+    }
+
+    // VST2 bridges a single instance per endpoint, so there's no instance ID
+    // to attribute the miss to. Events are counted in `effProcessEvents()`
+    // instead of here.
+    record_audio_processing_call(0,
+                                 static_cast<double>(last_sample_rate_.load(
+                                     std::memory_order_relaxed)),
+                                 static_cast<uint32_t>(sample_frames), 0,
+                                 process_start, copy_in_time, round_trip_time);
+
+    YABRIDGE_PROBE(vst2_process_response);
+
+    // The Wine side republishes the plugin's `AEffect` values to a mirror in
+    // the doorbell payload area after every block where they changed. If
+    // that's happened we'll refresh our copy of the struct right away, making
+    // for instance latency changes through `initialDelay` visible to the host
+    // a block sooner than the `audioMasterIOChanged()` notification would.
+    // This is a single load and compare in the common unchanged case.
+    if (const std::optional<uint32_t> new_sequence =
+            reinterpret_cast<const Vst2AEffectMirror*>(
+                process_buffers_->doorbell_payload() +
+                vst2_aeffect_mirror_offset)
+                ->read_if_changed(plugin_, aeffect_mirror_sequence_)) {
+        aeffect_mirror_sequence_ = *new_sequence;
     }
 
     // Plugins are allowed to send MIDI events during processing using a host
@@ -737,6 +1389,628 @@ void Vst2PluginBridge::do_process(T** inputs, T** outputs, int sample_frames) {
     incoming_midi_events_.clear();
 }
 
+template <typename T, bool replacing>
+bool Vst2PluginBridge::try_bypass_passthrough(T** inputs,
+                                              T** outputs,
+                                              int sample_frames) {
+    // A plain copy would break the host's delay compensation when the plugin
+    // reports latency, and stashed MIDI events should reach the plugin with
+    // the block they belong to
+    if (!process_buffers_ || plugin_.initialDelay != 0 ||
+        !pending_shm_events_.empty()) {
+        return false;
+    }
+
+    const bool bypassed = host_bypass_active_.load(std::memory_order_relaxed);
+    if (!bypassed) {
+        // Without an explicit bypass the round trip can still be skipped when
+        // the inputs are digital silence and the plugin has declared that it
+        // has no tail. Return values of both 0 and 1 mean no tail, and -1
+        // means that we don't know the tail size.
+        const intptr_t tail_size =
+            last_reported_tail_size_.load(std::memory_order_relaxed);
+        if (tail_size < 0 || tail_size > 1) {
+            return false;
+        }
+
+        for (int channel = 0; channel < plugin_.numInputs; channel++) {
+            if (!audio_copy::is_silent(inputs[channel],
+                                       static_cast<size_t>(sample_frames))) {
+                return false;
+            }
+        }
+    }
+
+    // A pipelined block that's still in flight gets drained first. Its
+    // outputs are the last block the plugin actually processed, which is
+    // exactly what the host should receive next at the one block of latency
+    // the pipelined path already has.
+    if (pipelining_block_in_flight_) {
+        pipelining_block_in_flight_ = false;
+        if (!wait_for_process_completion()) {
+            // See the note on overruns in `do_process()`
+            if constexpr (replacing) {
+                if (process_overrun_pending_) {
+                    for (int channel = 0; channel < plugin_.numOutputs;
+                         channel++) {
+                        std::fill_n(outputs[channel], sample_frames,
+                                    static_cast<T>(0.0));
+                    }
+                }
+            }
+            return true;
+        }
+
+        const uint32_t previous_bank = pipelining_bank_ ^ 1;
+        const int previous_sample_frames =
+            std::min(pipelining_prev_sample_frames_, sample_frames);
+        for (int channel = 0; channel < plugin_.numOutputs; channel++) {
+            const T* output_channel = process_buffers_->output_channel_ptr<T>(
+                previous_bank, 0, channel);
+
+            if constexpr (replacing) {
+                std::copy_n(output_channel, previous_sample_frames,
+                            outputs[channel]);
+                std::fill(outputs[channel] + previous_sample_frames,
+                          outputs[channel] + sample_frames,
+                          static_cast<T>(0.0));
+            } else {
+                std::transform(output_channel,
+                               output_channel + previous_sample_frames,
+                               outputs[channel], outputs[channel],
+                               [](const T& new_value, T& current_value) -> T {
+                                   return new_value + current_value;
+                               });
+            }
+        }
+
+        return true;
+    }
+
+    // In the bypassed case the inputs get copied straight to the outputs. In
+    // the silent case those inputs are all zeroes, so the same copy results
+    // in the digital silence we want to output. Output channels beyond the
+    // plugin's inputs are zeroed out.
+    for (int channel = 0; channel < plugin_.numOutputs; channel++) {
+        if constexpr (replacing) {
+            if (channel < plugin_.numInputs) {
+                std::copy_n(inputs[channel], sample_frames, outputs[channel]);
+            } else {
+                std::fill_n(outputs[channel], sample_frames,
+                            static_cast<T>(0.0));
+            }
+        } else {
+            // See the note on accumulating outputs in `do_process()`
+            if (channel < plugin_.numInputs) {
+                std::transform(inputs[channel],
+                               inputs[channel] + sample_frames,
+                               outputs[channel], outputs[channel],
+                               [](const T& new_value, T& current_value) -> T {
+                                   return new_value + current_value;
+                               });
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Vst2PluginBridge::try_stash_shm_events(const VstEvents& events) {
+    if (events.numEvents < 0 ||
+        pending_shm_events_.size() + static_cast<size_t>(events.numEvents) >
+            vst2_shm_max_events) {
+        return false;
+    }
+
+    // SysEx events contain pointers to variable length data, so they can't be
+    // passed through the fixed size event area
+    for (int i = 0; i < events.numEvents; i++) {
+        const auto* sysex_event =
+            reinterpret_cast<const VstMidiSysExEvent*>(events.events[i]);
+        if (sysex_event->type == kVstSysExType) {
+            return false;
+        }
+    }
+
+    // Hosts virtually always send all of a block's events in a single
+    // `effProcessEvents()` call, but appending here also covers the hosts
+    // that don't
+    for (int i = 0; i < events.numEvents; i++) {
+        pending_shm_events_.push_back(*events.events[i]);
+    }
+
+    return true;
+}
+
+void Vst2PluginBridge::clear_dispatch_query_cache() noexcept {
+    std::lock_guard lock(dispatch_query_cache_mutex_);
+    dispatch_query_cache_.clear();
+}
+
+/**
+ * Stores the `Vst2ProgramNames` response to the bulk program name prefetch,
+ * see `Vst2PluginBridge::prefetch_program_names()`. This yabridge-internal
+ * event has no data pointer to write anything back to.
+ */
+class ProgramNamesDataConverter : public DefaultDataConverter {
+   public:
+    void write_data(const int /*opcode*/,
+                    void* /*data*/,
+                    const Vst2EventResult& response) const override {
+        if (const auto* program_names =
+                std::get_if<Vst2ProgramNames>(&response.payload)) {
+            names_ = program_names->names;
+        }
+    }
+
+    mutable std::vector<std::string> names_;
+};
+
+void Vst2PluginBridge::prefetch_program_names() {
+    std::lock_guard lock(program_names_prefetch_mutex_);
+
+    // Assigning the new thread joins the previous prefetch first, so there's
+    // never more than one prefetch in flight
+    program_names_prefetch_thread_ = std::jthread([&]() {
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("program-names");
+
+        ProgramNamesDataConverter converter{};
+        try {
+            if (sockets_.host_plugin_dispatch_.send_event(
+                    converter, std::pair<Vst2Logger&, bool>(logger_, true),
+                    vst2_get_program_names_opcode, 0, 0, nullptr, 0.0f) == 0) {
+                // The plugin doesn't support `effGetProgramNameIndexed()`,
+                // so the host's queries will just keep being forwarded
+                return;
+            }
+        } catch (const std::system_error&) {
+            // Thrown when the sockets get closed because the plugin is being
+            // shut down while the prefetch was still in flight
+            return;
+        }
+
+        std::lock_guard cache_lock(program_names_cache_mutex_);
+        program_names_cache_.checked(cache_generation_) =
+            std::move(converter.names_);
+    });
+}
+
+void Vst2PluginBridge::clear_program_names_cache() noexcept {
+    std::lock_guard lock(program_names_cache_mutex_);
+    program_names_cache_.clear();
+}
+
+void Vst2PluginBridge::clear_program_values_cache() noexcept {
+    std::lock_guard lock(program_values_cache_mutex_);
+    program_values_cache_.clear();
+    program_values_cache_armed_.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * A shared, file backed mapping parsed from `/proc/self/maps`. Used by the
+ * `audio_zero_copy_input` and `audio_zero_copy_output` options to detect
+ * host audio buffers that live in shareable memory, see
+ * `Vst2PluginBridge::try_use_mapped_host_buffers()`.
+ */
+struct SharedFileMapping {
+    uintptr_t start;
+    uintptr_t end;
+    uint64_t file_offset;
+    dev_t device;
+    ino_t inode;
+};
+
+/**
+ * Parse the shared, file backed mappings out of this process'
+ * `/proc/self/maps`. These are the only mappings another process could ever
+ * map as well, since private and anonymous memory has no handle to share.
+ * memfd backed buffers, like the ones PipeWire hands out, show up here as
+ * regular files on the tmpfs device.
+ */
+std::vector<SharedFileMapping> parse_shared_file_mappings() {
+    std::vector<SharedFileMapping> mappings{};
+
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        unsigned long long start = 0;
+        unsigned long long end = 0;
+        char permissions[5] = {0};
+        unsigned long long file_offset = 0;
+        unsigned int device_major = 0;
+        unsigned int device_minor = 0;
+        unsigned long long inode = 0;
+        if (sscanf(line.c_str(), "%llx-%llx %4s %llx %x:%x %llu", &start,
+                   &end, permissions, &file_offset, &device_major,
+                   &device_minor, &inode) != 7) {
+            continue;
+        }
+
+        if (permissions[3] != 's' || inode == 0) {
+            continue;
+        }
+
+        mappings.push_back(SharedFileMapping{
+            .start = static_cast<uintptr_t>(start),
+            .end = static_cast<uintptr_t>(end),
+            .file_offset = file_offset,
+            .device = makedev(device_major, device_minor),
+            .inode = static_cast<ino_t>(inode)});
+    }
+
+    return mappings;
+}
+
+/**
+ * Find an open file descriptor in this process that refers to the given
+ * file, by scanning `/proc/self/fd`. The host necessarily holds one for
+ * every shared file backed mapping it has created, and the Wine plugin host
+ * can then reopen that descriptor through `/proc/<pid>/fd/`.
+ */
+std::optional<int> find_backing_file_descriptor(const dev_t device,
+                                                const ino_t inode) {
+    DIR* fd_dir = opendir("/proc/self/fd");
+    if (!fd_dir) {
+        return std::nullopt;
+    }
+
+    std::optional<int> result{};
+    while (const dirent* entry = readdir(fd_dir)) {
+        // This also skips the `.` and `..` entries along with the standard
+        // streams
+        const int fd = atoi(entry->d_name);
+        if (fd <= 2) {
+            continue;
+        }
+
+        struct stat file_info {};
+        if (fstat(fd, &file_info) == 0 && file_info.st_dev == device &&
+            file_info.st_ino == inode) {
+            result = fd;
+            break;
+        }
+    }
+    closedir(fd_dir);
+
+    return result;
+}
+
+/**
+ * Resolve one direction's host buffer pointers to `Vst2HostBufferMap`
+ * channel entries, if all of them turn out to live in shared, file backed
+ * memory. Returns a nullopt when any channel lives in plain private memory
+ * or when no file descriptor for its backing file could be found, in which
+ * case the copy for that direction stays in place.
+ */
+std::optional<std::vector<Vst2HostBufferMap::Channel>>
+detect_host_buffer_channels(const std::vector<SharedFileMapping>& mappings,
+                            const std::vector<const void*>& pointers,
+                            const size_t channel_size) {
+    std::vector<Vst2HostBufferMap::Channel> channels{};
+    channels.reserve(pointers.size());
+    for (const void* pointer : pointers) {
+        const auto address = reinterpret_cast<uintptr_t>(pointer);
+        const auto mapping = std::find_if(
+            mappings.begin(), mappings.end(),
+            [&](const SharedFileMapping& candidate) {
+                return address >= candidate.start &&
+                       address + channel_size <= candidate.end;
+            });
+        if (mapping == mappings.end()) {
+            return std::nullopt;
+        }
+
+        const std::optional<int> fd =
+            find_backing_file_descriptor(mapping->device, mapping->inode);
+        if (!fd) {
+            return std::nullopt;
+        }
+
+        channels.push_back(Vst2HostBufferMap::Channel{
+            .fd = *fd,
+            .offset = mapping->file_offset + (address - mapping->start)});
+    }
+
+    return channels;
+}
+
+/**
+ * Build the `Vst2HostBufferMap` for the host's buffers. Either pointer list
+ * may be empty when that direction isn't being negotiated, and a direction
+ * whose buffers turn out to live in plain private memory is simply left out
+ * of the map so the other direction can still be mapped on its own. Returns
+ * a nullopt when neither direction could be resolved, in which case there's
+ * nothing to offer the Wine side.
+ */
+std::optional<Vst2HostBufferMap> detect_host_buffer_map(
+    const std::vector<const void*>& inputs,
+    const std::vector<const void*>& outputs,
+    const size_t channel_size) {
+    const std::vector<SharedFileMapping> mappings =
+        parse_shared_file_mappings();
+
+    Vst2HostBufferMap buffer_map{.pid = getpid(),
+                                 .channel_size = channel_size,
+                                 .channels = {},
+                                 .output_channels = {}};
+    if (!inputs.empty()) {
+        if (auto channels =
+                detect_host_buffer_channels(mappings, inputs, channel_size)) {
+            buffer_map.channels = std::move(*channels);
+        }
+    }
+    if (!outputs.empty()) {
+        if (auto channels = detect_host_buffer_channels(mappings, outputs,
+                                                        channel_size)) {
+            buffer_map.output_channels = std::move(*channels);
+        }
+    }
+
+    if (buffer_map.channels.empty() && buffer_map.output_channels.empty()) {
+        return std::nullopt;
+    }
+
+    return buffer_map;
+}
+
+/**
+ * Sends the `Vst2HostBufferMap` built during the negotiation in
+ * `Vst2PluginBridge::try_use_mapped_host_buffers()`. The Wine side only
+ * responds with a return value, so the default response handling suffices.
+ */
+class HostBufferMapDataConverter : public DefaultDataConverter {
+   public:
+    explicit HostBufferMapDataConverter(Vst2HostBufferMap buffer_map) noexcept
+        : buffer_map_(std::move(buffer_map)) {}
+
+    Vst2Event::Payload read_data(const int /*opcode*/,
+                                 const int /*index*/,
+                                 const intptr_t /*value*/,
+                                 const void* /*data*/) const override {
+        return buffer_map_;
+    }
+
+   private:
+    Vst2HostBufferMap buffer_map_;
+};
+
+std::pair<bool, bool> Vst2PluginBridge::try_use_mapped_host_buffers(
+    const void* const* inputs,
+    const void* const* outputs,
+    const size_t sample_size,
+    const size_t block_bytes) {
+    // While a negotiation is in flight the Wine side may be replacing its
+    // mappings at this very moment, so nothing may be flagged until the
+    // response has come in
+    if (host_buffer_map_in_flight_.load(std::memory_order_acquire)) {
+        return {false, false};
+    }
+
+    // Directly written outputs would still be scribbled into after the
+    // host has moved on when a block overruns its deadline, so the output
+    // direction is skipped entirely with `audio_deadline_ms` set
+    const bool want_inputs =
+        config_.audio_zero_copy_input && plugin_.numInputs > 0;
+    const bool want_outputs = config_.audio_zero_copy_output &&
+                              config_.audio_deadline_ms == 0 &&
+                              outputs != nullptr && plugin_.numOutputs > 0;
+
+    bool inputs_match = false;
+    bool outputs_match = false;
+    {
+        std::lock_guard lock(mapped_host_buffers_mutex_);
+        if (block_bytes <= mapped_host_buffers_bytes_) {
+            inputs_match =
+                want_inputs && !mapped_host_inputs_.empty() &&
+                std::equal(mapped_host_inputs_.begin(),
+                           mapped_host_inputs_.end(), inputs);
+            outputs_match =
+                want_outputs && !mapped_host_outputs_.empty() &&
+                std::equal(mapped_host_outputs_.begin(),
+                           mapped_host_outputs_.end(), outputs);
+        }
+    }
+    if ((inputs_match || !want_inputs) && (outputs_match || !want_outputs)) {
+        return {inputs_match, outputs_match};
+    }
+
+    // The host is processing from buffers the Wine side doesn't have mapped.
+    // If there's still negotiation budget left we'll scan procfs on a
+    // background thread and offer the current buffers for mapping, while
+    // this block and every block until the response arrives gets copied as
+    // usual. The mapped buffer sizes are derived from the maximum block size
+    // the host announced through `effSetBlockSize()`, so without one no
+    // mapping is attempted.
+    const int32_t block_size =
+        last_block_size_.load(std::memory_order_relaxed);
+    if (block_size <= 0 || (!want_inputs && !want_outputs) ||
+        host_buffer_map_attempts_.load(std::memory_order_relaxed) >=
+            max_host_buffer_map_attempts) {
+        // A direction that still matches the active mapping can keep using
+        // it even when the budget for remapping the other one has run out
+        return {inputs_match, outputs_match};
+    }
+
+    host_buffer_map_attempts_.fetch_add(1, std::memory_order_relaxed);
+    host_buffer_map_in_flight_.store(true, std::memory_order_release);
+
+    // If the host ever switches precisions its buffers will be different
+    // ones anyway, so the channel size only needs to cover the precision
+    // it's processing with right now
+    const size_t channel_size =
+        static_cast<size_t>(block_size) * sample_size;
+    std::vector<const void*> input_pointers{};
+    if (want_inputs) {
+        input_pointers.assign(inputs, inputs + plugin_.numInputs);
+    }
+    std::vector<const void*> output_pointers{};
+    if (want_outputs) {
+        output_pointers.assign(outputs, outputs + plugin_.numOutputs);
+    }
+    host_buffer_map_thread_ = std::jthread(
+        [&, channel_size, input_pointers = std::move(input_pointers),
+         output_pointers = std::move(output_pointers)]() mutable {
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("buffer-map");
+
+            std::optional<Vst2HostBufferMap> buffer_map =
+                detect_host_buffer_map(input_pointers, output_pointers,
+                                       channel_size);
+            if (buffer_map) {
+                // A direction whose buffers turned out to live in private
+                // memory was left out of the map, and its copy stays in
+                // place
+                const bool mapped_inputs = !buffer_map->channels.empty();
+                const bool mapped_outputs =
+                    !buffer_map->output_channels.empty();
+                HostBufferMapDataConverter converter(std::move(*buffer_map));
+                try {
+                    if (sockets_.host_plugin_dispatch_.send_event(
+                            converter,
+                            std::pair<Vst2Logger&, bool>(logger_, true),
+                            vst2_map_host_buffers_opcode, 0, 0, nullptr,
+                            0.0f) == 1) {
+                        std::lock_guard lock(mapped_host_buffers_mutex_);
+                        if (mapped_inputs) {
+                            mapped_host_inputs_ = std::move(input_pointers);
+                        } else {
+                            mapped_host_inputs_.clear();
+                        }
+                        if (mapped_outputs) {
+                            mapped_host_outputs_ = std::move(output_pointers);
+                        } else {
+                            mapped_host_outputs_.clear();
+                        }
+                        mapped_host_buffers_bytes_ = channel_size;
+                    }
+                } catch (const std::system_error&) {
+                    // Thrown when the sockets get closed because the plugin
+                    // is being shut down while the negotiation was still in
+                    // flight
+                }
+            }
+
+            host_buffer_map_in_flight_.store(false,
+                                             std::memory_order_release);
+        });
+
+    return {false, false};
+}
+
+void Vst2PluginBridge::reset_host_buffer_map() noexcept {
+    {
+        std::lock_guard lock(mapped_host_buffers_mutex_);
+        mapped_host_inputs_.clear();
+        mapped_host_outputs_.clear();
+        mapped_host_buffers_bytes_ = 0;
+    }
+    host_buffer_map_attempts_.store(0, std::memory_order_relaxed);
+}
+
+bool Vst2PluginBridge::wait_for_process_completion() {
+    // With the `audio_deadline_ms` option set we'll only wait this long for
+    // the response. When the deadline is overrun the host gets silence for
+    // this block, and `do_process()` keeps polling for the late completion
+    // before ringing any new blocks.
+    if (config_.audio_deadline_ms > 0) {
+        const std::optional<uint32_t> message =
+            process_buffers_->wait_for_completion(
+                std::chrono::milliseconds(config_.audio_deadline_ms));
+        if (message) {
+            consecutive_process_overruns_ = 0;
+
+            return *message != AudioShmBuffer::doorbell_message_terminate;
+        }
+
+        if (!plugin_host_->running()) {
+            logger_.log(
+                "The Wine process exited during audio processing, not "
+                "waiting for a response");
+            return false;
+        }
+
+        process_overrun_pending_ = true;
+        consecutive_process_overruns_ += 1;
+        logger_.log(
+            "The plugin did not process its block within " +
+            std::to_string(config_.audio_deadline_ms) +
+            " ms, handing silence back to the host while it catches up");
+
+        return false;
+    }
+
+    // Unlike a socket, a futex wait doesn't get interrupted when the other
+    // process dies, so we'll wait with a timeout and check whether the Wine
+    // process is still running before waiting again
+    while (true) {
+        const std::optional<uint32_t> message =
+            process_buffers_->wait_for_completion(
+                std::chrono::milliseconds(1000));
+        if (!message) {
+            if (!plugin_host_->running()) {
+                logger_.log(
+                    "The Wine process exited during audio processing, not "
+                    "waiting for a response");
+                return false;
+            }
+
+            continue;
+        }
+
+        if (*message == AudioShmBuffer::doorbell_message_terminate)
+            [[unlikely]] {
+            // The Wine side is shutting down, so there's no audio to copy back
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool Vst2PluginBridge::send_parameter_mailbox(const Parameter& request,
+                                              ParameterResult& response) {
+    // The mailbox lives in the doorbell page of the shared memory object, so
+    // calls made before `effMainsChanged()` still use the parameters socket
+    if (!process_buffers_ || !process_buffers_->has_doorbell()) {
+        return false;
+    }
+
+    auto& mailbox = *reinterpret_cast<Vst2ParameterMailbox*>(
+        process_buffers_->doorbell_payload() + vst2_parameter_mailbox_offset);
+    mailbox.write_request(request);
+    process_buffers_->ring_rpc();
+
+    // Same liveness checking as in `wait_for_process_completion()`, since a
+    // futex wait doesn't get interrupted when the other process dies
+    while (true) {
+        const std::optional<uint32_t> message =
+            process_buffers_->wait_for_rpc_completion(
+                std::chrono::milliseconds(1000));
+        if (!message) {
+            if (!plugin_host_->running()) {
+                logger_.log(
+                    "The Wine process exited during a parameter call, not "
+                    "waiting for a response");
+                return false;
+            }
+
+            continue;
+        }
+
+        if (*message == AudioShmBuffer::doorbell_message_terminate)
+            [[unlikely]] {
+            return false;
+        }
+
+        break;
+    }
+
+    mailbox.read_response(response);
+
+    return true;
+}
+
 void Vst2PluginBridge::process(AEffect* /*plugin*/,
                                float** inputs,
                                float** outputs,
@@ -744,32 +2018,52 @@ void Vst2PluginBridge::process(AEffect* /*plugin*/,
     // Technically either `Vst2PluginBridge::process()` or
     // `Vst2PluginBridge::process_replacing()` could actually call the other
     // function on the plugin depending on what the plugin supports.
-    logger_.log_trace([]() { return ">> process() :: start"; });
+    logger_.log_audio_trace([]() { return ">> process() :: start"; });
     do_process<float, false>(inputs, outputs, sample_frames);
-    logger_.log_trace([]() { return "   process() :: end"; });
+    logger_.log_audio_trace([]() { return "   process() :: end"; });
 }
 
 void Vst2PluginBridge::process_replacing(AEffect* /*plugin*/,
                                          float** inputs,
                                          float** outputs,
                                          int sample_frames) {
-    logger_.log_trace([]() { return ">> processReplacing() :: start"; });
+    startup_trace_first_audio();
+
+    logger_.log_audio_trace([]() { return ">> processReplacing() :: start"; });
     do_process<float, true>(inputs, outputs, sample_frames);
-    logger_.log_trace([]() { return "   processReplacing() :: end"; });
+    logger_.log_audio_trace([]() { return "   processReplacing() :: end"; });
 }
 
 void Vst2PluginBridge::process_double_replacing(AEffect* /*plugin*/,
                                                 double** inputs,
                                                 double** outputs,
                                                 int sample_frames) {
-    logger_.log_trace([]() { return ">> processDoubleReplacing() :: start"; });
+    logger_.log_audio_trace(
+        []() { return ">> processDoubleReplacing() :: start"; });
     do_process<double, true>(inputs, outputs, sample_frames);
-    logger_.log_trace([]() { return "   processDoubleReplacing() :: end"; });
+    logger_.log_audio_trace(
+        []() { return "   processDoubleReplacing() :: end"; });
 }
 
 float Vst2PluginBridge::get_parameter(AEffect* /*plugin*/, int index) {
     logger_.log_get_parameter(index);
 
+    // Hosts re-read every parameter right after a program change, and the
+    // `effSetProgram()` response already contained all of the new values so
+    // that burst can be answered locally, see `Vst2ProgramBundle`
+    {
+        std::lock_guard lock(program_values_cache_mutex_);
+        const auto& cache =
+            program_values_cache_.checked(cache_generation_);
+        if (cache && index >= 0 &&
+            static_cast<size_t>(index) < cache->size()) {
+            const float value = (*cache)[index];
+            logger_.log_get_parameter_response(value);
+
+            return value;
+        }
+    }
+
     const Parameter request{index, std::nullopt};
     ParameterResult response;
 
@@ -777,10 +2071,15 @@ float Vst2PluginBridge::get_parameter(AEffect* /*plugin*/, int index) {
     // called at the same time since  they share the same socket
     {
         std::lock_guard lock(parameters_mutex_);
-        sockets_.host_plugin_parameters_.send(request);
-
-        response =
-            sockets_.host_plugin_parameters_.receive_single<ParameterResult>();
+        // Once the shared memory object exists these calls go through the
+        // parameter mailbox in its doorbell page, skipping the socket round
+        // trip
+        if (!send_parameter_mailbox(request, response)) {
+            sockets_.host_plugin_parameters_.send(request);
+
+            response = sockets_.host_plugin_parameters_
+                           .receive_single<ParameterResult>();
+        }
     }
 
     logger_.log_get_parameter_response(*response.value);
@@ -793,15 +2092,24 @@ void Vst2PluginBridge::set_parameter(AEffect* /*plugin*/,
                                      float value) {
     logger_.log_set_parameter(index, value);
 
+    // The host writing a value invalidates the values bundled with the last
+    // program change, since the plugin may respond by adjusting other
+    // (linked) parameters as well
+    if (program_values_cache_armed_.load(std::memory_order_relaxed)) {
+        clear_program_values_cache();
+    }
+
     const Parameter request{index, value};
     ParameterResult response;
 
     {
         std::lock_guard lock(parameters_mutex_);
-        sockets_.host_plugin_parameters_.send(request);
+        if (!send_parameter_mailbox(request, response)) {
+            sockets_.host_plugin_parameters_.send(request);
 
-        response =
-            sockets_.host_plugin_parameters_.receive_single<ParameterResult>();
+            response = sockets_.host_plugin_parameters_
+                           .receive_single<ParameterResult>();
+        }
     }
 
     logger_.log_set_parameter_response();
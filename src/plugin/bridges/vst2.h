@@ -19,10 +19,15 @@
 #include <vestige/aeffectx.h>
 
 #include <asio/io_context.hpp>
+#include <atomic>
+#include <map>
 #include <thread>
+#include <tuple>
+#include <utility>
 
 #include "../../common/communication/vst2.h"
 #include "../../common/logging/vst2.h"
+#include "cache-generation.h"
 #include "common.h"
 
 /**
@@ -127,6 +132,149 @@ class Vst2PluginBridge : PluginBridge<Vst2Sockets<std::jthread>> {
     template <typename T, bool replacing>
     void do_process(T** inputs, T** outputs, int sample_frames);
 
+    /**
+     * Try to handle a block of audio locally without involving the Wine
+     * plugin host at all. This is possible when the host has engaged the
+     * plugin's soft bypass through `effSetBypass()`, in which case the inputs
+     * are copied straight to the outputs, and when the inputs are digital
+     * silence while the plugin has declared that it has no tail, in which
+     * case the outputs are zeroed out. Both shortcuts require the plugin to
+     * report no latency, since a plain copy would otherwise break the host's
+     * delay compensation. A pipelined block that's still in flight is drained
+     * first so the host still receives the last block the plugin actually
+     * processed. Only used when the `bypass_passthrough` option is enabled.
+     *
+     * @return Whether the block was handled locally. When this returns `true`
+     *   the outputs have been filled in and the caller should skip the round
+     *   trip to the Wine plugin host.
+     */
+    template <typename T, bool replacing>
+    bool try_bypass_passthrough(T** inputs, T** outputs, int sample_frames);
+
+    /**
+     * Wait for the Wine plugin host to signal that the block that's currently
+     * being processed has finished, through the completion futex embedded in
+     * `process_buffers_`. Since a futex wait doesn't get interrupted when the
+     * other process dies, this waits with a timeout and checks whether the
+     * Wine process is still running before retrying.
+     *
+     * With the `audio_deadline_ms` option set, the wait instead gives up
+     * after that many milliseconds and sets `process_overrun_pending_`, so
+     * `do_process()` can hand silence back to the host while the Wine side
+     * finishes the block at its own pace.
+     *
+     * @return Whether the block finished processing. Returns `false` when the
+     *   Wine process has died or is shutting down, or when the deadline was
+     *   overrun, in which case there are no outputs to copy back.
+     */
+    bool wait_for_process_completion();
+
+    /**
+     * Try to send a `getParameter()` or `setParameter()` call through the
+     * parameter mailbox in `process_buffers_`' doorbell page instead of over
+     * the parameters socket, skipping the socket round trip. This is only
+     * possible once `effMainsChanged()` has set up the shared memory object,
+     * so before that point the caller should fall back to the socket based
+     * path. Must be called with `parameters_mutex_` held, just like the
+     * socket based path.
+     *
+     * @return Whether the call went through the mailbox and `response` has
+     *   been filled in. Returns `false` when the mailbox is not available or
+     *   when the Wine process has died or is shutting down.
+     */
+    bool send_parameter_mailbox(const Parameter& request,
+                                ParameterResult& response);
+
+    /**
+     * Try to stash the events from an `effProcessEvents()` call so they can be
+     * passed to the Wine plugin host through the shared memory object's event
+     * area along with the next processing cycle, skipping the dispatcher
+     * socket. This is not possible for SysEx events (which contain pointers to
+     * variable length data) or when the batch doesn't fit in the fixed
+     * capacity event area, in which case the caller should fall back to the
+     * socket based path.
+     *
+     * Both `effProcessEvents()` and the process functions are called from the
+     * host's audio thread, so `pending_shm_events_` doesn't need any locking.
+     *
+     * @return Whether the events were stashed.
+     */
+    bool try_stash_shm_events(const VstEvents& events);
+
+    /**
+     * Clear `dispatch_query_cache_`. Called during `effOpen()` since plugins
+     * may only fill in some of their information at that point. Plugin
+     * initiated changes invalidate the cache through `cache_generation_`
+     * instead.
+     */
+    void clear_dispatch_query_cache() noexcept;
+
+    /**
+     * Fetch the plugin's entire program name table into
+     * `program_names_cache_` with a single `vst2_get_program_names_opcode`
+     * round trip, on a background thread so the calling thread doesn't have
+     * to wait for it. Hosts enumerate all program names one
+     * `effGetProgramNameIndexed()` call at a time when opening a generic UI,
+     * which would otherwise be a full round trip to the Wine plugin host per
+     * program. Called after `effOpen()` and whenever the cache may have gone
+     * stale, see `program_names_cache_`.
+     */
+    void prefetch_program_names();
+
+    /**
+     * Clear `program_names_cache_`, so `effGetProgramNameIndexed()` calls go
+     * back to being forwarded until a new prefetch finishes.
+     */
+    void clear_program_names_cache() noexcept;
+
+    /**
+     * Clear `program_values_cache_`, so `getParameter()` calls go back to
+     * being forwarded.
+     */
+    void clear_program_values_cache() noexcept;
+
+    /**
+     * With the `audio_zero_copy_input` or `audio_zero_copy_output` option
+     * enabled, check whether the host's buffers for this block are the ones
+     * the Wine plugin host currently has mapped, see `Vst2HostBufferMap`.
+     * When they aren't and there are negotiation attempts left, a background
+     * thread scans procfs to see whether the buffers live in shared, file
+     * backed memory and offers them to the Wine side for mapping. Either
+     * direction may succeed on its own, so a host with shareable outputs but
+     * private inputs still gets zero-copy outputs. Called from the host's
+     * audio thread at the start of a processing cycle.
+     *
+     * @param inputs The host's input channel pointers, `plugin_.numInputs`
+     *   entries long.
+     * @param outputs The host's output channel pointers,
+     *   `plugin_.numOutputs` entries long. May be a null pointer when the
+     *   outputs can't be written directly, as during the accumulating
+     *   `process()` code path.
+     * @param sample_size The size of a single sample in bytes, so either
+     *   `sizeof(float)` or `sizeof(double)`. Used together with the maximum
+     *   block size to derive the mapped buffer sizes.
+     * @param block_bytes The size of this block's data per channel in bytes.
+     *
+     * @return Whether this block should be flagged with
+     *   `Vst2ProcessRequest::use_mapped_inputs` and
+     *   `Vst2ProcessRequest::use_mapped_outputs` respectively. The first
+     *   skips the input copy and the silent channel scan entirely, the
+     *   second skips the output copy after the Wine side signals completion.
+     */
+    std::pair<bool, bool> try_use_mapped_host_buffers(
+        const void* const* inputs,
+        const void* const* outputs,
+        size_t sample_size,
+        size_t block_bytes);
+
+    /**
+     * Clear the negotiated buffer mapping and reset the negotiation attempt
+     * budget, so the next processing cycle starts a fresh negotiation.
+     * Called during `effSetBlockSize()` since the mapped buffer sizes are
+     * derived from the host's maximum block size.
+     */
+    void reset_host_buffer_map() noexcept;
+
     /**
      * This AEffect struct will be populated using the data passed by the Wine
      * VST host during initialization and then passed as a pointer to the Linux
@@ -173,6 +321,92 @@ class Vst2PluginBridge : PluginBridge<Vst2Sockets<std::jthread>> {
      */
     std::optional<AudioShmBuffer> process_buffers_;
 
+    /**
+     * The bank of `process_buffers_` we'll write the next block's inputs to
+     * when the `audio_pipelining` option is enabled. The banks alternate
+     * between processing calls.
+     */
+    uint32_t pipelining_bank_ = 0;
+    /**
+     * Whether a pipelined block is currently being processed on the Wine side.
+     * When this is set, the previous block's outputs can be copied back to the
+     * host after waiting for the completion signal. Reset when audio
+     * processing gets reinitialized through `effMainsChanged()`.
+     */
+    bool pipelining_block_in_flight_ = false;
+    /**
+     * The number of samples in the block that's currently in flight. If the
+     * host suddenly changes its block size we can only hand it this many
+     * samples from the previous block, and the rest will be zeroed out.
+     */
+    int pipelining_prev_sample_frames_ = 0;
+
+    /**
+     * With the `audio_deadline_ms` option set, whether a block is still
+     * outstanding on the Wine side after a processing call overran its
+     * deadline and returned silence. No new block may be rung until the
+     * late completion arrives, so processing calls made in the meantime
+     * also return silence. Cleared by `do_process()` once the completion
+     * shows up, after which the late block's outputs are discarded and
+     * processing resumes with the current block. Only ever touched from the
+     * host's audio thread.
+     */
+    bool process_overrun_pending_ = false;
+    /**
+     * The number of blocks in a row the host has received silence for
+     * because of deadline overruns. Used to log an escalated warning once a
+     * plugin looks well and truly stuck rather than just slow, and reset as
+     * soon as a block completes in time again.
+     */
+    uint32_t consecutive_process_overruns_ = 0;
+
+    /**
+     * Whether the host has engaged the plugin's soft bypass through
+     * `effSetBypass()`. Written from the thread dispatching the event and
+     * read by `try_bypass_passthrough()` on the host's audio thread when the
+     * `bypass_passthrough` option is enabled.
+     */
+    std::atomic_bool host_bypass_active_ = false;
+    /**
+     * The sample rate the host last passed through `effSetSampleRate()`, used
+     * by `record_audio_processing_call()` to derive the deadline for a processing
+     * call. Stays at zero until the host has set a sample rate. Written from
+     * the thread dispatching the event and read on the host's audio thread.
+     */
+    std::atomic<float> last_sample_rate_ = 0.0f;
+    /**
+     * The maximum block size the host last announced through
+     * `effSetBlockSize()`, used to size the mapped host buffers for the
+     * `audio_zero_copy_input` option. Stays at zero until the host has set a
+     * block size, in which case no mapping is attempted. Written from the
+     * thread dispatching the event and read on the host's audio thread.
+     */
+    std::atomic<int32_t> last_block_size_ = 0;
+    /**
+     * The tail size the plugin last reported through `effGetTailSize()`, or
+     * -1 if we don't know it. Values of 0 and 1 both mean that the plugin has
+     * no tail. This gets filled in when the host queries the tail size and,
+     * with the `bypass_passthrough` option enabled, by our own query after
+     * audio processing gets resumed. Reset when the plugin calls
+     * `audioMasterIOChanged()` since its tail may have changed.
+     */
+    std::atomic<intptr_t> last_reported_tail_size_ = -1;
+
+    /**
+     * The sequence counter of the last `Vst2AEffectMirror` snapshot we
+     * refreshed `plugin_` from, see the check at the end of `do_process()`.
+     * Only accessed from the host's audio thread.
+     */
+    uint32_t aeffect_mirror_sequence_ = 0;
+
+    /**
+     * Events stashed by `try_stash_shm_events()` since the last processing
+     * cycle. These get copied to the shared memory object's event area just
+     * before ringing the doorbell, and the count is passed along in the
+     * metadata slot. Only accessed from the host's audio thread.
+     */
+    llvm::SmallVector<VstEvent, vst2_shm_max_events> pending_shm_events_;
+
     /**
      * We'll periodically synchronize the Wine host's audio thread priority with
      * that of the host. Since the overhead from doing so does add up, we'll
@@ -219,4 +453,111 @@ class Vst2PluginBridge : PluginBridge<Vst2Sockets<std::jthread>> {
      */
     std::optional<std::pair<int, int>> incoming_resize_;
     std::mutex incoming_resize_mutex_;
+
+    /**
+     * The generation counter behind the shared invalidation protocol all of
+     * this instance's caches below use, see `CacheGeneration`. Bumped once
+     * when the plugin calls `audioMasterUpdateDisplay()` or
+     * `audioMasterIOChanged()`, which invalidates every generation tagged
+     * cache at the same time.
+     */
+    CacheGeneration cache_generation_;
+
+    /**
+     * Cached responses for the idempotent query opcodes like `effCanDo` and
+     * `effGetVendorString`. Hosts re-ask these queries over and over again
+     * while their UI is open even though the answers cannot change until the
+     * plugin tells the host otherwise, and every one of those queries would
+     * otherwise be a full round trip to the Wine plugin host. The cache is
+     * keyed by the opcode, the index (for `effGetParameterProperties()`), and
+     * the query string (for `effCanDo()`).
+     *
+     * @see clear_dispatch_query_cache
+     */
+    GenerationTagged<std::map<std::tuple<int, int, std::string>,
+                              Vst2EventResult>>
+        dispatch_query_cache_;
+    std::mutex dispatch_query_cache_mutex_;
+
+    /**
+     * The plugin's program names indexed by program number, prefetched in
+     * bulk by `prefetch_program_names()` so the host's
+     * `effGetProgramNameIndexed()` queries can be answered locally. A nullopt
+     * until the prefetch after `effOpen()` has finished. Invalidated through
+     * `cache_generation_` when the plugin calls `audioMasterUpdateDisplay()`
+     * or `audioMasterIOChanged()`, and cleared when the host renames a
+     * program through `effSetProgramName()` or loads a state through
+     * `effSetChunk()`. Queries for indices outside of the cached table are
+     * still forwarded.
+     */
+    GenerationTagged<std::optional<std::vector<std::string>>>
+        program_names_cache_;
+    std::mutex program_names_cache_mutex_;
+
+    /**
+     * The thread performing the current program name prefetch, if any.
+     * Assigning a new prefetch joins the previous one first, and the mutex
+     * makes sure two threads don't do so at the same time. The worker only
+     * ever locks `program_names_cache_mutex_`, so joining it while holding
+     * this mutex cannot deadlock.
+     */
+    std::jthread program_names_prefetch_thread_;
+    std::mutex program_names_prefetch_mutex_;
+
+    /**
+     * Every parameter's value as bundled with the last `effSetProgram()`
+     * response, indexed by parameter number, see `Vst2ProgramBundle`. Hosts
+     * re-read all parameters right after a program change, and this lets
+     * `get_parameter()` answer that burst locally. The values are only valid
+     * until the plugin gets a chance to change them again, so the cache is
+     * cleared on `setParameter()` and at the start of the next audio
+     * processing cycle. A nullopt whenever no freshly loaded program state
+     * is available.
+     */
+    GenerationTagged<std::optional<std::vector<float>>>
+        program_values_cache_;
+    std::mutex program_values_cache_mutex_;
+    /**
+     * Whether `program_values_cache_` may be set. This lets the audio
+     * processing cycle check with a single relaxed load whether it needs to
+     * take the mutex and invalidate the cache.
+     */
+    std::atomic<bool> program_values_cache_armed_ = false;
+
+    /**
+     * With the `audio_zero_copy_input` and `audio_zero_copy_output` options
+     * enabled, the host input and output channel pointers the Wine plugin
+     * host currently has mapped, in channel order, along with the size of
+     * each channel's mapping in bytes. Empty until a negotiation has
+     * succeeded for the direction. `try_use_mapped_host_buffers()` compares
+     * the host's pointers against these sets at the start of every
+     * processing cycle, and while they match the copies are skipped and the
+     * block is flagged with `use_mapped_inputs` and `use_mapped_outputs`.
+     */
+    std::vector<const void*> mapped_host_inputs_;
+    std::vector<const void*> mapped_host_outputs_;
+    size_t mapped_host_buffers_bytes_ = 0;
+    std::mutex mapped_host_buffers_mutex_;
+
+    /**
+     * Whether a mapping negotiation is still in flight on
+     * `host_buffer_map_thread_`. No block may be flagged with
+     * `use_mapped_inputs` or `use_mapped_outputs` while this is set, since
+     * the Wine side may be replacing its mappings at that very moment.
+     */
+    std::atomic_bool host_buffer_map_in_flight_ = false;
+    /**
+     * The number of mapping negotiations started since the last
+     * `effSetBlockSize()`. Hosts whose buffers live in plain private memory
+     * can never map successfully, so after a couple of failed attempts we
+     * stop rescanning procfs and just keep copying.
+     */
+    std::atomic<uint32_t> host_buffer_map_attempts_ = 0;
+    /**
+     * The thread performing the current mapping negotiation, if any. Only
+     * the host's audio thread assigns this, and it only does so after the
+     * previous negotiation has finished, so the implicit join when assigning
+     * a new thread never blocks.
+     */
+    std::jthread host_buffer_map_thread_;
 };
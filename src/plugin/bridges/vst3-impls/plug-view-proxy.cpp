@@ -88,9 +88,56 @@ RunLoopTasks::onFDIsSet(Steinberg::Linux::FileDescriptor /*fd*/) {
 Vst3PlugViewProxyImpl::Vst3PlugViewProxyImpl(
     Vst3PluginBridge& bridge,
     Vst3PlugViewProxy::ConstructArgs&& args) noexcept
-    : Vst3PlugViewProxy(std::move(args)), bridge_(bridge) {}
+    : Vst3PlugViewProxy(std::move(args)), bridge_(bridge) {
+    // During a resize drag `onSize()` coalesces the intermediate sizes
+    // instead of doing a synchronous round trip per mouse move, and this
+    // thread delivers the most recent size once per GUI frame. See the
+    // docstring on `pending_on_size_`.
+    on_size_flusher_ = std::jthread([&](std::stop_token st) {
+        std::unique_lock lock(pending_on_size_mutex_);
+        while (true) {
+            pending_on_size_cv_.wait(lock, st, [&]() {
+                return pending_on_size_.has_value();
+            });
+            if (st.stop_requested()) {
+                break;
+            }
+
+            // Let a steady stream of resizes settle to one message per GUI
+            // frame. A stop request interrupts this wait as well.
+            pending_on_size_cv_.wait_until(
+                lock, st, last_on_size_send_ + bridge_.event_loop_interval(),
+                []() { return false; });
+            if (st.stop_requested()) {
+                break;
+            }
+            // A synchronous `onSize()` may have superseded the coalesced
+            // size while we were waiting
+            if (!pending_on_size_) {
+                continue;
+            }
+
+            const Steinberg::ViewRect new_size = *pending_on_size_;
+            pending_on_size_.reset();
+            last_on_size_send_ = std::chrono::steady_clock::now();
+
+            lock.unlock();
+            // The host already received an optimistic `kResultOk` for this
+            // size, so the result is only used for logging
+            bridge_.send_message(
+                YaPlugView::OnSize{.owner_instance_id = owner_instance_id(),
+                                   .new_size = new_size});
+            lock.lock();
+        }
+    });
+}
 
 Vst3PlugViewProxyImpl::~Vst3PlugViewProxyImpl() noexcept {
+    // Stop the resize flushing thread before destroying the Wine side's plug
+    // view so it cannot send a resize for a view that no longer exists
+    on_size_flusher_.request_stop();
+    on_size_flusher_.join();
+
     // Also drop the plug view smart pointer on the Wine side when this gets
     // dropped
     // NOTE: This can actually throw (e.g. out of memory or the socket got
@@ -100,6 +147,19 @@ Vst3PlugViewProxyImpl::~Vst3PlugViewProxyImpl() noexcept {
         Vst3PlugViewProxy::Destruct{.owner_instance_id = owner_instance_id()});
 }
 
+void* Vst3PlugViewProxyImpl::operator new(size_t size, Vst3ProxyArena& arena) {
+    return Vst3ProxyArena::allocate_member(arena, size);
+}
+
+void Vst3PlugViewProxyImpl::operator delete(void* /*object*/,
+                                            Vst3ProxyArena& /*arena*/) noexcept {
+}
+
+void Vst3PlugViewProxyImpl::operator delete(void* object,
+                                            size_t size) noexcept {
+    Vst3ProxyArena::deallocate_member(object, size);
+}
+
 tresult PLUGIN_API
 Vst3PlugViewProxyImpl::queryInterface(const Steinberg::TUID _iid, void** obj) {
     const tresult result = Vst3PlugViewProxy::queryInterface(_iid, obj);
@@ -190,6 +250,26 @@ tresult PLUGIN_API Vst3PlugViewProxyImpl::getSize(Steinberg::ViewRect* size) {
 
 tresult PLUGIN_API Vst3PlugViewProxyImpl::onSize(Steinberg::ViewRect* newSize) {
     if (newSize) {
+        // During a resize drag we'll get one of these calls per mouse move.
+        // Sizes that come in faster than one per GUI frame are coalesced and
+        // sent by `on_size_flusher_`, see the docstring on
+        // `pending_on_size_`.
+        {
+            std::lock_guard lock(pending_on_size_mutex_);
+            const auto now = std::chrono::steady_clock::now();
+            if (now - last_on_size_send_ < bridge_.event_loop_interval()) {
+                pending_on_size_ = *newSize;
+                pending_on_size_cv_.notify_one();
+
+                return Steinberg::kResultOk;
+            }
+
+            // This size supersedes any coalesced size that hasn't been
+            // flushed yet
+            pending_on_size_.reset();
+            last_on_size_send_ = now;
+        }
+
         return bridge_.send_mutually_recursive_message(YaPlugView::OnSize{
             .owner_instance_id = owner_instance_id(), .new_size = *newSize});
     } else {
@@ -249,27 +329,21 @@ tresult PLUGIN_API Vst3PlugViewProxyImpl::canResize() {
     const auto request =
         YaPlugView::CanResize{.owner_instance_id = owner_instance_id()};
 
-    {
-        std::lock_guard lock(can_resize_cache_mutex_);
-        if (const tresult* result = can_resize_cache_.get_and_keep_alive(5)) {
-            const bool log_response =
-                bridge_.logger_.log_request(true, request);
-            if (log_response) {
-                bridge_.logger_.log_response(
-                    true, YaPlugView::CanResize::Response(*result), true);
-            }
-
-            return *result;
+    if (const std::optional<tresult> result =
+            can_resize_cache_.get_and_keep_alive(5)) {
+        const bool log_response = bridge_.logger_.log_request(true, request);
+        if (log_response) {
+            bridge_.logger_.log_response(
+                true, YaPlugView::CanResize::Response(*result), true);
         }
+
+        return *result;
     }
 
     const UniversalTResult result =
         bridge_.send_mutually_recursive_message(request);
 
-    {
-        std::lock_guard lock(can_resize_cache_mutex_);
-        can_resize_cache_.set(result, 5);
-    }
+    can_resize_cache_.set(result, 5);
 
     return result;
 }
@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include <condition_variable>
+
 #include <function2/function2.hpp>
 
 #include "../vst3.h"
+#include "proxy-arena.h"
 
 /**
  * A RAII wrapper around `IRunLoop`'s event handlers so we can schedule tasks to
@@ -113,6 +116,24 @@ class Vst3PlugViewProxyImpl : public Vst3PlugViewProxy {
      */
     ~Vst3PlugViewProxyImpl() noexcept override;
 
+    /**
+     * Plug view proxies are allocated from the arena owned by the
+     * `Vst3PluginProxyImpl` they were created from, so they end up next to
+     * the rest of that instance's proxy graph. Declaring this placement form
+     * also hides the global `operator new`, which keeps anyone from
+     * accidentally heap allocating these again. When the host releases the
+     * view its block goes back to the arena's free list for the next
+     * `IEditController::createView()` call, the memory itself is freed
+     * together with the rest of the arena.
+     */
+    void* operator new(size_t size, Vst3ProxyArena& arena);
+    /**
+     * The matching placement delete, only used when the constructor throws.
+     * The storage just stays in the arena in that case.
+     */
+    void operator delete(void* object, Vst3ProxyArena& arena) noexcept;
+    void operator delete(void* object, size_t size) noexcept;
+
     /**
      * We'll override the query interface to log queries for interfaces we do
      * not (yet) support.
@@ -223,8 +244,35 @@ class Vst3PlugViewProxyImpl : public Vst3PlugViewProxy {
      * GUI thread, just like `IPlugView::onSize()` and
      * `IPlugView::checkSizeConstraint`. Everything running in lockstep makes
      * resizing a lot laggier than they would have to be, so as a compromise
-     * we'll remember this value for the duration of the resize.
+     * we'll remember this value for the duration of the resize. Not every
+     * host asks from a single thread, hence the thread safe cache.
+     */
+    AtomicTimedValueCache<tresult> can_resize_cache_;
+
+    /**
+     * During a live resize drag the host calls `IPlugView::onSize()` for
+     * every intermediate geometry, and passing each of those through
+     * synchronously means a mutually recursive socket round trip per mouse
+     * move. Big plugin GUIs redraw on every one of those, which makes
+     * dragging visibly stutter. When `onSize()` calls come in faster than
+     * one per GUI frame we'll store the most recent size here, optimistically
+     * return `kResultOk`, and let `on_size_flusher_` deliver the latest size
+     * once the frame interval has passed. The final size of a drag therefore
+     * always reaches the plugin, at most one frame late. One-off resizes
+     * outside of such a burst still take the synchronous path.
+     */
+    std::optional<Steinberg::ViewRect> pending_on_size_;
+    /**
+     * The last time a (synchronous or flushed) `OnSize` message was sent,
+     * used to tell one-off resizes apart from a resize drag in progress.
+     */
+    std::chrono::steady_clock::time_point last_on_size_send_{};
+    std::mutex pending_on_size_mutex_;
+    std::condition_variable_any pending_on_size_cv_;
+    /**
+     * Sends the coalesced size stored in `pending_on_size_`, one GUI frame
+     * after the last `OnSize` message went out. Declared last so it stops
+     * before the fields it uses are destroyed.
      */
-    TimedValueCache<tresult> can_resize_cache_;
-    std::mutex can_resize_cache_mutex_;
+    std::jthread on_size_flusher_;
 };
@@ -16,6 +16,8 @@
 
 #include "plugin-proxy.h"
 
+#include <chrono>
+
 #include <pluginterfaces/vst/ivstmidicontrollers.h>
 
 #include "plug-view-proxy.h"
@@ -37,6 +39,17 @@ constexpr char other_instance_message_id[] = "yabridge_other_instance";
  */
 constexpr char other_instance_pointer_attribute[] = "other_proxy_ptr";
 
+/**
+ * How long a cached parameter value stays valid when no value changes for it
+ * pass through the bridge. Roughly one UI frame, so a host polling every
+ * visible parameter at UI rate pays at most one bulk readout round trip per
+ * frame. The bound exists because not every plugin correctly announces
+ * internal value changes through `IComponentHandler::performEdit()`.
+ *
+ * @relates Vst3PluginProxyImpl::getParamNormalized
+ */
+constexpr std::chrono::milliseconds parameter_value_cache_max_age{33};
+
 Vst3PluginProxyImpl::ContextMenu::ContextMenu(
     Steinberg::IPtr<Steinberg::Vst::IContextMenu> menu)
     : menu(menu) {}
@@ -48,6 +61,11 @@ Vst3PluginProxyImpl::Vst3PluginProxyImpl(Vst3PluginBridge& bridge,
 }
 
 Vst3PluginProxyImpl::~Vst3PluginProxyImpl() noexcept {
+    // With the `async_state_transitions` option enabled a transition may
+    // still be in flight, and the destruction request has to stay ordered
+    // behind it
+    wait_for_state_transition();
+
     // NOTE: This can actually throw (e.g. out of memory or the socket got
     //       closed). But if that were to happen, then we wouldn't be able to
     //       recover from it anyways.
@@ -56,6 +74,52 @@ Vst3PluginProxyImpl::~Vst3PluginProxyImpl() noexcept {
     bridge_.unregister_plugin_proxy(*this);
 }
 
+void Vst3PluginProxyImpl::launch_state_transition(
+    fu2::unique_function<void()> transition) {
+    // Transitions have to stay ordered with respect to each other, since
+    // concurrent requests over the sockets could otherwise be handled out of
+    // order on the Wine side
+    wait_for_state_transition();
+
+    state_transition_in_flight_.store(true, std::memory_order_release);
+    state_transition_thread_ =
+        std::jthread([this, transition = std::move(transition)]() mutable {
+            transition();
+
+            {
+                std::lock_guard lock(state_transition_mutex_);
+                state_transition_in_flight_.store(false,
+                                                  std::memory_order_release);
+            }
+            state_transition_cv_.notify_all();
+        });
+}
+
+void Vst3PluginProxyImpl::wait_for_state_transition() noexcept {
+    if (!state_transition_in_flight_.load(std::memory_order_acquire))
+        [[likely]] {
+        return;
+    }
+
+    std::unique_lock lock(state_transition_mutex_);
+    state_transition_cv_.wait(lock, [&]() {
+        return !state_transition_in_flight_.load(std::memory_order_acquire);
+    });
+}
+
+void* Vst3PluginProxyImpl::operator new(size_t size) {
+    return Vst3ProxyArena::allocate_owning(std::make_unique<Vst3ProxyArena>(),
+                                           size);
+}
+
+void Vst3PluginProxyImpl::operator delete(void* object) noexcept {
+    Vst3ProxyArena::deallocate_owning(object);
+}
+
+Vst3ProxyArena& Vst3PluginProxyImpl::arena() noexcept {
+    return Vst3ProxyArena::of(this);
+}
+
 tresult PLUGIN_API
 Vst3PluginProxyImpl::queryInterface(const Steinberg::TUID _iid, void** obj) {
     const tresult result = Vst3PluginProxy::queryInterface(_iid, obj);
@@ -85,11 +149,25 @@ bool Vst3PluginProxyImpl::unregister_context_menu(size_t context_menu_id) {
     return context_menus_.erase(context_menu_id);
 }
 
-void Vst3PluginProxyImpl::clear_caches() noexcept {
-    clear_bus_cache();
-
-    std::lock_guard lock(function_result_cache_mutex_);
-    function_result_cache_ = FunctionResultCache{};
+void Vst3PluginProxyImpl::clear_caches(int32 restart_flags) noexcept {
+    using namespace Steinberg::Vst;
+
+    // Every cache on this instance shares the generation tagged protocol, so
+    // a single bump invalidates all of them at once. This is coarser than
+    // the per-flag clearing we used to do here, but it means no notification
+    // can ever slip past a cache, and the dropped entries are all things a
+    // host only re-queries at UI rate anyway. Tracked parameter values are
+    // refreshed with a single round trip on the next poll, see
+    // `param_value_cache_checked_generation_`.
+    cache_generation_.bump();
+
+    // The one thing the generation cannot express is that the parameter set
+    // itself may have changed, so a full reload additionally drops the set
+    // of tracked parameters
+    if (restart_flags & RestartFlags::kReloadComponent) {
+        std::lock_guard value_cache_lock(param_value_cache_mutex_);
+        param_value_cache_.clear();
+    }
 }
 
 tresult PLUGIN_API Vst3PluginProxyImpl::setAudioPresentationLatencySamples(
@@ -113,33 +191,105 @@ tresult PLUGIN_API Vst3PluginProxyImpl::setBusArrangements(
 
     // NOTE: Ardour passes a null pointer when `numIns` or `numOuts` is 0, so we
     //       need to work around that
-    return bridge_.send_audio_processor_message(
-        YaAudioProcessor::SetBusArrangements{
-            .instance_id = instance_id(),
-            .inputs =
-                (inputs ? std::vector<Steinberg::Vst::SpeakerArrangement>(
-                              inputs, &inputs[numIns])
-                        : std::vector<Steinberg::Vst::SpeakerArrangement>()),
-            .num_ins = numIns,
-            .outputs =
-                (outputs ? std::vector<Steinberg::Vst::SpeakerArrangement>(
-                               outputs, &outputs[numOuts])
-                         : std::vector<Steinberg::Vst::SpeakerArrangement>()),
-            .num_outs = numOuts,
-        });
+    auto request = YaAudioProcessor::SetBusArrangements{
+        .instance_id = instance_id(),
+        .inputs =
+            (inputs ? std::vector<Steinberg::Vst::SpeakerArrangement>(
+                          inputs, &inputs[numIns])
+                    : std::vector<Steinberg::Vst::SpeakerArrangement>()),
+        .num_ins = numIns,
+        .outputs =
+            (outputs ? std::vector<Steinberg::Vst::SpeakerArrangement>(
+                           outputs, &outputs[numOuts])
+                     : std::vector<Steinberg::Vst::SpeakerArrangement>()),
+        .num_outs = numOuts,
+    };
+
+    // Hosts renegotiate the exact same layout on every activation and on
+    // every graph rebuild. If the plugin already accepted this arrangement
+    // set and nothing could have changed it since, then the plugin is still
+    // in this configuration and the request can be acknowledged locally.
+    {
+        std::lock_guard lock(function_result_cache_mutex_);
+        auto& cache = function_result_cache_.checked(cache_generation_);
+        if (cache.accepted_arrangements &&
+            cache.accepted_arrangements->first == request.inputs &&
+            cache.accepted_arrangements->second == request.outputs) {
+            const bool log_response =
+                bridge_.logger_.log_request(true, request);
+            if (log_response) {
+                bridge_.logger_.log_response(
+                    true,
+                    YaAudioProcessor::SetBusArrangements::Response(
+                        Steinberg::kResultTrue),
+                    true);
+            }
+
+            return Steinberg::kResultTrue;
+        }
+
+        // A different negotiation may change the plugin's arrangements
+        // regardless of whether it gets accepted, so the cached values can
+        // no longer be served
+        cache.accepted_arrangements.reset();
+        cache.bus_arrangement.clear();
+    }
+
+    const tresult result = bridge_.send_audio_processor_message(request);
+
+    if (result == Steinberg::kResultTrue) {
+        std::lock_guard lock(function_result_cache_mutex_);
+        function_result_cache_.checked(cache_generation_)
+            .accepted_arrangements = {std::move(request.inputs),
+                                      std::move(request.outputs)};
+    }
+
+    return result;
 }
 
 tresult PLUGIN_API Vst3PluginProxyImpl::getBusArrangement(
     Steinberg::Vst::BusDirection dir,
     int32 index,
     Steinberg::Vst::SpeakerArrangement& arr) {
+    const auto request = YaAudioProcessor::GetBusArrangement{
+        .instance_id = instance_id(), .dir = dir, .index = index};
+
+    // Hosts walk all of the plugin's busses through this function after
+    // every negotiation and every activation. The plugin cannot change its
+    // arrangements in between without a `kIoChanged` restart, so repeat
+    // queries can be served locally.
+    {
+        std::lock_guard lock(function_result_cache_mutex_);
+        auto& cache = function_result_cache_.checked(cache_generation_);
+        if (const auto it = cache.bus_arrangement.find(std::tuple(dir, index));
+            it != cache.bus_arrangement.end()) {
+            const bool log_response =
+                bridge_.logger_.log_request(true, request);
+            if (log_response) {
+                bridge_.logger_.log_response(
+                    true,
+                    GetBusArrangementResponse{.result = Steinberg::kResultTrue,
+                                              .arr = it->second},
+                    true);
+            }
+
+            arr = it->second;
+
+            return Steinberg::kResultTrue;
+        }
+    }
+
     const GetBusArrangementResponse response =
-        bridge_.send_audio_processor_message(
-            YaAudioProcessor::GetBusArrangement{
-                .instance_id = instance_id(), .dir = dir, .index = index});
+        bridge_.send_audio_processor_message(request);
 
     arr = response.arr;
 
+    if (response.result == Steinberg::kResultTrue) {
+        std::lock_guard lock(function_result_cache_mutex_);
+        function_result_cache_.checked(cache_generation_)
+            .bus_arrangement[std::tuple(dir, index)] = response.arr;
+    }
+
     return response.result;
 }
 
@@ -151,9 +301,9 @@ Vst3PluginProxyImpl::canProcessSampleSize(int32 symbolicSampleSize) {
 
     {
         std::lock_guard lock(function_result_cache_mutex_);
-        if (auto it = function_result_cache_.can_process_sample_size.find(
-                symbolicSampleSize);
-            it != function_result_cache_.can_process_sample_size.end()) {
+        auto& cache = function_result_cache_.checked(cache_generation_);
+        if (auto it = cache.can_process_sample_size.find(symbolicSampleSize);
+            it != cache.can_process_sample_size.end()) {
             const bool log_response =
                 bridge_.logger_.log_request(true, request);
             if (log_response) {
@@ -172,20 +322,59 @@ Vst3PluginProxyImpl::canProcessSampleSize(int32 symbolicSampleSize) {
 
     {
         std::lock_guard lock(function_result_cache_mutex_);
-        function_result_cache_.can_process_sample_size[symbolicSampleSize] =
-            result;
+        function_result_cache_.checked(cache_generation_)
+            .can_process_sample_size[symbolicSampleSize] = result;
     }
 
     return result;
 }
 
 uint32 PLUGIN_API Vst3PluginProxyImpl::getLatencySamples() {
-    return bridge_.send_audio_processor_message(
+    // Hosts re-query the latency right after (re)activating the component,
+    // so with the `async_state_transitions` option enabled the query has to
+    // stay ordered behind a pending activation
+    wait_for_state_transition();
+
+    // Some hosts re-query the latency every processing cycle while plugin
+    // delay compensation is active, and the plugin has to announce latency
+    // changes through `restartComponent()` with `kLatencyChanged`, so we can
+    // serve this value locally in between those restarts
+    {
+        std::lock_guard lock(function_result_cache_mutex_);
+        const auto& cache = function_result_cache_.checked(cache_generation_);
+        if (cache.latency_samples) {
+            return *cache.latency_samples;
+        }
+    }
+
+    const uint32 latency_samples = bridge_.send_audio_processor_message(
         YaAudioProcessor::GetLatencySamples{.instance_id = instance_id()});
+
+    std::lock_guard lock(function_result_cache_mutex_);
+    function_result_cache_.checked(cache_generation_).latency_samples =
+        latency_samples;
+
+    return latency_samples;
 }
 
 tresult PLUGIN_API
 Vst3PluginProxyImpl::setupProcessing(Steinberg::Vst::ProcessSetup& setup) {
+    // Used to derive the audio processing deadline in `process()`
+    last_sample_rate_.store(setup.sampleRate, std::memory_order_relaxed);
+
+    // The setup change has to stay ordered behind a pending deactivation,
+    // see the `async_state_transitions` option
+    wait_for_state_transition();
+
+    // Plugins may report a different latency for a new sample rate or
+    // maximum block size without an explicit `restartComponent()` call, and
+    // hosts re-query the latency after changing the setup
+    {
+        std::lock_guard lock(function_result_cache_mutex_);
+        function_result_cache_.checked(cache_generation_)
+            .latency_samples.reset();
+    }
+
     return bridge_.send_audio_processor_message(
         YaAudioProcessor::SetupProcessing{.instance_id = instance_id(),
                                           .setup = setup});
@@ -206,19 +395,58 @@ tresult PLUGIN_API Vst3PluginProxyImpl::setProcessing(TBool state) {
         }
     }
 
+    // With the `async_state_transitions` option enabled the round trip
+    // happens on a background thread while the host's audio thread continues
+    // immediately, and the next `process()` call waits for it to finish.
+    // Hosts toggle the processing state of every instance on a track when
+    // enabling or disabling it, and doing all of those round trips
+    // sequentially on the audio thread causes audible hiccups. The downside
+    // is that the host always sees the transition succeed, so an actual
+    // failure can only be logged after the fact.
+    if (bridge_.config_.async_state_transitions) {
+        launch_state_transition([this, state]() {
+            const UniversalTResult result =
+                bridge_.send_audio_processor_message(
+                    YaAudioProcessor::SetProcessing{
+                        .instance_id = instance_id(), .state = state});
+            if (result != Steinberg::kResultOk) {
+                bridge_.logger_.log(
+                    "WARNING: The plugin returned '" + result.string() +
+                    "' from an asynchronous 'IAudioProcessor::setProcessing("
+                    + (state ? "true" : "false") + ")' call");
+            }
+        });
+
+        return Steinberg::kResultOk;
+    }
+
     return bridge_.send_audio_processor_message(YaAudioProcessor::SetProcessing{
         .instance_id = instance_id(), .state = state});
 }
 
 tresult PLUGIN_API
 Vst3PluginProxyImpl::process(Steinberg::Vst::ProcessData& data) {
-    // We'll synchronize the scheduling priority of the audio thread on the Wine
-    // plugin host with that of the host's audio thread every once in a while
-    std::optional<int> new_realtime_priority = std::nullopt;
+    startup_trace_first_audio();
+
+    // With the `async_state_transitions` option enabled an activation or
+    // processing state transition may still be in flight, and processing can
+    // only continue once it has finished. This is a single atomic load when
+    // there's no transition pending.
+    wait_for_state_transition();
+
+    // Timing brackets for the stats and deadline bookkeeping at the end of
+    // this function, see `PluginBridge::record_audio_processing_call()` for
+    // the phase breakdown they feed
+    const auto process_start = std::chrono::steady_clock::now();
+
+    // We'll synchronize the scheduling parameters of the audio thread on the
+    // Wine plugin host with those of the host's audio thread every once in a
+    // while
+    std::optional<RealtimeParameters> new_realtime_parameters = std::nullopt;
     time_t now = time(nullptr);
     if (now > last_audio_thread_priority_synchronization_ +
                   audio_thread_priority_synchronization_interval) {
-        new_realtime_priority = get_realtime_priority();
+        new_realtime_parameters = get_realtime_parameters();
         last_audio_thread_priority_synchronization_ = now;
     }
 
@@ -228,7 +456,7 @@ Vst3PluginProxyImpl::process(Steinberg::Vst::ProcessData& data) {
     assert(process_buffers_);
     process_request_.instance_id = instance_id();
     process_request_.data.repopulate(data, *process_buffers_);
-    process_request_.new_realtime_priority = new_realtime_priority;
+    process_request_.new_realtime_parameters = new_realtime_parameters;
 
     // HACK: This is a bit ugly. This `YaProcessData::Response` object actually
     //       contains pointers to the corresponding `YaProcessData` fields in
@@ -246,9 +474,11 @@ Vst3PluginProxyImpl::process(Steinberg::Vst::ProcessData& data) {
 
     // We'll also receive the response into an existing object so we can also
     // avoid heap allocations there
+    const auto copy_in_end = std::chrono::steady_clock::now();
     bridge_.receive_audio_processor_message_into(
         MessageReference<YaAudioProcessor::Process>(process_request_),
         process_response_);
+    const auto round_trip_end = std::chrono::steady_clock::now();
 
     // At this point the shared audio buffers should contain the output audio,
     // so we'll write that back to the host along with any metadata (which in
@@ -256,6 +486,22 @@ Vst3PluginProxyImpl::process(Steinberg::Vst::ProcessData& data) {
     // changes and events
     process_request_.data.write_back_outputs(data, *process_buffers_);
 
+    // Those output parameter changes also keep the `getParamNormalized()`
+    // polling cache fresh for free
+    if (process_request_.data.output_parameter_changes_) {
+        update_parameter_cache_from_output_changes(
+            *process_request_.data.output_parameter_changes_);
+    }
+
+    const Steinberg::int32 num_input_events =
+        data.inputEvents ? data.inputEvents->getEventCount() : 0;
+    bridge_.record_audio_processing_call(
+        instance_id(), last_sample_rate_.load(std::memory_order_relaxed),
+        static_cast<uint32_t>(data.numSamples),
+        num_input_events > 0 ? static_cast<uint32_t>(num_input_events) : 0,
+        process_start, copy_in_end - process_start,
+        round_trip_end - copy_in_end);
+
     return process_response_.result;
 }
 
@@ -305,8 +551,9 @@ Vst3PluginProxyImpl::getBusCount(Steinberg::Vst::MediaType type,
     {
         std::lock_guard lock(processing_bus_cache_mutex_);
         if (processing_bus_cache_) {
-            if (auto it = processing_bus_cache_->bus_count.find(args);
-                it != processing_bus_cache_->bus_count.end()) {
+            auto& cache = processing_bus_cache_->checked(cache_generation_);
+            if (auto it = cache.bus_count.find(args);
+                it != cache.bus_count.end()) {
                 const bool log_response =
                     bridge_.logger_.log_request(true, request);
                 if (log_response) {
@@ -325,7 +572,8 @@ Vst3PluginProxyImpl::getBusCount(Steinberg::Vst::MediaType type,
     {
         std::lock_guard lock(processing_bus_cache_mutex_);
         if (processing_bus_cache_) {
-            processing_bus_cache_->bus_count[args] = result;
+            processing_bus_cache_->checked(cache_generation_)
+                .bus_count[args] = result;
         }
     }
 
@@ -345,8 +593,9 @@ Vst3PluginProxyImpl::getBusInfo(Steinberg::Vst::MediaType type,
     {
         std::lock_guard lock(processing_bus_cache_mutex_);
         if (processing_bus_cache_) {
-            if (auto it = processing_bus_cache_->bus_info.find(args);
-                it != processing_bus_cache_->bus_info.end()) {
+            auto& cache = processing_bus_cache_->checked(cache_generation_);
+            if (auto it = cache.bus_info.find(args);
+                it != cache.bus_info.end()) {
                 const bool log_response =
                     bridge_.logger_.log_request(true, request);
                 if (log_response) {
@@ -372,7 +621,8 @@ Vst3PluginProxyImpl::getBusInfo(Steinberg::Vst::MediaType type,
     {
         std::lock_guard lock(processing_bus_cache_mutex_);
         if (processing_bus_cache_) {
-            processing_bus_cache_->bus_info[args] = response.bus;
+            processing_bus_cache_->checked(cache_generation_)
+                .bus_info[args] = response.bus;
         }
     }
 
@@ -413,9 +663,46 @@ tresult PLUGIN_API Vst3PluginProxyImpl::setActive(TBool state) {
     //       workaround of its own. Great!
     clear_bus_cache();
 
+    // The workflow for latency changes outside of `restartComponent()` is
+    // that the host re-queries the latency after (re)activating the
+    // component, so the cached value can't be served across activations
+    {
+        std::lock_guard lock(function_result_cache_mutex_);
+        function_result_cache_.checked(cache_generation_)
+            .latency_samples.reset();
+    }
+
+    // Like `setProcessing()` above, the `async_state_transitions` option
+    // moves the round trip to a background thread. The next `process()` call
+    // waits for the transition, which also means the audio buffer
+    // reconfiguration below is guaranteed to have happened by then.
+    if (bridge_.config_.async_state_transitions) {
+        launch_state_transition([this, state]() {
+            const SetActiveResponse response =
+                bridge_.send_audio_processor_message(YaComponent::SetActive{
+                    .instance_id = instance_id(), .state = state});
+            handle_set_active_response(response);
+            if (response.result != Steinberg::kResultOk) {
+                bridge_.logger_.log(
+                    "WARNING: The plugin returned '" +
+                    response.result.string() +
+                    "' from an asynchronous 'IComponent::setActive(" +
+                    (state ? "true" : "false") + ")' call");
+            }
+        });
+
+        return Steinberg::kResultOk;
+    }
+
     const SetActiveResponse response = bridge_.send_audio_processor_message(
         YaComponent::SetActive{.instance_id = instance_id(), .state = state});
+    handle_set_active_response(response);
 
+    return response.result;
+}
+
+void Vst3PluginProxyImpl::handle_set_active_response(
+    const SetActiveResponse& response) {
     // NOTE: REAPER may (and will) change a plugin's channel layout after
     //       calling `IAudioProcessor::setupProcessing()`. Because of that, we
     //       need to test whether this has happened any time the plugin gets
@@ -427,8 +714,6 @@ tresult PLUGIN_API Vst3PluginProxyImpl::setActive(TBool state) {
             process_buffers_->resize(*response.updated_audio_buffers_config);
         }
     }
-
-    return response.result;
 }
 
 tresult PLUGIN_API Vst3PluginProxyImpl::setState(Steinberg::IBStream* state) {
@@ -441,9 +726,15 @@ tresult PLUGIN_API Vst3PluginProxyImpl::setState(Steinberg::IBStream* state) {
         //       GUI thread. So if the GUI is active, we'll use the mutual
         //       recursion mechanism to allow this resize call to also be
         //       performed from the GUI thread.
-        return bridge_.send_mutually_recursive_message(
+        const tresult result = bridge_.send_mutually_recursive_message(
             Vst3PluginProxy::SetState{.instance_id = instance_id(),
                                       .state = state});
+
+        // Loading state changes parameter values wholesale, so cached values
+        // have to be refetched
+        invalidate_parameter_cache();
+
+        return result;
     } else {
         bridge_.logger_.log(
             "WARNING: Null pointer passed to "
@@ -463,10 +754,15 @@ tresult PLUGIN_API Vst3PluginProxyImpl::getState(Steinberg::IBStream* state) {
         //       so when changing a parameter also resizes the GUI we can run
         //       into a situation where we need mutually recursive function
         //       calls.
-        const GetStateResponse response =
+        GetStateResponse response =
             bridge_.send_mutually_recursive_message(Vst3PluginProxy::GetState{
                 .instance_id = instance_id(), .state = state});
 
+        // The Wine side only sends the ranges that changed since the last
+        // `getState()` call, so the full state has to be reconstructed from
+        // our retained copy first
+        response.state.decode_against(state_diff_decoder_);
+
         assert(response.state.write_back(state) == Steinberg::kResultOk);
 
         return response.result;
@@ -545,8 +841,11 @@ tresult PLUGIN_API Vst3PluginProxyImpl::connect(IConnectionPoint* other) {
 tresult PLUGIN_API
 Vst3PluginProxyImpl::disconnect(IConnectionPoint* /*other*/) {
     // See `Vst3PluginProxyImpl::connect()`, if we directly connected two
-    // instances we'll also disconnect them again
-    if (connected_instance_id_) {
+    // instances we'll also disconnect them again. The connection proxy check
+    // comes first because the actual connection always goes through the
+    // host's proxy when it is set, even if we later managed to figure out
+    // which object we're connected to.
+    if (connected_instance_id_ && !connection_point_proxy_) {
         return bridge_.send_message(YaConnectionPoint::Disconnect{
             .instance_id = instance_id(),
             .other_instance_id = *connected_instance_id_});
@@ -596,7 +895,21 @@ Vst3PluginProxyImpl::notify(Steinberg::Vst::IMessage* message) {
                     *reinterpret_cast<Vst3PluginProxyImpl*>(
                         static_cast<size_t>(other_object_ptr));
 
-                other_object.connected_instance_id_ = instance_id();
+                if (other_object.connection_point_proxy_) {
+                    // The host's connection proxy delivered this discovery
+                    // message only after the other object's `connect()` had
+                    // already fallen back to proxying that connection proxy.
+                    // We can't redo the connection at this point, but we can
+                    // tell the Wine side to deliver the other object's
+                    // `notify()` calls directly to us, skipping the trip
+                    // through this process and the host's proxy.
+                    other_object.bridge_.send_message(
+                        YaConnectionPoint::BypassConnectionProxy{
+                            .instance_id = other_object.instance_id(),
+                            .other_instance_id = instance_id()});
+                } else {
+                    other_object.connected_instance_id_ = instance_id();
+                }
 
                 return Steinberg::kResultOk;
             }
@@ -612,8 +925,15 @@ Vst3PluginProxyImpl::notify(Steinberg::Vst::IMessage* message) {
 tresult PLUGIN_API
 Vst3PluginProxyImpl::setComponentState(Steinberg::IBStream* state) {
     if (state) {
-        return bridge_.send_message(YaEditController::SetComponentState{
-            .instance_id = instance_id(), .state = state});
+        const tresult result =
+            bridge_.send_message(YaEditController::SetComponentState{
+                .instance_id = instance_id(), .state = state});
+
+        // Same as in `setState()`, the controller's parameter values just
+        // changed wholesale
+        invalidate_parameter_cache();
+
+        return result;
     } else {
         bridge_.logger_.log(
             "WARNING: Null pointer passed to "
@@ -631,7 +951,9 @@ int32 PLUGIN_API Vst3PluginProxyImpl::getParameterCount() {
     maybe_query_parameter_info();
 
     std::lock_guard lock(function_result_cache_mutex_);
-    return static_cast<int32>(function_result_cache_.parameter_info.size());
+    return static_cast<int32>(
+        function_result_cache_.checked(cache_generation_)
+            .parameter_info.size());
 }
 
 tresult PLUGIN_API Vst3PluginProxyImpl::getParameterInfo(
@@ -646,10 +968,9 @@ tresult PLUGIN_API Vst3PluginProxyImpl::getParameterInfo(
     maybe_query_parameter_info();
 
     std::lock_guard lock(function_result_cache_mutex_);
-    if (paramIndex <
-        static_cast<int32>(function_result_cache_.parameter_info.size())) {
-        if (const auto& result =
-                function_result_cache_.parameter_info[paramIndex]) {
+    const auto& cache = function_result_cache_.checked(cache_generation_);
+    if (paramIndex < static_cast<int32>(cache.parameter_info.size())) {
+        if (const auto& result = cache.parameter_info[paramIndex]) {
             info = *result;
             return Steinberg::kResultOk;
         } else {
@@ -723,15 +1044,92 @@ Vst3PluginProxyImpl::plainParamToNormalized(
 
 Steinberg::Vst::ParamValue PLUGIN_API
 Vst3PluginProxyImpl::getParamNormalized(Steinberg::Vst::ParamID id) {
-    return bridge_.send_message(YaEditController::GetParamNormalized{
-        .instance_id = instance_id(), .id = id});
+    const auto request = YaEditController::GetParamNormalized{
+        .instance_id = instance_id(), .id = id};
+
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard lock(param_value_cache_mutex_);
+
+        // A plugin initiated change marks every tracked value stale, without
+        // dropping the tracked set so the refresh below still covers all of
+        // them in one round trip. Validation is a single atomic load, see
+        // `CacheGeneration`.
+        const uint64_t current_generation = cache_generation_.current();
+        if (param_value_cache_checked_generation_ != current_generation) {
+            for (auto& [stale_id, entry] : param_value_cache_) {
+                entry.last_updated = std::chrono::steady_clock::time_point{};
+            }
+            param_value_cache_checked_generation_ = current_generation;
+        }
+
+        if (const auto it = param_value_cache_.find(id);
+            it != param_value_cache_.end() &&
+            now - it->second.last_updated < parameter_value_cache_max_age) {
+            const bool log_response =
+                bridge_.logger_.log_request(true, request);
+            if (log_response) {
+                bridge_.logger_.log_response(
+                    true,
+                    YaEditController::GetParamNormalized::Response(
+                        it->second.value),
+                    true);
+            }
+
+            return it->second.value;
+        }
+    }
+
+    // On a miss or a stale entry we'll refresh every tracked parameter with a
+    // single round trip. Hosts poll every visible parameter at UI rate, so
+    // whenever one value has gone stale the rest of them are about to be
+    // polled too.
+    std::vector<Steinberg::Vst::ParamID> ids;
+    {
+        std::lock_guard lock(param_value_cache_mutex_);
+        ids.reserve(param_value_cache_.size() + 1);
+        for (const auto& [tracked_id, entry] : param_value_cache_) {
+            ids.push_back(tracked_id);
+        }
+        if (!param_value_cache_.contains(id)) {
+            ids.push_back(id);
+        }
+    }
+
+    const YaEditController::GetParamNormalizedMultiResponse response =
+        bridge_.send_message(YaEditController::GetParamNormalizedMulti{
+            .instance_id = instance_id(), .ids = ids});
+    assert(response.values.size() == ids.size());
+
+    Steinberg::Vst::ParamValue result = 0.0;
+    {
+        std::lock_guard lock(param_value_cache_mutex_);
+        for (size_t i = 0; i < ids.size(); i++) {
+            param_value_cache_[ids[i]] = ParamValueCacheEntry{
+                .value = response.values[i], .last_updated = now};
+            if (ids[i] == id) {
+                result = response.values[i];
+            }
+        }
+    }
+
+    return result;
 }
 
 tresult PLUGIN_API
 Vst3PluginProxyImpl::setParamNormalized(Steinberg::Vst::ParamID id,
                                         Steinberg::Vst::ParamValue value) {
-    return bridge_.send_message(YaEditController::SetParamNormalized{
-        .instance_id = instance_id(), .id = id, .value = value});
+    const tresult result =
+        bridge_.send_message(YaEditController::SetParamNormalized{
+            .instance_id = instance_id(), .id = id, .value = value});
+
+    // The host is the authority on the value it just set, so this keeps the
+    // polling cache fresh without any additional messages
+    if (result == Steinberg::kResultOk) {
+        update_parameter_cache(id, value);
+    }
+
+    return result;
 }
 
 tresult PLUGIN_API Vst3PluginProxyImpl::setComponentHandler(
@@ -782,7 +1180,9 @@ Vst3PluginProxyImpl::createView(Steinberg::FIDString name) {
 
         if (response.plug_view_args) {
             // The host should manage this. Returning raw pointers feels scary.
-            auto plug_view_proxy = new Vst3PlugViewProxyImpl(
+            // The view is allocated from this instance's arena so it sits
+            // right next to the rest of the proxy graph.
+            auto plug_view_proxy = new (arena()) Vst3PlugViewProxyImpl(
                 bridge_, std::move(*response.plug_view_args));
 
             // We also need to store an (unmanaged, since we don't want to
@@ -1165,20 +1565,39 @@ Vst3PluginProxyImpl::setUnitData(Steinberg::Vst::UnitID unitId,
 }
 
 int32 PLUGIN_API Vst3PluginProxyImpl::getUnitCount() {
-    return bridge_.send_message(
-        YaUnitInfo::GetUnitCount{.instance_id = instance_id()});
+    // Hosts walk the entire unit tree with these two functions, some of them
+    // repeatedly. The first time either of them is called we'll fetch the
+    // infos for all units at once. These are cleared when the plugin triggers
+    // a component restart that can change the unit hierarchy.
+    maybe_query_unit_info();
+
+    std::lock_guard lock(function_result_cache_mutex_);
+    return static_cast<int32>(
+        function_result_cache_.checked(cache_generation_).unit_info.size());
 }
 
 tresult PLUGIN_API
 Vst3PluginProxyImpl::getUnitInfo(int32 unitIndex,
                                  Steinberg::Vst::UnitInfo& info /*out*/) {
-    const GetUnitInfoResponse response =
-        bridge_.send_message(YaUnitInfo::GetUnitInfo{
-            .instance_id = instance_id(), .unit_index = unitIndex});
+    if (unitIndex < 0) {
+        return Steinberg::kInvalidArgument;
+    }
 
-    info = response.info;
+    // See above
+    maybe_query_unit_info();
 
-    return response.result;
+    std::lock_guard lock(function_result_cache_mutex_);
+    const auto& cache = function_result_cache_.checked(cache_generation_);
+    if (unitIndex < static_cast<int32>(cache.unit_info.size())) {
+        if (const auto& result = cache.unit_info[unitIndex]) {
+            info = *result;
+            return Steinberg::kResultOk;
+        } else {
+            return Steinberg::kResultFalse;
+        }
+    } else {
+        return Steinberg::kInvalidArgument;
+    }
 }
 
 int32 PLUGIN_API Vst3PluginProxyImpl::getProgramListCount() {
@@ -1345,16 +1764,78 @@ tresult PLUGIN_API Vst3PluginProxyImpl::getXmlRepresentationStream(
     }
 }
 
+void Vst3PluginProxyImpl::update_parameter_cache(
+    Steinberg::Vst::ParamID id,
+    Steinberg::Vst::ParamValue value) noexcept {
+    std::lock_guard lock(param_value_cache_mutex_);
+    param_value_cache_[id] = ParamValueCacheEntry{
+        .value = value, .last_updated = std::chrono::steady_clock::now()};
+}
+
+void Vst3PluginProxyImpl::update_parameter_cache_from_output_changes(
+    const YaParameterChanges& output_changes) noexcept {
+    const int32 num_queues =
+        static_cast<int32>(output_changes.num_parameters());
+    if (num_queues == 0) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(param_value_cache_mutex_);
+    for (int32 queue_index = 0; queue_index < num_queues; queue_index++) {
+        // Only parameters the host is actually polling get refreshed, so
+        // this never inserts (and thus never allocates) on the audio thread
+        const auto it = param_value_cache_.find(
+            output_changes.queue_parameter_id(queue_index));
+        if (it == param_value_cache_.end()) {
+            continue;
+        }
+
+        const int32 num_points = output_changes.queue_num_points(queue_index);
+        int32 sample_offset;
+        Steinberg::Vst::ParamValue value;
+        if (num_points > 0 &&
+            output_changes.queue_get_point(queue_index, num_points - 1,
+                                           sample_offset, value) ==
+                Steinberg::kResultOk) {
+            it->second = ParamValueCacheEntry{.value = value,
+                                              .last_updated = now};
+        }
+    }
+}
+
+void Vst3PluginProxyImpl::invalidate_parameter_cache() noexcept {
+    std::lock_guard lock(param_value_cache_mutex_);
+    for (auto& [id, entry] : param_value_cache_) {
+        entry.last_updated = std::chrono::steady_clock::time_point{};
+    }
+}
+
 void Vst3PluginProxyImpl::maybe_query_parameter_info() {
     std::lock_guard lock(function_result_cache_mutex_);
 
     // We'll assume that the plugin has at least one parameter. If it does not
     // have any parameters then everything will work as expected, except that
     // the parameter count is not cached.
-    if (function_result_cache_.parameter_info.empty()) {
+    auto& cache = function_result_cache_.checked(cache_generation_);
+    if (cache.parameter_info.empty()) {
         const GetParameterInfosResponse response = bridge_.send_message(
             YaEditController::GetParameterInfos{.instance_id = instance_id()});
-        function_result_cache_.parameter_info = std::move(response.infos);
+        cache.parameter_info = std::move(response.infos);
+    }
+}
+
+void Vst3PluginProxyImpl::maybe_query_unit_info() {
+    std::lock_guard lock(function_result_cache_mutex_);
+
+    // Just like with the parameter infos above, a plugin without any units
+    // will work fine except that the unit count is not cached
+    auto& cache = function_result_cache_.checked(cache_generation_);
+    if (cache.unit_info.empty()) {
+        const GetUnitInfosResponse response = bridge_.send_message(
+            YaUnitInfo::GetUnitInfos{.instance_id = instance_id()});
+        cache.unit_info = std::move(response.infos);
     }
 }
 
@@ -16,10 +16,18 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <thread>
 
+#include <function2/function2.hpp>
+
+#include "../cache-generation.h"
 #include "../vst3.h"
 #include "plug-view-proxy.h"
+#include "proxy-arena.h"
 
 /**
  * Here we pass though all function calls made by the host to the Windows VST3
@@ -40,6 +48,23 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
      */
     ~Vst3PluginProxyImpl() noexcept override;
 
+    /**
+     * This object is the root of one plugin instance's proxy graph, and it
+     * owns the arena that backs both itself and the plug view proxies
+     * created through `IEditController::createView()`. When the host drops
+     * its last reference to this object, `operator delete` frees the arena
+     * and with it the whole graph's memory at once.
+     *
+     * @see Vst3ProxyArena
+     */
+    void* operator new(size_t size);
+    void operator delete(void* object) noexcept;
+
+    /**
+     * The arena backing this instance's proxy objects.
+     */
+    Vst3ProxyArena& arena() noexcept;
+
     /**
      * We'll override the query interface to log queries for interfaces we do
      * not (yet) support.
@@ -64,17 +89,40 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
     bool unregister_context_menu(size_t context_menu_id);
 
     /**
-     * Clear our function call caches. We'll do this when the plugin calls
-     * `IComponentHandler::restartComponent()`. These caching layers are
-     * necessary to get decent performance in certain hosts because they will
-     * call these functions repeatedly even when their values cannot change.
+     * Invalidate our function call caches. We'll do this when the plugin
+     * calls `IComponentHandler::restartComponent()`. These caching layers
+     * are necessary to get decent performance in certain hosts because they
+     * will call these functions repeatedly even when their values cannot
+     * change. All of the caches share the generation tagged invalidation
+     * protocol from `cache_generation_`, so a single bump here invalidates
+     * every one of them and a stale read is structurally impossible. The
+     * only thing the generation cannot express is that the parameter set
+     * itself may have changed, so a full component reload additionally drops
+     * the set of tracked parameter values.
      *
      * See the bottom of this class for more information on what we're caching.
      *
-     * @see clear_bus_cache_
+     * @param restart_flags The `Steinberg::Vst::RestartFlags` passed to
+     *   `IComponentHandler::restartComponent()`.
+     *
+     * @see cache_generation_
      * @see function_result_cache_
      */
-    void clear_caches() noexcept;
+    void clear_caches(int32 restart_flags) noexcept;
+
+    /**
+     * Store an authoritative normalized value for a parameter in
+     * `param_value_cache_`. Called whenever a value change passes through the
+     * bridge anyway: on `IComponentHandler::performEdit()` callbacks, on
+     * successful `IEditController::setParamNormalized()` calls, and for the
+     * output parameter changes produced by `IAudioProcessor::process()`.
+     * These pushed values keep the cache fresh so UI-rate
+     * `getParamNormalized()` polling doesn't need any messages at all.
+     *
+     * @see param_value_cache_
+     */
+    void update_parameter_cache(Steinberg::Vst::ParamID id,
+                                Steinberg::Vst::ParamValue value) noexcept;
 
     // From `IAudioPresentationLatency`
     tresult PLUGIN_API
@@ -398,6 +446,31 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
     Steinberg::FUnknownPtr<Steinberg::Vst::IUnitHandler2> unit_handler_2_;
 
    private:
+    /**
+     * With the `async_state_transitions` option enabled, run an activation
+     * or processing state transition on a background thread while the
+     * calling thread continues immediately, see `setActive()` and
+     * `setProcessing()`. Transitions have to stay ordered with respect to
+     * each other, so this first waits for any previous transition to finish.
+     * `process()` synchronizes with the transition through
+     * `wait_for_state_transition()` before touching the audio buffers.
+     */
+    void launch_state_transition(fu2::unique_function<void()> transition);
+
+    /**
+     * Block until the transition launched by `launch_state_transition()` has
+     * finished, if one is still in flight. A single atomic load when there
+     * isn't one.
+     */
+    void wait_for_state_transition() noexcept;
+
+    /**
+     * Apply the audio buffer reconfiguration from a
+     * `YaComponent::SetActive` response, shared between the synchronous
+     * `setActive()` path and the asynchronous transitions.
+     */
+    void handle_set_active_response(const SetActiveResponse& response);
+
     /**
      * Query information for all of the plugin's parameters and writes the
      * results to `function_result_cache_` if necessary. Otherwise does nothing.
@@ -406,6 +479,37 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
      */
     void maybe_query_parameter_info();
 
+    /**
+     * Query the plugin's entire unit hierarchy and write the results to
+     * `function_result_cache_` if necessary. Otherwise does nothing. The same
+     * locking caveat as with `maybe_query_parameter_info()` applies.
+     */
+    void maybe_query_unit_info();
+
+    /**
+     * Harvest the final value of every queue in the plugin's output parameter
+     * changes into `param_value_cache_`. Called from `process()` right after
+     * the outputs have been written back. This only refreshes parameters that
+     * are already in the cache so the audio thread never allocates here,
+     * values for parameters the host isn't polling wouldn't be read anyway.
+     *
+     * @see param_value_cache_
+     */
+    void update_parameter_cache_from_output_changes(
+        const YaParameterChanges& output_changes) noexcept;
+
+    /**
+     * Mark every entry in `param_value_cache_` as stale without dropping the
+     * set of tracked parameters. The first `getParamNormalized()` call
+     * afterwards will refetch all of them with a single round trip. Used
+     * when parameter values change wholesale for a host-initiated reason,
+     * like after loading state. Plugin initiated changes go through
+     * `cache_generation_` instead.
+     *
+     * @see param_value_cache_
+     */
+    void invalidate_parameter_cache() noexcept;
+
     /**
      * Clear the bus count and information cache. We need this cache for REAPER
      * as it makes `num_inputs + num_outputs + 2` function calls to retrieve
@@ -440,6 +544,14 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
      */
     time_t last_audio_thread_priority_synchronization_ = 0;
 
+    /**
+     * The sample rate from the last `IAudioProcessor::setupProcessing()`
+     * call, used to derive the deadline for a processing call in
+     * `PluginBridge::record_audio_processing_call()`. Stays at zero until the host
+     * has set up processing.
+     */
+    std::atomic<double> last_sample_rate_ = 0.0;
+
     /**
      * Used to assign unique identifiers to context menus created by
      * `IComponentHandler3::CreateContextMenu`.
@@ -482,6 +594,14 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
 
     // Caches
 
+    /**
+     * The generation counter behind the shared invalidation protocol all of
+     * this instance's caches below use, see `CacheGeneration`. Bumped once
+     * when the plugin calls `IComponentHandler::restartComponent()`, which
+     * invalidates every generation tagged cache at the same time.
+     */
+    CacheGeneration cache_generation_;
+
     /**
      * A cache for `IAudioProcessor::getBusCount()` and
      * `IAudioProcessor::getBusInfo()`. We'll memoize the function calls for
@@ -515,11 +635,13 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
      * in.
      *
      * Since this information is immutable during audio processing, this cache
-     * will only be available at those times.
+     * will only be available at those times. The optional tracks whether the
+     * cache is enabled at all, and the generation tag inside of it handles
+     * the invalidation on plugin initiated changes.
      *
      * @see clear_bus_cache_
      */
-    std::optional<BusInfoCache> processing_bus_cache_;
+    std::optional<GenerationTagged<BusInfoCache>> processing_bus_cache_;
     std::mutex processing_bus_cache_mutex_;
 
     /**
@@ -536,6 +658,17 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
          * call this every processing cycle.
          */
         std::map<int32, tresult> can_process_sample_size;
+        /**
+         * Memoizes `IAudioProcessor::getLatencySamples()`. Some hosts
+         * re-query the latency every processing cycle while plugin delay
+         * compensation is active, and the plugin has to report latency
+         * changes through `restartComponent()` with `kLatencyChanged`, so
+         * the value can be served locally in between those restarts. Also
+         * cleared when the host changes the processing setup, since plugins
+         * may report a different latency for a new sample rate or maximum
+         * block size without restarting.
+         */
+        std::optional<uint32> latency_samples;
         /**
          * Memoizes `IEditController::getParameterCount()` and
          * `IEditController::getParameterInfo()`. This information is queried
@@ -550,6 +683,40 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
          */
         std::vector<std::optional<Steinberg::Vst::ParameterInfo>>
             parameter_info;
+        /**
+         * Memoizes `IUnitInfo::getUnitCount()` and
+         * `IUnitInfo::getUnitInfo()`. Hosts walk the entire unit tree when
+         * building their parameter lists, and some of them do this every time
+         * the plugin reports a parameter change. Since the unit hierarchy can
+         * only change with a component reload, we can fetch it once and serve
+         * the tree walks locally.
+         *
+         * Uses the same `std::optional` approach as `parameter_info` above.
+         */
+        std::vector<std::optional<Steinberg::Vst::UnitInfo>> unit_info;
+        /**
+         * The last input and output arrangement set the plugin accepted
+         * through `IAudioProcessor::setBusArrangements()`. Hosts replay the
+         * exact same negotiation on every activation and on every graph
+         * rebuild, so a repeat request for the layout the plugin is already
+         * in can be acknowledged locally. The plugin cannot change its
+         * arrangements outside of this function without a `kIoChanged`
+         * restart, which clears this field again.
+         */
+        std::optional<
+            std::pair<std::vector<Steinberg::Vst::SpeakerArrangement>,
+                      std::vector<Steinberg::Vst::SpeakerArrangement>>>
+            accepted_arrangements;
+        /**
+         * Memoizes successful `IAudioProcessor::getBusArrangement()` calls.
+         * Hosts walk all of the plugin's busses after every negotiation and
+         * activation even when nothing changed in between. Cleared together
+         * with `accepted_arrangements` above. The same `std::map` remark as
+         * in `BusInfoCache` applies.
+         */
+        std::map<std::tuple<Steinberg::Vst::BusDirection, int32>,
+                 Steinberg::Vst::SpeakerArrangement>
+            bus_arrangement;
     };
 
     /**
@@ -561,11 +728,75 @@ class Vst3PluginProxyImpl : public Vst3PluginProxy {
      * fixed, but we'll keep it in because some other hosts also query this
      * information more than once.
      *
-     * The cache will be cleared when the plugin tells the host that some of its
-     * parameter values have changed.
+     * The cache is invalidated through `cache_generation_` when the plugin
+     * tells the host that something about it has changed.
      *
      * @see clear_caches
      */
-    FunctionResultCache function_result_cache_;
+    GenerationTagged<FunctionResultCache> function_result_cache_;
     std::mutex function_result_cache_mutex_;
+
+    /**
+     * A cached normalized parameter value along with the time it was last
+     * confirmed, either by a value change passing through the bridge or by a
+     * bulk readout.
+     *
+     * @see param_value_cache_
+     */
+    struct ParamValueCacheEntry {
+        Steinberg::Vst::ParamValue value;
+        std::chrono::steady_clock::time_point last_updated;
+    };
+
+    /**
+     * The last known normalized value for every parameter the host has polled
+     * through `IEditController::getParamNormalized()`. REAPER and other hosts
+     * poll every visible parameter at UI rate, which would otherwise cost one
+     * round trip per parameter per frame. Entries are refreshed for free by
+     * value changes that pass through the bridge anyway (`performEdit()`
+     * callbacks, `setParamNormalized()`, and output parameter changes from
+     * processing), and a poll for a value that hasn't been confirmed recently
+     * refetches all tracked parameters with a single
+     * `YaEditController::GetParamNormalizedMulti` round trip. The staleness
+     * bound exists because not every plugin correctly announces internal
+     * value changes through `performEdit()`.
+     *
+     * @see update_parameter_cache
+     * @see invalidate_parameter_cache
+     */
+    std::map<Steinberg::Vst::ParamID, ParamValueCacheEntry> param_value_cache_;
+    std::mutex param_value_cache_mutex_;
+    /**
+     * The generation the entries in `param_value_cache_` were last validated
+     * against, see `cache_generation_`. The poll path compares this against
+     * the current generation and marks every entry stale on a mismatch,
+     * which keeps the set of tracked parameters intact so the next poll
+     * still refreshes all of them with a single round trip. Guarded by
+     * `param_value_cache_mutex_`.
+     */
+    uint64_t param_value_cache_checked_generation_ = 0;
+
+    /**
+     * Retains the last state received in a `getState()` response so the Wine
+     * side only has to transfer the ranges that changed between host
+     * autosaves, see `YaBStream::decode_against()`.
+     */
+    StateDiffDecoder state_diff_decoder_;
+
+    /**
+     * Whether a state transition launched by `launch_state_transition()` is
+     * still in flight. Set before the transition thread starts and cleared
+     * by that thread under `state_transition_mutex_` once the round trip has
+     * finished, see the `async_state_transitions` option.
+     */
+    std::atomic_bool state_transition_in_flight_ = false;
+    std::mutex state_transition_mutex_;
+    std::condition_variable state_transition_cv_;
+    /**
+     * The thread performing the current state transition, if any. Only
+     * assigned after the previous transition has finished, so the implicit
+     * join when assigning a new thread never blocks. Declared last so it's
+     * joined before any of the state it uses gets destroyed.
+     */
+    std::jthread state_transition_thread_;
 };
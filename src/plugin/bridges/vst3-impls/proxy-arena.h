@@ -0,0 +1,211 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * A small arena that backs all proxy objects belonging to a single VST3
+ * plugin instance. One plugin instance consists of a `Vst3PluginProxyImpl`
+ * plus the `Vst3PlugViewProxyImpl` objects created for it, and allocating
+ * them from one arena keeps them on the same cache lines instead of
+ * scattered wherever the global heap happened to place them. It also makes
+ * tearing an instance down a matter of freeing a couple of chunks rather
+ * than walking individual allocations.
+ *
+ * The arena is owned by the root proxy object, which is itself placed inside
+ * the arena's first chunk. `allocate_owning()`/`deallocate_owning()` stash a
+ * pointer to the arena just in front of the root object so the root's
+ * `operator delete` can find and free the arena again, since by the time a
+ * deallocation function runs the object's members are already gone.
+ *
+ * Objects allocated through `allocate_member()` may not outlive the root
+ * object. This always holds here because VST3's lifetime rules require a
+ * plug view to be destroyed before the edit controller it was created from.
+ */
+class Vst3ProxyArena {
+   public:
+    Vst3ProxyArena() noexcept = default;
+
+    Vst3ProxyArena(const Vst3ProxyArena&) = delete;
+    Vst3ProxyArena& operator=(const Vst3ProxyArena&) = delete;
+    Vst3ProxyArena(Vst3ProxyArena&&) = delete;
+    Vst3ProxyArena& operator=(Vst3ProxyArena&&) = delete;
+
+    /**
+     * Allocate storage for the object that will own the arena. The object is
+     * placed in the arena like any other allocation, with the arena pointer
+     * stored in a header just in front of it. The object's `operator delete`
+     * should call `deallocate_owning()`, which frees the arena and with it
+     * every other object allocated from it.
+     */
+    static void* allocate_owning(std::unique_ptr<Vst3ProxyArena> arena,
+                                 size_t size) {
+        std::byte* block =
+            static_cast<std::byte*>(arena->allocate(header_size + size));
+        *reinterpret_cast<Vst3ProxyArena**>(block) = arena.get();
+
+        // The arena is now reachable through the header, and it gets freed
+        // again in `deallocate_owning()`
+        arena.release();
+
+        return block + header_size;
+    }
+
+    /**
+     * Free the arena owned by an object allocated with `allocate_owning()`,
+     * releasing the entire proxy graph's memory at once. This must only be
+     * called after all objects in the arena have been destructed.
+     */
+    static void deallocate_owning(void* object) noexcept {
+        std::byte* block = static_cast<std::byte*>(object) - header_size;
+        delete *reinterpret_cast<Vst3ProxyArena**>(block);
+    }
+
+    /**
+     * The arena an object allocated with `allocate_owning()` was placed in.
+     * Used to allocate the instance's other proxy objects from that same
+     * arena.
+     */
+    static Vst3ProxyArena& of(void* object) noexcept {
+        std::byte* block = static_cast<std::byte*>(object) - header_size;
+        return **reinterpret_cast<Vst3ProxyArena**>(block);
+    }
+
+    /**
+     * Allocate storage for an object whose lifetime is bounded by the arena's
+     * owning object. The same header trick as in `allocate_owning()` is used
+     * so `deallocate_member()` can find the arena again from just the
+     * object's address.
+     */
+    static void* allocate_member(Vst3ProxyArena& arena, size_t size) {
+        std::byte* block =
+            static_cast<std::byte*>(arena.allocate(header_size + size));
+        *reinterpret_cast<Vst3ProxyArena**>(block) = &arena;
+
+        return block + header_size;
+    }
+
+    /**
+     * Return an `allocate_member()` allocation to its arena's free list so
+     * the storage can be reused, for instance when the host opens and closes
+     * a plugin's editor over and over again. The memory itself is only
+     * released when the whole arena is freed.
+     */
+    static void deallocate_member(void* object, size_t size) noexcept {
+        std::byte* block = static_cast<std::byte*>(object) - header_size;
+        (*reinterpret_cast<Vst3ProxyArena**>(block))
+            ->deallocate(block, header_size + size);
+    }
+
+    /**
+     * Allocate `size` bytes from the arena, aligned for any object type.
+     * Previously deallocated blocks of the same size get reused, anything
+     * else comes from a simple bump pointer into the current chunk.
+     */
+    void* allocate(size_t size) {
+        size = align_up(size);
+
+        std::lock_guard lock(mutex_);
+
+        // Reusing blocks keeps repeated editor open/close cycles from
+        // growing the arena
+        for (size_t i = 0; i < free_blocks_.size(); i++) {
+            if (free_blocks_[i].second == size) {
+                void* block = free_blocks_[i].first;
+                free_blocks_[i] = free_blocks_.back();
+                free_blocks_.pop_back();
+
+                return block;
+            }
+        }
+
+        // Allocations that don't fit in a chunk get their own dedicated
+        // chunk, without disturbing the bump pointer
+        if (size > chunk_size) {
+            return chunks_.emplace_back(std::make_unique<std::byte[]>(size))
+                .get();
+        }
+
+        if (remaining_ < size) {
+            current_ =
+                chunks_.emplace_back(std::make_unique<std::byte[]>(chunk_size))
+                    .get();
+            remaining_ = chunk_size;
+        }
+
+        void* block = current_;
+        current_ += size;
+        remaining_ -= size;
+
+        return block;
+    }
+
+    /**
+     * Make a block returned by `allocate()` available for reuse. This doesn't
+     * free any memory, that only happens when the arena itself is destroyed.
+     */
+    void deallocate(void* block, size_t size) noexcept {
+        std::lock_guard lock(mutex_);
+        free_blocks_.emplace_back(block, align_up(size));
+    }
+
+   private:
+    /**
+     * The size of the header in front of objects allocated with
+     * `allocate_owning()` and `allocate_member()`. A full alignment unit is
+     * used so the object behind it stays aligned for any type.
+     */
+    static constexpr size_t header_size = alignof(std::max_align_t);
+    static_assert(sizeof(Vst3ProxyArena*) <= header_size);
+
+    static constexpr size_t chunk_size = 1 << 14;
+
+    static constexpr size_t align_up(size_t size) noexcept {
+        constexpr size_t alignment = alignof(std::max_align_t);
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    /**
+     * All chunks allocated so far. `operator new[]` aligns these for
+     * `std::max_align_t`, and they're freed all at once when the arena is
+     * destroyed.
+     */
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    /**
+     * The bump pointer into the most recent non-dedicated chunk, and the
+     * number of bytes left there.
+     */
+    std::byte* current_ = nullptr;
+    size_t remaining_ = 0;
+
+    /**
+     * Deallocated blocks available for reuse, stored with their (aligned)
+     * sizes.
+     */
+    std::vector<std::pair<void*, size_t>> free_blocks_;
+
+    /**
+     * Proxy objects get created and destroyed from multiple threads, but
+     * never frequently enough for this lock to matter.
+     */
+    std::mutex mutex_;
+};
@@ -43,6 +43,11 @@ Vst3PluginBridge::Vst3PluginBridge(const ghc::filesystem::path& plugin_path)
     // host
     connect_sockets_guarded();
 
+    // This side sends the control messages, so concurrent requests can be
+    // handled over pre-established spare connections when the `spare_sockets`
+    // option is set
+    sockets_.host_plugin_control_.set_spare_sockets(config_.spare_sockets);
+
     // Now that communication is set up the Wine host can send callbacks to this
     // bridge class, and we can send control messages to the Wine host. This
     // messaging mechanism is how we relay the VST3 communication protocol. As a
@@ -50,7 +55,11 @@ Vst3PluginBridge::Vst3PluginBridge(const ghc::filesystem::path& plugin_path)
     // configuration.
     host_callback_handler_ = std::jthread([&]() {
         set_realtime_priority(true);
-        pthread_setname_np(pthread_self(), "host-callbacks");
+        if (config_.main_affinity) {
+            set_cpu_affinity(*config_.main_affinity);
+        }
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("host-callbacks");
 
         sockets_.plugin_host_callback_.receive_messages(
             std::pair<Vst3Logger&, bool>(logger_, false),
@@ -84,9 +93,33 @@ Vst3PluginBridge::Vst3PluginBridge(const ghc::filesystem::path& plugin_path)
                     const auto& [proxy_object, _] =
                         get_proxy(request.owner_instance_id);
 
+                    // The plugin just announced this value, so it also keeps
+                    // the `getParamNormalized()` polling cache fresh
+                    proxy_object.update_parameter_cache(
+                        request.id, request.value_normalized);
+
                     return proxy_object.component_handler_->performEdit(
                         request.id, request.value_normalized);
                 },
+                [&](const YaComponentHandler::PerformEditBatch& request)
+                    -> YaComponentHandler::PerformEditBatch::Response {
+                    const auto& [proxy_object, _] =
+                        get_proxy(request.owner_instance_id);
+
+                    // These edits were accumulated on the Wine side during a
+                    // GUI frame, and we'll replay them in call order. The
+                    // plugin already received `kResultOk` for the individual
+                    // calls, so the result is only used for logging.
+                    tresult result = Steinberg::kResultOk;
+                    for (const auto& [id, value_normalized] : request.edits) {
+                        proxy_object.update_parameter_cache(id,
+                                                            value_normalized);
+                        result = proxy_object.component_handler_->performEdit(
+                            id, value_normalized);
+                    }
+
+                    return result;
+                },
                 [&](const YaComponentHandler::EndEdit& request)
                     -> YaComponentHandler::EndEdit::Response {
                     const auto& [proxy_object, _] =
@@ -99,9 +132,10 @@ Vst3PluginBridge::Vst3PluginBridge(const ghc::filesystem::path& plugin_path)
                     const auto& [proxy_object, _] =
                         get_proxy(request.owner_instance_id);
 
-                    // To err on the safe side, we'll just always clear out all
-                    // of our caches whenever a plugin requests a restart
-                    proxy_object.clear_caches();
+                    // The restart flags tell us exactly which cached
+                    // information can have changed, so we only drop the
+                    // affected caches
+                    proxy_object.clear_caches(request.flags);
 
                     return proxy_object.component_handler_->restartComponent(
                         request.flags);
@@ -307,7 +341,7 @@ Vst3PluginBridge::Vst3PluginBridge(const ghc::filesystem::path& plugin_path)
 
                     return YaHostApplication::GetNameResponse{
                         .result = result,
-                        .name = tchar_pointer_to_u16string(name),
+                        .name = name,
                     };
                 },
                 [&](YaPlugFrame::ResizeView& request)
@@ -409,13 +443,16 @@ Vst3PluginBridge::Vst3PluginBridge(const ghc::filesystem::path& plugin_path)
                 },
             });
     });
+
+    startup_trace_event("vst3-bridge-ready");
 }
 
 Vst3PluginBridge::~Vst3PluginBridge() noexcept {
     try {
-        // Drop all work make sure all sockets are closed
+        // Drop all work make sure all sockets are closed. The remaining pipe
+        // operations on the shared IO context are cancelled when
+        // `plugin_host_` gets destroyed.
         plugin_host_->terminate();
-        io_context_.stop();
     } catch (const std::system_error&) {
         // It could be that the sockets have already been closed or that the
         // process has already exited (at which point we probably won't be
@@ -434,12 +471,24 @@ Steinberg::IPluginFactory* Vst3PluginBridge::get_plugin_factory() {
         // will request after loading the module. Host callback handlers should
         // have started before this since the Wine plugin host will request a
         // copy of the configuration during its initialization.
-        Vst3PluginFactoryProxy::ConstructArgs factory_args =
-            sockets_.host_plugin_control_.send_message(
+        //
+        // The factory's contents are static for a given plugin version, so
+        // they're served from an on-disk cache when possible. This way hosts
+        // that enumerate the factory before instantiating anything don't have
+        // to wait for a round trip through the Wine plugin host.
+        std::optional<Vst3PluginFactoryProxy::ConstructArgs> factory_args =
+            load_cached_metadata<Vst3PluginFactoryProxy::ConstructArgs>(
+                info_.windows_library_path_, "vst3-factory");
+        if (!factory_args) {
+            factory_args = sockets_.host_plugin_control_.send_message(
                 Vst3PluginFactoryProxy::Construct{},
                 std::pair<Vst3Logger&, bool>(logger_, true));
+            store_cached_metadata(info_.windows_library_path_, "vst3-factory",
+                                  *factory_args);
+        }
+
         plugin_factory_ = Steinberg::owned(
-            new Vst3PluginFactoryProxyImpl(*this, std::move(factory_args)));
+            new Vst3PluginFactoryProxyImpl(*this, std::move(*factory_args)));
     }
 
     // Because we're returning a raw pointer, we have to increase the reference
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <shared_mutex>
 #include <thread>
 
@@ -115,6 +116,15 @@ class Vst3PluginBridge : PluginBridge<Vst3Sockets<std::jthread>> {
      */
     void unregister_plugin_proxy(Vst3PluginProxyImpl& proxy_object);
 
+    /**
+     * The time between GUI frames based on this plugin's `frame_rate` option.
+     * `Vst3PlugViewProxyImpl` uses this as the flush interval when coalescing
+     * `IPlugView::onSize()` calls during live resizes.
+     */
+    std::chrono::steady_clock::duration event_loop_interval() const noexcept {
+        return config_.event_loop_interval();
+    }
+
     /**
      * Send a control message to the Wine plugin host and return the response.
      * This is a shorthand for `sockets_.host_plugin_control_.send_message()`
@@ -190,6 +200,18 @@ class Vst3PluginBridge : PluginBridge<Vst3Sockets<std::jthread>> {
         return mutual_recursion_.maybe_handle(std::forward<F>(fn));
     }
 
+    /**
+     * Exposed so `Vst3PluginProxyImpl::process()` can update this instance's
+     * live stats block and record deadline misses to its xrun ring.
+     */
+    using PluginBridge<Vst3Sockets<std::jthread>>::record_audio_processing_call;
+
+    /**
+     * Exposed so `Vst3PluginProxyImpl` can check this instance's
+     * compatibility options, like `async_state_transitions`.
+     */
+    using PluginBridge<Vst3Sockets<std::jthread>>::config_;
+
     /**
      * The logging facility used for this instance of yabridge. Wraps around
      * `PluginBridge::generic_logger`.
@@ -16,18 +16,47 @@
 
 #include "host-process.h"
 
+#include <future>
+
+#include <asio/post.hpp>
 #include <asio/read_until.hpp>
 
+#include "../common/startup-trace.h"
 #include "../common/utils.h"
 
 namespace fs = ghc::filesystem;
 
 HostProcess::HostProcess(asio::io_context& io_context, Sockets& sockets)
-    : sockets_(sockets), stdout_pipe_(io_context), stderr_pipe_(io_context) {}
+    : sockets_(sockets),
+      io_context_(io_context),
+      stdout_pipe_(io_context),
+      stderr_pipe_(io_context) {}
+
+HostProcess::~HostProcess() noexcept {
+    // The pipes may only be touched from the reactor thread, since the
+    // relaying handlers run there. Closing them cancels any pending reads,
+    // and the handlers don't requeue themselves after an error.
+    std::packaged_task<void()> close_pipes([&]() {
+        std::error_code err;
+        stdout_pipe_.close(err);
+        stderr_pipe_.close(err);
+    });
+    std::future<void> pipes_closed = close_pipes.get_future();
+    asio::post(io_context_, std::move(close_pipes));
+    pipes_closed.wait();
+
+    // The cancelled completion handlers are queued on the reactor when the
+    // pipes get closed, so after this second round trip they're guaranteed to
+    // have run and nothing references this object's pipes and buffers anymore
+    std::packaged_task<void()> barrier([]() {});
+    std::future<void> handlers_flushed = barrier.get_future();
+    asio::post(io_context_, std::move(barrier));
+    handlers_flushed.wait();
+}
 
 Process::Handle HostProcess::launch_host(
     const ghc::filesystem::path& host_path,
-    std::initializer_list<std::string> args,
+    const std::vector<std::string>& args,
     Logger& logger,
     const Configuration& config,
     const PluginInfo& plugin_info) {
@@ -160,6 +189,120 @@ void IndividualHost::terminate() {
     handle_.terminate();
 }
 
+WarmPoolHost::WarmPoolHost(asio::io_context& io_context,
+                           Logger& logger,
+                           const Configuration& config,
+                           Sockets& sockets,
+                           const PluginInfo& plugin_info,
+                           const HostRequest& host_request)
+    : HostProcess(io_context, sockets),
+      plugin_info_(plugin_info),
+      host_path_(find_plugin_host(plugin_info.native_library_path_,
+                                  plugin_info.plugin_arch_)) {
+    // Try to hand the plugin to one of the pre-booted warm host processes
+    // first. A warm host stops accepting connections and removes its socket
+    // file as soon as it has been claimed, so every claim is exclusive. A
+    // failed connection indicates either an empty pool slot or a stale socket
+    // file left behind by a crashed process. In the latter case we'll remove
+    // the file so the slot can be refilled below.
+    const fs::path wine_prefix = plugin_info.normalize_wine_prefix();
+    for (size_t slot = 0; slot < config.warm_hosts; slot++) {
+        const fs::path socket_path = generate_warm_host_endpoint(
+            wine_prefix, plugin_info.plugin_arch_, slot);
+
+        try {
+            asio::local::stream_protocol::socket warm_socket(io_context);
+            warm_socket.connect(socket_path.string());
+
+            write_object(warm_socket, host_request);
+            const auto response = read_object<HostResponse>(warm_socket);
+            assert(response.pid > 0);
+
+            claimed_pid_ = response.pid;
+            logger.log("Loading the plugin in pre-booted host process " +
+                       std::to_string(response.pid));
+            break;
+        } catch (const std::system_error&) {
+            std::error_code err;
+            fs::remove(socket_path, err);
+        }
+    }
+
+    // When the pool hasn't been filled yet we'll just start a fresh process,
+    // exactly like `IndividualHost` would
+    if (!claimed_pid_) {
+        handle_ = launch_host(host_path_,
+                              {plugin_type_to_string(host_request.plugin_type),
+                               host_request.plugin_path,
+                               host_request.endpoint_base_dir,
+                               std::to_string(getpid())},
+                              logger, config, plugin_info);
+    }
+
+    // Top the pool back up for the next plugin load. Slots whose socket file
+    // still exists are either still warm or currently being booted by another
+    // instance, so those are skipped. A spawned process that loses the race to
+    // listen on its socket simply exits again, just like with group host
+    // processes.
+    for (size_t slot = 0; slot < config.warm_hosts; slot++) {
+        const fs::path socket_path = generate_warm_host_endpoint(
+            wine_prefix, plugin_info.plugin_arch_, slot);
+        if (fs::exists(socket_path)) {
+            continue;
+        }
+
+        Process warm_host(host_path_);
+        warm_host.arg("warm")
+            .arg(socket_path.string())
+            .arg(std::to_string(getpid()));
+        warm_host.environment(plugin_info.create_host_env());
+
+        // These processes will likely outlive this yabridge instance, so their
+        // output goes to a log file next to their socket instead of to this
+        // instance's pipes
+        fs::path log_path = socket_path;
+        log_path.replace_extension(".log");
+        std::visit(
+            overload{
+                [](Process::Handle handle) { handle.detach(); },
+                [&logger](const Process::CommandNotFound&) {
+                    logger.log(
+                        "Could not spawn a warm host process, command not "
+                        "found");
+                },
+                [&logger](const std::error_code& err) {
+                    logger.log("Error spawning a warm host process: " +
+                               err.message());
+                },
+            },
+            warm_host.spawn_child_redirected(log_path));
+    }
+}
+
+fs::path WarmPoolHost::path() {
+    return host_path_;
+}
+
+bool WarmPoolHost::running() {
+    if (claimed_pid_) {
+        return pid_running(*claimed_pid_);
+    } else {
+        return handle_->running();
+    }
+}
+
+void WarmPoolHost::terminate() {
+    // A claimed warm host process is not our child, so just like with group
+    // hosts we'll close the sockets to make the hosted plugin exit, after
+    // which the process shuts down by itself
+    sockets_.close();
+
+    if (handle_) {
+        // This will also reap the terminated process
+        handle_->terminate();
+    }
+}
+
 GroupHost::GroupHost(asio::io_context& io_context,
                      Logger& logger,
                      const Configuration& config,
@@ -168,8 +311,13 @@ GroupHost::GroupHost(asio::io_context& io_context,
                      const HostRequest& host_request)
     : HostProcess(io_context, sockets),
       plugin_info_(plugin_info),
+      // Plugin groups always go through the regular 64-bit group host
+      // process, which delegates 32-bit plugins to a companion 32-bit group
+      // host it manages itself. This way 32-bit plugins can join the same
+      // group as 64-bit ones without this side having to coordinate two
+      // separate group host processes.
       host_path_(find_plugin_host(plugin_info.native_library_path_,
-                                  plugin_info.plugin_arch_)) {
+                                  LibArchitecture::dll_64)) {
     // When using plugin groups, we'll first try to connect to an existing group
     // host process and ask it to host our plugin. If no such process exists,
     // then we'll start a new process. In the event that multiple yabridge
@@ -179,11 +327,27 @@ GroupHost::GroupHost(asio::io_context& io_context,
     // will try to connect to the socket once more in the case that another
     // process is now listening on it.
     const fs::path endpoint_base_dir = sockets.base_dir_;
+    // With the `group_shards` option a single declared group transparently
+    // splits into multiple host processes, where every shard is simply a
+    // group with a derived name. All the connection and spawning logic below
+    // works on the shard as if it were the configured group.
     const fs::path group_socket_path = generate_group_endpoint(
-        *config.group, plugin_info.normalize_wine_prefix(),
-        plugin_info.plugin_arch_);
-    const auto connect = [&io_context, host_request, endpoint_base_dir,
-                          group_socket_path]() {
+        shard_group_name(*config.group, config.group_shards,
+                         plugin_info.windows_plugin_path_),
+        plugin_info.normalize_wine_prefix(), LibArchitecture::dll_64);
+    // The group host process needs to know where to find
+    // `yabridge-host-32.exe` when it has to spawn a companion process for a
+    // 32-bit plugin. Resolving the path here means the group host doesn't
+    // need to know anything about this plugin's installation layout.
+    HostRequest group_host_request = host_request;
+    if (plugin_info.plugin_arch_ == LibArchitecture::dll_32) {
+        group_host_request.bitbridge_host_path =
+            find_plugin_host(plugin_info.native_library_path_,
+                             LibArchitecture::dll_32)
+                .string();
+    }
+    const auto connect = [&io_context, host_request = group_host_request,
+                          endpoint_base_dir, group_socket_path]() {
         asio::local::stream_protocol::socket group_socket(io_context);
         group_socket.connect(group_socket_path.string());
 
@@ -199,16 +363,30 @@ GroupHost::GroupHost(asio::io_context& io_context,
         // In case we could not connect to the socket, then we'll start a
         // new group host process. This process is detached immediately
         // because it should run independently of this yabridge instance as
-        // it will likely outlive it.
-        Process::Handle group_host =
-            launch_host(host_path_, {"group", group_socket_path.string()},
-                        logger, config, plugin_info);
+        // it will likely outlive it. With the `group_daemon` option the
+        // process also keeps running while it's not hosting any plugins, so
+        // Wine only needs to be booted once per session, and the
+        // `group_trusted` option disables the process watchdog in the group
+        // host.
+        std::vector<std::string> group_host_args{"group",
+                                                 group_socket_path.string()};
+        if (config.group_daemon) {
+            group_host_args.push_back("daemon");
+        }
+        if (config.group_trusted) {
+            group_host_args.push_back("trusted");
+        }
+
+        Process::Handle group_host = launch_host(
+            host_path_, group_host_args, logger, config, plugin_info);
         group_host.detach();
 
         group_host_connect_handler_ =
             std::jthread([this, connect, group_host = std::move(group_host)]() {
                 set_realtime_priority(true);
-                pthread_setname_np(pthread_self(), "group-connect");
+                const ThreadRegistry::Guard thread_guard =
+                    ThreadRegistry::instance().register_thread(
+                        "group-connect");
 
                 using namespace std::literals::chrono_literals;
 
@@ -257,3 +435,28 @@ void GroupHost::terminate() {
     // the sockets will cause the associated plugin to exit.
     sockets_.close();
 }
+
+std::unique_ptr<HostProcess> create_host_process(
+    asio::io_context& io_context,
+    Logger& logger,
+    const Configuration& config,
+    Sockets& sockets,
+    const PluginInfo& plugin_info,
+    const HostRequest& host_request) {
+    startup_trace_event("host-process-spawn-begin");
+
+    std::unique_ptr<HostProcess> host_process;
+    if (config.group) {
+        host_process = std::make_unique<GroupHost>(
+            io_context, logger, config, sockets, plugin_info, host_request);
+    } else if (config.warm_hosts > 0) {
+        host_process = std::make_unique<WarmPoolHost>(
+            io_context, logger, config, sockets, plugin_info, host_request);
+    } else {
+        host_process = std::make_unique<IndividualHost>(
+            io_context, logger, config, sockets, plugin_info, host_request);
+    }
+
+    startup_trace_event("host-process-spawn-end");
+    return host_process;
+}
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <thread>
 
 #include <asio/local/stream_protocol.hpp>
@@ -37,7 +39,14 @@
  */
 class HostProcess {
    public:
-    virtual ~HostProcess() noexcept = default;
+    /**
+     * Cancel the STDIO relaying for this process' pipes and wait for the
+     * pending completion handlers to be flushed. Those handlers run on the
+     * shared IO context and capture the pipes and buffers owned by this
+     * object, so they need to be fully unwound before those members get
+     * destroyed while the reactor keeps running for the other instances.
+     */
+    virtual ~HostProcess() noexcept;
 
     /**
      * Return the full path to the host application in use. The host application
@@ -89,7 +98,7 @@ class HostProcess {
      *   plugin's Wine prefix.
      */
     Process::Handle launch_host(const ghc::filesystem::path& host_path,
-                                std::initializer_list<std::string> args,
+                                const std::vector<std::string>& args,
                                 Logger& logger,
                                 const Configuration& config,
                                 const PluginInfo& plugin_info);
@@ -101,6 +110,13 @@ class HostProcess {
     Sockets& sockets_;
 
    private:
+    /**
+     * The IO context the pipes are bound to, shared between all instances.
+     * Used in the destructor to cancel the pipe operations from the reactor
+     * thread itself.
+     */
+    asio::io_context& io_context_;
+
     /**
      * The STDOUT stream of the Wine process we can forward to the logger.
      */
@@ -157,6 +173,72 @@ class IndividualHost : public HostProcess {
     Process::Handle handle_;
 };
 
+/**
+ * Host a plugin individually, but try to hand it to one of the pre-booted warm
+ * host processes from the `warm_hosts` option first. Those generic processes
+ * are spawned ahead of time and sit listening on well known per-prefix
+ * sockets, so claiming one skips the multi-second Wine process startup on the
+ * first plugin load. When no warm host is available (or the pool hasn't been
+ * filled yet), this behaves exactly like `IndividualHost` and spawns a fresh
+ * process. In both cases replacement warm hosts are spawned in the background
+ * afterwards to top the pool back up for the next plugin load.
+ */
+class WarmPoolHost : public HostProcess {
+   public:
+    /**
+     * Claim a warm host process and ask it to host the plugin, falling back to
+     * starting a fresh host process when the pool is empty.
+     *
+     * @param io_context The IO context that the STDIO redirection will be
+     *   handled on. Only used when falling back to spawning a fresh process,
+     *   since a claimed warm host keeps the output redirection it was spawned
+     *   with.
+     * @param logger The `Logger` instance the redirected STDIO streams will be
+     *   written to.
+     * @param config The configuration for this plugin instance. The pool size
+     *   will be retrieved from here.
+     * @param sockets The socket endpoints that will be used for communication
+     *   with the plugin. When the plugin shuts down, we'll close all of the
+     *   sockets used by the plugin.
+     * @param plugin_info Information about the plugin we're going to use. Used
+     *   to retrieve the Wine prefix and the plugin's architecture.
+     * @param host_request The information about the plugin we should launch a
+     *   host process for. This object will either be sent to the claimed warm
+     *   host process, or used as command line arguments for a fresh one.
+     *
+     * @throw std::runtime_error When `plugin_path` does not point to a valid
+     *   32-bit or 64-bit .dll file.
+     */
+    WarmPoolHost(asio::io_context& io_context,
+                 Logger& logger,
+                 const Configuration& config,
+                 Sockets& sockets,
+                 const PluginInfo& plugin_info,
+                 const HostRequest& host_request);
+
+    ghc::filesystem::path path() override;
+    bool running() override;
+    void terminate() override;
+
+   private:
+    const PluginInfo& plugin_info_;
+    ghc::filesystem::path host_path_;
+
+    /**
+     * The process ID of the warm host process we claimed, if we could claim
+     * one. A claimed process is not our child, so we can only check whether
+     * it's still alive and rely on it shutting down by itself after its plugin
+     * has exited.
+     */
+    std::optional<pid_t> claimed_pid_;
+
+    /**
+     * The handle for the host process we spawned ourselves when no warm host
+     * was available.
+     */
+    std::optional<Process::Handle> handle_;
+};
+
 /**
  * Either launch a new group host process, or connect to an existing one. This
  * will first try to connect to the plugin group's socket (determined based on
@@ -232,3 +314,20 @@ class GroupHost : public HostProcess {
      */
     std::jthread group_host_connect_handler_;
 };
+
+/**
+ * Create the appropriate `HostProcess` implementation for this plugin
+ * instance. Plugins that are part of a plugin group use `GroupHost`. For
+ * individually hosted plugins this uses `WarmPoolHost` when the `warm_hosts`
+ * option is set, and a plain `IndividualHost` otherwise.
+ *
+ * The parameters are identical to those of the `HostProcess` subclass
+ * constructors.
+ */
+std::unique_ptr<HostProcess> create_host_process(
+    asio::io_context& io_context,
+    Logger& logger,
+    const Configuration& config,
+    Sockets& sockets,
+    const PluginInfo& plugin_info,
+    const HostRequest& host_request);
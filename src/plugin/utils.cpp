@@ -16,8 +16,16 @@
 
 #include "utils.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 // Generated inside of the build directory
 #include <config.h>
@@ -27,8 +35,44 @@
 #include "../common/toml++.h"
 #include "../common/utils.h"
 
+using namespace std::literals::string_view_literals;
+
 namespace fs = ghc::filesystem;
 
+SharedIoContext::SharedIoContext()
+    : work_guard_(asio::make_work_guard(context_)),
+      has_realtime_priority_(has_realtime_priority_promise_.get_future()),
+      reactor_handler_([&]() {
+          // We don't keep the realtime priority because plugins that produce
+          // a lot of FIXMEs could in theory cause dropouts that way, but we
+          // still need to run this from a thread to check whether we support
+          // it
+          has_realtime_priority_promise_.set_value(set_realtime_priority(true));
+          set_realtime_priority(false);
+          const ThreadRegistry::Guard thread_guard =
+              ThreadRegistry::instance().register_thread("shared-io");
+
+          context_.run();
+      }) {}
+
+SharedIoContext::~SharedIoContext() noexcept {
+    work_guard_.reset();
+}
+
+std::shared_ptr<SharedIoContext> SharedIoContext::get_or_create() {
+    static std::mutex instance_mutex;
+    static std::weak_ptr<SharedIoContext> instance;
+
+    std::lock_guard lock(instance_mutex);
+    std::shared_ptr<SharedIoContext> shared_instance = instance.lock();
+    if (!shared_instance) {
+        shared_instance = std::make_shared<SharedIoContext>();
+        instance = shared_instance;
+    }
+
+    return shared_instance;
+}
+
 // These functions are used to populate the fields in `PluginInfo`. See the
 // docstrings for the corresponding fields for more information on what we're
 // actually doing here.
@@ -58,7 +102,14 @@ PluginInfo::PluginInfo(PluginType plugin_type,
       wine_prefix_(find_wine_prefix(windows_plugin_path_)) {}
 
 ProcessEnvironment PluginInfo::create_host_env() const {
-    ProcessEnvironment env(environ);
+    // Parsing the environment block into a `ProcessEnvironment` is repeated
+    // for every bridged instance, so all instances start from a frozen
+    // snapshot of the environment as it was when the first bridge got
+    // created. The host doesn't modify its own environment during normal
+    // operation, and the per-plugin modifications below are applied to a copy.
+    static const ProcessEnvironment base_env(environ);
+
+    ProcessEnvironment env(base_env);
 
     // Only set the prefix when could auto detect it and it's not being
     // overridden (this entire `std::visit` instead of `std::has_alternative` is
@@ -313,13 +364,52 @@ std::variant<OverridenWinePrefix, fs::path, DefaultWinePrefix> find_wine_prefix(
         return OverridenWinePrefix{prefix};
     }
 
+    // The search below walks up the directory hierarchy with a stat call per
+    // level. Since sessions tend to contain many plugins from the same
+    // directory, the detected prefix is cached per plugin directory so only
+    // the first instance pays for the walk. The entry is invalidated when the
+    // directory's modification time changes, for instance because the plugin
+    // directory got symlinked into another prefix.
+    static std::mutex wine_prefix_cache_mutex;
+    static std::unordered_map<
+        std::string,
+        std::pair<int64_t,
+                  std::variant<OverridenWinePrefix, fs::path,
+                               DefaultWinePrefix>>>
+        wine_prefix_cache;
+
+    const std::string plugin_dir = windows_plugin_path.parent_path().string();
+    std::error_code err;
+    const fs::file_time_type dir_mtime =
+        fs::last_write_time(plugin_dir, err);
+    const std::optional<int64_t> dir_mtime_ticks =
+        err ? std::nullopt
+            : std::optional<int64_t>(dir_mtime.time_since_epoch().count());
+
+    if (dir_mtime_ticks) {
+        std::lock_guard lock(wine_prefix_cache_mutex);
+        if (const auto it = wine_prefix_cache.find(plugin_dir);
+            it != wine_prefix_cache.end() &&
+            it->second.first == *dir_mtime_ticks) {
+            return it->second.second;
+        }
+    }
+
     const std::optional<fs::path> dosdevices_dir = find_dominating_file(
         "dosdevices", windows_plugin_path, fs::is_directory);
-    if (!dosdevices_dir) {
-        return DefaultWinePrefix{};
+    const std::variant<OverridenWinePrefix, fs::path, DefaultWinePrefix>
+        result = dosdevices_dir
+                     ? std::variant<OverridenWinePrefix, fs::path,
+                                    DefaultWinePrefix>(
+                           dosdevices_dir->parent_path())
+                     : DefaultWinePrefix{};
+
+    if (dir_mtime_ticks) {
+        std::lock_guard lock(wine_prefix_cache_mutex);
+        wine_prefix_cache[plugin_dir] = std::pair(*dir_mtime_ticks, result);
     }
 
-    return dosdevices_dir->parent_path();
+    return result;
 }
 
 bool equals_case_insensitive(const std::string& a, const std::string& b) {
@@ -398,13 +488,167 @@ ghc::filesystem::path generate_group_endpoint(
     return get_temporary_directory() / socket_name.str();
 }
 
+std::string shard_group_name(const std::string& group_name,
+                             uint32_t num_shards,
+                             const ghc::filesystem::path& plugin_path) {
+    if (num_shards <= 1) {
+        return group_name;
+    }
+
+    // Hashing the plugin path keeps the assignment deterministic, so all
+    // instances of the same plugin end up in the same shard regardless of
+    // which yabridge instance spawned the shard's host process first
+    const size_t shard =
+        std::hash<std::string>{}(plugin_path.string()) % num_shards;
+
+    return group_name + "-shard" + std::to_string(shard + 1);
+}
+
+ghc::filesystem::path generate_warm_host_endpoint(
+    const ghc::filesystem::path& wine_prefix,
+    const LibArchitecture architecture,
+    const size_t index) {
+    std::ostringstream socket_name;
+    socket_name << "yabridge-warm-" << index << "-"
+                << std::to_string(
+                       std::hash<std::string>{}(wine_prefix.string()))
+                << "-";
+    switch (architecture) {
+        case LibArchitecture::dll_32:
+            socket_name << "x32";
+            break;
+        case LibArchitecture::dll_64:
+            socket_name << "x64";
+            break;
+    }
+    socket_name << ".sock";
+
+    return get_temporary_directory() / socket_name.str();
+}
+
+std::optional<fs::path> get_metadata_cache_path(const fs::path& plugin_path,
+                                                const std::string& kind) {
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    if (const char* no_cache_env = getenv("YABRIDGE_NO_CACHE");
+        no_cache_env && no_cache_env == "1"sv) {
+        return std::nullopt;
+    }
+
+    fs::path cache_dir;
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    if (const char* xdg_cache_home = getenv("XDG_CACHE_HOME");
+        xdg_cache_home && xdg_cache_home[0] != '\0') {
+        cache_dir = xdg_cache_home;
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    } else if (const char* home = getenv("HOME"); home && home[0] != '\0') {
+        cache_dir = fs::path(home) / ".cache";
+    } else {
+        return std::nullopt;
+    }
+
+    // The hash makes sure that equally named plugin files in different
+    // directories don't share a cache entry
+    std::ostringstream file_name;
+    file_name << plugin_path.stem().string() << "-"
+              << std::to_string(std::hash<std::string>{}(plugin_path.string()))
+              << "-" << kind << ".bin";
+
+    return cache_dir / "yabridge" / "metadata" / file_name.str();
+}
+
+std::optional<MappedCacheFile> MappedCacheFile::open(
+    const fs::path& path) noexcept {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return std::nullopt;
+    }
+
+    struct stat file_info {};
+    if (fstat(fd, &file_info) == -1 ||
+        static_cast<size_t>(file_info.st_size) <
+            sizeof(MetadataCacheFileHeader)) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    const size_t size = static_cast<size_t>(file_info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the inode alive, so the descriptor isn't needed
+    // anymore after this point. Writers replacing the file with a rename
+    // don't affect existing mappings either.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return std::nullopt;
+    }
+
+    MappedCacheFile mapped(static_cast<const uint8_t*>(mapping), size);
+
+    MetadataCacheFileHeader header{};
+    std::memcpy(&header, mapped.bytes_, sizeof(header));
+    if (header.magic != metadata_cache_magic ||
+        header.format_version != metadata_cache_format_version) {
+        return std::nullopt;
+    }
+
+    return mapped;
+}
+
+MappedCacheFile::MappedCacheFile(const uint8_t* bytes, size_t size) noexcept
+    : bytes_(bytes), size_(size) {}
+
+MappedCacheFile::~MappedCacheFile() noexcept {
+    if (bytes_) {
+        munmap(const_cast<uint8_t*>(bytes_), size_);
+    }
+}
+
+MappedCacheFile::MappedCacheFile(MappedCacheFile&& o) noexcept
+    : bytes_(o.bytes_), size_(o.size_) {
+    o.bytes_ = nullptr;
+    o.size_ = 0;
+}
+
+MappedCacheFile& MappedCacheFile::operator=(MappedCacheFile&& o) noexcept {
+    if (bytes_) {
+        munmap(const_cast<uint8_t*>(bytes_), size_);
+    }
+    bytes_ = o.bytes_;
+    size_ = o.size_;
+    o.bytes_ = nullptr;
+    o.size_ = 0;
+
+    return *this;
+}
+
+std::span<const uint8_t> MappedCacheFile::payload() const noexcept {
+    return std::span<const uint8_t>(bytes_ + sizeof(MetadataCacheFileHeader),
+                                    size_ - sizeof(MetadataCacheFileHeader));
+}
+
+std::optional<int64_t> get_plugin_last_write_time(
+    const fs::path& plugin_path) noexcept {
+    std::error_code err;
+    const fs::file_time_type last_write_time =
+        fs::last_write_time(plugin_path, err);
+    if (err) {
+        return std::nullopt;
+    }
+
+    return last_write_time.time_since_epoch().count();
+}
+
 Configuration load_config_for(const fs::path& yabridge_path) {
     // First find the closest `yabridge.tmol` file for the plugin, falling back
     // to default configuration settings if it doesn't exist
     const std::optional<fs::path> config_file =
         find_dominating_file("yabridge.toml", yabridge_path);
     if (!config_file) {
-        return Configuration();
+        // The host's adaptation profile still applies without a
+        // configuration file, the file is only needed to override or disable
+        // it
+        Configuration config{};
+        config.apply_host_profile();
+        return config;
     }
 
     try {
@@ -428,6 +672,8 @@ Configuration load_config_for(const fs::path& yabridge_path) {
                 "' could not be parsed: " + std::string(error.description()),
             std::nullopt);
 
-        return Configuration();
+        Configuration config{};
+        config.apply_host_profile();
+        return config;
     }
 }
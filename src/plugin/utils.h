@@ -16,14 +16,105 @@
 
 #pragma once
 
+#include <unistd.h>
+
+#include <array>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
 #include <variant>
 
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <bitsery/adapter/buffer.h>
+#include <bitsery/bitsery.h>
+#include <bitsery/traits/string.h>
+#include <bitsery/traits/vector.h>
+
+#include "../common/bitsery/traits/span.h"
+
+// Generated inside of the build directory
+#include <version.h>
+
 #include "../common/configuration.h"
 #include "../common/logging/common.h"
 #include "../common/plugins.h"
 #include "../common/process.h"
 #include "../common/utils.h"
 
+/**
+ * An Asio IO context with a reactor thread that's shared between all bridged
+ * plugin instances within this process. This services the asynchronous
+ * operations on the plugin side: relaying the Wine process' STDOUT and STDERR
+ * streams to the logger, and the occasional bit of deferred cleanup work
+ * posted by the socket handlers. None of those involve any blocking work, so
+ * there's no reason for every instance to run its own mostly-idle reactor
+ * thread. A session with a hundred or more bridged instances would otherwise
+ * spend a hundred or more threads doing next to nothing.
+ *
+ * Instances obtain a reference counted handle through `get_or_create()`. The
+ * reactor thread is started when the first instance comes up and joined again
+ * when the last instance drops its handle.
+ */
+class SharedIoContext {
+   public:
+    /**
+     * Start the reactor thread. Use `get_or_create()` instead of constructing
+     * this directly.
+     */
+    SharedIoContext();
+
+    /**
+     * Drop the work guard and wait for the reactor thread to finish. By the
+     * time the last handle gets dropped all instances will have already
+     * cancelled their outstanding pipe operations, so this doesn't block on
+     * anything.
+     */
+    ~SharedIoContext() noexcept;
+
+    SharedIoContext(const SharedIoContext&) = delete;
+    SharedIoContext& operator=(const SharedIoContext&) = delete;
+
+    /**
+     * Retrieve the process wide IO context, creating it if this is the first
+     * live instance.
+     */
+    static std::shared_ptr<SharedIoContext> get_or_create();
+
+    /**
+     * Whether this process supports realtime scheduling. This is checked once
+     * from the reactor thread when it starts, since we shouldn't change the
+     * scheduler properties on the thread that's initializing the plugin as
+     * some DAWs do that from their UI thread.
+     */
+    bool has_realtime_priority() { return has_realtime_priority_.get(); }
+
+    /**
+     * The underlying IO context. The STDIO redirection pipes and the sockets
+     * are bound to this.
+     */
+    asio::io_context context_;
+
+   private:
+    /**
+     * Keeps `context_.run()` from returning while there are no pending
+     * operations, since instances come and go.
+     */
+    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
+
+    std::promise<bool> has_realtime_priority_promise_;
+    std::shared_future<bool> has_realtime_priority_;
+
+    /**
+     * The thread that runs `context_`. Joined when the last instance drops
+     * its handle to this object.
+     */
+    std::jthread reactor_handler_;
+};
+
 /**
  * Marker struct for when we use the default Wine prefix.
  */
@@ -83,6 +174,10 @@ struct PluginInfo {
      *
      * This also unsets `WAYLAND_DISPLAY` so if Wine has been compiled with
      * Wayland support, it won't suddenly start using that over X11.
+     *
+     * The environment is based on a frozen snapshot of the host's environment
+     * taken when the first bridged instance gets created, so later changes the
+     * host makes to its own environment are not picked up.
      */
     ProcessEnvironment create_host_env() const;
 
@@ -232,6 +327,46 @@ ghc::filesystem::path generate_group_endpoint(
     const ghc::filesystem::path& wine_prefix,
     const LibArchitecture architecture);
 
+/**
+ * The effective group name for a plugin after applying the `group_shards`
+ * option. With sharding enabled a declared group is transparently split
+ * across multiple host processes, each shard being an ordinary group named
+ * `<group_name>-shard<n>`. The shard is picked by hashing the plugin's file
+ * path, so all instances of the same plugin always end up in the same host
+ * process and plugin internal inter-instance communication keeps working.
+ *
+ * @param group_name The name of the plugin group as configured.
+ * @param num_shards The value of the `group_shards` option. Values below two
+ *   leave the group name untouched.
+ * @param plugin_path The path to the Windows plugin this instance will load.
+ *
+ * @return Either `group_name` itself, or the name of this plugin's shard.
+ */
+std::string shard_group_name(const std::string& group_name,
+                             uint32_t num_shards,
+                             const ghc::filesystem::path& plugin_path);
+
+/**
+ * Generate the socket endpoint path for one of the pre-booted warm host
+ * processes used by the `warm_hosts` option. These are named similarly to the
+ * group sockets, in the form
+ * `/run/user/<uid>/yabridge-warm-<index>-<wine_prefix_id>-<architecture>.sock`,
+ * so every Wine prefix and architecture gets its own pool.
+ *
+ * @param wine_prefix The name of the Wine prefix in use. This should be
+ *   obtained from `PluginInfo::normalize_wine_prefix()`.
+ * @param architecture The architecture the plugin is using, since 64-bit
+ *   processes can't host 32-bit plugins and the other way around.
+ * @param index The pool slot, in `[0, warm_hosts)`.
+ *
+ * @return A socket endpoint path that corresponds to the format described
+ *   above.
+ */
+ghc::filesystem::path generate_warm_host_endpoint(
+    const ghc::filesystem::path& wine_prefix,
+    const LibArchitecture architecture,
+    const size_t index);
+
 /**
  * Load the configuration that belongs to a copy of or symlink to
  * `libyabridge-{clap,vst2,vst3}.so`. If no configuration file could be found
@@ -258,6 +393,249 @@ ghc::filesystem::path generate_group_endpoint(
  */
 Configuration load_config_for(const ghc::filesystem::path& yabridge_path);
 
+// The plugin metadata cache used by `load_cached_metadata()` and
+// `store_cached_metadata()` uses its own bitsery adapter configuration. Unlike
+// with the sockets, where both ends are always the same yabridge version, here
+// we're reading files written by arbitrary older versions of ourselves, so the
+// safety checks stay enabled to make sure a truncated or corrupted cache file
+// results in a failed deserialization instead of garbage data.
+namespace bitsery {
+struct MetadataCacheConfig {
+    static constexpr EndiannessType Endianness = EndiannessType::LittleEndian;
+    static constexpr bool CheckDataErrors = true;
+    static constexpr bool CheckAdapterErrors = true;
+};
+}  // namespace bitsery
+
+using MetadataCacheOutputAdapter =
+    bitsery::OutputBufferAdapter<std::vector<uint8_t>,
+                                 bitsery::MetadataCacheConfig>;
+using MetadataCacheInputAdapter =
+    bitsery::InputBufferAdapter<std::span<const uint8_t>,
+                                bitsery::MetadataCacheConfig>;
+
+/**
+ * The magic bytes every metadata cache file starts with, followed by
+ * `metadata_cache_format_version`. Entries written with a different format
+ * version (or files that aren't cache files at all) fail this check and get
+ * treated as stale, so the on-disk layout can change between yabridge
+ * versions without old files ever being deserialized as garbage.
+ */
+constexpr std::array<char, 8> metadata_cache_magic{'Y', 'B', 'R', 'C',
+                                                   'A', 'C', 'H', 'E'};
+constexpr uint32_t metadata_cache_format_version = 1;
+
+/**
+ * The fixed size header at the start of every metadata cache file. The
+ * bitsery serialized payload follows directly after it.
+ */
+struct MetadataCacheFileHeader {
+    std::array<char, 8> magic;
+    uint32_t format_version;
+};
+
+/**
+ * A read-only memory mapping of a metadata cache file. Reading the cache
+ * through a shared mapping instead of `read()` means that when a session
+ * loads a hundred plus instances of the same plugins, every process maps the
+ * same pages and the kernel keeps only one physical copy of the cached data
+ * around. Readers don't need any locking either: writers replace cache files
+ * atomically with a rename, which leaves existing mappings pointing at the
+ * old inode.
+ */
+class MappedCacheFile {
+   public:
+    /**
+     * Map the cache file at `path` and validate its header. Returns a nullopt
+     * when the file doesn't exist, can't be mapped, or doesn't carry the
+     * current format version.
+     */
+    static std::optional<MappedCacheFile> open(
+        const ghc::filesystem::path& path) noexcept;
+
+    ~MappedCacheFile() noexcept;
+
+    MappedCacheFile(const MappedCacheFile&) = delete;
+    MappedCacheFile& operator=(const MappedCacheFile&) = delete;
+
+    MappedCacheFile(MappedCacheFile&&) noexcept;
+    MappedCacheFile& operator=(MappedCacheFile&&) noexcept;
+
+    /**
+     * The serialized payload stored after the file header.
+     */
+    std::span<const uint8_t> payload() const noexcept;
+
+   private:
+    MappedCacheFile(const uint8_t* bytes, size_t size) noexcept;
+
+    const uint8_t* bytes_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * The on-disk representation of a cached piece of plugin metadata. Next to the
+ * metadata object itself this stores the yabridge version that wrote the entry
+ * and the plugin's last write time at that moment, so stale entries can be
+ * detected when loading the cache again.
+ */
+template <typename T>
+struct CachedMetadata {
+    std::string yabridge_version;
+    int64_t last_write_time = 0;
+    T metadata{};
+
+    template <typename S>
+    void serialize(S& s) {
+        s.text1b(yabridge_version, 64);
+        s.value8b(last_write_time);
+        s.object(metadata);
+    }
+};
+
+/**
+ * The path the metadata cache entry of kind `kind` for the plugin at
+ * `plugin_path` is stored at. This will be a file in
+ * `$XDG_CACHE_HOME/yabridge/metadata/`, named after the plugin and a hash of
+ * its full path. Returns a nullopt if the cache directory could not be
+ * determined, or if the cache has been disabled through the
+ * `YABRIDGE_NO_CACHE` environment variable.
+ */
+std::optional<ghc::filesystem::path> get_metadata_cache_path(
+    const ghc::filesystem::path& plugin_path,
+    const std::string& kind);
+
+/**
+ * The plugin file's last write time in filesystem clock ticks, or a nullopt if
+ * the file could not be queried. Used to invalidate metadata cache entries
+ * when the plugin gets updated.
+ */
+std::optional<int64_t> get_plugin_last_write_time(
+    const ghc::filesystem::path& plugin_path) noexcept;
+
+/**
+ * Try to load a metadata cache entry previously written with
+ * `store_cached_metadata()`. This is used to skip expensive Wine-side plugin
+ * probing queries for static metadata like the VST3 and CLAP plugin
+ * factories' contents. Entries are invalidated when the plugin's last write
+ * time changes or when yabridge itself gets updated, so a stale cache can
+ * never mask a plugin update. This is a best effort operation, and a nullopt
+ * gets returned whenever there's no valid entry for whatever reason, in which
+ * case the caller should query the Wine plugin host as usual and store the
+ * result.
+ *
+ * @param plugin_path The path to the Windows plugin the metadata belongs to.
+ * @param kind A short identifier for the kind of metadata stored in the entry,
+ *   e.g. `vst3-factory`. This becomes part of the cache file's name.
+ *
+ * @tparam T The serializable object stored in the cache entry. This must match
+ *   the type passed to `store_cached_metadata()` for the same `kind`.
+ */
+template <typename T>
+std::optional<T> load_cached_metadata(
+    const ghc::filesystem::path& plugin_path,
+    const std::string& kind) noexcept {
+    try {
+        const std::optional<ghc::filesystem::path> cache_path =
+            get_metadata_cache_path(plugin_path, kind);
+        const std::optional<int64_t> last_write_time =
+            get_plugin_last_write_time(plugin_path);
+        if (!cache_path || !last_write_time) {
+            return std::nullopt;
+        }
+
+        const std::optional<MappedCacheFile> mapped =
+            MappedCacheFile::open(*cache_path);
+        if (!mapped) {
+            return std::nullopt;
+        }
+
+        // The entry gets deserialized straight out of the shared mapping, so
+        // loading the cache never copies the file to an owned buffer first
+        const std::span<const uint8_t> payload = mapped->payload();
+        CachedMetadata<T> cached{};
+        const auto [_, success] =
+            bitsery::quickDeserialization<MetadataCacheInputAdapter>(
+                {payload.begin(), payload.size()}, cached);
+        if (!success || cached.yabridge_version != yabridge_git_version ||
+            cached.last_write_time != *last_write_time) {
+            return std::nullopt;
+        }
+
+        return std::move(cached.metadata);
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+/**
+ * Store a metadata cache entry for the plugin at `plugin_path` so subsequent
+ * `load_cached_metadata()` calls for the same plugin, yabridge version, and
+ * plugin modification time can use it. The entry is written to a temporary
+ * file first and then moved in place, so concurrently starting plugin
+ * instances can never read a half written cache file. Like the load function
+ * this is best effort, and failures are silently ignored since the cache is
+ * purely an optimization.
+ *
+ * @see load_cached_metadata
+ */
+template <typename T>
+void store_cached_metadata(const ghc::filesystem::path& plugin_path,
+                           const std::string& kind,
+                           const T& metadata) noexcept {
+    try {
+        const std::optional<ghc::filesystem::path> cache_path =
+            get_metadata_cache_path(plugin_path, kind);
+        const std::optional<int64_t> last_write_time =
+            get_plugin_last_write_time(plugin_path);
+        if (!cache_path || !last_write_time) {
+            return;
+        }
+
+        const CachedMetadata<T> cached{.yabridge_version = yabridge_git_version,
+                                       .last_write_time = *last_write_time,
+                                       .metadata = metadata};
+
+        std::vector<uint8_t> buffer{};
+        const size_t size =
+            bitsery::quickSerialization<MetadataCacheOutputAdapter>(buffer,
+                                                                    cached);
+
+        std::error_code err;
+        ghc::filesystem::create_directories(cache_path->parent_path(), err);
+        if (err) {
+            return;
+        }
+
+        // Writes from multiple processes (e.g. when a session loads many
+        // instances of an uncached plugin at once) don't need any
+        // coordination this way, the last rename simply wins
+        const ghc::filesystem::path temp_path =
+            cache_path->string() + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream file(temp_path.string(), std::ofstream::binary |
+                                                       std::ofstream::trunc);
+
+            const MetadataCacheFileHeader header{
+                .magic = metadata_cache_magic,
+                .format_version = metadata_cache_format_version};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(buffer.data()),
+                       static_cast<std::streamsize>(size));
+            if (!file) {
+                ghc::filesystem::remove(temp_path, err);
+                return;
+            }
+        }
+
+        ghc::filesystem::rename(temp_path, *cache_path, err);
+        if (err) {
+            ghc::filesystem::remove(temp_path, err);
+        }
+    } catch (...) {
+    }
+}
+
 /**
  * Starting from the starting file or directory, go up in the directory
  * hierarchy until we find a file named `filename`.
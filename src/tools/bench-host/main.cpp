@@ -0,0 +1,342 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <vestige/aeffectx.h>
+
+#include "../bench-plugin/dsp.h"
+
+extern char** environ;
+
+// An end-to-end integration benchmark for the full yabridge stack. Where
+// `yabridge-bench` measures the IPC layer in isolation, this tool loads an
+// actual VST2 plugin library as a host would and measures the wall clock
+// time of real `processReplacing()` calls across a range of block sizes.
+// When pointed at a bridged copy of the reference benchmark plugin from
+// `src/tools/bench-plugin/`, it also runs the plugin's deterministic DSP
+// kernel natively in-process and reports the difference as yabridge's
+// end-to-end overhead: chainloader, plugin bridge, socket or shared memory
+// transport, Wine host, and back. That number is the canonical one to track
+// for transport and serialization changes.
+//
+// Setting up the bridged reference plugin works like bridging any other VST2
+// plugin by hand:
+//
+//     ln -s $PWD/build/yabridge-bench-plugin.dll /tmp/bench/bench.dll
+//     ln -s $PWD/build/libyabridge-chainloader-vst2.so /tmp/bench/bench.so
+//     yabridge-bench-host /tmp/bench/bench.so
+//
+// Transport and serialization options are runtime (or `meson configure`)
+// switches, so comparing transports is a matter of running this tool once
+// per configuration. The relevant `YABRIDGE_*` environment variables are
+// echoed into the JSON output to keep the results self-describing.
+//
+// This host only speaks VST2. The wire format and transports under test are
+// shared between all three plugin APIs, so VST2 numbers cover the transport
+// changes this tool exists for; hosting VST3 or CLAP would additionally drag
+// the plugin SDKs into this tool for little extra signal.
+
+namespace {
+
+using Vst2EntryPoint = AEffect*(VST_CALL_CONV*)(audioMasterCallback);
+
+/**
+ * The sample rate every measurement runs at. The actual value barely matters
+ * for the overhead numbers, but it has to be set for the plugin to process
+ * at all.
+ */
+constexpr double sample_rate = 48000.0;
+
+double current_block_size = 512.0;
+
+/**
+ * The host callback handed to the plugin. The bridged plugin only needs the
+ * basics during setup, and nothing here is called during the measured
+ * processing loop.
+ */
+intptr_t VST_CALL_CONV
+host_callback(AEffect*, int opcode, int, intptr_t, void* data, float) {
+    switch (opcode) {
+        case audioMasterVersion:
+            return 2400;
+        case audioMasterGetSampleRate:
+            return static_cast<intptr_t>(sample_rate);
+        case audioMasterGetBlockSize:
+            return static_cast<intptr_t>(current_block_size);
+        case audioMasterGetVendorString:
+        case audioMasterGetProductString:
+            if (data) {
+                strncpy(static_cast<char*>(data), "yabridge-bench-host", 31);
+                static_cast<char*>(data)[31] = 0;
+            }
+            return 1;
+        case audioMasterGetVendorVersion:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+struct BenchResult {
+    size_t block_size;
+    size_t num_blocks;
+    double mean_total_us;
+    double mean_dsp_us;
+    double p99_total_us;
+};
+
+/**
+ * Measure the mean wall clock time of `num_blocks` processing calls at the
+ * given block size. The input is a quiet but nonzero ramp so neither side
+ * can take a silence shortcut.
+ */
+BenchResult measure_block_size(AEffect* plugin,
+                               size_t block_size,
+                               size_t num_blocks,
+                               size_t warmup) {
+    std::vector<float> input_samples(block_size * 2);
+    std::vector<float> output_samples(block_size * 2);
+    for (size_t i = 0; i < input_samples.size(); i++) {
+        input_samples[i] = static_cast<float>(i % 512) * 1.0e-4f;
+    }
+    std::array<float*, 2> inputs{input_samples.data(),
+                                 input_samples.data() + block_size};
+    std::array<float*, 2> outputs{output_samples.data(),
+                                  output_samples.data() + block_size};
+
+    current_block_size = static_cast<double>(block_size);
+    plugin->dispatcher(plugin, effSetBlockSize, 0,
+                       static_cast<intptr_t>(block_size), nullptr, 0.0f);
+    plugin->dispatcher(plugin, effMainsChanged, 0, 1, nullptr, 0.0f);
+    plugin->dispatcher(plugin, effStartProcess, 0, 0, nullptr, 0.0f);
+
+    for (size_t i = 0; i < warmup; i++) {
+        plugin->processReplacing(plugin, inputs.data(), outputs.data(),
+                                 static_cast<int>(block_size));
+    }
+
+    std::vector<double> timings_us(num_blocks);
+    for (size_t i = 0; i < num_blocks; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        plugin->processReplacing(plugin, inputs.data(), outputs.data(),
+                                 static_cast<int>(block_size));
+        timings_us[i] = std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    }
+
+    plugin->dispatcher(plugin, effStopProcess, 0, 0, nullptr, 0.0f);
+    plugin->dispatcher(plugin, effMainsChanged, 0, 0, nullptr, 0.0f);
+
+    std::sort(timings_us.begin(), timings_us.end());
+    double sum = 0.0;
+    for (const double timing : timings_us) {
+        sum += timing;
+    }
+
+    return BenchResult{
+        .block_size = block_size,
+        .num_blocks = num_blocks,
+        .mean_total_us = sum / static_cast<double>(num_blocks),
+        .mean_dsp_us = 0.0,
+        .p99_total_us = timings_us[((num_blocks - 1) * 99) / 100],
+    };
+}
+
+/**
+ * Measure the native baseline cost of the reference plugin's DSP kernel for
+ * a single stereo block, using the exact same code the plugin runs inside
+ * Wine. This is what gets subtracted from the measured totals to arrive at
+ * the bridging overhead.
+ */
+double measure_native_dsp_us(size_t block_size,
+                             size_t num_blocks,
+                             int iterations) {
+    std::vector<float> samples(block_size);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = static_cast<float>(i % 512) * 1.0e-4f;
+    }
+
+    std::array<float, 2> state{0.0f, 0.0f};
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_blocks; i++) {
+        for (float& channel_state : state) {
+            bench_dsp::process_channel(samples.data(), samples.data(),
+                                       static_cast<int>(block_size),
+                                       iterations, channel_state);
+        }
+    }
+    const double total_us = std::chrono::duration<double, std::micro>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+    return total_us / static_cast<double>(num_blocks);
+}
+
+/**
+ * Escape a string for inclusion in the JSON output. The environment
+ * variables echoed into the results are the only values that can contain
+ * arbitrary characters.
+ */
+std::string json_escape(const std::string& string) {
+    std::string escaped{};
+    escaped.reserve(string.size());
+    for (const char character : string) {
+        if (character == '"' || character == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(character);
+    }
+    return escaped;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string plugin_path{};
+    size_t num_blocks = 2000;
+    bool reference_dsp = true;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--blocks" && i + 1 < argc) {
+            num_blocks =
+                static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+            if (num_blocks == 0) {
+                std::cerr << "'--blocks' requires a positive number"
+                          << std::endl;
+                return 1;
+            }
+        } else if (arg == "--no-reference-dsp") {
+            // For benchmarking arbitrary third party plugins, where there's
+            // no known DSP cost to subtract
+            reference_dsp = false;
+        } else if (plugin_path.empty() && !arg.starts_with("--")) {
+            plugin_path = arg;
+        } else {
+            std::cerr << "Usage: yabridge-bench-host <plugin.so> "
+                         "[--blocks <n>] [--no-reference-dsp]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (plugin_path.empty()) {
+        std::cerr << "Usage: yabridge-bench-host <plugin.so> "
+                     "[--blocks <n>] [--no-reference-dsp]"
+                  << std::endl;
+        return 1;
+    }
+
+    void* library = dlopen(plugin_path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+    if (!library) {
+        std::cerr << "Could not load '" << plugin_path << "': " << dlerror()
+                  << std::endl;
+        return 1;
+    }
+
+    Vst2EntryPoint entry_point = reinterpret_cast<Vst2EntryPoint>(
+        dlsym(library, "VSTPluginMain"));
+    if (!entry_point) {
+        entry_point =
+            reinterpret_cast<Vst2EntryPoint>(dlsym(library, "main"));
+    }
+    if (!entry_point) {
+        std::cerr << "'" << plugin_path
+                  << "' does not export a VST2 entry point" << std::endl;
+        return 1;
+    }
+
+    AEffect* plugin = entry_point(host_callback);
+    if (!plugin || plugin->magic != kEffectMagic) {
+        std::cerr << "'" << plugin_path
+                  << "' did not return a valid plugin instance" << std::endl;
+        return 1;
+    }
+    if (!(plugin->flags & effFlagsCanReplacing) || !plugin->processReplacing) {
+        std::cerr << "'" << plugin_path
+                  << "' does not support replacing processing" << std::endl;
+        return 1;
+    }
+
+    plugin->dispatcher(plugin, effOpen, 0, 0, nullptr, 0.0f);
+    plugin->dispatcher(plugin, effSetSampleRate, 0, 0, nullptr,
+                       static_cast<float>(sample_rate));
+
+    // The reference plugin's default 'Load' setting matches this iteration
+    // count, see `src/tools/bench-plugin/main.cpp`
+    const int dsp_iterations = bench_dsp::default_iterations_per_sample;
+
+    constexpr std::array<size_t, 7> block_sizes{32,  64,   128, 256,
+                                                512, 1024, 2048};
+    const size_t warmup = std::max<size_t>(num_blocks / 10, 1);
+
+    std::vector<BenchResult> results{};
+    for (const size_t block_size : block_sizes) {
+        std::cerr << "measuring: " << block_size << " samples" << std::endl;
+        BenchResult result =
+            measure_block_size(plugin, block_size, num_blocks, warmup);
+        if (reference_dsp) {
+            result.mean_dsp_us =
+                measure_native_dsp_us(block_size, num_blocks, dsp_iterations);
+        }
+        results.push_back(result);
+    }
+
+    plugin->dispatcher(plugin, effClose, 0, 0, nullptr, 0.0f);
+
+    std::cout << "{\n  \"api\": \"vst2\",\n  \"plugin\": \""
+              << json_escape(plugin_path) << "\",\n  \"env\": {";
+    bool first_variable = true;
+    for (char** variable = environ; *variable; variable++) {
+        const std::string assignment = *variable;
+        if (!assignment.starts_with("YABRIDGE_")) {
+            continue;
+        }
+        const size_t separator = assignment.find('=');
+        std::cout << (first_variable ? "" : ", ") << "\""
+                  << json_escape(assignment.substr(0, separator)) << "\": \""
+                  << json_escape(assignment.substr(separator + 1)) << "\"";
+        first_variable = false;
+    }
+    std::cout << "},\n  \"blocks\": [" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        std::cout << "    {\"block_size\": " << result.block_size
+                  << ", \"num_blocks\": " << result.num_blocks
+                  << ", \"mean_total_us\": " << result.mean_total_us
+                  << ", \"mean_dsp_us\": " << result.mean_dsp_us
+                  << ", \"mean_overhead_us\": "
+                  << result.mean_total_us - result.mean_dsp_us
+                  << ", \"p99_total_us\": " << result.p99_total_us << "}"
+                  << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    std::cout << "  ]\n}" << std::endl;
+
+    return 0;
+}
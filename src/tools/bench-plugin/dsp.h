@@ -0,0 +1,69 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+// The deterministic DSP kernel shared between the reference benchmark plugin
+// in this directory and the native benchmark host in
+// `src/tools/bench-host/`. The plugin runs this kernel inside Wine, and the
+// host runs the exact same code natively to establish the baseline DSP cost
+// it subtracts from the measured end-to-end processing time. Keeping both
+// sides on one kernel is what makes 'total minus DSP' a meaningful overhead
+// number: the code and the machine are identical, only the bridging in
+// between differs.
+
+namespace bench_dsp {
+
+/**
+ * The number of dependent multiply-add rounds the kernel runs per sample at
+ * the benchmark plugin's default parameter setting. A hundred serial FLOPs
+ * per sample is in the ballpark of a modest real effect, so the overhead
+ * numbers aren't measured against an unrealistically empty plugin.
+ */
+constexpr int default_iterations_per_sample = 100;
+
+/**
+ * Process a single sample. Every round depends on the previous one, so the
+ * compiler can neither vectorize nor hoist any of this and the cost stays
+ * strictly proportional to the iteration count. The added constant keeps the
+ * recurrence away from denormal range so FTZ settings can't skew the
+ * comparison between the native and the Wine side.
+ */
+inline float process_sample(float input, float& state, int iterations) {
+    float x = state + input;
+    for (int i = 0; i < iterations; i++) {
+        x = x * 0.999877929f + 1.0e-6f;
+    }
+    state = x;
+    return x;
+}
+
+/**
+ * Process a single channel's buffer in place or out of place. `state` is the
+ * channel's filter state and has to persist between blocks for the cost to
+ * match between the two sides.
+ */
+inline void process_channel(const float* input,
+                            float* output,
+                            int num_samples,
+                            int iterations,
+                            float& state) {
+    for (int sample = 0; sample < num_samples; sample++) {
+        output[sample] = process_sample(input[sample], state, iterations);
+    }
+}
+
+}  // namespace bench_dsp
@@ -0,0 +1,184 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstring>
+
+#include <vestige/aeffectx.h>
+
+#include "dsp.h"
+
+// A tiny reference VST2 plugin with a known, deterministic DSP cost, built as
+// a Winelib module with the same cross compilation setup as the host
+// applications. Together with `yabridge-bench-host` this measures yabridge's
+// end-to-end overhead through the full stack: the host loads this plugin
+// through a copy of `libyabridge-vst2.so` (or the chainloader), yabridge
+// spawns a Wine host process, and the measured per-block processing time
+// minus the natively measured cost of the same DSP kernel is the bridging
+// overhead. See `src/tools/bench-host/main.cpp` for the measurement
+// methodology and for how to set the plugin up.
+//
+// The plugin is a stereo effect with a single 'Load' parameter that scales
+// the number of serial multiply-adds the kernel in `dsp.h` runs per sample,
+// so DSP-load-dependent behaviour (like the elastic worker scaling in group
+// hosts) can also be exercised with multiple instances at different
+// settings.
+
+namespace {
+
+/**
+ * The number of kernel iterations per sample at the maximum 'Load' parameter
+ * setting. The parameter's default of 0.25 corresponds to
+ * `bench_dsp::default_iterations_per_sample`.
+ */
+constexpr int max_iterations_per_sample =
+    bench_dsp::default_iterations_per_sample * 4;
+
+struct BenchPlugin {
+    AEffect aeffect;
+
+    /**
+     * The 'Load' parameter. The per-sample iteration count is this value
+     * times `max_iterations_per_sample`, truncated.
+     */
+    float load = 0.25f;
+    /**
+     * Per-channel filter state, persisted between blocks so the kernel's
+     * cost matches the native baseline measured by the benchmark host.
+     */
+    float state[2] = {0.0f, 0.0f};
+};
+
+BenchPlugin& get_plugin(AEffect* effect) {
+    return *static_cast<BenchPlugin*>(effect->ptr3);
+}
+
+int current_iterations(const BenchPlugin& plugin) {
+    return static_cast<int>(plugin.load * max_iterations_per_sample);
+}
+
+/**
+ * Copy a string into one of the host's fixed size name buffers. The VST2
+ * buffers involved here are all at least 32 bytes large.
+ */
+void copy_string(void* buffer, const char* string) {
+    if (buffer) {
+        strncpy(static_cast<char*>(buffer), string, 31);
+        static_cast<char*>(buffer)[31] = 0;
+    }
+}
+
+intptr_t VST_CALL_CONV dispatch(AEffect* effect,
+                                int opcode,
+                                int /*index*/,
+                                intptr_t /*value*/,
+                                void* data,
+                                float /*option*/) {
+    switch (opcode) {
+        case effClose:
+            delete &get_plugin(effect);
+            return 0;
+        case effGetParamLabel:
+            copy_string(data, "x");
+            return 0;
+        case effGetParamDisplay: {
+            char display[32]{};
+            snprintf(display, sizeof(display), "%d",
+                     current_iterations(get_plugin(effect)));
+            copy_string(data, display);
+            return 0;
+        } break;
+        case effGetParamName:
+            copy_string(data, "Load");
+            return 0;
+        case effCanBeAutomated:
+            return 1;
+        case effGetPlugCategory:
+            return kPlugCategEffect;
+        case effGetEffectName:
+        case effGetProductString:
+            copy_string(data, "yabridge bench plugin");
+            return 1;
+        case effGetVendorString:
+            copy_string(data, "yabridge");
+            return 1;
+        case effGetVendorVersion:
+            return 1;
+        case effGetVstVersion:
+            return 2400;
+        default:
+            // Everything else, including the setup calls the benchmark host
+            // makes, needs no work on our end
+            return 0;
+    }
+}
+
+void VST_CALL_CONV process_replacing(AEffect* effect,
+                                     float** inputs,
+                                     float** outputs,
+                                     int num_samples) {
+    BenchPlugin& plugin = get_plugin(effect);
+    const int iterations = current_iterations(plugin);
+    for (int channel = 0; channel < 2; channel++) {
+        bench_dsp::process_channel(inputs[channel], outputs[channel],
+                                   num_samples, iterations,
+                                   plugin.state[channel]);
+    }
+}
+
+void VST_CALL_CONV set_parameter(AEffect* effect, int index, float value) {
+    if (index == 0) {
+        get_plugin(effect).load = value;
+    }
+}
+
+float VST_CALL_CONV get_parameter(AEffect* effect, int index) {
+    return index == 0 ? get_plugin(effect).load : 0.0f;
+}
+
+}  // namespace
+
+extern "C" __attribute__((visibility("default"))) AEffect* VSTPluginMain(
+    audioMasterCallback /*audio_master*/) {
+    BenchPlugin* plugin = new BenchPlugin{};
+
+    AEffect& aeffect = plugin->aeffect;
+    aeffect.magic = kEffectMagic;
+    aeffect.dispatcher = dispatch;
+    aeffect.setParameter = set_parameter;
+    aeffect.getParameter = get_parameter;
+    aeffect.numPrograms = 0;
+    aeffect.numParams = 1;
+    aeffect.numInputs = 2;
+    aeffect.numOutputs = 2;
+    aeffect.flags = effFlagsCanReplacing;
+    aeffect.ptr3 = plugin;
+    aeffect.uniqueID = CCONST('Y', 'b', 'B', 'p');
+    aeffect.version = 1;
+    aeffect.unkown_float = 1.0f;
+    aeffect.processReplacing = process_replacing;
+
+    return &plugin->aeffect;
+}
+
+// XXX: GCC doens't seem to have a clean way to let you define an arbitrary
+//      function called 'main'. Even JUCE does it this way, so it should be
+//      safe.
+extern "C" __attribute__((visibility("default"))) AEffect* deprecated_main(
+    audioMasterCallback audioMaster) asm("main");
+extern "C" AEffect* deprecated_main(audioMasterCallback audioMaster) {
+    return VSTPluginMain(audioMaster);
+}
@@ -0,0 +1,655 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <bitsery/traits/array.h>
+
+#include "../../common/bitsery/ext/in-place-variant.h"
+#include "../../common/communication/common.h"
+#include "../../common/serialization/common.h"
+
+// A loopback micro-benchmark for yabridge's IPC layer. This spins up a pair
+// of `TypedMessageHandler`s within a single process, connected through a Unix
+// domain socket just like a real bridged plugin would be, and it measures
+// round-trip latency and throughput for a couple of representative payload
+// shapes: an empty dispatcher call, a 64 sample stereo audio block, a batch
+// of 32 small events, and a one megabyte state chunk. The results are printed
+// as JSON so they can be compared between commits when working on
+// `src/common/communication/` or `src/common/serialization/`.
+//
+// The payloads are dependency-light stand-ins that match the wire shapes of
+// their real counterparts (`YaProcessData`, the CLAP event lists, and
+// `ChunkData`) without pulling in the plugin SDKs, so this tool benchmarks
+// the serialization and socket machinery rather than any SDK specifics.
+//
+// Since bridging overhead is extremely block size sensitive and different
+// hosts pick different block sizes, `yabridge-bench --sweep` additionally
+// runs a parameter sweep: process-call-shaped round trips at block sizes
+// from 32 to 2048 samples, in both 32-bit and 64-bit precision, across 1 to
+// 16 concurrent instance socket pairs. The result is a table of mean
+// overhead per block, so statements like 'at 64 samples yabridge costs X µs'
+// can be backed by data and tracked between releases.
+
+/**
+ * A stand-in for the logger types normally passed to `TypedMessageHandler`.
+ * We never pass an actual logging pair to `send_message()` or
+ * `receive_messages()`, but the logging code paths are still instantiated, so
+ * this needs to provide the same interface as `Vst3Logger`/`ClapLogger`.
+ */
+struct BenchLogger {
+    Logger& logger_;
+
+    template <typename T>
+    bool log_request(bool, const T&) {
+        return false;
+    }
+
+    template <typename T>
+    void log_response(bool, const T&) {}
+};
+
+/**
+ * A request without any payload, like the many `effCanDo()`-style dispatcher
+ * calls and marker structs that only exist to ask for some value. This
+ * measures the fixed per-round-trip overhead.
+ */
+struct EmptyDispatch {
+    using Response = Ack;
+
+    template <typename S>
+    void serialize(S&) {}
+};
+
+/**
+ * The response to an `AudioBlock`, carrying the processed audio back to the
+ * native plugin just like `YaProcessData::Response` would.
+ */
+struct AudioBlockResponse {
+    std::array<std::array<float, 64>, 2> channels;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container(channels, [](S& s, std::array<float, 64>& channel) {
+            s.container4b(channel);
+        });
+    }
+};
+
+/**
+ * A 64 sample stereo audio block, the payload shape of a `YaProcessData`
+ * process call at a small buffer size. The response sends the same amount of
+ * audio back, so a round trip moves audio in both directions like a real
+ * process call does.
+ */
+struct AudioBlock {
+    using Response = AudioBlockResponse;
+
+    std::array<std::array<float, 64>, 2> channels;
+    double sample_rate;
+    int32_t num_samples;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container(channels, [](S& s, std::array<float, 64>& channel) {
+            s.container4b(channel);
+        });
+        s.value8b(sample_rate);
+        s.value4b(num_samples);
+    }
+};
+
+/**
+ * A single event in an `EventBatch`, sized like a CLAP note event header.
+ */
+struct BenchEvent {
+    uint32_t time;
+    uint16_t type;
+    int16_t key;
+    double value;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.value4b(time);
+        s.value2b(type);
+        s.value2b(key);
+        s.value8b(value);
+    }
+};
+
+/**
+ * A batch of small events, like the input event list sent along with a CLAP
+ * process call when a plugin receives a lot of notes or automation at once.
+ */
+struct EventBatch {
+    using Response = Ack;
+
+    std::vector<BenchEvent> events;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container(events, 1 << 16);
+    }
+};
+
+/**
+ * A large binary blob, like the `ChunkData` payloads used when saving and
+ * restoring plugin state. This stresses the bulk transfer throughput rather
+ * than the per-message overhead.
+ */
+struct Chunk {
+    using Response = Ack;
+
+    std::vector<uint8_t> buffer;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container1b(buffer, 1 << 26);
+    }
+};
+
+/**
+ * The response to a `SweepBlockFloat`, carrying the same amount of audio
+ * back to the sender.
+ */
+struct SweepBlockFloatResponse {
+    std::vector<float> samples;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container4b(samples, 1 << 22);
+    }
+};
+
+/**
+ * A variable sized stereo audio block of 32-bit samples, used by the sweep
+ * mode. Unlike the fixed size `AudioBlock` the sample count is a runtime
+ * parameter, so the same payload shape can be measured at every block size a
+ * host might pick. The vector holds both channels back to back.
+ */
+struct SweepBlockFloat {
+    using Response = SweepBlockFloatResponse;
+
+    std::vector<float> samples;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container4b(samples, 1 << 22);
+    }
+};
+
+/**
+ * The response to a `SweepBlockDouble`, carrying the same amount of audio
+ * back to the sender.
+ */
+struct SweepBlockDoubleResponse {
+    std::vector<double> samples;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container8b(samples, 1 << 22);
+    }
+};
+
+/**
+ * The 64-bit precision counterpart to `SweepBlockFloat`, for hosts and
+ * plugins that process in double precision.
+ */
+struct SweepBlockDouble {
+    using Response = SweepBlockDoubleResponse;
+
+    std::vector<double> samples;
+
+    template <typename S>
+    void serialize(S& s) {
+        s.container8b(samples, 1 << 22);
+    }
+};
+
+/**
+ * The request variant sent over the benchmark's sockets, mirroring the
+ * `*ControlRequest` variants used by the real bridges.
+ */
+using BenchRequest = std::variant<EmptyDispatch,
+                                  AudioBlock,
+                                  EventBatch,
+                                  Chunk,
+                                  SweepBlockFloat,
+                                  SweepBlockDouble>;
+
+template <typename S>
+void serialize(S& s, BenchRequest& payload) {
+    // All of the objects in the variant should have their own serialization
+    // function
+    s.ext(payload, bitsery::ext::InPlaceVariant{});
+}
+
+using BenchMessageHandler =
+    TypedMessageHandler<std::jthread, BenchLogger, BenchRequest>;
+
+/**
+ * The timing results for a single payload shape.
+ */
+struct BenchResult {
+    std::string name;
+    size_t iterations;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    double roundtrips_per_second;
+};
+
+/**
+ * Send `request` over `handler` `iterations` times and collect round-trip
+ * timings, after sending it `warmup` times to connect the socket pools and
+ * warm up the serialization buffers.
+ */
+template <typename T>
+BenchResult run_benchmark(BenchMessageHandler& handler,
+                          const std::string& name,
+                          const T& request,
+                          size_t iterations,
+                          size_t warmup) {
+    // Just like the audio threads in the real bridges we'll reuse a single
+    // serialization buffer for every round trip
+    SerializationBuffer<256> buffer{};
+    for (size_t i = 0; i < warmup; i++) {
+        handler.send_message(request, std::nullopt, buffer);
+    }
+
+    std::vector<double> timings_us(iterations);
+    const auto total_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        handler.send_message(request, std::nullopt, buffer);
+        timings_us[i] = std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    }
+    const double total_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      total_start)
+            .count();
+
+    std::sort(timings_us.begin(), timings_us.end());
+    double sum = 0.0;
+    for (const double timing : timings_us) {
+        sum += timing;
+    }
+
+    return BenchResult{
+        .name = name,
+        .iterations = iterations,
+        .mean_us = sum / static_cast<double>(iterations),
+        .p50_us = timings_us[(iterations - 1) / 2],
+        .p99_us = timings_us[((iterations - 1) * 99) / 100],
+        .max_us = timings_us.back(),
+        .roundtrips_per_second =
+            static_cast<double>(iterations) / total_seconds,
+    };
+}
+
+/**
+ * A single loopback instance: a connected `TypedMessageHandler` pair with an
+ * echo server running on its own thread, shaped like the socket pair between
+ * a bridged plugin instance and the Wine plugin host. The sweep mode spins up
+ * several of these at once to measure how the overhead scales with concurrent
+ * instances.
+ */
+class BenchInstance {
+   public:
+    BenchInstance()
+        : endpoint_base_dir_(generate_endpoint_base("bench")),
+          endpoint_((endpoint_base_dir_ / "bench.sock").string()),
+          plugin_side_(plugin_context_, endpoint_, true),
+          host_side_(host_context_, endpoint_, false) {
+        std::jthread accept_thread([&]() { plugin_side_.connect(); });
+        host_side_.connect();
+        accept_thread.join();
+
+        // The host side acts as a simple echo server, sending back response
+        // objects of the appropriate shapes
+        host_thread_ = std::jthread([&]() {
+            try {
+                host_side_.receive_messages(
+                    std::nullopt,
+                    overload{
+                        [](EmptyDispatch&) { return Ack{}; },
+                        [](AudioBlock& block) {
+                            return AudioBlockResponse{.channels =
+                                                          block.channels};
+                        },
+                        [](EventBatch&) { return Ack{}; },
+                        [](Chunk&) { return Ack{}; },
+                        [](SweepBlockFloat& block) {
+                            return SweepBlockFloatResponse{
+                                .samples = std::move(block.samples)};
+                        },
+                        [](SweepBlockDouble& block) {
+                            return SweepBlockDoubleResponse{
+                                .samples = std::move(block.samples)};
+                        },
+                    });
+            } catch (const std::system_error&) {
+                // Thrown when the sockets get closed after the last benchmark
+            }
+        });
+    }
+
+    ~BenchInstance() noexcept {
+        plugin_side_.close();
+        host_side_.close();
+        host_thread_.join();
+
+        std::error_code err;
+        ghc::filesystem::remove_all(endpoint_base_dir_, err);
+    }
+
+    BenchInstance(const BenchInstance&) = delete;
+    BenchInstance& operator=(const BenchInstance&) = delete;
+    BenchInstance(BenchInstance&&) = delete;
+    BenchInstance& operator=(BenchInstance&&) = delete;
+
+    BenchMessageHandler& plugin_side() noexcept { return plugin_side_; }
+
+   private:
+    // These sockets live in their own directory under the regular temporary
+    // directory, just like the endpoints created by an actual bridged plugin
+    ghc::filesystem::path endpoint_base_dir_;
+    asio::local::stream_protocol::endpoint endpoint_;
+
+    asio::io_context plugin_context_{};
+    asio::io_context host_context_{};
+
+    BenchMessageHandler plugin_side_;
+    BenchMessageHandler host_side_;
+
+    std::jthread host_thread_;
+};
+
+/**
+ * The timing results for one cell of the sweep: a combination of block size,
+ * sample precision, and concurrent instance count.
+ */
+struct SweepResult {
+    size_t num_instances;
+    size_t block_size;
+    bool double_precision;
+    size_t iterations_per_instance;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    double blocks_per_second;
+};
+
+/**
+ * Measure one cell of the sweep. This spins up `num_instances` loopback
+ * instances with a sender thread each, synchronizes their start so the
+ * instances actually contend with each other like multiple plugin instances
+ * in a session would, and merges the per-thread round-trip timings.
+ */
+template <typename T>
+SweepResult run_sweep_cell(size_t num_instances,
+                           size_t block_size,
+                           size_t iterations,
+                           size_t warmup) {
+    std::vector<std::unique_ptr<BenchInstance>> instances{};
+    instances.reserve(num_instances);
+    for (size_t i = 0; i < num_instances; i++) {
+        instances.push_back(std::make_unique<BenchInstance>());
+    }
+
+    // Both channels of a stereo block, stored back to back
+    T request{};
+    request.samples.resize(block_size * 2);
+
+    std::vector<std::vector<double>> timings_us(num_instances);
+    std::vector<double> elapsed_seconds(num_instances);
+
+    std::latch ready_latch(static_cast<std::ptrdiff_t>(num_instances));
+    std::latch start_latch(1);
+
+    {
+        std::vector<std::jthread> senders{};
+        senders.reserve(num_instances);
+        for (size_t i = 0; i < num_instances; i++) {
+            senders.emplace_back([&, i]() {
+                BenchMessageHandler& handler = instances[i]->plugin_side();
+
+                // Just like the audio threads in the real bridges we'll reuse
+                // a single serialization buffer for every round trip
+                SerializationBuffer<256> buffer{};
+                for (size_t j = 0; j < warmup; j++) {
+                    handler.send_message(request, std::nullopt, buffer);
+                }
+
+                // All threads finish their warmup before any of them starts
+                // the measured iterations
+                ready_latch.count_down();
+                start_latch.wait();
+
+                timings_us[i].resize(iterations);
+                const auto total_start = std::chrono::steady_clock::now();
+                for (size_t j = 0; j < iterations; j++) {
+                    const auto start = std::chrono::steady_clock::now();
+                    handler.send_message(request, std::nullopt, buffer);
+                    timings_us[i][j] =
+                        std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+                }
+                elapsed_seconds[i] =
+                    std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - total_start)
+                        .count();
+            });
+        }
+
+        ready_latch.wait();
+        start_latch.count_down();
+    }
+
+    std::vector<double> merged_us{};
+    merged_us.reserve(num_instances * iterations);
+    double blocks_per_second = 0.0;
+    for (size_t i = 0; i < num_instances; i++) {
+        merged_us.insert(merged_us.end(), timings_us[i].begin(),
+                         timings_us[i].end());
+        blocks_per_second +=
+            static_cast<double>(iterations) / elapsed_seconds[i];
+    }
+
+    std::sort(merged_us.begin(), merged_us.end());
+    double sum = 0.0;
+    for (const double timing : merged_us) {
+        sum += timing;
+    }
+
+    return SweepResult{
+        .num_instances = num_instances,
+        .block_size = block_size,
+        .double_precision = std::is_same_v<T, SweepBlockDouble>,
+        .iterations_per_instance = iterations,
+        .mean_us = sum / static_cast<double>(merged_us.size()),
+        .p50_us = merged_us[(merged_us.size() - 1) / 2],
+        .p99_us = merged_us[((merged_us.size() - 1) * 99) / 100],
+        .max_us = merged_us.back(),
+        .blocks_per_second = blocks_per_second,
+    };
+}
+
+/**
+ * Run the full parameter sweep and print either a human readable table of
+ * mean overhead per block or, with `--json`, the raw results.
+ */
+int run_sweep(bool print_json, size_t iterations) {
+    constexpr std::array<size_t, 7> block_sizes{32,  64,   128, 256,
+                                                512, 1024, 2048};
+    constexpr std::array<size_t, 5> instance_counts{1, 2, 4, 8, 16};
+    const size_t warmup = std::max<size_t>(iterations / 10, 1);
+
+    std::vector<SweepResult> results{};
+    for (const bool double_precision : {false, true}) {
+        for (const size_t num_instances : instance_counts) {
+            for (const size_t block_size : block_sizes) {
+                std::cerr << "sweep: " << (double_precision ? "f64" : "f32")
+                          << ", " << num_instances << " instance"
+                          << (num_instances == 1 ? "" : "s") << ", "
+                          << block_size << " samples" << std::endl;
+                results.push_back(
+                    double_precision
+                        ? run_sweep_cell<SweepBlockDouble>(
+                              num_instances, block_size, iterations, warmup)
+                        : run_sweep_cell<SweepBlockFloat>(
+                              num_instances, block_size, iterations, warmup));
+            }
+        }
+    }
+
+    if (print_json) {
+        std::cout << "{\n  \"sweep\": [" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < results.size(); i++) {
+            const SweepResult& result = results[i];
+            std::cout << "    {\"precision\": \""
+                      << (result.double_precision ? "f64" : "f32")
+                      << "\", \"instances\": " << result.num_instances
+                      << ", \"block_size\": " << result.block_size
+                      << ", \"iterations_per_instance\": "
+                      << result.iterations_per_instance
+                      << ", \"mean_us\": " << result.mean_us
+                      << ", \"p50_us\": " << result.p50_us
+                      << ", \"p99_us\": " << result.p99_us
+                      << ", \"max_us\": " << result.max_us
+                      << ", \"blocks_per_second\": "
+                      << result.blocks_per_second << "}"
+                      << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        std::cout << "  ]\n}" << std::endl;
+    } else {
+        std::cout << "Mean round-trip overhead in microseconds per block:"
+                  << std::endl
+                  << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << std::setw(9) << "precision" << std::setw(10)
+                  << "instances";
+        for (const size_t block_size : block_sizes) {
+            std::cout << std::setw(8) << block_size;
+        }
+        std::cout << std::endl;
+
+        size_t result_idx = 0;
+        for (const bool double_precision : {false, true}) {
+            for (const size_t num_instances : instance_counts) {
+                std::cout << std::setw(9) << (double_precision ? "f64" : "f32")
+                          << std::setw(10) << num_instances;
+                for (size_t i = 0; i < block_sizes.size(); i++) {
+                    std::cout << std::setw(8)
+                              << results[result_idx++].mean_us;
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    bool sweep = false;
+    bool print_json = false;
+    size_t sweep_iterations = 1000;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--sweep") {
+            sweep = true;
+        } else if (arg == "--json") {
+            print_json = true;
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            sweep_iterations =
+                static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+            if (sweep_iterations == 0) {
+                std::cerr << "'--iterations' requires a positive number"
+                          << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Usage: yabridge-bench [--sweep] [--json] "
+                         "[--iterations <n>]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if (sweep) {
+        return run_sweep(print_json, sweep_iterations);
+    }
+
+    BenchInstance instance{};
+    BenchMessageHandler& plugin_side = instance.plugin_side();
+
+    AudioBlock audio_block{};
+    audio_block.sample_rate = 44100.0;
+    audio_block.num_samples = 64;
+
+    EventBatch event_batch{};
+    event_batch.events.resize(32);
+
+    Chunk chunk{};
+    chunk.buffer.resize(1 << 20);
+
+    std::vector<BenchResult> results{};
+    results.push_back(run_benchmark(plugin_side, "empty_dispatch",
+                                    EmptyDispatch{}, 20000, 2000));
+    results.push_back(run_benchmark(plugin_side, "audio_block_64_stereo",
+                                    audio_block, 20000, 2000));
+    results.push_back(
+        run_benchmark(plugin_side, "event_batch_32", event_batch, 20000, 2000));
+    results.push_back(run_benchmark(plugin_side, "chunk_1mb", chunk, 500, 50));
+
+    std::cout << "{\n  \"benchmarks\": [" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        std::cout << "    {\"name\": \"" << result.name
+                  << "\", \"iterations\": " << result.iterations
+                  << ", \"mean_us\": " << result.mean_us
+                  << ", \"p50_us\": " << result.p50_us
+                  << ", \"p99_us\": " << result.p99_us
+                  << ", \"max_us\": " << result.max_us
+                  << ", \"roundtrips_per_second\": "
+                  << result.roundtrips_per_second << "}"
+                  << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    std::cout << "  ]\n}" << std::endl;
+
+    return 0;
+}
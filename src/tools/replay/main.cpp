@@ -0,0 +1,489 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../common/logging/message-record.h"
+
+// A player for the message recordings written when
+// `YABRIDGE_MESSAGE_RECORD_FILE` is set, see
+// `src/common/logging/message-record.h` for the format. A recording captures
+// the already-serialized bitsery payloads of every message sent over the
+// bridge's sockets, so a session recorded from a problematic host (say, a
+// Cubase automation storm) can be played back deterministically afterwards
+// without that host, at the original or at accelerated timing.
+//
+// A recording interleaves the streams of all of an instance's sockets, so a
+// replay covers a single stream selected with `--stream`. Our sockets use
+// strict request-response framing, which means a stream's sent records pair
+// up with the received record that follows them into complete round trips.
+// By default those round trips are played back over a local socket pair, with
+// the recorded responses served from a second thread: a deterministic
+// benchmark of the IPC layer using real-world payloads, printing the same
+// JSON shape as `yabridge-bench`. With `--connect` the requests are instead
+// sent to a live endpoint, whose responses are read and discarded.
+//
+// Since the records are written in the host machine's native byte order, a
+// recording should be replayed on the machine (or at least the architecture)
+// it was recorded on.
+
+/**
+ * A single record loaded from the recording file.
+ */
+struct LoadedRecord {
+    MessageRecordHeader header;
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * A request-response pair reconstructed from a stream, with the request's
+ * offset from the start of the recording used for pacing the playback.
+ */
+struct RoundTrip {
+    uint64_t offset_us;
+    const std::vector<uint8_t>* request;
+    const std::vector<uint8_t>* response;
+};
+
+/**
+ * The `<pid>:<fd>` key identifying a single socket's stream within the
+ * recording.
+ */
+using StreamKey = std::pair<uint32_t, uint32_t>;
+
+void print_usage(const char* program_name) {
+    std::cerr << "Usage: " << program_name
+              << " [options] <recording_file>" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Replays a message recording made with the "
+                 "YABRIDGE_MESSAGE_RECORD_FILE" << std::endl;
+    std::cerr << "environment variable." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --list              List the streams in the recording "
+                 "and exit" << std::endl;
+    std::cerr << "  --stream <pid>:<fd> The stream to replay, required when "
+                 "the recording" << std::endl;
+    std::cerr << "                      contains more than one" << std::endl;
+    std::cerr << "  --rate <factor>     Playback speed, 1 replays at the "
+                 "original timing" << std::endl;
+    std::cerr << "                      and 0 replays as fast as possible "
+                 "(default: 1)" << std::endl;
+    std::cerr << "  --connect <path>    Send the requests to this Unix "
+                 "domain socket instead" << std::endl;
+    std::cerr << "                      of serving the recorded responses "
+                 "locally" << std::endl;
+}
+
+/**
+ * Connect to a Unix domain socket endpoint. Since yabridge's per-instance
+ * sockets live in the abstract socket namespace, a path that doesn't resolve
+ * as a filesystem socket is retried there.
+ */
+int connect_to_endpoint(const std::string& path) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        close(fd);
+        return -1;
+    }
+
+    memcpy(address.sun_path, path.data(), path.size());
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address),
+                sizeof(address)) == 0) {
+        return fd;
+    }
+
+    // The abstract namespace version of the same name starts with a null
+    // byte, see `as_abstract_endpoint()` in `src/common/communication/`
+    memmove(address.sun_path + 1, address.sun_path, path.size());
+    address.sun_path[0] = '\0';
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address),
+                offsetof(sockaddr_un, sun_path) + path.size() + 1) == 0) {
+        return fd;
+    }
+
+    close(fd);
+    return -1;
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t result = write(fd, bytes, size);
+        if (result <= 0) {
+            return false;
+        }
+
+        bytes += result;
+        size -= static_cast<size_t>(result);
+    }
+
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size) {
+    auto* bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t result = read(fd, bytes, size);
+        if (result <= 0) {
+            return false;
+        }
+
+        bytes += result;
+        size -= static_cast<size_t>(result);
+    }
+
+    return true;
+}
+
+/**
+ * Send a payload with the same `<uint64 size><payload>` framing
+ * `write_object()` uses.
+ */
+bool send_framed(int fd, const std::vector<uint8_t>& payload) {
+    const uint64_t size = payload.size();
+    return write_all(fd, &size, sizeof(size)) &&
+           write_all(fd, payload.data(), payload.size());
+}
+
+/**
+ * Read and discard a framed message, returning whether one could be read.
+ */
+bool receive_framed(int fd, std::vector<uint8_t>& scratch) {
+    uint64_t size;
+    if (!read_all(fd, &size, sizeof(size))) {
+        return false;
+    }
+
+    // Builds with LZ4 support mark compressed messages with the top bit of
+    // the size header. We're discarding the payload anyways, so there's no
+    // need to actually decompress it here.
+    size &= ~(1ull << 63);
+
+    scratch.resize(size);
+    return read_all(fd, scratch.data(), size);
+}
+
+int main(int argc, char** argv) {
+    bool list_streams = false;
+    std::optional<StreamKey> selected_stream{};
+    double rate = 1.0;
+    std::optional<std::string> connect_path{};
+    std::optional<std::string> recording_path{};
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument(argv[i]);
+        if (argument == "--list") {
+            list_streams = true;
+        } else if (argument == "--stream" && i + 1 < argc) {
+            const std::string value(argv[++i]);
+            const size_t separator = value.find(':');
+            try {
+                if (separator == std::string::npos) {
+                    throw std::invalid_argument(value);
+                }
+
+                selected_stream = StreamKey(
+                    std::stoul(value.substr(0, separator)),
+                    std::stoul(value.substr(separator + 1)));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid stream '" << value
+                          << "', expected <pid>:<fd>" << std::endl;
+                return 1;
+            }
+        } else if (argument == "--rate" && i + 1 < argc) {
+            rate = std::atof(argv[++i]);
+            if (rate < 0.0) {
+                std::cerr << "The replay rate cannot be negative"
+                          << std::endl;
+                return 1;
+            }
+        } else if (argument == "--connect" && i + 1 < argc) {
+            connect_path = argv[++i];
+        } else if (!recording_path && argument[0] != '-') {
+            recording_path = argument;
+        } else {
+            print_usage(argc > 0 ? argv[0] : "yabridge-replay");
+            return 1;
+        }
+    }
+
+    if (!recording_path) {
+        print_usage(argc > 0 ? argv[0] : "yabridge-replay");
+        return 1;
+    }
+
+    std::ifstream recording_file(*recording_path, std::ios::binary);
+    if (!recording_file.is_open()) {
+        std::cerr << "Could not open '" << *recording_path << "'"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<LoadedRecord> records{};
+    MessageRecordHeader header{};
+    while (recording_file.read(reinterpret_cast<char*>(&header),
+                               sizeof(header))) {
+        if (header.version != message_record_format_version) {
+            std::cerr << "'" << *recording_path << "' contains a version "
+                      << header.version
+                      << " record, but this version of yabridge-replay only "
+                         "supports version "
+                      << message_record_format_version
+                      << ". It was likely written by a different yabridge "
+                         "version." << std::endl;
+            return 1;
+        }
+
+        LoadedRecord record{.header = header, .payload = {}};
+        record.payload.resize(header.payload_size);
+        if (!recording_file.read(
+                reinterpret_cast<char*>(record.payload.data()),
+                header.payload_size)) {
+            std::cerr << "'" << *recording_path
+                      << "' ends with a truncated record, ignoring it"
+                      << std::endl;
+            break;
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    if (records.empty()) {
+        std::cerr << "'" << *recording_path << "' contains no records"
+                  << std::endl;
+        return 1;
+    }
+
+    // The streams are keyed by the writing process and the socket's file
+    // descriptor within that process, in order of first appearance
+    std::map<StreamKey, std::vector<const LoadedRecord*>> streams{};
+    for (const LoadedRecord& record : records) {
+        streams[{record.header.pid, record.header.stream_id}].push_back(
+            &record);
+    }
+
+    if (list_streams) {
+        std::cout << "stream     records  sent  received  duration"
+                  << std::endl;
+        for (const auto& [key, stream] : streams) {
+            size_t sent = 0;
+            for (const LoadedRecord* record : stream) {
+                if (record->header.direction ==
+                    static_cast<uint16_t>(MessageRecordDirection::sent)) {
+                    sent++;
+                }
+            }
+
+            const double duration_seconds =
+                static_cast<double>(stream.back()->header.timestamp_us -
+                                    stream.front()->header.timestamp_us) /
+                1e6;
+            std::cout << std::left << std::setw(10)
+                      << (std::to_string(key.first) + ":" +
+                          std::to_string(key.second))
+                      << " " << std::setw(8) << stream.size() << " "
+                      << std::setw(5) << sent << " " << std::setw(9)
+                      << (stream.size() - sent) << " " << std::fixed
+                      << std::setprecision(1) << duration_seconds << " s"
+                      << std::endl;
+        }
+
+        return 0;
+    }
+
+    if (!selected_stream) {
+        if (streams.size() == 1) {
+            selected_stream = streams.begin()->first;
+        } else {
+            std::cerr << "The recording contains " << streams.size()
+                      << " streams, pick one with --stream (see --list)"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    const auto stream_it = streams.find(*selected_stream);
+    if (stream_it == streams.end()) {
+        std::cerr << "The recording does not contain stream '"
+                  << selected_stream->first << ":" << selected_stream->second
+                  << "'" << std::endl;
+        return 1;
+    }
+
+    // Thanks to the strict request-response framing on our sockets, a sent
+    // record and the received record that follows it form a round trip.
+    // Streams recorded on the receiving side of a socket (where the first
+    // direction is a receive) are served rather than driven by that process,
+    // so those should be replayed from the other process' recording instead.
+    const uint64_t first_timestamp_us =
+        stream_it->second.front()->header.timestamp_us;
+    if (stream_it->second.front()->header.direction ==
+        static_cast<uint16_t>(MessageRecordDirection::received)) {
+        std::cerr << "Warning: stream " << selected_stream->first << ":"
+                  << selected_stream->second
+                  << " starts with a received record, so it was likely"
+                  << std::endl;
+        std::cerr << "recorded on the serving side of the socket. The "
+                     "replayed \"requests\" will" << std::endl;
+        std::cerr << "actually be that side's responses, try the other "
+                     "process' stream instead." << std::endl;
+    }
+    std::vector<RoundTrip> round_trips{};
+    const std::vector<uint8_t>* pending_request = nullptr;
+    uint64_t pending_offset_us = 0;
+    for (const LoadedRecord* record : stream_it->second) {
+        if (record->header.direction ==
+            static_cast<uint16_t>(MessageRecordDirection::sent)) {
+            pending_request = &record->payload;
+            pending_offset_us =
+                record->header.timestamp_us - first_timestamp_us;
+        } else if (pending_request) {
+            round_trips.push_back(RoundTrip{.offset_us = pending_offset_us,
+                                            .request = pending_request,
+                                            .response = &record->payload});
+            pending_request = nullptr;
+        }
+    }
+
+    if (round_trips.empty()) {
+        std::cerr << "Stream " << selected_stream->first << ":"
+                  << selected_stream->second
+                  << " contains no request-response round trips. It was "
+                     "likely recorded on" << std::endl;
+        std::cerr << "the receiving side of the socket, try the other "
+                     "process' stream instead." << std::endl;
+        return 1;
+    }
+
+    // Without `--connect` the recorded responses are served from a local
+    // responder thread, so the replay is fully deterministic
+    int request_fd = -1;
+    std::thread responder{};
+    if (connect_path) {
+        request_fd = connect_to_endpoint(*connect_path);
+        if (request_fd == -1) {
+            std::cerr << "Could not connect to '" << *connect_path << "'"
+                      << std::endl;
+            return 1;
+        }
+    } else {
+        std::array<int, 2> sockets{};
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0,
+                       sockets.data()) != 0) {
+            std::cerr << "Could not create a local socket pair" << std::endl;
+            return 1;
+        }
+
+        request_fd = sockets[0];
+        responder = std::thread([response_fd = sockets[1], &round_trips]() {
+            std::vector<uint8_t> scratch{};
+            for (const RoundTrip& round_trip : round_trips) {
+                if (!receive_framed(response_fd, scratch) ||
+                    !send_framed(response_fd, *round_trip.response)) {
+                    break;
+                }
+            }
+
+            close(response_fd);
+        });
+    }
+
+    // The requests are sent at the recorded timing scaled by the replay
+    // rate, and the time spent waiting for every response is measured just
+    // like `send_message()` would experience it
+    std::vector<double> timings_us(round_trips.size());
+    std::vector<uint8_t> response_scratch{};
+    const auto playback_start = std::chrono::steady_clock::now();
+    size_t completed = 0;
+    for (const RoundTrip& round_trip : round_trips) {
+        if (rate > 0.0) {
+            std::this_thread::sleep_until(
+                playback_start +
+                std::chrono::microseconds(static_cast<uint64_t>(
+                    static_cast<double>(round_trip.offset_us) / rate)));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (!send_framed(request_fd, *round_trip.request) ||
+            !receive_framed(request_fd, response_scratch)) {
+            std::cerr << "The connection was closed after " << completed
+                      << " of " << round_trips.size() << " round trips"
+                      << std::endl;
+            break;
+        }
+
+        timings_us[completed] =
+            std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+        completed++;
+    }
+    const double total_seconds = std::chrono::duration<double>(
+                                     std::chrono::steady_clock::now() -
+                                     playback_start)
+                                     .count();
+
+    close(request_fd);
+    if (responder.joinable()) {
+        responder.join();
+    }
+
+    if (completed == 0) {
+        return 1;
+    }
+
+    timings_us.resize(completed);
+    std::sort(timings_us.begin(), timings_us.end());
+    double sum = 0.0;
+    for (const double timing : timings_us) {
+        sum += timing;
+    }
+
+    // The same shape as `yabridge-bench`'s output, so the two can be
+    // compared and post-processed with the same scripts
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "{\"round_trips\": " << completed
+              << ", \"duration_seconds\": " << total_seconds
+              << ", \"mean_us\": " << (sum / static_cast<double>(completed))
+              << ", \"p50_us\": " << timings_us[(completed - 1) / 2]
+              << ", \"p99_us\": " << timings_us[((completed - 1) * 99) / 100]
+              << ", \"max_us\": " << timings_us.back() << "}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "../../common/logging/binary-trace.h"
+
+// A small offline renderer for the binary trace files written when
+// `YABRIDGE_BINARY_TRACE_FILE` is set, see
+// `src/common/logging/binary-trace.h` for the format. This turns the
+// fixed-size records back into lines that resemble the regular
+// `YABRIDGE_DEBUG_LEVEL=2` output, and it computes the time spent in every
+// process call from the deltas between request and response records. Since
+// the records are written in the host machine's native byte order, the trace
+// file should be rendered on the machine (or at least the architecture) it
+// was recorded on.
+
+/**
+ * The function name belonging to a record's event type, in the same format
+ * the regular logger uses.
+ */
+const char* event_type_name(BinaryTraceEventType event_type) {
+    switch (event_type) {
+        case BinaryTraceEventType::vst3_process_request:
+        case BinaryTraceEventType::vst3_process_response:
+            return "IAudioProcessor::process()";
+        case BinaryTraceEventType::clap_process_request:
+        case BinaryTraceEventType::clap_process_response:
+            return "clap_plugin::process()";
+        default:
+            return "<unknown>";
+    }
+}
+
+/**
+ * Whether a record describes a request. The other record types are responses
+ * to the matching request type.
+ */
+bool is_request(BinaryTraceEventType event_type) {
+    return event_type == BinaryTraceEventType::vst3_process_request ||
+           event_type == BinaryTraceEventType::clap_process_request;
+}
+
+/**
+ * The request type a response record belongs to, used for matching the two
+ * up when computing call durations.
+ */
+BinaryTraceEventType request_type_for(BinaryTraceEventType event_type) {
+    switch (event_type) {
+        case BinaryTraceEventType::vst3_process_response:
+            return BinaryTraceEventType::vst3_process_request;
+        case BinaryTraceEventType::clap_process_response:
+            return BinaryTraceEventType::clap_process_request;
+        default:
+            return event_type;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << (argc > 0 ? argv[0] : "yabridge-trace")
+                  << " <trace_file>" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Renders a binary trace file recorded with the "
+                     "YABRIDGE_BINARY_TRACE_FILE" << std::endl;
+        std::cerr << "environment variable into a human-readable form."
+                  << std::endl;
+
+        return 1;
+    }
+
+    std::ifstream trace_file(argv[1], std::ios::binary);
+    if (!trace_file.is_open()) {
+        std::cerr << "Could not open '" << argv[1] << "'" << std::endl;
+
+        return 1;
+    }
+
+    // The response records don't carry an instance ID, so requests and
+    // responses are matched up per process and per request type instead.
+    // Since the process calls within one of these streams are strictly
+    // sequential this is unambiguous.
+    std::map<std::pair<uint32_t, BinaryTraceEventType>, BinaryTraceRecord>
+        pending_requests{};
+    std::optional<uint64_t> first_timestamp_us{};
+
+    BinaryTraceRecord record{};
+    while (trace_file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        if (record.version != binary_trace_format_version) {
+            std::cerr << "'" << argv[1] << "' contains a version "
+                      << record.version
+                      << " record, but this version of yabridge-trace only "
+                         "supports version "
+                      << binary_trace_format_version
+                      << ". It was likely written by a different yabridge "
+                         "version."
+                      << std::endl;
+
+            return 1;
+        }
+
+        // All timestamps are printed relative to the first record so they're
+        // easier to correlate, and the processes writing to the same trace
+        // file share a monotonic epoch
+        if (!first_timestamp_us) {
+            first_timestamp_us = record.timestamp_us;
+        }
+        const uint64_t relative_us = record.timestamp_us - *first_timestamp_us;
+
+        const auto event_type =
+            static_cast<BinaryTraceEventType>(record.event_type);
+        std::cout << std::setfill('0') << (relative_us / 1'000'000) << "."
+                  << std::setw(6) << (relative_us % 1'000'000)
+                  << std::setfill(' ') << " [" << record.pid << "] ";
+
+        if (is_request(event_type)) {
+            pending_requests[{record.pid, event_type}] = record;
+
+            std::cout << record.instance_id << ": "
+                      << event_type_name(event_type) << ", "
+                      << record.num_samples << " samples, "
+                      << record.num_events << " input events" << std::endl;
+        } else {
+            std::cout << event_type_name(event_type) << " returned, "
+                      << record.num_events << " output events";
+
+            const auto matching_request = pending_requests.extract(
+                {record.pid, request_type_for(event_type)});
+            if (matching_request) {
+                std::cout << ", took "
+                          << (record.timestamp_us -
+                              matching_request.mapped().timestamp_us)
+                          << " us";
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    return 0;
+}
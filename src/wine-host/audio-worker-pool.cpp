@@ -0,0 +1,281 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "audio-worker-pool.h"
+
+#include <algorithm>
+#include <optional>
+#include <pthread.h>
+#include <string>
+
+#include "../common/utils.h"
+
+using namespace std::literals::chrono_literals;
+
+/**
+ * One in the fixed point format used for the queue depth moving average,
+ * with eight fractional bits.
+ */
+constexpr int64_t queue_depth_fp_one = 256;
+/**
+ * The worker target is recomputed once every this many submissions. At a
+ * hundred blocks per second and a dozen submissions per block this still
+ * reevaluates the target several times a second.
+ */
+constexpr size_t target_update_interval = 64;
+/**
+ * The minimum time between consecutive target changes, per direction.
+ * Scaling up reacts quickly since a too small target delays processing
+ * calls, while scaling down waits until the lower load has clearly settled.
+ */
+constexpr auto scale_up_cooldown = 100ms;
+constexpr auto scale_down_cooldown = 1s;
+
+AudioWorkerPool& AudioWorkerPool::instance() {
+    static AudioWorkerPool pool{};
+    return pool;
+}
+
+AudioWorkerPool::AudioWorkerPool() noexcept
+    : num_workers_(count_physical_cores()), num_active_workers_(num_workers_) {}
+
+AudioWorkerPool::~AudioWorkerPool() noexcept {
+    {
+        std::lock_guard lock(idle_mutex_);
+        shutdown_.store(true);
+    }
+    idle_cv_.notify_all();
+    unpark_cv_.notify_all();
+
+    // The `Win32Thread` destructors will join the workers
+}
+
+AudioWorkerPool::AudioThreadGuard::AudioThreadGuard() noexcept {
+    AudioWorkerPool& pool = AudioWorkerPool::instance();
+    const size_t num_audio_threads =
+        pool.num_audio_threads_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // The workers are only spawned once they can actually be of use, so
+    // individually hosted plugins and small groups never pay for them
+    if (num_audio_threads > pool.num_workers_) {
+        pool.ensure_workers_started();
+    }
+}
+
+AudioWorkerPool::AudioThreadGuard::~AudioThreadGuard() noexcept {
+    AudioWorkerPool::instance().num_audio_threads_.fetch_sub(
+        1, std::memory_order_relaxed);
+}
+
+void AudioWorkerPool::submit_and_wait(void (*invoke)(void* context),
+                                      void* context) {
+    std::mutex completion_mutex;
+    std::condition_variable completion_cv;
+    bool completed = false;
+
+    enqueue(Task{.invoke = invoke,
+                 .context = context,
+                 .completion_mutex = &completion_mutex,
+                 .completion_cv = &completion_cv,
+                 .completed = &completed});
+
+    std::unique_lock lock(completion_mutex);
+    completion_cv.wait(lock, [&]() { return completed; });
+}
+
+void AudioWorkerPool::submit_detached(void (*invoke)(void* context),
+                                      void* context) {
+    enqueue(Task{.invoke = invoke,
+                 .context = context,
+                 .completion_mutex = nullptr,
+                 .completion_cv = nullptr,
+                 .completed = nullptr});
+}
+
+void AudioWorkerPool::enqueue(const Task& task) {
+    // Incrementing before pushing means a worker's wakeup predicate can never
+    // miss this call. At worst a worker briefly loops without finding it
+    // while we're still holding the queue's lock.
+    const size_t queue_depth =
+        num_queued_.fetch_add(1, std::memory_order_release) + 1;
+    {
+        // Only the active workers' queues receive new calls. A call can
+        // still race onto the queue of a worker that's just parking itself,
+        // but since workers scan all queues before parking and the active
+        // workers steal from every queue it will always get picked up.
+        const size_t num_active = std::min(
+            num_active_workers_.load(std::memory_order_relaxed),
+            worker_queues_.size());
+        const size_t worker_index =
+            next_worker_.fetch_add(1, std::memory_order_relaxed) % num_active;
+        WorkerQueue& worker_queue = *worker_queues_[worker_index];
+        std::lock_guard lock(worker_queue.mutex);
+        worker_queue.queue.push_back(task);
+    }
+    idle_cv_.notify_one();
+
+    // The queue depth at submission time is the pool's load signal. Like the
+    // load counters in `HostBridge`, the average only needs to be roughly
+    // right, so losing a concurrent sample now and then is fine.
+    const int64_t sample =
+        static_cast<int64_t>(queue_depth) * queue_depth_fp_one;
+    const int64_t previous =
+        queue_depth_ewma_fp_.load(std::memory_order_relaxed);
+    queue_depth_ewma_fp_.store(
+        previous == 0 ? sample : previous + (sample - previous) / 8,
+        std::memory_order_relaxed);
+
+    if (num_submissions_.fetch_add(1, std::memory_order_relaxed) %
+            target_update_interval ==
+        target_update_interval - 1) {
+        update_worker_target();
+    }
+}
+
+void AudioWorkerPool::update_worker_target() {
+    std::unique_lock lock(scaling_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    const size_t num_active =
+        num_active_workers_.load(std::memory_order_relaxed);
+    const int64_t queue_depth_fp =
+        queue_depth_ewma_fp_.load(std::memory_order_relaxed);
+    const auto now = std::chrono::steady_clock::now();
+
+    // Keeping a second worker around even when one could cope means a
+    // momentary load spike doesn't have to wait out the scale up cool-down
+    const size_t min_active_workers = std::min<size_t>(2, num_workers_);
+
+    if (num_active < num_workers_ &&
+        queue_depth_fp >
+            static_cast<int64_t>(num_active) * queue_depth_fp_one &&
+        now - last_target_change_ >= scale_up_cooldown) {
+        // Storing the new target under `idle_mutex_` means a worker that's
+        // just deciding to park can't miss the notification
+        {
+            std::lock_guard idle_lock(idle_mutex_);
+            num_active_workers_.store(num_active + 1,
+                                      std::memory_order_relaxed);
+        }
+        last_target_change_ = now;
+        unpark_cv_.notify_all();
+    } else if (num_active > min_active_workers &&
+               queue_depth_fp * 2 <
+                   static_cast<int64_t>(num_active - 1) * queue_depth_fp_one &&
+               now - last_target_change_ >= scale_down_cooldown) {
+        // The worker parks itself lazily the next time it runs out of work,
+        // so there's nothing to notify here
+        num_active_workers_.store(num_active - 1, std::memory_order_relaxed);
+        last_target_change_ = now;
+    }
+}
+
+void AudioWorkerPool::ensure_workers_started() {
+    std::call_once(workers_started_, [&]() {
+        worker_queues_.reserve(num_workers_);
+        worker_threads_.reserve(num_workers_);
+        for (size_t worker_index = 0; worker_index < num_workers_;
+             worker_index++) {
+            worker_queues_.emplace_back(std::make_unique<WorkerQueue>());
+        }
+        for (size_t worker_index = 0; worker_index < num_workers_;
+             worker_index++) {
+            worker_threads_.emplace_back(
+                [this, worker_index]() { worker_loop(worker_index); });
+        }
+
+        workers_ready_.store(true, std::memory_order_release);
+    });
+}
+
+void AudioWorkerPool::worker_loop(size_t worker_index) {
+    set_realtime_priority(true);
+    const ThreadRegistry::Guard thread_guard =
+        ThreadRegistry::instance().register_thread("audio-pool", worker_index);
+
+    // Most plugins will already enable FTZ, but there are a handful of
+    // plugins that don't that suffer from extreme DSP load increases when
+    // they start producing denormals. These threads only ever run plugin
+    // audio code, so the flag just stays enabled for the thread's lifetime.
+    ensure_flush_to_zero();
+
+    while (!shutdown_.load(std::memory_order_relaxed)) {
+        std::optional<Task> task{};
+
+        // The worker's own queue gets drained from the front first, and when
+        // it's empty we'll steal the oldest queued call from one of the other
+        // workers
+        {
+            WorkerQueue& own_queue = *worker_queues_[worker_index];
+            std::lock_guard lock(own_queue.mutex);
+            if (!own_queue.queue.empty()) {
+                task = own_queue.queue.front();
+                own_queue.queue.pop_front();
+            }
+        }
+        for (size_t offset = 1; !task && offset < worker_queues_.size();
+             offset++) {
+            WorkerQueue& other_queue =
+                *worker_queues_[(worker_index + offset) %
+                                worker_queues_.size()];
+            std::lock_guard lock(other_queue.mutex);
+            if (!other_queue.queue.empty()) {
+                task = other_queue.queue.back();
+                other_queue.queue.pop_back();
+            }
+        }
+
+        if (task) {
+            num_queued_.fetch_sub(1, std::memory_order_acquire);
+
+            task->invoke(task->context);
+
+            // Detached submissions have nobody to notify
+            if (task->completion_mutex) {
+                {
+                    std::lock_guard lock(*task->completion_mutex);
+                    *task->completed = true;
+                }
+                task->completion_cv->notify_one();
+            }
+            continue;
+        }
+
+        std::unique_lock lock(idle_mutex_);
+        if (worker_index >=
+            num_active_workers_.load(std::memory_order_relaxed)) {
+            // Workers beyond the active target park here, out of reach of
+            // `enqueue()`'s wakeups, until the target grows again. Parking
+            // is lazy: a worker that gets deactivated while it still has
+            // work, or that gets woken from `idle_cv_` right as the target
+            // drops, simply finishes what it can find first and only ends
+            // up here once all the queues are empty.
+            unpark_cv_.wait(lock, [&]() {
+                return shutdown_.load(std::memory_order_relaxed) ||
+                       worker_index < num_active_workers_.load(
+                                          std::memory_order_relaxed);
+            });
+            continue;
+        }
+
+        idle_cv_.wait(lock, [&]() {
+            return shutdown_.load(std::memory_order_relaxed) ||
+                   num_queued_.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
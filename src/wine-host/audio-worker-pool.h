@@ -0,0 +1,277 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * A process wide pool of audio worker threads with work stealing, used to
+ * avoid oversubscribing the CPU when a group host process hosts more plugins
+ * than the machine has physical cores. Every plugin instance has its own
+ * audio thread that blocks waiting for the native plugin's processing
+ * requests. Since DAWs call all instances within the same block window, a
+ * group of say 40 plugins would wake up 40 realtime threads at the start of
+ * every block and leave it to the kernel to sort out the resulting
+ * contention. With this pool the actual processing calls are handed off to a
+ * fixed set of workers sized to the machine's physical core count instead.
+ * Each worker has its own run queue, and idle workers steal queued requests
+ * from the other workers' queues so a couple of heavy instances can't stall
+ * the lighter ones behind them in a queue.
+ *
+ * The pool stays completely passive until the number of registered audio
+ * threads exceeds the worker count. Below that point `run()` executes the
+ * request directly on the calling thread, so individually hosted plugins and
+ * small groups behave exactly as before and the worker threads are never even
+ * spawned.
+ *
+ * Once spawned, the number of workers that actually take part in processing
+ * scales with the observed load. A group can host forty instances of which
+ * only a handful are currently producing audio, and waking a full machine's
+ * worth of workers for those would waste wakeups. The pool keeps a moving
+ * average of the queue depth seen at submission time and parks the workers
+ * beyond what that backlog justifies. Parked workers are excluded from
+ * `enqueue()`'s round robin and wakeups, and get unparked again when the
+ * backlog grows. Scaling up and down use separate thresholds and cool-down
+ * periods so the target doesn't thrash when the load hovers around a
+ * boundary.
+ */
+class AudioWorkerPool {
+   public:
+    /**
+     * The pool shared by all plugins hosted in this process. Workers are only
+     * spawned once the number of registered audio threads first exceeds the
+     * worker count.
+     */
+    static AudioWorkerPool& instance();
+
+    AudioWorkerPool(const AudioWorkerPool&) = delete;
+    AudioWorkerPool& operator=(const AudioWorkerPool&) = delete;
+
+    AudioWorkerPool(AudioWorkerPool&&) = delete;
+    AudioWorkerPool& operator=(AudioWorkerPool&&) = delete;
+
+    /**
+     * Registers the calling audio thread with the process wide pool for as
+     * long as the guard is alive. The number of registered audio threads
+     * determines whether `run()` executes processing calls directly or hands
+     * them off to the pool's workers.
+     */
+    class AudioThreadGuard {
+       public:
+        AudioThreadGuard() noexcept;
+        ~AudioThreadGuard() noexcept;
+
+        AudioThreadGuard(const AudioThreadGuard&) = delete;
+        AudioThreadGuard& operator=(const AudioThreadGuard&) = delete;
+
+        AudioThreadGuard(AudioThreadGuard&&) = delete;
+        AudioThreadGuard& operator=(AudioThreadGuard&&) = delete;
+    };
+
+    /**
+     * Run a processing call, either directly on the calling thread when the
+     * process hosts no more audio threads than the pool has workers, or on
+     * one of the pool's workers otherwise. Blocks until the call has
+     * finished. The callable lives on the caller's stack for the duration of
+     * the call, so this never allocates.
+     */
+    template <typename F>
+    void run(F&& fn) {
+        // The second check covers the short window where another audio thread
+        // has just pushed the count over the limit but is still busy spawning
+        // the workers
+        if (num_audio_threads_.load(std::memory_order_relaxed) <=
+                num_workers_ ||
+            !workers_ready_.load(std::memory_order_acquire)) {
+            fn();
+            return;
+        }
+
+        submit_and_wait(
+            [](void* context) {
+                (*static_cast<std::remove_reference_t<F>*>(context))();
+            },
+            &fn);
+    }
+
+    /**
+     * Queue a processing call on one of the workers without waiting for it
+     * to finish. Used by the gang dispatcher, which fans a whole block
+     * boundary's worth of processing calls out to the workers from a single
+     * thread and must not block on any one of them. Everything `context`
+     * points to has to stay alive until the call has run, and the workers
+     * must have been started through `ensure_workers_started()` beforehand.
+     */
+    void submit_detached(void (*invoke)(void* context), void* context);
+
+    /**
+     * Spawn the worker threads if that hasn't happened yet. Called when the
+     * number of registered audio threads first exceeds the worker count, and
+     * by the gang dispatcher, which always runs its processing calls on the
+     * workers.
+     */
+    void ensure_workers_started();
+
+   private:
+    AudioWorkerPool() noexcept;
+    ~AudioWorkerPool() noexcept;
+
+    /**
+     * A queued processing call. Everything this points to lives on the stack
+     * of the audio thread blocked in `submit_and_wait()`. For detached
+     * submissions the completion fields are null and the caller guarantees
+     * the context's lifetime instead.
+     */
+    struct Task {
+        void (*invoke)(void* context);
+        void* context;
+
+        std::mutex* completion_mutex;
+        std::condition_variable* completion_cv;
+        bool* completed;
+    };
+
+    /**
+     * A worker's run queue. The worker pops from the front, and idle workers
+     * steal from the back. These are heap allocated so the mutexes don't
+     * share cache lines between workers.
+     */
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> queue;
+    };
+
+    /**
+     * Push a type erased processing call onto one of the worker queues and
+     * block until a worker has finished executing it. Used by `run()` when
+     * the pool's capacity has been exceeded.
+     */
+    void submit_and_wait(void (*invoke)(void* context), void* context);
+
+    /**
+     * Push a task onto one of the worker queues and notify an idle worker.
+     * Shared by `submit_and_wait()` and `submit_detached()`.
+     */
+    void enqueue(const Task& task);
+
+    /**
+     * The worker thread entry point. Pops calls from the worker's own queue,
+     * steals from the other workers' queues when that queue is empty, and
+     * parks itself when there's no work anywhere. Workers within the active
+     * target park on `idle_cv_` where the next submission can wake them,
+     * workers beyond it park on `unpark_cv_` until the target grows again.
+     */
+    void worker_loop(size_t worker_index);
+
+    /**
+     * Recompute the number of active workers from the queue depth moving
+     * average. Called from `enqueue()` once every few submissions. The target
+     * grows by one worker when the average backlog exceeds the active worker
+     * count and shrinks by one when one fewer worker would still comfortably
+     * cover it, each direction with its own cool-down period so the target
+     * doesn't oscillate. Contention is resolved by simply skipping the
+     * update, so this never blocks the submitting audio thread.
+     */
+    void update_worker_target();
+
+    /**
+     * The number of workers that will be spawned, based on the machine's
+     * physical core count. Also the audio thread count above which `run()`
+     * starts handing calls off to the workers.
+     */
+    const size_t num_workers_;
+    /**
+     * The number of workers that currently take part in processing, between
+     * a small floor and `num_workers_`. Workers with an index at or above
+     * this target park themselves on `unpark_cv_` and are skipped by
+     * `enqueue()`'s round robin. Adjusted by `update_worker_target()`.
+     */
+    std::atomic_size_t num_active_workers_;
+
+    std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+    std::vector<Win32Thread> worker_threads_;
+    std::once_flag workers_started_;
+    /**
+     * Set once the workers have been spawned and the queues can be submitted
+     * to.
+     */
+    std::atomic_bool workers_ready_ = false;
+
+    /**
+     * The number of audio threads currently registered through
+     * `AudioThreadGuard`.
+     */
+    std::atomic_size_t num_audio_threads_ = 0;
+    /**
+     * Round robin counter used to spread submitted calls over the worker
+     * queues.
+     */
+    std::atomic_size_t next_worker_ = 0;
+    /**
+     * The number of queued calls that have not been picked up by a worker
+     * yet. Idle workers use this in their wakeup predicate so they never
+     * sleep while there's still work in some other worker's queue.
+     */
+    std::atomic_size_t num_queued_ = 0;
+
+    /**
+     * An exponentially weighted moving average of the queue depth sampled on
+     * every submission, in fixed point with eight fractional bits. This is
+     * the load signal `update_worker_target()` scales the active worker
+     * count by. Updated with plain read-modify-writes since concurrent
+     * submissions losing the occasional sample doesn't matter here.
+     */
+    std::atomic_int64_t queue_depth_ewma_fp_ = 0;
+    /**
+     * The total number of submitted calls, used to run
+     * `update_worker_target()` once every few submissions instead of on
+     * every single one.
+     */
+    std::atomic_size_t num_submissions_ = 0;
+
+    /**
+     * Serializes `update_worker_target()`. Only ever acquired with
+     * `try_lock()` so submitting audio threads skip the update instead of
+     * blocking on each other. Also guards `last_target_change_`.
+     */
+    std::mutex scaling_mutex_;
+    std::chrono::steady_clock::time_point last_target_change_{};
+
+    /**
+     * Idle workers within the active target wait on this. Submitting a call
+     * or shutting the pool down notifies it.
+     */
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    /**
+     * Workers beyond the active target wait on this (with `idle_mutex_`)
+     * instead, so submissions never wake them. Raising the target or
+     * shutting the pool down notifies it.
+     */
+    std::condition_variable unpark_cv_;
+
+    std::atomic_bool shutdown_ = false;
+};
@@ -17,6 +17,7 @@
 #include "host-proxy.h"
 
 #include "../../../common/serialization/clap/version.h"
+#include "../../clap-thread-pool.h"
 #include "../clap.h"
 
 // NOTE: The liberal use of `send_mutually_recursive_main_thread_message()` here
@@ -91,13 +92,43 @@ clap_host_proxy::clap_host_proxy(ClapBridge& bridge,
           .is_main_thread = ext_thread_check_is_main_thread,
           .is_audio_thread = ext_thread_check_is_audio_thread,
       }),
+      ext_thread_pool_vtable(clap_host_thread_pool_t{
+          .request_exec = ext_thread_pool_request_exec,
+      }),
       ext_timer_support_vtable(clap_host_timer_support_t{
           .register_timer = ext_timer_support_register_timer,
           .unregister_timer = ext_timer_support_unregister_timer,
       }),
       ext_voice_info_vtable(clap_host_voice_info_t{
           .changed = ext_voice_info_changed,
-      }) {}
+      }) {
+    // With the `notification_dedup_ms` option set, repeated identical change
+    // notifications collapse into a single forwarded message per window, see
+    // the rescan and latency callbacks below
+    if (bridge_.config_.notification_dedup_ms > 0) {
+        notification_dedup_.emplace(
+            bridge_.main_context_,
+            std::chrono::milliseconds(bridge_.config_.notification_dedup_ms));
+    }
+}
+
+/**
+ * Tags mixed into the `NotificationDeduplicator` keys so the callback types
+ * multiplexed through one deduplicator can't collide. The callback's rescan
+ * flags, if any, occupy the lower 32 bits of the key.
+ */
+enum class NotificationType : uint64_t {
+    request_restart = 1,
+    audio_ports_rescan = 2,
+    latency_changed = 3,
+    note_ports_rescan = 4,
+    params_rescan = 5,
+};
+
+static constexpr uint64_t notification_key(NotificationType type,
+                                           uint32_t flags = 0) noexcept {
+    return (static_cast<uint64_t>(type) << 32) | flags;
+}
 
 const void* CLAP_ABI
 clap_host_proxy::host_get_extension(const struct clap_host* host,
@@ -144,6 +175,11 @@ clap_host_proxy::host_get_extension(const struct clap_host* host,
     } else if (strcmp(extension_id, CLAP_EXT_THREAD_CHECK) == 0) {
         // This extension doesn't require any bridging
         extension_ptr = &self->ext_thread_check_vtable;
+    } else if (strcmp(extension_id, CLAP_EXT_THREAD_POOL) == 0) {
+        // This extension is implemented purely on the Wine side using our own
+        // worker pool, so it's available regardless of whether the native
+        // host has one
+        extension_ptr = &self->ext_thread_pool_vtable;
     } else if (self->supported_extensions_.supports_voice_info &&
                strcmp(extension_id, CLAP_EXT_VOICE_INFO) == 0) {
         extension_ptr = &self->ext_voice_info_vtable;
@@ -160,6 +196,19 @@ clap_host_proxy::host_request_restart(const struct clap_host* host) {
     assert(host && host->host_data);
     auto self = static_cast<const clap_host_proxy*>(host->host_data);
 
+    // Repeated restart requests within the deduplication window collapse
+    // into a single forwarded message, with the burst's trailing request
+    // resent once the window closes. See `NotificationDeduplicator`.
+    if (self->notification_dedup_ &&
+        !self->notification_dedup_->should_forward(
+            notification_key(NotificationType::request_restart), [self]() {
+                self->bridge_.send_mutually_recursive_main_thread_message(
+                    clap::host::RequestRestart{
+                        .owner_instance_id = self->owner_instance_id()});
+            })) {
+        return;
+    }
+
     self->bridge_.send_mutually_recursive_main_thread_message(
         clap::host::RequestRestart{.owner_instance_id =
                                        self->owner_instance_id()});
@@ -227,6 +276,20 @@ void CLAP_ABI clap_host_proxy::ext_audio_ports_rescan(const clap_host_t* host,
     assert(host && host->host_data);
     auto self = static_cast<const clap_host_proxy*>(host->host_data);
 
+    // Identical rescans within the deduplication window collapse into a
+    // single forwarded message, see `host_request_restart()`
+    if (self->notification_dedup_ &&
+        !self->notification_dedup_->should_forward(
+            notification_key(NotificationType::audio_ports_rescan, flags),
+            [self, flags]() {
+                self->bridge_.send_mutually_recursive_main_thread_message(
+                    clap::ext::audio_ports::host::Rescan{
+                        .owner_instance_id = self->owner_instance_id(),
+                        .flags = flags});
+            })) {
+        return;
+    }
+
     self->bridge_.send_mutually_recursive_main_thread_message(
         clap::ext::audio_ports::host::Rescan{
             .owner_instance_id = self->owner_instance_id(), .flags = flags});
@@ -323,6 +386,18 @@ void CLAP_ABI clap_host_proxy::ext_latency_changed(const clap_host_t* host) {
     assert(host && host->host_data);
     auto self = static_cast<const clap_host_proxy*>(host->host_data);
 
+    // Repeated latency change notifications within the deduplication window
+    // collapse into a single forwarded message, see `host_request_restart()`
+    if (self->notification_dedup_ &&
+        !self->notification_dedup_->should_forward(
+            notification_key(NotificationType::latency_changed), [self]() {
+                self->bridge_.send_mutually_recursive_main_thread_message(
+                    clap::ext::latency::host::Changed{
+                        .owner_instance_id = self->owner_instance_id()});
+            })) {
+        return;
+    }
+
     self->bridge_.send_mutually_recursive_main_thread_message(
         clap::ext::latency::host::Changed{.owner_instance_id =
                                               self->owner_instance_id()});
@@ -405,6 +480,20 @@ void CLAP_ABI clap_host_proxy::ext_note_ports_rescan(const clap_host_t* host,
     assert(host && host->host_data);
     auto self = static_cast<const clap_host_proxy*>(host->host_data);
 
+    // Identical rescans within the deduplication window collapse into a
+    // single forwarded message, see `host_request_restart()`
+    if (self->notification_dedup_ &&
+        !self->notification_dedup_->should_forward(
+            notification_key(NotificationType::note_ports_rescan, flags),
+            [self, flags]() {
+                self->bridge_.send_mutually_recursive_main_thread_message(
+                    clap::ext::note_ports::host::Rescan{
+                        .owner_instance_id = self->owner_instance_id(),
+                        .flags = flags});
+            })) {
+        return;
+    }
+
     self->bridge_.send_mutually_recursive_main_thread_message(
         clap::ext::note_ports::host::Rescan{
             .owner_instance_id = self->owner_instance_id(), .flags = flags});
@@ -416,6 +505,20 @@ clap_host_proxy::ext_params_rescan(const clap_host_t* host,
     assert(host && host->host_data);
     auto self = static_cast<const clap_host_proxy*>(host->host_data);
 
+    // Identical rescans within the deduplication window collapse into a
+    // single forwarded message, see `host_request_restart()`
+    if (self->notification_dedup_ &&
+        !self->notification_dedup_->should_forward(
+            notification_key(NotificationType::params_rescan, flags),
+            [self, flags]() {
+                self->bridge_.send_mutually_recursive_main_thread_message(
+                    clap::ext::params::host::Rescan{
+                        .owner_instance_id = self->owner_instance_id(),
+                        .flags = flags});
+            })) {
+        return;
+    }
+
     // NOTE: This one in particular needs the mutual recursion because Surge XT
     //       calls this function immediately when inserting, and when the host
     //       opens the GUI at the same time this would otherwise deadlock
@@ -553,6 +656,39 @@ clap_host_proxy::ext_thread_check_is_audio_thread(const clap_host_t* host) {
     return !self->bridge_.main_context_.is_gui_thread();
 }
 
+bool CLAP_ABI
+clap_host_proxy::ext_thread_pool_request_exec(const clap_host_t* host,
+                                              uint32_t num_tasks) {
+    assert(host && host->host_data);
+    auto self = static_cast<const clap_host_proxy*>(host->host_data);
+
+    // In case the plugin somehow does not implement the plugin side of the
+    // interface then it also can't get any host threads. Returning false
+    // makes the plugin run its tasks itself, just like it would under a host
+    // without a thread pool.
+    const auto& [instance, _] =
+        self->bridge_.get_instance(self->owner_instance_id());
+    const clap_plugin_thread_pool_t* thread_pool =
+        instance.extensions.thread_pool;
+    if (!thread_pool) {
+        return false;
+    }
+
+    // The tasks are fanned out over our own Wine side worker pool instead of
+    // being forwarded to the native host. Bridging this extension properly
+    // would require a socket round trip per task per audio buffer, which
+    // would be much slower than the single threaded fallback. This function
+    // is called from the audio thread during a process call, and it blocks
+    // until every task has finished like the extension requires.
+    const clap_plugin_t* plugin = instance.plugin.get();
+    ClapThreadPool::instance().run_tasks(
+        num_tasks, [plugin, thread_pool](uint32_t task_index) {
+            thread_pool->exec(plugin, task_index);
+        });
+
+    return true;
+}
+
 void CLAP_ABI clap_host_proxy::ext_voice_info_changed(const clap_host_t* host) {
     assert(host && host->host_data);
     auto self = static_cast<const clap_host_proxy*>(host->host_data);
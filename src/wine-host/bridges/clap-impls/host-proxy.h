@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <optional>
 
 #include <clap/ext/audio-ports-config.h>
 #include <clap/ext/audio-ports.h>
@@ -29,6 +30,7 @@
 #include <clap/ext/state.h>
 #include <clap/ext/tail.h>
 #include <clap/ext/thread-check.h>
+#include <clap/ext/thread-pool.h>
 #include <clap/ext/timer-support.h>
 #include <clap/ext/voice-info.h>
 #include <clap/host.h>
@@ -38,6 +40,7 @@
 #include <asio/steady_timer.hpp>
 
 #include "../../common/serialization/clap/factory/plugin-factory.h"
+#include "../../notification-dedup.h"
 
 // Forward declaration to avoid circular includes
 class ClapBridge;
@@ -151,6 +154,9 @@ class clap_host_proxy {
     static bool CLAP_ABI
     ext_thread_check_is_audio_thread(const clap_host_t* host);
 
+    static bool CLAP_ABI ext_thread_pool_request_exec(const clap_host_t* host,
+                                                      uint32_t num_tasks);
+
     static void CLAP_ABI ext_voice_info_changed(const clap_host_t* host);
 
    private:
@@ -189,6 +195,11 @@ class clap_host_proxy {
     const clap_host_tail_t ext_tail_vtable;
     // This is always available regardless of the proxied host
     const clap_host_thread_check_t ext_thread_check_vtable;
+    // This is always available regardless of the proxied host. The extension
+    // is implemented purely on the Wine side with a `ClapThreadPool`, since
+    // round-tripping every exec task to the native host would defeat the
+    // point of the extension.
+    const clap_host_thread_pool_t ext_thread_pool_vtable;
     // This is always available regardless of the proxied host
     const clap_host_timer_support_t ext_timer_support_vtable;
     const clap_host_voice_info_t ext_voice_info_vtable;
@@ -201,6 +212,14 @@ class clap_host_proxy {
      */
     std::atomic_bool has_pending_host_callbacks_ = false;
 
+    /**
+     * Collapses repeated identical change notifications (restart requests,
+     * rescans, latency changes) into one forwarded callback per window when
+     * the `notification_dedup_ms` option is set. Mutable because the host
+     * vtable's callbacks receive a const pointer to this proxy.
+     */
+    mutable std::optional<NotificationDeduplicator> notification_dedup_;
+
     /**
      * Any timers the plugin has registered through the `timer-support`
      * extension. The timers are registered on the `bridge_`'s IO context.
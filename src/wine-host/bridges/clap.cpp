@@ -24,6 +24,8 @@
 // Generated inside of the build directory
 #include <version.h>
 
+#include "../audio-worker-pool.h"
+
 namespace fs = ghc::filesystem;
 
 ClapPluginExtensions::ClapPluginExtensions(const clap_plugin& plugin) noexcept
@@ -47,6 +49,8 @@ ClapPluginExtensions::ClapPluginExtensions(const clap_plugin& plugin) noexcept
           plugin.get_extension(&plugin, CLAP_EXT_STATE))),
       tail(static_cast<const clap_plugin_tail_t*>(
           plugin.get_extension(&plugin, CLAP_EXT_TAIL))),
+      thread_pool(static_cast<const clap_plugin_thread_pool_t*>(
+          plugin.get_extension(&plugin, CLAP_EXT_THREAD_POOL))),
       timer_support(static_cast<const clap_plugin_timer_support_t*>(
           plugin.get_extension(&plugin, CLAP_EXT_TIMER_SUPPORT))),
       voice_info(static_cast<const clap_plugin_voice_info_t*>(
@@ -84,7 +88,7 @@ ClapBridge::ClapBridge(MainContext& main_context,
                        std::string plugin_dll_path,
                        std::string endpoint_base_dir,
                        pid_t parent_pid)
-    : HostBridge(main_context, plugin_dll_path, parent_pid),
+    : HostBridge(main_context, plugin_dll_path, endpoint_base_dir, parent_pid),
       logger_(generic_logger_),
       plugin_handle_(LoadLibrary(plugin_dll_path.c_str()), FreeLibrary),
       entry_(plugin_handle_
@@ -155,8 +159,47 @@ ClapBridge::ClapBridge(MainContext& main_context,
     config_ = sockets_.plugin_host_main_thread_callback_.send_message(
         WantsConfiguration{.host_version = yabridge_git_version}, std::nullopt);
 
+    // This side sends the host callbacks, so concurrent callbacks can be
+    // handled over pre-established spare connections when the `spare_sockets`
+    // option is set
+    sockets_.plugin_host_main_thread_callback_.set_spare_sockets(
+        config_.spare_sockets);
+
+    // Without an explicit `frame_rate` setting we'll pace the event loop to
+    // the display's actual refresh rate instead of assuming 60 fps
+    if (!config_.frame_rate) {
+        config_.frame_rate = detect_screen_refresh_rate(
+            *SharedX11Connection::get(main_context)->connection());
+    }
+
     // Allow this plugin to configure the main context's tick rate
     main_context.update_timer_interval(config_.event_loop_interval());
+
+    // Process wide resource limits requested through the `group_cpus`,
+    // `group_cpu_quota` and `group_memory_limit` options. These have to be
+    // applied before any worker threads get spawned so the affinity fallback
+    // gets inherited, and only the first loaded plugin's settings take
+    // effect since all plugins in a plugin group share this process.
+    if (config_.group_cpus || config_.group_cpu_quota > 0 ||
+        config_.group_memory_limit > 0) {
+        apply_process_resource_limits(
+            config_.group.value_or(plugin_path_.stem().string()),
+            config_.group_cpus, config_.group_cpu_quota,
+            config_.group_memory_limit);
+    }
+
+    // We're running on the main GUI thread here, so this pins the Win32
+    // message loop and all GUI work. Like the event loop interval this is
+    // shared by every plugin in a plugin group, so the last loaded plugin's
+    // setting wins. The NUMA node pinning has to happen before any worker
+    // threads get spawned so they inherit the affinity, and explicit
+    // `main_affinity`/`audio_affinity` lists still override it per thread.
+    if (config_.numa_node) {
+        set_numa_node_affinity(*config_.numa_node);
+    }
+    if (config_.main_affinity) {
+        set_cpu_affinity(*config_.main_affinity);
+    }
 }
 
 bool ClapBridge::inhibits_event_loop() noexcept {
@@ -339,31 +382,44 @@ void ClapBridge::run() {
                     })
                     .get();
             },
-            [&](const clap::ext::audio_ports::plugin::Count& request)
-                -> clap::ext::audio_ports::plugin::Count::Response {
+            [&](const clap::ext::audio_ports::plugin::GetPorts& request)
+                -> clap::ext::audio_ports::plugin::GetPorts::Response {
                 const auto& [instance, _] = get_instance(request.instance_id);
 
                 // We'll ignore the main thread requirement for simple array
-                // lookups to avoid the synchronisation costs in hot code paths
-                return instance.extensions.audio_ports->count(
-                    instance.plugin.get(), request.is_input);
-            },
-            [&](const clap::ext::audio_ports::plugin::Get& request)
-                -> clap::ext::audio_ports::plugin::Get::Response {
-                const auto& [instance, _] = get_instance(request.instance_id);
+                // lookups to avoid the synchronisation costs in hot code
+                // paths. Just like the parameter infos, the entire port
+                // layout is queried at once and then cached on the native
+                // side until the plugin asks for a rescan, since hosts tend
+                // to re-query it around every activation.
+                const auto query_ports = [&instance = instance](bool is_input) {
+                    const uint32_t num_ports =
+                        instance.extensions.audio_ports->count(
+                            instance.plugin.get(), is_input);
+
+                    std::vector<
+                        std::optional<clap::ext::audio_ports::AudioPortInfo>>
+                        ports;
+                    ports.reserve(num_ports);
+                    for (uint32_t i = 0; i < num_ports; i++) {
+                        // This should never fail, but we can't make things up
+                        // and we don't want to change port orders around so
+                        // we'll store a nullopt if the plugin returns an
+                        // error here
+                        clap_audio_port_info_t info{};
+                        if (instance.extensions.audio_ports->get(
+                                instance.plugin.get(), i, is_input, &info)) {
+                            ports.push_back(std::move(info));
+                        } else {
+                            ports.push_back(std::nullopt);
+                        }
+                    }
 
-                // We'll ignore the main thread requirement for simple array
-                // lookups to avoid the synchronisation costs in hot code paths
-                clap_audio_port_info_t info{};
-                if (instance.extensions.audio_ports->get(
-                        instance.plugin.get(), request.index, request.is_input,
-                        &info)) {
-                    return clap::ext::audio_ports::plugin::GetResponse{
-                        .result = info};
-                } else {
-                    return clap::ext::audio_ports::plugin::GetResponse{
-                        .result = std::nullopt};
-                }
+                    return ports;
+                };
+
+                return clap::ext::audio_ports::plugin::GetPortsResponse{
+                    .inputs = query_ports(true), .outputs = query_ports(false)};
             },
             [&](const clap::ext::audio_ports_config::plugin::Count& request)
                 -> clap::ext::audio_ports_config::plugin::Count::Response {
@@ -690,31 +746,42 @@ void ClapBridge::run() {
                         .result = std::nullopt};
                 }
             },
-            [&](const clap::ext::note_ports::plugin::Count& request)
-                -> clap::ext::note_ports::plugin::Count::Response {
+            [&](const clap::ext::note_ports::plugin::GetPorts& request)
+                -> clap::ext::note_ports::plugin::GetPorts::Response {
                 const auto& [instance, _] = get_instance(request.instance_id);
 
                 // We'll ignore the main thread requirement for simple array
-                // lookups to avoid the synchronisation costs in hot code paths
-                return instance.extensions.note_ports->count(
-                    instance.plugin.get(), request.is_input);
-            },
-            [&](const clap::ext::note_ports::plugin::Get& request)
-                -> clap::ext::note_ports::plugin::Get::Response {
-                const auto& [instance, _] = get_instance(request.instance_id);
+                // lookups to avoid the synchronisation costs in hot code
+                // paths. These are batched and cached on the native side
+                // exactly like the audio ports above.
+                const auto query_ports = [&instance = instance](bool is_input) {
+                    const uint32_t num_ports =
+                        instance.extensions.note_ports->count(
+                            instance.plugin.get(), is_input);
+
+                    std::vector<
+                        std::optional<clap::ext::note_ports::NotePortInfo>>
+                        ports;
+                    ports.reserve(num_ports);
+                    for (uint32_t i = 0; i < num_ports; i++) {
+                        // This should never fail, but we can't make things up
+                        // and we don't want to change port orders around so
+                        // we'll store a nullopt if the plugin returns an
+                        // error here
+                        clap_note_port_info_t info{};
+                        if (instance.extensions.note_ports->get(
+                                instance.plugin.get(), i, is_input, &info)) {
+                            ports.push_back(std::move(info));
+                        } else {
+                            ports.push_back(std::nullopt);
+                        }
+                    }
 
-                // We'll ignore the main thread requirement for simple array
-                // lookups to avoid the synchronisation costs in hot code paths
-                clap_note_port_info_t info{};
-                if (instance.extensions.note_ports->get(
-                        instance.plugin.get(), request.index, request.is_input,
-                        &info)) {
-                    return clap::ext::note_ports::plugin::GetResponse{.result =
-                                                                          info};
-                } else {
-                    return clap::ext::note_ports::plugin::GetResponse{
-                        .result = std::nullopt};
-                }
+                    return ports;
+                };
+
+                return clap::ext::note_ports::plugin::GetPortsResponse{
+                    .inputs = query_ports(true), .outputs = query_ports(false)};
             },
             [&](const clap::ext::params::plugin::GetInfos& request)
                 -> clap::ext::params::plugin::GetInfos::Response {
@@ -840,28 +907,71 @@ void ClapBridge::run() {
                 const auto& [instance, _] = get_instance(request.instance_id);
 
                 return main_context_
-                    .run_in_context([&, plugin = instance.plugin.get(),
-                                     state = instance.extensions.state]() {
-                        clap::stream::Stream stream{};
-                        if (state->save(plugin, stream.ostream())) {
-                            return clap::ext::state::plugin::SaveResponse{
-                                .result = std::move(stream)};
-                        } else {
+                    .run_in_context(
+                        [&, plugin = instance.plugin.get(),
+                         state = instance.extensions.state,
+                         &pending_saved_state = instance.pending_saved_state]()
+                            -> clap::ext::state::plugin::SaveResponse {
+                            clap::stream::Stream stream{};
+                            if (!state->save(plugin, stream.ostream())) {
+                                return clap::ext::state::plugin::SaveResponse{
+                                    .first_chunk = std::nullopt};
+                            }
+
+                            // Larger states are pulled chunk by chunk with
+                            // `SaveContinue` messages, so they never have to
+                            // pass through the sockets in one piece
+                            clap::stream::StreamChunk first_chunk =
+                                stream.take_chunk();
+                            if (!first_chunk.is_last) {
+                                pending_saved_state = std::move(stream);
+                            }
+
                             return clap::ext::state::plugin::SaveResponse{
-                                .result = std::nullopt};
-                        }
-                    })
+                                .first_chunk = std::move(first_chunk)};
+                        })
                     .get();
             },
+            [&](clap::ext::state::plugin::SaveContinue& request)
+                -> clap::ext::state::plugin::SaveContinue::Response {
+                const auto& [instance, _] = get_instance(request.instance_id);
+
+                // This just slices up the already saved state, so there's no
+                // need to involve the main thread here
+                assert(instance.pending_saved_state);
+                clap::stream::StreamChunk chunk =
+                    instance.pending_saved_state->take_chunk();
+                if (chunk.is_last) {
+                    instance.pending_saved_state.reset();
+                }
+
+                return chunk;
+            },
+            [&](clap::ext::state::plugin::LoadChunk& request)
+                -> clap::ext::state::plugin::LoadChunk::Response {
+                const auto& [instance, _] = get_instance(request.instance_id);
+
+                instance.incoming_state.append(request.data);
+
+                return Ack{};
+            },
             [&](clap::ext::state::plugin::Load& request)
                 -> clap::ext::state::plugin::Load::Response {
                 const auto& [instance, _] = get_instance(request.instance_id);
 
                 return main_context_
-                    .run_in_context([&, plugin = instance.plugin.get(),
-                                     state = instance.extensions.state]() {
-                        return state->load(plugin, request.stream.istream());
-                    })
+                    .run_in_context(
+                        [&, plugin = instance.plugin.get(),
+                         state = instance.extensions.state,
+                         &incoming_state = instance.incoming_state]() {
+                            incoming_state.append(request.data);
+
+                            const bool result =
+                                state->load(plugin, incoming_state.istream());
+                            incoming_state.clear();
+
+                            return result;
+                        })
                     .get();
             },
             [&](clap::ext::voice_info::plugin::Get& request)
@@ -946,11 +1056,14 @@ std::optional<AudioShmBuffer::Config> ClapBridge::setup_shared_audio_buffers(
     // space for double precision audio when the port supports it, and then
     // we'll simply only use the first half of that space if the host sends
     // 32-bit audio.
-    uint32_t current_offset = 0;
+    // The start of the shared memory object is reserved for the output event
+    // ring, so the audio channel offsets start after it
+    uint32_t current_offset =
+        ShmEventRing::region_size(clap::events::output_event_ring_capacity);
     auto create_bus_offsets = [&](bool is_input) {
         const uint32_t num_ports = audio_ports->count(plugin, is_input);
 
-        std::vector<std::vector<uint32_t>> offsets(num_ports);
+        AudioShmBuffer::BusOffsets offsets(num_ports);
         for (uint32_t port = 0; port < num_ports; port++) {
             clap_audio_port_info_t info{};
             assert(audio_ports->get(plugin, port, is_input, &info));
@@ -976,8 +1089,8 @@ std::optional<AudioShmBuffer::Config> ClapBridge::setup_shared_audio_buffers(
     // Creating the audio buffer offsets for every channel in every bus will
     // advance `current_offset` to keep pointing to the starting position for
     // the next channel
-    const auto input_bus_offsets = create_bus_offsets(true);
-    const auto output_bus_offsets = create_bus_offsets(false);
+    auto input_bus_offsets = create_bus_offsets(true);
+    auto output_bus_offsets = create_bus_offsets(false);
     const uint32_t buffer_size = current_offset;
 
     // If this function has been called previously and the size did not change,
@@ -994,14 +1107,25 @@ std::optional<AudioShmBuffer::Config> ClapBridge::setup_shared_audio_buffers(
         .name = sockets_.base_dir_.filename().string() + "-" +
                 std::to_string(instance_id),
         .size = buffer_size,
+        .huge_pages = config_.audio_huge_pages,
+        .numa_node = config_.numa_node ? static_cast<int32_t>(*config_.numa_node)
+                                       : -1,
         .input_offsets = std::move(input_bus_offsets),
-        .output_offsets = std::move(output_bus_offsets)};
+        .output_offsets = std::move(output_bus_offsets),
+        .event_offsets = {0}};
     if (!instance.process_buffers) {
         instance.process_buffers.emplace(buffer_config);
     } else {
         instance.process_buffers->resize(buffer_config);
     }
 
+    // The ring's positions live in the shared memory object itself, so we'll
+    // initialize them here before the native side attaches its own view. This
+    // also needs to happen after a resize since the mapping may have moved.
+    instance.output_event_ring.attach(
+        instance.process_buffers->event_area_ptr(0),
+        clap::events::output_event_ring_capacity, true);
+
     // After setting up the shared memory buffer, we need to create a vector of
     // channel audio pointers for every bus. These will then be assigned to the
     // `AudioBusBuffers` objects in the `ClapProcess` struct in
@@ -1009,8 +1133,8 @@ std::optional<AudioShmBuffer::Config> ClapBridge::setup_shared_audio_buffers(
     // data to `clap_plugin::process()`.
     auto set_port_pointers =
         [&]<std::invocable<uint32_t, uint32_t> F>(
-            std::vector<std::vector<void*>>& port_pointers,
-            const std::vector<std::vector<uint32_t>>& offsets,
+            AudioShmBuffer::BusPointers& port_pointers,
+            const AudioShmBuffer::BusOffsets& offsets,
             F&& get_channel_pointer) {
             port_pointers.resize(offsets.size());
             for (size_t port = 0; port < offsets.size(); port++) {
@@ -1064,13 +1188,23 @@ void ClapBridge::register_plugin_instance(
     object_instances_.at(instance_id)
         .audio_thread_handler = Win32Thread([&, instance_id]() {
         set_realtime_priority(true);
+        if (config_.audio_affinity) {
+            set_cpu_affinity(*config_.audio_affinity);
+        }
 
         // XXX: Like with VST2 worker threads, when using plugin groups the
         //      thread names from different plugins will clash. Not a huge
         //      deal probably, since duplicate thread names are still more
         //      useful than no thread names.
-        const std::string thread_name = "audio-" + std::to_string(instance_id);
-        pthread_setname_np(pthread_self(), thread_name.c_str());
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("audio", instance_id);
+
+        // When this process hosts more plugins than the machine has physical
+        // cores, the actual `process()` calls get handed off to the process
+        // wide worker pool so all those audio threads don't oversubscribe the
+        // CPU. Until that point the pool stays completely passive and
+        // `AudioWorkerPool::run()` just runs the call on this thread.
+        AudioWorkerPool::AudioThreadGuard audio_worker_guard{};
 
         sockets_.add_audio_thread_and_listen_control(
             instance_id, socket_listening_latch,
@@ -1112,21 +1246,16 @@ void ClapBridge::register_plugin_instance(
                     clap::plugin::Process& request = request_ref.get();
 
                     // As suggested by Jack Winter, we'll synchronize this
-                    // thread's audio processing priority with that of the
+                    // thread's scheduling parameters with those of the
                     // host's audio thread every once in a while
-                    if (request.new_realtime_priority) {
-                        set_realtime_priority(true,
-                                              *request.new_realtime_priority);
+                    if (request.new_realtime_parameters) {
+                        set_realtime_parameters(
+                            *request.new_realtime_parameters);
                     }
 
                     const auto& [instance, _] =
                         get_instance(request.instance_id);
 
-                    // Most plugins will already enable FTZ, but there are a
-                    // handful of plugins that don't that suffer from extreme
-                    // DSP load increases when they start producing denormals
-                    ScopedFlushToZero ftz_guard;
-
                     // The actual audio is stored in the shared memory
                     // buffers, so the reconstruction function will need to
                     // know where it should point the `AudioBusBuffers` to
@@ -1135,27 +1264,65 @@ void ClapBridge::register_plugin_instance(
                     //       thread while the plugin is in offline processing
                     //       mode. So as a precaution, we'll also do offline
                     //       processing for CLAP plugins on the GUI thread.
+                    //       The `offline_direct_processing` option skips this
+                    //       detour so consecutive offline blocks can be
+                    //       processed back-to-back on this thread.
                     clap_process_status result;
                     auto& reconstructed = request.process.reconstruct(
                         instance.process_buffers_input_pointers,
                         instance.process_buffers_output_pointers);
-                    if (instance.render_mode == CLAP_RENDER_OFFLINE) {
+                    if (instance.render_mode == CLAP_RENDER_OFFLINE &&
+                        !config_.offline_direct_processing) {
                         result =
                             main_context_
-                                .run_in_context([&instance = instance,
-                                                 &reconstructed]() {
+                                .run_in_context([&, &instance = instance]() {
+                                    ScopedLoadTimer load_timer(
+                                        *this, ScopedLoadTimer::Kind::audio);
+
+                                    // MXCSR is per thread, so FTZ has to be
+                                    // enabled on whichever thread ends up
+                                    // running the plugin's processing function
+                                    ensure_flush_to_zero();
+
                                     return instance.plugin->process(
                                         instance.plugin.get(), &reconstructed);
                                 })
                                 .get();
                     } else {
-                        result = instance.plugin->process(instance.plugin.get(),
-                                                          &reconstructed);
+                        AudioWorkerPool::instance().run([&]() {
+                            // Measured inside the lambda so the CPU time gets
+                            // sampled on the thread that runs the plugin's
+                            // processing function
+                            ScopedLoadTimer load_timer(
+                                *this, ScopedLoadTimer::Kind::audio);
+
+                            // Most plugins will already enable FTZ, but there
+                            // are a handful of plugins that don't that suffer
+                            // from extreme DSP load increases when they start
+                            // producing denormals. MXCSR is per thread, so
+                            // this has to happen on whichever thread ends up
+                            // running the plugin's processing function. In
+                            // steady state this is only a register read.
+                            ensure_flush_to_zero();
+
+                            result = instance.plugin->process(
+                                instance.plugin.get(), &reconstructed);
+                        });
+                    }
+
+                    // Output events that can be represented as plain structs
+                    // are pushed into the shared memory ring, so the response
+                    // only needs to serialize whatever's left (in practice
+                    // only SysEx events, or the overflow when the plugin
+                    // produced more events than the ring can hold)
+                    auto& response_data = request.process.create_response();
+                    if (instance.output_event_ring.attached()) {
+                        response_data.out_events->offload_prefix_to_ring(
+                            instance.output_event_ring);
                     }
 
                     return clap::plugin::ProcessResponse{
-                        .result = result,
-                        .output_data = request.process.create_response()};
+                        .result = result, .output_data = response_data};
                 },
                 [&](clap::ext::params::plugin::Flush& request)
                     -> clap::ext::params::plugin::Flush::Response {
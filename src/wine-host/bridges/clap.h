@@ -22,6 +22,7 @@
 #include <string>
 
 #include <clap/entry.h>
+#include <clap/ext/thread-pool.h>
 #include <clap/factory/plugin-factory.h>
 #include <clap/plugin.h>
 
@@ -76,6 +77,10 @@ struct ClapPluginExtensions {
     const clap_plugin_render_t* render = nullptr;
     const clap_plugin_state_t* state = nullptr;
     const clap_plugin_tail_t* tail = nullptr;
+    // Used for the thread-pool extension implementation purely on the Wine
+    // side, where `clap_host_thread_pool::request_exec()` fans the plugin's
+    // tasks out over a `ClapThreadPool`
+    const clap_plugin_thread_pool_t* thread_pool = nullptr;
     // Used for the timer-support extension implementation purely on the Wine
     // side
     const clap_plugin_timer_support_t* timer_support = nullptr;
@@ -127,13 +132,21 @@ struct ClapPluginInstance {
      */
     std::optional<AudioShmBuffer> process_buffers;
 
+    /**
+     * A view over the output event ring at the start of `process_buffers`.
+     * Output events produced by the plugin during processing get pushed here
+     * as raw event structs so they don't have to be serialized as part of the
+     * process response. Reattached whenever the buffers get (re)created.
+     */
+    ShmEventRing output_event_ring;
+
     /**
      * Pointers to the per-port input channels in process_buffers so we can pass
      * them to the plugin after a call to `ClapProcess::reconstruct()`. These
      * can be either `float*` or `double*` depending on the audio port's flags,
      * so we're using void pointers here.
      */
-    std::vector<std::vector<void*>> process_buffers_input_pointers;
+    AudioShmBuffer::BusPointers process_buffers_input_pointers;
 
     /**
      * Pointers to the per-port output channels in process_buffers so we can
@@ -141,13 +154,13 @@ struct ClapPluginInstance {
      * These can be either `float*` or `double*` depending on the audio port's
      * flags, so we're using void pointers here.
      */
-    std::vector<std::vector<void*>> process_buffers_output_pointers;
+    AudioShmBuffer::BusPointers process_buffers_output_pointers;
 
     /**
      * This instance's editor, if it has an open editor. Embedding here works
      * exactly the same as how it works for VST2 plugins.
      */
-    std::optional<Editor> editor;
+    EditorCache editor;
 
     /**
      * The plugin object. The plugin gets destroyed together with this struct.
@@ -175,6 +188,22 @@ struct ClapPluginInstance {
      * so we'll take precautions and also do this for CLAP.
      */
     clap_plugin_render_mode render_mode = CLAP_RENDER_REALTIME;
+
+    /**
+     * The remainder of a state stream produced by `clap_plugin_state::save()`
+     * that still has to be pulled by the native side through
+     * `clap::ext::state::plugin::SaveContinue` messages. Unset when no
+     * chunked save transfer is in progress.
+     */
+    std::optional<clap::stream::Stream> pending_saved_state;
+
+    /**
+     * State chunks received through `clap::ext::state::plugin::LoadChunk`
+     * messages. The final `Load` message appends its own chunk, passes the
+     * reassembled stream to `clap_plugin_state::load()`, and clears this
+     * buffer again.
+     */
+    clap::stream::Stream incoming_state;
 };
 
 /**
@@ -16,21 +16,26 @@
 
 #include "common.h"
 
+#include <time.h>
+
+#include <algorithm>
 #include <iostream>
 
 #include "../../common/process.h"
+#include "../../common/tracepoints.h"
 #include "../editor.h"
 
 /**
- * The maximum number of Win32 messages to handle per message loop. This is
- * needed because otherwise some plugins can run into an infinite loop. I've
- * observed this with:
+ * The maximum number of Win32 messages to handle in a single
+ * `handle_events()` batch before yielding back to the IO context. The per-tick
+ * budget in `HostBridge::default_message_budget` is needed because otherwise
+ * some plugins can run into an infinite loop. I've observed this with:
  *
  * - Waves plugins
  * - Melda plugins when having multiple editor windows open within a single
  *   plugin group
  */
-constexpr int max_win32_messages = 20;
+constexpr int max_win32_messages_per_batch = 20;
 
 /**
  * Some JUCE based plugins however send thousands of `WM_USER+123` events
@@ -50,27 +55,129 @@ constexpr unsigned int juce_message_id = WM_USER + 123;
 
 HostBridge::HostBridge(MainContext& main_context,
                        ghc::filesystem::path plugin_path,
+                       const std::string& endpoint_base_dir,
                        pid_t parent_pid)
     : plugin_path_(plugin_path),
       main_context_(main_context),
       generic_logger_(Logger::create_wine_stderr()),
       parent_pid_(parent_pid),
-      watchdog_guard_(main_context.register_watchdog(*this)) {}
+      watchdog_guard_(Watchdog::instance().register_watchdog(*this)),
+      heartbeat_(HeartbeatBuffer::name_for(ghc::filesystem::path(
+                                               endpoint_base_dir)
+                                               .filename()
+                                               .string()),
+                 false) {
+    if (heartbeat_.active()) {
+        heartbeat_guard_.emplace(main_context, heartbeat_.word());
+    }
+}
+
+/**
+ * The CPU time consumed so far by the calling thread. Unlike wall clock time
+ * this doesn't advance while the thread is blocked, so sampling it around a
+ * call into the plugin measures only the work actually done there.
+ */
+static std::chrono::nanoseconds current_thread_cpu_time() noexcept {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
 
-void HostBridge::handle_events() noexcept {
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+bool HostBridge::handle_events(int& message_budget) noexcept {
     MSG msg;
 
-    int limit = max_win32_messages;
-    for (int i = 0; i < limit && PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE);
-         i++) {
+    for (int i = 0; i < max_win32_messages_per_batch && message_budget > 0 &&
+                    PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE);
+         i++, message_budget--) {
         // HACK: See the docstring on `juce_win32_message_limit`
         if (msg.message == juce_message_id) {
-            limit = extended_max_win32_messages;
+            message_budget = extended_max_win32_messages;
         }
 
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
+
+    // The caller should keep running batches until either the queue is empty
+    // or this tick's budget has run out, with queued main thread work
+    // interleaved between the batches
+    return message_budget > 0 && PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE);
+}
+
+HostBridge::LoadStatistics HostBridge::load_statistics() const noexcept {
+    return LoadStatistics{
+        .audio_cpu_ns = audio_cpu_ns_.load(std::memory_order_relaxed),
+        .gui_cpu_ns = gui_cpu_ns_.load(std::memory_order_relaxed),
+        .process_call_count =
+            process_call_count_.load(std::memory_order_relaxed),
+        .process_call_ewma_ns =
+            process_call_ewma_ns_.load(std::memory_order_relaxed),
+        .event_count = event_count_.load(std::memory_order_relaxed),
+    };
+}
+
+HostBridge::ScopedLoadTimer::ScopedLoadTimer(HostBridge& bridge,
+                                             Kind kind) noexcept
+    : bridge_(bridge),
+      kind_(kind),
+      cpu_start_(current_thread_cpu_time()),
+      wall_start_(std::chrono::steady_clock::now()) {
+    // These timers already bracket the plugin's audio processing and
+    // dispatcher calls for all plugin formats, so with the `tracepoints`
+    // build option the USDT probes for those boundaries live here too. The
+    // bridge's address lets a tracer tell the instances in a plugin group
+    // apart.
+    switch (kind_) {
+        case Kind::audio:
+            YABRIDGE_PROBE1(process_start, &bridge_);
+            break;
+        case Kind::control:
+            YABRIDGE_PROBE1(dispatch_start, &bridge_);
+            break;
+    }
+}
+
+HostBridge::ScopedLoadTimer::~ScopedLoadTimer() noexcept {
+    const std::chrono::nanoseconds cpu_time =
+        current_thread_cpu_time() - cpu_start_;
+
+    switch (kind_) {
+        case Kind::audio:
+            YABRIDGE_PROBE1(process_end, &bridge_);
+            bridge_.record_process_call(
+                cpu_time, std::chrono::steady_clock::now() - wall_start_);
+            break;
+        case Kind::control:
+            YABRIDGE_PROBE1(dispatch_end, &bridge_);
+            bridge_.record_control_event(cpu_time);
+            break;
+    }
+}
+
+void HostBridge::record_process_call(std::chrono::nanoseconds cpu_time,
+                                     std::chrono::nanoseconds wall_time) noexcept {
+    audio_cpu_ns_.fetch_add(static_cast<uint64_t>(cpu_time.count()),
+                            std::memory_order_relaxed);
+    process_call_count_.fetch_add(1, std::memory_order_relaxed);
+
+    // Only one processing call runs at a time for a single instance, so a
+    // plain read-modify-write is fine here. The average uses an alpha of 1/8
+    // so a handful of large buffers after a period of inactivity quickly
+    // dominate it.
+    const int64_t previous = static_cast<int64_t>(
+        process_call_ewma_ns_.load(std::memory_order_relaxed));
+    const int64_t ewma = previous == 0
+                             ? wall_time.count()
+                             : previous + (wall_time.count() - previous) / 8;
+    process_call_ewma_ns_.store(static_cast<uint64_t>(std::max<int64_t>(ewma, 0)),
+                                std::memory_order_relaxed);
+}
+
+void HostBridge::record_control_event(std::chrono::nanoseconds cpu_time) noexcept {
+    gui_cpu_ns_.fetch_add(static_cast<uint64_t>(cpu_time.count()),
+                          std::memory_order_relaxed);
+    event_count_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void HostBridge::shutdown_if_dangling() {
@@ -78,8 +185,8 @@ void HostBridge::shutdown_if_dangling() {
     // outliving the process it's supposed to be connected to (because in some
     // situations sockets won't get closed when this happens so we'd hang on
     // `recv()`), then we'll close the sockets here so that the plugin bridge
-    // exits gracefully. This will be periodically called from `MainContext`'s
-    // watchdog thread.
+    // exits gracefully. This will be periodically called from the process wide
+    // `Watchdog`'s monitor thread.
     if (!pid_running(parent_pid_)) {
         std::cerr << "WARNING: The native plugin host seems to have died."
                   << std::endl;
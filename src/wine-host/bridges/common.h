@@ -18,8 +18,13 @@
 
 #include "../use-linux-asio.h"
 
+#include <atomic>
+#include <chrono>
+#include <optional>
+
 #include <ghc/filesystem.hpp>
 
+#include "../../common/audio-shm.h"
 #include "../../common/logging/common.h"
 #include "../utils.h"
 
@@ -34,6 +39,7 @@ class HostBridge {
    protected:
     HostBridge(MainContext& main_context,
                ghc::filesystem::path plugin_path,
+               const std::string& endpoint_base_dir,
                pid_t parent_pid);
 
    public:
@@ -67,14 +73,22 @@ class HostBridge {
     virtual void run() = 0;
 
     /**
-     * Run the message loop for this plugin. This should be called from a timer.
-     * X11 events for the open editors are also handled in this same way,
-     * because they are run from a Win32 timer. This lets us still process those
-     * events even when the Win32 event loop blocks the GUI thread. Since this
-     * function doesn't have any per-plugin behavior, only a single invocation
-     * of this is needed when hosting multiple plugins. This is run on a timer
-     * in the same IO context as the one that handles the events, i.e.
-     * `main_context_`.
+     * The number of Win32 messages `handle_events()` may dispatch per event
+     * loop tick before it stops and waits for the next tick. The budget gets
+     * raised when JUCE's message storms are detected, see the implementation
+     * for the details on both limits.
+     */
+    static constexpr int default_message_budget = 20;
+
+    /**
+     * Run one batch of the message loop for this plugin. This should be called
+     * from a timer. X11 events for the open editors are also handled in this
+     * same way, because they are run from a Win32 timer. This lets us still
+     * process those events even when the Win32 event loop blocks the GUI
+     * thread. Since this function doesn't have any per-plugin behavior, only a
+     * single invocation of this is needed when hosting multiple plugins. This
+     * is run on a timer in the same IO context as the one that handles the
+     * events, i.e. `main_context_`.
      *
      * Because of the way the Win32 API works we have to process events on the
      * same thread as the one the window was created on, and that thread is the
@@ -84,8 +98,24 @@ class HostBridge {
      * specific situation that can cause a race condition in some plugins
      * because of incorrect assumptions made by the plugin. See the dostring for
      * `Vst2Bridge::editor` for more information.
+     *
+     * Messages are dispatched in small batches so that dispatcher calls posted
+     * to the main IO context can interleave between the batches. Without this
+     * a plugin GUI flooding the message queue would delay every other plugin's
+     * main thread dispatch in a plugin group until the entire queue had been
+     * drained.
+     *
+     * @param message_budget The number of messages that may still be
+     *   dispatched during the current event loop tick. Callers should reset
+     *   this to `default_message_budget` at the start of every tick. This
+     *   function decrements it as it dispatches messages, and raises it once
+     *   when it detects a JUCE message storm.
+     *
+     * @return Whether messages are still pending and there's budget left. In
+     *   that case the caller should run another batch after giving queued main
+     *   thread tasks a chance to execute first.
      */
-    static void handle_events() noexcept;
+    static bool handle_events(int& message_budget) noexcept;
 
     /**
      * Used as part of the watchdog. This will check whether the remote host
@@ -95,6 +125,31 @@ class HostBridge {
      */
     void shutdown_if_dangling();
 
+    /**
+     * A snapshot of this instance's load counters. `GroupBridge` collects
+     * these for every hosted plugin to answer statistics queries made over
+     * the group socket, so a group host process's CPU usage can be attributed
+     * to individual plugin instances. All fields are running totals since the
+     * plugin was loaded, except for `process_call_ewma_ns` which is an
+     * exponentially weighted moving average over recent audio processing
+     * calls.
+     *
+     * @see GroupStatsResponse
+     */
+    struct LoadStatistics {
+        uint64_t audio_cpu_ns;
+        uint64_t gui_cpu_ns;
+        uint64_t process_call_count;
+        uint64_t process_call_ewma_ns;
+        uint64_t event_count;
+    };
+
+    /**
+     * Fetch the current values of this instance's load counters. This may be
+     * called from any thread.
+     */
+    LoadStatistics load_statistics() const noexcept;
+
     /**
      * The path to the .dll being loaded in the Wine plugin host.
      */
@@ -125,6 +180,59 @@ class HostBridge {
      */
     Logger generic_logger_;
 
+    /**
+     * An RAII guard that measures the calling thread's CPU time (and for
+     * audio, the wall clock duration) between its construction and
+     * destruction, and adds the result to the bridge's load counters. This
+     * should be constructed on the thread that actually runs the plugin's
+     * function so the CPU time gets attributed to the right instance, i.e.
+     * inside the lambda handed to the `AudioWorkerPool` rather than around
+     * it.
+     */
+    class ScopedLoadTimer {
+       public:
+        enum class Kind {
+            /**
+             * An audio processing call. Updates the audio CPU time, the
+             * process call count and the process call duration moving
+             * average.
+             */
+            audio,
+            /**
+             * A host-to-plugin dispatcher call. Updates the GUI/control CPU
+             * time and the event count.
+             */
+            control,
+        };
+
+        ScopedLoadTimer(HostBridge& bridge, Kind kind) noexcept;
+        ~ScopedLoadTimer() noexcept;
+
+        ScopedLoadTimer(const ScopedLoadTimer&) = delete;
+        ScopedLoadTimer& operator=(const ScopedLoadTimer&) = delete;
+
+       private:
+        HostBridge& bridge_;
+        Kind kind_;
+        std::chrono::nanoseconds cpu_start_;
+        std::chrono::steady_clock::time_point wall_start_;
+    };
+
+    /**
+     * Add one audio processing call to the load counters.
+     *
+     * @see ScopedLoadTimer
+     */
+    void record_process_call(std::chrono::nanoseconds cpu_time,
+                             std::chrono::nanoseconds wall_time) noexcept;
+
+    /**
+     * Add one host-to-plugin dispatcher call to the load counters.
+     *
+     * @see ScopedLoadTimer
+     */
+    void record_control_event(std::chrono::nanoseconds cpu_time) noexcept;
+
    private:
     /**
      * The process ID of the native plugin host we are bridging for. This should
@@ -139,5 +247,27 @@ class HostBridge {
      * A guard that, while in scope, will cause `shutdown_if_dangling()` to
      * periodically be called.
      */
-    MainContext::WatchdogGuard watchdog_guard_;
+    Watchdog::Guard watchdog_guard_;
+
+    /**
+     * The heartbeat word shared with the native plugin for this instance.
+     * The guard below has `main_context_`'s event loop bump the word every
+     * tick, so the native side can detect a stuck GUI thread with a single
+     * atomic load instead of a blocking socket timeout. The native side
+     * creates the object, so when it can't be opened, for instance because
+     * the two sides run different yabridge versions, this stays inactive.
+     */
+    HeartbeatBuffer heartbeat_;
+    std::optional<MainContext::HeartbeatGuard> heartbeat_guard_;
+
+    /**
+     * The load counters behind `load_statistics()`. These are updated with
+     * relaxed atomics since they're only ever read for diagnostics, and
+     * exactness doesn't matter there.
+     */
+    std::atomic<uint64_t> audio_cpu_ns_ = 0;
+    std::atomic<uint64_t> gui_cpu_ns_ = 0;
+    std::atomic<uint64_t> process_call_count_ = 0;
+    std::atomic<uint64_t> process_call_ewma_ns_ = 0;
+    std::atomic<uint64_t> event_count_ = 0;
 };
@@ -19,9 +19,16 @@
 #include "../use-linux-asio.h"
 
 #include <unistd.h>
+#include <cassert>
+#include <fstream>
 #include <regex>
+#include <string_view>
+#include <vector>
 
 #include "../../common/communication/common.h"
+#include "../../common/process.h"
+#include "../../common/startup-trace.h"
+#include "../preload-cache.h"
 #ifdef WITH_CLAP
 #include "clap.h"
 #endif
@@ -61,6 +68,21 @@ asio::local::stream_protocol::acceptor create_acceptor_if_inactive(
  */
 std::string create_logger_prefix(const fs::path& socket_path);
 
+/**
+ * The maximum number of additional event loop threads plugins get sharded
+ * across. Shard 0 is the process's main thread, so the total number of event
+ * loop threads is one more than this.
+ */
+constexpr size_t max_event_loop_shards = 3;
+
+/**
+ * The number of plugins a single event loop thread gets to tick before new
+ * plugins spill over into the next shard. With the cap above a very large
+ * group will still go past this number per thread, but by then the load is at
+ * least spread evenly.
+ */
+constexpr size_t max_plugins_per_event_loop = 8;
+
 StdIoCapture::StdIoCapture(asio::io_context& io_context, int file_descriptor)
     : pipe_(io_context),
       target_fd_(file_descriptor),
@@ -88,18 +110,35 @@ StdIoCapture::~StdIoCapture() noexcept {
     close(pipe_fd_[0]);
 }
 
-GroupBridge::GroupBridge(ghc::filesystem::path group_socket_path)
+GroupBridge::GroupBridge(ghc::filesystem::path group_socket_path,
+                         std::optional<pid_t> warm_parent_pid,
+                         bool daemon,
+                         bool trusted)
     : logger_(Logger::create_from_environment(
           create_logger_prefix(group_socket_path))),
       main_context_(),
       stdio_context_(),
       stdout_redirect_(stdio_context_, STDOUT_FILENO),
       stderr_redirect_(stdio_context_, STDERR_FILENO),
+      warm_parent_pid_(warm_parent_pid),
+      daemon_(daemon),
+      trusted_(trusted),
       group_socket_endpoint_(group_socket_path.string()),
       group_socket_acceptor_(
           create_acceptor_if_inactive(main_context_.context_,
                                       group_socket_endpoint_)),
-      shutdown_timer_(main_context_.context_) {
+      shutdown_timer_(main_context_.context_),
+      warm_watchdog_timer_(main_context_.context_),
+      io_advisor_timer_(main_context_.context_),
+      session_prefetcher_(group_socket_path) {
+    // Trusted groups rely on the passive shared memory heartbeat instead of
+    // the watchdog's active process liveness sweeps. This has to happen
+    // before the first plugin gets hosted, since the bridges register
+    // themselves with the watchdog in their constructors.
+    if (trusted_) {
+        Watchdog::instance().disable_for_trusted_group();
+    }
+
     // Write this process's original STDOUT and STDERR streams to the logger
     logger_.async_log_pipe_lines(stdout_redirect_.pipe_, stdout_buffer_,
                                  "[STDOUT] ");
@@ -107,7 +146,8 @@ GroupBridge::GroupBridge(ghc::filesystem::path group_socket_path)
                                  "[STDERR] ");
 
     stdio_handler_ = Win32Thread([&]() {
-        pthread_setname_np(pthread_self(), "group-stdio");
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("group-stdio");
 
         stdio_context_.run();
     });
@@ -117,17 +157,27 @@ GroupBridge::~GroupBridge() noexcept {
     // Our fancy `Vst2Sockets` and `Vst3Sockets` clean up after themselves, but
     // here we need to do it manually
     // TODO: Encapsulate this, destructors are evil
-    fs::remove(group_socket_endpoint_.path());
+    //
+    // A claimed warm host already removed its socket file when it was claimed,
+    // and a replacement warm host may have bound a new socket on the same path
+    // since then, so in that case the file should be left alone
+    if (!warm_claimed_) {
+        fs::remove(group_socket_endpoint_.path());
+    }
 
     stdio_context_.stop();
 }
 
-bool GroupBridge::is_event_loop_inhibited() noexcept {
+bool GroupBridge::is_event_loop_inhibited(size_t shard) noexcept {
     std::lock_guard lock(active_plugins_mutex_);
 
-    for (auto& [parameters, value] : active_plugins_) {
-        auto& [thread, bridge] = value;
-        if (bridge->inhibits_event_loop()) {
+    for (auto& [plugin_id, plugin] : active_plugins_) {
+        // Plugins that are still being prefetched on their worker thread
+        // don't have a bridge yet. Those can't interact with the message loop
+        // until their initialization gets run on their shard's thread, so they
+        // don't need to inhibit the event loop for the already active plugins.
+        if (plugin.shard == shard && plugin.bridge &&
+            plugin.bridge->inhibits_event_loop()) {
             return true;
         }
     }
@@ -146,12 +196,17 @@ void GroupBridge::handle_plugin_run(size_t plugin_id, HostBridge* bridge) {
     logger_.log("'" + plugin_path + "' has exited");
 
     // After the plugin has exited we'll remove this thread's plugin from the
-    // active plugins. This is done within the IO context because the call to
-    // `FreeLibrary()` has to be done from the main thread, or else we'll
-    // potentially corrupt our heap. This way we can also properly join the
-    // thread again. If no active plugins remain, then we'll terminate the
-    // process.
-    main_context_.schedule_task([this, plugin_id]() {
+    // active plugins. This is done within the plugin's own shard's IO context
+    // because the call to `FreeLibrary()` has to be done from the thread that
+    // loaded the library, or else we'll potentially corrupt our heap. This
+    // way we can also properly join the thread again. If no active plugins
+    // remain, then we'll terminate the process.
+    size_t shard;
+    {
+        std::lock_guard lock(active_plugins_mutex_);
+        shard = active_plugins_.at(plugin_id).shard;
+    }
+    shard_context(shard).schedule_task([this, plugin_id]() {
         std::lock_guard lock(active_plugins_mutex_);
 
         // The join is implicit because we're using Win32Thread (which mimics
@@ -166,14 +221,36 @@ void GroupBridge::handle_plugin_run(size_t plugin_id, HostBridge* bridge) {
 
 void GroupBridge::handle_incoming_connections() {
     accept_requests();
-    async_handle_events();
+    async_handle_events(main_context_, 0);
+    schedule_io_advisory_scan();
 
-    // If we don't get a request to host a plugin within five seconds, we'll
-    // shut the process down again.
-    maybe_schedule_shutdown(5s);
+    if (trusted_) {
+        logger_.log(
+            "This group is marked as trusted, so the process watchdog is "
+            "disabled and the passive heartbeat is the only liveness signal");
+    }
+
+    if (warm_parent_pid_) {
+        // Warm host processes keep waiting until they get claimed, but they do
+        // need to shut down again when the native host that spawned the pool
+        // exits before that happens
+        schedule_warm_watchdog();
+
+        logger_.log("Warm host is up and running, waiting to be claimed");
+    } else if (daemon_) {
+        logger_.log(
+            "Group host is up and running as a daemon, now accepting "
+            "incoming connections");
+    } else {
+        // If we don't get a request to host a plugin within five seconds,
+        // we'll shut the process down again.
+        maybe_schedule_shutdown(5s);
+
+        logger_.log(
+            "Group host is up and running, now accepting incoming "
+            "connections");
+    }
 
-    logger_.log(
-        "Group host is up and running, now accepting incoming connections");
     main_context_.run();
 }
 
@@ -197,97 +274,360 @@ void GroupBridge::accept_requests() {
             // yabridge plugin will be able to tell if the plugin has caused
             // this process to crash during its initialization to prevent
             // waiting indefinitely on the sockets to be connected to.
-            const auto request = read_object<HostRequest>(socket);
-            write_object(socket, HostResponse{.pid = getpid()});
+            HostRequest request;
+            try {
+                request = read_object<HostRequest>(socket);
+
+                // Requests with an unknown plugin type are load statistics
+                // queries made through `yabridge-host.exe stats <socket>`.
+                // These get answered immediately and don't affect the hosted
+                // plugins or this process's lifecycle in any way.
+                if (request.plugin_type == PluginType::unknown) {
+                    write_object(socket, collect_statistics());
+
+                    accept_requests();
+                    return;
+                }
+
+                write_object(socket, HostResponse{.pid = getpid()});
+            } catch (const std::system_error& error) {
+                // The other side may disappear between connecting and sending
+                // its request, for instance when the native host gets killed
+                // at just the wrong moment. That shouldn't bring down the
+                // plugins already running in this process, or an unclaimed
+                // warm host.
+                logger_.log("Error while reading an incoming host request:");
+                logger_.log(error.what());
+
+                accept_requests();
+                return;
+            }
+
+            // A request that names a bitbridge host binary is for a 32-bit
+            // plugin. Those can't be loaded into this process, so they get
+            // handed over to a companion 32-bit group host process instead.
+            // Spawning that process involves booting Wine, so the forwarding
+            // runs on its own thread to keep this acceptor and the already
+            // hosted plugins' event loops responsive. Warm hosts never
+            // receive these requests since the warm pool uses per
+            // architecture host processes.
+            if (!request.bitbridge_host_path.empty()) {
+                logger_.log("Received request to host 32-bit " +
+                            plugin_type_to_string(request.plugin_type) +
+                            " plugin at '" + request.plugin_path +
+                            "', delegating it to the companion 32-bit group "
+                            "host process");
+
+                shutdown_timer_.cancel();
+                delegation_threads_.push_back(Win32Thread([this, request]() {
+                    const ThreadRegistry::Guard thread_guard =
+                        ThreadRegistry::instance().register_thread("delegate");
+
+                    delegate_to_bitbridge_host(request);
+
+                    // Delegated plugins don't keep this process alive. The
+                    // companion process manages its own lifecycle just like
+                    // any other group host, so it keeps running for as long
+                    // as it's hosting plugins.
+                    maybe_schedule_shutdown(4s);
+                }));
+
+                accept_requests();
+                return;
+            }
+
+            if (warm_parent_pid_) {
+                // Warm host processes host exactly one plugin. Closing the
+                // acceptor and removing the socket file frees up the pool slot
+                // so the claiming yabridge instance can spawn a replacement
+                // warm host that listens on the same path.
+                warm_claimed_ = true;
+                warm_watchdog_timer_.cancel();
+
+                std::error_code err;
+                group_socket_acceptor_.close(err);
+                fs::remove(group_socket_endpoint_.path(), err);
+            }
 
-            // The plugin has to be initiated on the IO context's thread because
-            // this has to be done on the same thread that's handling messages,
-            // and all window messages have to be handled from the same thread.
             logger_.log("Received request to host " +
                         plugin_type_to_string(request.plugin_type) +
                         " plugin at '" + request.plugin_path +
                         "' using socket endpoint base directory '" +
                         request.endpoint_base_dir + "'");
-            try {
-                // Cancel the (initial) shutdown timer, since the plugin may
-                // take longer to initialize if it is new
-                shutdown_timer_.cancel();
 
-                std::unique_ptr<HostBridge> bridge = nullptr;
-                switch (request.plugin_type) {
-                    case PluginType::clap:
+            // Cancel the (initial) shutdown timer, since the plugin may take
+            // longer to initialize if it is new
+            shutdown_timer_.cancel();
+
+            // The plugin itself has to be initiated on its event loop
+            // shard's thread because this has to be done on the same thread
+            // that's handling its messages, and all window messages have to
+            // be handled from the thread that created the window. That part
+            // cannot be parallelized, but the most time consuming part of
+            // loading a cold session is usually just reading the plugin
+            // binaries from disk. So we'll hand the request over to the
+            // plugin's worker thread right away, that thread first prefetches
+            // the binaries (in parallel, when multiple plugins are loading at
+            // the same time), and only the actual initialization gets
+            // funneled to the shard's thread. The map entry gets a null
+            // bridge pointer until that happens, which also keeps the idle
+            // shutdown timer from firing while plugins are still being
+            // prefetched.
+            const size_t plugin_id = next_plugin_id_.fetch_add(1);
+            const size_t shard = assign_event_loop_shard();
+            active_plugins_[plugin_id] = ActivePlugin{
+                .thread = Win32Thread([this, plugin_id, shard, request]() {
+                    const ThreadRegistry::Guard thread_guard =
+                        ThreadRegistry::instance().register_thread(
+                            "worker", plugin_id);
+
+                    // Next to the plugin's own binaries, the dependencies
+                    // recorded during earlier loads of this plugin also get
+                    // prefetched so the loader doesn't have to wait for them
+                    ModulePreloader module_preloader(request.plugin_path);
+                    prefetch_plugin_library(request.plugin_path);
+
+                    // A warm host only ever hosts this one plugin, but in a
+                    // group the plugins that followed this one in earlier
+                    // sessions can already be read from disk while this
+                    // plugin initializes and restores its state
+                    if (!warm_parent_pid_) {
+                        session_prefetcher_.plugin_requested(
+                            request.plugin_path);
+                    }
+
+                    MainContext& context = shard_context(shard);
+                    HostBridge* plugin_ptr = nullptr;
+                    try {
+                        std::unique_ptr<HostBridge> bridge =
+                            context
+                                .run_in_context([&]() {
+                                    return create_bridge(request, context);
+                                })
+                                .get();
+                        plugin_ptr = bridge.get();
+
+                        {
+                            std::lock_guard lock(active_plugins_mutex_);
+                            active_plugins_[plugin_id].bridge =
+                                std::move(bridge);
+                        }
+
+                        logger_.log("Finished initializing '" +
+                                    request.plugin_path + "'");
+                        startup_trace_event("wine-host-plugin-initialized");
+
+                        module_preloader.record_loaded_modules();
+                    } catch (const std::exception& error) {
+                        logger_.log("Error while initializing '" +
+                                    request.plugin_path + "':");
+                        logger_.log(error.what());
+
+                        // The thread can't join itself, so like in
+                        // `handle_plugin_run()` the map entry gets removed
+                        // from the shard's IO context
+                        context.schedule_task([this, plugin_id]() {
+                            std::lock_guard lock(active_plugins_mutex_);
+
+                            active_plugins_.erase(plugin_id);
+                        });
+
+                        maybe_schedule_shutdown(5s);
+                        return;
+                    }
+
+                    // Listen for dispatcher events sent to the plugin's
+                    // socket on this thread. Parts of the actual event
+                    // handling will still be posted to the main IO context so
+                    // that any events that potentially interact with the
+                    // Win32 message loop are handled from the main thread. We
+                    // keep using the raw pointer so we don't have to
+                    // immediately look the instance up in the map again, as
+                    // this could otherwise result in a deadlock when using
+                    // the Spitfire plugins. Those will block the message loop
+                    // until `effOpen()` has been called and would thus
+                    // prevent this lock from happening.
+                    handle_plugin_run(plugin_id, plugin_ptr);
+                }),
+                .bridge = nullptr,
+                .shard = shard};
+
+            if (!warm_parent_pid_) {
+                accept_requests();
+            }
+        });
+}
+
+std::unique_ptr<HostBridge> GroupBridge::create_bridge(
+    const HostRequest& request,
+    MainContext& context) {
+    switch (request.plugin_type) {
+        case PluginType::clap:
 #ifdef WITH_CLAP
-                        bridge = std::make_unique<ClapBridge>(
-                            main_context_, request.plugin_path,
-                            request.endpoint_base_dir, request.parent_pid);
+            return std::make_unique<ClapBridge>(
+                context, request.plugin_path, request.endpoint_base_dir,
+                request.parent_pid);
 #else
-                        throw std::runtime_error(
-                            "This version of yabridge has not been compiled "
-                            "with CLAP support");
+            throw std::runtime_error(
+                "This version of yabridge has not been compiled with CLAP "
+                "support");
 #endif
-                        break;
-                    case PluginType::vst2:
-                        bridge = std::make_unique<Vst2Bridge>(
-                            main_context_, request.plugin_path,
-                            request.endpoint_base_dir, request.parent_pid);
-                        break;
-                    case PluginType::vst3:
+        case PluginType::vst2:
+            return std::make_unique<Vst2Bridge>(
+                context, request.plugin_path, request.endpoint_base_dir,
+                request.parent_pid);
+        case PluginType::vst3:
 #ifdef WITH_VST3
-                        bridge = std::make_unique<Vst3Bridge>(
-                            main_context_, request.plugin_path,
-                            request.endpoint_base_dir, request.parent_pid);
+            return std::make_unique<Vst3Bridge>(
+                context, request.plugin_path, request.endpoint_base_dir,
+                request.parent_pid);
 #else
-                        throw std::runtime_error(
-                            "This version of yabridge has not been compiled "
-                            "with VST3 support");
+            throw std::runtime_error(
+                "This version of yabridge has not been compiled with VST3 "
+                "support");
 #endif
-                        break;
-                    case PluginType::unknown:
-                        throw std::runtime_error(
-                            "Invalid plugin host request received, how did you "
-                            "even manage to do this?");
-                        break;
-                }
+        case PluginType::unknown:
+        default:
+            throw std::runtime_error(
+                "Invalid plugin host request received, how did you even "
+                "manage to do this?");
+    }
+}
 
-                logger_.log("Finished initializing '" + request.plugin_path +
-                            "'");
-
-                // Start listening for dispatcher events sent to the plugin's
-                // socket on another thread. Parts of the actual event handling
-                // will still be posted to this IO context so that any events
-                // that potentially interact with the Win32 message loop are
-                // handled from the main thread. We also pass a raw pointer to
-                // the plugin so we don't have to immediately look the instance
-                // up in the map again, as this would require us to immediately
-                // lock the map again. This could otherwise result in a deadlock
-                // when using the Spitfire plugins, as they will block the
-                // message loop until `effOpen()` has been called and thus
-                // prevent this lock from happening.
-                const size_t plugin_id = next_plugin_id_.fetch_add(1);
-                active_plugins_[plugin_id] = std::pair(
-                    Win32Thread([this, plugin_id, plugin_ptr = bridge.get()]() {
-                        const std::string thread_name =
-                            "worker-" + std::to_string(plugin_id);
-                        pthread_setname_np(pthread_self(), thread_name.c_str());
-
-                        handle_plugin_run(plugin_id, plugin_ptr);
-                    }),
-                    std::move(bridge));
-            } catch (const std::exception& error) {
-                logger_.log("Error while initializing '" + request.plugin_path +
-                            "':");
-                logger_.log(error.what());
+void GroupBridge::delegate_to_bitbridge_host(const HostRequest& request) {
+    // The companion process listens on the socket path a 32-bit group with
+    // this group's name would use, which is simply this group's own socket
+    // path with the architecture suffix swapped out. See
+    // `generate_group_endpoint()` on the plugin side.
+    const std::string own_socket_path = group_socket_endpoint_.path();
+    constexpr std::string_view own_suffix = "-x64.sock";
+    assert(own_socket_path.ends_with(own_suffix));
+    const std::string companion_socket_path =
+        own_socket_path.substr(0, own_socket_path.size() - own_suffix.size()) +
+        "-x32.sock";
+
+    // The companion process hosts the plugin itself, so the forwarded
+    // request shouldn't name a bitbridge host binary again or the companion
+    // would in turn try to delegate it
+    HostRequest companion_request = request;
+    companion_request.bitbridge_host_path.clear();
+
+    const auto forward = [&]() {
+        asio::local::stream_protocol::socket companion_socket(
+            main_context_.context_);
+        companion_socket.connect(companion_socket_path);
+
+        write_object(companion_socket, companion_request);
+        const auto response = read_object<HostResponse>(companion_socket);
+        assert(response.pid > 0);
+    };
+
+    // An already running companion process can accept the plugin right away
+    try {
+        forward();
+        return;
+    } catch (const std::system_error&) {
+    }
 
-                maybe_schedule_shutdown(5s);
-            }
+    // Otherwise we'll spawn one, the same way the native plugin spawned this
+    // process. The companion may well outlive this process, so just like
+    // with the warm host processes its output goes to a log file next to its
+    // socket and the handle gets detached.
+    Process companion(request.bitbridge_host_path);
+    companion.arg("group").arg(companion_socket_path);
+    if (daemon_) {
+        companion.arg("daemon");
+    }
+    if (trusted_) {
+        companion.arg("trusted");
+    }
+
+    fs::path companion_log_path = companion_socket_path;
+    companion_log_path.replace_extension(".log");
+
+    auto spawn_result = companion.spawn_child_redirected(companion_log_path);
+    std::optional<Process::Handle> companion_handle{};
+    std::visit(
+        overload{
+            [&](Process::Handle& handle) {
+                handle.detach();
+                companion_handle.emplace(std::move(handle));
+            },
+            [&](const Process::CommandNotFound&) {
+                logger_.log("Could not spawn '" +
+                            request.bitbridge_host_path +
+                            "', command not found");
+            },
+            [&](const std::error_code& err) {
+                logger_.log(
+                    "Error spawning the companion 32-bit group host "
+                    "process: " +
+                    err.message());
+            },
+        },
+        spawn_result);
+    if (!companion_handle) {
+        return;
+    }
+
+    // Now keep trying to hand the plugin over to the companion we just
+    // spawned, exactly like the plugin side does after spawning a group host
+    // process
+    while (companion_handle->running()) {
+        std::this_thread::sleep_for(20ms);
+
+        try {
+            forward();
+            return;
+        } catch (const std::system_error&) {
+            // Keep trying until the companion either starts accepting
+            // requests or exits
+        }
+    }
+
+    // When the companion exits before accepting our request it either ran
+    // into an error, or two plugins got delegated at the same time and this
+    // thread's companion lost the race to listen on the socket. For the
+    // latter case we'll try to connect one more time.
+    try {
+        forward();
+    } catch (const std::system_error& error) {
+        logger_.log("Could not hand '" + request.plugin_path +
+                    "' over to the companion 32-bit group host process:");
+        logger_.log(error.what());
+    }
+}
+
+GroupStatsResponse GroupBridge::collect_statistics() noexcept {
+    GroupStatsResponse response{.pid = getpid(), .instances = {}};
+    response.instances.reserve(active_plugins_.size());
 
-            accept_requests();
+    for (const auto& [plugin_id, active_plugin] : active_plugins_) {
+        // Plugins that are still being prefetched don't have a bridge yet,
+        // those are simply left out of the report
+        if (!active_plugin.bridge) {
+            continue;
+        }
+
+        const HostBridge::LoadStatistics statistics =
+            active_plugin.bridge->load_statistics();
+        response.instances.push_back(GroupInstanceStats{
+            .plugin_id = plugin_id,
+            .plugin_path = active_plugin.bridge->plugin_path_.string(),
+            .audio_cpu_ns = statistics.audio_cpu_ns,
+            .gui_cpu_ns = statistics.gui_cpu_ns,
+            .process_call_count = statistics.process_call_count,
+            .process_call_ewma_ns = statistics.process_call_ewma_ns,
+            .event_count = statistics.event_count,
         });
+    }
+
+    return response;
 }
 
-void GroupBridge::async_handle_events() {
-    main_context_.async_handle_events(
-        [&]() {
+void GroupBridge::async_handle_events(MainContext& context, size_t shard) {
+    context.async_handle_events(
+        [&, message_budget = HostBridge::default_message_budget]() mutable {
             std::lock_guard lock(active_plugins_mutex_);
 
             // Keep the loop responsive by not handling too many events at once.
@@ -298,9 +638,71 @@ void GroupBridge::async_handle_events() {
             // timer loop for a little while after opening a second editor.
             // Without this limit everything will get blocked indefinitely. How
             // could this be fixed?
-            HostBridge::handle_events();
+            if (HostBridge::handle_events(message_budget)) {
+                // Pending dispatcher calls for the other plugins in this group
+                // get to run in between the message batches
+                return true;
+            }
+
+            message_budget = HostBridge::default_message_budget;
+            return false;
         },
-        [&]() { return !is_event_loop_inhibited(); });
+        [&, shard]() { return !is_event_loop_inhibited(shard); });
+}
+
+size_t GroupBridge::assign_event_loop_shard() {
+    // NOTE: `active_plugins_mutex_` must be held by the caller here
+    std::vector<size_t> shard_sizes(event_loop_shards_.size() + 1, 0);
+    for (const auto& [plugin_id, plugin] : active_plugins_) {
+        shard_sizes[plugin.shard] += 1;
+    }
+
+    size_t best_shard = 0;
+    for (size_t shard = 1; shard < shard_sizes.size(); shard++) {
+        if (shard_sizes[shard] < shard_sizes[best_shard]) {
+            best_shard = shard;
+        }
+    }
+
+    // Only spin up another event loop thread once every existing shard is at
+    // capacity. Most groups will never go past the main thread.
+    if (shard_sizes[best_shard] >= max_plugins_per_event_loop &&
+        event_loop_shards_.size() < max_event_loop_shards) {
+        event_loop_shards_.push_back(std::make_unique<EventLoopShard>(
+            *this, event_loop_shards_.size() + 1));
+        best_shard = event_loop_shards_.size();
+
+        logger_.log("Started event loop shard " + std::to_string(best_shard) +
+                    " for the next batch of plugins");
+    }
+
+    return best_shard;
+}
+
+MainContext& GroupBridge::shard_context(size_t shard) noexcept {
+    if (shard == 0) {
+        return main_context_;
+    }
+
+    // The vector may grow concurrently, but the shards themselves are heap
+    // allocated so the returned reference remains stable
+    std::lock_guard lock(active_plugins_mutex_);
+    return event_loop_shards_[shard - 1]->context;
+}
+
+GroupBridge::EventLoopShard::EventLoopShard(GroupBridge& group,
+                                            size_t shard_index) {
+    thread = Win32Thread([&group, shard_index, this]() {
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("events", shard_index);
+
+        group.async_handle_events(context, shard_index);
+        context.run();
+    });
+}
+
+GroupBridge::EventLoopShard::~EventLoopShard() noexcept {
+    context.stop();
 }
 
 asio::local::stream_protocol::acceptor create_acceptor_if_inactive(
@@ -336,6 +738,12 @@ asio::local::stream_protocol::acceptor create_acceptor_if_inactive(
 
 void GroupBridge::maybe_schedule_shutdown(
     std::chrono::steady_clock::duration delay) {
+    // Daemonized group hosts stay alive while idle so Wine never has to be
+    // booted again for the rest of the session
+    if (daemon_) {
+        return;
+    }
+
     std::lock_guard lock(shutdown_timer_mutex_);
 
     shutdown_timer_.expires_after(delay);
@@ -357,6 +765,54 @@ void GroupBridge::maybe_schedule_shutdown(
     });
 }
 
+void GroupBridge::schedule_io_advisory_scan() {
+    io_advisor_timer_.expires_after(10s);
+    io_advisor_timer_.async_wait([this](const std::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        const StreamingIoAdvisor::ScanResult result =
+            io_advisor_.advise_open_files();
+        if (result.new_files > 0) {
+            logger_.log_trace([&]() {
+                return "Advised streaming readahead on " +
+                       std::to_string(result.new_handles) + " new handle(s), " +
+                       std::to_string(result.new_files) +
+                       " new unique file(s)";
+            });
+        }
+
+        schedule_io_advisory_scan();
+    });
+}
+
+void GroupBridge::schedule_warm_watchdog() {
+    if (is_watchdog_timer_disabled()) {
+        return;
+    }
+
+    warm_watchdog_timer_.expires_after(5s);
+    warm_watchdog_timer_.async_wait([this](const std::error_code& error) {
+        // The timer gets cancelled when this process is claimed, and from
+        // that point on the regular watchdog on the hosted plugin takes over
+        if (error || warm_claimed_) {
+            return;
+        }
+
+        if (!pid_running(*warm_parent_pid_)) {
+            logger_.log(
+                "The process that spawned this warm host has exited before "
+                "the host was claimed, shutting down");
+
+            main_context_.stop();
+            return;
+        }
+
+        schedule_warm_watchdog();
+    });
+}
+
 std::string create_logger_prefix(const fs::path& socket_path) {
     // The group socket filename will be in the format
     // '/tmp/yabridge-group-<group_name>-<wine_prefix_id>-<architecture>.sock',
@@ -369,7 +825,13 @@ std::string create_logger_prefix(const fs::path& socket_path) {
     std::smatch group_match;
     std::regex group_regexp("^yabridge-group-(.*)-[^-]+-[^-]+$",
                             std::regex::ECMAScript);
-    if (std::regex_match(socket_name, group_match, group_regexp)) {
+    // Warm host sockets are named
+    // '/tmp/yabridge-warm-<index>-<wine_prefix_id>-<architecture>.sock', so
+    // those get a 'warm-<index>' prefix
+    std::regex warm_regexp("^yabridge-(warm-[0-9]+)-[^-]+-[^-]+$",
+                           std::regex::ECMAScript);
+    if (std::regex_match(socket_name, group_match, group_regexp) ||
+        std::regex_match(socket_name, group_match, warm_regexp)) {
         socket_name = group_match[1].str();
 
 #ifdef __i386__
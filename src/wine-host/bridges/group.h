@@ -17,7 +17,10 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <optional>
 #include <thread>
+#include <vector>
 
 #include "../use-linux-asio.h"
 
@@ -25,6 +28,9 @@
 #include <asio/posix/stream_descriptor.hpp>
 
 #include "../common/logging/common.h"
+#include "../common/serialization/common.h"
+#include "../io-advisor.h"
+#include "../preload-cache.h"
 #include "../utils.h"
 #include "common.h"
 
@@ -116,6 +122,24 @@ class GroupBridge {
      *   `/tmp/yabridge-group-<group_name>-<wine_prefix_id>-<architecture>.sock`
      *   where `<wine_prefix_id>` is a numerical hash as explained in the
      *   `create_logger_prefix()` function in `./group.cpp`.
+     * @param warm_parent_pid When set, this process acts as a pre-booted warm
+     *   host for the `warm_hosts` option instead of as a plugin group. It will
+     *   then sit waiting until a yabridge instance claims it, host exactly one
+     *   plugin, and stop accepting further connections. The argument is the
+     *   process ID of the native host that spawned the pool, so an unclaimed
+     *   warm host can shut down again after that process has exited.
+     * @param daemon Whether this group host should keep running as a daemon
+     *   when it's not hosting any plugins. This backs the `group_daemon`
+     *   option, and it makes loading the first plugin of a session
+     *   near-instant since Wine has already been booted by the time the
+     *   plugin gets loaded.
+     * @param trusted Whether this group is marked as trusted through the
+     *   `group_trusted` option. Trusted groups replace active watchdog
+     *   participation with the passive shared memory heartbeat, so the
+     *   watchdog's monitor thread and its mutex work on plugin lifetime
+     *   paths disappear from this process entirely.
+     *
+     *   @see Watchdog::disable_for_trusted_group
      *
      * @throw std::system_error If we can't listen on the socket.
      * @throw std::system_error If the pipe could not be created.
@@ -124,7 +148,10 @@ class GroupBridge {
      *   STDOUT and STDERR streams of the current process will be redirected to
      *   a pipe so they can be properly written to a log file.
      */
-    explicit GroupBridge(ghc::filesystem::path group_socket_path);
+    explicit GroupBridge(ghc::filesystem::path group_socket_path,
+                         std::optional<pid_t> warm_parent_pid = std::nullopt,
+                         bool daemon = false,
+                         bool trusted = false);
 
     ~GroupBridge() noexcept;
 
@@ -135,12 +162,13 @@ class GroupBridge {
     GroupBridge& operator=(GroupBridge&&) = delete;
 
     /**
-     * If this returns `true`, then the group host's event loop should
+     * If this returns `true`, then the event loop for the given shard should
      * temporarily be disabled. This simply calls
-     * `HostBridge::inhibits_event_loop()` for all plugins hosted in this group
-     * process.
+     * `HostBridge::inhibits_event_loop()` for all plugins assigned to that
+     * shard. Plugins on other shards run on their own threads with their own
+     * message queues, so they don't need to be considered here.
      */
-    bool is_event_loop_inhibited() noexcept;
+    bool is_event_loop_inhibited(size_t shard) noexcept;
 
     /**
      * Run a plugin's dispatcher and message loop, processing all events on the
@@ -177,22 +205,85 @@ class GroupBridge {
      * the yabridge instance can tell if the plugin crashed during
      * initialization, and it will then try to initialize the plugin. After
      * intialization the plugin handling will be handed over to a new thread
-     * running `handle_plugin_run()`. Because of the way the Win32 API works,
-     * all plugins have to be initialized from the same thread, and all event
-     * handling and message loop interaction also has to be done from that
-     * thread, which is why we initialize the plugin here and use the
-     * `handle_dispatch()` function to run events within the same
-     * `main_context_`.
+     * running `handle_plugin_run()`. Because of the way the Win32 API works, a
+     * plugin has to be initialized from the same thread that will be handling
+     * its message loop. That used to mean one shared thread for the entire
+     * group, but plugins are now sharded across a small set of event loop
+     * threads so the per-tick event handling work doesn't grow linearly with
+     * the group's size. The request handler picks a shard here, and the
+     * plugin is then initialized within that shard's IO context.
      *
      * @see handle_plugin_run
+     * @see assign_event_loop_shard
      */
     void accept_requests();
 
     /**
-     * Handle both Win32 messages and X11 events on a timer within the IO
-     * context for all plugins.
+     * Host a 32-bit plugin by forwarding its request to the companion 32-bit
+     * group host process, spawning that process first when it isn't running
+     * yet. A 64-bit process can't load 32-bit plugin libraries, so requests
+     * that come with a `bitbridge_host_path` set get handed over to a
+     * `yabridge-host-32.exe` group host listening on this group's derived
+     * `-x32` socket. The companion process manages its own lifecycle exactly
+     * like any other group host, so it sticks around for as long as it's
+     * hosting plugins even if this process shuts down before it does. Because
+     * spawning the companion involves booting Wine this has to run on one of
+     * the `delegation_threads_`, not on the accept handler.
+     */
+    void delegate_to_bitbridge_host(const HostRequest& request);
+
+    /**
+     * Instantiate the bridge for a requested plugin. Because of the way the
+     * Win32 API works this always has to be run from the assigned shard's IO
+     * context thread, since all window messages have to be handled from the
+     * thread that created the corresponding windows. The rest of the load
+     * path runs on the plugin's own worker thread.
+     *
+     * @param request The host request describing the plugin.
+     * @param context The IO context of the event loop shard this plugin was
+     *   assigned to. The bridge will run all of its main thread work there.
+     *
+     * @throw std::runtime_error When the request is for a plugin type this
+     *   version of yabridge has not been compiled with, or when the plugin
+     *   failed to initialize.
+     */
+    std::unique_ptr<HostBridge> create_bridge(const HostRequest& request,
+                                              MainContext& context);
+
+    /**
+     * Gather the load counters of every initialized plugin instance hosted by
+     * this process. This is used to answer statistics queries made over the
+     * group socket, which are `HostRequest`s with their `plugin_type` field
+     * set to `PluginType::unknown`. The caller must hold
+     * `active_plugins_mutex_`.
+     *
+     * @see GroupStatsResponse
+     */
+    GroupStatsResponse collect_statistics() noexcept;
+
+    /**
+     * Handle both Win32 messages and X11 events on a timer within the given
+     * IO context, for the plugins assigned to the given event loop shard.
+     * Win32 message queues are per-thread, so every shard pumps the messages
+     * for exactly the windows its own plugins created.
+     */
+    void async_handle_events(MainContext& context, size_t shard);
+
+    /**
+     * Pick the event loop shard a new plugin should be assigned to. This
+     * returns the shard currently hosting the fewest plugins, spinning up a
+     * new shard thread when all existing shards are at capacity and the cap
+     * on shard threads hasn't been reached yet. Shard 0 is the process's main
+     * thread. Requires `active_plugins_mutex_` to be held.
+     */
+    size_t assign_event_loop_shard();
+
+    /**
+     * The IO context for an event loop shard, with shard 0 mapping to
+     * `main_context_`. The returned reference remains valid for the lifetime
+     * of this object.
      */
-    void async_handle_events();
+    MainContext& shard_context(size_t shard) noexcept;
 
     /**
      * After `delay` seconds, check if this group host process is (still)
@@ -201,6 +292,27 @@ class GroupBridge {
      */
     void maybe_schedule_shutdown(std::chrono::steady_clock::duration delay);
 
+    /**
+     * Periodically rescan the process's open files and advise streaming
+     * readahead on the sample files the hosted plugins keep open, logging a
+     * trace line whenever new files show up. Reschedules itself on
+     * `io_advisor_timer_` for as long as the process runs.
+     *
+     * @see StreamingIoAdvisor
+     */
+    void schedule_io_advisory_scan();
+
+    /**
+     * Periodically check whether the native host process that spawned this
+     * warm host is still running, shutting this process down when it isn't.
+     * This replaces the initial shutdown timer for warm hosts, since those
+     * need to keep waiting until they get claimed. The check stops once a
+     * plugin has claimed this process, as from that point on the regular
+     * watchdog on the hosted plugin takes over. This does nothing when the
+     * watchdog has been explicitly disabled through `YABRIDGE_NO_WATCHDOG`.
+     */
+    void schedule_warm_watchdog();
+
     /**
      * The logging facility used for this group host process. Since we can't
      * identify which plugin is generating (debug) output, every line will only
@@ -211,7 +323,9 @@ class GroupBridge {
     /**
      * The IO context that connections will be accepted on, and that any plugin
      * operations that may involve the Win32 mesasge loop (e.g. initialization
-     * and most `AEffect::dispatcher()` calls) should be run on.
+     * and most `AEffect::dispatcher()` calls) should be run on. This doubles
+     * as event loop shard 0, with additional plugins spilling over into the
+     * shards in `event_loop_shards_`.
      */
     MainContext main_context_;
     /**
@@ -242,6 +356,38 @@ class GroupBridge {
      */
     Win32Thread stdio_handler_;
 
+    /**
+     * When set, this process is a pre-booted warm host for the `warm_hosts`
+     * option and will host exactly one plugin. Contains the process ID of the
+     * native host that spawned the pool.
+     *
+     * @see GroupBridge::GroupBridge
+     */
+    const std::optional<pid_t> warm_parent_pid_;
+
+    /**
+     * Whether this group host should keep running when it's not hosting any
+     * plugins instead of shutting down after a few seconds of being idle.
+     *
+     * @see GroupBridge::GroupBridge
+     */
+    const bool daemon_;
+
+    /**
+     * Whether this group is marked as trusted, which disables the process
+     * watchdog. Also forwarded to the companion 32-bit group host when one
+     * gets spawned.
+     *
+     * @see GroupBridge::GroupBridge
+     */
+    const bool trusted_;
+
+    /**
+     * Set from the accept handler once a yabridge instance has claimed this
+     * warm host. Only ever touched from the main IO context.
+     */
+    bool warm_claimed_ = false;
+
     asio::local::stream_protocol::endpoint group_socket_endpoint_;
     /**
      * The UNIX domain socket acceptor that will be used to listen for incoming
@@ -249,6 +395,48 @@ class GroupBridge {
      */
     asio::local::stream_protocol::acceptor group_socket_acceptor_;
 
+    /**
+     * A plugin currently hosted in this process: the thread running its
+     * sockets, the bridge instance itself, and the event loop shard its main
+     * thread work runs on. The bridge pointer stays null while the plugin's
+     * binaries are still being prefetched on the worker thread.
+     */
+    struct ActivePlugin {
+        Win32Thread thread;
+        std::unique_ptr<HostBridge> bridge;
+        /**
+         * The index of the event loop shard this plugin was assigned to, with
+         * 0 being the process's main thread.
+         *
+         * @see assign_event_loop_shard
+         */
+        size_t shard = 0;
+    };
+
+    /**
+     * An additional event loop thread that a subset of the hosted plugins
+     * runs on. Win32 delivers window messages to the thread that created the
+     * window, so a plugin is created on its shard's thread and all of its GUI
+     * and message loop work then stays on that same thread. This keeps the
+     * per-tick event handling cost flat as the group grows instead of one
+     * thread having to tick every hosted plugin.
+     */
+    struct EventLoopShard {
+        EventLoopShard(GroupBridge& group, size_t shard_index);
+
+        /**
+         * Stop the IO context before the implicit thread join so the thread
+         * can actually exit.
+         */
+        ~EventLoopShard() noexcept;
+
+        EventLoopShard(const EventLoopShard&) = delete;
+        EventLoopShard& operator=(const EventLoopShard&) = delete;
+
+        MainContext context;
+        Win32Thread thread;
+    };
+
     /**
      * A map of threads that are currently hosting a plugin within this process
      * along with their plugin instance. After a plugin has exited or its
@@ -258,9 +446,7 @@ class GroupBridge {
      * thread and plugin is a unique plugin ID obtained by doing a fetch-and-add
      * on `next_plugin_id_`.
      */
-    std::unordered_map<size_t,
-                       std::pair<Win32Thread, std::unique_ptr<HostBridge>>>
-        active_plugins_;
+    std::unordered_map<size_t, ActivePlugin> active_plugins_;
     /**
      * A counter for the next unique plugin ID. When hosting a new plugin we'll
      * do a fetch-and-add to ensure that every thread gets its own unique
@@ -271,10 +457,32 @@ class GroupBridge {
      * A mutex to prevent two threads from simultaneously accessing the plugins
      * map, and also to prevent `handle_plugin_run()` from terminating the
      * process because it thinks there are no active plugins left just as a new
-     * plugin is being spawned.
+     * plugin is being spawned. This also guards `event_loop_shards_`.
      */
     std::mutex active_plugins_mutex_;
 
+    /**
+     * The additional event loop threads plugins can be sharded onto, created
+     * on demand once the existing shards fill up. Shard index `n` maps to
+     * element `n - 1` here, since shard 0 is `main_context_`. The unique
+     * pointers keep the `MainContext` addresses stable when this vector
+     * grows. Declared after (and thus destroyed before) the plugin map so the
+     * shard threads are gone before the plugins they reference are.
+     */
+    std::vector<std::unique_ptr<EventLoopShard>> event_loop_shards_;
+
+    /**
+     * The threads used to forward requests for 32-bit plugins to the
+     * companion 32-bit group host process. Each delegation finishes once the
+     * companion has accepted the forwarded request, so these threads are all
+     * short-lived, but they can't run on the accept handler because spawning
+     * the companion process involves booting Wine. Guarded by
+     * `active_plugins_mutex_`, and joined implicitly on destruction.
+     *
+     * @see delegate_to_bitbridge_host
+     */
+    std::vector<Win32Thread> delegation_threads_;
+
     /**
      * A timer to defer shutting down the process, allowing for fast plugin
      * scanning without having to start a new group host process for each
@@ -288,4 +496,39 @@ class GroupBridge {
      * timer when multiple plugins exit at the same time.
      */
     std::mutex shutdown_timer_mutex_;
+
+    /**
+     * The timer used to periodically check whether an unclaimed warm host's
+     * spawning process is still running.
+     *
+     * @see schedule_warm_watchdog
+     */
+    asio::steady_timer warm_watchdog_timer_;
+
+    /**
+     * Tracks and advises the sample files streamed by the hosted plugins.
+     * Only ever touched from the main IO context through the scan timer
+     * below.
+     *
+     * @see schedule_io_advisory_scan
+     */
+    StreamingIoAdvisor io_advisor_;
+
+    /**
+     * The timer driving the periodic open file scans.
+     *
+     * @see schedule_io_advisory_scan
+     */
+    asio::steady_timer io_advisor_timer_;
+
+    /**
+     * Records the plugins hosted by this group and prefetches the recorded
+     * plugins from earlier sessions when the first hosting request comes in,
+     * so reopening a project doesn't serialize the loader's disk reads with
+     * the per-instance state restores. Warm hosts skip this, since they only
+     * ever host a single plugin.
+     *
+     * @see SessionPrefetcher
+     */
+    SessionPrefetcher session_prefetcher_;
 };
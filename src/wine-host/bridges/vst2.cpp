@@ -16,6 +16,11 @@
 
 #include "vst2.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <iostream>
 #include <set>
 
@@ -23,6 +28,8 @@
 #include <version.h>
 
 #include "../../common/communication/vst2.h"
+#include "../audio-worker-pool.h"
+#include "../gang-dispatch.h"
 
 /**
  * A function pointer to what should be the entry point of a VST plugin.
@@ -49,6 +56,12 @@ constexpr size_t yabridge_ptr2_magic = 0xdeadbeef + 420;
  */
 Vst2Bridge* current_bridge_instance = nullptr;
 
+/**
+ * How often to check whether this instance has been silent for longer than the
+ * `hibernate_after` option allows. Only used when that option is set.
+ */
+constexpr std::chrono::seconds hibernation_check_interval(5);
+
 /**
  * Callbacks (presumably made from the GUI thread) that may receive responses
  * that have to be handled from the same thread. If we don't do this, then those
@@ -159,10 +172,14 @@ Vst2Bridge::Vst2Bridge(MainContext& main_context,
                        std::string plugin_dll_path,
                        std::string endpoint_base_dir,
                        pid_t parent_pid)
-    : HostBridge(main_context, plugin_dll_path, parent_pid),
+    : HostBridge(main_context, plugin_dll_path, endpoint_base_dir, parent_pid),
       logger_(generic_logger_),
       plugin_handle_(LoadLibrary(plugin_dll_path.c_str()), FreeLibrary),
-      sockets_(main_context.context_, endpoint_base_dir, false) {
+      sockets_(main_context.context_, endpoint_base_dir, false),
+      hibernation_timer_(main_context.context_),
+      snapshot_timer_(main_context.context_),
+      needs_idle_timer_(main_context.context_),
+      automate_flush_timer_(main_context.context_) {
     if (!plugin_handle_) {
         throw std::runtime_error("Could not load the Windows .dll file at '" +
                                  plugin_dll_path + "'");
@@ -229,12 +246,54 @@ Vst2Bridge::Vst2Bridge(MainContext& main_context,
     // configuration as a response
     config_ = sockets_.host_plugin_control_.receive_single<Configuration>();
 
+    // This side sends the plugin's `audioMaster()` callbacks, so concurrent
+    // callbacks can be handled over pre-established spare connections when the
+    // `spare_sockets` option is set
+    sockets_.plugin_host_callback_.set_spare_sockets(config_.spare_sockets);
+
+    // Without an explicit `frame_rate` setting we'll pace the event loop to
+    // the display's actual refresh rate instead of assuming 60 fps
+    if (!config_.frame_rate) {
+        config_.frame_rate = detect_screen_refresh_rate(
+            *SharedX11Connection::get(main_context)->connection());
+    }
+
     // Allow this plugin to configure the main context's tick rate
     main_context.update_timer_interval(config_.event_loop_interval());
 
+    // Process wide resource limits requested through the `group_cpus`,
+    // `group_cpu_quota` and `group_memory_limit` options. These have to be
+    // applied before the worker threads below get spawned so the affinity
+    // fallback gets inherited, and only the first loaded plugin's settings
+    // take effect since all plugins in a plugin group share this process.
+    if (config_.group_cpus || config_.group_cpu_quota > 0 ||
+        config_.group_memory_limit > 0) {
+        apply_process_resource_limits(
+            config_.group.value_or(plugin_path_.stem().string()),
+            config_.group_cpus, config_.group_cpu_quota,
+            config_.group_memory_limit);
+    }
+
+    // We're running on the main GUI thread here, so this pins the Win32
+    // message loop and all GUI work. Like the event loop interval this is
+    // shared by every plugin in a plugin group, so the last loaded plugin's
+    // setting wins. The NUMA node pinning has to happen before the worker
+    // threads below get spawned so they inherit the affinity, and explicit
+    // `main_affinity`/`audio_affinity` lists still override it per thread.
+    if (config_.numa_node) {
+        set_numa_node_affinity(*config_.numa_node);
+    }
+    if (config_.main_affinity) {
+        set_cpu_affinity(*config_.main_affinity);
+    }
+
     parameters_handler_ = Win32Thread([&]() {
         set_realtime_priority(true);
-        pthread_setname_np(pthread_self(), "parameters");
+        if (config_.audio_affinity) {
+            set_cpu_affinity(*config_.audio_affinity);
+        }
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("parameters");
 
         sockets_.host_plugin_parameters_.receive_multi<Parameter>(
             [&](Parameter& request, SerializationBufferBase& buffer) {
@@ -259,131 +318,600 @@ Vst2Bridge::Vst2Bridge(MainContext& main_context,
             });
     });
 
+    parameters_rpc_handler_ = Win32Thread([&]() {
+        set_realtime_priority(true);
+        if (config_.audio_affinity) {
+            set_cpu_affinity(*config_.audio_affinity);
+        }
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("parameters-rpc");
+
+        // Once the shared memory object exists, `getParameter` and
+        // `setParameter` calls come in through the parameter mailbox in its
+        // doorbell page instead of through the parameters socket. Like the
+        // audio thread we'll first wait for the dispatcher thread to create
+        // that object during `effMainsChanged()`.
+        {
+            std::unique_lock lock(process_buffers_doorbell_mutex_);
+            process_buffers_doorbell_cv_.wait(lock, [&]() {
+                return (process_buffers_ && process_buffers_->has_doorbell()) ||
+                       audio_thread_shutdown_.load();
+            });
+        }
+
+        if (audio_thread_shutdown_.load()) {
+            return;
+        }
+
+        auto& mailbox = *reinterpret_cast<Vst2ParameterMailbox*>(
+            process_buffers_->doorbell_payload() +
+            vst2_parameter_mailbox_offset);
+        while (true) {
+            const uint32_t message = process_buffers_->wait_for_rpc_ring();
+            if (message == AudioShmBuffer::doorbell_message_terminate)
+                [[unlikely]] {
+                break;
+            }
+
+            // Same distinction as on the socket based path above: the
+            // presence of a value tells us whether this is a `setParameter`
+            // or a `getParameter` call
+            if (mailbox.is_set) {
+                plugin_->setParameter(plugin_, mailbox.index, mailbox.value);
+            } else {
+                mailbox.value = plugin_->getParameter(plugin_, mailbox.index);
+            }
+
+            process_buffers_->ring_rpc_completion();
+        }
+    });
+
     process_replacing_handler_ = Win32Thread([&]() {
         set_realtime_priority(true);
-        pthread_setname_np(pthread_self(), "audio");
+        if (config_.audio_affinity) {
+            set_cpu_affinity(*config_.audio_affinity);
+        }
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("audio");
 
         // Most plugins will already enable FTZ, but there are a handful of
         // plugins that don't that suffer from extreme DSP load increases when
-        // they start producing denormals
-        ScopedFlushToZero ftz_guard;
-
-        sockets_.host_plugin_process_replacing_.receive_multi<
-            Vst2ProcessRequest>([&](Vst2ProcessRequest& process_request,
-                                    SerializationBufferBase& buffer) {
-            // Since the value cannot change during this processing cycle,
-            // we'll send the current transport information as part of the
-            // request so we prefetch it to avoid unnecessary callbacks from
-            // the audio thread
-            std::optional<decltype(time_info_cache_)::Guard>
-                time_info_cache_guard =
-                    process_request.current_time_info
-                        ? std::optional(time_info_cache_.set(
-                              *process_request.current_time_info))
-                        : std::nullopt;
-
-            // We'll also prefetch the process level, since some plugins
-            // will ask for this during every processing cycle
-            decltype(process_level_cache_)::Guard process_level_cache_guard =
-                process_level_cache_.set(process_request.current_process_level);
-
-            // As suggested by Jack Winter, we'll synchronize this thread's
-            // audio processing priority with that of the host's audio
-            // thread every once in a while
-            if (process_request.new_realtime_priority) {
-                set_realtime_priority(true,
-                                      *process_request.new_realtime_priority);
+        // they start producing denormals. This thread only ever runs plugin
+        // audio code, so the flag just stays enabled for its lifetime.
+        ensure_flush_to_zero();
+
+        // Audio processing requests come in through the futex doorbell
+        // embedded in the shared memory object that's set up during
+        // `effMainsChanged()`. That way steady-state audio processing doesn't
+        // involve any sockets at all. Since that object doesn't exist yet at
+        // this point, we'll first wait for the dispatcher thread to create it.
+        {
+            std::unique_lock lock(process_buffers_doorbell_mutex_);
+            process_buffers_doorbell_cv_.wait(lock, [&]() {
+                return (process_buffers_ && process_buffers_->has_doorbell()) ||
+                       audio_thread_shutdown_.load();
+            });
+        }
+
+        if (audio_thread_shutdown_.load()) {
+            return;
+        }
+
+        // With the `audio_gang_dispatch` option this instance's rings funnel
+        // through the process wide gang doorbell instead of this instance's
+        // own futex. The gang listener scans all registered instances after
+        // a gang wakeup and runs the pending cycles on the worker pool, so
+        // the only thing left to do here is registering this instance. The
+        // registration gets removed again in `close_sockets()`.
+        if (process_buffers_->has_gang()) {
+            GangDispatcher::instance().register_instance(
+                *process_buffers_,
+                [](void* context, uint32_t message) {
+                    static_cast<Vst2Bridge*>(context)->run_audio_cycle(
+                        message, false);
+                },
+                this);
+            return;
+        }
+
+        // When this process hosts more plugins than the machine has physical
+        // cores, the actual processing calls get handed off to the process
+        // wide worker pool so all those audio threads don't oversubscribe the
+        // CPU. Until that point the pool stays completely passive and
+        // `AudioWorkerPool::run()` just runs the call on this thread.
+        AudioWorkerPool::AudioThreadGuard audio_worker_guard{};
+
+        while (true) {
+            const uint32_t message = process_buffers_->wait_for_ring();
+            if (message == AudioShmBuffer::doorbell_message_terminate)
+                [[unlikely]] {
+                break;
             }
 
-            // Let the plugin process the MIDI events that were received
-            // since the last buffer, and then clean up those events. This
-            // approach should not be needed but Kontakt only stores
-            // pointers to rather than copies of the events.
-            std::lock_guard lock(next_buffer_midi_events_mutex_);
-
-            // As an optimization we no don't pass the input audio along
-            // with `Vst2ProcessRequest`, and instead we'll write it to a
-            // shared memory object on the plugin side. We can then write
-            // the output audio to the same shared memory object. Since the
-            // host should only be calling one of `process()`,
-            // processReplacing()` or `processDoubleReplacing()`, we can all
-            // handle them all at once. We pick which one to call depending
-            // on the type of data we got sent and the plugin's reported
-            // support for these functions.
-            auto do_process = [&]<typename T>(T) {
-                // These were set up after the host called
-                // `effMainsChanged()` with the correct size, so this
-                // reinterpret cast is safe even if the host suddenly starts
-                // sending 32-bit single precision audio after it set up
-                // audio processing for double precision (not that the
-                // Windows VST2 plugin would be able to handle that,
-                // presumably)
-                T** input_channel_pointers = reinterpret_cast<T**>(
-                    process_buffers_input_pointers_.data());
-                T** output_channel_pointers = reinterpret_cast<T**>(
-                    process_buffers_output_pointers_.data());
-
-                if constexpr (std::is_same_v<T, float>) {
-                    // Any plugin made in the last fifteen years or so
-                    // should support `processReplacing`. In the off chance
-                    // it does not we can just emulate this behavior
-                    // ourselves.
-                    if (plugin_->processReplacing) {
-                        plugin_->processReplacing(
-                            plugin_, input_channel_pointers,
-                            output_channel_pointers,
-                            process_request.sample_frames);
-                    } else {
-                        // If we zero out this buffer then the behavior is
-                        // the same as `processReplacing`
-                        for (int channel = 0; channel < plugin_->numOutputs;
-                             channel++) {
-                            std::fill(output_channel_pointers[channel],
-                                      output_channel_pointers[channel] +
-                                          process_request.sample_frames,
-                                      static_cast<T>(0.0));
-                        }
-
-                        plugin_->process(plugin_, input_channel_pointers,
-                                         output_channel_pointers,
-                                         process_request.sample_frames);
-                    }
-                } else if (std::is_same_v<T, double>) {
-                    plugin_->processDoubleReplacing(
-                        plugin_, input_channel_pointers,
-                        output_channel_pointers, process_request.sample_frames);
-                } else {
-                    static_assert(
-                        std::is_same_v<T, float> || std::is_same_v<T, double>,
-                        "Audio processing only works with single and "
-                        "double precision floating point numbers");
+            run_audio_cycle(message, true);
+        }
+    });
+
+    // With the `notification_dedup_ms` option set, repeated identical
+    // `audioMasterIOChanged()` callbacks collapse into one forwarded
+    // callback per window, see the handling in `host_callback()`
+    if (config_.notification_dedup_ms > 0) {
+        notification_dedup_.emplace(
+            main_context_,
+            std::chrono::milliseconds(config_.notification_dedup_ms));
+    }
+
+    // With the `hibernate_after` option set we'll periodically check whether
+    // this instance has gone silent so its memory can be reclaimed
+    last_audio_activity_.store(
+        std::chrono::steady_clock::now().time_since_epoch().count(),
+        std::memory_order_relaxed);
+    if (config_.hibernate_after > 0) {
+        schedule_hibernation_check();
+    }
+
+    // With the `snapshot_interval` option set we'll periodically spool the
+    // plugin's state chunk to disk so a crashing group host doesn't take
+    // every instance's unsaved tweaks with it. If a previous process hosting
+    // this plugin died, we'll adopt the snapshot it left behind here and
+    // restore it right after the host's `effOpen()` call.
+    if (config_.snapshot_interval > 0) {
+        snapshot_spool_.emplace(plugin_path_);
+        recovered_state_ = snapshot_spool_->adopt_orphaned_snapshot();
+        schedule_state_snapshot();
+    }
+
+    // With the `overload_priority` option this instance takes part in the
+    // process wide overload governor, which bypasses the lowest priority
+    // instances' processing when the group's audio threads keep overrunning
+    // their block budgets. See `OverloadGovernor`.
+    if (config_.overload_priority) {
+        overload_instance_ = OverloadGovernor::instance().register_instance(
+            *config_.overload_priority);
+    }
+}
+
+#pragma GCC diagnostic pop
+
+void Vst2Bridge::run_audio_cycle(uint32_t message, bool use_worker_pool) {
+    // With the `audio_pipelining` option the native plugin alternates
+    // between the two buffer banks, and each bank has its own
+    // metadata slot in the payload area
+    const uint32_t bank =
+        message == AudioShmBuffer::doorbell_message_process_secondary ? 1 : 0;
+    const auto& metadata = reinterpret_cast<const Vst2ProcessMetadata*>(
+        process_buffers_->doorbell_payload())[bank];
+    metadata.to_request(process_request_);
+
+    // Used by `maybe_hibernate()` to detect instances that have gone
+    // silent. This has to happen before the mutex below gets locked
+    // so a concurrently running hibernation check always either sees
+    // this store or blocks us until its suspend has finished.
+    last_audio_activity_.store(
+        std::chrono::steady_clock::now().time_since_epoch().count(),
+        std::memory_order_relaxed);
+
+    // `maybe_hibernate()` only ever suspends the plugin while holding
+    // this mutex, and we'll hold it for the remainder of this cycle.
+    // That way a hibernation can never start in between the wakeup
+    // check below and the actual processing call.
+    std::unique_lock midi_events_lock(next_buffer_midi_events_mutex_);
+
+    // If we hibernated this instance because it went silent, it has
+    // to be resumed before it can process audio again. The resume
+    // happens on the GUI thread without holding the mutex, since the
+    // hibernation checks also run there.
+    if (hibernated_.load(std::memory_order_relaxed)) [[unlikely]] {
+        midi_events_lock.unlock();
+        main_context_
+            .run_in_context([&]() {
+                plugin_->dispatcher(plugin_, effMainsChanged, 0, 1, nullptr,
+                                    0.0f);
+            })
+            .get();
+        hibernated_.store(false, std::memory_order_relaxed);
+        midi_events_lock.lock();
+    }
+
+    // Small MIDI event batches are written to the shared memory
+    // object's event area just before the doorbell gets rung instead
+    // of being serialized over the dispatcher socket. These need to
+    // be passed to the plugin the same way the socket based
+    // `effProcessEvents()` path does, including keeping the events
+    // alive until the next processing cycle for plugins like Kontakt
+    // that only store pointers to them.
+    if (metadata.num_shm_events > 0) {
+        if (should_clear_midi_events_) {
+            next_audio_buffer_midi_events_.clear();
+            should_clear_midi_events_ = false;
+        }
+
+        next_audio_buffer_midi_events_.emplace_back(
+            reinterpret_cast<const VstEvent*>(
+                process_buffers_->event_area_ptr(bank)),
+            metadata.num_shm_events);
+        DynamicVstEvents& events = next_audio_buffer_midi_events_.back();
+
+        // Hosts don't use `effProcessEvents()`'s return value, so the
+        // native plugin side already returned 1 to the host when it
+        // stashed the events
+        plugin_->dispatcher(plugin_, effProcessEvents, 0, 0,
+                            &events.as_c_events(), 0.0f);
+    }
+
+    if (use_worker_pool) {
+        // We keep holding `midi_events_lock` here even though the worker
+        // pool may run the call on one of its own threads: this thread
+        // blocks until the call has finished, so the mutual exclusion
+        // with `effProcessEvents()` and the hibernation checks still
+        // holds
+        AudioWorkerPool::instance().run(
+            [&]() { handle_process_request(process_request_, bank); });
+    } else {
+        // With gang dispatch this whole cycle already runs on one of the
+        // pool's workers
+        handle_process_request(process_request_, bank);
+    }
+
+    // Republish the plugin's `AEffect` values after the block, so
+    // changes like a new `initialDelay` become visible to the native
+    // side one block sooner than the `audioMasterIOChanged()`
+    // notification would make them. This only bumps the mirror's
+    // sequence counter when something actually changed.
+    reinterpret_cast<Vst2AEffectMirror*>(process_buffers_->doorbell_payload() +
+                                         vst2_aeffect_mirror_offset)
+        ->update(*plugin_);
+
+    // The native plugin side blocks on this as the equivalent of the
+    // old `Ack` message, after which it can copy the outputs back to
+    // the host
+    process_buffers_->ring_completion();
+}
+
+void Vst2Bridge::handle_process_request(
+    const Vst2ProcessRequest& process_request,
+    uint32_t bank) {
+    // This entire function runs on the audio worker thread, so the CPU time
+    // measured here gets attributed to the right place
+    ScopedLoadTimer load_timer(*this, ScopedLoadTimer::Kind::audio);
+
+    // MXCSR is per thread, so FTZ has to be enabled on whichever thread ends
+    // up running the plugin's processing function. In steady state this is
+    // only a register read.
+    ensure_flush_to_zero();
+
+    // With the `overload_priority` option the process wide overload
+    // governor may have switched this instance into economy mode because
+    // the group's audio threads keep overrunning their block budgets. Its
+    // blocks then get bypassed instead of processed: the inputs are copied
+    // straight to the outputs and the plugin is never called, which frees
+    // up this instance's entire DSP cost until the overload clears.
+    const bool economy_mode =
+        overload_instance_ &&
+        OverloadGovernor::instance().economy_mode(overload_instance_);
+    if (economy_mode != economy_mode_engaged_) [[unlikely]] {
+        economy_mode_engaged_ = economy_mode;
+        if (economy_mode) {
+            logger_.log(
+                "The overload governor engaged economy mode, bypassing "
+                "this instance's audio processing");
+        } else {
+            logger_.log(
+                "The overload governor restored this instance to full "
+                "audio processing");
+        }
+    }
+
+    // Since the value cannot change during this processing cycle,
+    // we'll send the current transport information as part of the
+    // request so we prefetch it to avoid unnecessary callbacks from
+    // the audio thread
+    std::optional<decltype(time_info_cache_)::Guard>
+        time_info_cache_guard =
+            process_request.current_time_info
+                ? std::optional(time_info_cache_.set(
+                      *process_request.current_time_info))
+                : std::nullopt;
+
+    // We'll also prefetch the process level, since some plugins
+    // will ask for this during every processing cycle
+    decltype(process_level_cache_)::Guard process_level_cache_guard =
+        process_level_cache_.set(process_request.current_process_level);
+
+    // As suggested by Jack Winter, we'll synchronize this thread's
+    // scheduling parameters with those of the host's audio thread
+    // every once in a while
+    if (process_request.new_realtime_parameters) {
+        set_realtime_parameters(*process_request.new_realtime_parameters);
+    }
+
+    // The MIDI events received since the last buffer have already
+    // been passed to the plugin by our caller, which also holds
+    // `next_buffer_midi_events_mutex_` for the duration of this
+    // call so those events can't be modified while the plugin may
+    // still be reading them.
+
+    // As an optimization we no don't pass the input audio along
+    // with `Vst2ProcessRequest`, and instead we'll write it to a
+    // shared memory object on the plugin side. We can then write
+    // the output audio to the same shared memory object. Since the
+    // host should only be calling one of `process()`,
+    // processReplacing()` or `processDoubleReplacing()`, we can all
+    // handle them all at once. We pick which one to call depending
+    // on the type of data we got sent and the plugin's reported
+    // support for these functions.
+    auto do_process = [&]<typename T>(T) {
+        // These were set up after the host called
+        // `effMainsChanged()` with the correct size, so this
+        // reinterpret cast is safe even if the host suddenly starts
+        // sending 32-bit single precision audio after it set up
+        // audio processing for double precision (not that the
+        // Windows VST2 plugin would be able to handle that,
+        // presumably)
+        T** input_channel_pointers =
+            reinterpret_cast<T**>(process_buffers_input_pointers_[bank].data());
+        T** output_channel_pointers = reinterpret_cast<T**>(
+            process_buffers_output_pointers_[bank].data());
+
+        // With the `audio_zero_copy_input` option the native side flags
+        // blocks whose inputs should be read straight from the host's own
+        // buffers as mapped by `map_host_buffers()`, skipping the input
+        // copy. The silent channel mask is always zero for these blocks,
+        // which also matters because the mappings are read-only.
+        if (process_request.use_mapped_inputs) {
+            input_channel_pointers =
+                reinterpret_cast<T**>(mapped_input_pointers_.data());
+        }
+
+        // Similarly, with `audio_zero_copy_output` the plugin writes its
+        // outputs straight into the host's own buffers before we signal
+        // completion, so the native side's post-wake work shrinks to a flag
+        // check instead of a copy on the host's audio thread.
+        if (process_request.use_mapped_outputs) {
+            output_channel_pointers =
+                reinterpret_cast<T**>(mapped_output_pointers_.data());
+        }
+
+        // The native plugin side skips the input copy for channels that
+        // only contain digital silence, so the shared memory still holds
+        // whatever the last non-silent block left behind. Zero those
+        // channels out before handing them to the plugin. This is a
+        // store-only fill instead of the read-and-write copy it replaces.
+        if (process_request.silent_input_channels != 0) {
+            for (int channel = 0;
+                 channel < plugin_->numInputs && channel < 64; channel++) {
+                if (process_request.silent_input_channels &
+                    (1ull << channel)) {
+                    std::fill_n(input_channel_pointers[channel],
+                                process_request.sample_frames,
+                                static_cast<T>(0.0));
                 }
-            };
+            }
+        }
 
-            assert(process_buffers_);
-            if (process_request.double_precision) {
-                // XXX: Clangd doesn't let you specify template parameters
-                //      for templated lambdas. This argument should get
-                //      optimized out
-                do_process(double());
+        // An economy mode block acts like a hard bypass: inputs get copied
+        // to the matching outputs, any extra outputs are zeroed, and the
+        // plugin never runs. The silent channel fill above already zeroed
+        // the skipped input channels, so those copy zeros as they should.
+        if (economy_mode) [[unlikely]] {
+            const int shared_channels =
+                std::min(plugin_->numInputs, plugin_->numOutputs);
+            for (int channel = 0; channel < shared_channels; channel++) {
+                std::copy_n(input_channel_pointers[channel],
+                            process_request.sample_frames,
+                            output_channel_pointers[channel]);
+            }
+            for (int channel = shared_channels; channel < plugin_->numOutputs;
+                 channel++) {
+                std::fill_n(output_channel_pointers[channel],
+                            process_request.sample_frames,
+                            static_cast<T>(0.0));
+            }
+
+            return;
+        }
+
+        if constexpr (std::is_same_v<T, float>) {
+            // Any plugin made in the last fifteen years or so
+            // should support `processReplacing`. In the off chance
+            // it does not we can just emulate this behavior
+            // ourselves.
+            if (plugin_->processReplacing) {
+                plugin_->processReplacing(plugin_, input_channel_pointers,
+                                          output_channel_pointers,
+                                          process_request.sample_frames);
             } else {
-                do_process(float());
+                // If we zero out this buffer then the behavior is
+                // the same as `processReplacing`
+                for (int channel = 0; channel < plugin_->numOutputs;
+                     channel++) {
+                    std::fill(output_channel_pointers[channel],
+                              output_channel_pointers[channel] +
+                                  process_request.sample_frames,
+                              static_cast<T>(0.0));
+                }
+
+                plugin_->process(plugin_, input_channel_pointers,
+                                 output_channel_pointers,
+                                 process_request.sample_frames);
             }
+        } else if (std::is_same_v<T, double>) {
+            plugin_->processDoubleReplacing(plugin_, input_channel_pointers,
+                                            output_channel_pointers,
+                                            process_request.sample_frames);
+        } else {
+            static_assert(
+                std::is_same_v<T, float> || std::is_same_v<T, double>,
+                "Audio processing only works with single and "
+                "double precision floating point numbers");
+        }
+    };
+
+    assert(process_buffers_);
+
+    // Like the dispatcher opcodes tallied in `Vst2EventHandler`, the time
+    // spent inside the plugin's process function is accumulated per function
+    // for the timing table dumped on shutdown
+    DispatchTimingTable::Entry& timing_entry = process_timings_.entry(
+        process_request.double_precision ? "processDoubleReplacing()"
+                                         : "processReplacing()");
+    const auto process_start = std::chrono::steady_clock::now();
+
+    if (process_request.double_precision) {
+        // XXX: Clangd doesn't let you specify template parameters
+        //      for templated lambdas. This argument should get
+        //      optimized out
+        do_process(double());
+    } else {
+        do_process(float());
+    }
 
-            // We modified the buffers within the `process_response` object,
-            // so we can just send that object back. Like on the plugin side
-            // we cannot reuse the request object because a plugin may have
-            // a different number of input and output channels
-            sockets_.host_plugin_process_replacing_.send(Ack{}, buffer);
+    const std::chrono::steady_clock::duration process_duration =
+        std::chrono::steady_clock::now() - process_start;
+    timing_entry.record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(process_duration)
+            .count()));
+
+    // The overload governor compares every fully processed block's wall
+    // clock time against the block's real time budget. Bypassed economy
+    // blocks say nothing about the session's load, so they don't count.
+    if (overload_instance_ && !economy_mode) {
+        const float sample_rate = sample_rate_ > 0.0f ? sample_rate_ : 44100.0f;
+        OverloadGovernor::instance().record_block(
+            process_duration,
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(
+                    static_cast<float>(process_request.sample_frames) /
+                    sample_rate)));
+    }
 
-            // See the docstrong on `should_clear_midi_events` for why we
-            // don't just clear `next_buffer_midi_events` here
-            should_clear_midi_events_ = true;
-        });
+    // See the docstrong on `should_clear_midi_events` for why we
+    // don't just clear `next_buffer_midi_events` here
+    should_clear_midi_events_ = true;
+}
+
+void Vst2Bridge::schedule_hibernation_check() {
+    hibernation_timer_.expires_after(hibernation_check_interval);
+    hibernation_timer_.async_wait([this](const std::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        maybe_hibernate();
+        schedule_hibernation_check();
     });
 }
 
-#pragma GCC diagnostic pop
+void Vst2Bridge::maybe_hibernate() {
+    // We'll only hibernate instances the host left in their resumed state,
+    // and an open editor means the user is still interacting with this
+    // instance. We're running on the GUI thread here, so reading `editor_` is
+    // safe.
+    if (hibernated_.load(std::memory_order_relaxed) ||
+        !host_resumed_.load(std::memory_order_relaxed) || editor_) {
+        return;
+    }
+
+    // The audio thread holds this mutex for the entire processing cycle, so
+    // failing to lock it just means the instance obviously isn't silent. We
+    // can't block on it either, since the audio thread may be waiting on this
+    // very thread to wake a hibernated instance up again.
+    std::unique_lock lock(next_buffer_midi_events_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    // Rechecked under the mutex so a processing request that comes in right
+    // now either updates this timestamp before we see it, or blocks on the
+    // mutex until the suspend below has finished and then resumes the plugin
+    const auto last_activity = std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(
+            last_audio_activity_.load(std::memory_order_relaxed)));
+    if (std::chrono::steady_clock::now() - last_activity <
+        std::chrono::seconds(config_.hibernate_after)) {
+        return;
+    }
+
+    // A suspended plugin can free its own processing buffers, and we'll also
+    // release the backing pages of the shared memory audio buffers. The
+    // instance gets resumed again transparently on the next processing
+    // request or when the host opens the editor.
+    plugin_->dispatcher(plugin_, effMainsChanged, 0, 0, nullptr, 0.0f);
+    hibernated_.store(true, std::memory_order_relaxed);
+    if (process_buffers_) {
+        process_buffers_->trim();
+    }
+}
+
+void Vst2Bridge::schedule_state_snapshot() {
+    snapshot_timer_.expires_after(
+        std::chrono::seconds(config_.snapshot_interval));
+    snapshot_timer_.async_wait([this](const std::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        take_state_snapshot();
+        schedule_state_snapshot();
+    });
+}
+
+void Vst2Bridge::take_state_snapshot() {
+    // There's nothing to snapshot before the host has opened the plugin, and
+    // plugins without chunk support return nothing here. Snapshotting a
+    // hibernated instance is fine, since a suspended plugin keeps its state.
+    if (!is_initialized_) {
+        return;
+    }
+
+    void* chunk = nullptr;
+    const intptr_t size =
+        plugin_->dispatcher(plugin_, effGetChunk, 0, 0, &chunk, 0.0f);
+    if (size > 0 && chunk) {
+        snapshot_spool_->write(static_cast<const uint8_t*>(chunk),
+                               static_cast<size_t>(size));
+    }
+}
+
+void Vst2Bridge::schedule_plugin_idle() {
+    needs_idle_timer_.expires_after(config_.event_loop_interval());
+    needs_idle_timer_.async_wait([this](const std::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        run_plugin_idle();
+        if (needs_idle_) {
+            schedule_plugin_idle();
+        }
+    });
+}
+
+void Vst2Bridge::run_plugin_idle() {
+    // A hibernated instance is suspended, and waking it back up for idle
+    // processing would defeat the point of hibernating it. The flag stays
+    // set, so the idle calls simply resume along with the plugin.
+    if (hibernated_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (plugin_->dispatcher(plugin_, effIdle, 0, 0, nullptr, 0.0f) == 0) {
+        needs_idle_ = false;
+    }
+}
+
+void Vst2Bridge::maybe_run_deferred_editor_open() {
+    if (!pending_editor_open_) {
+        return;
+    }
+
+    // The function is moved out first so the editor idle timer and the
+    // inline flush in `dispatch_wrapper()` can tell that the open is no
+    // longer pending while the plugin is building its GUI
+    fu2::unique_function<intptr_t()> open_editor =
+        std::move(pending_editor_open_);
+    open_editor();
+}
 
 bool Vst2Bridge::inhibits_event_loop() noexcept {
     return !is_initialized_;
@@ -395,6 +923,28 @@ void Vst2Bridge::run() {
     sockets_.host_plugin_dispatch_.receive_events(
         std::nullopt,
         [&](Vst2Event& event, bool /*on_main_thread*/) -> Vst2EventResult {
+            // This yabridge-internal event never reaches the plugin. The
+            // native side uses it to prefetch the plugin's entire program
+            // name table in one round trip instead of forwarding one
+            // `effGetProgramNameIndexed()` call per program, see
+            // `Vst2PluginBridge::prefetch_program_names()`.
+            if (event.opcode == vst2_get_program_names_opcode) {
+                return get_program_names();
+            }
+
+            // Another yabridge-internal event that never reaches the plugin.
+            // With the `audio_zero_copy_input` or `audio_zero_copy_output`
+            // option enabled the native side sends this to have us map the
+            // host's own audio buffers, see
+            // `Vst2PluginBridge::try_use_mapped_host_buffers()`.
+            if (event.opcode == vst2_map_host_buffers_opcode) {
+                const auto* buffer_map =
+                    std::get_if<Vst2HostBufferMap>(&event.payload);
+                assert(buffer_map);
+
+                return map_host_buffers(*buffer_map);
+            }
+
             if (event.opcode == effProcessEvents) {
                 // For 99% of the plugins we can just call
                 // `effProcessReplacing()` and be done with it, but a select few
@@ -510,14 +1060,84 @@ void Vst2Bridge::run() {
                                        .value_payload = std::nullopt};
             }
 
+            // Hosts follow a program change by re-reading every parameter
+            // value and the `AEffect` fields, so the new program's full
+            // state gets bundled into the response and the native side can
+            // answer those reads without any further round trips
+            if (event.opcode == effSetProgram) {
+                return Vst2EventResult{.return_value = result.return_value,
+                                       .payload = collect_program_bundle(),
+                                       .value_payload = std::nullopt};
+            }
+
             return result;
         });
 }
 
+Vst2Bridge::~Vst2Bridge() noexcept {
+    // The audio thread may still be blocked on the doorbell or on the
+    // condition variable, and the thread handles are joined before
+    // `process_buffers_` gets destroyed. `close_sockets()` is normally already
+    // called before we get here, in which case this is a no-op.
+    close_sockets();
+
+    // Group host processes outlive individual plugin instances, so any
+    // host buffer mappings set up for the `audio_zero_copy_input` option
+    // have to be cleaned up here rather than left to process teardown
+    for (const auto& [region, region_size] : mapped_host_regions_) {
+        munmap(region, region_size);
+    }
+}
+
 void Vst2Bridge::close_sockets() {
+    // The audio thread and the parameter RPC thread block on the shared
+    // memory doorbell instead of on a socket, so closing the sockets alone
+    // won't wake them up
+    audio_thread_shutdown_.store(true);
+    {
+        std::lock_guard lock(process_buffers_doorbell_mutex_);
+    }
+    process_buffers_doorbell_cv_.notify_all();
+
+    // With gang dispatch the gang listener polls this instance's doorbell
+    // instead, and a cycle may still be running on one of the worker pool's
+    // threads. Unregistering waits for that cycle to finish.
+    if (process_buffers_ && process_buffers_->has_gang()) {
+        GangDispatcher::instance().unregister_instance(this);
+    }
+    if (process_buffers_ && process_buffers_->has_doorbell()) {
+        process_buffers_->terminate_doorbell();
+    }
+
+    // An unloaded instance should no longer take up one of the overload
+    // governor's degradation slots
+    if (overload_instance_) {
+        OverloadGovernor::instance().unregister_instance(overload_instance_);
+        overload_instance_ = nullptr;
+    }
+
     sockets_.close();
 }
 
+/**
+ * Whether an opcode is a host callback query whose response is fixed for the
+ * lifetime of the host process and can thus be replayed locally, see
+ * `Vst2Bridge::host_query_cache_`.
+ */
+bool is_constant_host_query_opcode(const int opcode) noexcept {
+    switch (opcode) {
+        case audioMasterVersion:
+        case audioMasterCanDo:
+        case audioMasterGetVendorString:
+        case audioMasterGetProductString:
+        case audioMasterGetVendorVersion:
+        case audioMasterGetLanguage:
+            return true;
+        default:
+            return false;
+    }
+}
+
 class HostCallbackDataConverter : public DefaultDataConverter {
    public:
     HostCallbackDataConverter(
@@ -665,11 +1285,58 @@ intptr_t Vst2Bridge::host_callback(AEffect* effect,
                                    void* data,
                                    float option) {
     switch (opcode) {
+        // Plugins with internal MIDI learn fire `audioMasterAutomate()` for
+        // every control tick, so a hardware controller sweep would otherwise
+        // generate thousands of callback round trips per second. With the
+        // `automate_coalesce` option set, rapid successive values for the
+        // same parameter get merged and only the most recent one is
+        // forwarded when the coalescing window expires.
+        case audioMasterAutomate: {
+            if (config_.automate_coalesce) {
+                const std::optional<intptr_t> local_response =
+                    coalesce_automate(index, option);
+                if (local_response) {
+                    logger_.log_event(false, opcode, index, value, nullptr,
+                                      option, std::nullopt);
+                    logger_.log_event_response(false, opcode, *local_response,
+                                               nullptr, std::nullopt, true);
+
+                    return *local_response;
+                }
+            }
+        } break;
+        // Some plugins fire this callback dozens of times in a row while
+        // loading a preset, and every forwarded one costs a round trip plus
+        // a graph rebuild in the host. With the `notification_dedup_ms`
+        // option set, repeats within the window collapse into a single
+        // callback. The trailing resend reads the plugin's `AEffect` at send
+        // time, so the host's rebuild observes the settled values.
+        case audioMasterIOChanged: {
+            if (notification_dedup_) {
+                const bool forward = notification_dedup_->should_forward(
+                    audioMasterIOChanged, [this]() {
+                        HostCallbackDataConverter converter(
+                            plugin_, last_time_info_, mutual_recursion_);
+                        sockets_.plugin_host_callback_.send_event(
+                            converter, std::nullopt, audioMasterIOChanged, 0,
+                            0, nullptr, 0.0f);
+                    });
+                if (!forward) {
+                    logger_.log_event(false, opcode, index, value,
+                                      AEffect(*plugin_), option, std::nullopt);
+                    logger_.log_event_response(false, opcode, 1, nullptr,
+                                               std::nullopt, true);
+
+                    return 1;
+                }
+            }
+        } break;
         // During a processing call we'll have already sent the current
         // transport information from the plugin side to avoid an unnecessary
         // callback
         case audioMasterGetTime: {
-            const VstTimeInfo* cached_time_info = time_info_cache_.get();
+            const std::optional<VstTimeInfo> cached_time_info =
+                time_info_cache_.get();
             if (cached_time_info) {
                 // This cached value is temporary, so we'll still use the
                 // regular time info storing mechanism
@@ -685,10 +1352,35 @@ intptr_t Vst2Bridge::host_callback(AEffect* effect,
 
                 return result;
             }
+
+            // Outside of processing calls we can still answer from the time
+            // info mirror the native plugin refreshes for every processed
+            // block, which will be at most one block stale
+            if (process_buffers_ && process_buffers_->has_doorbell()) {
+                const std::optional<VstTimeInfo> mirrored_time_info =
+                    reinterpret_cast<const Vst2TimeInfoMirror*>(
+                        process_buffers_->doorbell_payload() +
+                        vst2_time_info_mirror_offset)
+                        ->read();
+                if (mirrored_time_info) {
+                    last_time_info_ = *mirrored_time_info;
+                    const intptr_t result =
+                        reinterpret_cast<intptr_t>(&last_time_info_);
+
+                    logger_.log_event(false, opcode, index, value,
+                                      WantsVstTimeInfo{}, option, std::nullopt);
+                    logger_.log_event_response(false, opcode, result,
+                                               last_time_info_, std::nullopt,
+                                               true);
+
+                    return result;
+                }
+            }
         } break;
         // We also send the current process level for similar reasons
         case audioMasterGetCurrentProcessLevel: {
-            const int* current_process_level = process_level_cache_.get();
+            const std::optional<int> current_process_level =
+                process_level_cache_.get();
             if (current_process_level) {
                 logger_.log_event(false, opcode, index, value, nullptr, option,
                                   std::nullopt);
@@ -699,6 +1391,28 @@ intptr_t Vst2Bridge::host_callback(AEffect* effect,
                 return *current_process_level;
             }
         } break;
+        // The deprecated `audioMasterNeedIdle()`/`effIdle()` pair is handled
+        // entirely on this side, just like `effEditIdle()` is driven from the
+        // editor's idle timer instead of being passed through. We'll run
+        // `effIdle()` from a timer until the plugin reports that it's done,
+        // and the native plugin side drops the host's own `effIdle()` calls.
+        case audioMasterNeedIdle: {
+            logger_.log_event(false, opcode, index, value, nullptr, option,
+                              std::nullopt);
+            logger_.log_event_response(false, opcode, 1, nullptr, std::nullopt,
+                                       true);
+
+            // Plugins may call this from any thread, and the timer should
+            // only ever be touched from the thread running `main_context_`
+            main_context_.schedule_task([this]() {
+                if (!needs_idle_) {
+                    needs_idle_ = true;
+                    schedule_plugin_idle();
+                }
+            });
+
+            return 1;
+        } break;
         // If the plugin changes its window size, we'll also resize the wrapper
         // window accordingly.
         case audioMasterSizeWindow: {
@@ -710,16 +1424,179 @@ intptr_t Vst2Bridge::host_callback(AEffect* effect,
 
     HostCallbackDataConverter converter(effect, last_time_info_,
                                         mutual_recursion_);
+
+    // A good chunk of the callback traffic consists of queries whose answers
+    // cannot change for as long as the host process lives: the host's
+    // version, its vendor and product strings, and its `audioMasterCanDo()`
+    // capability set. After the first round trip the previous response gets
+    // replayed locally, just like the idempotent dispatcher queries are
+    // replayed on the native side.
+    if (is_constant_host_query_opcode(opcode)) {
+        const Vst2Event::Payload request_payload =
+            converter.read_data(opcode, index, value, data);
+        const std::string_view* query =
+            std::get_if<std::string_view>(&request_payload);
+        std::pair<int, std::string> cache_key(
+            opcode, query ? std::string(*query) : std::string());
+
+        std::optional<Vst2EventResult> cached_response{};
+        {
+            std::lock_guard lock(host_query_cache_mutex_);
+            if (const auto it = host_query_cache_.find(cache_key);
+                it != host_query_cache_.end()) {
+                cached_response = it->second;
+            }
+        }
+
+        if (cached_response) {
+            logger_.log_event(false, opcode, index, value, request_payload,
+                              option, std::nullopt);
+
+            converter.write_data(opcode, data, *cached_response);
+            converter.write_value(opcode, value, *cached_response);
+
+            const intptr_t return_value =
+                converter.return_value(opcode, cached_response->return_value);
+            logger_.log_event_response(false, opcode, return_value,
+                                       cached_response->payload,
+                                       cached_response->value_payload, true);
+
+            return return_value;
+        }
+
+        const intptr_t return_value = sockets_.plugin_host_callback_.send_event(
+            converter, std::nullopt, opcode, index, value, data, option);
+
+        // Rebuild the response from what the converter just wrote back to
+        // `data`, so the next identical query can be answered by replaying it
+        // through the same `write_data()` path
+        Vst2EventResult response{.return_value = return_value,
+                                 .payload = nullptr,
+                                 .value_payload = std::nullopt};
+        switch (opcode) {
+            case audioMasterGetVendorString:
+            case audioMasterGetProductString:
+                response.payload = std::string(static_cast<const char*>(data));
+                break;
+        }
+
+        std::lock_guard lock(host_query_cache_mutex_);
+        host_query_cache_[std::move(cache_key)] = std::move(response);
+
+        return return_value;
+    }
+
     return sockets_.plugin_host_callback_.send_event(
         converter, std::nullopt, opcode, index, value, data, option);
 }
 
+std::optional<intptr_t> Vst2Bridge::coalesce_automate(int parameter,
+                                                      float value) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(automate_coalesce_mutex_);
+
+    // When a flush is already waiting on a value for this parameter we'll
+    // just replace it, so only the burst's most recent value survives
+    if (const auto it = pending_automate_values_.find(parameter);
+        it != pending_automate_values_.end()) {
+        it->second = value;
+        return 0;
+    }
+
+    // The first value after a quiet period passes through as is so one-shot
+    // automation (like clicking a control once) keeps its timing. Only
+    // values that follow another one within the window get held back.
+    if (const auto it = last_automate_sent_.find(parameter);
+        it != last_automate_sent_.end() &&
+        now - it->second < automate_coalesce_window()) {
+        pending_automate_values_[parameter] = value;
+        if (!automate_flush_scheduled_) {
+            automate_flush_scheduled_ = true;
+            // Timers should only ever be touched from the thread running
+            // `main_context_`, like the plugin idle timer
+            main_context_.schedule_task(
+                [this]() { schedule_automate_flush(); });
+        }
+        return 0;
+    }
+
+    last_automate_sent_[parameter] = now;
+    return std::nullopt;
+}
+
+std::chrono::steady_clock::duration Vst2Bridge::automate_coalesce_window()
+    const noexcept {
+    if (*config_.automate_coalesce > 0) {
+        return std::chrono::milliseconds(*config_.automate_coalesce);
+    }
+
+    // The default window is the duration of one audio block. Some hosts
+    // never call `effSetBlockSize()`, in which case we'll just assume a
+    // moderate size.
+    const uint32_t block_size = max_samples_per_block_.value_or(512);
+    const float sample_rate = sample_rate_ > 0.0f ? sample_rate_ : 44100.0f;
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<float>(static_cast<float>(block_size) /
+                                     sample_rate));
+}
+
+void Vst2Bridge::schedule_automate_flush() {
+    automate_flush_timer_.expires_after(automate_coalesce_window());
+    automate_flush_timer_.async_wait([this](const std::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        flush_pending_automate_values();
+    });
+}
+
+void Vst2Bridge::flush_pending_automate_values() {
+    std::map<int, float> pending_values{};
+    {
+        std::lock_guard lock(automate_coalesce_mutex_);
+        pending_values.swap(pending_automate_values_);
+        automate_flush_scheduled_ = false;
+
+        // Refreshing the forwarded timestamps here means an ongoing sweep
+        // keeps getting coalesced into one callback per window
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& [parameter, value] : pending_values) {
+            last_automate_sent_[parameter] = now;
+        }
+    }
+
+    HostCallbackDataConverter converter(plugin_, last_time_info_,
+                                        mutual_recursion_);
+    for (const auto& [parameter, value] : pending_values) {
+        sockets_.plugin_host_callback_.send_event(converter, std::nullopt,
+                                                  audioMasterAutomate,
+                                                  parameter, 0, nullptr, value);
+    }
+}
+
 intptr_t Vst2Bridge::dispatch_wrapper(AEffect* plugin,
                                       int opcode,
                                       int index,
                                       intptr_t value,
                                       void* data,
                                       float option) {
+    // Every dispatcher call runs through this function, on the thread that
+    // actually calls into the plugin. That makes it the single place to
+    // account for the instance's non-audio CPU usage.
+    ScopedLoadTimer load_timer(*this, ScopedLoadTimer::Kind::control);
+
+    // With the `editor_deferred_open` option set, the plugin's actual
+    // `effEditOpen()` call may still be pending when the host follows up with
+    // another editor interaction. Those have to wait for the open to finish,
+    // so we'll just run it inline here. These opcodes are all part of
+    // `unsafe_requests`, so this always happens on the GUI thread.
+    if (pending_editor_open_ &&
+        (opcode == effEditGetRect || opcode == effEditClose ||
+         opcode == effEditIdle || opcode == effEditTop)) {
+        maybe_run_deferred_editor_open();
+    }
+
     // We have to intercept GUI open calls since we can't use the X11 window
     // handle passed by the host. Keep in mind that in our `run()` function
     // above some of these events will be called on some arbitrary thread (where
@@ -727,6 +1604,35 @@ intptr_t Vst2Bridge::dispatch_wrapper(AEffect* plugin,
     // main thread using `main_context.run_in_context()` (where we don't use
     // realtime scheduling).
     switch (opcode) {
+        case effOpen: {
+            const intptr_t return_value =
+                plugin->dispatcher(plugin, opcode, index, value, data, option);
+
+            // When the `snapshot_interval` option is enabled and a previous
+            // host process died with this plugin loaded, we'll restore the
+            // state snapshot that process left behind. A host that restores
+            // its own saved state afterwards simply overwrites this again.
+            if (recovered_state_) {
+                logger_.log(
+                    "Restoring a state snapshot left behind by a crashed "
+                    "host process");
+                plugin->dispatcher(
+                    plugin, effSetChunk, 0,
+                    static_cast<intptr_t>(recovered_state_->size()),
+                    recovered_state_->data(), 0.0f);
+                recovered_state_.reset();
+            }
+
+            return return_value;
+        } break;
+        case effSetSampleRate: {
+            // Used to compute the default one-block window for the
+            // `automate_coalesce` option
+            sample_rate_ = option;
+
+            return plugin->dispatcher(plugin, opcode, index, value, data,
+                                      option);
+        } break;
         case effSetBlockSize: {
             // Used to initialize the shared audio buffers when handling
             // `effMainsChanged` in `Vst2Bridge::run()`
@@ -735,7 +1641,42 @@ intptr_t Vst2Bridge::dispatch_wrapper(AEffect* plugin,
             return plugin->dispatcher(plugin, opcode, index, value, data,
                                       option);
         } break;
+        case effMainsChanged: {
+            // If we hibernated this instance because it went silent, then the
+            // plugin is already suspended even though the host thinks it's
+            // still running. A suspend from the host would be the plugin's
+            // second one in that case, so we'll just swallow it. A resume is
+            // forwarded as is, since waking up from hibernation is exactly
+            // what the plugin needs then. We also keep track of the host's
+            // intended state here, because `maybe_hibernate()` should only
+            // ever touch instances the host left in their resumed state.
+            if (value == 0 &&
+                hibernated_.exchange(false, std::memory_order_relaxed)) {
+                host_resumed_.store(false, std::memory_order_relaxed);
+
+                return 0;
+            }
+
+            if (value == 1) {
+                hibernated_.store(false, std::memory_order_relaxed);
+                last_audio_activity_.store(std::chrono::steady_clock::now()
+                                               .time_since_epoch()
+                                               .count(),
+                                           std::memory_order_relaxed);
+            }
+            host_resumed_.store(value == 1, std::memory_order_relaxed);
+
+            return plugin->dispatcher(plugin, opcode, index, value, data,
+                                      option);
+        } break;
         case effEditOpen: {
+            // A hibernated instance gets woken up before its editor opens,
+            // since the user is clearly about to interact with it again
+            if (hibernated_.exchange(false, std::memory_order_relaxed)) {
+                plugin->dispatcher(plugin, effMainsChanged, 0, 1, nullptr,
+                                   0.0f);
+            }
+
             // Create a Win32 window through Wine, embed it into the window
             // provided by the host, and let the plugin embed itself into
             // the Wine window
@@ -743,33 +1684,65 @@ intptr_t Vst2Bridge::dispatch_wrapper(AEffect* plugin,
 
             Editor& editor_instance = editor_.emplace(
                 main_context_, config_, generic_logger_, x11_handle,
-                [plugin = plugin_]() {
+                [this, plugin = plugin_]() {
+                    // The idle timer may start ticking before a deferred
+                    // `effEditOpen()` call has actually run
+                    if (pending_editor_open_) {
+                        return;
+                    }
+
                     plugin->dispatcher(plugin, effEditIdle, 0, 0, nullptr, 0.0);
                 });
 
-            const intptr_t result =
-                plugin->dispatcher(plugin, opcode, index, value,
-                                   editor_instance.win32_handle(), option);
-
-            // Make sure the wrapper window has the correct initial size. The
-            // plugin can later change this size using `audioMasterSizeWindow`.
-            // NOTE: Every single plugin handles `effEditGetRect` before
-            //       `effEditOpen` fine. Except for this one single plugin:
-            //       https://codefn42.com/randarp/index.html
-            VstRect* editor_rect = nullptr;
-            plugin->dispatcher(plugin, effEditGetRect, 0, 0, &editor_rect, 0.0);
-            if (editor_rect) {
-                editor_->resize(editor_rect->right - editor_rect->left,
-                                editor_rect->bottom - editor_rect->top);
-            }
+            auto open_editor = [this, plugin, opcode, index, value, option,
+                                editor_window =
+                                    editor_instance.win32_handle()]() {
+                const intptr_t result = plugin->dispatcher(
+                    plugin, opcode, index, value, editor_window, option);
+
+                // Make sure the wrapper window has the correct initial size.
+                // The plugin can later change this size using
+                // `audioMasterSizeWindow`.
+                // NOTE: Every single plugin handles `effEditGetRect` before
+                //       `effEditOpen` fine. Except for this one single plugin:
+                //       https://codefn42.com/randarp/index.html
+                VstRect* editor_rect = nullptr;
+                plugin->dispatcher(plugin, effEditGetRect, 0, 0, &editor_rect,
+                                   0.0);
+                if (editor_rect && editor_) {
+                    editor_->resize(editor_rect->right - editor_rect->left,
+                                    editor_rect->bottom - editor_rect->top);
+                }
 
-            // NOTE: There's zero reason why the window couldn't already be
-            //       visible from the start, but Waves V13 VST3 plugins think it
-            //       would be a splendid idea to randomly dereference null
-            //       pointers when the window is already visible. Thanks Waves.
-            editor_instance.show();
+                // NOTE: There's zero reason why the window couldn't already be
+                //       visible from the start, but Waves V13 VST3 plugins
+                //       think it would be a splendid idea to randomly
+                //       dereference null pointers when the window is already
+                //       visible. Thanks Waves.
+                if (editor_) {
+                    editor_->show();
+                }
 
-            return result;
+                return result;
+            };
+
+            // With the `editor_deferred_open` option set the host gets its UI
+            // thread back immediately, with the already embedded but still
+            // empty wrapper window acting as a placeholder. The plugin then
+            // embeds itself into it right afterwards. Any other editor
+            // interaction coming in before that runs the open inline first,
+            // see the check at the top of this function.
+            if (config_.editor_deferred_open) {
+                pending_editor_open_ = std::move(open_editor);
+                main_context_.schedule_task(
+                    [this]() { maybe_run_deferred_editor_open(); });
+
+                // Hosts generally don't check this return value, and plugins
+                // that advertise an editor in practice never fail to open it
+                return 1;
+            }
+
+            return open_editor();
         } break;
         case effEditClose: {
             // Cleanup is handled through RAII
@@ -796,6 +1769,166 @@ intptr_t Vst2Bridge::dispatch_wrapper(AEffect* plugin,
     }
 }
 
+Vst2EventResult Vst2Bridge::get_program_names() {
+    const int num_programs = plugin_->numPrograms;
+
+    Vst2ProgramNames program_names{};
+    if (num_programs > 0) {
+        program_names.names.reserve(static_cast<size_t>(num_programs));
+    }
+
+    // `effGetProgramNameIndexed()` is one of the
+    // `safe_mutually_recursive_requests`, so the enumeration uses the same
+    // mutual recursion handling that individually forwarded queries would
+    const bool supported = mutual_recursion_.handle([&]() {
+        std::array<char, max_string_length> name_buffer;
+        for (int program = 0; program < num_programs; program++) {
+            name_buffer.fill(0);
+            if (dispatch_wrapper(plugin_, effGetProgramNameIndexed, program, 0,
+                                 name_buffer.data(), 0.0f) == 0) {
+                return false;
+            }
+
+            program_names.names.emplace_back(name_buffer.data());
+        }
+
+        return true;
+    });
+
+    // When the plugin rejects one of the queries we'll report the whole
+    // prefetch as unsupported, and the native side keeps forwarding the
+    // host's individual `effGetProgramNameIndexed()` calls instead
+    if (!supported) {
+        return Vst2EventResult{.return_value = 0,
+                               .payload = nullptr,
+                               .value_payload = std::nullopt};
+    }
+
+    return Vst2EventResult{.return_value = 1,
+                           .payload = std::move(program_names),
+                           .value_payload = std::nullopt};
+}
+
+Vst2ProgramBundle Vst2Bridge::collect_program_bundle() {
+    Vst2ProgramBundle bundle{};
+    update_aeffect(bundle.aeffect, *plugin_);
+
+    // An empty value array tells the native side to keep forwarding the
+    // host's reads, which only ever happens with a nonsensical parameter
+    // count
+    const int num_params = plugin_->numParams;
+    if (num_params > 0 &&
+        static_cast<size_t>(num_params) <= max_program_parameters) {
+        bundle.values.resize(static_cast<size_t>(num_params));
+        for (int param = 0; param < num_params; param++) {
+            bundle.values[static_cast<size_t>(param)] =
+                plugin_->getParameter(plugin_, param);
+        }
+    }
+
+    return bundle;
+}
+
+Vst2EventResult Vst2Bridge::map_host_buffers(
+    const Vst2HostBufferMap& buffer_map) {
+    const Vst2EventResult failure{.return_value = 0,
+                                  .payload = nullptr,
+                                  .value_payload = std::nullopt};
+
+    // Several channels usually share the same backing file, so we'll map
+    // every distinct file once per direction, covering all of its channels.
+    // The input mappings are read-only both because we only ever read inputs
+    // from them and so a misbehaving plugin that writes to its input buffers
+    // crashes cleanly here instead of scribbling over the host's memory. The
+    // output mappings need to be writable since the plugin renders straight
+    // into them.
+    std::vector<std::pair<void*, size_t>> new_regions{};
+    const auto unmap_new_regions = [&]() {
+        for (const auto& [region, region_size] : new_regions) {
+            munmap(region, region_size);
+        }
+    };
+
+    const auto map_channels =
+        [&](const std::vector<Vst2HostBufferMap::Channel>& channels,
+            const int open_flags, const int protection,
+            AudioShmBuffer::ChannelPointers& pointers) -> bool {
+        std::map<int32_t, std::pair<void*, size_t>> regions_by_fd{};
+        for (const Vst2HostBufferMap::Channel& channel : channels) {
+            const size_t needed_size =
+                static_cast<size_t>(channel.offset + buffer_map.channel_size);
+            auto region = regions_by_fd.find(channel.fd);
+            if (region == regions_by_fd.end() ||
+                region->second.second < needed_size) {
+                // The native host process' file descriptors can be reopened
+                // through procfs since both processes run as the same user
+                const std::string fd_path =
+                    "/proc/" + std::to_string(buffer_map.pid) + "/fd/" +
+                    std::to_string(channel.fd);
+                const int fd = open(fd_path.c_str(), open_flags);
+                if (fd == -1) {
+                    return false;
+                }
+
+                // If the file is smaller than the request claims then
+                // something must have changed since the native side scanned
+                // its mappings, and mapping beyond the end would get the
+                // plugin killed with a SIGBUS when it reads there
+                struct stat file_info {};
+                if (fstat(fd, &file_info) != 0 ||
+                    static_cast<size_t>(file_info.st_size) < needed_size) {
+                    close(fd);
+                    return false;
+                }
+
+                void* mapped_region =
+                    mmap(nullptr, needed_size, protection, MAP_SHARED, fd, 0);
+                close(fd);
+                if (mapped_region == MAP_FAILED) {
+                    return false;
+                }
+
+                new_regions.emplace_back(mapped_region, needed_size);
+                region =
+                    regions_by_fd
+                        .insert_or_assign(
+                            channel.fd,
+                            std::pair(mapped_region, needed_size))
+                        .first;
+            }
+
+            pointers.push_back(
+                static_cast<uint8_t*>(region->second.first) + channel.offset);
+        }
+
+        return true;
+    };
+
+    AudioShmBuffer::ChannelPointers new_input_pointers{};
+    AudioShmBuffer::ChannelPointers new_output_pointers{};
+    if (!map_channels(buffer_map.channels, O_RDONLY, PROT_READ,
+                      new_input_pointers) ||
+        !map_channels(buffer_map.output_channels, O_RDWR,
+                      PROT_READ | PROT_WRITE, new_output_pointers)) {
+        unmap_new_regions();
+        return failure;
+    }
+
+    // The native side never flags a processing call with `use_mapped_inputs`
+    // or `use_mapped_outputs` while this negotiation is in flight, so the
+    // old regions can't be in use anymore
+    for (const auto& [region, region_size] : mapped_host_regions_) {
+        munmap(region, region_size);
+    }
+    mapped_host_regions_ = std::move(new_regions);
+    mapped_input_pointers_ = std::move(new_input_pointers);
+    mapped_output_pointers_ = std::move(new_output_pointers);
+
+    return Vst2EventResult{.return_value = 1,
+                           .payload = nullptr,
+                           .value_payload = std::nullopt};
+}
+
 AudioShmBuffer::Config Vst2Bridge::setup_shared_audio_buffers() {
     assert(max_samples_per_block_);
 
@@ -808,18 +1941,52 @@ AudioShmBuffer::Config Vst2Bridge::setup_shared_audio_buffers() {
     const size_t sample_size =
         (double_precision_ ? sizeof(double) : sizeof(float));
 
-    uint32_t current_offset = 0;
-
-    std::vector<uint32_t> input_channel_offsets(plugin_->numInputs);
-    for (int channel = 0; channel < plugin_->numInputs; channel++) {
-        input_channel_offsets[channel] = current_offset;
-        current_offset += *max_samples_per_block_ * sample_size;
+    // The first page of the shared memory object is reserved for the futex
+    // doorbell used to signal steady-state audio processing cycles without
+    // going through a socket
+    uint32_t current_offset = AudioShmBuffer::doorbell_reserved_size;
+
+    // Right after the doorbell page we'll reserve a fixed-capacity event area
+    // per buffer bank, so small `effProcessEvents()` batches can be passed
+    // along with the audio instead of being serialized over the dispatcher
+    // socket
+    const uint32_t num_event_banks = config_.audio_pipelining ? 2 : 1;
+    llvm::SmallVector<uint32_t, 2> event_area_offsets(num_event_banks);
+    for (uint32_t bank = 0; bank < num_event_banks; bank++) {
+        event_area_offsets[bank] = current_offset;
+        current_offset += vst2_event_area_size;
     }
 
-    std::vector<uint32_t> output_channel_offsets(plugin_->numOutputs);
-    for (int channel = 0; channel < plugin_->numOutputs; channel++) {
-        output_channel_offsets[channel] = current_offset;
-        current_offset += *max_samples_per_block_ * sample_size;
+    const auto layout_bank = [&]() {
+        AudioShmBuffer::ChannelOffsets input_channel_offsets(
+            plugin_->numInputs);
+        for (int channel = 0; channel < plugin_->numInputs; channel++) {
+            input_channel_offsets[channel] = current_offset;
+            current_offset += *max_samples_per_block_ * sample_size;
+        }
+
+        AudioShmBuffer::ChannelOffsets output_channel_offsets(
+            plugin_->numOutputs);
+        for (int channel = 0; channel < plugin_->numOutputs; channel++) {
+            output_channel_offsets[channel] = current_offset;
+            current_offset += *max_samples_per_block_ * sample_size;
+        }
+
+        return std::make_pair(std::move(input_channel_offsets),
+                              std::move(output_channel_offsets));
+    };
+
+    auto [input_channel_offsets, output_channel_offsets] = layout_bank();
+
+    // With the `audio_pipelining` option enabled we'll lay out a second bank
+    // of buffers right after the first one, so the native plugin side can
+    // write the next block's inputs while we're still processing the current
+    // block
+    AudioShmBuffer::ChannelOffsets input_channel_offsets_secondary{};
+    AudioShmBuffer::ChannelOffsets output_channel_offsets_secondary{};
+    if (config_.audio_pipelining) {
+        std::tie(input_channel_offsets_secondary,
+                 output_channel_offsets_secondary) = layout_bank();
     }
 
     // The size of the buffer is in bytes, and it will depend on whether the
@@ -832,35 +1999,73 @@ AudioShmBuffer::Config Vst2Bridge::setup_shared_audio_buffers() {
     AudioShmBuffer::Config buffer_config{
         .name = sockets_.base_dir_.filename().string(),
         .size = buffer_size,
-        .input_offsets = {std::move(input_channel_offsets)},
-        .output_offsets = {std::move(output_channel_offsets)}};
+        .doorbell_enabled = true,
+        .huge_pages = config_.audio_huge_pages,
+        .spin_wait_us = config_.audio_spin_us,
+        .busy_poll = config_.audio_busy_poll,
+        .numa_node = config_.numa_node ? static_cast<int32_t>(*config_.numa_node)
+                                       : -1,
+        .event_offsets = std::move(event_area_offsets)};
+    // With gang dispatch all instances hosted in this process ring one
+    // shared doorbell, and the gang listener fans the calls out to the
+    // worker pool, see `GangDispatcher`. The name is only set when the
+    // dispatcher is actually operational, since a native side ringing a
+    // gang doorbell nobody listens on would block forever.
+    if (config_.audio_gang_dispatch && GangDispatcher::instance().prepare()) {
+        buffer_config.gang_name = GangDispatcher::gang_object_name();
+    }
+    // VST2 plugins only have a single bus. Pushing the channel offsets into
+    // place instead of using an initializer list avoids copying them.
+    buffer_config.input_offsets.push_back(std::move(input_channel_offsets));
+    buffer_config.output_offsets.push_back(std::move(output_channel_offsets));
+    if (config_.audio_pipelining) {
+        buffer_config.input_offsets_secondary.push_back(
+            std::move(input_channel_offsets_secondary));
+        buffer_config.output_offsets_secondary.push_back(
+            std::move(output_channel_offsets_secondary));
+    }
     if (!process_buffers_) {
-        process_buffers_.emplace(buffer_config);
+        // The audio thread and the parameter RPC thread will be waiting for
+        // the buffers and the doorbell to come online, so we'll wake them up
+        // after setting them up
+        {
+            std::lock_guard lock(process_buffers_doorbell_mutex_);
+            process_buffers_.emplace(buffer_config);
+        }
+        process_buffers_doorbell_cv_.notify_all();
     } else {
         process_buffers_->resize(buffer_config);
     }
 
     // The process functions expect a `T**` for their inputs and outputs, so
-    // we'll also set those up right now
-    process_buffers_input_pointers_.resize(plugin_->numInputs);
-    for (int channel = 0; channel < plugin_->numInputs; channel++) {
-        if (double_precision_) {
-            process_buffers_input_pointers_[channel] =
-                process_buffers_->input_channel_ptr<double>(0, channel);
-        } else {
-            process_buffers_input_pointers_[channel] =
-                process_buffers_->input_channel_ptr<float>(0, channel);
+    // we'll also set those up right now. The second bank only exists when the
+    // `audio_pipelining` option is enabled.
+    const uint32_t num_banks = process_buffers_->double_buffered() ? 2 : 1;
+    for (uint32_t bank = 0; bank < num_banks; bank++) {
+        process_buffers_input_pointers_[bank].resize(plugin_->numInputs);
+        for (int channel = 0; channel < plugin_->numInputs; channel++) {
+            if (double_precision_) {
+                process_buffers_input_pointers_[bank][channel] =
+                    process_buffers_->input_channel_ptr<double>(bank, 0,
+                                                                channel);
+            } else {
+                process_buffers_input_pointers_[bank][channel] =
+                    process_buffers_->input_channel_ptr<float>(bank, 0,
+                                                               channel);
+            }
         }
-    }
 
-    process_buffers_output_pointers_.resize(plugin_->numOutputs);
-    for (int channel = 0; channel < plugin_->numOutputs; channel++) {
-        if (double_precision_) {
-            process_buffers_output_pointers_[channel] =
-                process_buffers_->output_channel_ptr<double>(0, channel);
-        } else {
-            process_buffers_output_pointers_[channel] =
-                process_buffers_->output_channel_ptr<float>(0, channel);
+        process_buffers_output_pointers_[bank].resize(plugin_->numOutputs);
+        for (int channel = 0; channel < plugin_->numOutputs; channel++) {
+            if (double_precision_) {
+                process_buffers_output_pointers_[bank][channel] =
+                    process_buffers_->output_channel_ptr<double>(bank, 0,
+                                                                 channel);
+            } else {
+                process_buffers_output_pointers_[bank][channel] =
+                    process_buffers_->output_channel_ptr<float>(bank, 0,
+                                                                channel);
+            }
         }
     }
 
@@ -18,13 +18,21 @@
 
 #include "../use-linux-asio.h"
 
+#include <array>
+#include <condition_variable>
+#include <map>
+
 #include <vestige/aeffectx.h>
 #include <windows.h>
+#include <function2/function2.hpp>
 
 #include "../../common/communication/vst2.h"
 #include "../../common/configuration.h"
 #include "../../common/mutual-recursion.h"
 #include "../editor.h"
+#include "../notification-dedup.h"
+#include "../overload-governor.h"
+#include "../state-snapshots.h"
 #include "common.h"
 
 /**
@@ -59,6 +67,13 @@ class Vst2Bridge : public HostBridge {
                std::string endpoint_base_dir,
                pid_t parent_pid);
 
+    /**
+     * Wakes up the audio thread in case it's still blocked on the shared
+     * memory doorbell, since that has to happen before the thread handles are
+     * destroyed.
+     */
+    ~Vst2Bridge() noexcept override;
+
     bool inhibits_event_loop() noexcept override;
 
     /**
@@ -96,6 +111,162 @@ class Vst2Bridge : public HostBridge {
      */
     AudioShmBuffer::Config setup_shared_audio_buffers();
 
+    /**
+     * Query all of the plugin's program names through
+     * `effGetProgramNameIndexed()` and return them as a single
+     * `Vst2ProgramNames` response. This is the handler for the
+     * `vst2_get_program_names_opcode` events the native plugin sends to
+     * prefetch the whole table in one round trip, see
+     * `Vst2PluginBridge::prefetch_program_names()`. Returns a result with a
+     * return value of 0 and an empty table when the plugin doesn't support
+     * the query, so the native side falls back to forwarding the host's
+     * individual queries.
+     */
+    Vst2EventResult get_program_names();
+
+    /**
+     * Gather the plugin's state right after an `effSetProgram()` call: the
+     * `AEffect` fields and every parameter's value for the newly loaded
+     * program. This gets sent back as the `effSetProgram()` response so the
+     * native side can answer the host's follow-up reads locally instead of
+     * forwarding them one round trip at a time, see
+     * `Vst2PluginBridge::program_values_cache_`.
+     */
+    Vst2ProgramBundle collect_program_bundle();
+
+    /**
+     * Map the native host's own audio buffers into this process, inputs
+     * read-only and outputs read-write. This is the handler for the
+     * `vst2_map_host_buffers_opcode` events the native plugin sends when the
+     * `audio_zero_copy_input` or `audio_zero_copy_output` option is enabled
+     * and the host's buffers were detected to live in shared, file backed
+     * memory, see `Vst2PluginBridge::try_use_mapped_host_buffers()`. The
+     * file descriptors in the request are resolved through `/proc/<pid>/fd/`.
+     * Returns a result with a return value of 1 when all channels could be
+     * mapped, and 0 when any of them could not, in which case the native
+     * side keeps copying as usual.
+     */
+    Vst2EventResult map_host_buffers(const Vst2HostBufferMap& buffer_map);
+
+    /**
+     * Handle a single audio processing cycle. The native plugin side will have
+     * written the input audio to the shared memory buffers before sending the
+     * request, and the outputs will be written to those same buffers. Called
+     * from the audio thread whenever the doorbell embedded in
+     * `process_buffers_` gets rung, with `next_buffer_midi_events_mutex_`
+     * held for the duration of the call.
+     *
+     * @param process_request The metadata for this processing cycle.
+     * @param bank The buffer bank the inputs were written to. This is always 0
+     *   unless the `audio_pipelining` option is enabled.
+     */
+    void handle_process_request(const Vst2ProcessRequest& process_request,
+                                uint32_t bank);
+
+    /**
+     * Run one full audio processing cycle for a ring of the processing
+     * doorbell, from reading the call's metadata out of the doorbell payload
+     * up to and including ringing the completion word. Called from the audio
+     * thread's doorbell loop, or from a worker pool thread when the
+     * `audio_gang_dispatch` option routes the rings through the process wide
+     * gang listener. In the latter case `use_worker_pool` is false since the
+     * cycle already runs on one of the pool's workers.
+     *
+     * @param message The message passed along with the ring, used to select
+     *   the buffer bank when the `audio_pipelining` option is enabled.
+     * @param use_worker_pool Whether `handle_process_request()` should go
+     *   through `AudioWorkerPool::run()`.
+     */
+    void run_audio_cycle(uint32_t message, bool use_worker_pool);
+
+    /**
+     * (Re)arm `hibernation_timer_` so `maybe_hibernate()` runs periodically.
+     * Only called when the `hibernate_after` option is set.
+     */
+    void schedule_hibernation_check();
+
+    /**
+     * Suspend the plugin and release the shared audio buffers' backing pages
+     * when this instance hasn't processed any audio for longer than the
+     * `hibernate_after` option allows. Called periodically from
+     * `hibernation_timer_`, so this always runs on the GUI thread. The
+     * instance gets resumed again transparently when the next audio
+     * processing request comes in or when the host opens the editor.
+     */
+    void maybe_hibernate();
+
+    /**
+     * (Re)arm `snapshot_timer_` so `take_state_snapshot()` runs periodically.
+     * Only called when the `snapshot_interval` option is set.
+     */
+    void schedule_state_snapshot();
+
+    /**
+     * Write the plugin's current state chunk to this instance's slot in the
+     * state snapshot spool for crash recovery. Called periodically from
+     * `snapshot_timer_`, so like the hibernation checks this always runs on
+     * the GUI thread. Plugins without chunk support are skipped since
+     * `effGetChunk()` returns nothing for those.
+     */
+    void take_state_snapshot();
+
+    /**
+     * (Re)arm `needs_idle_timer_` so `run_plugin_idle()` runs periodically.
+     * Only called after the plugin has requested idle processing through
+     * `audioMasterNeedIdle()`.
+     */
+    void schedule_plugin_idle();
+
+    /**
+     * Dispatch `effIdle()` to the plugin after it has asked for idle calls
+     * through `audioMasterNeedIdle()`. Called periodically from
+     * `needs_idle_timer_`, so this always runs on the GUI thread. Clears
+     * `needs_idle_` again when the plugin returns 0 to indicate that it's
+     * done.
+     */
+    void run_plugin_idle();
+
+    /**
+     * Run the plugin's actual `effEditOpen()` call if the
+     * `editor_deferred_open` option postponed it, see `pending_editor_open_`.
+     * Does nothing when no open is pending. Always runs on the GUI thread.
+     */
+    void maybe_run_deferred_editor_open();
+
+    /**
+     * Decide what to do with an `audioMasterAutomate()` callback when the
+     * `automate_coalesce` option is set. Returns a nullopt when the callback
+     * should be forwarded to the host as is, and a locally produced return
+     * value when it has been swallowed because another value for the same
+     * parameter was forwarded less than one coalescing window ago. Swallowed
+     * values are not lost: the most recent one is sent when the window
+     * expires, see `flush_pending_automate_values()`.
+     */
+    std::optional<intptr_t> coalesce_automate(int parameter, float value);
+
+    /**
+     * The length of the coalescing window for the `automate_coalesce`
+     * option: either the configured number of milliseconds, or the duration
+     * of one audio block at the current block size and sample rate.
+     */
+    std::chrono::steady_clock::duration automate_coalesce_window()
+        const noexcept;
+
+    /**
+     * (Re)arm `automate_flush_timer_` so the pending coalesced automation
+     * values get forwarded when the current window expires. Only called
+     * after `coalesce_automate()` has swallowed a value.
+     */
+    void schedule_automate_flush();
+
+    /**
+     * Forward the most recent swallowed value for every parameter in
+     * `pending_automate_values_` to the host. Called from
+     * `automate_flush_timer_`, so this always runs on the GUI thread, which
+     * is fine since plugins may fire this callback from any thread anyway.
+     */
+    void flush_pending_automate_values();
+
     /**
      * A logger instance we'll use log cached `audioMasterGetTime()` calls, so
      * they can be hidden on verbosity levels below 2.
@@ -125,19 +296,78 @@ class Vst2Bridge : public HostBridge {
      */
     std::optional<AudioShmBuffer> process_buffers_;
 
+    /**
+     * The audio thread blocks on this condition variable until
+     * `process_buffers_` and its doorbell have been set up during
+     * `effMainsChanged()`. After that all audio processing requests come in
+     * through the doorbell rather than through the audio socket, so we don't
+     * pay for a socket round trip on every processed buffer.
+     */
+    std::condition_variable process_buffers_doorbell_cv_;
+    std::mutex process_buffers_doorbell_mutex_;
+
+    /**
+     * Set when the sockets get closed so the audio thread also wakes up and
+     * terminates when the buffers were never initialized.
+     */
+    std::atomic_bool audio_thread_shutdown_ = false;
+
+    /**
+     * The request object reused by `run_audio_cycle()` so the audio
+     * processing loop never allocates. The native side blocks on the
+     * completion word between rings, so at most one cycle uses this at a
+     * time regardless of whether the cycles run on the audio thread or on
+     * the worker pool.
+     */
+    Vst2ProcessRequest process_request_{};
+
     /**
      * Pointers to the input channels in process_buffers so we can pass them to
-     * the plugin. These can be either `float*` or `double*`, so we sadly have
-     * to use void pointers here.
+     * the plugin, one set per buffer bank. These can be either `float*` or
+     * `double*`, so we sadly have to use void pointers here. Only the first
+     * bank is used unless the `audio_pipelining` option is enabled.
      */
-    std::vector<void*> process_buffers_input_pointers_;
+    std::array<AudioShmBuffer::ChannelPointers, 2> process_buffers_input_pointers_;
 
     /**
      * Pointers to the output channels in process_buffers so we can pass them to
-     * the plugin. These can be either `float*` or `double*`, so we sadly have
-     * to use void pointers here.
+     * the plugin, one set per buffer bank. These can be either `float*` or
+     * `double*`, so we sadly have to use void pointers here. Only the first
+     * bank is used unless the `audio_pipelining` option is enabled.
+     */
+    std::array<AudioShmBuffer::ChannelPointers, 2> process_buffers_output_pointers_;
+
+    /**
+     * Pointers into the native host's own input buffers after
+     * `map_host_buffers()` has mapped them, one per input channel. Used
+     * instead of the shared memory input pointers for processing calls
+     * flagged with `Vst2ProcessMetadata::use_mapped_inputs`, see the
+     * `audio_zero_copy_input` option. Empty when no mapping is active.
      */
-    std::vector<void*> process_buffers_output_pointers_;
+    AudioShmBuffer::ChannelPointers mapped_input_pointers_;
+
+    /**
+     * Pointers into the native host's own output buffers after
+     * `map_host_buffers()` has mapped them read-write, one per output
+     * channel. Used instead of the shared memory output pointers for
+     * processing calls flagged with
+     * `Vst2ProcessMetadata::use_mapped_outputs`, see the
+     * `audio_zero_copy_output` option. Empty when no output mapping is
+     * active.
+     */
+    AudioShmBuffer::ChannelPointers mapped_output_pointers_;
+
+    /**
+     * The memory regions backing `mapped_input_pointers_` (read-only) and
+     * `mapped_output_pointers_` (read-write), one per distinct file and
+     * direction in the mapping request along with its mapped length.
+     * Unmapped when the native side negotiates a new mapping and when the
+     * instance shuts down. The native side never flags a processing call
+     * with `use_mapped_inputs` or `use_mapped_outputs` while a renegotiation
+     * is in flight, so replacing these regions between processing calls is
+     * safe.
+     */
+    std::vector<std::pair<void*, size_t>> mapped_host_regions_;
 
     /**
      * The maximum number of samples the host will pass to the plugin during
@@ -165,7 +395,7 @@ class Vst2Bridge : public HostBridge {
      * communication, we'll prefetch the current transport information in the
      * plugin as part of the audio processing call.
      *
-     * @see cached_time_info_
+     * @see time_info_cache_
      */
     VstTimeInfo last_time_info_;
 
@@ -173,15 +403,33 @@ class Vst2Bridge : public HostBridge {
      * This will temporarily cache the current time info during an audio
      * processing call to avoid an additional callback every processing cycle.
      * Some faulty plugins may even request this information for every sample,
-     * which would otherwise cause a very noticeable performance hit.
+     * which would otherwise cause a very noticeable performance hit. The
+     * guard returned by `AtomicValueCache::set()` lives for the duration of
+     * the processing call, so the cache automatically invalidates itself at
+     * every process call boundary. Plugins can make this callback from any
+     * of their own threads while the cycle is running, hence the thread safe
+     * cache.
      */
-    ScopedValueCache<VstTimeInfo> time_info_cache_;
+    AtomicValueCache<VstTimeInfo> time_info_cache_;
 
     /**
      * Some plugins will also ask for the current process level during audio
      * processing, so we'll also prefetch that to prevent expensive callbacks.
      */
-    ScopedValueCache<int> process_level_cache_;
+    AtomicValueCache<int> process_level_cache_;
+
+    /**
+     * Cached responses for host callback queries whose answers are fixed for
+     * the lifetime of the host process, like `audioMasterVersion()`,
+     * `audioMasterGetVendorString()`, and `audioMasterCanDo()`. Plugins poll
+     * some of these surprisingly often, and every one of those queries would
+     * otherwise be a full round trip to the native plugin. Since the host
+     * cannot change its identity or capabilities at run time this cache
+     * never needs to be invalidated. Keyed by the opcode and, for
+     * `audioMasterCanDo()`, the capability string.
+     */
+    std::map<std::pair<int, std::string>, Vst2EventResult> host_query_cache_;
+    std::mutex host_query_cache_mutex_;
 
     /**
      * The shared library handle of the VST2 plugin.
@@ -202,9 +450,17 @@ class Vst2Bridge : public HostBridge {
     bool is_initialized_ = false;
 
     /**
-     * The thread that responds to `getParameter` and `setParameter` requests.
+     * The thread that responds to `getParameter` and `setParameter` requests
+     * made over the parameters socket.
      */
     Win32Thread parameters_handler_;
+    /**
+     * The thread that responds to `getParameter` and `setParameter` requests
+     * made through the parameter mailbox in the shared memory object's
+     * doorbell page. The socket based thread above stays in use for calls made
+     * before `effMainsChanged()` has set up that object.
+     */
+    Win32Thread parameters_rpc_handler_;
     /**
      * The thread that handles calls to `processReplacing` (and `process` as a
      * fallback) and `processDoubleReplacing`.
@@ -220,12 +476,173 @@ class Vst2Bridge : public HostBridge {
      */
     Vst2Sockets<Win32Thread> sockets_;
 
+    /**
+     * Cumulative timings for the plugin's audio processing functions. The
+     * dispatcher opcodes are already tallied by `Vst2EventHandler`, but the
+     * VST2 process calls arrive over the dedicated audio socket, so they get
+     * their own table here to complete the "where did the time go" summary
+     * dumped on shutdown.
+     *
+     * @see DispatchTimingTable
+     */
+    DispatchTimingTable process_timings_{
+        ghc::filesystem::path(sockets_.base_dir_).filename().string() +
+        " audio"};
+
     /**
      * The plugin editor window. Allows embedding the plugin's editor into a
      * Wine window, and embedding that Wine window into a window provided by the
-     * host. Should be empty when the editor is not open.
+     * host. Should be empty when the editor is not open, although with the
+     * `editor_keepalive_ms` option set the cache may keep a closed editor's
+     * windows parked for a quick reopen.
+     */
+    EditorCache editor_;
+
+    /**
+     * With the `editor_deferred_open` option set, the plugin's actual
+     * `effEditOpen()` call along with the initial resize and the unhiding of
+     * the wrapper window gets stashed here so the host gets its UI thread
+     * back immediately. This normally runs from a task scheduled right after
+     * the response is sent back, but any other editor-related dispatcher
+     * call arriving before that flushes it first through
+     * `maybe_run_deferred_editor_open()`. Empty when no open is pending.
+     * Only ever accessed on the GUI thread.
+     */
+    fu2::unique_function<intptr_t()> pending_editor_open_;
+
+    /**
+     * The timer used to periodically run `maybe_hibernate()` when the
+     * `hibernate_after` option is set. This runs within `main_context_`, so
+     * the hibernation checks happen on the GUI thread just like the host's
+     * own `effMainsChanged()` calls.
+     */
+    asio::steady_timer hibernation_timer_;
+
+    /**
+     * Whether we suspended the plugin ourselves because it went silent for
+     * longer than the `hibernate_after` option allows. This is only ever set
+     * to true while `next_buffer_midi_events_mutex_` is held, and the audio
+     * thread holds that mutex for the entire processing cycle, so
+     * hibernation can never start halfway through a processing call or in
+     * between the wakeup check and the call itself.
+     */
+    std::atomic_bool hibernated_ = false;
+
+    /**
+     * Whether the last `effMainsChanged()` sent by the host had a value of
+     * 1. We'll only ever hibernate instances the host left in their resumed
+     * state, since an instance the host itself suspended is none of our
+     * business.
+     */
+    std::atomic_bool host_resumed_ = false;
+
+    /**
+     * The `std::chrono::steady_clock` tick count of the last audio
+     * processing request, used by `maybe_hibernate()` to detect instances
+     * that have gone silent. Also refreshed when the host resumes the
+     * plugin, so a freshly resumed instance doesn't get hibernated right
+     * away.
+     */
+    std::atomic<std::chrono::steady_clock::rep> last_audio_activity_{};
+
+    /**
+     * With the `overload_priority` option set, this instance's registration
+     * with the process wide overload governor. The governor may bypass this
+     * instance's processing when the group's audio threads keep overrunning
+     * their block budgets, see `OverloadGovernor`. The registration gets
+     * removed again in `close_sockets()`.
+     */
+    OverloadGovernor::Instance* overload_instance_ = nullptr;
+
+    /**
+     * Whether the last processed block ran in the overload governor's
+     * economy mode, so transitions in and out of it get logged once instead
+     * of on every block. Only accessed from `handle_process_request()`,
+     * which never runs concurrently with itself.
+     */
+    bool economy_mode_engaged_ = false;
+
+    /**
+     * The timer used to periodically run `take_state_snapshot()` when the
+     * `snapshot_interval` option is set. This also runs within
+     * `main_context_` on the GUI thread.
+     */
+    asio::steady_timer snapshot_timer_;
+
+    /**
+     * This instance's slot in the state snapshot spool directory. Only set
+     * when the `snapshot_interval` option is enabled.
+     */
+    std::optional<StateSnapshotSpool> snapshot_spool_;
+
+    /**
+     * The timer used to periodically run `run_plugin_idle()` while the
+     * plugin has asked for idle processing through `audioMasterNeedIdle()`.
+     * That deprecated pair is handled entirely on this side: the callback
+     * never reaches the native plugin, and the native plugin side drops the
+     * host's own `effIdle()` calls, just like `effEditIdle` is driven from
+     * the editor's idle timer instead of being passed through. This also
+     * runs within `main_context_` on the GUI thread.
+     */
+    asio::steady_timer needs_idle_timer_;
+
+    /**
+     * Whether the plugin has requested idle processing through
+     * `audioMasterNeedIdle()` and hasn't returned 0 from a subsequent
+     * `effIdle()` call yet. Only ever accessed on the GUI thread, since the
+     * callback schedules a task to set this.
+     */
+    bool needs_idle_ = false;
+
+    /**
+     * The timer used to run `flush_pending_automate_values()` one coalescing
+     * window after the first `audioMasterAutomate()` callback gets swallowed.
+     * Only used when the `automate_coalesce` option is set. This also runs
+     * within `main_context_` on the GUI thread.
+     */
+    asio::steady_timer automate_flush_timer_;
+
+    /**
+     * The most recent swallowed `audioMasterAutomate()` value per parameter,
+     * waiting for `automate_flush_timer_` to forward them, together with the
+     * time the last value for each parameter was actually forwarded to the
+     * host. Plugins fire this callback from their audio and GUI threads,
+     * hence the mutex.
+     */
+    std::map<int, float> pending_automate_values_;
+    std::map<int, std::chrono::steady_clock::time_point> last_automate_sent_;
+    /**
+     * Whether a flush has already been scheduled for the values in
+     * `pending_automate_values_`, so a burst of swallowed callbacks only
+     * arms the timer once. Guarded by `automate_coalesce_mutex_` like the
+     * maps above.
+     */
+    bool automate_flush_scheduled_ = false;
+    std::mutex automate_coalesce_mutex_;
+
+    /**
+     * Collapses repeated `audioMasterIOChanged()` callbacks into a single
+     * forwarded round trip per window when the `notification_dedup_ms`
+     * option is set. Some plugins fire this callback dozens of times in a
+     * row during preset loads, and every forwarded one triggers a graph
+     * rebuild in the host.
+     */
+    std::optional<NotificationDeduplicator> notification_dedup_;
+
+    /**
+     * The sample rate passed in the last `effSetSampleRate()` call, used
+     * together with `max_samples_per_block_` to compute the default
+     * one-block coalescing window for the `automate_coalesce` option.
+     */
+    float sample_rate_ = 44100.0f;
+
+    /**
+     * A snapshot left behind by a crashed host process that hosted this same
+     * plugin, adopted during construction. This gets restored through
+     * `effSetChunk()` right after the host's `effOpen()` call and is cleared
+     * again afterwards, so on every normal load this stays empty.
      */
-    std::optional<Editor> editor_;
+    std::optional<std::vector<uint8_t>> recovered_state_;
 
     /**
      * The MIDI events that have been received **and processed** since the last
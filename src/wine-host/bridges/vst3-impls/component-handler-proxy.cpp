@@ -16,6 +16,7 @@
 
 #include "component-handler-proxy.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "context-menu-proxy.h"
@@ -26,6 +27,11 @@ Vst3ComponentHandlerProxyImpl::Vst3ComponentHandlerProxyImpl(
     : Vst3ComponentHandlerProxy(std::move(args)), bridge_(bridge) {
     // The lifecycle of this object is managed together with that of the plugin
     // object instance this host context got passed to
+    if (bridge_.config_.notification_dedup_ms > 0) {
+        restart_dedup_.emplace(
+            bridge_.main_context_,
+            std::chrono::milliseconds(bridge_.config_.notification_dedup_ms));
+    }
 }
 
 tresult PLUGIN_API
@@ -41,6 +47,15 @@ Vst3ComponentHandlerProxyImpl::queryInterface(const Steinberg::TUID _iid,
 
 tresult PLUGIN_API
 Vst3ComponentHandlerProxyImpl::beginEdit(Steinberg::Vst::ParamID id) {
+    {
+        std::lock_guard lock(pending_edits_mutex_);
+        active_edit_ids_.push_back(id);
+    }
+
+    // If another parameter's edit is still active, then its pending values
+    // need to reach the host first to keep the calls in their original order
+    flush_pending_edits();
+
     return bridge_.send_message(YaComponentHandler::BeginEdit{
         .owner_instance_id = owner_instance_id(), .id = id});
 }
@@ -48,6 +63,26 @@ Vst3ComponentHandlerProxyImpl::beginEdit(Steinberg::Vst::ParamID id) {
 tresult PLUGIN_API Vst3ComponentHandlerProxyImpl::performEdit(
     Steinberg::Vst::ParamID id,
     Steinberg::Vst::ParamValue valueNormalized) {
+    // During an active edit we'll batch these calls instead of doing a socket
+    // round trip per mouse move, see the docstring on `pending_edits_`
+    {
+        std::unique_lock lock(pending_edits_mutex_);
+        if (std::find(active_edit_ids_.begin(), active_edit_ids_.end(), id) !=
+            active_edit_ids_.end()) {
+            pending_edits_.emplace_back(id, valueNormalized);
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now - last_edit_flush_ < bridge_.event_loop_interval()) {
+                return Steinberg::kResultOk;
+            }
+
+            lock.unlock();
+            flush_pending_edits();
+
+            return Steinberg::kResultOk;
+        }
+    }
+
     // HACK: Ardour/Mixbus will in some cases immediately call
     //       `IEditController::setParamNormalized()` after this `performEdit()`,
     //       so we need to be able to receive that
@@ -61,18 +96,51 @@ tresult PLUGIN_API Vst3ComponentHandlerProxyImpl::performEdit(
 
 tresult PLUGIN_API
 Vst3ComponentHandlerProxyImpl::endEdit(Steinberg::Vst::ParamID id) {
+    {
+        std::lock_guard lock(pending_edits_mutex_);
+        const auto active_edit =
+            std::find(active_edit_ids_.begin(), active_edit_ids_.end(), id);
+        if (active_edit != active_edit_ids_.end()) {
+            active_edit_ids_.erase(active_edit);
+        }
+    }
+
+    // The host needs to receive the last batched values before it sees the
+    // end of the edit
+    flush_pending_edits();
+
     return bridge_.send_message(YaComponentHandler::EndEdit{
         .owner_instance_id = owner_instance_id(), .id = id});
 }
 
 tresult PLUGIN_API
 Vst3ComponentHandlerProxyImpl::restartComponent(int32 flags) {
+    flush_pending_edits();
+
+    // Some plugins call this once per parameter with the same flags while
+    // loading a preset. With the `notification_dedup_ms` option set, repeats
+    // within the window collapse into one forwarded call, and the burst's
+    // trailing call gets resent once the window closes so the host's final
+    // re-query observes the settled state.
+    if (restart_dedup_ &&
+        !restart_dedup_->should_forward(
+            static_cast<uint32_t>(flags), [this, flags]() {
+                bridge_.send_mutually_recursive_message(
+                    YaComponentHandler::RestartComponent{
+                        .owner_instance_id = owner_instance_id(),
+                        .flags = flags});
+            })) {
+        return Steinberg::kResultOk;
+    }
+
     return bridge_.send_mutually_recursive_message(
         YaComponentHandler::RestartComponent{
             .owner_instance_id = owner_instance_id(), .flags = flags});
 }
 
 tresult PLUGIN_API Vst3ComponentHandlerProxyImpl::setDirty(TBool state) {
+    flush_pending_edits();
+
     return bridge_.send_message(YaComponentHandler2::SetDirty{
         .owner_instance_id = owner_instance_id(), .state = state});
 }
@@ -91,11 +159,15 @@ Vst3ComponentHandlerProxyImpl::requestOpenEditor(Steinberg::FIDString name) {
 }
 
 tresult PLUGIN_API Vst3ComponentHandlerProxyImpl::startGroupEdit() {
+    flush_pending_edits();
+
     return bridge_.send_message(YaComponentHandler2::StartGroupEdit{
         .owner_instance_id = owner_instance_id()});
 }
 
 tresult PLUGIN_API Vst3ComponentHandlerProxyImpl::finishGroupEdit() {
+    flush_pending_edits();
+
     return bridge_.send_message(YaComponentHandler2::FinishGroupEdit{
         .owner_instance_id = owner_instance_id()});
 }
@@ -190,3 +262,23 @@ tresult PLUGIN_API Vst3ComponentHandlerProxyImpl::notifyUnitByBusChange() {
     return bridge_.send_message(YaUnitHandler2::NotifyUnitByBusChange{
         .owner_instance_id = owner_instance_id()});
 }
+
+void Vst3ComponentHandlerProxyImpl::flush_pending_edits() {
+    decltype(pending_edits_) edits;
+    {
+        std::lock_guard lock(pending_edits_mutex_);
+        if (pending_edits_.empty()) {
+            return;
+        }
+
+        edits.swap(pending_edits_);
+        last_edit_flush_ = std::chrono::steady_clock::now();
+    }
+
+    // The mutually recursive message sending is needed for the same
+    // Ardour/Mixbus quirk described in `performEdit()`
+    bridge_.send_mutually_recursive_message(
+        YaComponentHandler::PerformEditBatch{
+            .owner_instance_id = owner_instance_id(),
+            .edits = std::move(edits)});
+}
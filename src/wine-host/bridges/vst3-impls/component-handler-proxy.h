@@ -16,6 +16,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+#include "../../notification-dedup.h"
 #include "../vst3.h"
 
 class Vst3ComponentHandlerProxyImpl : public Vst3ComponentHandlerProxy {
@@ -75,5 +80,54 @@ class Vst3ComponentHandlerProxyImpl : public Vst3ComponentHandlerProxy {
     tresult PLUGIN_API notifyUnitByBusChange() override;
 
    private:
+    /**
+     * Send any batched `performEdit()` values accumulated since the last flush
+     * as a single `PerformEditBatch` message. Called when the batch is a GUI
+     * frame old, when an edit ends, and before any other component handler
+     * call so the host always observes the calls in their original order.
+     */
+    void flush_pending_edits();
+
     Vst3Bridge& bridge_;
+
+    /**
+     * During an active edit (i.e. in between `beginEdit()` and `endEdit()` for
+     * a parameter) we'll accumulate `performEdit()` values here instead of
+     * doing a socket round trip per call, since dragging a knob can easily
+     * produce one call per mouse move. `flush_pending_edits()` ships these as
+     * a single message at most once per GUI frame. One-off `performEdit()`
+     * calls outside of an active edit are still passed through directly.
+     *
+     * The batched calls optimistically return `kResultOk` to the plugin. The
+     * mutex is needed because JUCE plugins call `performEdit()` from the audio
+     * thread while other calls come from the GUI thread.
+     */
+    llvm::SmallVector<
+        std::pair<Steinberg::Vst::ParamID, Steinberg::Vst::ParamValue>,
+        16>
+        pending_edits_;
+
+    /**
+     * The parameters with an active edit, i.e. those that saw a `beginEdit()`
+     * without a matching `endEdit()` yet. Usually at most one element, hence
+     * the flat vector.
+     */
+    llvm::SmallVector<Steinberg::Vst::ParamID, 4> active_edit_ids_;
+
+    /**
+     * The last time `flush_pending_edits()` sent a batch, used to rate limit
+     * the flushes to one per GUI frame.
+     */
+    std::chrono::steady_clock::time_point last_edit_flush_{};
+
+    std::mutex pending_edits_mutex_;
+
+    /**
+     * Collapses repeated `restartComponent()` calls with identical flags
+     * into a single forwarded call per window when the
+     * `notification_dedup_ms` option is set. Some plugins fire these once
+     * per parameter during a preset load, each costing a round trip plus an
+     * expensive re-query in the host.
+     */
+    std::optional<NotificationDeduplicator> restart_dedup_;
 };
@@ -53,6 +53,16 @@ Vst3ConnectionPointProxyImpl::disconnect(IConnectionPoint* /*other*/) {
 tresult PLUGIN_API
 Vst3ConnectionPointProxyImpl::notify(Steinberg::Vst::IMessage* message) {
     if (message) {
+        // If the native plugin side discovered that the object on the other
+        // end of the host's connection proxy is another bridged object in
+        // this process, then we can deliver the message directly and skip
+        // the two socket round trips
+        if (const std::optional<tresult> result =
+                bridge_.maybe_notify_local_peer(owner_instance_id(),
+                                                message)) {
+            return *result;
+        }
+
         // FabFilter plugins require this to be done from the GUI thread so we
         // need to use our mutual recursion mechanism. Luckily only Ardour uses
         // connection proxies, so if this ends up breaking something it will
@@ -16,8 +16,15 @@
 
 #include "vst3.h"
 
+#include <algorithm>
 #include <bitset>
+#include <cctype>
+#include <limits>
+#include <optional>
 
+#include <llvm/small-vector.h>
+
+#include "../audio-worker-pool.h"
 #include "vst3-impls/component-handler-proxy.h"
 #include "vst3-impls/connection-point-proxy.h"
 #include "vst3-impls/context-menu-proxy.h"
@@ -43,6 +50,357 @@ Steinberg::FUnknownPtr<Steinberg::IPluginBase> hack_init_plugin_base(
     Steinberg::IPtr<Steinberg::FUnknown> object,
     Steinberg::IPtr<Steinberg::Vst::IComponent> component);
 
+/**
+ * The maximum number of sub-blocks a process call can be split into with the
+ * `vst3_sample_accurate_splitting` option, along with how short a sub-block
+ * is allowed to get. Hosts sending per-sample automation ramps would
+ * otherwise turn a single block into hundreds of process calls.
+ */
+constexpr Steinberg::int32 max_sub_blocks = 32;
+constexpr Steinberg::int32 min_sub_block_samples = 16;
+
+/**
+ * Collect the sorted, distinct sample offsets of all incoming automation
+ * points that fall strictly inside of the block, thinned out to respect
+ * `min_sub_block_samples` and `max_sub_blocks`. These are the positions
+ * `process_with_sample_accurate_splitting()` will split the block at. The
+ * result is empty when all points lie on the block boundary, in which case
+ * splitting would be pointless.
+ */
+static void collect_split_points(
+    Steinberg::Vst::IParameterChanges& changes,
+    Steinberg::int32 num_samples,
+    llvm::SmallVectorImpl<Steinberg::int32>& split_points) {
+    split_points.clear();
+
+    const Steinberg::int32 num_queues = changes.getParameterCount();
+    for (Steinberg::int32 queue_index = 0; queue_index < num_queues;
+         queue_index++) {
+        Steinberg::Vst::IParamValueQueue* queue =
+            changes.getParameterData(queue_index);
+        if (!queue) {
+            continue;
+        }
+
+        const Steinberg::int32 num_points = queue->getPointCount();
+        for (Steinberg::int32 point_index = 0; point_index < num_points;
+             point_index++) {
+            Steinberg::int32 sample_offset;
+            Steinberg::Vst::ParamValue value;
+            if (queue->getPoint(point_index, sample_offset, value) ==
+                    Steinberg::kResultOk &&
+                sample_offset > 0 && sample_offset < num_samples) {
+                split_points.push_back(sample_offset);
+            }
+        }
+    }
+
+    std::sort(split_points.begin(), split_points.end());
+    split_points.erase(
+        std::unique(split_points.begin(), split_points.end()),
+        split_points.end());
+
+    size_t num_kept = 0;
+    Steinberg::int32 previous_boundary = 0;
+    for (const Steinberg::int32 split_point : split_points) {
+        if (split_point - previous_boundary >= min_sub_block_samples &&
+            num_samples - split_point >= min_sub_block_samples &&
+            num_kept < static_cast<size_t>(max_sub_blocks - 1)) {
+            split_points[num_kept++] = split_point;
+            previous_boundary = split_point;
+        }
+    }
+    split_points.truncate(num_kept);
+}
+
+/**
+ * Process `data` as a series of sequential sub-block process calls split at
+ * the sample offsets of the incoming automation points, the way hosts that do
+ * sample-accurate automation split their blocks themselves. Used for the
+ * `vst3_sample_accurate_splitting` option. A host that's configured not to
+ * split (or that doesn't support splitting) can then send the whole block
+ * with its automation curves in a single round trip, and the splitting
+ * happens on this side of the bridge without any additional IPC. When the
+ * block contains no splittable automation points this simply forwards the
+ * call.
+ *
+ * Each sub-block gets the slice of the automation points that falls inside
+ * of it, rebased to the sub-block's start, with the most recent earlier value
+ * repeated at offset 0 the same way splitting hosts do. Input events are
+ * routed to the sub-block containing their sample offset, output events and
+ * output parameter changes are rebased back to block-relative offsets, and
+ * the project time in the process context advances with every sub-block.
+ */
+static tresult process_with_sample_accurate_splitting(
+    Steinberg::Vst::IAudioProcessor& processor,
+    Steinberg::Vst::ProcessData& data) {
+    using namespace Steinberg;
+    using namespace Steinberg::Vst;
+
+    if (!data.inputParameterChanges || data.numSamples <= 0) {
+        return processor.process(data);
+    }
+
+    // NOTE: These are static thread locals so repeated process calls on the
+    //       same audio thread don't allocate
+    static thread_local llvm::SmallVector<int32, 16> split_points;
+    collect_split_points(*data.inputParameterChanges, data.numSamples,
+                         split_points);
+    if (split_points.empty()) {
+        return processor.process(data);
+    }
+
+    static thread_local YaParameterChanges sub_input_parameter_changes;
+    static thread_local YaParameterChanges sub_output_parameter_changes;
+    static thread_local YaEventList sub_input_events;
+    static thread_local YaEventList sub_output_events;
+    static thread_local llvm::SmallVector<AudioBusBuffers, 8> sub_inputs;
+    static thread_local llvm::SmallVector<AudioBusBuffers, 8> sub_outputs;
+    static thread_local llvm::SmallVector<void*, 32> sub_channel_pointers;
+
+    const bool double_precision = data.symbolicSampleSize == kSample64;
+
+    // The sub-block bus buffers are copies of the original ones with their
+    // channel pointers advanced to the sub-block's start. All those adjusted
+    // channel pointers live back-to-back in one flat array.
+    sub_inputs.assign(data.inputs, data.inputs + data.numInputs);
+    sub_outputs.assign(data.outputs, data.outputs + data.numOutputs);
+
+    size_t total_channels = 0;
+    for (const auto& bus : sub_inputs) {
+        total_channels += static_cast<size_t>(bus.numChannels);
+    }
+    for (const auto& bus : sub_outputs) {
+        total_channels += static_cast<size_t>(bus.numChannels);
+    }
+    sub_channel_pointers.resize(total_channels);
+
+    size_t channel_pointer_offset = 0;
+    for (auto& bus : sub_inputs) {
+        bus.channelBuffers32 = reinterpret_cast<Sample32**>(
+            sub_channel_pointers.data() + channel_pointer_offset);
+        channel_pointer_offset += static_cast<size_t>(bus.numChannels);
+    }
+    for (auto& bus : sub_outputs) {
+        bus.channelBuffers32 = reinterpret_cast<Sample32**>(
+            sub_channel_pointers.data() + channel_pointer_offset);
+        channel_pointer_offset += static_cast<size_t>(bus.numChannels);
+    }
+
+    // Output silence flags should only be reported to the host when the
+    // output stayed silent over all sub-blocks
+    for (int32 bus_index = 0; bus_index < data.numOutputs; bus_index++) {
+        data.outputs[bus_index].silenceFlags =
+            std::numeric_limits<uint64>::max();
+    }
+
+    ProcessContext sub_context{};
+    ProcessData sub_data = data;
+    sub_data.inputs = sub_inputs.data();
+    sub_data.outputs = sub_outputs.data();
+    sub_data.inputParameterChanges = &sub_input_parameter_changes;
+    sub_data.outputParameterChanges =
+        data.outputParameterChanges ? &sub_output_parameter_changes : nullptr;
+    sub_data.inputEvents = data.inputEvents ? &sub_input_events : nullptr;
+    sub_data.outputEvents = data.outputEvents ? &sub_output_events : nullptr;
+    if (data.processContext) {
+        sub_context = *data.processContext;
+        sub_data.processContext = &sub_context;
+    }
+
+    tresult result = kResultOk;
+    int32 sub_block_start = 0;
+    for (size_t sub_block_index = 0; sub_block_index <= split_points.size();
+         sub_block_index++) {
+        const int32 sub_block_end = sub_block_index < split_points.size()
+                                        ? split_points[sub_block_index]
+                                        : data.numSamples;
+        sub_data.numSamples = sub_block_end - sub_block_start;
+
+        // Advance the audio to the sub-block's start
+        size_t channel_index = 0;
+        const auto advance_bus = [&](const AudioBusBuffers& bus) {
+            for (int32 channel = 0; channel < bus.numChannels; channel++) {
+                if (double_precision) {
+                    sub_channel_pointers[channel_index] =
+                        bus.channelBuffers64[channel]
+                            ? bus.channelBuffers64[channel] + sub_block_start
+                            : nullptr;
+                } else {
+                    sub_channel_pointers[channel_index] =
+                        bus.channelBuffers32[channel]
+                            ? bus.channelBuffers32[channel] + sub_block_start
+                            : nullptr;
+                }
+                channel_index++;
+            }
+        };
+        for (int32 bus_index = 0; bus_index < data.numInputs; bus_index++) {
+            advance_bus(data.inputs[bus_index]);
+        }
+        for (int32 bus_index = 0; bus_index < data.numOutputs; bus_index++) {
+            advance_bus(data.outputs[bus_index]);
+            sub_outputs[bus_index].silenceFlags = 0;
+        }
+
+        // Slice the automation points to the sub-block, rebased to its
+        // start. Like in a splitting host every sub-block after the first
+        // starts with the most recent earlier value at offset 0.
+        sub_input_parameter_changes.clear();
+        const int32 num_queues =
+            data.inputParameterChanges->getParameterCount();
+        for (int32 queue_index = 0; queue_index < num_queues; queue_index++) {
+            IParamValueQueue* queue =
+                data.inputParameterChanges->getParameterData(queue_index);
+            if (!queue) {
+                continue;
+            }
+
+            IParamValueQueue* sub_queue = nullptr;
+            const auto ensure_sub_queue = [&]() {
+                if (!sub_queue) {
+                    int32 sub_queue_index;
+                    sub_queue = sub_input_parameter_changes.addParameterData(
+                        queue->getParameterId(), sub_queue_index);
+                }
+            };
+
+            std::optional<ParamValue> boundary_value;
+            const int32 num_points = queue->getPointCount();
+            for (int32 point_index = 0; point_index < num_points;
+                 point_index++) {
+                int32 sample_offset;
+                ParamValue value;
+                if (queue->getPoint(point_index, sample_offset, value) !=
+                    kResultOk) {
+                    continue;
+                }
+
+                if (sample_offset < sub_block_start) {
+                    boundary_value = value;
+                } else if (sample_offset < sub_block_end) {
+                    if (boundary_value && sample_offset > sub_block_start) {
+                        ensure_sub_queue();
+                        int32 sub_point_index;
+                        sub_queue->addPoint(0, *boundary_value,
+                                            sub_point_index);
+                    }
+                    boundary_value.reset();
+
+                    ensure_sub_queue();
+                    int32 sub_point_index;
+                    sub_queue->addPoint(sample_offset - sub_block_start, value,
+                                        sub_point_index);
+                }
+            }
+            if (boundary_value) {
+                ensure_sub_queue();
+                int32 sub_point_index;
+                sub_queue->addPoint(0, *boundary_value, sub_point_index);
+            }
+        }
+
+        // Route the input events that fall inside of this sub-block
+        if (data.inputEvents) {
+            sub_input_events.clear();
+            const int32 num_events = data.inputEvents->getEventCount();
+            for (int32 event_index = 0; event_index < num_events;
+                 event_index++) {
+                Event event;
+                if (data.inputEvents->getEvent(event_index, event) ==
+                        kResultOk &&
+                    event.sampleOffset >= sub_block_start &&
+                    event.sampleOffset < sub_block_end) {
+                    event.sampleOffset -= sub_block_start;
+                    sub_input_events.addEvent(event);
+                }
+            }
+        }
+        if (data.outputParameterChanges) {
+            sub_output_parameter_changes.clear();
+        }
+        if (data.outputEvents) {
+            sub_output_events.clear();
+        }
+
+        // And advance the song position
+        if (data.processContext) {
+            sub_context.projectTimeSamples =
+                data.processContext->projectTimeSamples + sub_block_start;
+            sub_context.continousTimeSamples =
+                data.processContext->continousTimeSamples + sub_block_start;
+            if ((sub_context.state & ProcessContext::kProjectTimeMusicValid) &&
+                (sub_context.state & ProcessContext::kTempoValid) &&
+                sub_context.sampleRate > 0.0) {
+                sub_context.projectTimeMusic =
+                    data.processContext->projectTimeMusic +
+                    (sub_block_start * sub_context.tempo) /
+                        (60.0 * sub_context.sampleRate);
+            }
+        }
+
+        result = processor.process(sub_data);
+        if (result != kResultOk) {
+            return result;
+        }
+
+        // Rebase the sub-block's outputs back to block-relative offsets
+        for (int32 bus_index = 0; bus_index < data.numOutputs; bus_index++) {
+            data.outputs[bus_index].silenceFlags &=
+                sub_outputs[bus_index].silenceFlags;
+        }
+        if (data.outputParameterChanges) {
+            const int32 num_output_queues =
+                sub_output_parameter_changes.getParameterCount();
+            for (int32 queue_index = 0; queue_index < num_output_queues;
+                 queue_index++) {
+                IParamValueQueue* sub_queue =
+                    sub_output_parameter_changes.getParameterData(queue_index);
+                if (!sub_queue) {
+                    continue;
+                }
+
+                int32 output_queue_index;
+                IParamValueQueue* output_queue =
+                    data.outputParameterChanges->addParameterData(
+                        sub_queue->getParameterId(), output_queue_index);
+                if (!output_queue) {
+                    continue;
+                }
+
+                const int32 num_points = sub_queue->getPointCount();
+                for (int32 point_index = 0; point_index < num_points;
+                     point_index++) {
+                    int32 sample_offset;
+                    ParamValue value;
+                    if (sub_queue->getPoint(point_index, sample_offset,
+                                            value) == kResultOk) {
+                        int32 output_point_index;
+                        output_queue->addPoint(sample_offset + sub_block_start,
+                                               value, output_point_index);
+                    }
+                }
+            }
+        }
+        if (data.outputEvents) {
+            const int32 num_events = sub_output_events.getEventCount();
+            for (int32 event_index = 0; event_index < num_events;
+                 event_index++) {
+                Event event;
+                if (sub_output_events.getEvent(event_index, event) ==
+                    kResultOk) {
+                    event.sampleOffset += sub_block_start;
+                    data.outputEvents->addEvent(event);
+                }
+            }
+        }
+
+        sub_block_start = sub_block_end;
+    }
+
+    return result;
+}
+
 Vst3PlugViewInterfaces::Vst3PlugViewInterfaces() noexcept {}
 
 Vst3PlugViewInterfaces::Vst3PlugViewInterfaces(
@@ -90,7 +448,7 @@ Vst3Bridge::Vst3Bridge(MainContext& main_context,
                        std::string plugin_dll_path,
                        std::string endpoint_base_dir,
                        pid_t parent_pid)
-    : HostBridge(main_context, plugin_dll_path, parent_pid),
+    : HostBridge(main_context, plugin_dll_path, endpoint_base_dir, parent_pid),
       logger_(generic_logger_),
       sockets_(main_context.context_, endpoint_base_dir, false) {
     std::string error;
@@ -107,8 +465,46 @@ Vst3Bridge::Vst3Bridge(MainContext& main_context,
     config_ = sockets_.plugin_host_callback_.send_message(
         WantsConfiguration{.host_version = yabridge_git_version}, std::nullopt);
 
+    // This side sends the host callbacks, so concurrent callbacks can be
+    // handled over pre-established spare connections when the `spare_sockets`
+    // option is set
+    sockets_.plugin_host_callback_.set_spare_sockets(config_.spare_sockets);
+
+    // Without an explicit `frame_rate` setting we'll pace the event loop to
+    // the display's actual refresh rate instead of assuming 60 fps
+    if (!config_.frame_rate) {
+        config_.frame_rate = detect_screen_refresh_rate(
+            *SharedX11Connection::get(main_context)->connection());
+    }
+
     // Allow this plugin to configure the main context's tick rate
     main_context.update_timer_interval(config_.event_loop_interval());
+
+    // Process wide resource limits requested through the `group_cpus`,
+    // `group_cpu_quota` and `group_memory_limit` options. These have to be
+    // applied before any worker threads get spawned so the affinity fallback
+    // gets inherited, and only the first loaded plugin's settings take
+    // effect since all plugins in a plugin group share this process.
+    if (config_.group_cpus || config_.group_cpu_quota > 0 ||
+        config_.group_memory_limit > 0) {
+        apply_process_resource_limits(
+            config_.group.value_or(plugin_path_.stem().string()),
+            config_.group_cpus, config_.group_cpu_quota,
+            config_.group_memory_limit);
+    }
+
+    // We're running on the main GUI thread here, so this pins the Win32
+    // message loop and all GUI work. Like the event loop interval this is
+    // shared by every plugin in a plugin group, so the last loaded plugin's
+    // setting wins. The NUMA node pinning has to happen before any worker
+    // threads get spawned so they inherit the affinity, and explicit
+    // `main_affinity`/`audio_affinity` lists still override it per thread.
+    if (config_.numa_node) {
+        set_numa_node_affinity(*config_.numa_node);
+    }
+    if (config_.main_affinity) {
+        set_cpu_affinity(*config_.main_affinity);
+    }
 }
 
 bool Vst3Bridge::inhibits_event_loop() noexcept {
@@ -269,8 +665,19 @@ void Vst3Bridge::run() {
                         }
                     });
 
-                return Vst3PluginProxy::GetStateResponse{
+                Vst3PluginProxy::GetStateResponse response{
                     .result = result, .state = std::move(request.state)};
+
+                // Successive state fetches (i.e. host autosaves) are nearly
+                // identical, so only the changed ranges are transferred and
+                // the native side patches its retained copy of the last state
+                {
+                    const auto& [instance, _] =
+                        get_instance(request.instance_id);
+                    response.state.encode_against(instance.state_diff_encoder);
+                }
+
+                return response;
             },
             [&](YaAudioPresentationLatency::SetAudioPresentationLatencySamples&
                     request) -> YaAudioPresentationLatency::
@@ -351,6 +758,21 @@ void Vst3Bridge::run() {
                             this_instance.connection_point_proxy);
                     this_instance.connection_point_proxy.reset();
 
+                    // If we were delivering messages directly to another
+                    // bridged object, then that object may also deliver its
+                    // messages directly to us, and neither should keep doing
+                    // that after this disconnect
+                    if (this_instance.local_connection_peer) {
+                        const auto& [peer_instance, _2] =
+                            get_instance(*this_instance.local_connection_peer);
+                        if (peer_instance.local_connection_peer ==
+                            request.instance_id) {
+                            peer_instance.local_connection_peer.reset();
+                        }
+
+                        this_instance.local_connection_peer.reset();
+                    }
+
                     return result;
                 }
             },
@@ -379,6 +801,16 @@ void Vst3Bridge::run() {
                         request.message_ptr.get_original());
                 });
             },
+            [&](const YaConnectionPoint::BypassConnectionProxy& request)
+                -> YaConnectionPoint::BypassConnectionProxy::Response {
+                const auto& [this_instance, _] =
+                    get_instance(request.instance_id);
+
+                this_instance.local_connection_peer =
+                    request.other_instance_id;
+
+                return Ack{};
+            },
             [&](YaContextMenuTarget::ExecuteMenuItem& request)
                 -> YaContextMenuTarget::ExecuteMenuItem::Response {
                 const auto& [instance, _] =
@@ -439,8 +871,7 @@ void Vst3Bridge::run() {
                         request.id, request.value_normalized, string);
 
                 return YaEditController::GetParamStringByValueResponse{
-                    .result = result,
-                    .string = tchar_pointer_to_u16string(string)};
+                    .result = result, .string = string};
             },
             [&](const YaEditController::GetParamValueByString& request)
                 -> YaEditController::GetParamValueByString::Response {
@@ -451,7 +882,7 @@ void Vst3Bridge::run() {
                     instance.interfaces.edit_controller->getParamValueByString(
                         request.id,
                         const_cast<Steinberg::Vst::TChar*>(
-                            u16string_to_tchar_pointer(request.string)),
+                            request.string.c_str()),
                         value_normalized);
 
                 return YaEditController::GetParamValueByStringResponse{
@@ -479,6 +910,24 @@ void Vst3Bridge::run() {
                 return instance.interfaces.edit_controller->getParamNormalized(
                     request.id);
             },
+            [&](const YaEditController::GetParamNormalizedMulti& request)
+                -> YaEditController::GetParamNormalizedMulti::Response {
+                const auto& [instance, _] = get_instance(request.instance_id);
+
+                // The native plugin side uses this to refresh its entire
+                // parameter value cache with a single round trip when the
+                // host polls parameter values at UI rate
+                std::vector<Steinberg::Vst::ParamValue> values;
+                values.reserve(request.ids.size());
+                for (const auto id : request.ids) {
+                    values.push_back(
+                        instance.interfaces.edit_controller->getParamNormalized(
+                            id));
+                }
+
+                return YaEditController::GetParamNormalizedMultiResponse{
+                    .values = std::move(values)};
+            },
             [&](const YaEditController::SetParamNormalized& request)
                 -> YaEditController::SetParamNormalized::Response {
                 // HACK: Under Ardour/Mixbus, `IComponentHandler::performEdit()`
@@ -688,8 +1137,7 @@ void Vst3Bridge::run() {
 
                         return YaNoteExpressionController::
                             GetNoteExpressionStringByValueResponse{
-                                .result = result,
-                                .string = tchar_pointer_to_u16string(string)};
+                                .result = result, .string = string};
                     },
             [&](const YaNoteExpressionController::
                     GetNoteExpressionValueByString& request)
@@ -703,8 +1151,7 @@ void Vst3Bridge::run() {
                             instance.interfaces.note_expression_controller
                                 ->getNoteExpressionValueByString(
                                     request.bus_index, request.channel,
-                                    request.id,
-                                    u16string_to_tchar_pointer(request.string),
+                                    request.id, request.string.c_str(),
                                     value_normalized);
 
                         return YaNoteExpressionController::
@@ -1198,6 +1645,34 @@ void Vst3Bridge::run() {
                 return YaUnitInfo::GetUnitInfoResponse{.result = result,
                                                        .info = std::move(info)};
             },
+            [&](const YaUnitInfo::GetUnitInfos& request)
+                -> YaUnitInfo::GetUnitInfos::Response {
+                const auto& [instance, _] = get_instance(request.instance_id);
+
+                // Hosts like Cubase walk the entire unit tree whenever they
+                // (re)build their parameter lists, so we'll fetch all of it in
+                // one go and let the native plugin side cache the results
+                const int num_units =
+                    instance.interfaces.unit_info->getUnitCount();
+
+                std::vector<std::optional<Steinberg::Vst::UnitInfo>> infos;
+                infos.reserve(num_units);
+                for (int i = 0; i < num_units; i++) {
+                    // Just like with the parameter infos, we can't make
+                    // anything up if the plugin errors out here, so we'll
+                    // store a nullopt to keep the indices intact
+                    Steinberg::Vst::UnitInfo info{};
+                    if (instance.interfaces.unit_info->getUnitInfo(i, info) ==
+                        Steinberg::kResultOk) {
+                        infos.push_back(std::move(info));
+                    } else {
+                        infos.push_back(std::nullopt);
+                    }
+                }
+
+                return YaUnitInfo::GetUnitInfosResponse{
+                    .infos = std::move(infos)};
+            },
             [&](const YaUnitInfo::GetProgramListCount& request)
                 -> YaUnitInfo::GetProgramListCount::Response {
                 const auto& [instance, _] = get_instance(request.instance_id);
@@ -1232,8 +1707,8 @@ void Vst3Bridge::run() {
                             request.list_id, request.program_index, name);
                     });
 
-                return YaUnitInfo::GetProgramNameResponse{
-                    .result = result, .name = tchar_pointer_to_u16string(name)};
+                return YaUnitInfo::GetProgramNameResponse{.result = result,
+                                                          .name = name};
             },
             [&](const YaUnitInfo::GetProgramInfo& request)
                 -> YaUnitInfo::GetProgramInfo::Response {
@@ -1246,9 +1721,7 @@ void Vst3Bridge::run() {
                         request.attribute_id.c_str(), attribute_value);
 
                 return YaUnitInfo::GetProgramInfoResponse{
-                    .result = result,
-                    .attribute_value =
-                        tchar_pointer_to_u16string(attribute_value)};
+                    .result = result, .attribute_value = attribute_value};
             },
             [&](const YaUnitInfo::HasProgramPitchNames& request)
                 -> YaUnitInfo::HasProgramPitchNames::Response {
@@ -1267,8 +1740,8 @@ void Vst3Bridge::run() {
                         request.list_id, request.program_index,
                         request.midi_pitch, name);
 
-                return YaUnitInfo::GetProgramPitchNameResponse{
-                    .result = result, .name = tchar_pointer_to_u16string(name)};
+                return YaUnitInfo::GetProgramPitchNameResponse{.result = result,
+                                                               .name = name};
             },
             [&](const YaUnitInfo::GetSelectedUnit& request)
                 -> YaUnitInfo::GetSelectedUnit::Response {
@@ -1356,6 +1829,23 @@ void Vst3Bridge::unregister_context_menu(
         context_menu.context_menu_id());
 }
 
+std::optional<tresult> Vst3Bridge::maybe_notify_local_peer(
+    size_t instance_id,
+    Steinberg::Vst::IMessage* message) noexcept {
+    const auto& [instance, _] = get_instance(instance_id);
+    if (!instance.local_connection_peer) {
+        return std::nullopt;
+    }
+
+    // Delivering the message directly matches the semantics of a direct
+    // connection, which is also what we prefer when the native plugin side
+    // can figure out the peer before the connection is made
+    const auto& [peer_instance, _2] =
+        get_instance(*instance.local_connection_peer);
+
+    return peer_instance.interfaces.connection_point->notify(message);
+}
+
 void Vst3Bridge::close_sockets() {
     sockets_.close();
 }
@@ -1407,8 +1897,7 @@ std::optional<AudioShmBuffer::Config> Vst3Bridge::setup_shared_audio_buffers(
         // According to the docs this does not need to be realtime-safe, but we
         // should at least still try to not do anything expensive when no work
         // needs to be done.
-        llvm::SmallVector<llvm::SmallVector<uint32_t, 32>, 16> bus_offsets(
-            num_busses);
+        AudioShmBuffer::BusOffsets bus_offsets(num_busses);
         for (int bus = 0; bus < num_busses; bus++) {
             Steinberg::Vst::SpeakerArrangement speaker_arrangement{};
             audio_processor->getBusArrangement(direction, bus,
@@ -1432,45 +1921,98 @@ std::optional<AudioShmBuffer::Config> Vst3Bridge::setup_shared_audio_buffers(
     // Creating the audio buffer offsets for every channel in every bus will
     // advance `current_offset` to keep pointing to the starting position for
     // the next channel
-    const auto input_bus_offsets = create_bus_offsets(Steinberg::Vst::kInput);
-    const auto output_bus_offsets = create_bus_offsets(Steinberg::Vst::kOutput);
+    auto input_bus_offsets = create_bus_offsets(Steinberg::Vst::kInput);
+    auto output_bus_offsets = create_bus_offsets(Steinberg::Vst::kOutput);
 
     // The size of the buffer is in bytes, and it will depend on whether the
     // host is going to pass 32-bit or 64-bit audio to the plugin
     const uint32_t buffer_size = current_offset;
 
-    // If this function has been called previously and the size did not change,
-    // then we should not do any work
-    if (instance.process_buffers &&
-        instance.process_buffers->config_.size == buffer_size) {
-        return std::nullopt;
-    }
-
-    // Because the above check should be super cheap, we'll now need to convert
-    // the stack allocated SmallVectors to regular heap vectors
-    std::vector<std::vector<uint32_t>> input_bus_offsets_vector;
-    input_bus_offsets_vector.reserve(input_bus_offsets.size());
-    for (const auto& channel_offsets : input_bus_offsets) {
-        input_bus_offsets_vector.push_back(
-            std::vector(channel_offsets.begin(), channel_offsets.end()));
+    // With the `shared_sidechain` option every auxiliary input bus is backed
+    // by a region shared with all other instances in the group that use the
+    // same tag. The host routes identical samples to those busses, so the
+    // native sides only need to copy them once per block instead of once per
+    // instance. The offsets are computed deterministically from the layout,
+    // so every instance with the same tag and layout independently arrives at
+    // the same region without any coordination.
+    std::string shared_input_name{};
+    uint32_t shared_input_size = 0;
+    AudioShmBuffer::BusOffsets shared_input_offsets{};
+    if (config_.shared_sidechain && input_bus_offsets.size() > 1) {
+        shared_input_offsets.resize(input_bus_offsets.size());
+        uint32_t shared_offset = AudioShmBuffer::shared_input_reserved_size;
+        size_t num_shared_channels = 0;
+        for (size_t bus = 1; bus < input_bus_offsets.size(); bus++) {
+            shared_input_offsets[bus].resize(input_bus_offsets[bus].size());
+            for (size_t channel = 0; channel < input_bus_offsets[bus].size();
+                 channel++) {
+                shared_input_offsets[bus][channel] = shared_offset;
+                shared_offset +=
+                    instance.process_setup->maxSamplesPerBlock * sample_size;
+                num_shared_channels += 1;
+            }
+        }
+        shared_input_size = shared_offset;
+
+        // The layout is encoded into the object's name so instances with
+        // mismatched layouts end up in separate regions instead of reading
+        // each other's samples at the wrong offsets. The tag is sanitized
+        // since it's user input and shared memory names can't contain
+        // slashes.
+        std::string sanitized_tag = *config_.shared_sidechain;
+        for (char& character : sanitized_tag) {
+            if (!std::isalnum(static_cast<unsigned char>(character)) &&
+                character != '-' && character != '_') {
+                character = '_';
+            }
+        }
+        shared_input_name =
+            "yabridge-sidechain-" + sanitized_tag + "-" +
+            std::to_string(num_shared_channels) + "x" +
+            std::to_string(instance.process_setup->maxSamplesPerBlock) + "x" +
+            std::to_string(sample_size);
     }
 
-    std::vector<std::vector<uint32_t>> output_bus_offsets_vector;
-    output_bus_offsets_vector.reserve(output_bus_offsets.size());
-    for (const auto& channel_offsets : output_bus_offsets) {
-        output_bus_offsets_vector.push_back(
-            std::vector(channel_offsets.begin(), channel_offsets.end()));
+    // If this function has been called previously and the layout did not
+    // change, then we should not do any work. The offsets need to be compared
+    // as well because two different bus layouts can add up to the same total
+    // size.
+    const auto offsets_equal = [](const AudioShmBuffer::BusOffsets& computed,
+                                  const AudioShmBuffer::BusOffsets& existing) {
+        return std::equal(computed.begin(), computed.end(), existing.begin(),
+                          existing.end(), [](const auto& a, const auto& b) {
+                              return std::equal(a.begin(), a.end(), b.begin(),
+                                                b.end());
+                          });
+    };
+    if (instance.process_buffers &&
+        instance.process_buffers->config_.size == buffer_size &&
+        offsets_equal(input_bus_offsets,
+                      instance.process_buffers->config_.input_offsets) &&
+        offsets_equal(output_bus_offsets,
+                      instance.process_buffers->config_.output_offsets) &&
+        instance.process_buffers->config_.shared_input_name ==
+            shared_input_name) {
+        return std::nullopt;
     }
 
     // We'll set up these shared memory buffers on the Wine side first, and then
     // when this request returns we'll do the same thing on the native plugin
-    // side
+    // side. The config stores the same small vector type we just computed the
+    // offsets in, so this no longer requires converting anything to heap
+    // allocated vectors.
     AudioShmBuffer::Config buffer_config{
         .name = sockets_.base_dir_.filename().string() + "-" +
                 std::to_string(instance_id),
         .size = buffer_size,
-        .input_offsets = std::move(input_bus_offsets_vector),
-        .output_offsets = std::move(output_bus_offsets_vector)};
+        .huge_pages = config_.audio_huge_pages,
+        .numa_node = config_.numa_node ? static_cast<int32_t>(*config_.numa_node)
+                                       : -1,
+        .input_offsets = std::move(input_bus_offsets),
+        .output_offsets = std::move(output_bus_offsets),
+        .shared_input_name = std::move(shared_input_name),
+        .shared_input_size = shared_input_size,
+        .shared_input_offsets = std::move(shared_input_offsets)};
     if (!instance.process_buffers) {
         instance.process_buffers.emplace(buffer_config);
     } else {
@@ -1484,8 +2026,8 @@ std::optional<AudioShmBuffer::Config> Vst3Bridge::setup_shared_audio_buffers(
     // data to `IAudioProcessor::process()`.
     auto set_bus_pointers =
         [&]<std::invocable<uint32_t, uint32_t> F>(
-            std::vector<std::vector<void*>>& bus_pointers,
-            const std::vector<std::vector<uint32_t>>& bus_offsets,
+            AudioShmBuffer::BusPointers& bus_pointers,
+            const AudioShmBuffer::BusOffsets& bus_offsets,
             F&& get_channel_pointer) {
             bus_pointers.resize(bus_offsets.size());
 
@@ -1545,14 +2087,25 @@ size_t Vst3Bridge::register_object_instance(
         object_instances_.at(instance_id)
             .audio_processor_handler = Win32Thread([&, instance_id]() {
             set_realtime_priority(true);
+            if (config_.audio_affinity) {
+                set_cpu_affinity(*config_.audio_affinity);
+            }
 
             // XXX: Like with VST2 worker threads, when using plugin groups the
             //      thread names from different plugins will clash. Not a huge
             //      deal probably, since duplicate thread names are still more
             //      useful than no thread names.
-            const std::string thread_name =
-                "audio-" + std::to_string(instance_id);
-            pthread_setname_np(pthread_self(), thread_name.c_str());
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("audio",
+                                                           instance_id);
+
+            // When this process hosts more plugins than the machine has
+            // physical cores, the actual `process()` calls get handed off to
+            // the process wide worker pool so all those audio threads don't
+            // oversubscribe the CPU. Until that point the pool stays
+            // completely passive and `AudioWorkerPool::run()` just runs the
+            // call on this thread.
+            AudioWorkerPool::AudioThreadGuard audio_worker_guard{};
 
             sockets_.add_audio_processor_and_listen(
                 instance_id, socket_listening_latch,
@@ -1650,20 +2203,15 @@ size_t Vst3Bridge::register_object_instance(
                         YaAudioProcessor::Process& request = request_ref.get();
 
                         // As suggested by Jack Winter, we'll synchronize this
-                        // thread's audio processing priority with that of the
+                        // thread's scheduling parameters with those of the
                         // host's audio thread every once in a while
-                        if (request.new_realtime_priority) {
-                            set_realtime_priority(
-                                true, *request.new_realtime_priority);
+                        if (request.new_realtime_parameters) {
+                            set_realtime_parameters(
+                                *request.new_realtime_parameters);
                         }
 
                         const auto& [instance, _] =
                             get_instance(request.instance_id);
-                        // Most plugins will already enable FTZ, but there are a
-                        // handful of plugins that don't that suffer from
-                        // extreme DSP load increases when they start producing
-                        // denormals
-                        ScopedFlushToZero ftz_guard;
 
                         // The actual audio is stored in the shared memory
                         // buffers, so the reconstruction function will need to
@@ -1671,26 +2219,66 @@ size_t Vst3Bridge::register_object_instance(
                         // HACK: IK-Multimedia's T-RackS 5 will hang if audio
                         //       processing is done from the audio thread while
                         //       the plugin is in offline processing mode. Yes
-                        //       that's as silly as it sounds.
+                        //       that's as silly as it sounds. The
+                        //       `offline_direct_processing` option skips this
+                        //       detour so consecutive offline blocks can be
+                        //       processed back-to-back on this thread.
                         tresult result;
                         auto& reconstructed = request.data.reconstruct(
                             instance.process_buffers_input_pointers,
                             instance.process_buffers_output_pointers);
+
+                        // With the `vst3_sample_accurate_splitting` option
+                        // the sub-block splitting a host would otherwise do
+                        // around automation points happens on this side of
+                        // the bridge, so the whole block still only costs a
+                        // single round trip
+                        const auto process_block =
+                            [&, &instance = instance]() -> tresult {
+                            // Most plugins will already enable FTZ, but there
+                            // are a handful of plugins that don't that suffer
+                            // from extreme DSP load increases when they start
+                            // producing denormals. MXCSR is per thread, so
+                            // this has to happen on whichever thread ends up
+                            // running the plugin's processing function. In
+                            // steady state this is only a register read.
+                            ensure_flush_to_zero();
+
+                            if (config_.vst3_sample_accurate_splitting) {
+                                return process_with_sample_accurate_splitting(
+                                    *instance.interfaces.audio_processor,
+                                    reconstructed);
+                            } else {
+                                return instance.interfaces.audio_processor
+                                    ->process(reconstructed);
+                            }
+                        };
+
                         if (instance.process_setup &&
                             instance.process_setup->processMode ==
-                                Steinberg::Vst::kOffline) {
+                                Steinberg::Vst::kOffline &&
+                            !config_.offline_direct_processing) {
                             result = main_context_
-                                         .run_in_context([&instance = instance,
-                                                          &reconstructed]() {
-                                             return instance.interfaces
-                                                 .audio_processor->process(
-                                                     reconstructed);
+                                         .run_in_context([&,
+                                                          &instance =
+                                                              instance]() {
+                                             ScopedLoadTimer load_timer(
+                                                 *this,
+                                                 ScopedLoadTimer::Kind::audio);
+
+                                             return process_block();
                                          })
                                          .get();
                         } else {
-                            result =
-                                instance.interfaces.audio_processor->process(
-                                    reconstructed);
+                            AudioWorkerPool::instance().run([&]() {
+                                // Measured inside the lambda so the CPU time
+                                // gets sampled on the thread that runs the
+                                // plugin's processing function
+                                ScopedLoadTimer load_timer(
+                                    *this, ScopedLoadTimer::Kind::audio);
+
+                                result = process_block();
+                            });
                         }
 
                         return YaAudioProcessor::ProcessResponse{
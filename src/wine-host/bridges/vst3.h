@@ -134,6 +134,19 @@ struct Vst3PluginInstance {
      */
     Steinberg::IPtr<Vst3ConnectionPointProxy> connection_point_proxy;
 
+    /**
+     * If the native plugin side discovered that the object on the other end
+     * of the host's connection proxy is another bridged object in this same
+     * process, then this contains that object's instance ID. In that case
+     * `Vst3ConnectionPointProxyImpl::notify()` delivers messages directly to
+     * that object instead of routing them through the native plugin and the
+     * host's connection proxy, which saves two socket round trips per
+     * message. Only used when `connection_point_proxy` is also set.
+     *
+     * @relates Vst3Bridge::maybe_notify_local_peer
+     */
+    std::optional<size_t> local_connection_peer;
+
     /**
      * After a call to `IEditController::setComponentHandler()`, we'll create a
      * proxy of that component handler just like we did for the plugin object.
@@ -185,7 +198,7 @@ struct Vst3PluginInstance {
      * can be either `float*` or `double*`, so we sadly have to use void
      * pointers here.
      */
-    std::vector<std::vector<void*>> process_buffers_input_pointers;
+    AudioShmBuffer::BusPointers process_buffers_input_pointers;
 
     /**
      * Pointers to the per-bus output channels in process_buffers so we can pass
@@ -193,13 +206,21 @@ struct Vst3PluginInstance {
      * can be either `float*` or `double*`, so we sadly have to use void
      * pointers here.
      */
-    std::vector<std::vector<void*>> process_buffers_output_pointers;
+    AudioShmBuffer::BusPointers process_buffers_output_pointers;
 
     /**
      * This instance's editor, if it has an open editor. Embedding here works
      * exactly the same as how it works for VST2 plugins.
      */
-    std::optional<Editor> editor;
+    EditorCache editor;
+
+    /**
+     * Retains the last state sent in a `getState()` response so subsequent
+     * responses only have to transfer the ranges that changed, see
+     * `YaBStream::encode_against()`. Hosts fetch the full state on every
+     * autosave, and between autosaves most of it stays identical.
+     */
+    StateDiffEncoder state_diff_encoder;
 
     /**
      * The base object we cast from. This is upcasted from the object created by
@@ -324,6 +345,28 @@ class Vst3Bridge : public HostBridge {
      */
     void unregister_context_menu(Vst3ContextMenuProxyImpl& context_menu);
 
+    /**
+     * If the native plugin side told us that `notify()` calls made on this
+     * object's connection point proxy can be delivered directly to another
+     * bridged object in this process (see
+     * `YaConnectionPoint::BypassConnectionProxy`), then deliver the message
+     * to that object and return the result. Returns a nullopt when no local
+     * peer is known, in which case the message has to be routed through the
+     * host's connection proxy as usual.
+     */
+    std::optional<tresult> maybe_notify_local_peer(
+        size_t instance_id,
+        Steinberg::Vst::IMessage* message) noexcept;
+
+    /**
+     * The time between GUI frames based on this plugin's `frame_rate` option.
+     * `Vst3ComponentHandlerProxyImpl` uses this as the flush interval when
+     * batching `IComponentHandler::performEdit()` calls.
+     */
+    std::chrono::steady_clock::duration event_loop_interval() const noexcept {
+        return config_.event_loop_interval();
+    }
+
    protected:
     void close_sockets() override;
 
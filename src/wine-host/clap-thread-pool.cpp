@@ -0,0 +1,150 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "clap-thread-pool.h"
+
+#include <pthread.h>
+#include <string>
+
+#include "../common/utils.h"
+
+ClapThreadPool& ClapThreadPool::instance() {
+    static ClapThreadPool pool{};
+    return pool;
+}
+
+ClapThreadPool::ClapThreadPool() noexcept
+    : num_workers_(count_physical_cores() - 1) {}
+
+ClapThreadPool::~ClapThreadPool() noexcept {
+    {
+        std::lock_guard lock(wake_mutex_);
+        shutdown_.store(true);
+    }
+    wake_cv_.notify_all();
+
+    // The `Win32Thread` destructors will join the workers
+}
+
+void ClapThreadPool::run_tasks_impl(uint32_t num_tasks,
+                                    void (*invoke)(void* context,
+                                                   uint32_t task_index),
+                                    void* context) {
+    std::lock_guard exec_lock(exec_mutex_);
+    ensure_workers_started();
+
+    invoke_ = invoke;
+    context_ = context;
+    num_tasks_.store(num_tasks, std::memory_order_relaxed);
+    num_remaining_.store(num_tasks, std::memory_order_relaxed);
+
+    // Publishing the new generation with a zeroed task index hands the batch
+    // to the workers. This is done while holding `wake_mutex_` so a worker's
+    // wakeup predicate can never miss it.
+    const uint32_t generation =
+        static_cast<uint32_t>(
+            batch_state_.load(std::memory_order_relaxed) >> 32) +
+        1;
+    {
+        std::lock_guard lock(wake_mutex_);
+        batch_state_.store(static_cast<uint64_t>(generation) << 32,
+                           std::memory_order_release);
+    }
+    wake_cv_.notify_all();
+
+    // We'll claim tasks ourselves instead of just blocking. With every
+    // physical core hosting either a worker or this thread, the batch runs at
+    // full hardware parallelism.
+    claim_tasks(generation);
+
+    std::unique_lock lock(done_mutex_);
+    done_cv_.wait(lock, [&]() {
+        return num_remaining_.load(std::memory_order_acquire) == 0;
+    });
+}
+
+void ClapThreadPool::claim_tasks(uint32_t generation) {
+    uint64_t state = batch_state_.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(state >> 32) == generation &&
+           static_cast<uint32_t>(state) <
+               num_tasks_.load(std::memory_order_relaxed)) {
+        // The generation check in the compare-exchange means a claim can only
+        // ever succeed for the batch this thread was woken up for
+        if (!batch_state_.compare_exchange_weak(state, state + 1,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+            continue;
+        }
+
+        invoke_(context_, static_cast<uint32_t>(state));
+
+        if (num_remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // This was the batch's last task, so wake up the submitting
+            // thread. The empty critical section prevents the classic missed
+            // wakeup between its predicate check and its wait.
+            { std::lock_guard lock(done_mutex_); }
+            done_cv_.notify_one();
+        }
+
+        state = batch_state_.load(std::memory_order_acquire);
+    }
+}
+
+void ClapThreadPool::ensure_workers_started() {
+    std::call_once(workers_started_, [&]() {
+        worker_threads_.reserve(num_workers_);
+        for (size_t worker_index = 0; worker_index < num_workers_;
+             worker_index++) {
+            worker_threads_.emplace_back(
+                [this, worker_index]() { worker_loop(worker_index); });
+        }
+    });
+}
+
+void ClapThreadPool::worker_loop(size_t worker_index) {
+    set_realtime_priority(true);
+    const ThreadRegistry::Guard thread_guard =
+        ThreadRegistry::instance().register_thread("clap-pool", worker_index);
+
+    // Most plugins will already enable FTZ, but there are a handful of
+    // plugins that don't that suffer from extreme DSP load increases when
+    // they start producing denormals. These threads only ever run plugin
+    // audio code, so the flag just stays enabled for the thread's lifetime.
+    ensure_flush_to_zero();
+
+    uint32_t last_generation = 0;
+    while (true) {
+        uint32_t generation;
+        {
+            std::unique_lock lock(wake_mutex_);
+            wake_cv_.wait(lock, [&]() {
+                const uint64_t state =
+                    batch_state_.load(std::memory_order_acquire);
+                return shutdown_.load(std::memory_order_relaxed) ||
+                       static_cast<uint32_t>(state >> 32) != last_generation;
+            });
+            if (shutdown_.load(std::memory_order_relaxed)) {
+                break;
+            }
+
+            generation = static_cast<uint32_t>(
+                batch_state_.load(std::memory_order_acquire) >> 32);
+        }
+
+        claim_tasks(generation);
+        last_generation = generation;
+    }
+}
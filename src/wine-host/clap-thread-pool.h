@@ -0,0 +1,179 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * A process wide fork-join worker pool backing the host side of CLAP's
+ * `clap.thread-pool` extension. When a plugin calls
+ * `clap_host_thread_pool::request_exec()` during processing, the tasks are
+ * spread over this pool's workers and executed by calling
+ * `clap_plugin_thread_pool::exec()` directly on the Wine side. Round-tripping
+ * every task to the native host's thread pool would mean a socket round trip
+ * per voice per block, so the native host is never involved: the plugin gets
+ * its parallelism from these workers instead.
+ *
+ * This is separate from `AudioWorkerPool` because the two solve opposite
+ * problems: that pool funnels many concurrent processing calls onto a bounded
+ * set of threads, while this one fans a single processing call out over idle
+ * cores and joins the results. The calling audio thread participates in
+ * executing tasks, so the pool only spawns one worker fewer than the machine
+ * has physical cores, and none at all until the first `request_exec()` call.
+ */
+class ClapThreadPool {
+   public:
+    /**
+     * The pool shared by all plugins hosted in this process. The workers are
+     * only spawned once a plugin first asks for an exec.
+     */
+    static ClapThreadPool& instance();
+
+    ClapThreadPool(const ClapThreadPool&) = delete;
+    ClapThreadPool& operator=(const ClapThreadPool&) = delete;
+
+    ClapThreadPool(ClapThreadPool&&) = delete;
+    ClapThreadPool& operator=(ClapThreadPool&&) = delete;
+
+    /**
+     * Run `fn(task_index)` for every index in `[0, num_tasks)`, spread over
+     * the pool's workers and the calling thread, and block until every task
+     * has finished. The callable lives on the caller's stack for the duration
+     * of the call, so this never allocates. Concurrent calls from different
+     * plugin instances are serialized, with each batch still running its own
+     * tasks in parallel. On a single core machine the tasks simply run
+     * sequentially on the calling thread.
+     */
+    template <typename F>
+    void run_tasks(uint32_t num_tasks, F&& fn) {
+        if (num_workers_ == 0 || num_tasks <= 1) {
+            for (uint32_t task_index = 0; task_index < num_tasks;
+                 task_index++) {
+                fn(task_index);
+            }
+            return;
+        }
+
+        run_tasks_impl(
+            num_tasks,
+            [](void* context, uint32_t task_index) {
+                (*static_cast<std::remove_reference_t<F>*>(context))(
+                    task_index);
+            },
+            &fn);
+    }
+
+   private:
+    ClapThreadPool() noexcept;
+    ~ClapThreadPool() noexcept;
+
+    /**
+     * Publish a batch of type erased tasks to the workers, claim and execute
+     * tasks on the calling thread, and block until the entire batch has
+     * finished. Used by `run_tasks()`.
+     */
+    void run_tasks_impl(uint32_t num_tasks,
+                        void (*invoke)(void* context, uint32_t task_index),
+                        void* context);
+
+    /**
+     * Claim and execute tasks from the batch with the given generation until
+     * all of its task indices have been handed out or a new batch has
+     * replaced it. Whoever executes the batch's last task notifies
+     * `done_cv_`.
+     */
+    void claim_tasks(uint32_t generation);
+
+    /**
+     * Spawn the worker threads if that hasn't happened yet. Called on the
+     * first `run_tasks()` call that can actually use them.
+     */
+    void ensure_workers_started();
+
+    /**
+     * The worker thread entry point. Waits for a new batch generation to be
+     * published and then claims tasks from it alongside the other workers and
+     * the submitting audio thread.
+     */
+    void worker_loop(size_t worker_index);
+
+    /**
+     * The number of workers that will be spawned. One less than the machine's
+     * physical core count since the thread calling `run_tasks()` also
+     * executes tasks. When this is zero the pool always runs tasks inline.
+     */
+    const size_t num_workers_;
+
+    std::vector<Win32Thread> worker_threads_;
+    std::once_flag workers_started_;
+
+    /**
+     * Held for the duration of `run_tasks_impl()` so only a single batch is
+     * ever in flight.
+     */
+    std::mutex exec_mutex_;
+
+    // The state for the batch that's currently in flight. These fields are
+    // written while holding `exec_mutex_` before the batch is published
+    // through `batch_state_`, and the release/acquire pair on that atomic
+    // makes them visible to the workers.
+
+    void (*invoke_)(void* context, uint32_t task_index) = nullptr;
+    void* context_ = nullptr;
+    /**
+     * The number of tasks in the current batch. Atomic because a worker that
+     * lost the race for the previous batch's last task may still compare its
+     * stale claim against this while the next batch is being set up.
+     */
+    std::atomic_uint32_t num_tasks_ = 0;
+    /**
+     * The number of tasks in the current batch that haven't finished
+     * executing yet. The batch is done once this hits zero.
+     */
+    std::atomic_uint32_t num_remaining_ = 0;
+
+    /**
+     * The batch generation in the upper 32 bits, and the next unclaimed task
+     * index in the lower 32 bits. Packing these into a single atomic means a
+     * task claim also proves which batch it belongs to: a worker that wakes
+     * up late or stalls simply has its claims fail once the generation moves
+     * on, so it can never execute a task with the wrong batch's context.
+     */
+    std::atomic_uint64_t batch_state_ = 0;
+
+    /**
+     * Idle workers wait on this for the next batch generation. Publishing a
+     * batch or shutting the pool down notifies it.
+     */
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+
+    /**
+     * The submitting thread waits on this for `num_remaining_` to hit zero
+     * after it runs out of tasks to claim for itself.
+     */
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+
+    std::atomic_bool shutdown_ = false;
+};
@@ -16,7 +16,17 @@
 
 #include "editor.h"
 
+#include <unistd.h>
+
+// Use the native version of xcb, like in the header
+#pragma push_macro("_WIN32")
+#undef _WIN32
+#include <xcb/randr.h>
+#pragma pop_macro("_WIN32")
+
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 
 #include <llvm/small-vector.h>
@@ -192,6 +202,163 @@ xcb_window_t get_x11_handle(HWND win32_handle) noexcept;
  */
 ATOM get_window_class() noexcept;
 
+std::shared_ptr<SharedX11Connection> SharedX11Connection::get(
+    MainContext& main_context) {
+    // Every event loop thread runs its own `MainContext`, so keying the
+    // registry on the context gives each thread its own connection without
+    // any further synchronization within the instances themselves. Expired
+    // entries are left in place since the number of event loops per process
+    // is tiny.
+    static std::mutex registry_mutex{};
+    static std::unordered_map<MainContext*, std::weak_ptr<SharedX11Connection>>
+        registry{};
+
+    std::lock_guard lock(registry_mutex);
+    std::weak_ptr<SharedX11Connection>& entry = registry[&main_context];
+    if (std::shared_ptr<SharedX11Connection> existing = entry.lock();
+        existing && !xcb_connection_has_error(existing->connection_.get())) {
+        return existing;
+    }
+
+    // `std::make_shared` can't reach the private constructor
+    std::shared_ptr<SharedX11Connection> created(
+        new SharedX11Connection(main_context));
+    entry = created;
+
+    return created;
+}
+
+SharedX11Connection::SharedX11Connection(MainContext& main_context)
+    : connection_(xcb_connect(nullptr, nullptr), xcb_disconnect),
+      event_fd_(main_context.context_,
+                dup(xcb_get_file_descriptor(connection_.get()))) {
+    async_handle_events();
+}
+
+void SharedX11Connection::async_handle_events() noexcept {
+    event_fd_.async_wait(
+        asio::posix::stream_descriptor::wait_read,
+        [this](const std::error_code& error) {
+            // The wait gets cancelled when the last editor is closed, and at
+            // that point this object may no longer exist
+            if (error) {
+                return;
+            }
+
+            handle_events();
+
+            // If the connection broke the descriptor stays readable while
+            // `xcb_poll_for_event()` no longer returns anything, so rearming
+            // would turn this into a busy loop
+            if (xcb_connection_has_error(connection_.get())) {
+                return;
+            }
+
+            async_handle_events();
+        });
+}
+
+xcb_atom_t SharedX11Connection::atom(const char* atom_name) {
+    if (const auto existing_atom = atom_cache_.find(atom_name);
+        existing_atom != atom_cache_.end()) {
+        return existing_atom->second;
+    }
+
+    const xcb_atom_t interned_atom = get_atom_by_name(*connection_, atom_name);
+    if (interned_atom != XCB_ATOM_NONE) {
+        atom_cache_.emplace(atom_name, interned_atom);
+    }
+
+    return interned_atom;
+}
+
+void SharedX11Connection::register_editor(Editor& editor) {
+    editors_.push_back(&editor);
+}
+
+void SharedX11Connection::unregister_editor(Editor& editor) noexcept {
+    editors_.erase(std::find(editors_.begin(), editors_.end(), &editor));
+
+    // With per-editor connections the editor's event masks simply went away
+    // with the connection. Now we'll explicitly downgrade the masks to what
+    // the remaining editors still need, so windows owned by the host don't
+    // keep streaming events nobody is interested in anymore. Windows the
+    // editor owned itself are about to be destroyed anyways, and the
+    // resulting asynchronous errors just end up in the unhandled event
+    // branch.
+    for (auto subscriptions = event_masks_.begin();
+         subscriptions != event_masks_.end();) {
+        const auto subscription = std::find_if(
+            subscriptions->second.begin(), subscriptions->second.end(),
+            [&](const auto& entry) { return entry.first == &editor; });
+        if (subscription != subscriptions->second.end()) {
+            subscriptions->second.erase(subscription);
+            apply_event_mask(subscriptions->first);
+        }
+
+        if (subscriptions->second.empty()) {
+            subscriptions = event_masks_.erase(subscriptions);
+        } else {
+            subscriptions++;
+        }
+    }
+
+    xcb_flush(connection_.get());
+}
+
+void SharedX11Connection::set_event_mask(const Editor& editor,
+                                         xcb_window_t window,
+                                         uint32_t event_mask) {
+    std::vector<std::pair<const Editor*, uint32_t>>& subscriptions =
+        event_masks_[window];
+    const auto subscription = std::find_if(
+        subscriptions.begin(), subscriptions.end(),
+        [&](const auto& entry) { return entry.first == &editor; });
+    if (event_mask == XCB_EVENT_MASK_NO_EVENT) {
+        if (subscription != subscriptions.end()) {
+            subscriptions.erase(subscription);
+        }
+    } else if (subscription != subscriptions.end()) {
+        subscription->second = event_mask;
+    } else {
+        subscriptions.emplace_back(&editor, event_mask);
+    }
+
+    apply_event_mask(window);
+    if (subscriptions.empty()) {
+        event_masks_.erase(window);
+    }
+}
+
+void SharedX11Connection::apply_event_mask(xcb_window_t window) noexcept {
+    uint32_t combined_mask = XCB_EVENT_MASK_NO_EVENT;
+    if (const auto subscriptions = event_masks_.find(window);
+        subscriptions != event_masks_.end()) {
+        for (const auto& [editor, event_mask] : subscriptions->second) {
+            combined_mask |= event_mask;
+        }
+    }
+
+    xcb_change_window_attributes(connection_.get(), window, XCB_CW_EVENT_MASK,
+                                 &combined_mask);
+}
+
+void SharedX11Connection::handle_events() noexcept {
+    std::unique_ptr<xcb_generic_event_t> generic_event;
+    while (generic_event.reset(xcb_poll_for_event(connection_.get())),
+           generic_event != nullptr) {
+        // The editors filter on their own windows, just like they did when
+        // they each drained their own connection
+        for (Editor* editor : editors_) {
+            editor->handle_x11_event(*generic_event);
+        }
+    }
+
+    for (Editor* editor : editors_) {
+        editor->finish_x11_event_batch();
+    }
+}
+
 DeferredWin32Window::DeferredWin32Window(
     MainContext& main_context,
     std::shared_ptr<xcb_connection_t> x11_connection,
@@ -264,7 +431,10 @@ Editor::Editor(MainContext& main_context,
       use_force_dnd_(config.editor_force_dnd),
       use_xembed_(config.editor_xembed),
       logger_(logger),
-      x11_connection_(xcb_connect(nullptr, nullptr), xcb_disconnect),
+      main_context_(main_context),
+      event_loop_guard_(main_context.register_editor()),
+      shared_x11_(SharedX11Connection::get(main_context)),
+      x11_connection_(shared_x11_->connection()),
       dnd_proxy_handle_(WineXdndProxy::get_handle()),
       client_area_(get_maximum_screen_dimensions(*x11_connection_)),
       wrapper_window_size_({128, 128}),
@@ -300,20 +470,28 @@ Editor::Editor(MainContext& main_context,
                                    nullptr,
                                    GetModuleHandle(nullptr),
                                    this)),
-      idle_timer_(
-          Win32Timer(win32_window_.handle_,
-                     idle_timer_id,
-                     std::chrono::duration_cast<std::chrono::milliseconds>(
-                         config.event_loop_interval())
-                         .count())),
+      idle_interval_(config.event_loop_interval()),
       idle_timer_proc_([this, timer_proc = std::move(timer_proc)]() mutable {
           handle_x11_events();
-          if (timer_proc) {
+          // A parked editor is closed as far as the plugin is concerned, so
+          // it shouldn't receive any idle calls
+          if (timer_proc && !parked_) {
               (*timer_proc)();
           }
       }),
-      xcb_wm_state_property_(
-          get_atom_by_name(*x11_connection_, wm_state_property_name)),
+      idle_fallback_timer_(
+          Win32Timer(win32_window_.handle_,
+                     idle_timer_id,
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                         config.event_loop_interval())
+                         .count())),
+      idle_tick_timer_(main_context.register_tick_timer(
+          idle_interval_,
+          [this]() {
+              last_idle_tick_ = std::chrono::steady_clock::now();
+              idle_timer_proc_();
+          })),
+      xcb_wm_state_property_(shared_x11_->atom(wm_state_property_name)),
       parent_window_(parent_window_handle),
       wrapper_window_(
           x11_connection_,
@@ -339,7 +517,8 @@ Editor::Editor(MainContext& main_context,
       host_window_(find_host_window(*x11_connection_,
                                     parent_window_,
                                     xcb_wm_state_property_)
-                       .value_or(parent_window_)) {
+                       .value_or(parent_window_)),
+      coordinate_fix_interval_(config.event_loop_interval()) {
     logger.log_editor_trace([&]() {
         return "DEBUG: host_window: " + std::to_string(host_window_);
     });
@@ -358,8 +537,7 @@ Editor::Editor(MainContext& main_context,
     // active. In case the atom does not exist or the WM does not support this
     // hint, we'll print a warning and fall back to grabbing focus when the user
     // clicks on the window (which should trigger a `WM_PARENTNOTIFY`).
-    active_window_property_ =
-        get_atom_by_name(*x11_connection_, active_window_property_name);
+    active_window_property_ = shared_x11_->atom(active_window_property_name);
     if (!supports_ewmh_active_window()) {
         std::cerr << "WARNING: The current window manager does not support the"
                   << std::endl;
@@ -370,8 +548,7 @@ Editor::Editor(MainContext& main_context,
     }
 
     // When using XEmbed we'll need the atoms for the corresponding properties
-    xcb_xembed_message_ =
-        get_atom_by_name(*x11_connection_, xembed_message_name);
+    xcb_xembed_message_ = shared_x11_->atom(xembed_message_name);
 
     // When not using XEmbed, Wine will interpret any local coordinates as
     // global coordinates. To work around this we'll tell the Wine window it's
@@ -387,12 +564,10 @@ Editor::Editor(MainContext& main_context,
     // `parent_window_` themselves.
     // If we do enable XEmbed support, we'll also listen for visibility changes
     // and trigger the embedding when the window becomes visible
-    xcb_change_window_attributes(x11_connection_.get(), host_window_,
-                                 XCB_CW_EVENT_MASK, &host_event_mask);
-    xcb_change_window_attributes(x11_connection_.get(), parent_window_,
-                                 XCB_CW_EVENT_MASK, &parent_event_mask);
-    xcb_change_window_attributes(x11_connection_.get(), wrapper_window_.window_,
-                                 XCB_CW_EVENT_MASK, &wrapper_event_mask);
+    shared_x11_->set_event_mask(*this, host_window_, host_event_mask);
+    shared_x11_->set_event_mask(*this, parent_window_, parent_event_mask);
+    shared_x11_->set_event_mask(*this, wrapper_window_.window_,
+                                wrapper_event_mask);
     xcb_flush(x11_connection_.get());
 
     // First reparent our dumb wrapper window to the host's window, and then
@@ -414,6 +589,15 @@ Editor::Editor(MainContext& main_context,
         // described in `Editor`'s docstring'.
         do_reparent(wine_window_, wrapper_window_.window_);
     }
+
+    // From this point on incoming X11 events are dispatched to this editor as
+    // soon as they arrive. The Win32 timer above stays around for when the
+    // message loop is being blocked and the IO context thus can't run.
+    shared_x11_->register_editor(*this);
+}
+
+Editor::~Editor() noexcept {
+    shared_x11_->unregister_editor(*this);
 }
 
 void Editor::resize(uint16_t width, uint16_t height) {
@@ -463,313 +647,365 @@ void Editor::show() noexcept {
     ShowWindow(win32_window_.handle_, SW_SHOWNORMAL);
 }
 
+void Editor::park() {
+    logger_.log_editor_trace([&]() {
+        return "DEBUG: Parking the editor for parent window " +
+               std::to_string(parent_window_);
+    });
+
+    parked_ = true;
+    should_fix_local_coordinates_ = false;
+
+    // Without any visible editors the event loop can fall back to its slower
+    // idle rate again
+    event_loop_guard_.reset();
+
+    ShowWindow(win32_window_.handle_, SW_HIDE);
+
+    // The host is likely going to destroy `parent_window_` now that the
+    // editor has closed, and the wrapper window would be destroyed right
+    // along with it if we left it embedded there. The Wine window stays
+    // embedded inside of the wrapper window.
+    shared_x11_->set_event_mask(*this, host_window_, XCB_EVENT_MASK_NO_EVENT);
+    shared_x11_->set_event_mask(*this, parent_window_,
+                                XCB_EVENT_MASK_NO_EVENT);
+    xcb_unmap_window(x11_connection_.get(), wrapper_window_.window_);
+
+    const xcb_window_t root_window =
+        get_root_window(*x11_connection_, wrapper_window_.window_);
+    do_reparent(wrapper_window_.window_, root_window);
+}
+
+void Editor::reactivate(const size_t parent_window_handle) {
+    parent_window_ = static_cast<xcb_window_t>(parent_window_handle);
+    host_window_ = find_host_window(*x11_connection_, parent_window_,
+                                    xcb_wm_state_property_)
+                       .value_or(parent_window_);
+
+    logger_.log_editor_trace([&]() {
+        return "DEBUG: Reactivating the parked editor for parent window " +
+               std::to_string(parent_window_);
+    });
+
+    // This is the same embedding dance performed at the end of the
+    // constructor. The wrapper window kept its own event mask while parked,
+    // so only the subscriptions on the host's windows need to be restored.
+    shared_x11_->set_event_mask(*this, host_window_, host_event_mask);
+    shared_x11_->set_event_mask(*this, parent_window_, parent_event_mask);
+    xcb_flush(x11_connection_.get());
+
+    do_reparent(wrapper_window_.window_, parent_window_);
+    xcb_map_window(x11_connection_.get(), wrapper_window_.window_);
+    xcb_flush(x11_connection_.get());
+
+    if (use_xembed_) {
+        do_xembed();
+    }
+
+    parked_ = false;
+    event_loop_guard_.emplace(main_context_.register_editor());
+
+    // The Wine window needs to be told its position within the new parent
+    // window, this will happen after the next batch of X11 events
+    should_fix_local_coordinates_ = true;
+}
+
 void Editor::handle_x11_events() noexcept {
+    shared_x11_->handle_events();
+}
+
+void Editor::handle_x11_event(xcb_generic_event_t& generic_event) noexcept {
+    // Parked editors are detached from the host's windows and should stay
+    // inert until they're reactivated
+    if (parked_) {
+        return;
+    }
+
     // NOTE: Ardour will unmap the window instead of closing the editor. When
     //       the window is unmapped `wine_window_` doesn't exist and any X11
     //       function calls involving it will fail. All functions called from
     //       here should be able to handle that cleanly.
     try {
-        // HACK: See the docstrings on `should_fix_local_coordinates_` and
-        //       `fix_local_coordinates()`
-        if (should_fix_local_coordinates_ && !is_mouse_button_held()) {
-            logger_.log_editor_trace([&]() {
-                return "DEBUG: Performing spooled local coordinate fix";
-            });
-
-            fix_local_coordinates();
-            should_fix_local_coordinates_ = false;
-        }
-
-        std::unique_ptr<xcb_generic_event_t> generic_event;
-        while (generic_event.reset(xcb_poll_for_event(x11_connection_.get())),
-               generic_event != nullptr) {
-            const uint8_t event_type =
-                generic_event->response_type & xcb_event_type_mask;
-            const bool is_synthetic_event =
-                generic_event->response_type & ~xcb_event_type_mask;
-            switch (event_type) {
-                // NOTE: When reopening a closed editor window in REAPER, REAPER
-                //       will initialize the editor first, and only then will it
-                //       reparent `parent_window_` to a new FX window. This
-                //       means that `host_window_` will be the same as
-                //       `parent_window_` in REAPER if you reopen a plugin GUI,
-                //       which breaks our input focus handling. To work around
-                //       this, we will just check if the host's window has
-                //       changed whenever the parent window gets reparented.
-                //       REAPER does the same thing when inserting a plugin on a
-                //       new track with the `Track -> Insert virtual instrument
-                //       on new track...` option.
-                case XCB_REPARENT_NOTIFY: {
-                    const auto event =
-                        reinterpret_cast<xcb_reparent_notify_event_t*>(
-                            generic_event.get());
+        const uint8_t event_type =
+            generic_event.response_type & xcb_event_type_mask;
+        const bool is_synthetic_event =
+            generic_event.response_type & ~xcb_event_type_mask;
+        switch (event_type) {
+            // NOTE: When reopening a closed editor window in REAPER, REAPER
+            //       will initialize the editor first, and only then will it
+            //       reparent `parent_window_` to a new FX window. This
+            //       means that `host_window_` will be the same as
+            //       `parent_window_` in REAPER if you reopen a plugin GUI,
+            //       which breaks our input focus handling. To work around
+            //       this, we will just check if the host's window has
+            //       changed whenever the parent window gets reparented.
+            //       REAPER does the same thing when inserting a plugin on a
+            //       new track with the `Track -> Insert virtual instrument
+            //       on new track...` option.
+            case XCB_REPARENT_NOTIFY: {
+                const auto event =
+                    reinterpret_cast<xcb_reparent_notify_event_t*>(
+                        &generic_event);
+                logger_.log_editor_trace([&]() {
+                    return "DEBUG: ReparentNotify for window " +
+                           std::to_string(event->window) +
+                           " to new parent " +
+                           std::to_string(event->parent) +
+                           ", generated from " +
+                           std::to_string(event->event);
+                });
+
+                redetect_host_window();
+
+                // If the `editor_force_dnd` option is set, we'll strip
+                // `XdndAware` from all of `wine_window_`'s ancestors
+                // (including `parent_window_`) to forcefully enable
+                // drag-and-drop support in REAPER. See the docstring on
+                // `Configuration::editor_force_dnd` and the option
+                // description in the readme for more information.
+                // NOTE: This also needs to be done here for the same reason
+                //       as the one mentioned above
+                if (use_force_dnd_) {
                     logger_.log_editor_trace([&]() {
-                        return "DEBUG: ReparentNotify for window " +
-                               std::to_string(event->window) +
-                               " to new parent " +
-                               std::to_string(event->parent) +
-                               ", generated from " +
-                               std::to_string(event->event);
+                        return "DEBUG: Removing XdndAware properties from "
+                               "window " +
+                               std::to_string(parent_window_) +
+                               " and all of its ancestors";
                     });
 
-                    redetect_host_window();
-
-                    // If the `editor_force_dnd` option is set, we'll strip
-                    // `XdndAware` from all of `wine_window_`'s ancestors
-                    // (including `parent_window_`) to forcefully enable
-                    // drag-and-drop support in REAPER. See the docstring on
-                    // `Configuration::editor_force_dnd` and the option
-                    // description in the readme for more information.
-                    // NOTE: This also needs to be done here for the same reason
-                    //       as the one mentioned above
-                    if (use_force_dnd_) {
-                        logger_.log_editor_trace([&]() {
-                            return "DEBUG: Removing XdndAware properties from "
-                                   "window " +
-                                   std::to_string(parent_window_) +
-                                   " and all of its ancestors";
-                        });
-
-                        const xcb_atom_t xcb_xdnd_aware_property =
-                            get_atom_by_name(*x11_connection_,
-                                             xdnd_aware_property_name);
-                        for (const xcb_window_t& window : find_ancestor_windows(
-                                 *x11_connection_, parent_window_)) {
-                            xcb_delete_property(x11_connection_.get(), window,
-                                                xcb_xdnd_aware_property);
-                        }
+                    const xcb_atom_t xcb_xdnd_aware_property =
+                        shared_x11_->atom(xdnd_aware_property_name);
+                    for (const xcb_window_t& window : find_ancestor_windows(
+                             *x11_connection_, parent_window_)) {
+                        xcb_delete_property(x11_connection_.get(), window,
+                                            xcb_xdnd_aware_property);
                     }
+                }
 
-                } break;
-                // We're listening for `ConfigureNotify` events on the host's
-                //  window (i.e. the window that's actually going to get dragged
-                //  around the by the user). In most cases this is the same as
-                //  `parent_window_`. When either this window gets moved, or
-                //  when the user moves his mouse over our window, the local
-                //  coordinates should be updated. The additional `EnterWindow`
-                //  check is sometimes necessary for using multiple editor
-                //  windows within a single plugin group.
-                case XCB_CONFIGURE_NOTIFY: {
-                    const auto event =
-                        reinterpret_cast<xcb_configure_notify_event_t*>(
-                            generic_event.get());
-                    logger_.log_editor_trace([&]() {
-                        return "DEBUG: ConfigureNotify for window " +
-                               std::to_string(event->window);
-                    });
-
-                    if (event->window == host_window_ ||
-                        event->window == parent_window_ ||
-                        event->window == wrapper_window_.window_) {
-                        if (!use_xembed_) {
-                            // NOTE: See the docstring on this field. This
-                            //       avoids flickering with some window manager
-                            //       and plugin combinations when dragging
-                            //       plugin windows around.
-                            if (is_mouse_button_held()) {
-                                logger_.log_editor_trace([&]() {
-                                    return "DEBUG: ConfigureNotify received "
-                                           "while mouse button is held down, "
-                                           "spooling the coordinate fix";
-                                });
-
-                                should_fix_local_coordinates_ = true;
-                            } else {
-                                fix_local_coordinates();
-                            }
-                        }
+            } break;
+            // We're listening for `ConfigureNotify` events on the host's
+            //  window (i.e. the window that's actually going to get dragged
+            //  around the by the user). In most cases this is the same as
+            //  `parent_window_`. When either this window gets moved, or
+            //  when the user moves his mouse over our window, the local
+            //  coordinates should be updated. The additional `EnterWindow`
+            //  check is sometimes necessary for using multiple editor
+            //  windows within a single plugin group.
+            case XCB_CONFIGURE_NOTIFY: {
+                const auto event =
+                    reinterpret_cast<xcb_configure_notify_event_t*>(
+                        &generic_event);
+                logger_.log_editor_trace([&]() {
+                    return "DEBUG: ConfigureNotify for window " +
+                           std::to_string(event->window);
+                });
+
+                if (event->window == host_window_ ||
+                    event->window == parent_window_ ||
+                    event->window == wrapper_window_.window_) {
+                    if (!use_xembed_) {
+                        // NOTE: See the docstring on this field. The
+                        //       actual fixup is performed at most once
+                        //       after draining the queue, so a storm of
+                        //       configure events during a resize or drag
+                        //       collapses into a single
+                        //       `fix_local_coordinates()` call.
+                        should_fix_local_coordinates_ = true;
                     }
-                } break;
-                // Start the XEmbed procedure when the window becomes visible,
-                // since most hosts will only show the window after the plugin
-                // has embedded itself into it.
-                case XCB_VISIBILITY_NOTIFY: {
-                    const auto event =
-                        reinterpret_cast<xcb_visibility_notify_event_t*>(
-                            generic_event.get());
-                    logger_.log_editor_trace([&]() {
-                        return "DEBUG: VisibilityNotify for window " +
-                               std::to_string(event->window);
-                    });
-
-                    if (event->window == host_window_ ||
-                        event->window == parent_window_) {
-                        if (use_xembed_) {
-                            do_xembed();
-                        }
+                }
+            } break;
+            // Start the XEmbed procedure when the window becomes visible,
+            // since most hosts will only show the window after the plugin
+            // has embedded itself into it.
+            case XCB_VISIBILITY_NOTIFY: {
+                const auto event =
+                    reinterpret_cast<xcb_visibility_notify_event_t*>(
+                        &generic_event);
+                logger_.log_editor_trace([&]() {
+                    return "DEBUG: VisibilityNotify for window " +
+                           std::to_string(event->window);
+                });
+
+                if (event->window == host_window_ ||
+                    event->window == parent_window_) {
+                    if (use_xembed_) {
+                        do_xembed();
                     }
-                } break;
-                // We want to grab keyboard input focus when the user hovers
-                // over our embedded Wine window AND that window is a child of
-                // the currently active window. This ensures that the behavior
-                // is similar to what you'd expect of a native application,
-                // without grabbing input focus when accidentally hovering over
-                // a yabridge window in the background. The `FocusIn` is needed
-                // for when returning to the main plugin window after closing a
-                // dialog, since that often won't trigger an `EnterNotify'.
-                case XCB_ENTER_NOTIFY:
-                case XCB_FOCUS_IN: {
-                    const xcb_window_t window =
-                        event_type == XCB_ENTER_NOTIFY
-                            ? reinterpret_cast<xcb_enter_notify_event_t*>(
-                                  generic_event.get())
-                                  ->child
-                            : reinterpret_cast<xcb_focus_in_event_t*>(
-                                  generic_event.get())
-                                  ->event;
-                    logger_.log_editor_trace([&]() {
-                        return "DEBUG: "s +
-                               (event_type == XCB_ENTER_NOTIFY ? "EnterNotify"
-                                                               : "FocusIn") +
-                               " for window " + std::to_string(window) +
-                               " (wine window " +
-                               (is_wine_window_active() ? "active"
-                                                        : "inactive") +
-                               ")";
-                    });
-
-                    if (window == parent_window_ ||
-                        window == wrapper_window_.window_) {
-                        if (!use_xembed_) {
-                            fix_local_coordinates();
-                        }
-
-                        // In case the WM somehow does not support
-                        // `_NET_ACTIVE_WINDOW`, a more naive focus grabbing
-                        // method implemented in the `WM_PARENTNOTIFY` handler
-                        // will be used.
-                        if (supports_ewmh_active_window() &&
-                            is_wine_window_active()) {
-                            set_input_focus(true);
-                        }
+                }
+            } break;
+            // We want to grab keyboard input focus when the user hovers
+            // over our embedded Wine window AND that window is a child of
+            // the currently active window. This ensures that the behavior
+            // is similar to what you'd expect of a native application,
+            // without grabbing input focus when accidentally hovering over
+            // a yabridge window in the background. The `FocusIn` is needed
+            // for when returning to the main plugin window after closing a
+            // dialog, since that often won't trigger an `EnterNotify'.
+            case XCB_ENTER_NOTIFY:
+            case XCB_FOCUS_IN: {
+                const xcb_window_t window =
+                    event_type == XCB_ENTER_NOTIFY
+                        ? reinterpret_cast<xcb_enter_notify_event_t*>(
+                              &generic_event)
+                              ->child
+                        : reinterpret_cast<xcb_focus_in_event_t*>(
+                              &generic_event)
+                              ->event;
+                logger_.log_editor_trace([&]() {
+                    return "DEBUG: "s +
+                           (event_type == XCB_ENTER_NOTIFY ? "EnterNotify"
+                                                           : "FocusIn") +
+                           " for window " + std::to_string(window) +
+                           " (wine window " +
+                           (is_wine_window_active() ? "active"
+                                                    : "inactive") +
+                           ")";
+                });
+
+                if (window == parent_window_ ||
+                    window == wrapper_window_.window_) {
+                    if (!use_xembed_) {
+                        fix_local_coordinates();
                     }
-                } break;
-                // When the user moves their mouse away from the Wine window
-                // _while the window provided by the host it is contained in is
-                // still active_, we will give back keyboard focus to that
-                // window. This for instance allows you to still use the search
-                // bar in REAPER's FX window. This distinction is important,
-                // because we do not want to mess with keyboard focus when
-                // hovering over the window while for instance a dialog is open.
-                case XCB_LEAVE_NOTIFY: {
-                    const auto event =
-                        reinterpret_cast<xcb_leave_notify_event_t*>(
-                            generic_event.get());
-
-                    // HACK: We need to do a `WindowFromPoint()` query inside of
-                    //       `is_cursor_in_wine_window()`, and
-                    //       `GetCursorPos()`'s value only updates once every
-                    //       100 milliseconds:
-                    //       https://github.com/wine-mirror/wine/blob/25271032dfb3f126a8b0dff2adb9b96a7d09241d/dlls/user32/input.c#L345
-                    //
-                    //       To avoid this, we will use the X11 cursor position.
-                    //       For this to work we will need to translate X11 root
-                    //       window coordinates into Wine virtual screen
-                    //       coordinates, like so:
-                    //       https://github.com/wine-mirror/wine/tree/25271032dfb3f126a8b0dff2adb9b96a7d09241d/dlls/winex11.drv/display.c
-                    //
-                    //       This function is sadly not exposed, so instead we
-                    //       will get the root window cursor position, and then
-                    //       add to that the difference between `wine_window_`'s
-                    //       root-relative X11 position and its Win32 position.
-                    //       The alternative is sleeping for 100 milliseconds,
-                    //       but this is faster.
-                    const std::optional<POINT> windows_pointer_pos =
-                        get_current_pointer_position();
 
-                    logger_.log_editor_trace([&]() {
-                        std::ostringstream message;
-                        message << "DEBUG: LeaveNotify for window "
-                                << event->child;
-                        message << " (wine window "
-                                << (is_wine_window_active() ? "active"
-                                                            : "inactive");
-                        message << ", detail: "
-                                << static_cast<int>(event->detail);
-                        message << ", pointer pos: ";
-                        if (windows_pointer_pos) {
-                            message << windows_pointer_pos->x << ", "
-                                    << windows_pointer_pos->y;
-                        } else {
-                            message << "<unknown>";
-                        }
-                        message
-                            << ", pointer "
-                            << (is_cursor_in_wine_window(windows_pointer_pos)
-                                    ? "is"
-                                    : "is not")
-                            << " in Wine window)";
-
-                        return message.str();
-                    });
-
-                    // This extra check for the `NonlinearVirtual` detail is
-                    // important (see
-                    // https://www.x.org/releases/X11R7.5/doc/x11proto/proto.html
-                    // for more information on what this actually means). I've
-                    // only seen this issue with the Tokyo Dawn Records plugins,
-                    // but a plugin may create a popup window that acts as a
-                    // dropdown without actually activating that window (unlike
-                    // with an actual Win32 dropdown menu). Without this check
-                    // these fake dropdowns would immediately close when
-                    // hovering over them.
-                    if (event->child == wrapper_window_.window_ &&
-                        supports_ewmh_active_window() &&
-                        is_wine_window_active() &&
-                        !is_cursor_in_wine_window(windows_pointer_pos)) {
-                        set_input_focus(false);
+                    // In case the WM somehow does not support
+                    // `_NET_ACTIVE_WINDOW`, a more naive focus grabbing
+                    // method implemented in the `WM_PARENTNOTIFY` handler
+                    // will be used.
+                    if (supports_ewmh_active_window() &&
+                        is_wine_window_active()) {
+                        set_input_focus(true);
                     }
-                } break;
-                // We need to forward synthetic keyboard events sent by the host
-                // from the wrapper window to the Wine window
-                // NOTE: We're _only_ forwarding synthetic events sent by the
-                //       host. Wine can listen for regular keyboard events on
-                //       its own, so we won't forward those. Bitwig Studio uses
-                //       this approach to still allow you to press Space to
-                //       control the transport.
-                case XCB_KEY_PRESS:
-                case XCB_KEY_RELEASE: {
-                    static_assert(std::is_same_v<xcb_key_press_event_t,
-                                                 xcb_key_release_event_t>);
-                    const auto event = reinterpret_cast<xcb_key_press_event_t*>(
-                        generic_event.get());
-                    logger_.log_editor_trace([&]() {
-                        return "DEBUG: "s +
-                               (is_synthetic_event ? "synthetic " : "") +
-                               (event_type == XCB_KEY_PRESS ? "KeyPress"
-                                                            : "KeyRelease") +
-                               " for window " + std::to_string(event->event) +
-                               " with key code " +
-                               std::to_string(event->detail);
-                    });
-
-                    if (is_synthetic_event &&
-                        event->event == wrapper_window_.window_) {
-                        const uint32_t event_mask =
-                            event_type == XCB_KEY_PRESS
-                                ? XCB_EVENT_MASK_KEY_PRESS
-                                : XCB_EVENT_MASK_KEY_RELEASE;
-
-                        // We will reset the `response_type`, because the X11
-                        // server will have already set the first bit for us to
-                        // indicate that it's a synthetic event. Most likely not
-                        // needed, but it feels like the right thing to do. All
-                        // other fields can stay the same.
-                        event->response_type = event_type;
-                        event->event = wine_window_;
-
-                        xcb_send_event(x11_connection_.get(), true,
-                                       wine_window_, event_mask,
-                                       reinterpret_cast<const char*>(event));
-                        xcb_flush(x11_connection_.get());
+                }
+            } break;
+            // When the user moves their mouse away from the Wine window
+            // _while the window provided by the host it is contained in is
+            // still active_, we will give back keyboard focus to that
+            // window. This for instance allows you to still use the search
+            // bar in REAPER's FX window. This distinction is important,
+            // because we do not want to mess with keyboard focus when
+            // hovering over the window while for instance a dialog is open.
+            case XCB_LEAVE_NOTIFY: {
+                const auto event =
+                    reinterpret_cast<xcb_leave_notify_event_t*>(
+                        &generic_event);
+
+                // HACK: We need to do a `WindowFromPoint()` query inside of
+                //       `is_cursor_in_wine_window()`, and
+                //       `GetCursorPos()`'s value only updates once every
+                //       100 milliseconds:
+                //       https://github.com/wine-mirror/wine/blob/25271032dfb3f126a8b0dff2adb9b96a7d09241d/dlls/user32/input.c#L345
+                //
+                //       To avoid this, we will use the X11 cursor position.
+                //       For this to work we will need to translate X11 root
+                //       window coordinates into Wine virtual screen
+                //       coordinates, like so:
+                //       https://github.com/wine-mirror/wine/tree/25271032dfb3f126a8b0dff2adb9b96a7d09241d/dlls/winex11.drv/display.c
+                //
+                //       This function is sadly not exposed, so instead we
+                //       will get the root window cursor position, and then
+                //       add to that the difference between `wine_window_`'s
+                //       root-relative X11 position and its Win32 position.
+                //       The alternative is sleeping for 100 milliseconds,
+                //       but this is faster.
+                const std::optional<POINT> windows_pointer_pos =
+                    get_current_pointer_position();
+
+                logger_.log_editor_trace([&]() {
+                    std::ostringstream message;
+                    message << "DEBUG: LeaveNotify for window "
+                            << event->child;
+                    message << " (wine window "
+                            << (is_wine_window_active() ? "active"
+                                                        : "inactive");
+                    message << ", detail: "
+                            << static_cast<int>(event->detail);
+                    message << ", pointer pos: ";
+                    if (windows_pointer_pos) {
+                        message << windows_pointer_pos->x << ", "
+                                << windows_pointer_pos->y;
+                    } else {
+                        message << "<unknown>";
                     }
-                } break;
-                default: {
-                    logger_.log_editor_trace([&]() {
-                        return "DEBUG: Unhandled X11 event " +
-                               std::to_string(event_type);
-                    });
+                    message
+                        << ", pointer "
+                        << (is_cursor_in_wine_window(windows_pointer_pos)
+                                ? "is"
+                                : "is not")
+                        << " in Wine window)";
+
+                    return message.str();
+                });
+
+                // This extra check for the `NonlinearVirtual` detail is
+                // important (see
+                // https://www.x.org/releases/X11R7.5/doc/x11proto/proto.html
+                // for more information on what this actually means). I've
+                // only seen this issue with the Tokyo Dawn Records plugins,
+                // but a plugin may create a popup window that acts as a
+                // dropdown without actually activating that window (unlike
+                // with an actual Win32 dropdown menu). Without this check
+                // these fake dropdowns would immediately close when
+                // hovering over them.
+                if (event->child == wrapper_window_.window_ &&
+                    supports_ewmh_active_window() &&
+                    is_wine_window_active() &&
+                    !is_cursor_in_wine_window(windows_pointer_pos)) {
+                    set_input_focus(false);
                 }
+            } break;
+            // We need to forward synthetic keyboard events sent by the host
+            // from the wrapper window to the Wine window
+            // NOTE: We're _only_ forwarding synthetic events sent by the
+            //       host. Wine can listen for regular keyboard events on
+            //       its own, so we won't forward those. Bitwig Studio uses
+            //       this approach to still allow you to press Space to
+            //       control the transport.
+            case XCB_KEY_PRESS:
+            case XCB_KEY_RELEASE: {
+                static_assert(std::is_same_v<xcb_key_press_event_t,
+                                             xcb_key_release_event_t>);
+                const auto event = reinterpret_cast<xcb_key_press_event_t*>(
+                    &generic_event);
+                logger_.log_editor_trace([&]() {
+                    return "DEBUG: "s +
+                           (is_synthetic_event ? "synthetic " : "") +
+                           (event_type == XCB_KEY_PRESS ? "KeyPress"
+                                                        : "KeyRelease") +
+                           " for window " + std::to_string(event->event) +
+                           " with key code " +
+                           std::to_string(event->detail);
+                });
+
+                if (is_synthetic_event &&
+                    event->event == wrapper_window_.window_) {
+                    const uint32_t event_mask =
+                        event_type == XCB_KEY_PRESS
+                            ? XCB_EVENT_MASK_KEY_PRESS
+                            : XCB_EVENT_MASK_KEY_RELEASE;
+
+                    // We will reset the `response_type`, because the X11
+                    // server will have already set the first bit for us to
+                    // indicate that it's a synthetic event. Most likely not
+                    // needed, but it feels like the right thing to do. All
+                    // other fields can stay the same. This has to be a copy
+                    // because the same event buffer gets dispatched to every
+                    // editor sharing this connection.
+                    xcb_key_press_event_t forwarded_event = *event;
+                    forwarded_event.response_type = event_type;
+                    forwarded_event.event = wine_window_;
+
+                    xcb_send_event(
+                        x11_connection_.get(), true, wine_window_, event_mask,
+                        reinterpret_cast<const char*>(&forwarded_event));
+                    xcb_flush(x11_connection_.get());
+                }
+            } break;
+            default: {
+                logger_.log_editor_trace([&]() {
+                    return "DEBUG: Unhandled X11 event " +
+                           std::to_string(event_type);
+                });
             }
         }
     } catch (const std::runtime_error& error) {
@@ -778,6 +1014,46 @@ void Editor::handle_x11_events() noexcept {
     }
 }
 
+void Editor::finish_x11_event_batch() noexcept {
+    if (parked_) {
+        return;
+    }
+
+    try {
+        // HACK: See the docstrings on `should_fix_local_coordinates_` and
+        //       `fix_local_coordinates()`. Doing this after the shared
+        //       connection's queue has been drained coalesces configure event
+        //       storms into a single fixup.
+        maybe_fix_local_coordinates();
+    } catch (const std::runtime_error& error) {
+        std::cerr << "Error occurred while handling X11 events, continuing: "
+                  << error.what() << std::endl;
+    }
+}
+
+void Editor::maybe_fix_local_coordinates() {
+    if (!should_fix_local_coordinates_ || is_mouse_button_held()) {
+        return;
+    }
+
+    // Resizes can produce far more configure events than we have any use for.
+    // If the last fixup was too recent we'll simply keep the request spooled.
+    // The idle timer guarantees that `handle_x11_events()` keeps being called,
+    // so the final exact fixup always happens once the storm dies down.
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (now - last_coordinate_fix_ < coordinate_fix_interval_) {
+        return;
+    }
+
+    logger_.log_editor_trace(
+        []() { return "DEBUG: Performing spooled local coordinate fix"; });
+
+    fix_local_coordinates();
+    should_fix_local_coordinates_ = false;
+    last_coordinate_fix_ = now;
+}
+
 HWND Editor::win32_handle() const noexcept {
     return win32_window_.handle_;
 }
@@ -927,6 +1203,15 @@ void Editor::set_input_focus(bool grab) const {
 }
 
 void Editor::run_timer_proc() {
+    // The event loop's tick timer normally drives the idle handling, and
+    // this `WM_TIMER` fallback only has to take over while that loop is
+    // stalled because the GUI thread is stuck in a Win32 modal loop. See the
+    // docstring on `idle_fallback_timer_`.
+    if (std::chrono::steady_clock::now() - last_idle_tick_ <
+        2 * idle_interval_) {
+        return;
+    }
+
     idle_timer_proc_();
 }
 
@@ -1039,19 +1324,18 @@ void Editor::redetect_host_window() noexcept {
     // We need to readjust the event masks for the new host window, keeping the
     // (very probable) possibility in mind that the old host window is the same
     // as the parent window or that the parent window now is the host window.
+    // These go through the shared connection's mask tracking so we don't
+    // clobber the events another editor embedded in the same host toplevel
+    // still needs.
     if (host_window_ != parent_window_) {
-        constexpr uint32_t no_event_mask = XCB_EVENT_MASK_NO_EVENT;
-        xcb_change_window_attributes(x11_connection_.get(), host_window_,
-                                     XCB_CW_EVENT_MASK, &no_event_mask);
+        shared_x11_->set_event_mask(*this, host_window_,
+                                    XCB_EVENT_MASK_NO_EVENT);
     }
 
-    if (new_host_window == parent_window_) {
-        xcb_change_window_attributes(x11_connection_.get(), new_host_window,
-                                     XCB_CW_EVENT_MASK, &parent_event_mask);
-    } else {
-        xcb_change_window_attributes(x11_connection_.get(), new_host_window,
-                                     XCB_CW_EVENT_MASK, &host_event_mask);
-    }
+    shared_x11_->set_event_mask(*this, new_host_window,
+                                new_host_window == parent_window_
+                                    ? parent_event_mask
+                                    : host_event_mask);
 
     host_window_ = new_host_window;
     xcb_flush(x11_connection_.get());
@@ -1183,6 +1467,87 @@ void Editor::do_xembed() const {
     xcb_flush(x11_connection_.get());
 }
 
+Editor& EditorCache::emplace(
+    MainContext& main_context,
+    const Configuration& config,
+    Logger& logger,
+    const size_t parent_window_handle,
+    std::optional<fu2::unique_function<void()>> timer_proc) {
+    main_context_ = &main_context;
+    keepalive_ = std::chrono::milliseconds(config.editor_keepalive_ms);
+
+    // Invalidates any queued expiry handler, see the docstring on the field
+    *park_epoch_ += 1;
+    if (expiry_timer_) {
+        expiry_timer_->cancel();
+    }
+
+    if (editor_ && editor_->is_parked()) {
+        try {
+            editor_->reactivate(parent_window_handle);
+            return *editor_;
+        } catch (const std::runtime_error& error) {
+            std::cerr << "Could not reactivate the parked editor, building a "
+                         "new one instead: "
+                      << error.what() << std::endl;
+            editor_.reset();
+        }
+    }
+
+    return editor_.emplace(main_context, config, logger, parent_window_handle,
+                           std::move(timer_proc));
+}
+
+void EditorCache::reset() noexcept {
+    if (!editor_) {
+        return;
+    }
+
+    if (keepalive_ == keepalive_.zero() || editor_->is_parked()) {
+        editor_.reset();
+        return;
+    }
+
+    try {
+        editor_->park();
+    } catch (const std::runtime_error& error) {
+        // If the windows couldn't be cleanly detached from the host then
+        // reusing them is out of the question
+        std::cerr << "Could not park the editor, destroying it instead: "
+                  << error.what() << std::endl;
+        editor_.reset();
+        return;
+    }
+
+    *park_epoch_ += 1;
+    try {
+        if (!expiry_timer_) {
+            expiry_timer_.emplace(main_context_->context_);
+        }
+
+        expiry_timer_->expires_after(keepalive_);
+        expiry_timer_->async_wait(
+            [this, expected_epoch = *park_epoch_,
+             park_epoch = std::weak_ptr<size_t>(park_epoch_)](
+                const std::error_code& error) {
+                // The epoch check covers a handler that had already expired
+                // and was queued right before the editor got reclaimed, and
+                // the weak pointer covers this object having been destroyed
+                // along with its instance before the handler ran
+                const std::shared_ptr<size_t> current_epoch =
+                    park_epoch.lock();
+                if (error || !current_epoch ||
+                    *current_epoch != expected_epoch) {
+                    return;
+                }
+
+                editor_.reset();
+            });
+    } catch (const std::bad_alloc&) {
+        editor_.reset();
+    }
+}
+
 LRESULT CALLBACK window_proc(HWND handle,
                              UINT message,
                              WPARAM wParam,
@@ -1225,10 +1590,10 @@ LRESULT CALLBACK window_proc(HWND handle,
                 break;
             }
 
-            // We'll send idle messages on a timer for VST2 plugins. This way
-            // the plugin will get keep periodically updating its editor either
-            // when the host sends `effEditIdle` themself, or periodically when
-            // the GUI is being blocked by a dropdown or a message box.
+            // This is the fallback route for the idle handling, which only
+            // kicks in when the GUI is being blocked by a dropdown or a
+            // message box and the event loop's tick timer has thus stopped
+            // running. See the docstring on `Editor::idle_fallback_timer_`.
             editor->run_timer_proc();
             return 0;
         } break;
@@ -1377,6 +1742,91 @@ xcb_atom_t get_atom_by_name(xcb_connection_t& x11_connection,
     return atom_reply->atom;
 }
 
+std::optional<float> detect_screen_refresh_rate(
+    xcb_connection_t& x11_connection) noexcept {
+    const xcb_query_extension_reply_t* extension_reply =
+        xcb_get_extension_data(&x11_connection, &xcb_randr_id);
+    if (!extension_reply || !extension_reply->present) {
+        return std::nullopt;
+    }
+
+    float highest_refresh_rate = 0.0f;
+
+    xcb_screen_iterator_t iter =
+        xcb_setup_roots_iterator(xcb_get_setup(&x11_connection));
+    while (iter.rem > 0) {
+        const xcb_window_t root = iter.data->root;
+        xcb_screen_next(&iter);
+
+        const xcb_randr_get_screen_resources_current_cookie_t
+            resources_cookie = xcb_randr_get_screen_resources_current(
+                &x11_connection, root);
+        const std::unique_ptr<xcb_randr_get_screen_resources_current_reply_t>
+            resources_reply(xcb_randr_get_screen_resources_current_reply(
+                &x11_connection, resources_cookie, nullptr));
+        if (!resources_reply) {
+            continue;
+        }
+
+        const xcb_randr_mode_info_t* modes =
+            xcb_randr_get_screen_resources_current_modes(
+                resources_reply.get());
+        const int num_modes =
+            xcb_randr_get_screen_resources_current_modes_length(
+                resources_reply.get());
+        const xcb_randr_crtc_t* crtcs =
+            xcb_randr_get_screen_resources_current_crtcs(
+                resources_reply.get());
+        const int num_crtcs =
+            xcb_randr_get_screen_resources_current_crtcs_length(
+                resources_reply.get());
+
+        for (int crtc_idx = 0; crtc_idx < num_crtcs; crtc_idx++) {
+            const xcb_randr_get_crtc_info_cookie_t crtc_cookie =
+                xcb_randr_get_crtc_info(&x11_connection, crtcs[crtc_idx],
+                                        resources_reply->config_timestamp);
+            const std::unique_ptr<xcb_randr_get_crtc_info_reply_t> crtc_reply(
+                xcb_randr_get_crtc_info_reply(&x11_connection, crtc_cookie,
+                                              nullptr));
+            if (!crtc_reply || crtc_reply->mode == XCB_NONE) {
+                continue;
+            }
+
+            for (int mode_idx = 0; mode_idx < num_modes; mode_idx++) {
+                const xcb_randr_mode_info_t& mode = modes[mode_idx];
+                if (mode.id != crtc_reply->mode) {
+                    continue;
+                }
+
+                // Doublescan modes scan every line twice, and interlaced
+                // modes only scan half of the lines per vertical refresh
+                float vtotal = mode.vtotal;
+                if (mode.mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN) {
+                    vtotal *= 2.0f;
+                }
+                if (mode.mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE) {
+                    vtotal /= 2.0f;
+                }
+
+                if (mode.htotal > 0 && vtotal > 0.0f) {
+                    highest_refresh_rate = std::max(
+                        highest_refresh_rate,
+                        static_cast<float>(mode.dot_clock) /
+                            (static_cast<float>(mode.htotal) * vtotal));
+                }
+
+                break;
+            }
+        }
+    }
+
+    if (highest_refresh_rate <= 0.0f) {
+        return std::nullopt;
+    }
+
+    return highest_refresh_rate;
+}
+
 Size get_maximum_screen_dimensions(xcb_connection_t& x11_connection) noexcept {
     xcb_screen_iterator_t iter =
         xcb_setup_roots_iterator(xcb_get_setup(&x11_connection));
@@ -16,11 +16,19 @@
 
 #pragma once
 
+#include "use-linux-asio.h"
+
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <windows.h>
+#include <asio/posix/stream_descriptor.hpp>
+#include <asio/steady_timer.hpp>
 #include <function2/function2.hpp>
 
 // Use the native version of xcb
@@ -78,6 +86,17 @@ xcb_atom_t get_atom_by_name(xcb_connection_t& x11_connection,
 bool is_cursor_in_wine_window(
     std::optional<POINT> windows_pointer_pos = std::nullopt) noexcept;
 
+/**
+ * Detect the refresh rate of the fastest connected display through the RandR
+ * extension. The editor could end up on any display, so pacing everything to
+ * the fastest one throttles repaint-happy plugins without ever degrading the
+ * display they're actually on. Used as the default event loop rate when the
+ * `frame_rate` option hasn't been set explicitly. Returns a nullopt when the
+ * extension isn't available or the server doesn't report usable mode timings.
+ */
+std::optional<float> detect_screen_refresh_rate(
+    xcb_connection_t& x11_connection) noexcept;
+
 /**
  * Used to store the maximum width and height of a screen.
  */
@@ -86,6 +105,147 @@ struct Size {
     uint16_t height;
 };
 
+class Editor;
+
+/**
+ * An X11 connection shared by every editor running on the same event loop
+ * thread. Editors used to each open their own connection and re-intern the
+ * same handful of atoms, costing an X server handshake, a couple of intern
+ * round trips, and a file descriptor per open editor. Now all editors within
+ * one `MainContext` share a single connection with a pre-interned atom cache,
+ * so opening another editor in a group host doesn't involve any new X
+ * handshakes.
+ *
+ * Sharing a connection does mean that the events for every editor arrive on
+ * the same queue, so instead of each editor polling its own connection this
+ * object drains the queue and passes every event to all registered editors,
+ * which already filter on their own windows. It also tracks the event masks
+ * the editors request per window: with separate connections the X server kept
+ * a mask per client, but on a shared connection a plain
+ * `xcb_change_window_attributes()` call from one editor would overwrite the
+ * mask another editor set on the same host window, so we apply the union of
+ * all requested masks instead.
+ *
+ * Instances of this class are not thread safe, but they're also never shared
+ * across threads: every event loop thread gets its own instance through
+ * `get()`, and everything here runs on that loop's GUI thread.
+ */
+class SharedX11Connection {
+   public:
+    /**
+     * Get the shared connection for `main_context`'s GUI thread, connecting
+     * to the X server if this is the first editor on that event loop or if
+     * the previous connection broke. The instance stays alive for as long as
+     * at least one editor holds on to it.
+     */
+    static std::shared_ptr<SharedX11Connection> get(MainContext& main_context);
+
+    SharedX11Connection(const SharedX11Connection&) = delete;
+    SharedX11Connection& operator=(const SharedX11Connection&) = delete;
+    SharedX11Connection(SharedX11Connection&&) = delete;
+    SharedX11Connection& operator=(SharedX11Connection&&) = delete;
+
+    /**
+     * The underlying X11 connection. The shared pointer keeps the raw
+     * connection alive independently of this object for the deferred window
+     * cleanup in `DeferredWin32Window`.
+     */
+    const std::shared_ptr<xcb_connection_t>& connection() const noexcept {
+        return connection_;
+    }
+
+    /**
+     * A cached version of `get_atom_by_name()`. Atoms are scoped to the X
+     * server rather than to a connection, so every editor interning the same
+     * names was pure overhead. Nonexistent atoms are not cached since the
+     * atom may be created later on.
+     */
+    xcb_atom_t atom(const char* atom_name);
+
+    /**
+     * Start dispatching events to `editor`. Called at the end of the editor's
+     * constructor, once all of the fields the event handlers touch have been
+     * initialized.
+     */
+    void register_editor(Editor& editor);
+
+    /**
+     * Stop dispatching events to `editor` and drop its event mask
+     * subscriptions, downgrading the affected windows' masks to what the
+     * remaining editors need.
+     */
+    void unregister_editor(Editor& editor) noexcept;
+
+    /**
+     * Replace the event mask `editor` wants for `window` and apply the union
+     * of all editors' requested masks to the window. Passing
+     * `XCB_EVENT_MASK_NO_EVENT` drops the editor's subscription. This does
+     * not flush, just like the `xcb_change_window_attributes()` calls it
+     * replaces.
+     */
+    void set_event_mask(const Editor& editor,
+                        xcb_window_t window,
+                        uint32_t event_mask);
+
+    /**
+     * Drain this connection's event queue, passing every event to all
+     * registered editors. Called both when the connection's file descriptor
+     * becomes readable and from the editors' Win32 idle timers for when the
+     * message loop is being blocked.
+     */
+    void handle_events() noexcept;
+
+   private:
+    explicit SharedX11Connection(MainContext& main_context);
+
+    /**
+     * Start an asynchronous wait for readability on the connection's file
+     * descriptor, handle any events once it becomes readable, and then rearm
+     * the wait again. The wait gets cancelled automatically when `event_fd_`
+     * is destroyed along with this object.
+     */
+    void async_handle_events() noexcept;
+
+    /**
+     * Apply the union of all editors' requested event masks for `window`, or
+     * `XCB_EVENT_MASK_NO_EVENT` when no subscriptions remain.
+     */
+    void apply_event_mask(xcb_window_t window) noexcept;
+
+    std::shared_ptr<xcb_connection_t> connection_;
+
+    /**
+     * A duplicate of `connection_`'s file descriptor, registered with the
+     * main IO context so `async_handle_events()` can wait for incoming X11
+     * events instead of having to poll for them. This needs to be a duplicate
+     * because both this object and `xcb_disconnect()` close the descriptor
+     * they own.
+     */
+    asio::posix::stream_descriptor event_fd_;
+
+    /**
+     * The editors events get dispatched to. Editors are only created and
+     * destroyed through tasks run on the IO context, never from within the
+     * X11 event handlers themselves, so this won't change while
+     * `handle_events()` iterates over it.
+     */
+    std::vector<Editor*> editors_;
+
+    /**
+     * Previously interned atoms, see `atom()`.
+     */
+    std::unordered_map<std::string, xcb_atom_t> atom_cache_;
+
+    /**
+     * The event masks requested through `set_event_mask()`, per window. Most
+     * windows only ever have a single subscription, but editors embedded in
+     * the same host toplevel (which happens in plugin groups) share an entry.
+     */
+    std::unordered_map<xcb_window_t,
+                       std::vector<std::pair<const Editor*, uint32_t>>>
+        event_masks_;
+};
+
 /**
  * A RAII wrapper around windows created using `CreateWindow()` that will post a
  * `WM_CLOSE` message to the window's message loop so it can clean itself up
@@ -194,6 +354,11 @@ class Editor {
         const size_t parent_window_handle,
         std::optional<fu2::unique_function<void()>> timer_proc = std::nullopt);
 
+    /**
+     * Unregisters this editor from the shared X11 connection.
+     */
+    ~Editor() noexcept;
+
     /**
      * Resize the `wrapper_window_` to this new size. We need to manually call
      * this whenever the plugin requests a resize, or when the host resizes the
@@ -209,7 +374,35 @@ class Editor {
     void show() noexcept;
 
     /**
-     * Handle X11 events sent to the window our editor is embedded in.
+     * Hide the editor and detach it from the host's window without destroying
+     * anything, so it can be reembedded later through `reactivate()`. The
+     * wrapper window gets unmapped and reparented back to the root window,
+     * since the host is likely going to destroy `parent_window_` now that the
+     * editor is closed and the wrapper would otherwise be destroyed along
+     * with it. While parked the editor ignores incoming X11 events and the
+     * plugin's timer proc is skipped. Used by `EditorCache` to implement the
+     * `editor_keepalive_ms` option.
+     */
+    void park();
+
+    /**
+     * Reembed a parked editor into a (possibly different) parent window
+     * provided by the host. This performs the same embedding dance as the
+     * constructor, but skips the Win32 window creation since the Wine window
+     * and the wrapper it's embedded in are still alive. The window stays
+     * hidden until the next `show()` call, just like after construction.
+     */
+    void reactivate(size_t parent_window_handle);
+
+    /**
+     * Whether `park()` has detached this editor from the host's windows.
+     */
+    bool is_parked() const noexcept { return parked_; }
+
+    /**
+     * Handle X11 events sent to the window our editor is embedded in. Since
+     * the connection is shared, this drains the entire queue and thus also
+     * handles the events for any other editors on this event loop.
      */
     void handle_x11_events() noexcept;
 
@@ -265,9 +458,11 @@ class Editor {
 
     /**
      * Run the X11 event loop plus the timer proc function passed to the
-     * constructor, if one was passed.
+     * constructor, if one was passed. Called from the `WM_TIMER` handler,
+     * and skipped while the event loop's tick timer is delivering the idle
+     * handling normally.
      *
-     * @see idle_timer_
+     * @see idle_fallback_timer_
      * @see idle_timer_proc_
      */
     void run_timer_proc();
@@ -297,6 +492,24 @@ class Editor {
     const bool use_xembed_;
 
    private:
+    // The shared connection dispatches the drained events to
+    // `handle_x11_event()` and `finish_x11_event_batch()` below
+    friend class SharedX11Connection;
+
+    /**
+     * Handle a single X11 event dispatched by the shared connection. Events
+     * for other editors' windows are ignored, the same way they used to be
+     * ignored when every editor drained its own connection.
+     */
+    void handle_x11_event(xcb_generic_event_t& generic_event) noexcept;
+
+    /**
+     * Called by the shared connection after the event queue has been drained.
+     * Performs the coalesced local coordinate fixup through
+     * `maybe_fix_local_coordinates()`.
+     */
+    void finish_x11_event_batch() noexcept;
+
     /**
      * Get the X11 event mask containing the current keyboard modifiers. Because
      * we don't want to link with `xcb-xkb` and we also can't really use
@@ -323,6 +536,18 @@ class Editor {
      */
     bool is_mouse_button_held() const;
 
+    /**
+     * Perform a `fix_local_coordinates()` call spooled through
+     * `should_fix_local_coordinates_`, if there is one and it's allowed right
+     * now. The fixup is skipped while a mouse button is held (to avoid
+     * flickering while dragging windows around) and when the previous one was
+     * less than `coordinate_fix_interval_` ago. In both cases the flag stays
+     * set, so a later `handle_x11_events()` call - the idle timer guarantees
+     * there will be one - performs the final exact fixup once the storm has
+     * settled.
+     */
+    void maybe_fix_local_coordinates();
+
     /**
      * Returns `true` if the currently active window (as per
      * `_NET_ACTIVE_WINDOW`) contains `wine_window_`. If the window manager does
@@ -368,7 +593,32 @@ class Editor {
     Logger& logger_;
 
     /**
-     * Every editor window gets its own X11 connection.
+     * The application's main IO context running on the GUI thread. Kept
+     * around so `reactivate()` can register the editor with the event loop
+     * again after `park()` dropped `event_loop_guard_`.
+     */
+    MainContext& main_context_;
+
+    /**
+     * Keeps the main event loop ticking at the configured frame rate for as
+     * long as this editor is open. Without any open editors the event loop
+     * drops to a slower idle rate so editorless instances don't keep pumping
+     * empty message queues at full speed. Dropped while the editor is parked
+     * so a cached but invisible editor doesn't keep the loop at full rate.
+     *
+     * @see MainContext::register_editor
+     */
+    std::optional<MainContext::EditorGuard> event_loop_guard_;
+
+    /**
+     * The X11 connection shared between all editors on this event loop
+     * thread, along with its atom cache and event dispatching.
+     */
+    std::shared_ptr<SharedX11Connection> shared_x11_;
+
+    /**
+     * The underlying connection handle of `shared_x11_`, kept around
+     * separately because nearly every call in this class uses it directly.
      */
     std::shared_ptr<xcb_connection_t> x11_connection_;
 
@@ -401,34 +651,64 @@ class Editor {
     DeferredWin32Window win32_window_;
 
     /**
-     * A timer we'll use to periodically run the X11 event loop plus
-     * `idle_timer_proc_`, if that is set. We handle X11 events from within the
-     * Win32 event loop because that allows us to still process those while the
-     * GUI is blocked. Additionally for VST2 plugins we also need this
-     * `idle_timer_proc_`, as they expected the host to periodically send an
-     * idle event. We used to just pass through the calls from the host before
-     * yabridge 3.x, but doing it ourselves here makes things m much more
-     * manageable and we'd still need a timer anyways for when the GUI is
-     * blocked.
+     * The interval between idle timer deliveries, taken from the plugin's
+     * `frame_rate` option. Used both for registering the timers below and for
+     * the staleness check in `run_timer_proc()`.
      */
-    Win32Timer idle_timer_;
+    const std::chrono::steady_clock::duration idle_interval_;
 
     /**
-     * A function to call when the Win32 timer procs. This is used to
-     * periodically call `handle_x11_events()`, as well as `effEditIdle()` for
-     * VST2 plugins even if the GUI is being blocked.
+     * A function to run periodically to handle X11 events, as well as
+     * `effEditIdle()` for VST2 plugins, which expect the host to send an idle
+     * event even while the GUI is being blocked. We used to just pass through
+     * the calls from the host before yabridge 3.x, but doing it ourselves
+     * here makes things m much more manageable and we'd still need a timer
+     * anyways for when the GUI is blocked. With the event-driven handling
+     * through the shared connection's file descriptor the periodic X11 part
+     * now mostly acts as a fallback.
      */
     fu2::unique_function<void()> idle_timer_proc_;
 
+    /**
+     * When `idle_tick_timer_` last delivered `idle_timer_proc_`. Only ever
+     * touched from the GUI thread, by the tick timer's callback and the
+     * `WM_TIMER` staleness check in `run_timer_proc()`.
+     */
+    std::chrono::steady_clock::time_point last_idle_tick_{};
+
+    /**
+     * The fallback Win32 timer for `idle_timer_proc_`. The event loop's tick
+     * timer below normally drives the idle handling, but it stops ticking
+     * while the GUI thread is stuck in a Win32 modal loop, for instance when
+     * a plugin opens a dropdown menu. `WM_TIMER` messages are the only thing
+     * still being delivered in that situation, so this timer keeps the plugin
+     * idling through the modal loop's message pump. `run_timer_proc()` skips
+     * the delivery while the tick timer is running normally.
+     */
+    Win32Timer idle_fallback_timer_;
+
+    /**
+     * The timer that normally runs `idle_timer_proc_`, batch-delivered by the
+     * event loop at the start of a tick. Compared to the `WM_TIMER` route
+     * this doesn't go through the Win32 message queue at all: there's no
+     * queued message per proc and no Win32 timer granularity, just the
+     * phase-aligned tick.
+     *
+     * @see MainContext::register_tick_timer
+     */
+    MainContext::TickTimerGuard idle_tick_timer_;
+
     /**
      * The atom corresponding to `WM_STATE`.
      */
     xcb_atom_t xcb_wm_state_property_;
 
     /**
-     * The window handle of the editor window created by the DAW.
+     * The window handle of the editor window created by the DAW. Replaced
+     * when a parked editor gets reactivated, since most hosts create a fresh
+     * window for every editor open.
      */
-    const xcb_window_t parent_window_;
+    xcb_window_t parent_window_;
     /**
      * A window that sits between `parent_window_` and `wine_window_`. The
      * entire purpose of this is to prevent the host from responding to the
@@ -462,15 +742,41 @@ class Editor {
      */
     xcb_window_t host_window_;
 
+    /**
+     * Whether `park()` has detached this editor from the host's windows. Set
+     * back to `false` by `reactivate()`.
+     */
+    bool parked_ = false;
+
     /**
      * Used to delay calling `fix_local_coordinates()` when dragging windows
      * around with the mouse. Some WMs will continuously send `ConfigureNotify`
      * messages when dragging windows around, and the `fix_local_coordinates()`
      * function may cause the window to blink. This becomes a but jarring if it
      * happens 60 times per second while dragging windows around.
+     *
+     * This is also how configure events get coalesced in general: every
+     * `ConfigureNotify` for our windows only sets this flag, and
+     * `maybe_fix_local_coordinates()` then performs a single fixup per batch
+     * of events, rate limited to `coordinate_fix_interval_`.
      */
     bool should_fix_local_coordinates_ = false;
 
+    /**
+     * The minimum amount of time between two spooled
+     * `fix_local_coordinates()` calls, based on the plugin's `frame_rate`
+     * option. Resize and move storms can produce far more configure events
+     * than that, and doing the reparenting fixup for every single one of them
+     * wastes a lot of CPU on weaker machines.
+     */
+    const std::chrono::steady_clock::duration coordinate_fix_interval_;
+
+    /**
+     * The last time a spooled `fix_local_coordinates()` call was performed
+     * from `maybe_fix_local_coordinates()`.
+     */
+    std::chrono::steady_clock::time_point last_coordinate_fix_{};
+
     /**
      * The atom corresponding to `_NET_ACTIVE_WINDOW`.
      */
@@ -487,3 +793,83 @@ class Editor {
      */
     xcb_atom_t xcb_xembed_message_;
 };
+
+/**
+ * Owns a bridge instance's editor. Without the `editor_keepalive_ms` option
+ * this behaves exactly like the `std::optional<Editor>` the bridges used to
+ * store: `emplace()` builds an editor, and `reset()` destroys it again. With
+ * the option set to a nonzero number of milliseconds, `reset()` instead parks
+ * the editor for that long, keeping the Win32 window tree and the X11 wrapper
+ * window alive but hidden. An `emplace()` within that period reactivates the
+ * parked editor, skipping the window creation and embedding work that
+ * otherwise makes reopening a GUI noticeably slower than it is for native
+ * plugins. The parked editor is destroyed once the period expires without a
+ * reopen.
+ *
+ * Like the editor itself, instances of this class are only ever touched from
+ * the GUI thread.
+ */
+class EditorCache {
+   public:
+    /**
+     * Whether an open (not parked) editor exists. Parked editors are an
+     * implementation detail the bridges shouldn't ever observe.
+     */
+    explicit operator bool() const noexcept {
+        return editor_.has_value() && !editor_->is_parked();
+    }
+
+    Editor* operator->() noexcept { return &*editor_; }
+    const Editor* operator->() const noexcept { return &*editor_; }
+
+    /**
+     * Open an editor, taking the same arguments as `Editor`'s constructor.
+     * Reuses the parked editor when there is one, falling back to building a
+     * fresh editor when the reactivation fails. A reused editor keeps the
+     * timer proc it was originally constructed with, which captures the same
+     * per-instance state the new one would.
+     */
+    Editor& emplace(
+        MainContext& main_context,
+        const Configuration& config,
+        Logger& logger,
+        size_t parent_window_handle,
+        std::optional<fu2::unique_function<void()>> timer_proc = std::nullopt);
+
+    /**
+     * Close the editor. Parks it for `editor_keepalive_ms` milliseconds when
+     * that option is set, and destroys it directly otherwise. Does nothing
+     * when no editor exists.
+     */
+    void reset() noexcept;
+
+   private:
+    std::optional<Editor> editor_;
+
+    /**
+     * The IO context used for the expiry timer below, set on `emplace()`.
+     */
+    MainContext* main_context_ = nullptr;
+
+    /**
+     * How long parked editors stay around, taken from the
+     * `editor_keepalive_ms` option on `emplace()`. Zero disables the parking
+     * entirely.
+     */
+    std::chrono::milliseconds keepalive_{0};
+
+    /**
+     * Destroys the parked editor once the keepalive period expires without a
+     * reopen. Runs on the main IO context like everything else here.
+     */
+    std::optional<asio::steady_timer> expiry_timer_;
+
+    /**
+     * Bumped whenever the editor gets parked or reclaimed. The expiry
+     * timer's completion handler captures a weak pointer to this along with
+     * the current value, so a handler that was already queued when the
+     * editor got reclaimed (or when this object got destroyed along with its
+     * instance) can detect that and back off.
+     */
+    std::shared_ptr<size_t> park_epoch_ = std::make_shared<size_t>(0);
+};
@@ -0,0 +1,242 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "gang-dispatch.h"
+
+#include <climits>
+#include <cstdlib>
+#include <optional>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <ghc/filesystem.hpp>
+#include <llvm/small-vector.h>
+
+#include "../common/process.h"
+#include "../common/utils.h"
+#include "audio-worker-pool.h"
+
+namespace fs = ghc::filesystem;
+
+/**
+ * The same futex wrapper as in `audio-shm.cpp`.
+ */
+static long futex(std::atomic<uint32_t>& word,
+                  int futex_op,
+                  uint32_t value) noexcept {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), futex_op,
+                   value, nullptr, nullptr, 0);
+}
+
+/**
+ * The prefix shared by every process's gang doorbell object. The rest of the
+ * name is the group host's process ID.
+ */
+constexpr char gang_object_prefix[] = "yabridge-gang-";
+
+/**
+ * Remove gang doorbell objects left behind by group host processes that are
+ * no longer running. Group hosts get terminated with `TerminateProcess()`,
+ * so the objects can't reliably be removed on shutdown alone.
+ */
+static void sweep_stale_gang_objects() noexcept {
+    std::error_code err;
+    for (const auto& entry : fs::directory_iterator("/dev/shm", err)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(gang_object_prefix, 0) != 0) {
+            continue;
+        }
+
+        char* endptr = nullptr;
+        const unsigned long pid = strtoul(
+            name.c_str() + sizeof(gang_object_prefix) - 1, &endptr, 10);
+        if (endptr != name.c_str() + name.size() ||
+            pid_running(static_cast<pid_t>(pid))) {
+            continue;
+        }
+
+        shm_unlink(name.c_str());
+    }
+}
+
+GangDispatcher& GangDispatcher::instance() {
+    static GangDispatcher dispatcher{};
+    return dispatcher;
+}
+
+GangDispatcher::~GangDispatcher() noexcept {
+    shutdown_.store(true);
+    if (gang_ring_) {
+        // Wake the listener up so it can exit, and join it before the object
+        // gets torn down underneath it
+        gang_ring_->fetch_add(1, std::memory_order_release);
+        futex(*gang_ring_, FUTEX_WAKE, INT_MAX);
+        {
+            const Win32Thread join_guard = std::move(listener_thread_);
+        }
+
+        munmap(gang_ring_, AudioShmBuffer::gang_reserved_size);
+        close(gang_fd_);
+        shm_unlink(gang_object_name().c_str());
+    }
+}
+
+std::string GangDispatcher::gang_object_name() {
+    return gang_object_prefix + std::to_string(getpid());
+}
+
+bool GangDispatcher::prepare() noexcept {
+    std::call_once(listener_started_, [&]() {
+        sweep_stale_gang_objects();
+
+        const int fd =
+            shm_open(gang_object_name().c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd == -1) {
+            return;
+        }
+        if (ftruncate(fd, AudioShmBuffer::gang_reserved_size) != 0) {
+            close(fd);
+            return;
+        }
+
+        void* mapping =
+            mmap(nullptr, AudioShmBuffer::gang_reserved_size,
+                 PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return;
+        }
+
+        gang_fd_ = fd;
+        gang_ring_ = static_cast<std::atomic<uint32_t>*>(mapping);
+
+        // Gang cycles always run on the pool's workers, regardless of how
+        // many audio threads the process hosts
+        AudioWorkerPool::instance().ensure_workers_started();
+
+        listener_thread_ = Win32Thread([this]() { listener_loop(); });
+        operational_ = true;
+    });
+
+    return operational_;
+}
+
+void GangDispatcher::register_instance(
+    AudioShmBuffer& buffers,
+    void (*run_cycle)(void* context, uint32_t message),
+    void* context) {
+    std::lock_guard lock(instances_mutex_);
+    instances_.push_back(
+        std::make_unique<Instance>(Instance{.dispatcher = this,
+                                            .buffers = &buffers,
+                                            .run_cycle = run_cycle,
+                                            .context = context}));
+}
+
+void GangDispatcher::unregister_instance(void* context) noexcept {
+    std::unique_lock lock(instances_mutex_);
+    for (auto it = instances_.begin(); it != instances_.end(); it++) {
+        if ((*it)->context == context) {
+            // A cycle that's still queued or running on a worker uses the
+            // instance's buffers, so it has to finish first
+            Instance& instance = **it;
+            in_flight_cv_.wait(lock, [&]() { return !instance.in_flight; });
+            instances_.erase(it);
+            return;
+        }
+    }
+}
+
+void GangDispatcher::run_pending_cycle(void* context) {
+    Instance& instance = *static_cast<Instance*>(context);
+    instance.run_cycle(instance.context, instance.pending_message);
+
+    {
+        std::lock_guard lock(instance.dispatcher->instances_mutex_);
+        instance.in_flight = false;
+    }
+    instance.dispatcher->in_flight_cv_.notify_all();
+}
+
+void GangDispatcher::listener_loop() {
+    set_realtime_priority(true);
+    const ThreadRegistry::Guard thread_guard =
+        ThreadRegistry::instance().register_thread("gang-dispatch");
+
+    while (!shutdown_.load(std::memory_order_relaxed)) {
+        const uint32_t last_generation =
+            gang_ring_->load(std::memory_order_acquire);
+
+        // Every instance whose own doorbell was rung since the last scan
+        // gets its cycle queued on the worker pool. The instances always
+        // bump their own ring word before ringing the gang word, so a ring
+        // that comes in during the scan is either picked up right here or
+        // makes the wait below return immediately for the next pass.
+        {
+            std::lock_guard lock(instances_mutex_);
+            llvm::SmallVector<Instance*, 16> submitted{};
+            for (auto& instance : instances_) {
+                if (instance->in_flight) {
+                    continue;
+                }
+
+                const std::optional<uint32_t> message =
+                    instance->buffers->poll_ring();
+                if (!message ||
+                    *message ==
+                        AudioShmBuffer::doorbell_message_terminate) {
+                    continue;
+                }
+
+                instance->pending_message = *message;
+                instance->in_flight = true;
+                AudioWorkerPool::instance().submit_detached(run_pending_cycle,
+                                                            instance.get());
+                submitted.push_back(instance.get());
+            }
+
+            // While the workers chew through the cycles submitted above, the
+            // queued instances' request data still sits in cold shared
+            // memory. Staging it from here overlaps that part of the
+            // per-request setup with the processing that's already running,
+            // so by the time a worker reaches one of these cycles its
+            // metadata and the head of its input buffers are already in
+            // cache. The first cycle is skipped since a worker typically
+            // starts on it immediately. Holding `instances_mutex_` keeps the
+            // buffers alive: `unregister_instance()` can't proceed while
+            // we're in here.
+            for (size_t i = 1; i < submitted.size(); i++) {
+                Instance& pending = *submitted[i];
+                const uint32_t bank =
+                    pending.pending_message ==
+                            AudioShmBuffer::doorbell_message_process_secondary
+                        ? 1
+                        : 0;
+                pending.buffers->prefetch_request_area(bank);
+            }
+        }
+
+        while (!shutdown_.load(std::memory_order_relaxed) &&
+               gang_ring_->load(std::memory_order_acquire) ==
+                   last_generation) {
+            futex(*gang_ring_, FUTEX_WAIT, last_generation);
+        }
+    }
+}
@@ -0,0 +1,172 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../common/audio-shm.h"
+#include "utils.h"
+
+/**
+ * The process wide listener side of the `audio_gang_dispatch` option. DAWs
+ * process their tracks in parallel, so all bridged instances hosted in one
+ * group process tend to receive their processing calls at the same block
+ * boundary. Each of those calls normally rings the instance's own doorbell
+ * and wakes up that instance's dedicated audio thread, so a group of N
+ * plugins eats N scheduler wakeups per block before any audio has been
+ * processed.
+ *
+ * With gang dispatch the native sides instead ring a single doorbell word
+ * shared by the whole group, see `AudioShmBuffer::Config::gang_name`. The
+ * dispatcher's one listener thread wakes up, scans the registered instances'
+ * own generation counters to find everyone who rang, and fans the pending
+ * processing calls out to the `AudioWorkerPool` without blocking on any of
+ * them. Calls that come in while the listener is still scanning get picked up
+ * in the same pass, so a block boundary costs one wakeup instead of one per
+ * instance.
+ */
+class GangDispatcher {
+   public:
+    /**
+     * The dispatcher shared by all plugins hosted in this process.
+     */
+    static GangDispatcher& instance();
+
+    GangDispatcher(const GangDispatcher&) = delete;
+    GangDispatcher& operator=(const GangDispatcher&) = delete;
+
+    GangDispatcher(GangDispatcher&&) = delete;
+    GangDispatcher& operator=(GangDispatcher&&) = delete;
+
+    /**
+     * The name of this process's gang doorbell object. Contains the process
+     * ID so stale objects left behind by crashed group hosts can be
+     * recognized and removed.
+     */
+    static std::string gang_object_name();
+
+    /**
+     * Map the gang doorbell object, start the listener thread and the worker
+     * pool's workers if that hasn't happened yet, and sweep up gang objects
+     * left behind by group host processes that are no longer running.
+     * Returns whether the dispatcher is operational. This has to be called,
+     * and has to have succeeded, before `Config::gang_name` may be set on a
+     * buffer: a native side ringing a gang doorbell nobody listens on would
+     * block forever.
+     */
+    bool prepare() noexcept;
+
+    /**
+     * Register a plugin instance with the dispatcher. After this the
+     * listener invokes `run_cycle` (through the worker pool) with the rung
+     * message whenever the instance's processing doorbell gets rung. At most
+     * one cycle per instance is in flight at a time, which the native side
+     * already guarantees by blocking on the completion word between rings.
+     * `prepare()` must have succeeded beforehand.
+     *
+     * @param buffers The instance's shared memory buffers. The listener
+     *   polls these, so they have to outlive the registration.
+     * @param run_cycle Runs one audio processing cycle, including ringing
+     *   the completion word afterwards. Called on a worker pool thread.
+     * @param context Passed to `run_cycle`, also identifies the
+     *   registration in `unregister_instance()`.
+     */
+    void register_instance(AudioShmBuffer& buffers,
+                           void (*run_cycle)(void* context, uint32_t message),
+                           void* context);
+
+    /**
+     * Remove the instance registered with the given context, blocking until
+     * a cycle that's currently running on a worker has finished. Has to be
+     * called before the instance's buffers get destroyed. Calling this for a
+     * context that was never registered is a no-op.
+     */
+    void unregister_instance(void* context) noexcept;
+
+   private:
+    GangDispatcher() noexcept = default;
+    ~GangDispatcher() noexcept;
+
+    /**
+     * A registered plugin instance. Heap allocated so the pointer handed to
+     * the worker pool stays valid when the vector reallocates.
+     */
+    struct Instance {
+        GangDispatcher* dispatcher;
+        AudioShmBuffer* buffers;
+        void (*run_cycle)(void* context, uint32_t message);
+        void* context;
+
+        /**
+         * The message of the ring that's currently being dispatched. Only
+         * valid while `in_flight` is set.
+         */
+        uint32_t pending_message = 0;
+        /**
+         * Whether a cycle for this instance is currently queued or running
+         * on a worker. Guarded by `instances_mutex_`.
+         */
+        bool in_flight = false;
+    };
+
+    /**
+     * The `AudioWorkerPool` task that runs one instance's pending cycle and
+     * then clears its in flight flag.
+     */
+    static void run_pending_cycle(void* context);
+
+    /**
+     * The listener thread entry point. Blocks on the gang doorbell word,
+     * scans the registered instances after every wakeup, and hands the
+     * pending cycles off to the worker pool.
+     */
+    void listener_loop();
+
+    /**
+     * The file descriptor and mapped generation counter of this process's
+     * gang doorbell object. The object gets unlinked again when this
+     * dispatcher shuts down.
+     */
+    int gang_fd_ = -1;
+    std::atomic<uint32_t>* gang_ring_ = nullptr;
+
+    /**
+     * Guards `instances_` and every instance's `in_flight` flag.
+     */
+    std::mutex instances_mutex_;
+    /**
+     * Notified whenever a cycle finishes, so `unregister_instance()` can
+     * wait out an in flight cycle.
+     */
+    std::condition_variable in_flight_cv_;
+    std::vector<std::unique_ptr<Instance>> instances_;
+
+    Win32Thread listener_thread_;
+    std::once_flag listener_started_;
+    /**
+     * Whether `prepare()` has succeeded. Guarded by `listener_started_`'s
+     * call once.
+     */
+    bool operational_ = false;
+
+    std::atomic_bool shutdown_ = false;
+};
@@ -14,19 +14,26 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <unistd.h>
+
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <thread>
 
 // Generated inside of the build directory
 #include <config.h>
 #include <version.h>
 
+#include "../common/communication/common.h"
+#include "../common/startup-trace.h"
 #include "../common/utils.h"
 #ifdef WITH_CLAP
 #include "bridges/clap.h"
 #endif
 #include "bridges/group.h"
 #include "bridges/vst2.h"
+#include "preload-cache.h"
 #ifdef WITH_VST3
 #include "bridges/vst3.h"
 #endif
@@ -62,9 +69,12 @@ int YABRIDGE_EXPORT
     // directory for the Unix domain socket endpoints to connect to and the
     // process ID of the process the native plugin is being hosted in as
     // arguments for yabridge-host.exe. Group host processes receive only a unix
-    // domain socket it should listen on.
+    // domain socket it should listen on. Warm host processes additionally
+    // receive the process ID of the native host that spawned the pool.
     const bool is_group_host = (argc >= 3 && strcmp(argv[1], "group") == 0);
-    if (!(is_group_host || argc >= 5)) {
+    const bool is_warm_host = (argc >= 4 && strcmp(argv[1], "warm") == 0);
+    const bool is_stats_query = (argc >= 3 && strcmp(argv[1], "stats") == 0);
+    if (!(is_group_host || is_warm_host || is_stats_query || argc >= 5)) {
         std::cerr << host_name << std::endl;
         std::cerr << "Usage: "
 #ifdef __i386__
@@ -81,13 +91,90 @@ int YABRIDGE_EXPORT
 #else
                   << yabridge_host_name
 #endif
-                  << " group <unix_domain_socket>" << std::endl;
+                  << " group <unix_domain_socket> [daemon] [trusted]"
+                  << std::endl;
+        std::cerr << "       "
+#ifdef __i386__
+                  << yabridge_host_name_32bit
+#else
+                  << yabridge_host_name
+#endif
+                  << " warm <unix_domain_socket> <parent_pid>" << std::endl;
+        std::cerr << "       "
+#ifdef __i386__
+                  << yabridge_host_name_32bit
+#else
+                  << yabridge_host_name
+#endif
+                  << " stats <unix_domain_socket>" << std::endl;
 
         return 1;
     }
 
+    // Load statistics queries connect to a running group host process'
+    // socket, print a per-instance breakdown of that process' resource usage,
+    // and then exit again without hosting anything themselves. This helps
+    // figuring out which of the plugins in a busy group is responsible for
+    // the load.
+    if (is_stats_query) {
+        const std::string group_socket_endpoint_path(argv[2]);
+
+        try {
+            asio::io_context io_context;
+            asio::local::stream_protocol::socket socket(io_context);
+            socket.connect(group_socket_endpoint_path);
+
+            // A request with an unknown plugin type is interpreted by the
+            // group host as a statistics query rather than as a request to
+            // host a plugin
+            write_object(socket, HostRequest{.plugin_type = PluginType::unknown,
+                                             .plugin_path = "",
+                                             .endpoint_base_dir = "",
+                                             .parent_pid = getpid(),
+                                             .bitbridge_host_path = ""});
+            const auto response = read_object<GroupStatsResponse>(socket);
+
+            std::cout << "Group host process " << response.pid << " is hosting "
+                      << response.instances.size() << " plugin(s)" << std::endl;
+            std::cout << std::endl;
+            std::cout << std::right << std::setw(4) << "id" << std::setw(15)
+                      << "audio CPU (s)" << std::setw(13) << "GUI CPU (s)"
+                      << std::setw(16) << "avg block (ms)" << std::setw(12)
+                      << "blocks" << std::setw(10) << "events"
+                      << "  plugin" << std::endl;
+            for (const auto& instance : response.instances) {
+                std::cout << std::setw(4) << instance.plugin_id << std::fixed
+                          << std::setprecision(2) << std::setw(15)
+                          << (static_cast<double>(instance.audio_cpu_ns) /
+                              1.0e9)
+                          << std::setw(13)
+                          << (static_cast<double>(instance.gui_cpu_ns) / 1.0e9)
+                          << std::setw(16)
+                          << (static_cast<double>(
+                                  instance.process_call_ewma_ns) /
+                              1.0e6)
+                          << std::setw(12) << instance.process_call_count
+                          << std::setw(10) << instance.event_count << "  "
+                          << instance.plugin_path << std::endl;
+            }
+        } catch (const std::system_error& error) {
+            std::cerr << "Could not query the group host process listening on "
+                         "'"
+                      << group_socket_endpoint_path << "':" << std::endl;
+            std::cerr << error.what() << std::endl;
+
+            return 1;
+        }
+
+        return 0;
+    }
+
     std::cerr << "Initializing " << host_name << std::endl;
 
+    // When startup tracing is enabled this marks how long it took Wine to
+    // boot far enough to run this process
+    startup_trace_event("wine-host-started");
+
     // NOTE: Without this, Wine 9.17+ will try to scale surface bitmaps in the
     //       X11 driver, which results in window client areas being larger than
     //       should be.
@@ -99,14 +186,37 @@ int YABRIDGE_EXPORT
     //       PSPaudioware's InfiniStrip and Shattered Glass Audio Code Red Free.
     OleInitialize(nullptr);
 
-    // The first argument is either a plugin type or 'group', in which case
-    // we'll spawn a plugin group host process. In the past this was a separate
-    // binary, but they have been merged since they share 95% of the same code.
-    if (is_group_host) {
+    // The first argument is either a plugin type, 'group', or 'warm'. For the
+    // latter two we'll spawn a plugin group host process, with 'warm' putting
+    // it in the single plugin warm host mode used by the `warm_hosts` option.
+    // In the past the group host was a separate binary, but they have been
+    // merged since they share 95% of the same code.
+    if (is_group_host || is_warm_host) {
         const std::string group_socket_endpoint_path(argv[2]);
+        const std::optional<pid_t> warm_parent_pid =
+            is_warm_host ? std::optional<pid_t>(std::stoi(argv[3]))
+                         : std::nullopt;
+        // Group hosts take additional attributes after the socket path.
+        // `daemon`, set through the `group_daemon` option, keeps the process
+        // running while idle so it can also be started ahead of time, for
+        // instance from a login script. `trusted`, set through the
+        // `group_trusted` option, disables the process watchdog in favor of
+        // the passive shared memory heartbeat.
+        const auto has_group_attribute = [&](const char* attribute) {
+            for (int i = 3; i < argc; i++) {
+                if (strcmp(argv[i], attribute) == 0) {
+                    return true;
+                }
+            }
+
+            return false;
+        };
+        const bool daemon = is_group_host && has_group_attribute("daemon");
+        const bool trusted = is_group_host && has_group_attribute("trusted");
 
         try {
-            GroupBridge bridge(group_socket_endpoint_path);
+            GroupBridge bridge(group_socket_endpoint_path, warm_parent_pid,
+                               daemon, trusted);
 
             // Blocks the main thread until all plugins have exited
             bridge.handle_incoming_connections();
@@ -144,6 +254,11 @@ int YABRIDGE_EXPORT
         // don't need to differentiate between individually hosted plugins and
         // plugin groups when it comes to event handling.
         MainContext main_context{};
+
+        // Prefetching the dependencies recorded during earlier loads of this
+        // plugin overlaps the loader's disk reads with the socket setup below
+        ModulePreloader module_preloader(plugin_location);
+
         std::unique_ptr<HostBridge> bridge;
         try {
             switch (plugin_type) {
@@ -200,7 +315,8 @@ int YABRIDGE_EXPORT
         // potentially unsafe events that should always be run from the UI
         // thread will be posted to `main_context`.
         Win32Thread worker_thread([&]() {
-            pthread_setname_np(pthread_self(), "worker");
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("worker");
 
             bridge->run();
 
@@ -220,11 +336,25 @@ int YABRIDGE_EXPORT
 
         std::cerr << "Finished initializing '" << plugin_location << "'"
                   << std::endl;
+        startup_trace_event("wine-host-plugin-initialized");
+
+        // Now that the plugin has been loaded, its dependencies can be
+        // recorded so the next load of this plugin can prefetch them
+        module_preloader.record_loaded_modules();
 
         // Handle Win32 messages and X11 events on a timer, just like in
         // `GroupBridge::async_handle_events()``
         main_context.async_handle_events(
-            [&]() { bridge->handle_events(); },
+            [&, message_budget = HostBridge::default_message_budget]() mutable {
+                if (bridge->handle_events(message_budget)) {
+                    // Pending dispatcher calls get to run in between the
+                    // message batches
+                    return true;
+                }
+
+                message_budget = HostBridge::default_message_budget;
+                return false;
+            },
             [&]() { return !bridge->inhibits_event_loop(); });
         main_context.run();
     }
@@ -0,0 +1,88 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "io-advisor.h"
+
+#include <cstdlib>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The minimum file size before a handle is considered to belong to a streamed
+ * sample file. This skips the various small configuration and preset files
+ * plugins keep open, whose access patterns readahead doesn't matter for.
+ */
+constexpr off_t streaming_file_size_threshold = 1 << 20;
+
+StreamingIoAdvisor::ScanResult
+StreamingIoAdvisor::advise_open_files() noexcept {
+    ScanResult result{};
+
+    DIR* fd_dir = opendir("/proc/self/fd");
+    if (!fd_dir) {
+        return result;
+    }
+
+    while (dirent* entry = readdir(fd_dir)) {
+        const int fd = atoi(entry->d_name);
+        // Skip the stdio streams, the non-numeric dot entries that `atoi()`
+        // parses to zero, and the descriptor backing this directory walk
+        if (fd <= 2 || fd == dirfd(fd_dir)) {
+            continue;
+        }
+
+        struct stat file_info;
+        if (fstat(fd, &file_info) != 0 || !S_ISREG(file_info.st_mode)) {
+            continue;
+        }
+
+        // A file descriptor number can be recycled for another file between
+        // scans, in which case the new file needs its own advise call
+        const FileKey key{.device = file_info.st_dev,
+                          .inode = file_info.st_ino};
+        if (const auto it = advised_handles_.find(fd);
+            it != advised_handles_.end() && it->second == key) {
+            continue;
+        }
+
+        // Only large read-only files look like streamed sample content. The
+        // read-only requirement also keeps us away from yabridge's own shared
+        // memory buffers and any files the plugin is writing to.
+        const int flags = fcntl(fd, F_GETFL);
+        if (file_info.st_size < streaming_file_size_threshold || flags == -1 ||
+            (flags & O_ACCMODE) != O_RDONLY) {
+            continue;
+        }
+
+        // This is the actual tuning. Everything above just decides which
+        // handles get it, and failures don't matter since this is purely an
+        // optimization.
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        advised_handles_[fd] = key;
+        result.new_handles += 1;
+        if (advised_files_.insert(key).second) {
+            result.new_files += 1;
+        }
+    }
+
+    closedir(fd_dir);
+
+    return result;
+}
@@ -0,0 +1,109 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sys/types.h>
+
+/**
+ * Tunes the kernel's readahead for the sample files streamed by the plugins
+ * hosted in a group process. Wine file handles are backed by regular Unix
+ * file descriptors in this same process, so the large read-only files a
+ * sampler keeps open for disk streaming are all visible in `/proc/self/fd`.
+ * Linux's default readahead heuristics have to rediscover the access pattern
+ * for every handle, so this periodically walks the process's open files and
+ * marks every qualifying handle with `posix_fadvise(POSIX_FADV_SEQUENTIAL)`,
+ * which doubles the kernel's readahead window for it. Disk streaming reads
+ * each voice's sample data in order, so the larger window turns the stream
+ * into fewer, bigger disk requests during dense playback.
+ *
+ * The advisor also keeps a group level map of the unique files seen across
+ * all hosted instances, keyed by device and inode. Duplicate instances of the
+ * same sampler open the same content through their own handles; since they
+ * all live in this one process the page cache already serves those reads from
+ * a single physical copy, and the map lets the group host report how many
+ * distinct files actually back the group's streaming instead of advising and
+ * counting the same library once per instance.
+ *
+ * Everything here is purely advisory: a file descriptor that disappears
+ * between the scan and the advise call, or an `posix_fadvise()` that fails,
+ * is silently ignored.
+ */
+class StreamingIoAdvisor {
+   public:
+    /**
+     * The totals for a single scan, used by the group host to log when new
+     * streaming files show up.
+     */
+    struct ScanResult {
+        /**
+         * The number of file handles that were newly advised this scan.
+         */
+        size_t new_handles = 0;
+        /**
+         * The number of distinct files, keyed by device and inode, that had
+         * not been seen through any handle before this scan.
+         */
+        size_t new_files = 0;
+    };
+
+    /**
+     * Walk `/proc/self/fd` and advise sequential readahead on every handle
+     * that looks like a streamed sample file: a regular file of at least a
+     * megabyte that's open read-only. Handles that were already advised are
+     * skipped, with the device and inode rechecked so a recycled file
+     * descriptor number gets advised again for its new file. This must always
+     * be called from the same thread, which in practice is the group host's
+     * main IO context.
+     */
+    ScanResult advise_open_files() noexcept;
+
+   private:
+    /**
+     * Identifies a file independently of the handles opened to it, so
+     * duplicate instances streaming the same library map to a single entry.
+     */
+    struct FileKey {
+        dev_t device;
+        ino_t inode;
+
+        bool operator==(const FileKey&) const = default;
+    };
+
+    struct FileKeyHash {
+        size_t operator()(const FileKey& key) const noexcept {
+            return std::hash<dev_t>{}(key.device) ^
+                   (std::hash<ino_t>{}(key.inode) << 1);
+        }
+    };
+
+    /**
+     * The file behind every file descriptor that has already been advised, so
+     * rescans only touch new handles and recycled descriptor numbers.
+     */
+    std::unordered_map<int, FileKey> advised_handles_;
+
+    /**
+     * Every distinct file seen through any qualifying handle. This is the
+     * group level view: its size is the number of unique files backing the
+     * group's streaming, regardless of how many instances have them open.
+     */
+    std::unordered_set<FileKey, FileKeyHash> advised_files_;
+};
@@ -0,0 +1,90 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "notification-dedup.h"
+
+#include <utility>
+
+NotificationDeduplicator::NotificationDeduplicator(
+    MainContext& main_context,
+    std::chrono::steady_clock::duration window)
+    : main_context_(main_context),
+      window_(window),
+      flush_timer_(main_context.context_) {}
+
+bool NotificationDeduplicator::should_forward(
+    uint64_t key,
+    fu2::unique_function<void()> forward) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(mutex_);
+
+    // When a flush is already waiting on this notification we'll just
+    // replace the stored callback, so only the burst's most recent
+    // notification survives
+    if (const auto it = pending_.find(key); it != pending_.end()) {
+        it->second = std::move(forward);
+        return false;
+    }
+
+    // The first notification after a quiet period passes through as is so
+    // one-off notifications keep their timing. Only ones that repeat the
+    // last forwarded notification within the window get held back.
+    if (const auto it = last_forwarded_.find(key);
+        it != last_forwarded_.end() && now - it->second < window_) {
+        pending_[key] = std::move(forward);
+        if (!flush_scheduled_) {
+            flush_scheduled_ = true;
+            // Timers should only ever be touched from the thread running
+            // `main_context_`, like the plugin idle timers
+            main_context_.schedule_task([this]() { schedule_flush(); });
+        }
+        return false;
+    }
+
+    last_forwarded_[key] = now;
+    return true;
+}
+
+void NotificationDeduplicator::schedule_flush() {
+    flush_timer_.expires_after(window_);
+    flush_timer_.async_wait([this](const std::error_code& error) {
+        if (error) {
+            return;
+        }
+
+        flush_pending();
+    });
+}
+
+void NotificationDeduplicator::flush_pending() {
+    std::map<uint64_t, fu2::unique_function<void()>> pending{};
+    {
+        std::lock_guard lock(mutex_);
+        pending.swap(pending_);
+        flush_scheduled_ = false;
+
+        // Refreshing the forwarded timestamps here means an ongoing storm
+        // keeps getting collapsed into one callback per window
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& [key, forward] : pending) {
+            last_forwarded_[key] = now;
+        }
+    }
+
+    for (auto& [key, forward] : pending) {
+        forward();
+    }
+}
@@ -0,0 +1,120 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "use-linux-asio.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include <asio/steady_timer.hpp>
+#include <function2/function2.hpp>
+
+#include "utils.h"
+
+/**
+ * Collapses identical host change notifications fired in rapid succession
+ * into a single forwarded callback, used to implement the
+ * `notification_dedup_ms` option. Some plugins call
+ * `audioMasterIOChanged()`/`IComponentHandler::restartComponent()` style
+ * notifications dozens of times in a row while loading a preset, and every
+ * one of them costs a bridged round trip plus an expensive re-query or graph
+ * rebuild on the host's side.
+ *
+ * This works just like the `automate_coalesce` handling in `Vst2Bridge`: the
+ * first notification of a burst is forwarded immediately, identical
+ * notifications that follow within the window are absorbed, and when any
+ * were absorbed a single trailing notification per key is forwarded from the
+ * main thread once the window closes. That trailing notification means the
+ * host's final re-query always observes the plugin's settled state, so
+ * nothing is lost even when the repeated notifications weren't actually
+ * redundant. A notification whose key differs from the last forwarded one is
+ * never held back.
+ */
+class NotificationDeduplicator {
+   public:
+    /**
+     * @param main_context The main context whose thread runs the trailing
+     *   flushes. The timer is only ever touched from that thread.
+     * @param window The deduplication window, from the
+     *   `notification_dedup_ms` option.
+     */
+    NotificationDeduplicator(MainContext& main_context,
+                             std::chrono::steady_clock::duration window);
+
+    NotificationDeduplicator(const NotificationDeduplicator&) = delete;
+    NotificationDeduplicator& operator=(const NotificationDeduplicator&) =
+        delete;
+
+    /**
+     * Returns whether the caller should forward the notification identified
+     * by `key` right now. When this returns false the notification was
+     * absorbed, and `forward` will be invoked once from the main context's
+     * thread when the window closes. An absorbed notification replaces a
+     * previously stored callback for the same key, so only the burst's last
+     * notification survives.
+     *
+     * @param key Identifies the notification, e.g. the callback opcode or
+     *   the restart flags. Callers multiplexing several callback types
+     *   through one deduplicator should mix a type tag into the key.
+     * @param forward Re-sends the notification. Runs on the main context's
+     *   thread, which is where these callbacks normally originate anyway.
+     */
+    bool should_forward(uint64_t key, fu2::unique_function<void()> forward);
+
+   private:
+    /**
+     * (Re)arm `flush_timer_` so the pending notifications get forwarded one
+     * window from now. Like the other bridge timers this only ever runs on
+     * the thread running `main_context_`.
+     */
+    void schedule_flush();
+
+    /**
+     * Forward all notifications held back in `pending_` and refresh their
+     * forwarded timestamps, so an ongoing storm keeps getting collapsed into
+     * one callback per window. Called from `flush_timer_`.
+     */
+    void flush_pending();
+
+    MainContext& main_context_;
+    const std::chrono::steady_clock::duration window_;
+
+    /**
+     * The timer used to run `flush_pending()` one window after the first
+     * absorbed notification. Only armed while `pending_` is non-empty.
+     */
+    asio::steady_timer flush_timer_;
+
+    /**
+     * The notifications absorbed during the current window, waiting for
+     * `flush_timer_` to forward them, together with the time each key was
+     * last forwarded to the host. Both guarded by `mutex_` since the
+     * callbacks can fire from any plugin thread.
+     */
+    std::map<uint64_t, fu2::unique_function<void()>> pending_;
+    std::map<uint64_t, std::chrono::steady_clock::time_point> last_forwarded_;
+    /**
+     * Whether a task to arm `flush_timer_` has already been scheduled for
+     * the notifications in `pending_`, so a burst of absorbed callbacks only
+     * arms the timer once. Guarded by `mutex_`.
+     */
+    bool flush_scheduled_ = false;
+    std::mutex mutex_;
+};
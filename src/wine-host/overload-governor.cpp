@@ -0,0 +1,182 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "overload-governor.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace std::literals::chrono_literals;
+
+/**
+ * The length of one observation window. Long enough to smooth over the
+ * occasional page fault or scheduler hiccup, short enough that an actual
+ * overload gets acted on before the dropouts pile up.
+ */
+constexpr std::chrono::steady_clock::duration overload_window = 500ms;
+
+/**
+ * A window counts as overloaded when more than one in this many of its
+ * blocks overran their budget. A single overrun per window is normal even
+ * in a healthy session, sustained overruns are not.
+ */
+constexpr uint32_t overload_fraction = 4;
+
+/**
+ * A window counts as clean when at most one in this many of its blocks
+ * overran its budget. Windows that are neither overloaded nor clean keep
+ * the governor in its current state.
+ */
+constexpr uint32_t clean_fraction = 16;
+
+/**
+ * The number of consecutive clean windows needed before a degraded instance
+ * gets restored. Restoring an instance adds its DSP cost back, so restoring
+ * too eagerly would just oscillate between the two states.
+ */
+constexpr uint32_t restore_after_clean_windows = 4;
+
+}  // namespace
+
+OverloadGovernor& OverloadGovernor::instance() {
+    static OverloadGovernor instance{};
+    return instance;
+}
+
+OverloadGovernor::Instance* OverloadGovernor::register_instance(
+    uint32_t priority) {
+    // The atomic member makes `Instance` non-movable, so it can't be brace
+    // initialized through `make_unique()`
+    auto instance = std::make_unique<Instance>();
+    instance->priority = priority;
+
+    std::lock_guard lock(instances_mutex_);
+
+    return instances_.emplace_back(std::move(instance)).get();
+}
+
+void OverloadGovernor::unregister_instance(Instance* instance) noexcept {
+    if (!instance) {
+        return;
+    }
+
+    std::lock_guard lock(instances_mutex_);
+    instances_.erase(
+        std::remove_if(instances_.begin(), instances_.end(),
+                       [instance](const std::unique_ptr<Instance>& candidate) {
+                           return candidate.get() == instance;
+                       }),
+        instances_.end());
+}
+
+void OverloadGovernor::record_block(
+    std::chrono::steady_clock::duration spent,
+    std::chrono::steady_clock::duration budget) noexcept {
+    window_blocks_.fetch_add(1, std::memory_order_relaxed);
+    if (spent > budget) {
+        window_overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const std::chrono::steady_clock::rep now =
+        std::chrono::steady_clock::now().time_since_epoch().count();
+    std::chrono::steady_clock::rep window_start =
+        window_start_.load(std::memory_order_relaxed);
+    if (window_start == 0) {
+        // The very first recorded block just starts the first window. The
+        // exchange can lose against another audio thread, which then simply
+        // started the window instead of us.
+        window_start_.compare_exchange_strong(window_start, now,
+                                              std::memory_order_relaxed);
+        return;
+    }
+    if (std::chrono::steady_clock::duration(now - window_start) <
+        overload_window) {
+        return;
+    }
+
+    // The window is over, so one audio thread rolls it over and acts on it.
+    // Everyone else just carries on, including when another thread is
+    // already evaluating: this runs on real time audio threads, so blocking
+    // here is never an option.
+    std::unique_lock lock(evaluate_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    window_start = window_start_.load(std::memory_order_relaxed);
+    if (window_start == 0 ||
+        std::chrono::steady_clock::duration(now - window_start) <
+            overload_window) {
+        // Someone else already rolled the window over between our check
+        // above and acquiring the lock
+        return;
+    }
+
+    const uint32_t blocks =
+        window_blocks_.exchange(0, std::memory_order_relaxed);
+    const uint32_t overruns =
+        window_overruns_.exchange(0, std::memory_order_relaxed);
+    window_start_.store(now, std::memory_order_relaxed);
+
+    if (overruns * overload_fraction > blocks) {
+        clean_windows_ = 0;
+        degrade_one();
+    } else if (overruns * clean_fraction <= blocks) {
+        clean_windows_ += 1;
+        if (clean_windows_ >= restore_after_clean_windows) {
+            // The counter resets after every restore, so a stack of
+            // degraded instances gets restored one at a time with full
+            // hysteresis in between
+            clean_windows_ = 0;
+            restore_one();
+        }
+    } else {
+        clean_windows_ = 0;
+    }
+}
+
+void OverloadGovernor::degrade_one() noexcept {
+    std::lock_guard lock(instances_mutex_);
+
+    Instance* lowest = nullptr;
+    for (const std::unique_ptr<Instance>& candidate : instances_) {
+        if (!candidate->degraded.load(std::memory_order_relaxed) &&
+            (!lowest || candidate->priority < lowest->priority)) {
+            lowest = candidate.get();
+        }
+    }
+
+    if (lowest) {
+        lowest->degraded.store(true, std::memory_order_relaxed);
+    }
+}
+
+void OverloadGovernor::restore_one() noexcept {
+    std::lock_guard lock(instances_mutex_);
+
+    Instance* highest = nullptr;
+    for (const std::unique_ptr<Instance>& candidate : instances_) {
+        if (candidate->degraded.load(std::memory_order_relaxed) &&
+            (!highest || candidate->priority > highest->priority)) {
+            highest = candidate.get();
+        }
+    }
+
+    if (highest) {
+        highest->degraded.store(false, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,154 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * The process wide listener side of the `overload_priority` option. When a
+ * session overloads the CPU every bridged instance misses its deadlines
+ * equally, so the whole mix glitches at once even though the user would
+ * usually rather sacrifice a background layer than the master bus. Instances
+ * hosted in this process that set `overload_priority` register themselves
+ * here, and every fully processed block reports its wall clock processing
+ * time against the block's real time budget. When a sustained share of
+ * blocks overruns that budget, the governor switches the registered instance
+ * with the lowest priority into economy mode: its blocks get bypassed
+ * (inputs copied straight to the outputs) instead of processed, which frees
+ * up that instance's entire DSP cost. The governor keeps degrading instances
+ * from the bottom up every window while the overload persists, and restores
+ * them from the top down with some hysteresis once the remaining instances
+ * have been making their deadlines again for a while. Instances that don't
+ * set the option never take part and are never degraded.
+ */
+class OverloadGovernor {
+   public:
+    /**
+     * A registered plugin instance. Owned by the governor, so the pointer
+     * handed out by `register_instance()` stays valid until the matching
+     * `unregister_instance()` call.
+     */
+    struct Instance {
+        /**
+         * The instance's user assigned priority. Lower priorities get
+         * degraded first and restored last.
+         */
+        uint32_t priority = 0;
+
+        /**
+         * Whether the governor has switched this instance into economy
+         * mode. Read from the instance's audio thread every block.
+         */
+        std::atomic_bool degraded = false;
+    };
+
+    /**
+     * The governor shared by all plugins hosted in this process.
+     */
+    static OverloadGovernor& instance();
+
+    OverloadGovernor(const OverloadGovernor&) = delete;
+    OverloadGovernor& operator=(const OverloadGovernor&) = delete;
+
+    OverloadGovernor(OverloadGovernor&&) = delete;
+    OverloadGovernor& operator=(OverloadGovernor&&) = delete;
+
+    /**
+     * Register a plugin instance with the governor. The returned instance
+     * stays valid until `unregister_instance()` gets called for it.
+     */
+    Instance* register_instance(uint32_t priority);
+
+    /**
+     * Remove a previously registered instance. Calling this with a null
+     * pointer is a no-op.
+     */
+    void unregister_instance(Instance* instance) noexcept;
+
+    /**
+     * Whether the governor has switched this instance into economy mode.
+     * The instance's audio thread checks this before every block, bypassing
+     * the block instead of processing it when it returns true.
+     */
+    bool economy_mode(const Instance* instance) const noexcept {
+        return instance->degraded.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Record the wall clock processing time of one fully processed block
+     * against that block's real time budget. Called from the audio threads,
+     * so this never blocks: the counters are relaxed atomics, and the
+     * window evaluation this occasionally triggers backs off when another
+     * thread is already running it. Bypassed economy blocks are not
+     * recorded since they say nothing about the session's actual load.
+     */
+    void record_block(std::chrono::steady_clock::duration spent,
+                      std::chrono::steady_clock::duration budget) noexcept;
+
+   private:
+    OverloadGovernor() noexcept = default;
+    ~OverloadGovernor() noexcept = default;
+
+    /**
+     * Switch the registered non-degraded instance with the lowest priority
+     * into economy mode, if there is one.
+     */
+    void degrade_one() noexcept;
+
+    /**
+     * Restore the degraded instance with the highest priority back to full
+     * processing, if there is one.
+     */
+    void restore_one() noexcept;
+
+    /**
+     * Guards `instances_`.
+     */
+    std::mutex instances_mutex_;
+    std::vector<std::unique_ptr<Instance>> instances_;
+
+    /**
+     * The number of blocks recorded in the current observation window, and
+     * how many of those overran their real time budget.
+     */
+    std::atomic<uint32_t> window_blocks_ = 0;
+    std::atomic<uint32_t> window_overruns_ = 0;
+
+    /**
+     * The `steady_clock` tick count of when the current observation window
+     * started. Zero until the first recorded block.
+     */
+    std::atomic<std::chrono::steady_clock::rep> window_start_ = 0;
+
+    /**
+     * Serializes the window rollover so only one audio thread evaluates it.
+     * Only ever acquired with `try_lock`, see `record_block()`.
+     */
+    std::mutex evaluate_mutex_;
+
+    /**
+     * The number of consecutive windows without meaningful overruns,
+     * providing the hysteresis before a degraded instance gets restored.
+     * Guarded by `evaluate_mutex_`.
+     */
+    uint32_t clean_windows_ = 0;
+};
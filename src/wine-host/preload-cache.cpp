@@ -0,0 +1,385 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "preload-cache.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include <tlhelp32.h>
+
+#include "../common/utils.h"
+
+namespace fs = ghc::filesystem;
+
+using namespace std::literals::string_view_literals;
+
+/**
+ * The chunk size used when reading the recorded files, matching the reads in
+ * `prefetch_plugin_library()`.
+ */
+constexpr size_t prefetch_chunk_size = 1 << 20;
+
+/**
+ * The path a manifest with the given file name stem, hash key, and suffix is
+ * stored at. This mirrors the plugin-side `get_metadata_cache_path()`, so the
+ * manifests end up in `$XDG_CACHE_HOME/yabridge/metadata/` next to the other
+ * metadata cache entries. The manifests are plain text files with one path
+ * per line rather than binary cache entries, since only this Wine-side code
+ * ever looks at them. Returns a nullopt if the cache directory could not be
+ * determined, or if the cache has been disabled through the
+ * `YABRIDGE_NO_CACHE` environment variable.
+ */
+static std::optional<fs::path> manifest_path_for(const std::string& stem,
+                                                 const std::string& key,
+                                                 const char* suffix) {
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    if (const char* no_cache_env = getenv("YABRIDGE_NO_CACHE");
+        no_cache_env && no_cache_env == "1"sv) {
+        return std::nullopt;
+    }
+
+    fs::path cache_dir;
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    if (const char* xdg_cache_home = getenv("XDG_CACHE_HOME");
+        xdg_cache_home && xdg_cache_home[0] != '\0') {
+        cache_dir = xdg_cache_home;
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    } else if (const char* home = getenv("HOME"); home && home[0] != '\0') {
+        cache_dir = fs::path(home) / ".cache";
+    } else {
+        return std::nullopt;
+    }
+
+    std::ostringstream file_name;
+    file_name << stem << "-" << std::to_string(std::hash<std::string>{}(key))
+              << suffix;
+
+    return cache_dir / "yabridge" / "metadata" / file_name.str();
+}
+
+/**
+ * The path this plugin's preload manifest is stored at. The hash makes sure
+ * that equally named plugin files in different directories don't share a
+ * manifest.
+ */
+static std::optional<fs::path> preload_manifest_path(
+    const fs::path& plugin_path) {
+    return manifest_path_for(plugin_path.stem().string(), plugin_path.string(),
+                             "-preload-deps.txt");
+}
+
+/**
+ * The path a group's session manifest is stored at. The socket filename
+ * already contains the group name, the Wine prefix ID, and the architecture,
+ * so two groups with the same name in different prefixes don't share a
+ * manifest.
+ */
+static std::optional<fs::path> session_manifest_path(
+    const fs::path& group_socket_path) {
+    return manifest_path_for(
+        group_socket_path.filename().replace_extension().string(),
+        group_socket_path.string(), "-session-plugins.txt");
+}
+
+/**
+ * The paths of all modules currently loaded into this process. Any failure
+ * here just results in fewer or no modules being recorded.
+ */
+static std::unordered_set<std::string> enumerate_loaded_modules() noexcept {
+    std::unordered_set<std::string> modules{};
+
+    const HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) {
+        return modules;
+    }
+
+    MODULEENTRY32 entry{};
+    entry.dwSize = sizeof(entry);
+    if (Module32First(snapshot, &entry)) {
+        do {
+            modules.insert(entry.szExePath);
+        } while (Module32Next(snapshot, &entry));
+    }
+
+    CloseHandle(snapshot);
+    return modules;
+}
+
+/**
+ * Whether the given module path lies within the given directory. The
+ * comparison is case insensitive since these are Windows paths.
+ */
+static bool is_in_directory(const std::string& path,
+                            const std::string& directory) noexcept {
+    if (directory.empty() || path.size() <= directory.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < directory.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(path[i])) !=
+            std::tolower(static_cast<unsigned char>(directory[i]))) {
+            return false;
+        }
+    }
+
+    const char separator = path[directory.size()];
+    return separator == '\\' || separator == '/';
+}
+
+/**
+ * Read the file at the given Windows path to pull it into the kernel's page
+ * cache, just like `prefetch_plugin_library()` does for the plugin's own
+ * binaries. Since the recorded module paths are Windows paths, the file is
+ * read through the Win32 API instead of through a native file stream.
+ */
+static void prefetch_file(const std::string& path,
+                          std::vector<char>& read_buffer) noexcept {
+    const HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    DWORD bytes_read = 0;
+    while (ReadFile(file, read_buffer.data(),
+                    static_cast<DWORD>(read_buffer.size()), &bytes_read,
+                    nullptr) &&
+           bytes_read > 0) {
+    }
+
+    CloseHandle(file);
+}
+
+/**
+ * Prefetch every file recorded in the manifest at the given path, one
+ * Windows module path per line. This reads a plugin's own dependency
+ * manifest in `ModulePreloader`, and the manifests of the previously hosted
+ * plugins in `SessionPrefetcher`.
+ */
+static void prefetch_recorded_modules(const fs::path& manifest_path) {
+    std::ifstream manifest(manifest_path.string());
+    std::vector<char> read_buffer(prefetch_chunk_size);
+    std::string module_path;
+    while (std::getline(manifest, module_path)) {
+        if (!module_path.empty()) {
+            prefetch_file(module_path, read_buffer);
+        }
+    }
+}
+
+/**
+ * Union merge the given new entries into the manifest at the given path,
+ * creating the manifest if it doesn't exist yet. Entries that are absent
+ * this time around are kept, so recorded files don't flip flop in and out of
+ * the manifest between runs. The manifest is left untouched when nothing
+ * changed, and the write-then-rename makes updates atomic so two processes
+ * updating the same manifest at the same time can't leave a torn file
+ * behind.
+ */
+static void merge_into_manifest(
+    const fs::path& manifest_path,
+    const std::unordered_set<std::string>& new_entries) {
+    std::vector<std::string> entries{};
+    std::unordered_set<std::string> recorded_entries{};
+    {
+        std::ifstream manifest(manifest_path.string());
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && recorded_entries.insert(line).second) {
+                entries.push_back(line);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (const std::string& entry : new_entries) {
+        if (recorded_entries.insert(entry).second) {
+            entries.push_back(entry);
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    std::error_code err;
+    fs::create_directories(manifest_path.parent_path(), err);
+
+    const fs::path temporary_path(manifest_path.string() + "." +
+                                  std::to_string(getpid()) + ".tmp");
+    {
+        std::ofstream manifest(temporary_path.string(),
+                               std::ios::out | std::ios::trunc);
+        for (const std::string& entry : entries) {
+            manifest << entry << '\n';
+        }
+        if (!manifest) {
+            return;
+        }
+    }
+    fs::rename(temporary_path, manifest_path, err);
+}
+
+void prefetch_plugin_library(const fs::path& plugin_path) noexcept {
+    try {
+        std::vector<char> read_buffer(prefetch_chunk_size);
+        const auto read_file = [&read_buffer](const fs::path& path) {
+            std::ifstream file(path.string(), std::ifstream::binary);
+            while (file.read(read_buffer.data(),
+                             static_cast<std::streamsize>(read_buffer.size()))) {
+            }
+        };
+
+        if (fs::is_directory(plugin_path)) {
+            // VST3 bundles are directories containing the module and
+            // potentially some resource files
+            for (const auto& entry :
+                 fs::recursive_directory_iterator(plugin_path)) {
+                if (entry.is_regular_file()) {
+                    read_file(entry.path());
+                }
+            }
+        } else {
+            read_file(plugin_path);
+        }
+    } catch (...) {
+        // This is purely an optimization, and actually loading the plugin
+        // will produce much better diagnostics than anything we could print
+        // here
+    }
+}
+
+ModulePreloader::ModulePreloader(const fs::path& plugin_path)
+    : manifest_path_(preload_manifest_path(plugin_path)),
+      baseline_modules_(enumerate_loaded_modules()) {
+    if (!manifest_path_) {
+        return;
+    }
+
+    // The files recorded during earlier loads of this plugin get read into
+    // the page cache while the sockets are being set up and the plugin's own
+    // binaries are being prefetched, so by the time Wine's loader gets to
+    // resolving the dependencies their contents are already cached
+    prefetch_thread_ = Win32Thread([manifest_path = *manifest_path_]() {
+        const ThreadRegistry::Guard thread_guard =
+            ThreadRegistry::instance().register_thread("preload");
+
+        prefetch_recorded_modules(manifest_path);
+    });
+}
+
+void ModulePreloader::record_loaded_modules() noexcept {
+    if (!manifest_path_) {
+        return;
+    }
+
+    try {
+        // Wine's builtin and system libraries live in the Windows directory
+        // and get loaded into every process anyway, so there's no point in
+        // recording those
+        std::string windows_directory{};
+        char windows_directory_buffer[MAX_PATH];
+        const UINT windows_directory_length = GetWindowsDirectoryA(
+            windows_directory_buffer, sizeof(windows_directory_buffer));
+        if (windows_directory_length > 0 &&
+            windows_directory_length < sizeof(windows_directory_buffer)) {
+            windows_directory.assign(windows_directory_buffer,
+                                     windows_directory_length);
+        }
+
+        std::unordered_set<std::string> new_modules{};
+        for (const std::string& path : enumerate_loaded_modules()) {
+            if (baseline_modules_.count(path) == 0 &&
+                !is_in_directory(path, windows_directory)) {
+                new_modules.insert(path);
+            }
+        }
+        if (new_modules.empty()) {
+            return;
+        }
+
+        // The union merge makes sure dependencies that only get loaded under
+        // specific conditions (like an instruction set specific DSP library)
+        // don't flip flop in and out of the manifest between loads
+        merge_into_manifest(*manifest_path_, new_modules);
+    } catch (...) {
+        // Just like the other prefetching, none of this is worth failing a
+        // plugin load over
+    }
+}
+
+SessionPrefetcher::SessionPrefetcher(const fs::path& group_socket_path)
+    : manifest_path_(session_manifest_path(group_socket_path)) {}
+
+void SessionPrefetcher::plugin_requested(const fs::path& plugin_path) noexcept {
+    if (!manifest_path_) {
+        return;
+    }
+
+    try {
+        const std::string plugin_path_string = plugin_path.string();
+
+        std::lock_guard lock(mutex_);
+        if (!requested_plugins_.insert(plugin_path_string).second) {
+            return;
+        }
+
+        // The plugins recorded during earlier sessions get read into the
+        // page cache while the first requested plugin initializes and
+        // restores its state, so by the time the host's track list walk
+        // reaches the follow-up instances their binaries are already cached
+        if (!prefetch_started_) {
+            prefetch_started_ = true;
+            prefetch_thread_ = Win32Thread(
+                [manifest_path = *manifest_path_,
+                 requested_plugin = plugin_path_string]() {
+                    const ThreadRegistry::Guard thread_guard =
+                        ThreadRegistry::instance().register_thread(
+                            "session-preload");
+
+                    std::ifstream manifest(manifest_path.string());
+                    std::string recorded_plugin;
+                    while (std::getline(manifest, recorded_plugin)) {
+                        // The requested plugin's own worker thread is
+                        // already prefetching it
+                        if (recorded_plugin.empty() ||
+                            recorded_plugin == requested_plugin) {
+                            continue;
+                        }
+
+                        prefetch_plugin_library(recorded_plugin);
+                        if (const std::optional<fs::path> dependency_manifest =
+                                preload_manifest_path(recorded_plugin)) {
+                            prefetch_recorded_modules(*dependency_manifest);
+                        }
+                    }
+                });
+        }
+
+        merge_into_manifest(*manifest_path_, {plugin_path_string});
+    } catch (...) {
+        // Like the rest of the prefetching, this is purely an optimization
+    }
+}
@@ -0,0 +1,195 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+#include <ghc/filesystem.hpp>
+
+#include "utils.h"
+
+/**
+ * Read the plugin's binaries to pull them into the kernel's page cache before
+ * the plugin gets initialized on the main thread. Reading the files is by far
+ * the most expensive part of loading a plugin from a cold cache, and unlike
+ * the initialization itself it doesn't need to be done from the main thread,
+ * so doing this on the plugins' worker threads lets a session bring up all
+ * plugins in a group mostly in parallel. VST3 plugins can be bundles, in
+ * which case every file in the bundle gets read. Any errors are ignored since
+ * this is purely an optimization, and actually loading the plugin will
+ * produce much better diagnostics.
+ */
+void prefetch_plugin_library(const ghc::filesystem::path& plugin_path) noexcept;
+
+/**
+ * Records and replays the set of library files a plugin drags in when it gets
+ * loaded. Wine's loader resolves a plugin's DLL dependencies one after the
+ * other, so on a cold cache most of the time spent in `LoadLibrary()` goes
+ * into reading those files from disk. The plugin's own binaries already get
+ * prefetched before the load (see `prefetch_plugin_library()`), but big
+ * plugins often ship a pile of support DLLs that only become known once the
+ * loader has resolved them.
+ *
+ * To also hide that cost, this takes a snapshot of the modules loaded into
+ * this process before the plugin gets initialized, diffs it against the
+ * modules present afterwards, and stores the new module paths in a manifest
+ * next to the plugin-side metadata cache entries in
+ * `$XDG_CACHE_HOME/yabridge/metadata/`. On the next load of the plugin a
+ * background thread reads the recorded files back while the sockets are still
+ * being set up, so the loader's reads overlap with the handshake and hit the
+ * page cache instead of the disk. Like the other prefetching this is purely
+ * an optimization: every failure is silently ignored, and a stale manifest at
+ * worst reads a couple of files that are no longer needed.
+ */
+class ModulePreloader {
+   public:
+    /**
+     * Takes the baseline module snapshot and starts prefetching the
+     * dependencies recorded during earlier loads of this plugin on a
+     * background thread. This should thus be created right before the plugin
+     * gets loaded.
+     *
+     * @param plugin_path The path to the plugin `.dll` file or bundle, used
+     *   to locate the plugin's manifest.
+     */
+    explicit ModulePreloader(const ghc::filesystem::path& plugin_path);
+
+    ModulePreloader(const ModulePreloader&) = delete;
+    ModulePreloader& operator=(const ModulePreloader&) = delete;
+
+    ModulePreloader(ModulePreloader&&) = delete;
+    ModulePreloader& operator=(ModulePreloader&&) = delete;
+
+    /**
+     * Diff the modules now loaded into this process against the baseline
+     * snapshot and merge the new ones into the plugin's manifest. This should
+     * be called once after the plugin has finished initializing. Modules from
+     * the Windows directory are skipped, since Wine's builtin and system
+     * libraries get loaded into every process anyway. In a group host the
+     * diff may also pick up modules from another plugin that was loading at
+     * the same time, which at worst attributes a few extra files to this
+     * plugin's manifest.
+     */
+    void record_loaded_modules() noexcept;
+
+   private:
+    /**
+     * The manifest file for this plugin, or a nullopt when the cache
+     * directory could not be determined or the cache has been disabled. In
+     * that case both the prefetching and the recording become no-ops.
+     */
+    std::optional<ghc::filesystem::path> manifest_path_;
+
+    /**
+     * The paths of the modules that were already loaded into this process
+     * before the plugin got initialized, so `record_loaded_modules()` only
+     * records the modules the plugin's load pulled in.
+     */
+    std::unordered_set<std::string> baseline_modules_;
+
+    /**
+     * The thread reading the previously recorded dependencies into the page
+     * cache. It's joined on destruction, but it normally finishes long before
+     * the plugin is done initializing.
+     */
+    Win32Thread prefetch_thread_;
+};
+
+/**
+ * Records which plugins a group process hosts and prefetches all of them at
+ * once on the next run. A host loading a project walks its track list
+ * serially: it instantiates a plugin, restores its state, and only then asks
+ * for the next one, so without help the loader's disk reads for instance N+1
+ * can't start before instance N is done. Since reopening a project loads the
+ * same plugins into the same group, the first hosting request kicks off a
+ * background read of the binaries and the recorded module dependencies (see
+ * `ModulePreloader`) of every plugin this group hosted during earlier
+ * sessions. By the time the host requests the follow-up instances their
+ * files are then already in the page cache, and the loads are bounded by the
+ * plugins' own initialization instead of by disk reads.
+ *
+ * The manifest lives next to the `ModulePreloader` manifests in
+ * `$XDG_CACHE_HOME/yabridge/metadata/`, keyed by the group socket name. Like
+ * the other prefetching every failure is silently ignored, and a stale
+ * manifest at worst reads the binaries of some plugins that are no longer
+ * part of the project.
+ */
+class SessionPrefetcher {
+   public:
+    /**
+     * Set up the prefetcher for a group host process. This only locates the
+     * manifest, the actual prefetching starts with the first call to
+     * `plugin_requested()`.
+     *
+     * @param group_socket_path The path to the group socket this process
+     *   listens on. The socket's filename already encodes the group name,
+     *   the Wine prefix, and the architecture, so it doubles as the manifest
+     *   key.
+     */
+    explicit SessionPrefetcher(const ghc::filesystem::path& group_socket_path);
+
+    SessionPrefetcher(const SessionPrefetcher&) = delete;
+    SessionPrefetcher& operator=(const SessionPrefetcher&) = delete;
+
+    SessionPrefetcher(SessionPrefetcher&&) = delete;
+    SessionPrefetcher& operator=(SessionPrefetcher&&) = delete;
+
+    /**
+     * Record that this process got asked to host the given plugin, merging
+     * the plugin's path into the manifest. The first call also starts
+     * prefetching the other plugins recorded during earlier sessions on a
+     * background thread. Only the first one: by the second request the host
+     * is already walking its track list, and the remaining recorded plugins
+     * are either being read by that background thread or about to be
+     * requested themselves. This may be called from multiple worker threads
+     * at once.
+     */
+    void plugin_requested(const ghc::filesystem::path& plugin_path) noexcept;
+
+   private:
+    /**
+     * The manifest file for this group, or a nullopt when the cache
+     * directory could not be determined or the cache has been disabled. In
+     * that case `plugin_requested()` becomes a no-op.
+     */
+    std::optional<ghc::filesystem::path> manifest_path_;
+
+    /**
+     * Guards the two fields below against concurrent hosting requests.
+     */
+    std::mutex mutex_;
+
+    /**
+     * Whether the background prefetch has been kicked off yet.
+     */
+    bool prefetch_started_ = false;
+
+    /**
+     * The plugins requested during this run, so repeated instances of the
+     * same plugin don't reread the manifest over and over.
+     */
+    std::unordered_set<std::string> requested_plugins_;
+
+    /**
+     * The thread reading the previously recorded plugins into the page
+     * cache, joined on destruction.
+     */
+    Win32Thread prefetch_thread_;
+};
@@ -0,0 +1,203 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "state-snapshots.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+
+#include <unistd.h>
+
+#include "../common/process.h"
+#include "../common/utils.h"
+
+namespace fs = ghc::filesystem;
+
+/**
+ * The extension used for the snapshot files in the spool directory.
+ */
+constexpr char snapshot_extension[] = ".snapshot";
+
+/**
+ * Snapshots from dead processes older than this are deleted instead of being
+ * offered for adoption. Crash recovery happens when the session gets reloaded
+ * right after the crash, so anything this stale is more likely to confuse
+ * than to help.
+ */
+constexpr std::chrono::hours snapshot_max_age(1);
+
+/**
+ * The ordinal appended to this process's snapshot file names. Instances of
+ * the same plugin thus get increasing ordinals in their load order, which is
+ * what lets a reloaded session map every new instance back to the old
+ * instance's snapshot.
+ */
+static std::atomic_size_t next_snapshot_ordinal = 0;
+
+/**
+ * Parse the `<pid>` and `<ordinal>` fields from a snapshot file name of the
+ * form `<plugin_name>-<pid>-<ordinal>`, after checking that the name actually
+ * belongs to the given plugin. The fields are taken from the end of the
+ * string since plugin file names can contain dashes themselves.
+ */
+static std::optional<std::pair<pid_t, size_t>> parse_snapshot_stem(
+    const std::string& stem,
+    const std::string& plugin_name) noexcept {
+    const size_t ordinal_pos = stem.find_last_of('-');
+    if (ordinal_pos == std::string::npos || ordinal_pos == 0) {
+        return std::nullopt;
+    }
+    const size_t pid_pos = stem.find_last_of('-', ordinal_pos - 1);
+    if (pid_pos == std::string::npos ||
+        stem.substr(0, pid_pos) != plugin_name) {
+        return std::nullopt;
+    }
+
+    char* endptr = nullptr;
+    const unsigned long pid =
+        strtoul(stem.c_str() + pid_pos + 1, &endptr, 10);
+    if (endptr != stem.c_str() + ordinal_pos) {
+        return std::nullopt;
+    }
+    const unsigned long ordinal =
+        strtoul(stem.c_str() + ordinal_pos + 1, &endptr, 10);
+    if (endptr != stem.c_str() + stem.size()) {
+        return std::nullopt;
+    }
+
+    return std::pair(static_cast<pid_t>(pid), static_cast<size_t>(ordinal));
+}
+
+/**
+ * The directory the snapshot files are spooled to. This lives under the same
+ * user-private temporary directory as yabridge's socket endpoints.
+ */
+static fs::path spool_directory() {
+    return get_temporary_directory() / "yabridge-state-snapshots";
+}
+
+StateSnapshotSpool::StateSnapshotSpool(const fs::path& plugin_path)
+    : plugin_name_(plugin_path.filename().string()) {
+    std::error_code err;
+    fs::create_directories(spool_directory(), err);
+
+    snapshot_path_ =
+        spool_directory() /
+        (plugin_name_ + "-" + std::to_string(getpid()) + "-" +
+         std::to_string(next_snapshot_ordinal.fetch_add(1)) +
+         snapshot_extension);
+}
+
+StateSnapshotSpool::~StateSnapshotSpool() noexcept {
+    // A snapshot that's still around after a clean shutdown would be restored
+    // on the next load as if the process had crashed
+    std::error_code err;
+    fs::remove(snapshot_path_, err);
+}
+
+std::optional<std::vector<uint8_t>>
+StateSnapshotSpool::adopt_orphaned_snapshot() noexcept {
+    // Find all snapshots for this plugin left behind by processes that are no
+    // longer running. Snapshots too old to be part of a crash recovery are
+    // removed on the spot so the spool doesn't accumulate garbage.
+    std::vector<std::tuple<pid_t, size_t, fs::path>> candidates;
+    std::error_code err;
+    for (const auto& entry : fs::directory_iterator(spool_directory(), err)) {
+        const fs::path& path = entry.path();
+        if (path.extension() != snapshot_extension) {
+            continue;
+        }
+
+        const auto parsed =
+            parse_snapshot_stem(path.stem().string(), plugin_name_);
+        if (!parsed || parsed->first == getpid() ||
+            pid_running(parsed->first)) {
+            continue;
+        }
+
+        const fs::file_time_type mtime = fs::last_write_time(path, err);
+        if (err || fs::file_time_type::clock::now() - mtime >
+                       snapshot_max_age) {
+            fs::remove(path, err);
+            continue;
+        }
+
+        candidates.emplace_back(parsed->first, parsed->second, path);
+    }
+    if (candidates.empty()) {
+        return std::nullopt;
+    }
+
+    // Adopting the dead process's snapshots in their original load order is
+    // what maps instance n of a reloaded session back to instance n's old
+    // state. The rename into our own slot is atomic, so when two instances
+    // load at the same time only one of them can win any given snapshot.
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto& [pid, ordinal, path] : candidates) {
+        fs::rename(path, snapshot_path_, err);
+        if (err) {
+            continue;
+        }
+
+        std::ifstream file(snapshot_path_.string(),
+                           std::ios::in | std::ios::binary);
+        std::vector<uint8_t> state((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+        if (!file || state.empty()) {
+            continue;
+        }
+
+        return state;
+    }
+
+    return std::nullopt;
+}
+
+void StateSnapshotSpool::write(const uint8_t* data, size_t size) noexcept {
+    // Idle instances will produce the exact same chunk every interval, so
+    // we'll skip the write when nothing has changed. FNV-1a is plenty here
+    // since a collision just means one skipped snapshot.
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+    if (size == last_snapshot_size_ && hash == last_snapshot_hash_) {
+        return;
+    }
+
+    // The write-then-rename makes replacing the snapshot atomic, so a crash
+    // in the middle of a write can never leave a truncated snapshot behind
+    const fs::path temporary_path(snapshot_path_.string() + ".tmp");
+    {
+        std::ofstream file(temporary_path.string(),
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data),
+                   static_cast<std::streamsize>(size));
+        if (!file) {
+            return;
+        }
+    }
+
+    std::error_code err;
+    fs::rename(temporary_path, snapshot_path_, err);
+    if (!err) {
+        last_snapshot_hash_ = hash;
+        last_snapshot_size_ = size;
+    }
+}
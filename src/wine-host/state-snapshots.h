@@ -0,0 +1,105 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <ghc/filesystem.hpp>
+
+/**
+ * A per-instance slot in the state snapshot spool directory, used by the
+ * `snapshot_interval` option's crash recovery. Each plugin instance with that
+ * option enabled periodically writes its most recent state chunk to its slot,
+ * and the slot is removed again when the instance shuts down cleanly. When a
+ * plugin takes down a group host process, every plugin in the group dies with
+ * it and their slots stay behind in the spool. The next time those plugins
+ * get loaded, each new instance adopts one of the snapshots left behind by
+ * the dead process and restores it, so reloading the group doesn't lose the
+ * tweaks made since the last session save.
+ *
+ * Snapshots are matched on the plugin's file name, and the snapshots of a
+ * dead process are adopted in the same order their instances were originally
+ * loaded in. Since hosts reload the plugins of a session in a deterministic
+ * order, instance `n` of a plugin normally gets instance `n`'s old state
+ * back. The files live under the same user-private temporary directory as
+ * yabridge's socket endpoints.
+ */
+class StateSnapshotSpool {
+   public:
+    /**
+     * Claim a snapshot slot for a new plugin instance. This creates the spool
+     * directory if it doesn't exist yet and prunes snapshots from dead
+     * processes that are too old to still be useful for crash recovery.
+     *
+     * @param plugin_path The path to the plugin `.dll` file. Only the file
+     *   name is used to match snapshots between processes.
+     */
+    StateSnapshotSpool(const ghc::filesystem::path& plugin_path);
+
+    /**
+     * Removes this instance's snapshot file. Reaching this destructor means
+     * the instance is shutting down cleanly, so there's nothing left to
+     * recover.
+     */
+    ~StateSnapshotSpool() noexcept;
+
+    StateSnapshotSpool(const StateSnapshotSpool&) = delete;
+    StateSnapshotSpool& operator=(const StateSnapshotSpool&) = delete;
+
+    StateSnapshotSpool(StateSnapshotSpool&&) = delete;
+    StateSnapshotSpool& operator=(StateSnapshotSpool&&) = delete;
+
+    /**
+     * Take over the oldest not yet adopted snapshot left behind for this
+     * plugin by a process that is no longer running, returning its contents.
+     * The snapshot file is atomically renamed into this instance's slot
+     * before it's read, so two instances loading at the same time can never
+     * adopt the same snapshot. Returns a nullopt when there's nothing to
+     * recover, which is the case on every normal, non-crash-recovery load.
+     */
+    std::optional<std::vector<uint8_t>> adopt_orphaned_snapshot() noexcept;
+
+    /**
+     * Atomically replace this instance's snapshot with the given state chunk.
+     * The write is skipped when the chunk hasn't changed since the last
+     * snapshot, so idle instances don't rewrite the same data to disk every
+     * interval. Failures are ignored since a missed snapshot only matters if
+     * the process also happens to crash afterwards.
+     */
+    void write(const uint8_t* data, size_t size) noexcept;
+
+   private:
+    /**
+     * The plugin's file name, used to recognize this plugin's snapshots in
+     * the spool directory.
+     */
+    std::string plugin_name_;
+
+    /**
+     * The file this instance writes its snapshots to, inside of the spool
+     * directory. The file doesn't exist until the first call to `write()`.
+     */
+    ghc::filesystem::path snapshot_path_;
+
+    /**
+     * A hash and size of the last written snapshot so `write()` can skip
+     * writing identical state over and over again for idle instances.
+     */
+    uint64_t last_snapshot_hash_ = 0;
+    size_t last_snapshot_size_ = 0;
+};
@@ -16,12 +16,43 @@
 
 #include "utils.h"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
 
 #include "bridges/common.h"
 
 using namespace std::literals::chrono_literals;
 
+size_t count_physical_cores() noexcept {
+    size_t num_cores = 0;
+    for (size_t cpu = 0;; cpu++) {
+        std::ifstream siblings_file("/sys/devices/system/cpu/cpu" +
+                                    std::to_string(cpu) +
+                                    "/topology/thread_siblings_list");
+        if (!siblings_file.is_open()) {
+            break;
+        }
+
+        // The list is formatted like `0,16` or `0-1`, and the first element
+        // is always the lowest numbered sibling
+        size_t first_sibling;
+        if (siblings_file >> first_sibling && first_sibling == cpu) {
+            num_cores++;
+        }
+    }
+
+    if (num_cores == 0) {
+        // Sysfs may not be available, in which case the logical CPU count is
+        // still a better size than no workers at all
+        num_cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    return num_cores;
+}
+
 uint32_t WINAPI
 win32_thread_trampoline(fu2::unique_function<void()>* entry_point) {
     (*entry_point)();
@@ -78,11 +109,123 @@ Win32Timer& Win32Timer::operator=(Win32Timer&& o) noexcept {
     return *this;
 }
 
-MainContext::MainContext()
-    : context_(),
-      events_timer_(context_),
-      watchdog_context_(),
-      watchdog_timer_(watchdog_context_) {}
+Watchdog& Watchdog::instance() {
+    static Watchdog watchdog{};
+    return watchdog;
+}
+
+Watchdog::Watchdog() noexcept {}
+
+Watchdog::~Watchdog() noexcept {
+    {
+        std::lock_guard lock(wake_mutex_);
+        shutdown_ = true;
+    }
+    wake_cv_.notify_all();
+
+    // The `Win32Thread` destructor will join the monitor thread
+}
+
+Watchdog::Guard::Guard() noexcept : is_active_(false) {}
+
+Watchdog::Guard::Guard(HostBridge& bridge,
+                       std::unordered_set<HostBridge*>& watched_bridges,
+                       std::mutex& watched_bridges_mutex)
+    : bridge_(&bridge),
+      watched_bridges_(&watched_bridges),
+      watched_bridges_mutex_(&watched_bridges_mutex) {
+    std::lock_guard lock(watched_bridges_mutex);
+    watched_bridges.insert(&bridge);
+}
+
+Watchdog::Guard::~Guard() noexcept {
+    if (is_active_) {
+        std::lock_guard lock(*watched_bridges_mutex_);
+        watched_bridges_->erase(bridge_);
+    }
+}
+
+Watchdog::Guard::Guard(Guard&& o) noexcept
+    : is_active_(o.is_active_),
+      bridge_(o.bridge_),
+      watched_bridges_(o.watched_bridges_),
+      watched_bridges_mutex_(o.watched_bridges_mutex_) {
+    o.is_active_ = false;
+}
+
+Watchdog::Guard& Watchdog::Guard::operator=(Guard&& o) noexcept {
+    is_active_ = o.is_active_;
+    bridge_ = o.bridge_;
+    watched_bridges_ = o.watched_bridges_;
+    watched_bridges_mutex_ = o.watched_bridges_mutex_;
+    o.is_active_ = false;
+
+    return *this;
+}
+
+Watchdog::Guard Watchdog::register_watchdog(HostBridge& bridge) {
+    // Trusted group processes don't participate in the watchdog at all; the
+    // passive shared memory heartbeat is their only liveness signal
+    if (trusted_) {
+        return Guard();
+    }
+
+    ensure_monitor_started();
+
+    // The guard's constructor and destructor will handle actually registering
+    // and unregistering the bridge from `watched_bridges`
+    return Guard(bridge, watched_bridges_, watched_bridges_mutex_);
+}
+
+void Watchdog::disable_for_trusted_group() noexcept {
+    trusted_ = true;
+}
+
+void Watchdog::ensure_monitor_started() {
+    std::call_once(monitor_started_, [&]() {
+        // NOTE: We allow disabling the watchdog timer to allow the Wine
+        //       process to be run from a separate namespace. This is not
+        //       something you'd normally want to enable.
+        if (is_watchdog_timer_disabled()) {
+            std::cerr << "WARNING: Watchdog timer disabled. Not protecting"
+                      << std::endl;
+            std::cerr << "         against dangling processes." << std::endl;
+            return;
+        }
+
+        monitor_thread_ = Win32Thread([&]() {
+            const ThreadRegistry::Guard thread_guard =
+                ThreadRegistry::instance().register_thread("watchdog");
+
+            monitor_loop();
+        });
+    });
+}
+
+void Watchdog::monitor_loop() {
+    // To account for hosts terminating before the bridged plugin has
+    // initialized, we'll do the first watchdog check after five seconds. After
+    // this we'll run the checks on a 30 second interval.
+    std::chrono::steady_clock::duration interval = 5s;
+
+    std::unique_lock lock(wake_mutex_);
+    while (!wake_cv_.wait_for(lock, interval, [&]() { return shutdown_; })) {
+        // When the `Guard` field on `HostBridge` gets destroyed, that bridge
+        // instance will be removed from `watched_bridges`. So if our call to
+        // `HostBridge::shutdown_if_dangling()` shuts the plugin down, the
+        // instance will be removed shortly afterwards.
+        {
+            std::lock_guard bridges_lock(watched_bridges_mutex_);
+            for (auto& bridge : watched_bridges_) {
+                bridge->shutdown_if_dangling();
+            }
+        }
+
+        interval = 30s;
+    }
+}
+
+MainContext::MainContext() : context_(), events_timer_(context_) {}
 
 void MainContext::run() {
     // We need to know which thread is the GUI thread because mutual recursion
@@ -91,102 +234,228 @@ void MainContext::run() {
     // or a GUI thread
     gui_thread_id_ = GetCurrentThreadId();
 
-    // NOTE: We allow disabling the watchdog timer to allow the Wine process to
-    //       be run from a separate namespace. This is not something you'd
-    //       normally want to enable.
-    if (is_watchdog_timer_disabled()) {
-        std::cerr << "WARNING: Watchdog timer disabled. Not protecting"
-                  << std::endl;
-        std::cerr << "         against dangling processes." << std::endl;
-    } else {
-        // To account for hosts terminating before the bridged plugin has
-        // initialized, we'll do the first watchdog check five seconds. After
-        // this we'll run the timer on a 30 second interval.
-        async_handle_watchdog_timer(5s);
-
-        watchdog_handler_ = Win32Thread([&]() {
-            pthread_setname_np(pthread_self(), "watchdog");
-
-            watchdog_context_.run();
-        });
-    }
-
     context_.run();
-
-    // We only need to check if the host is still running while the main context
-    // is also running. If a stop was requested, the entire application is
-    // supposed to shut down. Otherwise `watchdog_handler` would just block on
-    // the join as the watchdog timer is still active.
-    watchdog_context_.stop();
 }
 
 void MainContext::stop() noexcept {
     context_.stop();
 }
 
+std::chrono::steady_clock::time_point MainContext::align_timer_phase(
+    std::chrono::steady_clock::time_point deadline,
+    std::chrono::steady_clock::duration interval) noexcept {
+    using std::chrono::steady_clock;
+
+    const steady_clock::duration::rep interval_ticks = interval.count();
+    if (interval_ticks <= 0) {
+        return deadline;
+    }
+
+    const steady_clock::duration::rep deadline_ticks =
+        deadline.time_since_epoch().count();
+    const steady_clock::duration::rep aligned_ticks =
+        ((deadline_ticks + interval_ticks - 1) / interval_ticks) *
+        interval_ticks;
+
+    return steady_clock::time_point(steady_clock::duration(aligned_ticks));
+}
+
 void MainContext::update_timer_interval(
     std::chrono::steady_clock::duration new_interval) noexcept {
     timer_interval_ = new_interval;
 }
 
-MainContext::WatchdogGuard::WatchdogGuard(
-    HostBridge& bridge,
-    std::unordered_set<HostBridge*>& watched_bridges,
-    std::mutex& watched_bridges_mutex)
-    : bridge_(&bridge),
-      watched_bridges_(watched_bridges),
-      watched_bridges_mutex_(watched_bridges_mutex) {
-    std::lock_guard lock(watched_bridges_mutex);
-    watched_bridges.insert(&bridge);
+MainContext::EditorGuard::EditorGuard(
+    std::atomic_size_t& active_editors) noexcept
+    : active_editors_(active_editors) {
+    active_editors.fetch_add(1, std::memory_order_relaxed);
 }
 
-MainContext::WatchdogGuard::~WatchdogGuard() noexcept {
+MainContext::EditorGuard::~EditorGuard() noexcept {
     if (is_active_) {
-        std::lock_guard lock(watched_bridges_mutex_.get());
-        watched_bridges_.get().erase(bridge_);
+        active_editors_.get().fetch_sub(1, std::memory_order_relaxed);
     }
 }
 
-MainContext::WatchdogGuard::WatchdogGuard(WatchdogGuard&& o) noexcept
-    : bridge_(std::move(o.bridge_)),
-      watched_bridges_(std::move(o.watched_bridges_)),
-      watched_bridges_mutex_(std::move(o.watched_bridges_mutex_)) {
+MainContext::EditorGuard::EditorGuard(EditorGuard&& o) noexcept
+    : active_editors_(std::move(o.active_editors_)) {
     o.is_active_ = false;
 }
 
-MainContext::WatchdogGuard& MainContext::WatchdogGuard::operator=(
-    WatchdogGuard&& o) noexcept {
-    bridge_ = std::move(o.bridge_);
-    watched_bridges_ = std::move(o.watched_bridges_);
-    watched_bridges_mutex_ = std::move(o.watched_bridges_mutex_);
+MainContext::EditorGuard& MainContext::EditorGuard::operator=(
+    EditorGuard&& o) noexcept {
+    active_editors_ = std::move(o.active_editors_);
     o.is_active_ = false;
 
     return *this;
 }
 
-MainContext::WatchdogGuard MainContext::register_watchdog(HostBridge& bridge) {
-    // The guard's constructor and destructor will handle actually registering
-    // and unregistering the bridge from `watched_bridges`
-    return WatchdogGuard(bridge, watched_bridges_, watched_bridges_mutex_);
+MainContext::EditorGuard MainContext::register_editor() noexcept {
+    // The guard's constructor and destructor take care of incrementing and
+    // decrementing the counter again
+    return EditorGuard(active_editors_);
 }
 
-void MainContext::async_handle_watchdog_timer(
-    std::chrono::steady_clock::duration interval) {
-    watchdog_timer_.expires_at(std::chrono::steady_clock::now() + interval);
-    watchdog_timer_.async_wait([&](const std::error_code& error) {
-        if (error) {
-            return;
+MainContext::HeartbeatGuard::HeartbeatGuard(
+    MainContext& context,
+    std::atomic<uint32_t>& word) noexcept
+    : context_(&context), word_(&word) {
+    std::lock_guard lock(context_->heartbeat_words_mutex_);
+    context_->heartbeat_words_.push_back(word_);
+}
+
+MainContext::HeartbeatGuard::~HeartbeatGuard() noexcept {
+    unregister();
+}
+
+MainContext::HeartbeatGuard::HeartbeatGuard(HeartbeatGuard&& o) noexcept
+    : context_(o.context_), word_(o.word_) {
+    o.word_ = nullptr;
+}
+
+MainContext::HeartbeatGuard& MainContext::HeartbeatGuard::operator=(
+    HeartbeatGuard&& o) noexcept {
+    unregister();
+    context_ = o.context_;
+    word_ = o.word_;
+    o.word_ = nullptr;
+
+    return *this;
+}
+
+void MainContext::HeartbeatGuard::unregister() noexcept {
+    if (word_) {
+        std::lock_guard lock(context_->heartbeat_words_mutex_);
+        std::erase(context_->heartbeat_words_, word_);
+        word_ = nullptr;
+    }
+}
+
+MainContext::HeartbeatGuard MainContext::register_heartbeat(
+    std::atomic<uint32_t>& word) noexcept {
+    return HeartbeatGuard(*this, word);
+}
+
+void MainContext::bump_heartbeats() noexcept {
+    std::lock_guard lock(heartbeat_words_mutex_);
+    for (std::atomic<uint32_t>* word : heartbeat_words_) {
+        word->fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+MainContext::TickTimerGuard::TickTimerGuard(MainContext& context,
+                                            size_t timer_id) noexcept
+    : context_(&context), timer_id_(timer_id) {}
+
+MainContext::TickTimerGuard::~TickTimerGuard() noexcept {
+    unregister();
+}
+
+MainContext::TickTimerGuard::TickTimerGuard(TickTimerGuard&& o) noexcept
+    : context_(o.context_), timer_id_(o.timer_id_) {
+    o.timer_id_ = 0;
+}
+
+MainContext::TickTimerGuard& MainContext::TickTimerGuard::operator=(
+    TickTimerGuard&& o) noexcept {
+    unregister();
+    context_ = o.context_;
+    timer_id_ = o.timer_id_;
+    o.timer_id_ = 0;
+
+    return *this;
+}
+
+void MainContext::TickTimerGuard::unregister() noexcept {
+    if (timer_id_ != 0) {
+        std::lock_guard lock(context_->tick_timers_mutex_);
+        std::erase_if(context_->tick_timers_, [&](const TickTimer& timer) {
+            return timer.id == timer_id_;
+        });
+        timer_id_ = 0;
+    }
+}
+
+MainContext::TickTimerGuard MainContext::register_tick_timer(
+    std::chrono::steady_clock::duration interval,
+    Task callback) noexcept {
+    std::lock_guard lock(tick_timers_mutex_);
+    const size_t timer_id = next_tick_timer_id_++;
+    tick_timers_.push_back(
+        TickTimer{.id = timer_id,
+                  .interval = interval,
+                  .next_due = std::chrono::steady_clock::now() + interval,
+                  .callback = std::move(callback)});
+
+    return TickTimerGuard(*this, timer_id);
+}
+
+void MainContext::fire_due_tick_timers() {
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+
+    // The due timers are collected first so a callback registering new timers
+    // can't cause those to also fire within the same tick
+    due_tick_timer_ids_.clear();
+    {
+        std::lock_guard lock(tick_timers_mutex_);
+        for (TickTimer& timer : tick_timers_) {
+            if (now >= timer.next_due) {
+                // Rescheduling relative to now instead of to the old deadline
+                // means a timer that fell behind, for instance because the
+                // GUI thread was blocked, doesn't fire in a burst afterwards
+                timer.next_due = now + timer.interval;
+                due_tick_timer_ids_.push_back(timer.id);
+            }
         }
+    }
 
-        // When the `WatchdogGuard` field on `HostBridge` gets destroyed, that
-        // bridge instance will be removed from `watched_bridges`. So if our
-        // call to `HostBridge::shutdown_if_dangling()` shuts the plugin down,
-        // the instance will be removed after this lambda exits.
-        std::lock_guard lock(watched_bridges_mutex_);
-        for (auto& bridge : watched_bridges_) {
-            bridge->shutdown_if_dangling();
+    // The callbacks run without the lock held since they may register or
+    // unregister timers themselves. Each callback is moved out of its slot
+    // for the duration of the call, so a callback unregistering its own timer
+    // just causes the function object to be dropped afterwards.
+    for (const size_t timer_id : due_tick_timer_ids_) {
+        Task callback;
+        {
+            std::lock_guard lock(tick_timers_mutex_);
+            const auto it =
+                std::find_if(tick_timers_.begin(), tick_timers_.end(),
+                             [&](const TickTimer& timer) {
+                                 return timer.id == timer_id;
+                             });
+            if (it == tick_timers_.end()) {
+                continue;
+            }
+
+            callback = std::move(it->callback);
         }
 
-        async_handle_watchdog_timer(30s);
-    });
+        callback();
+
+        {
+            std::lock_guard lock(tick_timers_mutex_);
+            const auto it =
+                std::find_if(tick_timers_.begin(), tick_timers_.end(),
+                             [&](const TickTimer& timer) {
+                                 return timer.id == timer_id;
+                             });
+            if (it != tick_timers_.end()) {
+                it->callback = std::move(callback);
+            }
+        }
+    }
+}
+
+void MainContext::drain_critical_tasks() {
+    // We move the entire queue out at once so the lock is never held while
+    // running plugin code, which may queue new tasks of its own
+    std::vector<MainContext::Task> tasks;
+    {
+        std::lock_guard lock(critical_tasks_mutex_);
+        tasks.swap(critical_tasks_);
+    }
+
+    for (auto& task : tasks) {
+        task();
+    }
 }
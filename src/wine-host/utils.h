@@ -18,21 +18,46 @@
 
 #include "use-linux-asio.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_set>
+#include <vector>
 
 #include <windows.h>
 #include <asio/dispatch.hpp>
 #include <asio/io_context.hpp>
+#include <asio/post.hpp>
 #include <function2/function2.hpp>
 
+#include "../common/tracepoints.h"
 #include "../common/utils.h"
 
-// Forward declaration for use in our watchdog in `MainContext`
+// Forward declaration for use in our process wide `Watchdog`
 class HostBridge;
 
+/**
+ * The event loop tick interval used when no editors are open and the GUI
+ * thread's message queue is empty. Without any GUIs there's nothing to draw at
+ * the configured frame rate, and pumping empty message queues at 60+ updates
+ * per second adds up when a group host process runs dozens of instances. The
+ * loop ramps back up to the configured interval as soon as an editor opens or
+ * messages are waiting in the queue.
+ */
+constexpr std::chrono::milliseconds idle_event_loop_interval(100);
+
+/**
+ * Count the machine's physical cores. SMT siblings share their core's
+ * execution resources, so sizing a worker pool to the logical CPU count would
+ * just reintroduce the contention such a pool tries to avoid. Every logical
+ * CPU lists its siblings in sysfs, and counting only the CPUs that come first
+ * in their own sibling list counts every physical core exactly once.
+ */
+size_t count_physical_cores() noexcept;
+
 /**
  * A proxy function that calls `Win32Thread::entry_point` since `CreateThread()`
  * is not usable with lambdas directly. Calling the passed function will invoke
@@ -145,21 +170,178 @@ class Win32Timer {
     std::optional<size_t> timer_id_;
 };
 
+/**
+ * The process wide watchdog that shuts down a plugin instance's sockets when
+ * the native host process that spawned it is no longer active. In some cases
+ * Unix Domain Sockets are left in a state where it's impossible to tell that
+ * the remote isn't alive anymore, and where `recv()` will just hang
+ * indefinitely, so we periodically check whether the host processes are still
+ * running instead. This approach also works with plugin groups since closing a
+ * plugin's sockets will only cause that one plugin to terminate.
+ *
+ * A single monitor thread is shared by every plugin and every `MainContext` in
+ * the process. Since all registered bridges get checked in one sweep anyway,
+ * running a periodically waking watchdog thread per IO context would just add
+ * wakeups without adding any protection.
+ */
+class Watchdog {
+   public:
+    /**
+     * The watchdog shared by all plugins hosted in this process. The monitor
+     * thread is only spawned once the first bridge registers itself, and not
+     * at all when the watchdog has been disabled through
+     * `YABRIDGE_NO_WATCHDOG`.
+     */
+    static Watchdog& instance();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+    Watchdog(Watchdog&&) = delete;
+    Watchdog& operator=(Watchdog&&) = delete;
+
+    /**
+     * The RAII guard used to register and unregister host bridge instances
+     * from the watchdog.
+     */
+    class Guard {
+       public:
+        /**
+         * The inactive guard handed out in trusted group processes, where
+         * bridges don't participate in the watchdog at all.
+         *
+         * @see Watchdog::disable_for_trusted_group
+         */
+        Guard() noexcept;
+
+        Guard(HostBridge& bridge,
+              std::unordered_set<HostBridge*>& watched_bridges,
+              std::mutex& watched_bridges_mutex);
+        ~Guard() noexcept;
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        Guard(Guard&& o) noexcept;
+        Guard& operator=(Guard&& o) noexcept;
+
+       private:
+        /**
+         * Used to facilitate moves, and false for the inactive guards handed
+         * out in trusted group processes.
+         */
+        bool is_active_ = true;
+
+        /**
+         * The bridge that we will add to the watchdog list when this object
+         * gets created, and that we'll remove from the list again when this
+         * object gets destroyed.
+         */
+        HostBridge* bridge_ = nullptr;
+
+        // Pointers to the same two fields on `Watchdog`, so we don't have to
+        // use `friend`
+        std::unordered_set<HostBridge*>* watched_bridges_ = nullptr;
+        std::mutex* watched_bridges_mutex_ = nullptr;
+    };
+
+    /**
+     * Register a bridge instance for the watchdog. We'll periodically check if
+     * the remote (native) host process that should be connected to the bridge
+     * instance is still alive, and we'll shut down the bridge if it is not to
+     * prevent dangling processes. The returned guard should be stored as a
+     * field in `HostBridge`, and the watchdog will automatically be
+     * unregistered once this guard drops from scope.
+     */
+    Guard register_watchdog(HostBridge& bridge);
+
+    /**
+     * Replace active watchdog participation with the passive shared memory
+     * heartbeat for this process's entire lifetime. This backs the
+     * `group_trusted` option: on setups where the plugin host processes are
+     * managed externally, such as a locked-down render farm, the periodic
+     * process liveness sweeps only add a monitor thread and mutex work on
+     * plugin lifetime paths. After this call `register_watchdog()` hands out
+     * inactive guards and the monitor thread is never spawned. The native
+     * side can still observe this process through the heartbeat words, which
+     * get bumped by the event loops without any involvement from this class.
+     * Dangling host processes are no longer cleaned up, so this must only be
+     * used when something else manages those processes. Must be called
+     * before the first bridge registers itself.
+     */
+    void disable_for_trusted_group() noexcept;
+
+   private:
+    Watchdog() noexcept;
+    ~Watchdog() noexcept;
+
+    /**
+     * Spawn the monitor thread if that hasn't happened yet. Called from
+     * `register_watchdog()`. This also prints the warning when the watchdog
+     * has been disabled, so it only shows up once per process.
+     */
+    void ensure_monitor_started();
+
+    /**
+     * The monitor thread entry point. Periodically checks whether the host
+     * processes belonging to all registered plugin bridges are still alive,
+     * and shuts down the plugin instances where this is not the case, so that
+     * this process can gracefully terminate.
+     */
+    void monitor_loop();
+
+    /**
+     * All of the bridges we're watching as part of our watchdog. We're storing
+     * pointers for efficiency's sake, since reference wrappers don't implement
+     * any comparison operators.
+     */
+    std::unordered_set<HostBridge*> watched_bridges_;
+    std::mutex watched_bridges_mutex_;
+
+    /**
+     * Whether this process hosts a trusted group. Set once before any bridge
+     * registers itself and read-only afterwards, so this doesn't need to be
+     * atomic.
+     *
+     * @see disable_for_trusted_group
+     */
+    bool trusted_ = false;
+
+    /**
+     * The thread where we run our periodic checks, to shut down plugins after
+     * the native plugin host process they're supposed to be connected to has
+     * died.
+     */
+    Win32Thread monitor_thread_;
+    std::once_flag monitor_started_;
+
+    /**
+     * The monitor thread sleeps on this in between checks, so tearing the
+     * watchdog down at process exit doesn't have to wait out the rest of the
+     * current interval.
+     */
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool shutdown_ = false;
+};
+
 /**
  * A wrapper around `asio::io_context()` to serve as the application's
  * main IO context, run from the GUI thread. A single instance is shared for all
  * plugins in a plugin group so that several important events can be handled on
  * the main thread, which can be required because in the Win32 model all GUI
  * related operations have to be handled from the same thread.
- *
- * This also spawns a second IO context in its own thread, which will be used as
- * a watchdog to shutdown a plugin instance's sockets when the process that
- * spawned it is no longer active. This approach also works with plugin groups
- * since closing a plugin's sockets will only cause that one plugin to
- * terminate.
  */
 class MainContext {
    public:
+    /**
+     * The type used for tasks posted to this IO context. This is a move-only
+     * `std::function<void()>` with a small buffer optimization, so posting a
+     * plugin function call doesn't allocate and the captures can hold
+     * move-only resources like packaged tasks.
+     */
+    using Task = fu2::unique_function<void()>;
+
     MainContext();
 
     /**
@@ -183,21 +365,20 @@ class MainContext {
         std::chrono::steady_clock::duration new_interval) noexcept;
 
     /**
-     * The RAII guard used to register and unregister host bridge instances from
-     * our watchdog.
+     * The RAII guard returned by `register_editor()`. The event loop keeps
+     * running at the configured rate for as long as at least one of these
+     * guards is alive.
      */
-    class WatchdogGuard {
+    class EditorGuard {
        public:
-        WatchdogGuard(HostBridge& bridge,
-                      std::unordered_set<HostBridge*>& watched_bridges,
-                      std::mutex& watched_bridges_mutex);
-        ~WatchdogGuard() noexcept;
+        EditorGuard(std::atomic_size_t& active_editors) noexcept;
+        ~EditorGuard() noexcept;
 
-        WatchdogGuard(const WatchdogGuard&) = delete;
-        WatchdogGuard& operator=(const WatchdogGuard&) = delete;
+        EditorGuard(const EditorGuard&) = delete;
+        EditorGuard& operator=(const EditorGuard&) = delete;
 
-        WatchdogGuard(WatchdogGuard&& o) noexcept;
-        WatchdogGuard& operator=(WatchdogGuard&& o) noexcept;
+        EditorGuard(EditorGuard&& o) noexcept;
+        EditorGuard& operator=(EditorGuard&& o) noexcept;
 
        private:
         /**
@@ -206,28 +387,104 @@ class MainContext {
         bool is_active_ = true;
 
         /**
-         * The bridge that we will add to the watchdog list when this object
-         * gets created, and that we'll remove from the list again when this
-         * object gets destroyed.
+         * A reference to `MainContext::active_editors_`, so we don't have to
+         * use `friend`.
+         */
+        std::reference_wrapper<std::atomic_size_t> active_editors_;
+    };
+
+    /**
+     * Register an open editor. While at least one editor is open the event
+     * loop ticks at the interval configured through the `frame_rate` option,
+     * and when the last returned guard drops from scope the loop falls back to
+     * the slower idle rate again. `Editor` stores this guard as a field so
+     * this happens automatically.
+     */
+    EditorGuard register_editor() noexcept;
+
+    /**
+     * The RAII guard returned by `register_heartbeat()`. The registered word
+     * gets bumped on every event loop tick for as long as the guard is alive.
+     */
+    class HeartbeatGuard {
+       public:
+        HeartbeatGuard(MainContext& context,
+                       std::atomic<uint32_t>& word) noexcept;
+        ~HeartbeatGuard() noexcept;
+
+        HeartbeatGuard(const HeartbeatGuard&) = delete;
+        HeartbeatGuard& operator=(const HeartbeatGuard&) = delete;
+
+        HeartbeatGuard(HeartbeatGuard&& o) noexcept;
+        HeartbeatGuard& operator=(HeartbeatGuard&& o) noexcept;
+
+       private:
+        /**
+         * Unregister the current word, if any. Used in the destructor and
+         * when move assigning over an active guard.
          */
-        HostBridge* bridge_;
+        void unregister() noexcept;
 
-        // References to the same two fields on `MainContext`, so we don't have
-        // to use `friend`
-        std::reference_wrapper<std::unordered_set<HostBridge*>>
-            watched_bridges_;
-        std::reference_wrapper<std::mutex> watched_bridges_mutex_;
+        MainContext* context_;
+        std::atomic<uint32_t>* word_;
     };
 
     /**
-     * Register a bridge instance for our watchdog. We'll periodically check if
-     * the remote (native) host process that should be connected to the bridge
-     * instance is still alive, and we'll shut down the bridge if it is not to
-     * prevent dangling processes. The returned guard should be stored as a
-     * field in `HostBridge`, and the watchdog will automatically be
-     * unregistered once this guard drops from scope.
+     * Register a shared memory heartbeat word that should be incremented on
+     * every event loop tick. The native plugin side watches these counters to
+     * detect when this context's GUI thread has stopped making progress, with
+     * nothing more than an atomic load on its end.
+     *
+     * @see HeartbeatBuffer
+     */
+    HeartbeatGuard register_heartbeat(std::atomic<uint32_t>& word) noexcept;
+
+    /**
+     * The RAII guard returned by `register_tick_timer()`. The callback stops
+     * firing once this guard drops from scope.
+     */
+    class TickTimerGuard {
+       public:
+        TickTimerGuard(MainContext& context, size_t timer_id) noexcept;
+        ~TickTimerGuard() noexcept;
+
+        TickTimerGuard(const TickTimerGuard&) = delete;
+        TickTimerGuard& operator=(const TickTimerGuard&) = delete;
+
+        TickTimerGuard(TickTimerGuard&& o) noexcept;
+        TickTimerGuard& operator=(TickTimerGuard&& o) noexcept;
+
+       private:
+        /**
+         * Unregister the current timer, if any. Used in the destructor and
+         * when move assigning over an active guard.
+         */
+        void unregister() noexcept;
+
+        MainContext* context_;
+        size_t timer_id_;
+    };
+
+    /**
+     * Register a periodic callback driven by this context's event loop. All
+     * timers that have come due are delivered in one batch at the start of
+     * every event loop tick, so a tick with several due timers costs a single
+     * reactor wakeup instead of one queued `WM_TIMER` message per timer, and
+     * the delivery granularity is the phase-aligned tick interval rather than
+     * the Win32 timer resolution. The callback always runs on the GUI thread,
+     * and the returned guard should also be dropped from that thread so an
+     * unregistration can't race with a running callback. Callbacks may
+     * register and unregister timers themselves, including their own.
+     *
+     * Note that these timers only fire while the event loop is actually
+     * ticking. When the GUI thread is stuck in a Win32 modal loop, for
+     * instance because a plugin opened a dropdown menu, only `WM_TIMER`
+     * messages keep being delivered, so consumers that must keep running in
+     * that situation need their own fallback. See `Editor::run_timer_proc()`.
      */
-    WatchdogGuard register_watchdog(HostBridge& bridge);
+    TickTimerGuard register_tick_timer(
+        std::chrono::steady_clock::duration interval,
+        Task callback) noexcept;
 
     /**
      * Returns `true` if the calling thread is the GUI thread, aka the thread
@@ -241,6 +498,14 @@ class MainContext {
      * Asynchronously execute a function inside of this main IO context and
      * return the results as a future. This is used to make sure that operations
      * that may involve the Win32 message loop are all run from the same thread.
+     *
+     * These functions go through a latency-critical lane that jumps ahead of
+     * work queued with `schedule_task()` and of pending Win32 message batches.
+     * The host is usually blocked waiting on the returned future, so a
+     * `restartComponent()` triggered by parameter automation shouldn't have to
+     * wait for a plugin GUI that's flooding the message queue. Calls made from
+     * the GUI thread itself are still executed directly to allow mutually
+     * recursive function calls.
      */
     template <std::invocable F>
     std::future<std::invoke_result_t<F>> run_in_context(F&& fn) {
@@ -248,7 +513,18 @@ class MainContext {
 
         std::packaged_task<Result()> call_fn(std::forward<F>(fn));
         std::future<Result> result = call_fn.get_future();
-        asio::dispatch(context_, std::move(call_fn));
+        if (is_gui_thread()) {
+            asio::dispatch(context_, std::move(call_fn));
+        } else {
+            {
+                std::lock_guard lock(critical_tasks_mutex_);
+                critical_tasks_.emplace_back(std::move(call_fn));
+            }
+
+            // This makes sure the task also gets picked up when the IO context
+            // is sitting idle in between event loop ticks
+            asio::post(context_, [&]() { drain_critical_tasks(); });
+        }
 
         return result;
     }
@@ -256,7 +532,9 @@ class MainContext {
     /**
      * Run a task within the IO context. The difference with `run_in_context()`
      * is that this version does not guarantee that it's going to be executed as
-     * soon as possible, and thus we also won't return a future.
+     * soon as possible, and thus we also won't return a future. This is the
+     * bulk lane: tasks queued here run in FIFO order after any pending
+     * latency-critical functions.
      */
     template <std::invocable F>
     void schedule_task(F&& fn) {
@@ -270,7 +548,11 @@ class MainContext {
      *
      * @param handler The function that should be executed in the IO context
      *   when the timer ticks. This should be a function that handles both the
-     *   X11 events and the Win32 message loop.
+     *   X11 events and the Win32 message loop. It should return `true` when it
+     *   has more work left for the current tick, in which case it gets run
+     *   again after the tasks queued through `run_in_context()` have had a
+     *   chance to execute. This way a plugin GUI flooding the message queue
+     *   can't starve the other plugins' main thread function calls.
      * @param predicate A function returning a boolean to indicate whether
      *   `handler` should be run. If this returns `false`, then the current
      *   event loop cycle will be skipped. This is used to prevent the Win32
@@ -280,24 +562,34 @@ class MainContext {
      *   that will cause them to stall indefinitely in this situation, but who
      *   knows which other plugins exert similar behaviour.
      */
-    template <std::invocable F, invocable_returning<bool> P>
+    template <invocable_returning<bool> F, invocable_returning<bool> P>
     void async_handle_events(F handler, P predicate) {
         // Try to keep a steady framerate, but add in delays to let other events
         // get handled if the GUI message handling somehow takes very long.
-        events_timer_.expires_at(
-            std::max(events_timer_.expiry() + timer_interval_,
-                     std::chrono::steady_clock::now() + timer_interval_ / 4));
+        const std::chrono::steady_clock::duration interval =
+            current_timer_interval();
+        events_timer_.expires_at(align_timer_phase(
+            std::max(events_timer_.expiry() + interval,
+                     std::chrono::steady_clock::now() + interval / 4),
+            interval));
         events_timer_.async_wait(
-            [&, handler, predicate](const std::error_code& error) {
+            [&, handler = std::move(handler), predicate = std::move(predicate)](
+                const std::error_code& error) mutable {
                 if (error) {
                     return;
                 }
 
-                if (predicate()) {
-                    handler();
-                }
+                // Ticking heartbeats here rather than per batch means a
+                // plugin flooding the message queue doesn't inflate them
+                bump_heartbeats();
 
-                async_handle_events(handler, predicate);
+                // All timers registered through `register_tick_timer()` that
+                // have come due get delivered in one batch per tick
+                fire_due_tick_timers();
+
+                YABRIDGE_PROBE(event_loop_tick);
+
+                handle_event_batch(std::move(handler), std::move(predicate));
             });
     }
 
@@ -309,15 +601,76 @@ class MainContext {
 
    private:
     /**
-     * Start a timer to periodically check whether the host processes belong to
-     * all active plugin bridges are still alive. We will shut down the plugin
-     * instances where this is not the case, so that this process can gracefully
-     * terminate. In some cases Unix Domain Sockets are left in a state where
-     * it's impossible to tell that the remote isn't alive anymore, and where
-     * `recv()` will just hang indefinitely. We use this watchdog to avoid this.
+     * Run a single batch of the event handling started through
+     * `async_handle_events()`. When the handler indicates that it has more
+     * work left for this tick, the next batch gets posted through the IO
+     * context instead of being run directly so that tasks queued with
+     * `run_in_context()` can execute in between the batches. Once the handler
+     * is done we'll wait for the next timer tick again.
+     */
+    template <invocable_returning<bool> F, invocable_returning<bool> P>
+    void handle_event_batch(F handler, P predicate) {
+        // Host-visible function calls always go first so their round trip
+        // times stay bounded by a single message batch, even when a plugin
+        // GUI keeps the message queue saturated
+        drain_critical_tasks();
+
+        const bool more_events = predicate() ? handler() : false;
+        if (more_events) {
+            asio::post(context_, [&, handler = std::move(handler),
+                                  predicate = std::move(predicate)]() mutable {
+                handle_event_batch(std::move(handler), std::move(predicate));
+            });
+        } else {
+            async_handle_events(std::move(handler), std::move(predicate));
+        }
+    }
+
+    /**
+     * Run all functions currently queued through `run_in_context()` from other
+     * threads. These are expected to be short plugin function calls with a
+     * host blocked on the result, so the queue is drained in full every time.
+     */
+    void drain_critical_tasks();
+
+    /**
+     * The tick interval to use for the next event loop cycle. While editors
+     * are open or the GUI thread's message queue has messages waiting we'll
+     * use the interval configured through the `frame_rate` option, and
+     * otherwise we'll fall back to the much slower `idle_event_loop_interval`.
+     * The queue check means that bursts of activity from editorless plugins,
+     * like `WM_TIMER` messages for hidden windows, still ramp the loop back up
+     * to full speed.
+     *
+     * This is called from `async_handle_events()`, which always runs on the
+     * GUI thread. That matters because `GetQueueStatus()` inspects the calling
+     * thread's message queue.
+     */
+    /**
+     * Round a timer deadline up to the next multiple of `interval` since the
+     * `std::chrono::steady_clock` epoch. That clock is `CLOCK_MONOTONIC`, and
+     * its epoch is the machine's boot time, so every yabridge host process on
+     * the system rounds against the same grid. Separately hosted plugins thus
+     * phase-lock their event loops and wake up in a single burst per interval
+     * instead of at sixty unaligned phases, which lets CPU cores actually
+     * reach deeper idle states in between. In the steady state the deadline
+     * computed in `async_handle_events()` already lies on the grid, so this is
+     * a no-op there and the configured frame rate is unaffected; only the
+     * first tick and the falling-behind recovery path get nudged.
      */
-    void async_handle_watchdog_timer(
-        std::chrono::steady_clock::duration interval);
+    static std::chrono::steady_clock::time_point align_timer_phase(
+        std::chrono::steady_clock::time_point deadline,
+        std::chrono::steady_clock::duration interval) noexcept;
+
+    std::chrono::steady_clock::duration current_timer_interval()
+        const noexcept {
+        if (active_editors_.load(std::memory_order_relaxed) == 0 &&
+            GetQueueStatus(QS_ALLINPUT) == 0) {
+            return idle_event_loop_interval;
+        }
+
+        return timer_interval_;
+    }
 
     /**
      * The **Windows** thread ID the context is running on, which will be our
@@ -341,30 +694,66 @@ class MainContext {
         std::chrono::milliseconds(1000) / 60;
 
     /**
-     * The IO context used for the watchdog described below.
+     * The number of currently open editors, tracked through the guards
+     * returned by `register_editor()`. When this is zero the event loop can
+     * drop to `idle_event_loop_interval`.
      */
-    asio::io_context watchdog_context_;
+    std::atomic_size_t active_editors_ = 0;
 
     /**
-     * The timer used to periodically check if the host processes are still
-     * active, so we can shut down a plugin's sockets (and with that the plugin
-     * itself) when the host has exited and the sockets are somehow not closed
-     * yet..
+     * Increment all heartbeat words registered through
+     * `register_heartbeat()`. Called once per event loop tick.
      */
-    asio::steady_timer watchdog_timer_;
+    void bump_heartbeats() noexcept;
 
     /**
-     * All of the bridges we're watching as part of our watchdog. We're storing
-     * pointers for efficiency's sake, since reference wrappers don't implement
-     * any comparison operators.
+     * The heartbeat words registered through `register_heartbeat()`. The
+     * mutex is only ever contended when plugins are loading or unloading.
      */
-    std::unordered_set<HostBridge*> watched_bridges_;
-    std::mutex watched_bridges_mutex_;
+    std::vector<std::atomic<uint32_t>*> heartbeat_words_;
+    std::mutex heartbeat_words_mutex_;
 
     /**
-     * The thread where we run our watchdog timer, to shut down plugins after
-     * the native plugin host process they're supposed to be connected to has
-     * died.
+     * A periodic callback registered through `register_tick_timer()`, with
+     * the deadline for its next delivery.
+     */
+    struct TickTimer {
+        size_t id;
+        std::chrono::steady_clock::duration interval;
+        std::chrono::steady_clock::time_point next_due;
+        Task callback;
+    };
+
+    /**
+     * Deliver all registered timers that have come due. Called once at the
+     * start of every event loop tick. The callbacks run without the lock held
+     * and are looked up by ID one at a time, since a callback may itself
+     * register or unregister timers.
+     */
+    void fire_due_tick_timers();
+
+    /**
+     * The timers registered through `register_tick_timer()`. Like the
+     * heartbeat words, the mutex is only ever contended when plugins are
+     * loading or unloading.
+     */
+    std::vector<TickTimer> tick_timers_;
+    std::mutex tick_timers_mutex_;
+    size_t next_tick_timer_id_ = 1;
+
+    /**
+     * The IDs of the timers due in the current tick. A field on the context
+     * so `fire_due_tick_timers()` doesn't allocate a new vector sixty times
+     * per second.
+     */
+    std::vector<size_t> due_tick_timer_ids_;
+
+    /**
+     * The latency-critical lane for `run_in_context()`. These tasks are
+     * executed before the bulk work posted directly onto the IO context, both
+     * from `handle_event_batch()` and from a trigger posted alongside the
+     * task.
      */
-    Win32Thread watchdog_handler_;
+    std::vector<Task> critical_tasks_;
+    std::mutex critical_tasks_mutex_;
 };
@@ -75,6 +75,16 @@ static WineXdndProxy* instance = nullptr;
  */
 static std::atomic_size_t instance_reference_count = 0;
 
+/**
+ * The WinEvents hook that watches for the tracker windows created by Wine's OLE
+ * drag-and-drop implementation. This is installed as soon as the first editor
+ * opens because it's nearly free, while the `WineXdndProxy` itself with its
+ * dedicated X11 connection is only created once a drag actually starts.
+ */
+static std::unique_ptr<std::remove_pointer_t<HWINEVENTHOOK>,
+                       std::decay_t<decltype(&UnhookWinEvent)>>
+    hook_handle(nullptr, UnhookWinEvent);
+
 void CALLBACK dnd_winevent_callback(HWINEVENTHOOK hWinEventHook,
                                     DWORD event,
                                     HWND hwnd,
@@ -127,16 +137,7 @@ WineXdndProxy::WineXdndProxy()
                                 window, screen->root, 0, 0, 1, 1, 0,
                                 XCB_WINDOW_CLASS_INPUT_ONLY,
                                 XCB_COPY_FROM_PARENT, 0, nullptr);
-          }),
-      hook_handle_(
-          SetWinEventHook(EVENT_OBJECT_CREATE,
-                          EVENT_OBJECT_CREATE,
-                          nullptr,
-                          dnd_winevent_callback,
-                          0,
-                          0,
-                          WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS),
-          UnhookWinEvent) {
+          }) {
     // XDND uses a whole load of atoms for its messages, properties, and
     // selections
     xcb_xdnd_selection_ =
@@ -167,30 +168,41 @@ WineXdndProxy::WineXdndProxy()
         get_atom_by_name(*x11_connection_, mime_text_plain_name);
 }
 
-WineXdndProxy::Handle::Handle(WineXdndProxy* proxy) : proxy_(proxy) {}
+WineXdndProxy::Handle::Handle() {}
 
 WineXdndProxy::Handle::~Handle() noexcept {
     if (instance_reference_count.fetch_sub(1) == 1) {
-        delete proxy_;
+        hook_handle.reset();
+
+        // The proxy is only created once a drag-and-drop operation actually
+        // happened, so there may not be anything to free here
+        delete instance;
+        instance = nullptr;
     }
 }
 
-WineXdndProxy::Handle::Handle(const Handle& o) noexcept : proxy_(o.proxy_) {
+WineXdndProxy::Handle::Handle(const Handle&) noexcept {
     instance_reference_count += 1;
 }
 
-WineXdndProxy::Handle::Handle(Handle&& o) noexcept : proxy_(o.proxy_) {
+WineXdndProxy::Handle::Handle(Handle&&) noexcept {
     instance_reference_count += 1;
 }
 
 WineXdndProxy::Handle WineXdndProxy::get_handle() {
     // See the `instance` global above for an explanation on what's going on
-    // here.
+    // here. The hook itself is cheap to install, so we'll do that right away.
+    // The expensive part, creating the `WineXdndProxy` with its own X11
+    // connection, is deferred to `dnd_winevent_callback()` until a drag
+    // actually starts.
     if (instance_reference_count.fetch_add(1) == 0) {
-        instance = new WineXdndProxy{};
+        hook_handle.reset(
+            SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_CREATE, nullptr,
+                            dnd_winevent_callback, 0, 0,
+                            WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS));
     }
 
-    return Handle(instance);
+    return Handle();
 }
 
 void WineXdndProxy::begin_xdnd(
@@ -919,13 +931,20 @@ void CALLBACK dnd_winevent_callback(HWINEVENTHOOK /*hWinEventHook*/,
     }
 
     // This shouldn't be possible, but you can never be too sure!
-    if (instance_reference_count <= 0 || !instance) {
+    if (instance_reference_count <= 0) {
         std::cerr << "Drag-and-drop proxy has not yet been initialized"
                   << std::endl;
         return;
     }
 
     try {
+        // We'll only create the actual proxy, along with its dedicated X11
+        // connection, the first time it's needed. Since this callback always
+        // runs on the GUI thread this doesn't need any synchronization.
+        if (!instance) {
+            instance = new WineXdndProxy{};
+        }
+
         instance->begin_xdnd(dragged_files, hwnd);
     } catch (const std::exception& error) {
         std::cerr << "XDND initialization failed:" << std::endl;
@@ -77,14 +77,17 @@ class X11Window {
 };
 
 /**
- * A simple wrapper that registers a WinEvents hook to listen for new windows
- * being created, and handles XDND client messages to achieve the behaviour
- * described in `WineXdndProxy::get_handle()`.
+ * A simple wrapper that handles XDND client messages to achieve the behaviour
+ * described in `WineXdndProxy::get_handle()`. The WinEvents hook used to
+ * detect the start of a drag-and-drop operation is registered separately in
+ * `get_handle()`, and this object - along with its dedicated X11 connection -
+ * is only created once a drag actually starts.
  */
 class WineXdndProxy {
    protected:
     /**
-     * Initialize the proxy and register all hooks.
+     * Initialize the proxy, its X11 connection, and the atoms used for the
+     * XDND protocol.
      */
     WineXdndProxy();
 
@@ -103,14 +106,15 @@ class WineXdndProxy {
          * Before calling this, the reference count should be increased by one
          * in `WineXdndProxy::get_handle()`.
          */
-        Handle(WineXdndProxy* proxy);
+        Handle();
 
         friend WineXdndProxy;
 
        public:
         /**
-         * Reduces the reference count by one, and frees `proxy_` if this was
-         * the last handle.
+         * Reduces the reference count by one, and unregisters the hook and
+         * frees the proxy instance (if a drag ever caused one to be created)
+         * if this was the last handle.
          */
         ~Handle() noexcept;
 
@@ -119,9 +123,6 @@ class WineXdndProxy {
 
         Handle(Handle&&) noexcept;
         Handle& operator=(Handle&&) noexcept = default;
-
-       private:
-        WineXdndProxy* proxy_;
     };
 
     /**
@@ -136,9 +137,11 @@ class WineXdndProxy {
      * Because the actual data is stored in a COM object, we can only handle
      * drag-and-drop coming form this process.
      *
-     * This is sort of a singleton but not quite, as the `WineXdndProxy` is only
-     * alive for as long as there are open editors in this process. This is done
-     * to avoid opening too many X11 connections.
+     * This is sort of a singleton but not quite, as the hook is only installed
+     * for as long as there are open editors in this process. The actual
+     * `WineXdndProxy` with its dedicated X11 connection is created even more
+     * lazily, on the first drag-and-drop operation. This is done to avoid
+     * opening too many X11 connections.
      *
      * @note This function, like everything other GUI realted, should be called
      *   from the main thread that's running the Win32 message loop.
@@ -240,10 +243,6 @@ class WineXdndProxy {
      */
     X11Window proxy_window_;
 
-    std::unique_ptr<std::remove_pointer_t<HWINEVENTHOOK>,
-                    std::decay_t<decltype(&UnhookWinEvent)>>
-        hook_handle_;
-
     /**
      * MT-PowerDrumkit for some reason initializes a drag-and-drop operation,
      * cancels it, and then immediately starts a new one. We need to make sure
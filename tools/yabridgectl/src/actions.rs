@@ -20,6 +20,7 @@ use anyhow::{Context, Result};
 use clap::ValueEnum;
 use colored::Colorize;
 use std::collections::{HashMap, HashSet};
+use std::env;
 use std::fs;
 use std::path::{Path, PathBuf};
 use walkdir::WalkDir;
@@ -30,6 +31,7 @@ use crate::config::{
     YABRIDGE_HOST_32_EXE_NAME, YABRIDGE_HOST_EXE_NAME,
 };
 use crate::files::{self, ClapPlugin, NativeFile, Plugin, Vst2Plugin};
+use crate::resources;
 use crate::util::{self, get_file_type};
 use crate::util::{verify_external_dependencies, verify_path_setup, verify_wine_setup};
 use crate::vst3_moduleinfo::ModuleInfo;
@@ -51,7 +53,7 @@ pub fn remove_directory(config: &mut Config, path: &Path) -> Result<()> {
 
     // Ask the user to remove any leftover files to prevent possible future problems and out of date
     // copies
-    let orphan_files = files::index(path, &HashSet::new()).so_files;
+    let orphan_files = files::index(path, &HashSet::new(), None).so_files;
     if !orphan_files.is_empty() {
         println!(
             "Warning: Found {} leftover .so files still in this directory:",
@@ -212,6 +214,54 @@ pub fn show_status(config: &Config) -> Result<()> {
         }
     }
 
+    // If any bridges are currently running we'll also show their memory usage, with the shared
+    // memory segments backing the audio buffers attributed to plugin instances
+    resources::show_resource_usage();
+
+    Ok(())
+}
+
+/// Change the log verbosity of running bridge instances by writing the new level to the
+/// `verbosity` control file inside their socket directories. Both the native and the Wine side of
+/// a bridge watch this file, so the new level takes effect on both sides without reloading the
+/// plugin. A negative level reverts back to the verbosity set through `YABRIDGE_DEBUG_LEVEL`.
+pub fn set_log_level(instance: &str, level: i32) -> Result<()> {
+    // This must match `get_temporary_directory()` from `src/common/utils.cpp`, which is where the
+    // socket directories are created
+    let runtime_dir = env::var("XDG_RUNTIME_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(|_| PathBuf::from("/tmp"));
+
+    let mut num_updated = 0;
+    for entry in fs::read_dir(&runtime_dir)
+        .with_context(|| format!("Could not read '{}'", runtime_dir.display()))?
+    {
+        let entry = entry?;
+        let directory_name = entry.file_name().to_string_lossy().into_owned();
+        if !entry.path().is_dir() || !directory_name.starts_with("yabridge-") {
+            continue;
+        }
+        if instance != "all" && !directory_name.contains(instance) {
+            continue;
+        }
+
+        let control_file = entry.path().join("verbosity");
+        fs::write(&control_file, format!("{}\n", level))
+            .with_context(|| format!("Could not write to '{}'", control_file.display()))?;
+
+        println!("Set the log level for '{}' to {}", directory_name, level);
+        num_updated += 1;
+    }
+
+    if num_updated == 0 {
+        println!(
+            "No running bridge instances matched '{}'. The bridges create their socket \
+             directories under '{}', so you can check there to see what's running.",
+            instance,
+            runtime_dir.display()
+        );
+    }
+
     Ok(())
 }
 
@@ -331,18 +331,30 @@ impl Config {
         })
     }
 
-    /// Search for VST2, VST3, and CLAP plugins in all of the registered plugins directories.
+    /// Search for VST2, VST3, and CLAP plugins in all of the registered plugins directories. The
+    /// directory listings from the previous search are used to skip relisting unchanged
+    /// directories, which makes re-syncs against large or network mounted plugin collections much
+    /// cheaper.
     pub fn search_directories(&self) -> Result<BTreeMap<&Path, SearchResults>> {
         let blacklist: HashSet<&Path> = self.blacklist.iter().map(|p| p.as_path()).collect();
 
-        self.plugin_dirs
+        let cache = files::ScanCache::read();
+        let results = self
+            .plugin_dirs
             .par_iter()
             .map(|path| {
-                files::index(path, &blacklist)
+                files::index(path, &blacklist, Some(&cache))
                     .search()
                     .map(|search_results| (path.as_path(), search_results))
             })
-            .collect()
+            .collect();
+
+        // The cache is an optimization, so failing to persist it shouldn't fail the search
+        if let Err(err) = cache.write() {
+            eprintln!("Warning: could not write the scan cache: {err}");
+        }
+
+        results
     }
 }
 
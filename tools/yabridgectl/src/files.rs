@@ -16,15 +16,21 @@
 
 //! Functions to index plugins and to set up yabridge for those plugins.
 
-use anyhow::Result;
+use anyhow::{Context, Result};
 use rayon::prelude::*;
+use serde_derive::{Deserialize, Serialize};
 use std::collections::{BTreeMap, HashMap, HashSet};
 use std::fmt::Display;
+use std::fs;
+use std::os::unix::fs::MetadataExt;
 use std::path::{Path, PathBuf};
-use walkdir::WalkDir;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use std::time::UNIX_EPOCH;
 
 use crate::config::{
-    yabridge_clap_home, yabridge_vst2_home, yabridge_vst3_home, Config, YabridgeFiles,
+    yabridge_clap_home, yabridge_vst2_home, yabridge_vst3_home, yabridgectl_directories, Config,
+    YabridgeFiles,
 };
 use crate::symbols::parse_pe32_binary;
 use crate::util::get_file_type;
@@ -67,7 +73,7 @@ pub struct SearchIndex {
 }
 
 /// Native `.so` files and VST3 bundle directories we found during a search.
-#[derive(Debug, Clone, PartialEq, Eq)]
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
 pub enum NativeFile {
     Symlink(PathBuf),
     Regular(PathBuf),
@@ -488,102 +494,323 @@ impl SearchResults {
     }
 }
 
-/// Find all `.dll`, `.vst3`, `.clap`, and `.so` files under a directory. These results can be
-/// filtered down to actual VST2 plugins, VST3 modules, and CLAP plugins using `search()`. Any path
-/// found in the blacklist will be pruned immediately, so this can be used to both not index
-/// individual files and to skip an entire directory.
-///
-/// For VST3 plugin _bundles_ the subdirectory also contains the `foo.vst3/Contents/x86_64-win`
-/// suffix. This needs to be stripped out to get the bundle root.
-pub fn index(directory: &Path, blacklist: &HashSet<&Path>) -> SearchIndex {
-    // These are pairs of `(absolute_path, subdirectory)`. The subdirectory is used for setting up
-    // VST3 and CLAP plugins and for setting up VST2 plugins in the centralized installation
-    // location mode.
-    let mut dll_files: Vec<(PathBuf, Option<PathBuf>)> = Vec::new();
-    let mut vst3_files: Vec<(PathBuf, Option<PathBuf>)> = Vec::new();
-    let mut clap_files: Vec<(PathBuf, Option<PathBuf>)> = Vec::new();
-    let mut so_files: Vec<NativeFile> = Vec::new();
-    for (file_idx, path) in WalkDir::new(directory)
-        .follow_links(true)
-        .into_iter()
-        .filter_entry(|e| {
-            // The blacklist entries are canonicalized to resolve symlinks and to normalize slashes,
-            // so we should do the same thing here as well
-            e.path()
-                .canonicalize()
-                .map(|p| !blacklist.contains(p.as_path()))
-                .unwrap_or(false)
-        })
-        .filter_map(|e| {
-            // NOTE: Broken symlinks will also get an `Err` entry, so we'll use `err.path()` to
-            //       still include them in the index
-            let path = match e {
-                Ok(entry) => entry.path().to_owned(),
-                Err(err) => err.path()?.to_owned(),
-            };
-
-            if !path.is_dir() {
-                Some(path)
-            } else {
-                None
-            }
+/// The name of the scan cache file in yabridgectl's XDG cache directory. This stores the listing
+/// of every directory visited during the last `index()` walk together with the directory's
+/// modification time, so unchanged directories can be relisted from the cache on the next sync.
+/// This matters most on network file systems, where a `readdir()` over thousands of plugin
+/// bundles can take orders of magnitude longer than a single `stat()` per directory.
+const SCAN_CACHE_FILE_NAME: &str = "scan-cache.json";
+
+/// An indexable file found directly inside a cached directory.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+enum CachedFile {
+    Dll(PathBuf),
+    Vst3(PathBuf),
+    Clap(PathBuf),
+    So(NativeFile),
+}
+
+/// The cached listing for a single directory, valid for as long as the directory's modification
+/// time doesn't change. Adding, removing or renaming an entry in a directory bumps that
+/// directory's mtime, and those are the only changes `index()` cares about: whether a file's
+/// _contents_ still contain a plugin entry point gets rechecked by `search()` either way.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+struct CachedDirectory {
+    /// The directory's modification time as whole seconds and subsecond nanoseconds since the
+    /// Unix epoch.
+    mtime: (u64, u32),
+    /// The indexable files directly inside this directory.
+    files: Vec<CachedFile>,
+    /// The subdirectories to descend into. These have their own cache entries.
+    subdirectories: Vec<PathBuf>,
+}
+
+/// A persistent cache of directory listings keyed by absolute path, used by `index()` to skip
+/// relisting unchanged directories. Reading and writing the cache is best effort: a missing or
+/// corrupt cache file simply means everything gets walked again.
+pub struct ScanCache {
+    /// The listings from the previous run.
+    previous: HashMap<PathBuf, CachedDirectory>,
+    /// The listings observed during this run. Directories that no longer exist are never visited
+    /// and thus never reinserted, so writing this back automatically prunes stale entries.
+    current: Mutex<HashMap<PathBuf, CachedDirectory>>,
+}
+
+impl ScanCache {
+    /// Read the cache written by the previous run, or start with an empty cache if there is none.
+    pub fn read() -> ScanCache {
+        let previous = yabridgectl_directories()
+            .ok()
+            .and_then(|dirs| dirs.find_cache_file(SCAN_CACHE_FILE_NAME))
+            .and_then(|path| fs::read_to_string(path).ok())
+            .and_then(|json| serde_jsonrc::from_str(&json).ok())
+            .unwrap_or_default();
+
+        ScanCache {
+            previous,
+            current: Mutex::new(HashMap::new()),
+        }
+    }
+
+    /// Persist the listings recorded during this run for the next one.
+    pub fn write(&self) -> Result<()> {
+        let cache_path = yabridgectl_directories()?
+            .place_cache_file(SCAN_CACHE_FILE_NAME)
+            .context("Could not create the scan cache file")?;
+        let json = serde_jsonrc::to_string(&*self.current.lock().unwrap())
+            .context("Could not serialize the scan cache")?;
+
+        fs::write(&cache_path, json).with_context(|| {
+            format!("Failed to write scan cache to '{}'", cache_path.display())
         })
-        .enumerate()
-    {
+    }
+
+    /// The previous listing for a directory, if the directory hasn't been modified since it was
+    /// recorded.
+    fn lookup(&self, directory: &Path, mtime: (u64, u32)) -> Option<&CachedDirectory> {
+        self.previous
+            .get(directory)
+            .filter(|cached| cached.mtime == mtime)
+    }
+
+    /// Record a directory's listing for the next run.
+    fn store(&self, directory: PathBuf, listing: CachedDirectory) {
+        self.current.lock().unwrap().insert(directory, listing);
+    }
+}
+
+/// The state shared by all threads participating in one `index()` walk.
+struct WalkContext<'a> {
+    /// The directory the walk started from, used to compute the relative subdirectories.
+    directory: &'a Path,
+    blacklist: &'a HashSet<&'a Path>,
+    cache: Option<&'a ScanCache>,
+    /// The results collected so far.
+    index: Mutex<SearchIndex>,
+    /// The number of files indexed so far, for the runaway scan warning.
+    indexed_files: AtomicUsize,
+    /// The device and inode numbers of every directory visited so far. Since symlinks get
+    /// followed, this is what keeps a symlink pointing back at an ancestor from sending the walk
+    /// into an infinite loop, the same protection `WalkDir` offered.
+    visited_directories: Mutex<HashSet<(u64, u64)>>,
+}
+
+impl WalkContext<'_> {
+    /// Whether an entry should be pruned from the walk. The blacklist entries are canonicalized
+    /// to resolve symlinks and to normalize slashes, so we should do the same thing here as well.
+    /// With an empty blacklist the canonicalization gets skipped entirely, since it costs a
+    /// couple of system calls per entry.
+    fn is_blacklisted(&self, path: &Path) -> bool {
+        if self.blacklist.is_empty() {
+            return false;
+        }
+
+        path.canonicalize()
+            .map(|p| self.blacklist.contains(p.as_path()))
+            .unwrap_or(true)
+    }
+
+    /// Add an indexed file to the results. The relative subdirectory used for setting up VST3 and
+    /// CLAP plugins and for the centralized VST2 installation location gets computed here, so
+    /// cached listings can be reused no matter which directory the walk started from.
+    fn push_file(&self, file: &CachedFile) {
         // This is a bit of an odd warning, but I can see it happening that someone adds their
-        // entire home directory by accident. Removing the home directory would cause yabridgectl to
-        // scan for leftover `.so` files, which would of course take an enternity. This warning will
-        // at least tell the user what's happening and that they can safely cancel the scan.
-        if file_idx == 100_000 {
+        // entire home directory by accident. Removing the home directory would cause yabridgectl
+        // to scan for leftover `.so` files, which would of course take an enternity. This warning
+        // will at least tell the user what's happening and that they can safely cancel the scan.
+        if self.indexed_files.fetch_add(1, Ordering::Relaxed) == 100_000 {
             eprintln!(
                 "Indexed over 100.000 files, press Ctrl+C to cancel this operation if this was \
                  not intentional."
             )
         }
 
-        match path.extension().and_then(|os| os.to_str()) {
-            Some("dll") => {
-                let subdirectory = path
-                    .parent()
-                    .and_then(|p| p.strip_prefix(directory).ok())
-                    .map(|p| p.to_owned());
-                dll_files.push((path, subdirectory));
+        let subdirectory_for = |path: &Path| {
+            path.parent()
+                .and_then(|p| p.strip_prefix(self.directory).ok())
+                .map(|p| p.to_owned())
+        };
+
+        let mut index = self.index.lock().unwrap();
+        match file {
+            CachedFile::Dll(path) => {
+                let subdirectory = subdirectory_for(path);
+                index.dll_files.push((path.clone(), subdirectory));
             }
-            Some("vst3") => {
+            CachedFile::Vst3(path) => {
                 // NOTE: For bundles this will also contain the `foo.vst3/Contents/x86_64-win`
                 //       suffix. This needs to be stripped later.
-                let subdirectory = path
-                    .parent()
-                    .and_then(|p| p.strip_prefix(directory).ok())
-                    .map(|p| p.to_owned());
-                vst3_files.push((path, subdirectory));
+                let subdirectory = subdirectory_for(path);
+                index.vst3_files.push((path.clone(), subdirectory));
             }
-            Some("clap") => {
-                let subdirectory = path
-                    .parent()
-                    .and_then(|p| p.strip_prefix(directory).ok())
-                    .map(|p| p.to_owned());
-                clap_files.push((path, subdirectory));
+            CachedFile::Clap(path) => {
+                let subdirectory = subdirectory_for(path);
+                index.clap_files.push((path.clone(), subdirectory));
             }
-            Some("so") => {
-                if path.is_symlink() {
-                    so_files.push(NativeFile::Symlink(path));
+            CachedFile::So(native_file) => index.so_files.push(native_file.clone()),
+        }
+    }
+}
+
+/// Index a single directory, descending into its subdirectories in parallel. Rayon's scheduler
+/// takes care of the work stealing, so one huge subtree ends up spread over all threads instead
+/// of serializing the walk. When the directory's modification time matches the cached listing
+/// from the previous run the `readdir()` pass is skipped entirely and the listing is replayed
+/// from the cache.
+fn walk_directory(context: &WalkContext, directory: &Path) {
+    // This single `stat()` per directory is all the file system traffic an unchanged directory
+    // costs on a warm cache. It doubles as the loop protection for followed symlinks.
+    let metadata = match fs::metadata(directory) {
+        Ok(metadata) => metadata,
+        Err(_) => return,
+    };
+    if !context
+        .visited_directories
+        .lock()
+        .unwrap()
+        .insert((metadata.dev(), metadata.ino()))
+    {
+        return;
+    }
+
+    let mtime = metadata
+        .modified()
+        .ok()
+        .and_then(|modified| modified.duration_since(UNIX_EPOCH).ok())
+        .map(|elapsed| (elapsed.as_secs(), elapsed.subsec_nanos()));
+
+    // Cached listings still go through the regular blacklist checks below, so a cache written
+    // with a different blacklist can't smuggle pruned entries back in
+    let cached_listing = match (context.cache, mtime) {
+        (Some(cache), Some(mtime)) => cache.lookup(directory, mtime).cloned(),
+        _ => None,
+    };
+
+    let listing = cached_listing.unwrap_or_else(|| {
+        let mut files: Vec<CachedFile> = Vec::new();
+        let mut subdirectories: Vec<PathBuf> = Vec::new();
+        if let Ok(entries) = fs::read_dir(directory) {
+            for entry in entries.flatten() {
+                let path = entry.path();
+
+                // The file type from the directory entry comes along for free with the
+                // `readdir()` pass on most file systems, so non-symlink entries don't need any
+                // system calls of their own
+                let file_type = match entry.file_type() {
+                    Ok(file_type) => file_type,
+                    Err(_) => continue,
+                };
+
+                // Symlinks get resolved just like `WalkDir`'s `follow_links(true)` did, and
+                // broken symlinks are still indexed by their extension below
+                let is_dir = if file_type.is_symlink() {
+                    fs::metadata(&path)
+                        .map(|metadata| metadata.is_dir())
+                        .unwrap_or(false)
                 } else {
-                    so_files.push(NativeFile::Regular(path));
+                    file_type.is_dir()
+                };
+
+                if is_dir {
+                    subdirectories.push(path);
+                    continue;
+                }
+
+                match path.extension().and_then(|os| os.to_str()) {
+                    Some("dll") => files.push(CachedFile::Dll(path)),
+                    Some("vst3") => files.push(CachedFile::Vst3(path)),
+                    Some("clap") => files.push(CachedFile::Clap(path)),
+                    Some("so") => {
+                        if file_type.is_symlink() {
+                            files.push(CachedFile::So(NativeFile::Symlink(path)));
+                        } else {
+                            files.push(CachedFile::So(NativeFile::Regular(path)));
+                        }
+                    }
+                    _ => (),
                 }
             }
-            _ => (),
+        }
+
+        CachedDirectory {
+            mtime: mtime.unwrap_or((0, 0)),
+            files,
+            subdirectories,
+        }
+    });
+
+    for file in &listing.files {
+        if !context.is_blacklisted(file_path(file)) {
+            context.push_file(file);
         }
     }
 
-    SearchIndex {
-        dll_files,
-        vst3_files,
-        clap_files,
-        so_files,
+    listing
+        .subdirectories
+        .par_iter()
+        .filter(|subdirectory| !context.is_blacklisted(subdirectory))
+        .for_each(|subdirectory| walk_directory(context, subdirectory));
+
+    if let (Some(cache), Some(_)) = (context.cache, mtime) {
+        cache.store(directory.to_owned(), listing);
+    }
+}
+
+/// The path of an indexed file, for the blacklist check.
+fn file_path(file: &CachedFile) -> &Path {
+    match file {
+        CachedFile::Dll(path) | CachedFile::Vst3(path) | CachedFile::Clap(path) => path,
+        CachedFile::So(native_file) => native_file.path(),
     }
 }
 
+/// Find all `.dll`, `.vst3`, `.clap`, and `.so` files under a directory. These results can be
+/// filtered down to actual VST2 plugins, VST3 modules, and CLAP plugins using `search()`. Any path
+/// found in the blacklist will be pruned immediately, so this can be used to both not index
+/// individual files and to skip an entire directory.
+///
+/// The walk descends into subdirectories in parallel, and when a `ScanCache` is passed the
+/// listings of unchanged directories are replayed from the previous run instead of hitting the
+/// file system again.
+///
+/// For VST3 plugin _bundles_ the subdirectory also contains the `foo.vst3/Contents/x86_64-win`
+/// suffix. This needs to be stripped out to get the bundle root.
+pub fn index(
+    directory: &Path,
+    blacklist: &HashSet<&Path>,
+    cache: Option<&ScanCache>,
+) -> SearchIndex {
+    let context = WalkContext {
+        directory,
+        blacklist,
+        cache,
+        index: Mutex::new(SearchIndex {
+            dll_files: Vec::new(),
+            vst3_files: Vec::new(),
+            clap_files: Vec::new(),
+            so_files: Vec::new(),
+        }),
+        indexed_files: AtomicUsize::new(0),
+        visited_directories: Mutex::new(HashSet::new()),
+    };
+
+    if !context.is_blacklisted(directory) {
+        walk_directory(&context, directory);
+    }
+
+    // The parallel walk visits directories in a nondeterministic order, so the results get sorted
+    // to keep the output of `yabridgectl sync --verbose` and friends stable between runs
+    let mut index = context.index.into_inner().unwrap();
+    index.dll_files.sort_unstable();
+    index.vst3_files.sort_unstable();
+    index.clap_files.sort_unstable();
+    index
+        .so_files
+        .sort_unstable_by(|a, b| a.path().cmp(b.path()));
+
+    index
+}
+
 impl SearchIndex {
     /// Filter these indexing results down to actual VST2 plugins and VST3 modules. This will skip
     /// all invalid files, such as regular `.dll` libraries.
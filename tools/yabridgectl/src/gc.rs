@@ -0,0 +1,115 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//! Removes shared memory segments left behind by crashed or killed bridge processes, as
+//! `yabridgectl gc`. Every process that maps yabridge shared memory objects records them in a
+//! per-PID registry file, and this unlinks all segments whose recorded owners are no longer
+//! running. The registry format must stay in sync with `ShmRegistry` from
+//! `src/common/audio-shm.cpp`, which performs the same sweep whenever a new bridge starts.
+
+use anyhow::Result;
+use std::collections::HashSet;
+use std::fs;
+use std::path::Path;
+
+use crate::resources::format_size;
+
+/// The directory containing the per-process registry files, `ShmRegistry::registry_directory`.
+const REGISTRY_DIR: &str = "/dev/shm/yabridge-shm-registry";
+
+/// Remove all shared memory segments whose recorded owning processes are no longer running,
+/// along with their stale registry files.
+pub fn collect_garbage() -> Result<()> {
+    let entries = match fs::read_dir(REGISTRY_DIR) {
+        Ok(entries) => entries,
+        Err(_) => {
+            println!("No shared memory registry found, nothing to clean up.");
+            return Ok(());
+        }
+    };
+
+    // Segments recorded by a process that's still running have to be left alone even when
+    // another recorded owner is gone, since segments like the shared sidechain objects are
+    // mapped by multiple processes
+    let mut live_names: HashSet<String> = HashSet::new();
+    let mut orphans: Vec<(std::path::PathBuf, Vec<String>)> = Vec::new();
+    for entry in entries.flatten() {
+        // This also skips the temporary files used for atomic registry rewrites
+        let file_name = entry.file_name().to_string_lossy().into_owned();
+        let pid: u32 = match file_name.parse() {
+            Ok(pid) => pid,
+            Err(_) => continue,
+        };
+
+        let names: Vec<String> = match fs::read_to_string(entry.path()) {
+            Ok(contents) => contents
+                .lines()
+                // Only names written by the bridges themselves should ever end up in the
+                // registry, but since these are about to be unlinked it doesn't hurt to be
+                // careful with unexpected contents
+                .filter(|name| name.starts_with("yabridge-") && !name.contains('/'))
+                .map(str::to_owned)
+                .collect(),
+            Err(_) => continue,
+        };
+
+        // A recycled PID keeps an orphan's segments alive until that unrelated process also
+        // exits, which is the safe direction to err in
+        if Path::new(&format!("/proc/{pid}")).exists() {
+            live_names.extend(names);
+        } else {
+            orphans.push((entry.path(), names));
+        }
+    }
+
+    let mut removed_segments = 0;
+    let mut removed_bytes = 0;
+    for (registry_file, names) in orphans {
+        for name in names {
+            if live_names.contains(&name) {
+                continue;
+            }
+
+            let segment = Path::new("/dev/shm").join(&name);
+            let size = fs::metadata(&segment).map(|metadata| metadata.len());
+            if fs::remove_file(&segment).is_ok() {
+                println!(
+                    "Removed '{}' ({})",
+                    name,
+                    size.map(format_size)
+                        .unwrap_or_else(|_| "unknown size".into())
+                );
+                removed_segments += 1;
+                removed_bytes += size.unwrap_or(0);
+            }
+        }
+
+        let _ = fs::remove_file(registry_file);
+    }
+
+    if removed_segments == 0 {
+        println!("No orphaned shared memory segments found.");
+    } else {
+        println!(
+            "\nReclaimed {} in {} segment{}.",
+            format_size(removed_bytes),
+            removed_segments,
+            if removed_segments == 1 { "" } else { "s" }
+        );
+    }
+
+    Ok(())
+}
@@ -28,9 +28,14 @@ use crate::config::Config;
 mod actions;
 mod config;
 mod files;
+mod gc;
+mod resources;
+mod rt;
 mod symbols;
+mod top;
 mod util;
 mod vst3_moduleinfo;
+mod xruns;
 
 fn main() -> Result<()> {
     // We'll modify our `PATH` environment variable so it matches up with
@@ -86,6 +91,67 @@ fn main() -> Result<()> {
                 .about("Show the installation status for all plugins")
                 .display_order(4),
         )
+        .subcommand(
+            Command::new("top")
+                .about("Show live statistics for running bridged plugins")
+                .display_order(5)
+                .long_about(
+                    "Show live statistics for running bridged plugins\n\nEvery running bridged \
+                     plugin instance exposes counters for its audio processing calls, round \
+                     trip times, and event counts through shared memory. This samples those \
+                     counters once a second and shows them as a live refreshing table, so the \
+                     bridge's own overhead can be observed in production without attaching \
+                     anything to the Wine processes.",
+                ),
+        )
+        .subcommand(
+            Command::new("xruns")
+                .about("Show recorded audio processing deadline misses")
+                .display_order(6)
+                .long_about(
+                    "Show recorded audio processing deadline misses\n\nEvery running bridged \
+                     plugin instance keeps a small ring of processing calls that overran the \
+                     deadline implied by the block size and sample rate, with a breakdown of \
+                     where the time went. This reads those rings, so when the DAW reports an \
+                     xrun this can tell which instance caused it.",
+                ),
+        )
+        .subcommand(
+            Command::new("rt")
+                .about("Give running plugins' audio threads realtime priorities")
+                .display_order(7)
+                .long_about(
+                    "Give running plugins' audio threads realtime priorities\n\nThe Wine plugin \
+                     host already tries to reuse the host's realtime scheduling for its audio \
+                     threads, but that silently fails when this user doesn't have realtime \
+                     rlimits. This finds the audio threads of all running yabridge host \
+                     processes and puts them on SCHED_FIFO, either directly or through the rtkit \
+                     daemon when direct scheduling isn't permitted. Run it again after loading \
+                     more plugins.",
+                )
+                .arg(
+                    Arg::new("priority")
+                        .short('p')
+                        .long("priority")
+                        .help("The SCHED_FIFO priority to request")
+                        .value_parser(value_parser!(i32).range(1..=99))
+                        .default_value("5"),
+                ),
+        )
+        .subcommand(
+            Command::new("gc")
+                .about("Remove orphaned shared memory segments")
+                .display_order(8)
+                .long_about(
+                    "Remove orphaned shared memory segments\n\nBridged plugins back their audio \
+                     buffers with shared memory objects in '/dev/shm', and host processes that \
+                     crash or get killed leave those segments behind until the next reboot. \
+                     Running bridges record their segments in a small per-process registry, and \
+                     this removes every segment whose recorded owners are all gone. Newly \
+                     started bridges also perform this sweep themselves, so this is only needed \
+                     to free up the memory without loading another plugin.",
+                ),
+        )
         .subcommand(
             Command::new("sync")
                 .about("Set up or update yabridge for all plugins")
@@ -170,6 +236,36 @@ fn main() -> Result<()> {
                         .value_parser(value_parser!(bool)),
                 ),
         )
+        .subcommand(
+            Command::new("log-level")
+                .about("Change the log verbosity of running plugins (advanced)")
+                .display_order(202)
+                .long_about(
+                    "Change the log verbosity of running plugins (advanced)\n\nThis overrides \
+                     the verbosity set through YABRIDGE_DEBUG_LEVEL for running bridge \
+                     instances at runtime, without having to reload the plugin. The new level \
+                     applies to both the native and the Wine side of the bridge.",
+                )
+                .arg(
+                    Arg::new("instance")
+                        .help(
+                            "A running bridge instance, either the full name of its socket \
+                             directory under $XDG_RUNTIME_DIR, a substring of it such as the \
+                             plugin's name, or 'all' to change every running instance",
+                        )
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("level")
+                        .help(
+                            "The new verbosity level (0, 1, or 2), or -1 to revert back to the \
+                             level set through YABRIDGE_DEBUG_LEVEL",
+                        )
+                        .allow_negative_numbers(true)
+                        .value_parser(value_parser!(i32).range(-1..=2))
+                        .required(true),
+                ),
+        )
         .subcommand(
             Command::new("blacklist")
                 .about("Manage the indexing blacklist (advanced)")
@@ -235,6 +331,10 @@ fn main() -> Result<()> {
         }
         Some(("list", _)) => actions::list_directories(&config),
         Some(("status", _)) => actions::show_status(&config),
+        Some(("top", _)) => top::show_top(),
+        Some(("xruns", _)) => xruns::show_xruns(),
+        Some(("rt", options)) => rt::make_realtime(*options.get_one::<i32>("priority").unwrap()),
+        Some(("gc", _)) => gc::collect_garbage(),
         Some(("sync", options)) => actions::do_sync(
             &mut config,
             &actions::SyncOptions {
@@ -257,6 +357,10 @@ fn main() -> Result<()> {
                 no_verify: options.get_one::<bool>("no_verify").copied(),
             },
         ),
+        Some(("log-level", options)) => actions::set_log_level(
+            options.get_one::<String>("instance").unwrap(),
+            *options.get_one::<i32>("level").unwrap(),
+        ),
         Some(("blacklist", blacklist)) => match blacklist.subcommand() {
             Some(("add", options)) => actions::blacklist::add_path(
                 &mut config,
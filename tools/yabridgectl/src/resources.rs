@@ -0,0 +1,269 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//! A live resource view over running yabridge host processes and the shared memory objects
+//! backing their audio buffers, shown as part of `yabridgectl status`. Everything here is read
+//! from procfs and `/dev/shm`, so this only sees processes and segments belonging to the current
+//! user.
+
+use colored::Colorize;
+use std::collections::BTreeMap;
+use std::env;
+use std::fs;
+use std::path::{Path, PathBuf};
+
+/// A running `yabridge-host.exe` or `yabridge-host-32.exe` process.
+struct HostProcess {
+    pid: u32,
+    /// The host binary's file name, e.g. `yabridge-host.exe`.
+    name: String,
+    /// The name of the instance's endpoint base directory parsed from the process' command line,
+    /// e.g. `yabridge-Plugin-aB3dE9fG`. Group host processes are connected to over a socket
+    /// instead and can serve multiple instances, so for those this contains the group socket's
+    /// name.
+    instance: Option<String>,
+    /// The process' memory usage. This can be a `None` if the process exited while we were
+    /// reading it.
+    memory: Option<MemoryUsage>,
+}
+
+/// Memory usage totals for a process, from `/proc/<pid>/smaps_rollup`. All values are in bytes.
+struct MemoryUsage {
+    /// The resident set size. Memory shared between processes, like Wine's files and our shared
+    /// memory objects, gets counted in full for every process mapping it.
+    rss: u64,
+    /// The proportional set size, where shared pages are divided over the processes sharing them.
+    /// Summing this column gives an honest total.
+    pss: u64,
+}
+
+/// Print the resource usage of all running yabridge host processes and all yabridge shared memory
+/// segments, grouped by plugin instance. Prints nothing when no bridges are running and no
+/// segments exist, since most `yabridgectl status` invocations happen while setting things up.
+pub fn show_resource_usage() {
+    let processes = collect_host_processes();
+    let segments = collect_shm_segments();
+    if processes.is_empty() && segments.is_empty() {
+        return;
+    }
+
+    if !segments.is_empty() {
+        println!("\nShared memory usage ('/dev/shm'):");
+
+        // The audio buffer and heartbeat segments are named after the instance's endpoint base
+        // directory, so they can be grouped per plugin instance
+        let mut instances: BTreeMap<String, (u64, usize)> = BTreeMap::new();
+        let mut total_size = 0;
+        for (name, size) in &segments {
+            let entry = instances.entry(instance_for_segment(name)).or_default();
+            entry.0 += size;
+            entry.1 += 1;
+            total_size += size;
+        }
+
+        // An instance's socket directory exists for as long as the instance is alive, so
+        // segments without one were leaked by a crashed or killed process
+        let runtime_dir = instance_runtime_dir();
+        for (instance, (size, num_segments)) in instances {
+            let leaked = !runtime_dir.join(&instance).is_dir();
+            println!(
+                "  {}: {} in {} segment{}{}",
+                instance,
+                format_size(size),
+                num_segments,
+                if num_segments == 1 { "" } else { "s" },
+                if leaked {
+                    format!(" ({})", "no running instance, leaked?".red())
+                } else {
+                    String::new()
+                }
+            );
+        }
+        println!("  total: {}", format_size(total_size));
+    }
+
+    if !processes.is_empty() {
+        println!("\nHost process memory usage:");
+        for process in processes {
+            let memory = match process.memory {
+                Some(memory) => format!(
+                    "{} resident, {} proportional",
+                    format_size(memory.rss),
+                    format_size(memory.pss)
+                ),
+                None => "<could not read memory usage>".into(),
+            };
+
+            println!(
+                "  pid {} {} ({}): {}",
+                process.pid,
+                process.name,
+                process.instance.as_deref().unwrap_or("<unknown instance>"),
+                memory
+            );
+        }
+    }
+}
+
+/// Find all running yabridge host processes belonging to the current user. Processes we can't
+/// inspect are silently skipped.
+fn collect_host_processes() -> Vec<HostProcess> {
+    let mut processes = Vec::new();
+
+    let entries = match fs::read_dir("/proc") {
+        Ok(entries) => entries,
+        Err(_) => return processes,
+    };
+    for entry in entries.flatten() {
+        let pid: u32 = match entry.file_name().to_string_lossy().parse() {
+            Ok(pid) => pid,
+            Err(_) => continue,
+        };
+        let cmdline = match fs::read(format!("/proc/{pid}/cmdline")) {
+            Ok(cmdline) => cmdline,
+            Err(_) => continue,
+        };
+        let args: Vec<String> = cmdline
+            .split(|&byte| byte == 0)
+            .filter(|arg| !arg.is_empty())
+            .map(|arg| String::from_utf8_lossy(arg).into_owned())
+            .collect();
+
+        // The host processes are launched as `yabridge-host.exe <type> <path> <endpoint> <pid>`,
+        // but Wine may prepend its own loader to the command line so we'll look for the host
+        // binary anywhere in there
+        let name = match args.iter().find_map(|arg| {
+            let file_name = Path::new(arg).file_name()?.to_string_lossy();
+            file_name
+                .starts_with("yabridge-host")
+                .then(|| file_name.into_owned())
+        }) {
+            Some(name) => name,
+            None => continue,
+        };
+
+        // The endpoint base directory argument tells us which instance this process serves.
+        // Group host processes are launched with the group's socket path instead, which also
+        // makes for a useful label even if it doesn't map to a single instance.
+        let instance = args.iter().find_map(|arg| {
+            if !arg.contains('/') {
+                return None;
+            }
+
+            let file_name = Path::new(arg).file_name()?.to_string_lossy();
+            (file_name.starts_with("yabridge-") && !file_name.starts_with("yabridge-host"))
+                .then(|| file_name.into_owned())
+        });
+
+        processes.push(HostProcess {
+            pid,
+            name,
+            instance,
+            memory: read_memory_usage(pid),
+        });
+    }
+
+    processes.sort_by_key(|process| process.pid);
+    processes
+}
+
+/// Read a process' memory usage from `/proc/<pid>/smaps_rollup`. Returns a `None` when the
+/// process has already exited or belongs to another user.
+fn read_memory_usage(pid: u32) -> Option<MemoryUsage> {
+    let contents = fs::read_to_string(format!("/proc/{pid}/smaps_rollup")).ok()?;
+
+    let mut rss = 0;
+    let mut pss = 0;
+    for line in contents.lines() {
+        let mut fields = line.split_whitespace();
+        // All interesting lines look like `Rss:   123456 kB`
+        let (key, value) = match (fields.next(), fields.next()) {
+            (Some(key), Some(value)) => (key, value),
+            _ => continue,
+        };
+        let value: u64 = match value.parse() {
+            Ok(value) => value,
+            Err(_) => continue,
+        };
+
+        match key {
+            "Rss:" => rss = value * 1024,
+            "Pss:" => pss = value * 1024,
+            _ => (),
+        }
+    }
+
+    Some(MemoryUsage { rss, pss })
+}
+
+/// Find all yabridge shared memory segments in `/dev/shm`, as `(name, size in bytes)` pairs.
+fn collect_shm_segments() -> Vec<(String, u64)> {
+    let mut segments = Vec::new();
+
+    let entries = match fs::read_dir("/dev/shm") {
+        Ok(entries) => entries,
+        Err(_) => return segments,
+    };
+    for entry in entries.flatten() {
+        let name = entry.file_name().to_string_lossy().into_owned();
+        if !name.starts_with("yabridge-") {
+            continue;
+        }
+
+        let size = entry.metadata().map(|metadata| metadata.len()).unwrap_or(0);
+        segments.push((name, size));
+    }
+
+    segments
+}
+
+/// Map a shared memory segment's name to the name of the plugin instance's endpoint base
+/// directory. The audio buffers are either named exactly after that directory (VST2), or with a
+/// numeric object instance ID appended (VST3 and CLAP). The heartbeat buffer appends
+/// `-heartbeat`.
+fn instance_for_segment(segment_name: &str) -> String {
+    let name = segment_name
+        .strip_suffix("-heartbeat")
+        .unwrap_or(segment_name);
+    match name.rsplit_once('-') {
+        Some((prefix, suffix)) if suffix.chars().all(|c| c.is_ascii_digit()) => prefix.to_owned(),
+        _ => name.to_owned(),
+    }
+}
+
+/// The directory containing the per-instance socket directories. This must match
+/// `get_temporary_directory()` from `src/common/utils.cpp`.
+fn instance_runtime_dir() -> PathBuf {
+    env::var("XDG_RUNTIME_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(|_| PathBuf::from("/tmp"))
+}
+
+/// Format a byte count as a human readable string.
+pub fn format_size(bytes: u64) -> String {
+    const KIB: f64 = 1024.0;
+    const MIB: f64 = 1024.0 * KIB;
+    const GIB: f64 = 1024.0 * MIB;
+
+    let bytes = bytes as f64;
+    if bytes >= GIB {
+        format!("{:.1} GiB", bytes / GIB)
+    } else if bytes >= MIB {
+        format!("{:.1} MiB", bytes / MIB)
+    } else {
+        format!("{:.1} KiB", bytes / KIB)
+    }
+}
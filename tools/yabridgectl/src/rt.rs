@@ -0,0 +1,288 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//! Requests realtime scheduling for the audio threads of running Wine plugin host processes, as
+//! `yabridgectl rt`. The Wine side already tries to apply `SCHED_FIFO` to its own audio threads,
+//! but that silently fails on systems without realtime rlimits for the user. This finds those
+//! threads from the outside through the kernel-visible thread names set by `ThreadRegistry` in
+//! `src/common/utils.h`, and escalates to rtkit when direct scheduling is not permitted.
+
+use anyhow::Result;
+use colored::Colorize;
+use std::fs;
+use std::path::Path;
+use std::process::Command;
+
+/// The `SCHED_FIFO` scheduling policy on Linux.
+const SCHED_FIFO: i32 = 1;
+/// The `RLIMIT_RTTIME` resource on Linux, in microseconds of uninterrupted realtime CPU time.
+const RLIMIT_RTTIME: i32 = 15;
+/// The `RLIMIT_RTTIME` value to apply before going through rtkit, which refuses threads without a
+/// finite limit. 200 milliseconds matches rtkit's default maximum and what PipeWire's realtime
+/// module uses.
+const RTKIT_RTTIME_US: u64 = 200_000;
+
+/// `struct sched_param` from `<sched.h>`. Only the priority field exists on Linux.
+#[repr(C)]
+struct SchedParam {
+    sched_priority: i32,
+}
+
+/// `struct rlimit64` from `<sys/resource.h>`.
+#[repr(C)]
+struct Rlimit64 {
+    rlim_cur: u64,
+    rlim_max: u64,
+}
+
+extern "C" {
+    fn sched_setscheduler(pid: i32, policy: i32, param: *const SchedParam) -> i32;
+    fn prlimit64(
+        pid: i32,
+        resource: i32,
+        new_limit: *const Rlimit64,
+        old_limit: *mut Rlimit64,
+    ) -> i32;
+}
+
+/// A running Wine plugin host process along with its audio threads.
+struct HostProcess {
+    pid: i32,
+    /// A human readable description, either the group's name or the hosted plugin's file name.
+    description: String,
+    /// The Linux thread IDs of the process' audio threads, found through the thread names set by
+    /// the thread registry.
+    audio_threads: Vec<i32>,
+}
+
+/// How a thread ended up with realtime scheduling.
+enum RtMethod {
+    /// Through a direct `sched_setscheduler()` call, which works when this user has realtime
+    /// rlimits.
+    Direct,
+    /// Through rtkit's `MakeThreadRealtimeWithPID` D-Bus call.
+    Rtkit,
+}
+
+/// Request `SCHED_FIFO` scheduling at the given priority for the audio threads of all running
+/// yabridge host processes.
+pub fn make_realtime(priority: i32) -> Result<()> {
+    let mut processes = find_host_processes();
+    if processes.is_empty() {
+        println!("No running yabridge host processes found.");
+        return Ok(());
+    }
+
+    processes.sort_by_key(|process| process.pid);
+
+    let mut had_failures = false;
+    for process in processes {
+        if process.audio_threads.is_empty() {
+            println!(
+                "{} (pid {}): no audio threads yet, load a plugin first",
+                process.description.bright_white(),
+                process.pid
+            );
+            continue;
+        }
+
+        let mut direct = 0;
+        let mut rtkit = 0;
+        let mut failed = 0;
+        for tid in &process.audio_threads {
+            match make_thread_realtime(process.pid, *tid, priority) {
+                Some(RtMethod::Direct) => direct += 1,
+                Some(RtMethod::Rtkit) => rtkit += 1,
+                None => failed += 1,
+            }
+        }
+
+        let num_threads = process.audio_threads.len();
+        let summary = if failed == 0 {
+            format!(
+                "{} audio thread{} now SCHED_FIFO {}{}",
+                num_threads,
+                if num_threads == 1 { "" } else { "s" },
+                priority,
+                if rtkit > 0 && direct == 0 {
+                    " (through rtkit)"
+                } else {
+                    ""
+                }
+            )
+            .green()
+        } else {
+            had_failures = true;
+            format!(
+                "could not set realtime priorities for {} of {} audio thread{}",
+                failed,
+                num_threads,
+                if num_threads == 1 { "" } else { "s" }
+            )
+            .red()
+        };
+
+        println!(
+            "{} (pid {}): {}",
+            process.description.bright_white(),
+            process.pid,
+            summary
+        );
+    }
+
+    if had_failures {
+        println!();
+        println!(
+            "Setting realtime priorities requires either realtime rlimits for this user (see \
+             your distro's pro-audio setup instructions) or a running rtkit daemon with \
+             'dbus-send' installed."
+        );
+    }
+
+    Ok(())
+}
+
+/// Find all running yabridge host processes by scanning `/proc`. The host binaries for both
+/// architectures are named `yabridge-host*`, so matching on the first command line argument covers
+/// individually hosted plugins, group hosts, and warm hosts alike.
+fn find_host_processes() -> Vec<HostProcess> {
+    let mut processes = Vec::new();
+
+    let entries = match fs::read_dir("/proc") {
+        Ok(entries) => entries,
+        Err(_) => return processes,
+    };
+    for entry in entries.flatten() {
+        let pid: i32 = match entry.file_name().to_string_lossy().parse() {
+            Ok(pid) => pid,
+            Err(_) => continue,
+        };
+
+        let cmdline = match fs::read(entry.path().join("cmdline")) {
+            Ok(cmdline) => cmdline,
+            Err(_) => continue,
+        };
+        let argv: Vec<&str> = cmdline
+            .split(|byte| *byte == 0)
+            .filter(|arg| !arg.is_empty())
+            .filter_map(|arg| std::str::from_utf8(arg).ok())
+            .collect();
+        let is_host = argv
+            .first()
+            .map(|arg| {
+                Path::new(arg)
+                    .file_name()
+                    .map(|name| name.to_string_lossy().starts_with("yabridge-host"))
+                    .unwrap_or(false)
+            })
+            .unwrap_or(false);
+        if !is_host {
+            continue;
+        }
+
+        processes.push(HostProcess {
+            pid,
+            description: describe_host(&argv),
+            audio_threads: find_audio_threads(pid),
+        });
+    }
+
+    processes
+}
+
+/// Build a short description of a host process from its command line. Group and warm hosts are
+/// named after their socket, individually hosted plugins after the plugin file.
+fn describe_host(argv: &[&str]) -> String {
+    match argv.get(1).copied() {
+        Some("group") => match argv.get(2).and_then(|path| Path::new(path).file_stem()) {
+            Some(socket) => format!("group host '{}'", socket.to_string_lossy()),
+            None => String::from("group host"),
+        },
+        // Individually hosted plugins get the plugin type followed by the plugin path
+        Some(_) => match argv.get(2).and_then(|path| Path::new(path).file_name()) {
+            Some(plugin) => plugin.to_string_lossy().into_owned(),
+            None => String::from("yabridge host"),
+        },
+        None => String::from("yabridge host"),
+    }
+}
+
+/// Find the audio threads of a process through the kernel-visible thread names applied by the
+/// thread registry. These are the per-instance `audio` and `audio-<n>` socket threads along with
+/// the `audio-pool-<n>` and `clap-pool-<n>` worker pools.
+fn find_audio_threads(pid: i32) -> Vec<i32> {
+    let mut threads = Vec::new();
+
+    let entries = match fs::read_dir(format!("/proc/{pid}/task")) {
+        Ok(entries) => entries,
+        Err(_) => return threads,
+    };
+    for entry in entries.flatten() {
+        let tid: i32 = match entry.file_name().to_string_lossy().parse() {
+            Ok(tid) => tid,
+            Err(_) => continue,
+        };
+
+        let comm = match fs::read_to_string(entry.path().join("comm")) {
+            Ok(comm) => comm,
+            Err(_) => continue,
+        };
+        let comm = comm.trim_end();
+        if comm == "audio" || comm.starts_with("audio-") || comm.starts_with("clap-pool") {
+            threads.push(tid);
+        }
+    }
+
+    threads
+}
+
+/// Try to get a single thread onto `SCHED_FIFO` at the given priority, first directly and then
+/// through rtkit. Returns how the scheduling was applied, or a `None` when both attempts failed.
+fn make_thread_realtime(pid: i32, tid: i32, priority: i32) -> Option<RtMethod> {
+    // This works without any daemons when the user has a sufficient `RLIMIT_RTPRIO`, which the
+    // usual pro-audio setups grant through the audio group
+    let param = SchedParam {
+        sched_priority: priority,
+    };
+    if unsafe { sched_setscheduler(tid, SCHED_FIFO, &param) } == 0 {
+        return Some(RtMethod::Direct);
+    }
+
+    // rtkit refuses threads without a finite `RLIMIT_RTTIME`, and the Wine host processes don't
+    // set one themselves. Lowering another same-user process' limit doesn't require privileges.
+    let rttime = Rlimit64 {
+        rlim_cur: RTKIT_RTTIME_US,
+        rlim_max: RTKIT_RTTIME_US,
+    };
+    unsafe { prlimit64(pid, RLIMIT_RTTIME, &rttime, std::ptr::null_mut()) };
+
+    // There's no lightweight D-Bus crate worth pulling in for a single method call, and dbus-send
+    // ships with the bus daemon rtkit requires anyways
+    let result = Command::new("dbus-send")
+        .arg("--system")
+        .arg("--print-reply")
+        .arg("--dest=org.freedesktop.RealtimeKit1")
+        .arg("/org/freedesktop/RealtimeKit1")
+        .arg("org.freedesktop.RealtimeKit1.MakeThreadRealtimeWithPID")
+        .arg(format!("uint64:{pid}"))
+        .arg(format!("uint64:{tid}"))
+        .arg(format!("uint32:{priority}"))
+        .output();
+    match result {
+        Ok(output) if output.status.success() => Some(RtMethod::Rtkit),
+        _ => None,
+    }
+}
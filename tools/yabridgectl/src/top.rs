@@ -0,0 +1,225 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//! A live, `top`-style view over the statistics counters running bridged plugin instances expose
+//! through shared memory, as `yabridgectl top`. The counters are free-running totals, so rates
+//! and recent means are computed by sampling every instance's block once a second and diffing
+//! against the previous sample. The parsing here must stay in sync with `InstanceStats` from
+//! `src/common/audio-shm.h`.
+
+use anyhow::Result;
+use colored::Colorize;
+use std::collections::BTreeMap;
+use std::fs;
+use std::io::{self, Write};
+use std::thread;
+use std::time::{Duration, Instant};
+
+/// `InstanceStats::magic_value`, the bytes `stat` read as a little endian word.
+const STATS_MAGIC: u32 = 0x74617473;
+/// The `InstanceStats::current_version` this parser was written against.
+const STATS_VERSION: u32 = 1;
+
+/// The size of `InstanceStats` in bytes.
+const STATS_SIZE: usize = 48;
+
+/// The byte offset of `XrunRingHeader::sequence`, used to also show every instance's total
+/// deadline miss count. See `xruns.rs` for the full ring parser.
+const XRUN_SEQUENCE_OFFSET: usize = 16;
+
+/// A parsed `InstanceStats` block, plus the instance's total xrun count.
+#[derive(Clone, Copy, Default)]
+struct Snapshot {
+    /// The size of the most recently processed block in samples.
+    last_sample_frames: u32,
+    /// The instance's current sample rate in Hz, or zero when the host hasn't set one yet.
+    sample_rate: u32,
+    /// The total number of bridged audio processing calls.
+    process_calls: u64,
+    /// The total time spent inside bridged audio processing calls, in microseconds.
+    process_time_us: u64,
+    /// The longest single bridged audio processing call, in microseconds.
+    max_process_time_us: u64,
+    /// The total number of events the host has passed to the plugin.
+    events: u64,
+    /// The total number of deadline misses from the instance's xrun ring, see `yabridgectl
+    /// xruns`.
+    xruns: u64,
+}
+
+/// Refresh and print the statistics of all running bridged instances once a second, until the
+/// user interrupts us.
+pub fn show_top() -> Result<()> {
+    let mut previous = collect_snapshots();
+    let mut previous_time = Instant::now();
+
+    loop {
+        thread::sleep(Duration::from_secs(1));
+
+        let current = collect_snapshots();
+        let now = Instant::now();
+        let elapsed = (now - previous_time).as_secs_f64();
+
+        // Clear the terminal and move the cursor back to the top left
+        print!("\x1B[2J\x1B[H");
+        render(&previous, &current, elapsed);
+        io::stdout().flush()?;
+
+        previous = current;
+        previous_time = now;
+    }
+}
+
+/// Print one frame of the view, with rates and means computed over the sampling interval.
+fn render(
+    previous: &BTreeMap<String, Snapshot>,
+    current: &BTreeMap<String, Snapshot>,
+    elapsed: f64,
+) {
+    if current.is_empty() {
+        println!("No running yabridge instances found, press Ctrl-C to exit.");
+        return;
+    }
+
+    let name_width = current
+        .keys()
+        .map(|instance| instance.len())
+        .max()
+        .unwrap_or(0)
+        .max("INSTANCE".len());
+    println!(
+        "{}",
+        format!(
+            "{:<name_width$}  {:>8} {:>9} {:>9} {:>8} {:>7} {:>7} {:>6}",
+            "INSTANCE", "CALLS/S", "MEAN MS", "MAX MS", "EV/S", "FRAMES", "RATE", "XRUNS"
+        )
+        .bright_white()
+    );
+
+    for (instance, stats) in current {
+        // Instances that just appeared don't have a delta yet, so their rates start out at zero
+        let previous_stats = previous.get(instance).copied().unwrap_or_default();
+        let delta_calls = stats.process_calls.saturating_sub(previous_stats.process_calls);
+        let delta_time_us = stats
+            .process_time_us
+            .saturating_sub(previous_stats.process_time_us);
+        let delta_events = stats.events.saturating_sub(previous_stats.events);
+
+        let calls_per_second = delta_calls as f64 / elapsed;
+        let mean_ms = if delta_calls > 0 {
+            delta_time_us as f64 / delta_calls as f64 / 1000.0
+        } else {
+            0.0
+        };
+        let max_ms = stats.max_process_time_us as f64 / 1000.0;
+        let events_per_second = delta_events as f64 / elapsed;
+
+        // Pad before colorizing, since the invisible escape codes would
+        // otherwise count towards the column width
+        let xruns = format!("{:>6}", stats.xruns);
+        let xruns = if stats.xruns > 0 {
+            xruns.red().to_string()
+        } else {
+            xruns
+        };
+        println!(
+            "{instance:<name_width$}  {calls_per_second:>8.1} {mean_ms:>9.2} {max_ms:>9.2} \
+             {events_per_second:>8.1} {:>7} {:>7} {xruns}",
+            stats.last_sample_frames, stats.sample_rate
+        );
+    }
+
+    println!();
+    println!("Refreshing every second, press Ctrl-C to exit.");
+}
+
+/// Read the stats blocks of all running instances from `/dev/shm`, keyed by the name of the
+/// instance's endpoint base directory. Objects that can't be read or parsed are silently skipped.
+fn collect_snapshots() -> BTreeMap<String, Snapshot> {
+    let mut snapshots = BTreeMap::new();
+
+    let entries = match fs::read_dir("/dev/shm") {
+        Ok(entries) => entries,
+        Err(_) => return snapshots,
+    };
+    for entry in entries.flatten() {
+        let name = entry.file_name().to_string_lossy().into_owned();
+        let instance = match name
+            .strip_suffix("-stats")
+            .filter(|_| name.starts_with("yabridge-"))
+        {
+            Some(instance) => instance.to_owned(),
+            None => continue,
+        };
+
+        let bytes = match fs::read(entry.path()) {
+            Ok(bytes) => bytes,
+            Err(_) => continue,
+        };
+        if let Some(mut snapshot) = parse_stats(&bytes) {
+            snapshot.xruns = read_xrun_count(&instance);
+            snapshots.insert(instance, snapshot);
+        }
+    }
+
+    snapshots
+}
+
+/// Parse the contents of a shared memory object as an `InstanceStats` block. Returns a `None`
+/// when the object doesn't contain a valid block, for instance because it was written by an
+/// incompatible yabridge version.
+fn parse_stats(bytes: &[u8]) -> Option<Snapshot> {
+    if bytes.len() < STATS_SIZE {
+        return None;
+    }
+
+    let magic = read_u32(bytes, 0)?;
+    let version = read_u32(bytes, 4)?;
+    if magic != STATS_MAGIC || version != STATS_VERSION {
+        return None;
+    }
+
+    Some(Snapshot {
+        last_sample_frames: read_u32(bytes, 8)?,
+        sample_rate: read_u32(bytes, 12)?,
+        process_calls: read_u64(bytes, 16)?,
+        process_time_us: read_u64(bytes, 24)?,
+        max_process_time_us: read_u64(bytes, 32)?,
+        events: read_u64(bytes, 40)?,
+        xruns: 0,
+    })
+}
+
+/// Read an instance's total deadline miss count from its xrun ring, or zero when the ring can't
+/// be read.
+fn read_xrun_count(instance: &str) -> u64 {
+    fs::read(format!("/dev/shm/{instance}-xruns"))
+        .ok()
+        .and_then(|bytes| read_u64(&bytes, XRUN_SEQUENCE_OFFSET))
+        .unwrap_or(0)
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> Option<u32> {
+    Some(u32::from_le_bytes(
+        bytes.get(offset..offset + 4)?.try_into().ok()?,
+    ))
+}
+
+fn read_u64(bytes: &[u8], offset: usize) -> Option<u64> {
+    Some(u64::from_le_bytes(
+        bytes.get(offset..offset + 8)?.try_into().ok()?,
+    ))
+}
@@ -0,0 +1,247 @@
+// yabridge: a Wine plugin bridge
+// Copyright (C) 2020-2024 Robbert van der Helm
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//! Shows the audio processing deadline misses recorded by running bridged plugin instances, as
+//! `yabridgectl xruns`. Every instance exposes a small ring of miss records through a shared
+//! memory object in `/dev/shm`, and this reads those rings directly. The parsing here must stay
+//! in sync with `XrunRing` from `src/common/audio-shm.h`.
+
+use anyhow::Result;
+use colored::Colorize;
+use std::fs;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+/// `XrunRingHeader::magic_value`, the bytes `xrun` read as a little endian word.
+const XRUN_RING_MAGIC: u32 = 0x6e757278;
+/// The `XrunRingHeader::current_version` this parser was written against.
+const XRUN_RING_VERSION: u32 = 1;
+
+/// The size of `XrunRingHeader` in bytes.
+const HEADER_SIZE: usize = 24;
+/// The size of `XrunRecord` in bytes.
+const RECORD_SIZE: usize = 40;
+
+/// A parsed `XrunRecord`, a single deadline miss recorded by an instance's audio thread.
+struct XrunRecord {
+    /// When the miss happened, in microseconds since the Unix epoch.
+    timestamp_us: u64,
+    /// The object instance ID within the bridge for VST3 and CLAP plugins, or zero for VST2
+    /// plugins.
+    instance_id: u64,
+    /// The block size of the processing call that missed its deadline.
+    sample_frames: u32,
+    /// The deadline for the block derived from the block size and sample rate.
+    deadline_us: u32,
+    /// How long the entire bridged processing call took.
+    duration_us: u32,
+    /// Time spent copying the host's inputs to the shared audio buffers.
+    copy_in_us: u32,
+    /// Time spent waiting on the Wine plugin host, covering both the bridging round trip and the
+    /// plugin's own processing.
+    round_trip_us: u32,
+    /// Time spent copying the outputs back to the host.
+    copy_out_us: u32,
+}
+
+/// The parsed contents of one instance's xrun ring.
+struct XrunRing {
+    /// The name of the instance's endpoint base directory, e.g. `yabridge-Plugin-aB3dE9fG`.
+    instance: String,
+    /// The total number of misses recorded since the instance started. The ring only retains the
+    /// most recent records, so this can exceed `records.len()`.
+    total_misses: u64,
+    /// The retained records, oldest first.
+    records: Vec<XrunRecord>,
+}
+
+/// Print all audio processing deadline misses recorded by running bridged plugin instances.
+pub fn show_xruns() -> Result<()> {
+    let mut rings = collect_xrun_rings();
+    if rings.is_empty() {
+        println!("No running yabridge instances found.");
+        return Ok(());
+    }
+
+    rings.sort_by(|a, b| a.instance.cmp(&b.instance));
+    if rings.iter().all(|ring| ring.total_misses == 0) {
+        println!(
+            "{} running instance{}, no deadline misses have been recorded.",
+            rings.len(),
+            if rings.len() == 1 { "" } else { "s" }
+        );
+        return Ok(());
+    }
+
+    for ring in rings {
+        if ring.total_misses == 0 {
+            println!("{}: no deadline misses", ring.instance.bright_white());
+            continue;
+        }
+
+        let truncated = ring.total_misses > ring.records.len() as u64;
+        println!(
+            "{}: {} deadline miss{}{}",
+            ring.instance.bright_white(),
+            ring.total_misses,
+            if ring.total_misses == 1 { "" } else { "es" },
+            if truncated {
+                format!(", showing the last {}", ring.records.len())
+            } else {
+                String::new()
+            }
+        );
+
+        // Most recent misses first, since those are the ones being debugged
+        for record in ring.records.iter().rev() {
+            let instance = if record.instance_id == 0 {
+                String::new()
+            } else {
+                format!(" object {}", record.instance_id)
+            };
+            println!(
+                "  {} ago{}: {} frames took {} of its {} budget (copy in {}, Wine host {}, \
+                 copy out {})",
+                format_ago(record.timestamp_us),
+                instance,
+                record.sample_frames,
+                format_ms(record.duration_us).red(),
+                format_ms(record.deadline_us),
+                format_ms(record.copy_in_us),
+                format_ms(record.round_trip_us),
+                format_ms(record.copy_out_us)
+            );
+        }
+    }
+
+    Ok(())
+}
+
+/// Find and parse all xrun rings in `/dev/shm`. Objects that can't be read or parsed are silently
+/// skipped, just like in the resource overview.
+fn collect_xrun_rings() -> Vec<XrunRing> {
+    let mut rings = Vec::new();
+
+    let entries = match fs::read_dir("/dev/shm") {
+        Ok(entries) => entries,
+        Err(_) => return rings,
+    };
+    for entry in entries.flatten() {
+        let name = entry.file_name().to_string_lossy().into_owned();
+        let instance = match name
+            .strip_suffix("-xruns")
+            .filter(|_| name.starts_with("yabridge-"))
+        {
+            Some(instance) => instance.to_owned(),
+            None => continue,
+        };
+
+        let bytes = match fs::read(entry.path()) {
+            Ok(bytes) => bytes,
+            Err(_) => continue,
+        };
+        if let Some(ring) = parse_ring(instance, &bytes) {
+            rings.push(ring);
+        }
+    }
+
+    rings
+}
+
+/// Parse the contents of a shared memory object as an xrun ring. Returns a `None` when the object
+/// doesn't contain a valid ring, for instance because it was written by an incompatible yabridge
+/// version.
+fn parse_ring(instance: String, bytes: &[u8]) -> Option<XrunRing> {
+    if bytes.len() < HEADER_SIZE {
+        return None;
+    }
+
+    let magic = read_u32(bytes, 0)?;
+    let version = read_u32(bytes, 4)?;
+    let capacity = read_u32(bytes, 8)? as usize;
+    let sequence = read_u64(bytes, 16)?;
+    if magic != XRUN_RING_MAGIC || version != XRUN_RING_VERSION {
+        return None;
+    }
+    if bytes.len() < HEADER_SIZE + capacity * RECORD_SIZE || capacity == 0 {
+        return None;
+    }
+
+    // The sequence counter points at the slot the next record will overwrite, so once the ring
+    // has wrapped the oldest retained record lives right at that slot
+    let num_records = sequence.min(capacity as u64) as usize;
+    let mut records = Vec::with_capacity(num_records);
+    for record_idx in 0..num_records {
+        let slot = ((sequence + record_idx as u64).wrapping_sub(num_records as u64)
+            % capacity as u64) as usize;
+        records.push(parse_record(bytes, HEADER_SIZE + slot * RECORD_SIZE)?);
+    }
+
+    Some(XrunRing {
+        instance,
+        total_misses: sequence,
+        records,
+    })
+}
+
+/// Parse a single `XrunRecord` at the given byte offset.
+fn parse_record(bytes: &[u8], offset: usize) -> Option<XrunRecord> {
+    Some(XrunRecord {
+        timestamp_us: read_u64(bytes, offset)?,
+        instance_id: read_u64(bytes, offset + 8)?,
+        sample_frames: read_u32(bytes, offset + 16)?,
+        deadline_us: read_u32(bytes, offset + 20)?,
+        duration_us: read_u32(bytes, offset + 24)?,
+        copy_in_us: read_u32(bytes, offset + 28)?,
+        round_trip_us: read_u32(bytes, offset + 32)?,
+        copy_out_us: read_u32(bytes, offset + 36)?,
+    })
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> Option<u32> {
+    Some(u32::from_le_bytes(
+        bytes.get(offset..offset + 4)?.try_into().ok()?,
+    ))
+}
+
+fn read_u64(bytes: &[u8], offset: usize) -> Option<u64> {
+    Some(u64::from_le_bytes(
+        bytes.get(offset..offset + 8)?.try_into().ok()?,
+    ))
+}
+
+/// Format a microsecond duration as milliseconds.
+fn format_ms(us: u32) -> String {
+    format!("{:.1} ms", us as f64 / 1000.0)
+}
+
+/// Format how long ago a wall clock timestamp in microseconds since the Unix epoch was.
+fn format_ago(timestamp_us: u64) -> String {
+    let now_us = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|elapsed| elapsed.as_micros() as u64)
+        .unwrap_or(0);
+    let seconds = now_us.saturating_sub(timestamp_us) / 1_000_000;
+
+    if seconds < 60 {
+        format!("{seconds}s")
+    } else if seconds < 60 * 60 {
+        format!("{}m{:02}s", seconds / 60, seconds % 60)
+    } else if seconds < 24 * 60 * 60 {
+        format!("{}h{:02}m", seconds / (60 * 60), (seconds / 60) % 60)
+    } else {
+        format!("{}d", seconds / (24 * 60 * 60))
+    }
+}